@@ -0,0 +1,108 @@
+#pragma once
+
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the arduino-esp32 core, enough for the services to build and run
+ * natively: String, IPAddress, millis()/micros()/delay() and the FreeRTOS / esp_timer headers
+ * the core pulls in. Not part of the firmware.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#define IRAM_ATTR
+
+inline unsigned long millis() { return (unsigned long)(esp_timer_get_time() / 1000ULL); }
+inline unsigned long micros() { return (unsigned long)esp_timer_get_time(); }
+inline void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+/// The subset of Arduino's String the firmware uses, over std::string.
+class String
+{
+public:
+    String(const char *s = "") : _s(s ? s : "") {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+    explicit String(unsigned int v) : _s(std::to_string(v)) {}
+    explicit String(long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    void reserve(unsigned int n) { _s.reserve(n); }
+
+    String &operator+=(const String &o)
+    {
+        _s += o._s;
+        return *this;
+    }
+    String &operator+=(const char *o)
+    {
+        _s += o ? o : "";
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        _s += c;
+        return *this;
+    }
+
+    friend String operator+(String a, const String &b) { return a += b; }
+    friend String operator+(String a, const char *b) { return a += b; }
+
+    bool operator==(const String &o) const { return _s == o._s; }
+    bool operator==(const char *o) const { return o && _s == o; }
+    bool operator!=(const String &o) const { return !(*this == o); }
+    bool operator!=(const char *o) const { return !(*this == o); }
+
+private:
+    std::string _s;
+};
+
+/// IPv4 address; 0.0.0.0 is "not set", like on the device.
+class IPAddress
+{
+public:
+    IPAddress() = default;
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _b{a, b, c, d} {}
+
+    uint8_t operator[](int i) const { return _b[i & 3]; }
+    bool operator==(const IPAddress &o) const { return memcmp(_b, o._b, sizeof(_b)) == 0; }
+    bool operator!=(const IPAddress &o) const { return !(*this == o); }
+
+    bool fromString(const char *s)
+    {
+        unsigned v[4];
+        char tail;
+        if (!s || sscanf(s, "%u.%u.%u.%u%c", &v[0], &v[1], &v[2], &v[3], &tail) != 4)
+            return false;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (v[i] > 255)
+                return false;
+            _b[i] = (uint8_t)v[i];
+        }
+        return true;
+    }
+
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t _b[4]{};
+};
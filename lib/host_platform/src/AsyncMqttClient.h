@@ -0,0 +1,95 @@
+#pragma once
+
+/**
+ * @file AsyncMqttClient.h
+ * @brief Host AsyncMqttClient that never reaches a broker: it stays disconnected and refuses
+ * every packet. MqttService keeps it as its default transport on the host too; tests hand it
+ * a LoopbackTransport with setTransport().
+ */
+
+#include "Arduino.h"
+
+#include <functional>
+
+struct AsyncMqttClientMessageProperties
+{
+    uint8_t qos;
+    bool dup;
+    bool retain;
+};
+
+enum class AsyncMqttClientDisconnectReason : uint8_t
+{
+    TCP_DISCONNECTED = 0,
+};
+
+class AsyncMqttClient
+{
+public:
+    using OnConnect = std::function<void(bool sessionPresent)>;
+    using OnDisconnect = std::function<void(AsyncMqttClientDisconnectReason reason)>;
+    using OnSubscribe = std::function<void(uint16_t packetId, uint8_t qos)>;
+    using OnPacket = std::function<void(uint16_t packetId)>;
+    using OnMessage = std::function<void(char *topic, char *payload, AsyncMqttClientMessageProperties props,
+                                         size_t len, size_t index, size_t total)>;
+
+    AsyncMqttClient &onConnect(OnConnect cb) { return set(_onConnect, std::move(cb)); }
+    AsyncMqttClient &onDisconnect(OnDisconnect cb) { return set(_onDisconnect, std::move(cb)); }
+    AsyncMqttClient &onSubscribe(OnSubscribe cb) { return set(_onSubscribe, std::move(cb)); }
+    AsyncMqttClient &onUnsubscribe(OnPacket cb) { return set(_onUnsubscribe, std::move(cb)); }
+    AsyncMqttClient &onMessage(OnMessage cb) { return set(_onMessage, std::move(cb)); }
+    AsyncMqttClient &onPublish(OnPacket cb) { return set(_onPublish, std::move(cb)); }
+
+    AsyncMqttClient &setServer(const IPAddress &host, uint16_t port)
+    {
+        (void)host;
+        (void)port;
+        return *this;
+    }
+    AsyncMqttClient &setCleanSession(bool clean)
+    {
+        (void)clean;
+        return *this;
+    }
+
+    bool connected() const { return false; }
+    void connect() {}
+    void disconnect(bool force = false) { (void)force; }
+
+    uint16_t publish(const char *topic, uint8_t qos, bool retain, const char *payload = nullptr,
+                     size_t length = 0)
+    {
+        (void)topic;
+        (void)qos;
+        (void)retain;
+        (void)payload;
+        (void)length;
+        return 0;
+    }
+    uint16_t subscribe(const char *topic, uint8_t qos)
+    {
+        (void)topic;
+        (void)qos;
+        return 0;
+    }
+    uint16_t unsubscribe(const char *topic)
+    {
+        (void)topic;
+        return 0;
+    }
+
+private:
+    template <typename Cb>
+    AsyncMqttClient &set(Cb &slot, Cb cb)
+    {
+        slot = std::move(cb);
+        return *this;
+    }
+
+    OnConnect _onConnect;
+    OnDisconnect _onDisconnect;
+    OnSubscribe _onSubscribe;
+    OnPacket _onUnsubscribe;
+    OnMessage _onMessage;
+    OnPacket _onPublish;
+};
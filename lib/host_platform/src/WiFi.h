@@ -0,0 +1,68 @@
+#pragma once
+
+/**
+ * @file WiFi.h
+ * @brief Host Wi-Fi station without a radio: an access point that is in range or not.
+ *
+ * begin() associates at once while the access point is in range (SYSTEM_EVENT_STA_CONNECTED,
+ * then SYSTEM_EVENT_STA_GOT_IP with 127.0.0.1) and fails with SYSTEM_EVENT_STA_DISCONNECTED
+ * while it isn't, like a failed attempt on the device. Handlers run on an event task, like the
+ * core's. setAccessPoint() is host only: it takes the access point away (a connected station
+ * drops with SYSTEM_EVENT_STA_DISCONNECTED) or brings it back, so tests can drive Wi-Fi recovery.
+ */
+
+#include "Arduino.h"
+
+typedef enum
+{
+    SYSTEM_EVENT_WIFI_READY = 0,
+    SYSTEM_EVENT_SCAN_DONE,
+    SYSTEM_EVENT_STA_START,
+    SYSTEM_EVENT_STA_STOP,
+    SYSTEM_EVENT_STA_CONNECTED,
+    SYSTEM_EVENT_STA_DISCONNECTED,
+    SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+    SYSTEM_EVENT_STA_GOT_IP,
+    SYSTEM_EVENT_STA_LOST_IP,
+    SYSTEM_EVENT_MAX,
+} system_event_id_t;
+
+typedef system_event_id_t WiFiEvent_t;
+typedef void (*WiFiEventCb)(WiFiEvent_t event);
+typedef size_t wifi_event_id_t;
+
+typedef enum
+{
+    WIFI_OFF = 0,
+    WIFI_STA,
+    WIFI_AP,
+    WIFI_AP_STA,
+} wifi_mode_t;
+
+typedef enum
+{
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+class WiFiClass
+{
+public:
+    /// @p cb for @p event, or for every event with SYSTEM_EVENT_MAX.
+    wifi_event_id_t onEvent(WiFiEventCb cb, WiFiEvent_t event = SYSTEM_EVENT_MAX);
+    bool mode(wifi_mode_t mode);
+    wl_status_t begin(const char *ssid, const char *passphrase = nullptr);
+    bool disconnect(bool wifiOff = false);
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    IPAddress localIP();
+
+    /// Host only: the access point comes into range (begin() succeeds) or goes away.
+    void setAccessPoint(bool inRange);
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ * @file WiFiUdp.h
+ * @brief Host WiFiUDP over a POSIX datagram socket: packets really go to the address given,
+ * so a test can receive them on 127.0.0.1.
+ */
+
+#include "Arduino.h"
+
+#include <vector>
+
+class WiFiUDP
+{
+public:
+    ~WiFiUDP() { stop(); }
+
+    /// Bind @p port (0 = any). @return 1 on success.
+    uint8_t begin(uint16_t port);
+    void stop();
+
+    int beginPacket(const IPAddress &ip, uint16_t port);
+    size_t write(const uint8_t *buf, size_t size);
+    size_t write(uint8_t b) { return write(&b, 1); }
+    /// Send what was written since beginPacket(). @return 1 if the datagram was sent.
+    int endPacket();
+
+private:
+    int _fd{-1};
+    IPAddress _ip{};
+    uint16_t _port{0};
+    std::vector<uint8_t> _tx;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+/**
+ * @file Wire.h
+ * @brief Host I2C bus with nothing attached: every address NACKs. Lets I2cBus start and run
+ * its task on the host; sensors are replayed instead (see imu_replay.hpp).
+ */
+
+#include "Arduino.h"
+
+class TwoWire
+{
+public:
+    bool begin() { return true; }
+    bool setClock(uint32_t hz)
+    {
+        (void)hz;
+        return true;
+    }
+    void setTimeOut(uint16_t ms) { (void)ms; }
+
+    void beginTransmission(uint8_t addr) { (void)addr; }
+    size_t write(const uint8_t *data, size_t len)
+    {
+        (void)data;
+        return len;
+    }
+    size_t write(uint8_t b) { return write(&b, 1); }
+    /// @return 2, address NACK.
+    uint8_t endTransmission(bool sendStop = true)
+    {
+        (void)sendStop;
+        return 2;
+    }
+    /// @return 0 bytes, address NACK.
+    size_t requestFrom(uint16_t addr, size_t len, bool sendStop = true)
+    {
+        (void)addr;
+        (void)len;
+        (void)sendStop;
+        return 0;
+    }
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t readBytes(uint8_t *buf, size_t len)
+    {
+        (void)buf;
+        (void)len;
+        return 0;
+    }
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,19 @@
+#pragma once
+
+/**
+ * @file esp_system.h
+ * @brief Host esp_random(): a fixed-seed generator, so backoff jitter repeats run to run.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    uint32_t esp_random(void);
+
+#ifdef __cplusplus
+}
+#endif
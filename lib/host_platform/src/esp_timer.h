@@ -0,0 +1,56 @@
+#pragma once
+
+/**
+ * @file esp_timer.h
+ * @brief Host esp_timer: microseconds on the host's monotonic clock, and one-shot/periodic
+ * timers whose callbacks run on one dispatch task (ESP_TIMER_TASK).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef int esp_err_t;
+
+#ifndef ESP_OK
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#endif
+
+    typedef struct HostEspTimer *esp_timer_handle_t;
+    typedef void (*esp_timer_cb_t)(void *arg);
+
+    typedef enum
+    {
+        ESP_TIMER_TASK,
+    } esp_timer_dispatch_t;
+
+    typedef struct
+    {
+        esp_timer_cb_t callback;
+        void *arg;
+        esp_timer_dispatch_t dispatch_method;
+        const char *name;
+        bool skip_unhandled_events;
+    } esp_timer_create_args_t;
+
+    int64_t esp_timer_get_time(void);
+
+    esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+    /// ESP_ERR_INVALID_STATE if the timer is already running.
+    esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs);
+    esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs);
+    /// ESP_ERR_INVALID_STATE if the timer isn't running.
+    esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+    esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+/**
+ * @file FreeRTOS.h
+ * @brief Host (native build) stand-in for the ESP-IDF FreeRTOS port: types, tick rate and
+ * portMUX critical sections. Tasks are std::threads, see task.h.
+ *
+ * Critical sections are recursive spinlocks like the ESP32's, minus the interrupt masking:
+ * keep them as short as on the device. Priorities and core affinity are accepted and ignored.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef int BaseType_t;
+    typedef unsigned int UBaseType_t;
+    typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define configTICK_RATE_HZ 1000 // the Arduino core's rate: 1 tick = 1 ms
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define pdTICKS_TO_MS(ticks) ((TickType_t)(((TickType_t)(ticks) * (TickType_t)1000U) / (TickType_t)configTICK_RATE_HZ))
+#define tskNO_AFFINITY (0x7FFFFFFF) // plain, for #if like ESP-IDF's
+
+    /// Recursive spinlock: owner is a host thread tag (0 = free), count the nesting depth.
+    typedef struct
+    {
+        uint32_t owner;
+        uint32_t count;
+    } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+    void vPortEnterCritical(portMUX_TYPE *mux);
+    void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(...) \
+    do                          \
+    {                           \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+/**
+ * @file queue.h
+ * @brief Host queues: fixed-size items copied in and out, bounded like FreeRTOS's.
+ */
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct HostQueue *QueueHandle_t;
+
+    QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+    void vQueueDelete(QueueHandle_t q);
+    BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks);
+    BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken);
+    BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks);
+    BaseType_t xQueueReset(QueueHandle_t q);
+    UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+
+#define xQueueSendToBack(q, item, ticks) xQueueSend((q), (item), (ticks))
+
+#ifdef __cplusplus
+}
+#endif
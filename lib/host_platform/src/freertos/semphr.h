@@ -0,0 +1,34 @@
+#pragma once
+
+/**
+ * @file semphr.h
+ * @brief Host binary semaphores and (non-recursive) mutexes. The state lives in the
+ * handle's storage, so static semaphores on a caller's stack need no cleanup.
+ */
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct
+    {
+        UBaseType_t count;
+        UBaseType_t max;
+    } StaticSemaphore_t;
+
+    typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+    SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+    SemaphoreHandle_t xSemaphoreCreateBinary(void);
+    SemaphoreHandle_t xSemaphoreCreateMutex(void);
+    void vSemaphoreDelete(SemaphoreHandle_t sem);
+    BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+    BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+    BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+/**
+ * @file task.h
+ * @brief Host tasks: each task is a detached std::thread with a FreeRTOS-style notification
+ * value. Threads that were not created here (the test's main thread) get a handle on first use,
+ * so they can wait for notifications too.
+ *
+ * vTaskEndScheduler() parks every task at its next blocking call (delay, notification, queue,
+ * semaphore) and returns once all of them are parked: call it at the end of a test program,
+ * before static singletons are destroyed under running tasks.
+ */
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct HostTask *TaskHandle_t;
+    typedef void (*TaskFunction_t)(void *);
+
+    typedef enum
+    {
+        eNoAction = 0,
+        eSetBits,
+        eIncrement,
+        eSetValueWithOverwrite,
+        eSetValueWithoutOverwrite,
+    } eNotifyAction;
+
+    BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *arg,
+                                       UBaseType_t prio, TaskHandle_t *created, BaseType_t core);
+    BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *arg,
+                           UBaseType_t prio, TaskHandle_t *created);
+    TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+    void vTaskDelay(TickType_t ticks);
+    TickType_t xTaskGetTickCount(void);
+
+    uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+    BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t ticks);
+    BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+    BaseType_t xTaskNotifyGive(TaskHandle_t task);
+    void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+    /// Park every task (see the file comment). Waits at most a second for busy ones.
+    void vTaskEndScheduler(void);
+
+#ifdef __cplusplus
+}
+#endif
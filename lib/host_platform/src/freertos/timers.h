@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+ * @file timers.h
+ * @brief Host software timers: callbacks run one after another on a timer service task,
+ * like FreeRTOS's. Command timeouts are ignored (commands never block).
+ */
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    typedef struct HostTimer *TimerHandle_t;
+    typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+    TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                               TimerCallbackFunction_t cb);
+    BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks);
+    BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks);
+    BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks);
+    BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks);
+    /// Also starts a stopped timer, like FreeRTOS's.
+    BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks);
+    BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+    void *pvTimerGetTimerID(TimerHandle_t timer);
+
+#ifdef __cplusplus
+}
+#endif
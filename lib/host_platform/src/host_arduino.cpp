@@ -0,0 +1,205 @@
+// host_arduino.cpp: Wi-Fi station, UDP and Wire stand-ins for the native build
+#include "WiFi.h"
+#include "WiFiUdp.h"
+#include "Wire.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <mutex>
+
+WiFiClass WiFi;
+TwoWire Wire;
+
+namespace
+{
+    struct Station
+    {
+        std::mutex mx;
+        struct Handler
+        {
+            WiFiEventCb cb;
+            WiFiEvent_t event;
+        };
+        std::vector<Handler> handlers;
+        QueueHandle_t events{nullptr};
+        bool inRange{true};
+        bool connected{false};
+    };
+
+    Station &station()
+    {
+        static Station *s = new Station; // the event task outlives static destruction
+        return *s;
+    }
+
+    void eventTask(void *)
+    {
+        Station &st = station();
+        WiFiEvent_t event;
+        for (;;)
+        {
+            if (xQueueReceive(st.events, &event, portMAX_DELAY) != pdTRUE)
+                continue;
+            std::vector<Station::Handler> handlers;
+            {
+                std::lock_guard<std::mutex> g(st.mx);
+                handlers = st.handlers;
+            }
+            for (const auto &h : handlers)
+            {
+                if (h.event == SYSTEM_EVENT_MAX || h.event == event)
+                    h.cb(event);
+            }
+        }
+    }
+
+    void post(WiFiEvent_t event)
+    {
+        Station &st = station();
+        {
+            std::lock_guard<std::mutex> g(st.mx);
+            if (!st.events)
+            {
+                st.events = xQueueCreate(16, sizeof(WiFiEvent_t));
+                xTaskCreate(&eventTask, "arduino_events", 4096, nullptr, 19, nullptr);
+            }
+        }
+        xQueueSend(st.events, &event, portMAX_DELAY);
+    }
+}
+
+// ===== WiFiClass =============================================================
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb cb, WiFiEvent_t event)
+{
+    Station &st = station();
+    std::lock_guard<std::mutex> g(st.mx);
+    st.handlers.push_back(Station::Handler{cb, event});
+    return st.handlers.size();
+}
+
+bool WiFiClass::mode(wifi_mode_t mode)
+{
+    (void)mode;
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase)
+{
+    (void)ssid;
+    (void)passphrase;
+    Station &st = station();
+    bool up;
+    {
+        std::lock_guard<std::mutex> g(st.mx);
+        if (st.connected)
+            return WL_CONNECTED;
+        up = st.inRange;
+        st.connected = up;
+    }
+    if (!up)
+    {
+        post(SYSTEM_EVENT_STA_DISCONNECTED); // the attempt failed
+        return WL_DISCONNECTED;
+    }
+    post(SYSTEM_EVENT_STA_CONNECTED);
+    post(SYSTEM_EVENT_STA_GOT_IP);
+    return WL_DISCONNECTED; // like the device: connecting, see the events
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+    (void)wifiOff;
+    Station &st = station();
+    bool was;
+    {
+        std::lock_guard<std::mutex> g(st.mx);
+        was = st.connected;
+        st.connected = false;
+    }
+    if (was)
+        post(SYSTEM_EVENT_STA_DISCONNECTED);
+    return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+    Station &st = station();
+    std::lock_guard<std::mutex> g(st.mx);
+    return st.connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP()
+{
+    return isConnected() ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+void WiFiClass::setAccessPoint(bool inRange)
+{
+    Station &st = station();
+    {
+        std::lock_guard<std::mutex> g(st.mx);
+        st.inRange = inRange;
+    }
+    if (!inRange)
+        disconnect();
+}
+
+// ===== WiFiUDP ===============================================================
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    stop();
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0)
+        return 0;
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(port);
+    if (bind(_fd, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0)
+    {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop()
+{
+    if (_fd >= 0)
+        close(_fd);
+    _fd = -1;
+}
+
+int WiFiUDP::beginPacket(const IPAddress &ip, uint16_t port)
+{
+    if (_fd < 0 || port == 0)
+        return 0;
+    _ip = ip;
+    _port = port;
+    _tx.clear();
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buf, size_t size)
+{
+    if (_port == 0)
+        return 0;
+    _tx.insert(_tx.end(), buf, buf + size);
+    return size;
+}
+
+int WiFiUDP::endPacket()
+{
+    if (_fd < 0 || _port == 0)
+        return 0;
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(_port);
+    const uint8_t b[4] = {_ip[0], _ip[1], _ip[2], _ip[3]};
+    memcpy(&to.sin_addr.s_addr, b, sizeof(b));
+    const ssize_t n = sendto(_fd, _tx.data(), _tx.size(), 0, reinterpret_cast<sockaddr *>(&to), sizeof(to));
+    _port = 0;
+    return n == (ssize_t)_tx.size() ? 1 : 0;
+}
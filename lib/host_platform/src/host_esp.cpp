@@ -0,0 +1,79 @@
+// host_esp.cpp: esp_timer and esp_random() stand-ins for the native build
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "host_scheduler.hpp"
+
+#include <random>
+
+struct HostEspTimer
+{
+    host::TimerService::Id entry;
+};
+
+namespace
+{
+    host::TimerService &dispatcher()
+    {
+        static host::TimerService *svc = new host::TimerService("esp_timer");
+        return *svc;
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (!args || !args->callback || !out)
+        return ESP_ERR_INVALID_ARG;
+    const esp_timer_cb_t cb = args->callback;
+    void *arg = args->arg;
+    HostEspTimer *t = new HostEspTimer{};
+    t->entry = dispatcher().add([cb, arg]()
+                                { cb(arg); });
+    *out = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs)
+{
+    if (dispatcher().active(timer->entry))
+        return ESP_ERR_INVALID_STATE;
+    dispatcher().start(timer->entry, std::chrono::microseconds(timeoutUs), std::chrono::microseconds(0));
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs)
+{
+    if (periodUs == 0)
+        return ESP_ERR_INVALID_ARG;
+    if (dispatcher().active(timer->entry))
+        return ESP_ERR_INVALID_STATE;
+    dispatcher().start(timer->entry, std::chrono::microseconds(periodUs), std::chrono::microseconds(periodUs));
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    return dispatcher().stop(timer->entry) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (dispatcher().active(timer->entry))
+        return ESP_ERR_INVALID_STATE;
+    dispatcher().remove(timer->entry);
+    delete timer;
+    return ESP_OK;
+}
+
+uint32_t esp_random(void)
+{
+    static std::mutex mx;
+    static std::mt19937 gen(0xE5D32u);
+    std::lock_guard<std::mutex> g(mx);
+    return (uint32_t)gen();
+}
@@ -0,0 +1,567 @@
+// host_freertos.cpp: FreeRTOS stand-in for the native build (see freertos/FreeRTOS.h)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "host_scheduler.hpp"
+
+#include <string.h>
+#include <atomic>
+#include <deque>
+#include <thread>
+
+struct HostTask
+{
+    std::mutex mx;
+    std::condition_variable cv;
+    uint32_t value{0};
+    bool pending{false}; // notified since the last xTaskNotifyWait()
+    std::string name;
+};
+
+struct HostQueue
+{
+    std::mutex mx;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t itemSize;
+};
+
+struct HostTimer
+{
+    TickType_t period;
+    bool autoReload;
+    void *id;
+    TimerCallbackFunction_t cb;
+    host::TimerService::Id entry;
+};
+
+namespace
+{
+    struct Scheduler
+    {
+        std::mutex mx;
+        std::condition_variable cv;
+        int running{0}; // task threads outside a blocking call
+        bool ended{false};
+    };
+
+    // Never destroyed: parked tasks wait on it while the program exits
+    Scheduler &sched()
+    {
+        static Scheduler *s = new Scheduler;
+        return *s;
+    }
+
+    thread_local HostTask *tSelf = nullptr;
+    thread_local bool tCounted = false; // a task thread, not e.g. the test's main thread
+
+    uint32_t threadTag()
+    {
+        static std::atomic<uint32_t> next{1};
+        thread_local uint32_t tag = next++;
+        return tag;
+    }
+
+    HostTask *self()
+    {
+        if (!tSelf)
+            tSelf = new HostTask{}; // foreign thread: a handle so it can take notifications
+        return tSelf;
+    }
+
+    void notified(HostTask *t)
+    {
+        t->pending = true;
+        t->cv.notify_all();
+    }
+
+    // Semaphore state lives in the handles; one lock and condition for all of them
+    std::mutex g_semMx;
+    std::condition_variable g_semCv;
+
+    host::TimerService &timerService()
+    {
+        static host::TimerService *svc = new host::TimerService("Tmr Svc");
+        return *svc;
+    }
+
+    std::chrono::microseconds ticksUs(TickType_t ticks)
+    {
+        return std::chrono::microseconds((uint64_t)ticks * 1000000ull / configTICK_RATE_HZ);
+    }
+}
+
+namespace host
+{
+    Clock::time_point deadline(TickType_t ticks)
+    {
+        if (ticks == portMAX_DELAY)
+            return Clock::time_point::max();
+        return Clock::now() + ticksUs(ticks);
+    }
+
+    bool block(std::condition_variable &cv, std::unique_lock<std::mutex> &lk, Clock::time_point until,
+               const std::function<bool()> &pred)
+    {
+        while (!pred())
+        {
+            if (until != Clock::time_point::max() && Clock::now() >= until)
+                return false;
+
+            if (tCounted)
+            {
+                std::lock_guard<std::mutex> g(sched().mx);
+                sched().running--;
+                sched().cv.notify_all();
+            }
+            if (until == Clock::time_point::max())
+                cv.wait(lk, pred);
+            else
+                cv.wait_until(lk, until, pred);
+            if (!tCounted)
+                continue;
+
+            lk.unlock();
+            {
+                std::unique_lock<std::mutex> s(sched().mx);
+                while (sched().ended)
+                    sched().cv.wait(s); // parked for good
+                sched().running++;
+            }
+            lk.lock();
+        }
+        return true;
+    }
+
+    HostTask *spawn(const char *name, std::function<void()> fn)
+    {
+        {
+            std::lock_guard<std::mutex> g(sched().mx);
+            if (sched().ended)
+                return nullptr;
+            sched().running++;
+        }
+        HostTask *task = new HostTask{};
+        task->name = name ? name : "";
+        std::thread(
+            [task, fn]()
+            {
+                tSelf = task;
+                tCounted = true;
+                fn();
+                // FreeRTOS tasks never return; if one does, it simply stops counting
+                std::lock_guard<std::mutex> g(sched().mx);
+                sched().running--;
+                sched().cv.notify_all();
+            })
+            .detach();
+        return task;
+    }
+
+    TimerService::Id TimerService::add(std::function<void()> fire)
+    {
+        std::lock_guard<std::mutex> g(_mx);
+        if (!_started)
+        {
+            _started = true;
+            spawn(_taskName, [this]()
+                  { run(); });
+        }
+        Id id = 0;
+        while (id < _entries.size() && _entries[id].used)
+            ++id;
+        if (id == _entries.size())
+            _entries.emplace_back();
+        _entries[id] = Entry{};
+        _entries[id].fire = std::move(fire);
+        _entries[id].used = true;
+        return id;
+    }
+
+    void TimerService::remove(Id id)
+    {
+        std::lock_guard<std::mutex> g(_mx);
+        _entries[id] = Entry{};
+        _changes++;
+        _cv.notify_all();
+    }
+
+    void TimerService::start(Id id, std::chrono::microseconds delay, std::chrono::microseconds period)
+    {
+        std::lock_guard<std::mutex> g(_mx);
+        Entry &e = _entries[id];
+        e.due = Clock::now() + delay;
+        e.period = period;
+        e.active = true;
+        _changes++;
+        _cv.notify_all();
+    }
+
+    bool TimerService::stop(Id id)
+    {
+        std::lock_guard<std::mutex> g(_mx);
+        const bool was = _entries[id].active;
+        _entries[id].active = false;
+        _changes++;
+        _cv.notify_all();
+        return was;
+    }
+
+    bool TimerService::active(Id id)
+    {
+        std::lock_guard<std::mutex> g(_mx);
+        return _entries[id].active;
+    }
+
+    void TimerService::run()
+    {
+        std::unique_lock<std::mutex> lk(_mx);
+        for (;;)
+        {
+            Entry *next = nullptr;
+            for (Entry &e : _entries)
+            {
+                if (e.active && (!next || e.due < next->due))
+                    next = &e;
+            }
+
+            const uint64_t seen = _changes;
+            if (!next || Clock::now() < next->due)
+            {
+                // Until it's due, or a timer is started / stopped meanwhile
+                block(_cv, lk, next ? next->due : Clock::time_point::max(), [this, seen]()
+                      { return _changes != seen; });
+                continue;
+            }
+
+            if (next->period.count() > 0)
+                next->due += next->period;
+            else
+                next->active = false;
+            std::function<void()> fire = next->fire;
+            lk.unlock();
+            fire();
+            lk.lock();
+        }
+    }
+} // namespace host
+
+// ===== Critical sections =====================================================
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    const uint32_t me = threadTag();
+    if (__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == me)
+    {
+        mux->count++;
+        return;
+    }
+    for (;;)
+    {
+        uint32_t expected = 0;
+        if (__atomic_compare_exchange_n(&mux->owner, &expected, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+        std::this_thread::yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    if (--mux->count == 0)
+        __atomic_store_n(&mux->owner, 0u, __ATOMIC_RELEASE);
+}
+
+// ===== Tasks =================================================================
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *created, BaseType_t core)
+{
+    (void)stackDepth;
+    (void)prio;
+    (void)core;
+    HostTask *task = host::spawn(name, [fn, arg]()
+                                 { fn(arg); });
+    if (!task)
+        return pdFAIL;
+    if (created)
+        *created = task;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *arg,
+                       UBaseType_t prio, TaskHandle_t *created)
+{
+    return xTaskCreatePinnedToCore(fn, name, stackDepth, arg, prio, created, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return self();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    HostTask *t = self();
+    std::unique_lock<std::mutex> lk(t->mx);
+    host::block(t->cv, lk, host::deadline(ticks ? ticks : 1), []()
+                { return false; });
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    using namespace std::chrono;
+    static const host::Clock::time_point start = host::Clock::now();
+    return (TickType_t)(duration_cast<milliseconds>(host::Clock::now() - start).count() * configTICK_RATE_HZ / 1000);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+    HostTask *t = self();
+    std::unique_lock<std::mutex> lk(t->mx);
+    host::block(t->cv, lk, host::deadline(ticks), [t]()
+                { return t->value != 0; });
+    const uint32_t v = t->value;
+    if (v)
+        t->value = clearOnExit ? 0 : v - 1;
+    t->pending = false;
+    return v;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value, TickType_t ticks)
+{
+    HostTask *t = self();
+    std::unique_lock<std::mutex> lk(t->mx);
+    if (!t->pending)
+        t->value &= ~clearOnEntry;
+    const bool got = host::block(t->cv, lk, host::deadline(ticks), [t]()
+                                 { return t->pending; });
+    if (value)
+        *value = t->value;
+    if (!got)
+        return pdFALSE;
+    t->value &= ~clearOnExit;
+    t->pending = false;
+    return pdTRUE;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    if (!task)
+        return pdFAIL;
+    std::lock_guard<std::mutex> g(task->mx);
+    switch (action)
+    {
+    case eSetBits:
+        task->value |= value;
+        break;
+    case eIncrement:
+        task->value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->pending)
+            return pdFAIL;
+        task->value = value;
+        break;
+    default:
+        break;
+    }
+    notified(task);
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (woken)
+        *woken = pdFALSE;
+}
+
+void vTaskEndScheduler(void)
+{
+    std::unique_lock<std::mutex> lk(sched().mx);
+    sched().ended = true;
+    sched().cv.wait_for(lk, std::chrono::seconds(1), []()
+                        { return sched().running <= 0; });
+}
+
+// ===== Queues ================================================================
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    if (length == 0)
+        return nullptr;
+    HostQueue *q = new HostQueue{};
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    delete q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lk(q->mx);
+    if (!host::block(q->cv, lk, host::deadline(ticks), [q]()
+                     { return q->items.size() < q->length; }))
+        return pdFALSE;
+    const uint8_t *p = static_cast<const uint8_t *>(item);
+    q->items.emplace_back(p, p + q->itemSize);
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lk(q->mx);
+    if (!host::block(q->cv, lk, host::deadline(ticks), [q]()
+                     { return !q->items.empty(); }))
+        return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> g(q->mx);
+    q->items.clear();
+    q->cv.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> g(q->mx);
+    return (UBaseType_t)q->items.size();
+}
+
+// ===== Semaphores ============================================================
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+    buffer->count = 0;
+    buffer->max = 1;
+    return buffer;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xSemaphoreCreateBinaryStatic(new StaticSemaphore_t);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t m = xSemaphoreCreateBinary();
+    m->count = 1; // available
+    return m;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    delete sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lk(g_semMx);
+    if (!host::block(g_semCv, lk, host::deadline(ticks), [sem]()
+                     { return sem->count > 0; }))
+        return pdFALSE;
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    std::lock_guard<std::mutex> g(g_semMx);
+    if (sem->count >= sem->max)
+        return pdFALSE;
+    sem->count++;
+    g_semCv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+// ===== Software timers =======================================================
+TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t autoReload, void *id,
+                           TimerCallbackFunction_t cb)
+{
+    (void)name;
+    if (period == 0 || !cb)
+        return nullptr;
+    HostTimer *t = new HostTimer{period, autoReload != pdFALSE, id, cb, 0};
+    t->entry = timerService().add([t]()
+                                  { t->cb(t); });
+    return t;
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks)
+{
+    (void)ticks;
+    timerService().remove(timer->entry);
+    delete timer;
+    return pdPASS;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks)
+{
+    (void)ticks;
+    const std::chrono::microseconds period = ticksUs(timer->period);
+    timerService().start(timer->entry, period, timer->autoReload ? period : std::chrono::microseconds(0));
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks)
+{
+    return xTimerStart(timer, ticks);
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks)
+{
+    (void)ticks;
+    timerService().stop(timer->entry);
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks)
+{
+    if (period == 0)
+        return pdFAIL;
+    timer->period = period;
+    return xTimerStart(timer, ticks);
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer)
+{
+    return timerService().active(timer->entry) ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer)
+{
+    return timer->id;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+/**
+ * @file host_scheduler.hpp
+ * @brief Internals shared by the host FreeRTOS and esp_timer stand-ins: blocking waits that
+ * vTaskEndScheduler() can park, and the timer service task both timer APIs run on.
+ * Not an API for firmware code.
+ */
+
+#include "freertos/FreeRTOS.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct HostTask;
+
+namespace host
+{
+    using Clock = std::chrono::steady_clock;
+
+    /// Deadline for a FreeRTOS timeout; portMAX_DELAY is time_point::max().
+    Clock::time_point deadline(TickType_t ticks);
+
+    /// @brief Wait on @p cv (with @p lk held) until @p pred or @p until. A task counts as
+    /// blocked meanwhile; after vTaskEndScheduler() it parks for good instead of returning.
+    /// @return pred() on return.
+    bool block(std::condition_variable &cv, std::unique_lock<std::mutex> &lk, Clock::time_point until,
+               const std::function<bool()> &pred);
+
+    /// Start a task thread running @p fn. @return Its handle, nullptr after vTaskEndScheduler().
+    HostTask *spawn(const char *name, std::function<void()> fn);
+
+    /**
+     * @brief Timers whose callbacks run one after another on one task (FreeRTOS's timer
+     * service, esp_timer's dispatch task). The task starts with the first timer.
+     */
+    class TimerService
+    {
+    public:
+        using Id = size_t;
+
+        explicit TimerService(const char *taskName) : _taskName(taskName) {}
+
+        Id add(std::function<void()> fire);
+        void remove(Id id);
+        /// (Re)arm: first expiry after @p delay, then every @p period (zero = one-shot).
+        void start(Id id, std::chrono::microseconds delay, std::chrono::microseconds period);
+        /// @return false if it wasn't running.
+        bool stop(Id id);
+        bool active(Id id);
+
+    private:
+        struct Entry
+        {
+            std::function<void()> fire;
+            Clock::time_point due{};
+            std::chrono::microseconds period{0};
+            bool active{false};
+            bool used{false};
+        };
+
+        void run();
+
+        const char *_taskName;
+        std::mutex _mx;
+        std::condition_variable _cv;
+        std::vector<Entry> _entries;
+        uint64_t _changes{0};
+        bool _started{false};
+    };
+} // namespace host
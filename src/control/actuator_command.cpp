@@ -0,0 +1,140 @@
+#include "actuator_command.hpp"
+
+namespace
+{
+    inline uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+    inline uint32_t rd32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    inline void wr16(uint8_t *p, uint16_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+    inline void wr32(uint8_t *p, uint32_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+        p[3] = (uint8_t)(v >> 24);
+    }
+
+    constexpr float kQ15 = 1.0f / 32767.0f;
+    constexpr uint32_t kOffsetLeakShift = 6; // follow sender clock drift at 1/64 of the residual per frame
+} // namespace
+
+ActuatorCommandStatus ActuatorCommandDecoder::reject(ActuatorCommandStatus s)
+{
+    switch (s)
+    {
+    case ActuatorCommandStatus::BadLength:
+        _stats.bad_length++;
+        break;
+    case ActuatorCommandStatus::BadVersion:
+        _stats.bad_version++;
+        break;
+    case ActuatorCommandStatus::BadChannels:
+        _stats.bad_channels++;
+        break;
+    case ActuatorCommandStatus::OutOfOrder:
+        _stats.out_of_order++;
+        break;
+    case ActuatorCommandStatus::Stale:
+        _stats.stale++;
+        break;
+    default:
+        break;
+    }
+    return s;
+}
+
+ActuatorCommandStatus ActuatorCommandDecoder::decode(
+    const uint8_t *data, size_t len, uint32_t nowMs, ActuatorCommand &out)
+{
+    if (!data || len < ACTUATOR_CMD_HEADER_LEN)
+        return reject(ActuatorCommandStatus::BadLength);
+    if (data[0] != ACTUATOR_CMD_VERSION)
+        return reject(ActuatorCommandStatus::BadVersion);
+
+    const uint8_t n = data[1];
+    if (n == 0 || n > ACTUATOR_CMD_MAX_CHANNELS)
+        return reject(ActuatorCommandStatus::BadChannels);
+    if (len != frameLength(n))
+        return reject(ActuatorCommandStatus::BadLength);
+
+    const uint16_t flags = rd16(data + 2);
+    const uint32_t seq = rd32(data + 4);
+    const uint32_t senderMs = rd32(data + 8);
+    const uint32_t transit = nowMs - senderMs; // wraps consistently with the stored offset
+
+    // Serial number arithmetic: tolerate wraparound of seq. Resync frames too: only a frame
+    // newer than everything accepted may re-anchor the clock offset.
+    if (_synced && (int32_t)(seq - _lastSeq) <= 0)
+        return reject(ActuatorCommandStatus::OutOfOrder);
+
+    if (!_synced || (flags & ACTUATOR_CMD_FLAG_RESYNC))
+    {
+        _offsetMs = transit;
+    }
+    else
+    {
+        const int32_t age = (int32_t)(transit - _offsetMs);
+        if (age < 0)
+        {
+            _offsetMs = transit; // faster than anything seen so far: new lower envelope
+        }
+        else if ((uint32_t)age > _maxAgeMs)
+        {
+            return reject(ActuatorCommandStatus::Stale);
+        }
+        else
+        {
+            _offsetMs += (uint32_t)age >> kOffsetLeakShift;
+        }
+    }
+
+    _synced = true;
+    _lastSeq = seq;
+    _stats.accepted++;
+
+    out.seq = seq;
+    out.sender_ms = senderMs;
+    out.flags = flags;
+    out.channel_count = n;
+    const uint8_t *sp = data + ACTUATOR_CMD_HEADER_LEN;
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        int16_t raw = (int16_t)rd16(sp + 2 * i);
+        if (raw < -32767)
+            raw = -32767; // keep the range symmetric
+        out.setpoint[i] = (float)raw * kQ15;
+    }
+    return ActuatorCommandStatus::Ok;
+}
+
+size_t ActuatorCommandDecoder::encode(uint8_t *dst, size_t cap, uint32_t seq, uint32_t senderMs,
+                                      const float *setpoints, uint8_t channelCount, uint16_t flags)
+{
+    if (!dst || !setpoints || channelCount == 0 || channelCount > ACTUATOR_CMD_MAX_CHANNELS)
+        return 0;
+    const size_t len = frameLength(channelCount);
+    if (cap < len)
+        return 0;
+
+    dst[0] = ACTUATOR_CMD_VERSION;
+    dst[1] = channelCount;
+    wr16(dst + 2, flags);
+    wr32(dst + 4, seq);
+    wr32(dst + 8, senderMs);
+    for (uint8_t i = 0; i < channelCount; ++i)
+    {
+        float v = setpoints[i];
+        if (v != v)
+            v = 0.0f; // NaN
+        v = v > 1.0f ? 1.0f : (v < -1.0f ? -1.0f : v);
+        const int32_t q = (int32_t)(v * 32767.0f + (v >= 0.0f ? 0.5f : -0.5f));
+        wr16(dst + ACTUATOR_CMD_HEADER_LEN + 2 * i, (uint16_t)(int16_t)q);
+    }
+    return len;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+/**
+ * @file actuator_command.hpp
+ * @brief Fixed-layout binary actuator command frame and its validating decoder.
+ *
+ * Wire format (little-endian, no padding):
+ * @code
+ *  offset size field
+ *  0      1    version        (ACTUATOR_CMD_VERSION)
+ *  1      1    channel_count  (1..ACTUATOR_CMD_MAX_CHANNELS)
+ *  2      2    flags          (ACTUATOR_CMD_FLAG_*)
+ *  4      4    seq            (incremented by the sender for every frame)
+ *  8      4    sender_ms      (sender clock, milliseconds, any epoch)
+ *  12     2*N  setpoint[N]    (int16 Q15: -32767..32767 -> -1.0..1.0)
+ * @endcode
+ *
+ * The decoder does a fixed amount of work per frame (no parsing, no branches on
+ * payload contents beyond the header checks) and rejects frames that are
+ * malformed, older than the last accepted one, or too old to be useful.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Tunables ===============================================================
+#ifndef ACTUATOR_CMD_MAX_CHANNELS
+#define ACTUATOR_CMD_MAX_CHANNELS 8
+#endif
+
+#ifndef ACTUATOR_CMD_MAX_AGE_MS
+#define ACTUATOR_CMD_MAX_AGE_MS 200 // frames older than this (after clock offset) are stale
+#endif
+
+#define ACTUATOR_CMD_VERSION 1
+#define ACTUATOR_CMD_HEADER_LEN 12
+
+/**
+ * Sender clock changed (restart, new epoch): re-seed the clock offset from this frame instead of
+ * checking its age. Still has to be newer than the last accepted frame, so a delayed or replayed
+ * resync can't re-anchor the decoder; a restarted sender carries its seq on (e.g. seeds it from
+ * wall-clock time), or the drone calls reset().
+ */
+#define ACTUATOR_CMD_FLAG_RESYNC 0x0001
+
+enum class ActuatorCommandStatus : uint8_t
+{
+    Ok,
+    BadLength,   ///< Shorter than the header or not header + 2*channel_count
+    BadVersion,  ///< Unknown frame version
+    BadChannels, ///< channel_count is 0 or above ACTUATOR_CMD_MAX_CHANNELS
+    OutOfOrder,  ///< seq not newer than the last accepted frame
+    Stale        ///< Older than the configured max age
+};
+
+struct ActuatorCommand
+{
+    uint32_t seq;
+    uint32_t sender_ms;
+    uint16_t flags;
+    uint8_t channel_count;
+    float setpoint[ACTUATOR_CMD_MAX_CHANNELS]; ///< Normalized to [-1, 1]
+};
+
+class ActuatorCommandDecoder
+{
+public:
+    struct Stats
+    {
+        uint32_t accepted;
+        uint32_t bad_length;
+        uint32_t bad_version;
+        uint32_t bad_channels;
+        uint32_t out_of_order;
+        uint32_t stale;
+    };
+
+    explicit ActuatorCommandDecoder(uint32_t maxAgeMs = ACTUATOR_CMD_MAX_AGE_MS)
+        : _maxAgeMs(maxAgeMs) {}
+
+    /**
+     * @brief Validate and decode one frame.
+     *
+     * @param data Raw payload
+     * @param len Payload length in bytes
+     * @param nowMs Local monotonic time in milliseconds
+     * @param out Filled only when the result is Ok
+     */
+    ActuatorCommandStatus decode(const uint8_t *data, size_t len, uint32_t nowMs, ActuatorCommand &out);
+
+    /// Forget the last accepted frame (next valid frame is accepted and re-seeds seq/clock offset).
+    void reset() { _synced = false; }
+
+    void setMaxAgeMs(uint32_t maxAgeMs) { _maxAgeMs = maxAgeMs; }
+    const Stats &stats() const { return _stats; }
+
+    /**
+     * @brief Encode a frame (ground tools, tests).
+     * @return Bytes written, or 0 if @p cap is too small / channel count invalid.
+     */
+    static size_t encode(uint8_t *dst, size_t cap, uint32_t seq, uint32_t senderMs,
+                         const float *setpoints, uint8_t channelCount, uint16_t flags = 0);
+
+    static constexpr size_t frameLength(uint8_t channelCount)
+    {
+        return ACTUATOR_CMD_HEADER_LEN + 2u * channelCount;
+    }
+
+private:
+    ActuatorCommandStatus reject(ActuatorCommandStatus s);
+
+    uint32_t _maxAgeMs;
+    bool _synced = false;
+    uint32_t _lastSeq = 0;
+    uint32_t _offsetMs = 0; // lower envelope of (local - sender), i.e. best-case transit
+    Stats _stats{};
+};
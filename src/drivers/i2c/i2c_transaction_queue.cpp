@@ -0,0 +1,157 @@
+#include "i2c_transaction_queue.hpp"
+
+#include <string.h>
+
+bool I2cTransaction::write(I2cTransaction &t, uint8_t addr, const uint8_t *data, size_t len)
+{
+    if (len > I2C_TX_INLINE_MAX)
+        return false;
+    t.addr = addr;
+    t.tx_len = (uint8_t)len;
+    if (len)
+        memcpy(t.tx, data, len);
+    t.rx = nullptr;
+    t.rx_len = 0;
+    t.job = nullptr;
+    return true;
+}
+
+bool I2cTransaction::readReg(I2cTransaction &t, uint8_t addr, uint8_t reg, uint8_t *rx, size_t len)
+{
+    if (!write(t, addr, &reg, 1))
+        return false;
+    t.rx = rx;
+    t.rx_len = len;
+    return true;
+}
+
+I2cTransaction I2cTransaction::exclusive(uint8_t addr, I2cJob job, void *ctx)
+{
+    I2cTransaction t;
+    t.addr = addr;
+    t.job = job;
+    t.ctx = ctx;
+    return t;
+}
+
+I2cStatus I2cTransactionQueue::submit(const I2cTransaction &t, uint32_t nowUs)
+{
+    if (_count >= I2C_BUS_QUEUE_LEN)
+    {
+        _stats.queue_full++;
+        return I2cStatus::QueueFull;
+    }
+    I2cTransaction &slot = _ring[(_head + _count) % I2C_BUS_QUEUE_LEN];
+    slot = t;
+    slot.queued_us = nowUs;
+    slot.status = I2cStatus::Ok;
+    _count++;
+    _stats.submitted++;
+    if (_count > _stats.queue_high_water)
+        _stats.queue_high_water = (uint32_t)_count;
+    return I2cStatus::Ok;
+}
+
+bool I2cTransactionQueue::pop(I2cTransaction &out)
+{
+    if (_count == 0)
+        return false;
+    out = _ring[_head];
+    _head = (_head + 1) % I2C_BUS_QUEUE_LEN;
+    _count--;
+    return true;
+}
+
+void I2cTransactionQueue::execute(I2cTransaction &t, II2cBackend &backend, uint32_t (*nowUs)())
+{
+    t.start_us = nowUs();
+    if (t.job)
+        t.status = t.job(t.ctx);
+    else
+        t.status = backend.transfer(t.addr, t.tx, t.tx_len, t.rx, t.rx_len);
+    t.end_us = nowUs();
+}
+
+void I2cTransactionQueue::record(const I2cTransaction &t)
+{
+    const uint32_t transfer = t.end_us - t.start_us;
+    const uint32_t latency = t.end_us - t.queued_us;
+    _stats.completed++;
+    _stats.busy_us += transfer;
+
+    DeviceStats *d = nullptr;
+    for (size_t i = 0; i < _deviceCount; ++i)
+    {
+        if (_devices[i].addr == t.addr)
+        {
+            d = &_devices[i];
+            break;
+        }
+    }
+    if (!d)
+    {
+        if (_deviceCount >= I2C_BUS_MAX_DEVICES)
+        {
+            _stats.untracked++;
+            return;
+        }
+        d = &_devices[_deviceCount++];
+        *d = DeviceStats{};
+        d->addr = t.addr;
+    }
+
+    d->transactions++;
+    d->latency_sum_us += latency;
+    d->busy_us += transfer;
+    if (latency > d->latency_max_us)
+        d->latency_max_us = latency;
+    if (transfer > d->transfer_max_us)
+        d->transfer_max_us = transfer;
+    switch (t.status)
+    {
+    case I2cStatus::Nack:
+        d->nacks++;
+        break;
+    case I2cStatus::Timeout:
+        d->timeouts++;
+        break;
+    case I2cStatus::Ok:
+        break;
+    default:
+        d->errors++;
+        break;
+    }
+}
+
+const I2cTransactionQueue::DeviceStats *I2cTransactionQueue::deviceStats(uint8_t addr) const
+{
+    for (size_t i = 0; i < _deviceCount; ++i)
+    {
+        if (_devices[i].addr == addr)
+            return &_devices[i];
+    }
+    return nullptr;
+}
+
+uint8_t I2cTransactionQueue::utilizationPct(uint32_t nowUs) const
+{
+    const uint32_t window = nowUs - _stats.since_us;
+    if (window == 0)
+        return 0;
+    const uint64_t pct = _stats.busy_us * 100 / window;
+    return pct > 100 ? 100 : (uint8_t)pct;
+}
+
+void I2cTransactionQueue::resetStats(uint32_t nowUs)
+{
+    const uint32_t highWater = (uint32_t)_count;
+    _stats = Stats{};
+    _stats.since_us = nowUs;
+    _stats.queue_high_water = highWater;
+    for (size_t i = 0; i < _deviceCount; ++i)
+    {
+        const uint8_t addr = _devices[i].addr;
+        _devices[i] = DeviceStats{};
+        _devices[i].addr = addr;
+    }
+}
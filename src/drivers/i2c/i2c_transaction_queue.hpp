@@ -0,0 +1,153 @@
+#pragma once
+
+/**
+ * @file i2c_transaction_queue.hpp
+ * @brief Transaction queue and bus statistics behind the asynchronous I2C bus manager.
+ *
+ * Providers describe what they need from the bus (write, write-then-read, or a job that
+ * hands the bus to a driver library for its duration) and submit it; the bus task pops
+ * transactions in submission order and runs them back to back against an II2cBackend.
+ * Completion is reported through a callback and/or a task notification (see
+ * services/i2c_bus.hpp). Records per-device latency (queue wait + transfer), NACK and
+ * timeout counts, and the time the bus was busy for utilization.
+ *
+ * Not thread-safe on its own: I2cBus serializes submit()/pop()/record() and calls
+ * execute() on its task only. Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Tunables ===============================================================
+#ifndef I2C_BUS_QUEUE_LEN
+#define I2C_BUS_QUEUE_LEN 16
+#endif
+
+#ifndef I2C_TX_INLINE_MAX
+#define I2C_TX_INLINE_MAX 16 // register address + data, copied at submit
+#endif
+
+#ifndef I2C_BUS_MAX_DEVICES
+#define I2C_BUS_MAX_DEVICES 8 // addresses with their own stats
+#endif
+
+enum class I2cStatus : uint8_t
+{
+    Ok = 0,
+    Nack,      ///< Address or data byte not acknowledged
+    Timeout,   ///< Bus stuck (clock stretching, arbitration) past the backend's timeout
+    BusError,  ///< Anything else the backend reports
+    QueueFull, ///< Not submitted
+};
+
+struct I2cTransaction;
+
+/// Runs on the bus task after the transaction completed; keep it short, the bus waits.
+using I2cCallback = void (*)(const I2cTransaction &t);
+
+/// Exclusive bus access for driver libraries that talk to Wire themselves.
+using I2cJob = I2cStatus (*)(void *ctx);
+
+struct I2cTransaction
+{
+    uint8_t addr{0};
+    uint8_t tx_len{0};
+    uint8_t tx[I2C_TX_INLINE_MAX]{}; ///< Written first (register address, data)
+    uint8_t *rx{nullptr};            ///< Read after a repeated start; caller-owned until completion
+    size_t rx_len{0};
+    I2cJob job{nullptr}; ///< If set, run job(ctx) instead of tx/rx (addr only keys the stats)
+
+    I2cCallback done{nullptr};
+    void *ctx{nullptr};
+    void *notify{nullptr};      ///< Task to notify on completion (TaskHandle_t on target)
+    uint32_t notify_bits{0};    ///< ... bits set in its notification value
+    void *waiter{nullptr};      ///< Set by I2cBus::transfer() for blocking callers
+
+    // Filled in by the bus
+    I2cStatus status{I2cStatus::Ok};
+    uint32_t queued_us{0};
+    uint32_t start_us{0};
+    uint32_t end_us{0};
+
+    /// @return false if @p len exceeds I2C_TX_INLINE_MAX.
+    static bool write(I2cTransaction &t, uint8_t addr, const uint8_t *data, size_t len);
+    static bool readReg(I2cTransaction &t, uint8_t addr, uint8_t reg, uint8_t *rx, size_t len);
+    static I2cTransaction exclusive(uint8_t addr, I2cJob job, void *ctx);
+};
+
+/// Performs one transfer; implemented over Wire on target and faked in host tests.
+class II2cBackend
+{
+public:
+    virtual ~II2cBackend() = default;
+    virtual I2cStatus transfer(uint8_t addr, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) = 0;
+};
+
+class I2cTransactionQueue
+{
+public:
+    struct DeviceStats
+    {
+        uint8_t addr;
+        uint32_t transactions;
+        uint32_t nacks;
+        uint32_t timeouts;
+        uint32_t errors;         ///< BusError
+        uint32_t latency_max_us; ///< Submit -> completion, worst case
+        uint64_t latency_sum_us; ///< ... sum, / transactions = mean
+        uint32_t transfer_max_us; ///< Time on the bus, worst case
+        uint64_t busy_us;         ///< Time on the bus, total
+    };
+
+    struct Stats
+    {
+        uint32_t submitted;
+        uint32_t completed;
+        uint32_t queue_full;       ///< Refused submits
+        uint32_t queue_high_water; ///< Deepest backlog seen
+        uint32_t untracked;        ///< Completions from addresses beyond I2C_BUS_MAX_DEVICES
+        uint64_t busy_us;          ///< Sum of all transfer times
+        uint32_t since_us;         ///< Start of the stats window
+    };
+
+    /// Queue a copy of @p t. @return Ok, or QueueFull (counted).
+    I2cStatus submit(const I2cTransaction &t, uint32_t nowUs);
+
+    /// Take the oldest pending transaction. @return false if there is none.
+    bool pop(I2cTransaction &out);
+
+    size_t pending() const { return _count; }
+
+    /// Execute @p t on @p backend (or its job) and timestamp it. Callbacks are the caller's.
+    static void execute(I2cTransaction &t, II2cBackend &backend, uint32_t (*nowUs)());
+
+    /// Account a completed transaction.
+    void record(const I2cTransaction &t);
+
+    /// execute() + record().
+    void run(I2cTransaction &t, II2cBackend &backend, uint32_t (*nowUs)())
+    {
+        execute(t, backend, nowUs);
+        record(t);
+    }
+
+    const Stats &stats() const { return _stats; }
+    size_t devices() const { return _deviceCount; }
+    const DeviceStats &device(size_t i) const { return _devices[i]; }
+    const DeviceStats *deviceStats(uint8_t addr) const;
+
+    /// Share of the window since resetStats() the bus spent transferring, 0..100.
+    uint8_t utilizationPct(uint32_t nowUs) const;
+
+    /// Start a new stats window; the device table keeps its addresses.
+    void resetStats(uint32_t nowUs);
+
+private:
+    I2cTransaction _ring[I2C_BUS_QUEUE_LEN];
+    size_t _head{0};
+    size_t _count{0};
+
+    Stats _stats{};
+    DeviceStats _devices[I2C_BUS_MAX_DEVICES]{};
+    size_t _deviceCount{0};
+};
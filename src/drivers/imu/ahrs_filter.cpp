@@ -0,0 +1,229 @@
+#include "ahrs_filter.hpp"
+
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+    constexpr float kRadToDeg = 57.2957795f;
+
+    float clampUnit(float v) { return v > 1.0f ? 1.0f : v < -1.0f ? -1.0f : v; }
+}
+
+float AhrsFilter::invSqrt(float x)
+{
+    // Initial estimate from the exponent bits, refined once (memcpy: no aliasing UB)
+    const float halfx = 0.5f * x;
+    uint32_t i;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5f3759dfu - (i >> 1);
+    float y;
+    memcpy(&y, &i, sizeof(y));
+    return y * (1.5f - halfx * y * y);
+}
+
+void AhrsFilter::setSampleRate(float hz)
+{
+    _sampleHz = hz;
+    _dt = hz > 0.0f ? 1.0f / hz : 0.0f;
+}
+
+void AhrsFilter::reset()
+{
+    _q0 = 1.0f;
+    _q1 = _q2 = _q3 = 0.0f;
+    _ix = _iy = _iz = 0.0f;
+}
+
+void AhrsFilter::update(const float gyro[3], const float accel[3], const float *mag)
+{
+    const bool useMag = mag && !(mag[0] == 0.0f && mag[1] == 0.0f && mag[2] == 0.0f);
+    const float mx = useMag ? mag[0] : 0.0f;
+    const float my = useMag ? mag[1] : 0.0f;
+    const float mz = useMag ? mag[2] : 0.0f;
+    if (_algorithm == AhrsAlgorithm::Madgwick)
+        madgwick(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], mx, my, mz, useMag);
+    else
+        mahony(gyro[0], gyro[1], gyro[2], accel[0], accel[1], accel[2], mx, my, mz, useMag);
+}
+
+void AhrsFilter::mahony(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz,
+                        bool useMag)
+{
+    if (!(ax == 0.0f && ay == 0.0f && az == 0.0f))
+    {
+        float recipNorm = invSqrt(ax * ax + ay * ay + az * az);
+        ax *= recipNorm;
+        ay *= recipNorm;
+        az *= recipNorm;
+
+        const float q0q1 = _q0 * _q1, q0q2 = _q0 * _q2, q0q3 = _q0 * _q3;
+        const float q1q1 = _q1 * _q1, q1q2 = _q1 * _q2, q1q3 = _q1 * _q3;
+        const float q2q2 = _q2 * _q2, q2q3 = _q2 * _q3, q3q3 = _q3 * _q3;
+
+        // Estimated gravity (half), error = measured x estimated
+        const float halfvx = q1q3 - q0q2;
+        const float halfvy = q0q1 + q2q3;
+        const float halfvz = _q0 * _q0 - 0.5f + q3q3;
+        float halfex = ay * halfvz - az * halfvy;
+        float halfey = az * halfvx - ax * halfvz;
+        float halfez = ax * halfvy - ay * halfvx;
+
+        if (useMag)
+        {
+            recipNorm = invSqrt(mx * mx + my * my + mz * mz);
+            mx *= recipNorm;
+            my *= recipNorm;
+            mz *= recipNorm;
+
+            // Earth field: rotate to earth, keep horizontal magnitude and vertical part
+            const float hx = 2.0f * (mx * (0.5f - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+            const float hy = 2.0f * (mx * (q1q2 + q0q3) + my * (0.5f - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+            const float h2 = hx * hx + hy * hy;
+            const float bx = h2 > 0.0f ? h2 * invSqrt(h2) : 0.0f;
+            const float bz = 2.0f * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5f - q1q1 - q2q2));
+
+            const float halfwx = bx * (0.5f - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+            const float halfwy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+            const float halfwz = bx * (q0q2 + q1q3) + bz * (0.5f - q1q1 - q2q2);
+            halfex += my * halfwz - mz * halfwy;
+            halfey += mz * halfwx - mx * halfwz;
+            halfez += mx * halfwy - my * halfwx;
+        }
+
+        if (_twoKi > 0.0f)
+        {
+            _ix += _twoKi * halfex * _dt;
+            _iy += _twoKi * halfey * _dt;
+            _iz += _twoKi * halfez * _dt;
+            gx += _ix;
+            gy += _iy;
+            gz += _iz;
+        }
+        else
+        {
+            _ix = _iy = _iz = 0.0f;
+        }
+        gx += _twoKp * halfex;
+        gy += _twoKp * halfey;
+        gz += _twoKp * halfez;
+    }
+
+    // q += 0.5 * q x omega * dt
+    const float halfDt = 0.5f * _dt;
+    gx *= halfDt;
+    gy *= halfDt;
+    gz *= halfDt;
+    const float qa = _q0, qb = _q1, qc = _q2;
+    _q0 += -qb * gx - qc * gy - _q3 * gz;
+    _q1 += qa * gx + qc * gz - _q3 * gy;
+    _q2 += qa * gy - qb * gz + _q3 * gx;
+    _q3 += qa * gz + qb * gy - qc * gx;
+    normalize();
+}
+
+void AhrsFilter::madgwick(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz,
+                          bool useMag)
+{
+    const float q0 = _q0, q1 = _q1, q2 = _q2, q3 = _q3;
+    float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    if (!(ax == 0.0f && ay == 0.0f && az == 0.0f))
+    {
+        float recipNorm = invSqrt(ax * ax + ay * ay + az * az);
+        ax *= recipNorm;
+        ay *= recipNorm;
+        az *= recipNorm;
+
+        const float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+        const float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+        float s0, s1, s2, s3;
+        if (useMag)
+        {
+            recipNorm = invSqrt(mx * mx + my * my + mz * mz);
+            mx *= recipNorm;
+            my *= recipNorm;
+            mz *= recipNorm;
+
+            const float q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3;
+            const float q1q2 = q1 * q2, q1q3 = q1 * q3, q2q3 = q2 * q3;
+            const float _2q0mx = _2q0 * mx, _2q0my = _2q0 * my, _2q0mz = _2q0 * mz, _2q1mx = _2q1 * mx;
+            const float _2q0q2 = 2.0f * q0q2, _2q2q3 = 2.0f * q2q3;
+
+            // Reference direction of the earth's field
+            const float hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 -
+                             mx * q2q2 - mx * q3q3;
+            const float hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 +
+                             _2q2 * mz * q3 - my * q3q3;
+            const float h2 = hx * hx + hy * hy;
+            const float _2bx = h2 > 0.0f ? h2 * invSqrt(h2) : 0.0f;
+            const float _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 -
+                               mz * q2q2 + mz * q3q3;
+            const float _4bx = 2.0f * _2bx, _4bz = 2.0f * _2bz;
+
+            // Objective function residuals, shared by the gradient terms
+            const float fa0 = 2.0f * q1q3 - _2q0q2 - ax;
+            const float fa1 = 2.0f * q0q1 + _2q2q3 - ay;
+            const float fa2 = 1.0f - 2.0f * q1q1 - 2.0f * q2q2 - az;
+            const float fm0 = _2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx;
+            const float fm1 = _2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my;
+            const float fm2 = _2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz;
+
+            s0 = -_2q2 * fa0 + _2q1 * fa1 - _2bz * q2 * fm0 + (-_2bx * q3 + _2bz * q1) * fm1 + _2bx * q2 * fm2;
+            s1 = _2q3 * fa0 + _2q0 * fa1 - 4.0f * q1 * fa2 + _2bz * q3 * fm0 + (_2bx * q2 + _2bz * q0) * fm1 +
+                 (_2bx * q3 - _4bz * q1) * fm2;
+            s2 = -_2q0 * fa0 + _2q3 * fa1 - 4.0f * q2 * fa2 + (-_4bx * q2 - _2bz * q0) * fm0 +
+                 (_2bx * q1 + _2bz * q3) * fm1 + (_2bx * q0 - _4bz * q2) * fm2;
+            s3 = _2q1 * fa0 + _2q2 * fa1 + (-_4bx * q3 + _2bz * q1) * fm0 + (-_2bx * q0 + _2bz * q2) * fm1 +
+                 _2bx * q1 * fm2;
+        }
+        else
+        {
+            const float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+            const float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+            s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+            s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+            s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+            s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+        }
+
+        const float s2sum = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (s2sum > 0.0f) // exactly on target: no step
+        {
+            recipNorm = _beta * invSqrt(s2sum);
+            qDot0 -= recipNorm * s0;
+            qDot1 -= recipNorm * s1;
+            qDot2 -= recipNorm * s2;
+            qDot3 -= recipNorm * s3;
+        }
+    }
+
+    _q0 = q0 + qDot0 * _dt;
+    _q1 = q1 + qDot1 * _dt;
+    _q2 = q2 + qDot2 * _dt;
+    _q3 = q3 + qDot3 * _dt;
+    normalize();
+}
+
+void AhrsFilter::normalize()
+{
+    // A second Newton step: invSqrt()'s 0.18 % would leave |q| short of 1 on every update,
+    // which scales the gravity estimate and reads as a few degrees of attitude error
+    const float n = _q0 * _q0 + _q1 * _q1 + _q2 * _q2 + _q3 * _q3;
+    float recipNorm = invSqrt(n);
+    recipNorm *= 1.5f - 0.5f * n * recipNorm * recipNorm;
+    _q0 *= recipNorm;
+    _q1 *= recipNorm;
+    _q2 *= recipNorm;
+    _q3 *= recipNorm;
+}
+
+void AhrsFilter::toEuler(float &rollDeg, float &pitchDeg, float &yawDeg) const
+{
+    rollDeg = atan2f(_q0 * _q1 + _q2 * _q3, 0.5f - _q1 * _q1 - _q2 * _q2) * kRadToDeg;
+    pitchDeg = asinf(clampUnit(-2.0f * (_q1 * _q3 - _q0 * _q2))) * kRadToDeg;
+    yawDeg = atan2f(_q1 * _q2 + _q0 * _q3, 0.5f - _q2 * _q2 - _q3 * _q3) * kRadToDeg;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * @file ahrs_filter.hpp
+ * @brief Mahony / Madgwick attitude filter with a fixed time step, single precision only.
+ *
+ * The MPU9250 library fuses inside update(), where we can neither tune nor time it. This
+ * filter keeps only the quaternion on the hot path: update() is multiply-adds, one fast
+ * inverse square root per normalization and no trig, with dt fixed by setSampleRate().
+ * Euler angles are computed on demand (toEuler()), i.e. at the publish rate.
+ *
+ * Inputs are in the sensor frame: gyro in rad/s, accel and mag in any unit (only their
+ * direction is used), so scaled counts can go in as they are. A null mag, or a zero one,
+ * falls back to accel + gyro (yaw integrated from the gyro). Builds on the host.
+ */
+
+#include <stdint.h>
+
+// ===== Tunables ===============================================================
+#ifndef AHRS_MAHONY_KP
+#define AHRS_MAHONY_KP 1.0f // proportional gain
+#endif
+
+#ifndef AHRS_MAHONY_KI
+#define AHRS_MAHONY_KI 0.05f // integral gain: learns the gyro bias the weak mag correction leaves as heading error; 0 = off
+#endif
+
+#ifndef AHRS_MADGWICK_BETA
+#define AHRS_MADGWICK_BETA 0.1f // gradient step (Adafruit AHRS default)
+#endif
+
+enum class AhrsAlgorithm : uint8_t
+{
+    Mahony,   ///< PI correction on the cross product of measured and estimated directions
+    Madgwick, ///< Gradient descent step towards the measured directions
+};
+
+struct AhrsQuaternion
+{
+    float w, x, y, z; ///< Sensor to earth (NWU), unit length
+};
+
+class AhrsFilter
+{
+public:
+    explicit AhrsFilter(AhrsAlgorithm algorithm = AhrsAlgorithm::Mahony) : _algorithm(algorithm) {}
+
+    /// Fixed step: update() assumes 1 / @p hz between samples.
+    void setSampleRate(float hz);
+    float sampleRate() const { return _sampleHz; }
+
+    void setAlgorithm(AhrsAlgorithm algorithm) { _algorithm = algorithm; }
+    AhrsAlgorithm algorithm() const { return _algorithm; }
+
+    void setMahonyGains(float kp, float ki)
+    {
+        _twoKp = 2.0f * kp;
+        _twoKi = 2.0f * ki;
+    }
+    void setMadgwickBeta(float beta) { _beta = beta; }
+
+    /// Back to level, heading 0, no integral feedback.
+    void reset();
+
+    /**
+     * @brief One fixed step.
+     * @param gyro rad/s
+     * @param accel Any unit; a zero vector skips the correction (gyro only)
+     * @param mag Any unit, or nullptr / zero vector for accel + gyro only
+     */
+    void update(const float gyro[3], const float accel[3], const float *mag);
+
+    AhrsQuaternion quaternion() const { return {_q0, _q1, _q2, _q3}; }
+
+    /// Roll, pitch, yaw in degrees (trig: call at the publish rate, not per update).
+    void toEuler(float &rollDeg, float &pitchDeg, float &yawDeg) const;
+
+    /// 1 / sqrt(x): bit-level estimate plus one Newton step, within 0.18 % (enough for directions).
+    static float invSqrt(float x);
+
+private:
+    void mahony(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, bool useMag);
+    void madgwick(float gx, float gy, float gz, float ax, float ay, float az, float mx, float my, float mz, bool useMag);
+    void normalize();
+
+    AhrsAlgorithm _algorithm;
+    float _sampleHz{0.0f};
+    float _dt{0.0f};
+    float _twoKp{2.0f * AHRS_MAHONY_KP};
+    float _twoKi{2.0f * AHRS_MAHONY_KI};
+    float _beta{AHRS_MADGWICK_BETA};
+    float _q0{1.0f}, _q1{0.0f}, _q2{0.0f}, _q3{0.0f};
+    float _ix{0.0f}, _iy{0.0f}, _iz{0.0f}; ///< Mahony integral feedback (scaled by Ki)
+};
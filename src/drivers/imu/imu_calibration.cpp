@@ -0,0 +1,224 @@
+#include "imu_calibration.hpp"
+
+#include <math.h>
+
+ImuCalibrationData ImuCalibrationData::identity()
+{
+    ImuCalibrationData d{};
+    d.mag_softiron[0] = d.mag_softiron[4] = d.mag_softiron[8] = 1.0f;
+    d.mag_field = 50.0f; // Adafruit_Sensor_Calibration's default
+    return d;
+}
+
+void ImuCalibration::apply(const ImuRawSample *in, size_t n, ImuSample *out) const
+{
+    // Offsets and scales in locals: the loop body is six independent multiply-subtracts
+    const float as = _accelScale, gs = _gyroScale;
+    const float a0 = _data.accel_zerog[0], a1 = _data.accel_zerog[1], a2 = _data.accel_zerog[2];
+    const float g0 = _data.gyro_zerorate[0], g1 = _data.gyro_zerorate[1], g2 = _data.gyro_zerorate[2];
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i].accel[0] = in[i].accel[0] * as - a0;
+        out[i].accel[1] = in[i].accel[1] * as - a1;
+        out[i].accel[2] = in[i].accel[2] * as - a2;
+        out[i].gyro[0] = in[i].gyro[0] * gs - g0;
+        out[i].gyro[1] = in[i].gyro[1] * gs - g1;
+        out[i].gyro[2] = in[i].gyro[2] * gs - g2;
+    }
+}
+
+void ImuCalibration::apply(const float accel[3], const float gyro[3], ImuSample &out) const
+{
+    for (int a = 0; a < 3; ++a)
+    {
+        out.accel[a] = accel[a] - _data.accel_zerog[a];
+        out.gyro[a] = gyro[a] - _data.gyro_zerorate[a];
+    }
+}
+
+void ImuCalibration::applyMag(const float in[3], float out[3]) const
+{
+    const float x = in[0] - _data.mag_hardiron[0];
+    const float y = in[1] - _data.mag_hardiron[1];
+    const float z = in[2] - _data.mag_hardiron[2];
+    const float *s = _data.mag_softiron;
+    out[0] = s[0] * x + s[1] * y + s[2] * z;
+    out[1] = s[3] * x + s[4] * y + s[5] * z;
+    out[2] = s[6] * x + s[7] * y + s[8] * z;
+}
+
+void ImuCalibrator::start(ImuCalKind kind, uint32_t samples)
+{
+    *this = ImuCalibrator{};
+    if (kind == ImuCalKind::None || samples == 0)
+        return;
+    _kind = kind;
+    _target = samples;
+    _status = ImuCalStatus::Running;
+    for (int a = 0; a < 3; ++a)
+    {
+        _min[a] = INFINITY;
+        _max[a] = -INFINITY;
+    }
+}
+
+void ImuCalibrator::cancel()
+{
+    _status = ImuCalStatus::Idle;
+    _kind = ImuCalKind::None;
+}
+
+void ImuCalibrator::add(const ImuSample &corrected, const float *rawMag)
+{
+    if (_status != ImuCalStatus::Running)
+        return;
+
+    _n++;
+    const float v[6] = {corrected.accel[0], corrected.accel[1], corrected.accel[2],
+                        corrected.gyro[0], corrected.gyro[1], corrected.gyro[2]};
+    for (int i = 0; i < 6; ++i)
+    {
+        const float d = v[i] - _mean[i];
+        _mean[i] += d / (float)_n;
+        _m2[i] += d * (v[i] - _mean[i]);
+    }
+    if (_kind == ImuCalKind::Mag && rawMag && (rawMag[0] != 0.0f || rawMag[1] != 0.0f || rawMag[2] != 0.0f))
+    {
+        _magN++;
+        for (int a = 0; a < 3; ++a)
+        {
+            _min[a] = rawMag[a] < _min[a] ? rawMag[a] : _min[a];
+            _max[a] = rawMag[a] > _max[a] ? rawMag[a] : _max[a];
+        }
+    }
+    if (_n >= _target)
+        finish();
+}
+
+void ImuCalibrator::finish()
+{
+    float accelStd = 0.0f, gyroStd = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        const float a = sqrtf(_m2[i] / (float)_n);
+        const float g = sqrtf(_m2[3 + i] / (float)_n);
+        accelStd = a > accelStd ? a : accelStd;
+        gyroStd = g > gyroStd ? g : gyroStd;
+    }
+
+    switch (_kind)
+    {
+    case ImuCalKind::Gyro:
+        _spread = gyroStd;
+        _status = gyroStd > IMU_CAL_MAX_GYRO_STD ? ImuCalStatus::Moving : ImuCalStatus::Done;
+        break;
+    case ImuCalKind::Accel:
+    {
+        _spread = accelStd;
+        const float dz = _mean[2] - IMU_STANDARD_GRAVITY;
+        const float offset = sqrtf(_mean[0] * _mean[0] + _mean[1] * _mean[1] + dz * dz);
+        if (accelStd > IMU_CAL_MAX_ACCEL_STD || gyroStd > IMU_CAL_MAX_GYRO_STD)
+            _status = ImuCalStatus::Moving;
+        else if (offset > IMU_CAL_MAX_ACCEL_OFFSET)
+            _status = ImuCalStatus::NotLevel;
+        else
+            _status = ImuCalStatus::Done;
+        break;
+    }
+    case ImuCalKind::Mag:
+    {
+        if (!_magN)
+        {
+            _status = ImuCalStatus::NoData;
+            break;
+        }
+        float minRadius = INFINITY;
+        for (int a = 0; a < 3; ++a)
+        {
+            const float r = 0.5f * (_max[a] - _min[a]);
+            minRadius = r < minRadius ? r : minRadius;
+        }
+        _spread = minRadius;
+        _status = minRadius < IMU_CAL_MIN_MAG_RADIUS ? ImuCalStatus::NoRotation : ImuCalStatus::Done;
+        break;
+    }
+    default:
+        _status = ImuCalStatus::Idle;
+        break;
+    }
+}
+
+bool ImuCalibrator::result(ImuCalibrationData &cal) const
+{
+    if (_status != ImuCalStatus::Done)
+        return false;
+
+    switch (_kind)
+    {
+    case ImuCalKind::Gyro:
+        for (int a = 0; a < 3; ++a)
+            cal.gyro_zerorate[a] += _mean[3 + a];
+        break;
+    case ImuCalKind::Accel:
+        cal.accel_zerog[0] += _mean[0];
+        cal.accel_zerog[1] += _mean[1];
+        cal.accel_zerog[2] += _mean[2] - IMU_STANDARD_GRAVITY;
+        break;
+    case ImuCalKind::Mag:
+    {
+        float r[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            cal.mag_hardiron[a] = 0.5f * (_max[a] + _min[a]);
+            r[a] = 0.5f * (_max[a] - _min[a]);
+        }
+        const float mean = (r[0] + r[1] + r[2]) / 3.0f;
+        for (int i = 0; i < 9; ++i)
+            cal.mag_softiron[i] = 0.0f;
+        cal.mag_softiron[0] = mean / r[0];
+        cal.mag_softiron[4] = mean / r[1];
+        cal.mag_softiron[8] = mean / r[2];
+        cal.mag_field = mean;
+        break;
+    }
+    default:
+        return false;
+    }
+    return true;
+}
+
+const char *ImuCalibrator::kindName(ImuCalKind kind)
+{
+    switch (kind)
+    {
+    case ImuCalKind::Gyro:
+        return "gyro";
+    case ImuCalKind::Accel:
+        return "accel";
+    case ImuCalKind::Mag:
+        return "mag";
+    default:
+        return "none";
+    }
+}
+
+const char *ImuCalibrator::statusName(ImuCalStatus status)
+{
+    switch (status)
+    {
+    case ImuCalStatus::Running:
+        return "running";
+    case ImuCalStatus::Done:
+        return "done";
+    case ImuCalStatus::Moving:
+        return "moving";
+    case ImuCalStatus::NotLevel:
+        return "not_level";
+    case ImuCalStatus::NoRotation:
+        return "no_rotation";
+    case ImuCalStatus::NoData:
+        return "no_data";
+    default:
+        return "idle";
+    }
+}
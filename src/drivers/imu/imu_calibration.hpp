@@ -0,0 +1,163 @@
+#pragma once
+
+/**
+ * @file imu_calibration.hpp
+ * @brief IMU calibration: the per-sample correction on the fusion path, and the on-command
+ * routines that estimate it.
+ *
+ * ImuCalibrationData holds the same fields, in the same units, as Adafruit_Sensor_Calibration
+ * (accel m/s², gyro rad/s, mag µT), so it copies one to one into the library's NVS record.
+ * The library's own calibrate() works on one sensors_event_t at a time and branches on the
+ * event type; ImuCalibration applies the same correction to a whole FIFO batch instead:
+ * scale from counts and subtract the offsets, one multiply-subtract per value without
+ * branches, which the compiler unrolls (and vectorizes where the target can). The
+ * magnetometer (hard iron, then the soft iron matrix) is corrected once per reading.
+ *
+ * ImuCalibrator runs one routine on the fused samples:
+ * - Gyro: held still, the mean rate is the bias
+ * - Accel: held still and level (z up), the mean minus 1 g is the zero-g offset
+ * - Mag: turned through every orientation, the min/max box gives the hard iron (centre) and
+ *   a diagonal soft iron (per-axis scale to the mean radius)
+ * Gyro and accel see samples that are already corrected, so their result adds to the
+ * current offsets; mag works on the raw field. Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mpu9250_fifo.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef IMU_CAL_MAX_GYRO_STD
+#define IMU_CAL_MAX_GYRO_STD 0.02f // rad/s (~1 deg/s): more spread than this while calibrating = moved
+#endif
+
+#ifndef IMU_CAL_MAX_ACCEL_STD
+#define IMU_CAL_MAX_ACCEL_STD 0.3f // m/s^2: more spread than this while calibrating = moved
+#endif
+
+#ifndef IMU_CAL_MAX_ACCEL_OFFSET
+#define IMU_CAL_MAX_ACCEL_OFFSET 1.5f // m/s^2: a larger zero-g offset means the board wasn't level (~9 deg)
+#endif
+
+#ifndef IMU_CAL_MIN_MAG_RADIUS
+#define IMU_CAL_MIN_MAG_RADIUS 15.0f // uT: every axis must swing this far around the centre (Earth: 25-65)
+#endif
+
+static constexpr float IMU_STANDARD_GRAVITY = 9.80665f; // m/s^2
+
+/// Field layout and units of Adafruit_Sensor_Calibration.
+struct ImuCalibrationData
+{
+    float accel_zerog[3];   ///< m/s^2, subtracted
+    float gyro_zerorate[3]; ///< rad/s, subtracted
+    float mag_hardiron[3];  ///< uT, subtracted
+    float mag_softiron[9];  ///< Row major, applied after the hard iron
+    float mag_field;        ///< uT, field magnitude after correction
+
+    /// No correction (the library's defaults).
+    static ImuCalibrationData identity();
+};
+
+/// One fused sample in SI units.
+struct ImuSample
+{
+    float accel[3]; ///< m/s^2
+    float gyro[3];  ///< rad/s
+};
+
+class ImuCalibration
+{
+public:
+    ImuCalibration() : ImuCalibration(ImuCalibrationData::identity()) {}
+    explicit ImuCalibration(const ImuCalibrationData &data) { set(data); }
+
+    void set(const ImuCalibrationData &data) { _data = data; }
+    const ImuCalibrationData &data() const { return _data; }
+
+    /// Counts to SI for apply(const ImuRawSample *, ...): m/s^2 and rad/s per LSB.
+    void setRawScale(float accelPerLsb, float gyroPerLsb)
+    {
+        _accelScale = accelPerLsb;
+        _gyroScale = gyroPerLsb;
+    }
+
+    /// @p n raw frames to corrected SI samples (@p in and @p out don't overlap).
+    void apply(const ImuRawSample *in, size_t n, ImuSample *out) const;
+
+    /// One sample already in SI units.
+    void apply(const float accel[3], const float gyro[3], ImuSample &out) const;
+
+    /// Field in uT, sensor (accel/gyro) axes.
+    void applyMag(const float in[3], float out[3]) const;
+
+private:
+    ImuCalibrationData _data;
+    float _accelScale{1.0f};
+    float _gyroScale{1.0f};
+};
+
+enum class ImuCalKind : uint8_t
+{
+    None,
+    Gyro,
+    Accel,
+    Mag,
+};
+
+enum class ImuCalStatus : uint8_t
+{
+    Idle,
+    Running,
+    Done,
+    Moving,     ///< Gyro / accel: spread above IMU_CAL_MAX_*_STD
+    NotLevel,   ///< Accel: offset above IMU_CAL_MAX_ACCEL_OFFSET
+    NoRotation, ///< Mag: an axis swung less than IMU_CAL_MIN_MAG_RADIUS
+    NoData,     ///< Mag: no field reading came in
+};
+
+class ImuCalibrator
+{
+public:
+    /// Start over, collecting @p samples fused samples.
+    void start(ImuCalKind kind, uint32_t samples);
+    void cancel();
+
+    bool running() const { return _status == ImuCalStatus::Running; }
+    ImuCalKind kind() const { return _kind; }
+    ImuCalStatus status() const { return _status; }
+    uint32_t collected() const { return _n; }
+
+    /**
+     * @brief One fused sample; finishes after the requested count.
+     * @param corrected Accel + gyro with the current calibration applied
+     * @param rawMag Field before correction in uT (sensor axes), nullptr if there is none
+     */
+    void add(const ImuSample &corrected, const float *rawMag);
+
+    /**
+     * @brief After Done: write this routine's fields into @p cal (gyro and accel on top of
+     * the offsets the samples were corrected with). False, untouched, otherwise.
+     */
+    bool result(ImuCalibrationData &cal) const;
+
+    /// Largest per-axis standard deviation (gyro rad/s, accel m/s^2) or the smallest
+    /// mag radius (uT) of the finished routine: what the status was judged on.
+    float spread() const { return _spread; }
+
+    static const char *kindName(ImuCalKind kind);
+    static const char *statusName(ImuCalStatus status);
+
+private:
+    void finish();
+
+    ImuCalKind _kind{ImuCalKind::None};
+    ImuCalStatus _status{ImuCalStatus::Idle};
+    uint32_t _target{0};
+    uint32_t _n{0};
+    uint32_t _magN{0};
+    float _spread{0.0f};
+    // Welford per axis: accel 0..2, gyro 3..5
+    float _mean[6]{};
+    float _m2[6]{};
+    float _min[3]{}, _max[3]{};
+};
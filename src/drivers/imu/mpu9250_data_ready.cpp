@@ -0,0 +1,75 @@
+#include "mpu9250_data_ready.hpp"
+
+namespace
+{
+    constexpr uint8_t kSmplrtDiv = 0x19;
+    constexpr uint8_t kIntPinCfg = 0x37;
+    constexpr uint8_t kIntEnable = 0x38;
+
+    constexpr uint8_t kBypassEn = 0x02;  // INT_PIN_CFG: AK8963 stays on the main bus; active high, 50 µs pulse
+    constexpr uint8_t kRawRdyEn = 0x01;  // INT_ENABLE
+    constexpr uint32_t kInternalHz = 1000;
+}
+
+I2cStatus Mpu9250DataReady::enable(II2cBackend &bus, uint8_t addr, uint32_t rateHz, uint32_t &actualHz)
+{
+    actualHz = 0;
+    if (rateHz)
+    {
+        uint32_t div = (kInternalHz + rateHz / 2) / rateHz;
+        div = div < 1 ? 1 : div > 256 ? 256 : div;
+        const uint8_t tx[2] = {kSmplrtDiv, (uint8_t)(div - 1)};
+        const I2cStatus st = bus.transfer(addr, tx, 2, nullptr, 0);
+        if (st != I2cStatus::Ok)
+            return st;
+        actualHz = kInternalHz / div;
+    }
+
+    const uint8_t pinCfg[2] = {kIntPinCfg, kBypassEn};
+    I2cStatus st = bus.transfer(addr, pinCfg, 2, nullptr, 0);
+    uint8_t enabled = 0;
+    if (st == I2cStatus::Ok)
+        st = bus.transfer(addr, &kIntEnable, 1, &enabled, 1);
+    if (st != I2cStatus::Ok)
+        return st;
+    const uint8_t intEnable[2] = {kIntEnable, (uint8_t)(enabled | kRawRdyEn)};
+    return bus.transfer(addr, intEnable, 2, nullptr, 0);
+}
+
+void Mpu9250DataReady::record(uint32_t readUs, uint32_t isrUs, bool fromIsr)
+{
+    _stats.reads++;
+    if (fromIsr)
+    {
+        const uint32_t latency = readUs - isrUs;
+        _stats.triggered++;
+        _stats.latency_sum_us += latency;
+        if (latency > _stats.latency_max_us)
+            _stats.latency_max_us = latency;
+    }
+
+    if (_haveLast && _periodUs)
+    {
+        const uint32_t interval = readUs - _lastReadUs;
+        if (interval >= 2 * _periodUs - _periodUs / 2)
+        {
+            _stats.gaps++; // not jitter: a whole period went by without a read
+        }
+        else
+        {
+            const uint32_t jitter = interval > _periodUs ? interval - _periodUs : _periodUs - interval;
+            _stats.intervals++;
+            _stats.jitter_sum_us += jitter;
+            if (jitter > _stats.jitter_max_us)
+                _stats.jitter_max_us = jitter;
+        }
+    }
+    _lastReadUs = readUs;
+    _haveLast = true;
+}
+
+void Mpu9250DataReady::resetStats(uint32_t nowUs)
+{
+    _stats = Stats{};
+    _stats.since_us = nowUs;
+}
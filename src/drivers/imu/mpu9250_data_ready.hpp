@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * @file mpu9250_data_ready.hpp
+ * @brief MPU9250 data-ready interrupt setup, and read timing against it.
+ *
+ * A timer-paced read lands anywhere in the sensor's sample period, and the two clocks
+ * drift apart, so now and then a sample is read twice or skipped. With RAW_RDY_EN the
+ * MPU9250 pulses INT (50 µs, active high) whenever a new sample is in its registers;
+ * reading right after that pulse gets every sample once, at a fixed small age.
+ *
+ * enable() configures the pin; record() measures each read: the interrupt-to-read latency
+ * (when the read was triggered by an interrupt) and the jitter of the read interval
+ * against the expected period, for either pacing. Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "drivers/i2c/i2c_transaction_queue.hpp"
+
+class Mpu9250DataReady
+{
+public:
+    struct Stats
+    {
+        uint32_t reads;
+        uint32_t triggered;      ///< Reads with an interrupt time (latency below)
+        uint32_t latency_max_us; ///< Interrupt -> read
+        uint64_t latency_sum_us; ///< ... sum, / triggered = mean
+        uint32_t jitter_max_us;  ///< |read interval - period|
+        uint64_t jitter_sum_us;  ///< ... sum, / intervals = mean
+        uint32_t intervals;
+        uint32_t gaps;           ///< Intervals of two periods or more (a sample read late or skipped)
+        uint32_t since_us;       ///< Start of the stats window
+    };
+
+    /**
+     * @brief Pulse INT on every new sample, keep the magnetometer bypass the MPU9250 library
+     * set up, and leave other interrupt sources (FIFO overflow) enabled.
+     * @param rateHz != 0 also sets the sample rate (1 kHz / n; needs the DLPF on)
+     * @param actualHz Sample rate the divider gives (unchanged: @p rateHz = 0 leaves it 0)
+     */
+    static I2cStatus enable(II2cBackend &bus, uint8_t addr, uint32_t rateHz, uint32_t &actualHz);
+
+    /// Expected time between reads (sensor period x interrupts per read, or the timer period).
+    void setPeriod(uint32_t periodUs) { _periodUs = periodUs; }
+    uint32_t periodUs() const { return _periodUs; }
+
+    /// A read started at @p readUs; @p fromIsr: it answers the interrupt at @p isrUs.
+    void record(uint32_t readUs, uint32_t isrUs, bool fromIsr);
+
+    const Stats &stats() const { return _stats; }
+    void resetStats(uint32_t nowUs);
+
+private:
+    uint32_t _periodUs{0};
+    uint32_t _lastReadUs{0};
+    bool _haveLast{false};
+    Stats _stats{};
+};
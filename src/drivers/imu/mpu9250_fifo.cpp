@@ -0,0 +1,170 @@
+#include "mpu9250_fifo.hpp"
+
+namespace
+{
+    // Register map (MPU-9250 register map rev 1.6)
+    constexpr uint8_t kSmplrtDiv = 0x19;
+    constexpr uint8_t kConfig = 0x1A;
+    constexpr uint8_t kGyroConfig = 0x1B;
+    constexpr uint8_t kAccelConfig = 0x1C;
+    constexpr uint8_t kAccelConfig2 = 0x1D;
+    constexpr uint8_t kFifoEn = 0x23;
+    constexpr uint8_t kIntEnable = 0x38;
+    constexpr uint8_t kIntStatus = 0x3A;
+    constexpr uint8_t kUserCtrl = 0x6A;
+    constexpr uint8_t kFifoCountH = 0x72;
+    constexpr uint8_t kFifoRW = 0x74;
+
+    constexpr uint8_t kDlpf184Hz = 0x01;       // CONFIG / ACCEL_CONFIG2: 1 kHz internal rate
+    constexpr uint8_t kGyroFs2000 = 0x18;
+    constexpr uint8_t kAccelFs16g = 0x18;
+    constexpr uint8_t kFifoAccelGyro = 0x78;   // GYRO_XOUT, _YOUT, _ZOUT, ACCEL
+    constexpr uint8_t kFifoOflowInt = 0x10;    // INT_ENABLE / INT_STATUS
+    constexpr uint8_t kUserFifoEn = 0x40;
+    constexpr uint8_t kUserFifoRst = 0x04;
+
+    constexpr uint32_t kInternalHz = 1000;
+
+    int16_t be16(const uint8_t *p) { return (int16_t)(((uint16_t)p[0] << 8) | p[1]); }
+}
+
+I2cStatus Mpu9250Fifo::writeReg(II2cBackend &bus, uint8_t reg, uint8_t value)
+{
+    const uint8_t tx[2] = {reg, value};
+    return bus.transfer(_addr, tx, 2, nullptr, 0);
+}
+
+I2cStatus Mpu9250Fifo::readReg(II2cBackend &bus, uint8_t reg, uint8_t *rx, size_t len)
+{
+    return bus.transfer(_addr, &reg, 1, rx, len);
+}
+
+I2cStatus Mpu9250Fifo::configure(II2cBackend &bus, uint8_t addr, uint32_t rateHz, uint32_t nowUs)
+{
+    _addr = addr;
+    if (rateHz == 0)
+        rateHz = 1;
+    uint32_t div = (kInternalHz + rateHz / 2) / rateHz;
+    div = div < 1 ? 1 : div > 256 ? 256 : div;
+
+    // FIFO off while the rate and ranges change, then reset and on
+    const uint8_t writes[][2] = {
+        {kFifoEn, 0},
+        {kUserCtrl, 0},
+        {kConfig, kDlpf184Hz}, // FIFO_MODE = 0: a full FIFO overwrites, the overflow flag tells us
+        {kSmplrtDiv, (uint8_t)(div - 1)},
+        {kGyroConfig, kGyroFs2000},
+        {kAccelConfig, kAccelFs16g},
+        {kAccelConfig2, kDlpf184Hz},
+        {kIntEnable, kFifoOflowInt},
+    };
+    for (const auto &w : writes)
+    {
+        const I2cStatus st = writeReg(bus, w[0], w[1]);
+        if (st != I2cStatus::Ok)
+        {
+            _stats.errors++;
+            return st;
+        }
+    }
+    const I2cStatus st = reset(bus);
+    if (st != I2cStatus::Ok)
+        return st;
+    _rateHz = kInternalHz / div;
+    resetStats(nowUs);
+    return I2cStatus::Ok;
+}
+
+I2cStatus Mpu9250Fifo::reset(II2cBackend &bus)
+{
+    uint8_t status;
+    I2cStatus st = writeReg(bus, kFifoEn, 0);
+    if (st == I2cStatus::Ok)
+        st = writeReg(bus, kUserCtrl, kUserFifoRst);
+    if (st == I2cStatus::Ok)
+        st = readReg(bus, kIntStatus, &status, 1); // clears a stale overflow flag
+    if (st == I2cStatus::Ok)
+        st = writeReg(bus, kUserCtrl, kUserFifoEn);
+    if (st == I2cStatus::Ok)
+        st = writeReg(bus, kFifoEn, kFifoAccelGyro);
+    if (st != I2cStatus::Ok)
+        _stats.errors++;
+    return st;
+}
+
+I2cStatus Mpu9250Fifo::restart(II2cBackend &bus)
+{
+    const I2cStatus st = reset(bus);
+    if (st == I2cStatus::Ok)
+        _stats.restarts++;
+    return st;
+}
+
+I2cStatus Mpu9250Fifo::drain(II2cBackend &bus, ImuRawSample *out, size_t max, size_t &n)
+{
+    n = 0;
+    uint8_t status;
+    uint8_t count[2];
+    I2cStatus st = readReg(bus, kIntStatus, &status, 1);
+    if (st == I2cStatus::Ok)
+        st = readReg(bus, kFifoCountH, count, 2);
+    if (st != I2cStatus::Ok)
+    {
+        _stats.errors++;
+        return st;
+    }
+    _stats.drains++;
+
+    if (status & kFifoOflowInt)
+    {
+        // The oldest bytes were overwritten: frame boundaries are gone, start over
+        _stats.overflows++;
+        _stats.lost += MPU9250_FIFO_FRAMES;
+        return reset(bus);
+    }
+
+    size_t frames = (((size_t)(count[0] & 0x1F) << 8) | count[1]) / MPU9250_FIFO_FRAME;
+    if (frames > max)
+        frames = max;
+    while (n < frames)
+    {
+        size_t chunk = (frames - n) * MPU9250_FIFO_FRAME;
+        if (chunk > sizeof(_chunk))
+            chunk = sizeof(_chunk);
+        st = readReg(bus, kFifoRW, _chunk, chunk);
+        if (st != I2cStatus::Ok)
+        {
+            _stats.errors++;
+            break;
+        }
+        for (size_t off = 0; off < chunk; off += MPU9250_FIFO_FRAME)
+            parse(_chunk + off, out[n++]);
+    }
+
+    _stats.samples += (uint32_t)n;
+    if (n > _stats.max_batch)
+        _stats.max_batch = (uint16_t)n;
+    return st;
+}
+
+void Mpu9250Fifo::parse(const uint8_t *frame, ImuRawSample &out)
+{
+    // Register order: ACCEL_XOUT_H .. ACCEL_ZOUT_L, then GYRO_XOUT_H .. GYRO_ZOUT_L
+    for (int i = 0; i < 3; ++i)
+    {
+        out.accel[i] = be16(frame + 2 * i);
+        out.gyro[i] = be16(frame + 6 + 2 * i);
+    }
+}
+
+uint32_t Mpu9250Fifo::effectiveHz(uint32_t nowUs) const
+{
+    const uint32_t elapsed = nowUs - _stats.since_us;
+    return elapsed ? (uint32_t)((uint64_t)_stats.samples * 1000000u / elapsed) : 0;
+}
+
+void Mpu9250Fifo::resetStats(uint32_t nowUs)
+{
+    _stats = Stats{};
+    _stats.since_us = nowUs;
+}
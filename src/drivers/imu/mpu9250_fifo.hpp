@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * @file mpu9250_fifo.hpp
+ * @brief MPU9250 accel + gyro FIFO: the sensor samples at up to 1 kHz on its own clock and
+ * the host drains everything that piled up in a few burst reads.
+ *
+ * Polling the registers once per tick reads one sample and misses everything the sensor
+ * measured in between; each read is also several small transactions. In FIFO mode the
+ * MPU9250 pushes a 12 byte frame (accel XYZ, gyro XYZ, big endian) per internal sample
+ * into its 512 byte FIFO. drain() reads INT_STATUS and FIFO_COUNT, then the whole
+ * frames in chunks of MPU9250_FIFO_READ_CHUNK bytes (the Wire buffer limit), so nothing
+ * is lost as long as the host drains within MPU9250_FIFO_FRAMES sample periods.
+ *
+ * If it doesn't, the FIFO overflows: the sensor overwrites the oldest bytes and frames lose
+ * their alignment, so drain() counts the overflow and resets the FIFO instead of parsing.
+ *
+ * Talks to the sensor through an II2cBackend (the bus task's, inside an exclusive job);
+ * the magnetometer and the library's own setup are left alone. Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "drivers/i2c/i2c_transaction_queue.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef MPU9250_FIFO_READ_CHUNK
+#define MPU9250_FIFO_READ_CHUNK 120 // bytes per burst read, whole frames, <= the 128 byte Wire buffer
+#endif
+
+static constexpr size_t MPU9250_FIFO_BYTES = 512;
+static constexpr size_t MPU9250_FIFO_FRAME = 12; // accel XYZ + gyro XYZ, int16 big endian
+static constexpr size_t MPU9250_FIFO_FRAMES = MPU9250_FIFO_BYTES / MPU9250_FIFO_FRAME; // 42
+
+static_assert(MPU9250_FIFO_READ_CHUNK >= MPU9250_FIFO_FRAME, "MPU9250_FIFO_READ_CHUNK must hold a frame");
+
+/// One FIFO frame in sensor counts (see Mpu9250Fifo::kAccelLsbPerG / kGyroLsbPerDps).
+struct ImuRawSample
+{
+    int16_t accel[3];
+    int16_t gyro[3];
+};
+
+class Mpu9250Fifo
+{
+public:
+    // Full scale set by configure(): ±16 g, ±2000 deg/s (the MPU9250 library's defaults)
+    static constexpr float kAccelLsbPerG = 2048.0f;
+    static constexpr float kGyroLsbPerDps = 16.4f;
+
+    struct Stats
+    {
+        uint32_t drains;       ///< drain() calls that reached the sensor
+        uint32_t samples;      ///< Frames read
+        uint32_t overflows;    ///< FIFO overflowed between drains (then reset)
+        uint32_t lost;         ///< Frames lost to overflows, at least (a full FIFO's worth each)
+        uint32_t restarts;     ///< Resets without an overflow being counted (restart())
+        uint32_t errors;       ///< Bus errors
+        uint16_t max_batch;    ///< Most frames in one drain
+        uint32_t since_us;     ///< Start of the stats window
+    };
+
+    /**
+     * @brief Set the internal sample rate (1 kHz / n, DLPF 184 Hz), full scale, and start the
+     * FIFO with accel + gyro. @return Ok; rateHz() is what the divider allows.
+     */
+    I2cStatus configure(II2cBackend &bus, uint8_t addr, uint32_t rateHz, uint32_t nowUs);
+
+    /// Throw away what's queued (e.g. after not draining for a while) without counting an overflow.
+    I2cStatus restart(II2cBackend &bus);
+
+    /**
+     * @brief Read every whole frame in the FIFO, at most @p max (the rest stays for the next drain).
+     * @param n Frames written to @p out, oldest first.
+     */
+    I2cStatus drain(II2cBackend &bus, ImuRawSample *out, size_t max, size_t &n);
+
+    uint32_t rateHz() const { return _rateHz; }
+    bool configured() const { return _rateHz != 0; }
+
+    const Stats &stats() const { return _stats; }
+
+    /// Frames read per second of the stats window (what the sensor really delivered).
+    uint32_t effectiveHz(uint32_t nowUs) const;
+
+    void resetStats(uint32_t nowUs);
+
+    /// Decode one 12 byte frame.
+    static void parse(const uint8_t *frame, ImuRawSample &out);
+
+private:
+    I2cStatus writeReg(II2cBackend &bus, uint8_t reg, uint8_t value);
+    I2cStatus readReg(II2cBackend &bus, uint8_t reg, uint8_t *rx, size_t len);
+    I2cStatus reset(II2cBackend &bus);
+
+    uint8_t _addr{0x68};
+    uint32_t _rateHz{0};
+    Stats _stats{};
+    uint8_t _chunk[MPU9250_FIFO_READ_CHUNK - MPU9250_FIFO_READ_CHUNK % MPU9250_FIFO_FRAME]{};
+};
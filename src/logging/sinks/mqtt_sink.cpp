@@ -88,7 +88,13 @@ size_t MqttSink::json_escape(char *out, size_t cap, const char *in, size_t len)
 
 void MqttSink::write(const LogRecord &r)
 {
-    if (!_svc.mqttConnected())
+    const MqttService::OfflinePolicy offline =
+        (r.level != LogLevel::None && r.level >= _offlineMinLevel)
+            ? MqttService::OfflinePolicy::Fifo
+            : MqttService::OfflinePolicy::Drop;
+
+    // Skip formatting work for records that would be dropped anyway
+    if (offline == MqttService::OfflinePolicy::Drop && !_svc.mqttConnected())
     {
         _dropped++;
         return;
@@ -154,7 +160,15 @@ void MqttSink::write(const LogRecord &r)
     }
 
     // ---- publish (non-blocking) ----
-    if (!_svc.publishRel(topic, json, (size_t)jl, (MqttService::QoS)_qos, _retain))
+    const MqttService::PublishStatus st =
+        _svc.tryPublishRel(topic, json, (size_t)jl, (MqttService::QoS)_qos, _retain, offline);
+    if (st == MqttService::PublishStatus::Backpressure)
+    {
+        // Never wait here: the logger task must keep draining
+        _backpressured++;
+        _dropped++;
+    }
+    else if (st == MqttService::PublishStatus::Disconnected)
     {
         _dropped++;
     }
@@ -8,22 +8,30 @@ public:
     // Publishes to "<channel>/<level?>" where:
     //   channel = r.channel if set, otherwise baseTopic
     //   level   = omitted if r.level == LogLevel::None
+    // While offline, records at or above `offlineMinLevel` are kept in the
+    // MqttService outbox (FIFO) and sent after reconnect; the rest are dropped.
+    // Level-less records (e.g. pings) are never buffered.
     MqttSink(
         MqttService::MqttService &svc,
         const char *baseTopic = "log",
         uint8_t qos = 0,
-        bool retain = false)
-        : _svc(svc), _base(baseTopic), _qos(qos), _retain(retain) {}
+        bool retain = false,
+        LogLevel offlineMinLevel = LogLevel::Info)
+        : _svc(svc), _base(baseTopic), _qos(qos), _retain(retain), _offlineMinLevel(offlineMinLevel) {}
 
     void write(const LogRecord &r) override;
     uint32_t droppedPublishes() const { return _dropped; }
+    // Subset of drops caused by MQTT flow control (in-flight window / TCP buffer) rather than the link
+    uint32_t backpressuredPublishes() const { return _backpressured; }
 
 private:
     MqttService::MqttService &_svc;
     const char *_base;
     uint8_t _qos;
     bool _retain;
+    LogLevel _offlineMinLevel;
     uint32_t _dropped = 0;
+    uint32_t _backpressured = 0;
 
     static const char *level_str(LogLevel l);
     static size_t json_escape(char *out, size_t out_cap, const char *in, size_t in_len);
@@ -5,11 +5,14 @@
 
 #include "services/mqtt_service.hpp"
 #include "services/telemetry_service.hpp"
+#include "services/blackbox_service.hpp"
 #include "telemetry/sensors/imu_mpu_9250.hpp"
 
 #include "drivers/esc/pwm.hpp"
 #include "drivers/dc/dc_motor_driver.hpp"
 
+#include "control/actuator_command.hpp"
+
 #include "secrets.hpp"
 #include <cmath>
 #include <algorithm>
@@ -17,7 +20,11 @@
 // ===== Config =================================================================
 static const char *DEVICE_ID = "guspet24";
 static const char *SERVO_TOPIC = "servo";
-static const char *MOTOR_TOPIC = "motor";
+static const char *MOTOR_TOPIC = "motor";                // ASCII, kept for debugging
+static const char *ACTUATOR_CMD_TOPIC = "cmd/actuators"; // binary ActuatorCommand frames
+static constexpr uint8_t CMD_CH_MOTOR = 0;               // [-1, 1]
+static constexpr uint8_t CMD_CH_SERVO = 1;               // [0, 1]
+static constexpr bool MQTT_PERSISTENT_SESSION = false;   // broker keeps subscriptions across outages (no resubscribe)
 
 static const uint8_t SERVO_PIN = 32;
 static const float SERVO_LOW = 0.25f;
@@ -27,7 +34,18 @@ static const uint8_t MOTOR_IN_2 = 25;
 static const float MOTOR_DEADBAND = 0.3f; // below this value, motor is set to 0
 
 static constexpr uint32_t IMU_RATE = 100; // Hz (lower rates may cause problems)
-static constexpr size_t TELEMETRY_QUEUE_LEN = 64;
+static constexpr uint32_t IMU_FIFO_HZ = 1000; // MPU9250 internal rate, drained IMU_RATE times a second; 0 = poll
+static constexpr int IMU_DRDY_PIN = -1;       // GPIO wired to the MPU9250 INT pin: sample on data-ready; -1 = timer
+static constexpr AhrsAlgorithm IMU_FUSION = AhrsAlgorithm::Mahony; // or Madgwick
+static constexpr bool IMU_RAW_STREAM = false; // raw accel + gyro blocks on telemetry/imu_raw (also imu/raw on/off)
+static constexpr TelemetryContentType IMU_ENCODING = TelemetryContentType::JSON; // or CBOR / BINARY (7 bytes) / DELTA (5-11 bytes)
+static constexpr size_t TELEMETRY_QUEUE_LEN = 64; // Bulk depth, capped at its share of the payload pool
+static constexpr UBaseType_t CMD_DISPATCH_PRIO = 10; // above telemetry TX, below IMU sampling
+static constexpr uint16_t UDP_TELEMETRY_PORT = 0;    // != 0: IMU over UDP to tools/udp_telemetry_rx.py on the broker host
+static constexpr uint32_t TELEMETRY_BUNDLE_MS = 0;   // != 0: bundle live streams, split with tools/telemetry_bundle_rx.py
+static constexpr uint32_t I2C_CLOCK_HZ = 400000;     // up to 1 MHz if every device on the bus supports Fm+
+static constexpr bool BLACKBOX_RECORD_ON_BOOT = false; // else "start" on <device>/blackbox/cmd or "bb start" on serial
+static constexpr uint32_t BLACKBOX_CONTROL_HZ = 500;  // control loop frames in the blackbox
 // ==============================================================================
 
 // ===== Hardware ===============================================================
@@ -38,27 +56,27 @@ static volatile float MotorTarget = 0.0f;
 static volatile float ServoTarget = 0.5f;
 
 static IMU_MPU9250 imu(
-    /*i2cMutex*/ nullptr, /*rateHz*/ IMU_RATE,
-    /*topicSuffix*/ "telemetry/imu");
+    /*bus*/ &I2cBus::instance(), /*rateHz*/ IMU_RATE,
+    /*topicSuffix*/ "telemetry/imu", /*encoding*/ IMU_ENCODING);
 //  ==============================================================================
 
-static void onMotorUpdate(MqttService::Message msg)
-{
-  // copy the payload to a null-terminated buffer, to ensure mqtt can't mess with it
-  char buf[16];
-  strncpy(buf, reinterpret_cast<const char *>(msg.payload), std::min<size_t>(15, msg.len));
-  buf[std::min<size_t>(15, msg.len)] = '\0';
+static ActuatorCommandDecoder CommandDecoder;
 
-  LOGI("MOTOR", "Received motor update: %s", buf);
-  float val = atof(buf);
+// Blackbox schema 2: control loop setpoints as applied (IMU attitude is schema 1)
+static const PackedField CONTROL_FIELDS[] = {
+    {"motor", PackedType::I16, 10000.0f},
+    {"servo", PackedType::U16, 10000.0f},
+};
+static const PackedSchema CONTROL_SCHEMA{2, CONTROL_FIELDS, 2};
 
-  // Validation
+// ===== Setpoint validation (shared by ASCII and binary paths) =================
+static bool applyMotor(float val)
+{
   if (isnan(val) || val < -1.0f || val > 1.0f)
   {
     LOGW("MOTOR", "Invalid motor value: %f", val);
-    return;
+    return false;
   }
-  LOGI("MOTOR", "Motor target: %f", val);
 
   if (abs(val) < MOTOR_DEADBAND)
   {
@@ -66,28 +84,66 @@ static void onMotorUpdate(MqttService::Message msg)
   }
 
   MotorTarget = val;
+  return true;
 }
 
-static void onServoUpdate(MqttService::Message msg)
+static bool applyServo(float val)
 {
+  if (isnan(val) || val < 0.0f || val > 1.0f)
+  {
+    LOGW("SERVO", "Invalid servo value: %f", val);
+    return false;
+  }
+
+  // Clamp to safe range
+  ServoTarget = std::max(SERVO_LOW, std::min(SERVO_HIGH, val));
+  return true;
+}
+
+// ===== ASCII topics (debugging) ===============================================
+static float parseAscii(const MqttService::Message &msg)
+{
+  // copy the payload to a null-terminated buffer, to ensure mqtt can't mess with it
   char buf[16];
   strncpy(buf, reinterpret_cast<const char *>(msg.payload), std::min<size_t>(15, msg.len));
   buf[std::min<size_t>(15, msg.len)] = '\0';
+  return atof(buf);
+}
 
-  float val = atof(buf);
+static void onMotorUpdate(MqttService::Message msg)
+{
+  float val = parseAscii(msg);
+  if (applyMotor(val))
+  {
+    LOGD("MOTOR", "Motor target: %f", val);
+  }
+}
 
-  // Validation
-  if (isnan(val) || val < 0.0f || val > 1.0f)
+static void onServoUpdate(MqttService::Message msg)
+{
+  float val = parseAscii(msg);
+  if (applyServo(val))
   {
-    LOGW("SERVO", "Invalid servo value: %f", val);
-    return;
+    LOGD("SERVO", "Servo target: %f", val);
   }
-  LOGI("SERVO", "Servo target: %f", val);
+}
 
-  // Clamp to safe range
-  val = std::max(SERVO_LOW, std::min(SERVO_HIGH, val));
+// ===== Binary command channel =================================================
+static void onActuatorCommand(MqttService::Message msg)
+{
+  ActuatorCommand cmd;
+  const ActuatorCommandStatus st = CommandDecoder.decode(msg.payload, msg.len, millis(), cmd);
+  if (st != ActuatorCommandStatus::Ok)
+  {
+    // Rejections are counted by the decoder; don't flood the log link
+    LOGD("CMD", "Rejected actuator frame, status=%u", (unsigned)st);
+    return;
+  }
 
-  ServoTarget = val;
+  if (cmd.channel_count > CMD_CH_MOTOR)
+    applyMotor(cmd.setpoint[CMD_CH_MOTOR]);
+  if (cmd.channel_count > CMD_CH_SERVO)
+    applyServo(cmd.setpoint[CMD_CH_SERVO]);
 }
 
 void setup()
@@ -118,21 +174,54 @@ void setup()
 
   // ===== Setup MQTT Client ====================================================
   mqtt.setServer(secrets::mqtt_broker, secrets::mqtt_port);
+  mqtt.setCleanSession(!MQTT_PERSISTENT_SESSION);
   LOGI("BOOT", "Starting, ip=%s", WiFi.localIP().toString().c_str());
   mqtt.begin(secrets::wifi_ssid, secrets::wifi_password, DEVICE_ID);
-  mqtt.subscribeRel(MOTOR_TOPIC, /*QoS*/ MqttService::QoS::ExactlyOnce, onMotorUpdate);
-  mqtt.subscribeRel(SERVO_TOPIC, /*QoS*/ MqttService::QoS::ExactlyOnce, onServoUpdate);
+  // Command handlers run on the dispatch task, not on the network task; setpoints keep only the latest value.
+  // A kept session would have the broker queue QoS1/2 setpoints through an outage and replay a stale one.
+  const MqttService::QoS setpointQos = MQTT_PERSISTENT_SESSION ? MqttService::QoS::AtMostOnce : MqttService::QoS::ExactlyOnce;
+  mqtt.subscribeRel(MOTOR_TOPIC, setpointQos, onMotorUpdate, MqttService::Delivery::Latest);
+  mqtt.subscribeRel(SERVO_TOPIC, setpointQos, onServoUpdate, MqttService::Delivery::Latest);
+  // Setpoints are latest-value data: QoS0, ordering/staleness is enforced by the frame itself
+  mqtt.subscribeRel(ACTUATOR_CMD_TOPIC, /*QoS*/ MqttService::QoS::AtMostOnce, onActuatorCommand, MqttService::Delivery::Latest);
+  mqtt.beginDispatch(/*prio*/ CMD_DISPATCH_PRIO, /*stackWords*/ 4096, /*core*/ tskNO_AFFINITY);
 
   // ===== Hardware interface initialization ====================================
-  Wire.begin(); // Initialize I2C bus
+  I2cBus::instance().begin(Wire, I2C_CLOCK_HZ); // bus task owns Wire from here on
+
+  // ===== Blackbox (full-rate log on LittleFS) =================================
+  auto &blackbox = BlackboxService::instance();
+  if (blackbox.begin())
+  {
+    blackbox.attachMqtt(mqtt);
+    blackbox.addSchema(&CONTROL_SCHEMA, "control");
+  }
 
   // ===== Setup Telemetry Service ==============================================
   auto &telem = TelemetryService::instance();
+  // UDP routes first: the TX task started by begin() reads them without locking
+  if (UDP_TELEMETRY_PORT != 0 && telem.beginUdp(secrets::mqtt_broker, UDP_TELEMETRY_PORT))
+  {
+    telem.routeUdp("telemetry/imu");
+  }
   telem.begin(
       DEVICE_ID, /*queueLen=*/TELEMETRY_QUEUE_LEN,
       /*txPrio=*/5, /*txStackWords=*/4096, /*txCore=*/tskNO_AFFINITY);
-  imu.setI2CMutex(telem.i2cMutex());
-  telem.addProvider(&imu);
+  telem.attachMqtt(mqtt); // ground clients switch streams on/off on telemetry/ctl
+  if (TELEMETRY_BUNDLE_MS != 0)
+  {
+    telem.enableBundling(TELEMETRY_BUNDLE_MS);
+  }
+  imu.setFifoRate(IMU_FIFO_HZ);
+  imu.setDataReadyPin(IMU_DRDY_PIN);
+  imu.setFusion(IMU_FUSION);
+  imu.setRawStream(IMU_RAW_STREAM);
+  telem.addProvider(&imu, TelemetryRateLimits{/*minHz*/ 25, /*maxHz*/ IMU_RATE, /*priority*/ 0}); // fusion needs >= 25 Hz
+  imu.attachMqtt(mqtt); // calibration commands on imu/cal, stored calibration already loaded by begin()
+  if (BLACKBOX_RECORD_ON_BOOT)
+  {
+    blackbox.start(); // after the providers registered their schemas
+  }
 
   // ===== Setup Motor & Servo ===================================================
   Motor.arm(true);
@@ -173,5 +262,14 @@ void loop()
     Motor.writeSigned(MotorTarget); // signed for direction control
   }
   Servo.writeNormalized(ServoTarget);
+
+  static uint32_t lastBlackboxUs = 0;
+  const uint32_t now = micros();
+  if (now - lastBlackboxUs >= 1000000u / BLACKBOX_CONTROL_HZ)
+  {
+    lastBlackboxUs = now;
+    const float control[2] = {MotorTarget, ServoTarget};
+    BlackboxService::instance().recordPacked(CONTROL_SCHEMA, control, now); // RAM copy only, never waits for flash
+  }
   delayMicroseconds(500); // ~2kHz
 }
\ No newline at end of file
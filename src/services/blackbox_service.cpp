@@ -0,0 +1,490 @@
+// blackbox_service.cpp
+#include "blackbox_service.hpp"
+#include "logging/logger.hpp"
+
+#include <LittleFS.h>
+#include <cstdarg> // va_list
+#include <cstdio>  // snprintf
+#include <cstdlib> // atoi
+#include <cstring>
+
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
+
+namespace
+{
+    bool g_onLittleFs = false; // default storage: check free space on the partition
+}
+
+BlackboxService &BlackboxService::instance()
+{
+    static BlackboxService inst;
+    return inst;
+}
+
+bool BlackboxService::begin(IBlackboxStorage *storage, Stream *serial)
+{
+    if (_task)
+        return true;
+
+    if (!storage)
+    {
+        if (!LittleFS.begin(/*formatOnFail*/ true))
+        {
+            LOGE("Blackbox", "LittleFS mount failed");
+            return false;
+        }
+        static FileBlackboxStorage flash(BLACKBOX_DIR);
+        storage = &flash;
+        g_onLittleFs = true;
+    }
+    if (!storage->begin())
+    {
+        LOGE("Blackbox", "Storage not available");
+        return false;
+    }
+    _storage = storage;
+    _serial = serial;
+
+    if (xTaskCreatePinnedToCore(&_writerThunk, "Blackbox", BLACKBOX_TASK_STACK, this, BLACKBOX_TASK_PRIO, &_task,
+                                tskNO_AFFINITY) != pdPASS)
+    {
+        LOGE("Blackbox", "Failed to create writer task");
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void BlackboxService::attachMqtt(MqttService::MqttService &mqtt)
+{
+    _mqtt = &mqtt;
+    mqtt.subscribeRel(
+        BLACKBOX_CMD_TOPIC, MqttService::QoS::AtLeastOnce,
+        [this](const MqttService::Message &msg)
+        {
+            portENTER_CRITICAL(&_mux);
+            const size_t n = msg.len < sizeof(_cmd) - 1 ? msg.len : sizeof(_cmd) - 1;
+            memcpy(_cmd, msg.payload, n);
+            _cmd[n] = '\0';
+            _cmdPending = true;
+            portEXIT_CRITICAL(&_mux);
+            if (_task)
+                xTaskNotifyGive(_task);
+        },
+        MqttService::Delivery::Queued);
+}
+
+bool BlackboxService::addSchema(const PackedSchema *schema, const char *name)
+{
+    if (!schema || _schemaCount >= BLACKBOX_MAX_SCHEMAS)
+        return false;
+    for (size_t i = 0; i < _schemaCount; ++i)
+    {
+        if (_schemas[i].schema->id == schema->id)
+            return _schemas[i].schema == schema; // same schema twice is fine, a clashing ID isn't
+    }
+    _schemas[_schemaCount++] = Schema{schema, name};
+    return true;
+}
+
+bool BlackboxService::start()
+{
+    if (!_task)
+        return false;
+    _startReq.store(true);
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+void BlackboxService::stop()
+{
+    if (!_task)
+        return;
+    _stopReq.store(true);
+    xTaskNotifyGive(_task);
+}
+
+bool BlackboxService::record(const uint8_t *payload, size_t len, uint32_t tUs)
+{
+    if (!_recording.load(std::memory_order_relaxed))
+        return false;
+
+    portENTER_CRITICAL(&_mux);
+    const uint32_t sealedBefore = _stager.stats().blocks;
+    const bool ok = _stager.append(tUs, payload, len);
+    const bool sealed = _stager.stats().blocks != sealedBefore;
+    portEXIT_CRITICAL(&_mux);
+
+    if (sealed)
+        xTaskNotifyGive(_task); // a sector is ready for flash
+    return ok;
+}
+
+bool BlackboxService::recordPacked(const PackedSchema &schema, const float *values, uint32_t tUs)
+{
+    if (!recording())
+        return false;
+
+    uint8_t buf[BLACKBOX_FRAME_MAX];
+    PackedBufWriter w(buf, sizeof(buf), &schema);
+    w.beginObject();
+    for (uint8_t i = 0; i < schema.count; ++i)
+    {
+        w.key(schema.fields[i].name);
+        w.value(values[i]);
+    }
+    w.endObject();
+
+    const uint8_t *out;
+    size_t len;
+    return w.finalize(out, len) && record(out, len, tUs);
+}
+
+BlackboxService::Stats BlackboxService::stats() const
+{
+    Stats s{};
+    portENTER_CRITICAL(&_mux);
+    s.staging = _stager.stats();
+    portEXIT_CRITICAL(&_mux);
+    s.blocks_written = _blocksWritten;
+    s.write_errors = _writeErrors;
+    s.write_max_us = _writeMaxUs;
+    s.log_bytes = _logBytes;
+    return s;
+}
+
+// ===== Writer task =============================================================
+
+void BlackboxService::_writerThunk(void *arg)
+{
+    static_cast<BlackboxService *>(arg)->_writerLoop();
+}
+
+void BlackboxService::_writerLoop()
+{
+    for (;;)
+    {
+        // Woken when a block is sealed or a command arrives; the timeout drives the serial poll and flushes
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+        if (_startReq.exchange(false))
+        {
+            if (_logOpen)
+                closeLog();
+            openLog();
+        }
+
+        writeSealed();
+
+        if (_logOpen && BLACKBOX_FLUSH_MS > 0 && millis() - _lastSealMs >= BLACKBOX_FLUSH_MS)
+        {
+            portENTER_CRITICAL(&_mux);
+            _stager.seal(); // padded to a full sector: aligned writes matter more than the space
+            portEXIT_CRITICAL(&_mux);
+            _lastSealMs = millis();
+            writeSealed();
+        }
+
+        if (_logOpen && (_logBytes >= BLACKBOX_MAX_LOG_BYTES || !haveSpace()))
+        {
+            LOGW("Blackbox", "Log %s full (%u bytes), stopping", _logName, (unsigned)_logBytes);
+            closeLog();
+        }
+        if (_stopReq.exchange(false) && _logOpen)
+            closeLog();
+
+        if (_serial)
+            pollSerial();
+
+        char cmd[sizeof(_cmd)];
+        bool pending = false;
+        portENTER_CRITICAL(&_mux);
+        if (_cmdPending)
+        {
+            memcpy(cmd, _cmd, sizeof(cmd));
+            _cmdPending = false;
+            pending = true;
+        }
+        portEXIT_CRITICAL(&_mux);
+        if (pending)
+            runCommand(cmd, /*serial*/ false);
+    }
+}
+
+bool BlackboxService::openLog()
+{
+    // Next free number after the highest existing log
+    unsigned next = 1;
+    char name[32];
+    size_t size;
+    for (size_t i = 0; _storage->entry(i, name, sizeof(name), size); ++i)
+    {
+        const unsigned n = (unsigned)atoi(name);
+        if (n >= next)
+            next = n + 1;
+    }
+    snprintf(_logName, sizeof(_logName), "%04u.bbl", next % 10000);
+    if (!_storage->create(_logName))
+    {
+        LOGE("Blackbox", "Can't create %s", _logName);
+        _logName[0] = '\0';
+        return false;
+    }
+
+    uint8_t def[BLACKBOX_FRAME_MAX];
+    const uint32_t now = (uint32_t)micros();
+    portENTER_CRITICAL(&_mux);
+    _stager.reset();
+    for (size_t i = 0; i < _schemaCount; ++i)
+    {
+        const size_t n = blackboxSchemaFrame(*_schemas[i].schema, _schemas[i].name, def, sizeof(def));
+        if (n)
+            _stager.append(now, def, n);
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    _logBytes = 0;
+    _lastSealMs = millis();
+    _logOpen = true;
+    _recording.store(true);
+    LOGI("Blackbox", "Recording to %s", _logName);
+    publishInfo("{\"event\":\"start\",\"log\":\"%s\"}", _logName);
+    return true;
+}
+
+void BlackboxService::writeSealed()
+{
+    for (;;)
+    {
+        portENTER_CRITICAL(&_mux);
+        const uint8_t *block = _stager.front();
+        portEXIT_CRITICAL(&_mux);
+        if (!block)
+            return;
+
+        // Producers only touch the filling block, so the sealed one is ours until pop()
+        const uint32_t t0 = (uint32_t)micros();
+        const bool ok = _logOpen && _storage->append(block, BLACKBOX_BLOCK_SIZE);
+        const uint32_t dt = (uint32_t)micros() - t0;
+
+        portENTER_CRITICAL(&_mux);
+        _stager.pop();
+        portEXIT_CRITICAL(&_mux);
+
+        if (!ok)
+        {
+            _writeErrors++;
+            if (_logOpen)
+            {
+                LOGE("Blackbox", "Write to %s failed, stopping", _logName);
+                _recording.store(false);
+            }
+            continue;
+        }
+        _blocksWritten++;
+        _logBytes += BLACKBOX_BLOCK_SIZE;
+        _lastSealMs = millis();
+        if (dt > _writeMaxUs)
+            _writeMaxUs = dt;
+    }
+}
+
+void BlackboxService::closeLog()
+{
+    _recording.store(false);
+    portENTER_CRITICAL(&_mux);
+    _stager.seal();
+    portEXIT_CRITICAL(&_mux);
+    writeSealed();
+    _storage->close();
+    _logOpen = false;
+
+    const Stats s = stats();
+    LOGI("Blackbox", "Closed %s: %u bytes, %u frames, %u dropped", _logName, (unsigned)_logBytes,
+         (unsigned)s.staging.frames, (unsigned)s.staging.dropped);
+    publishInfo("{\"event\":\"stop\",\"log\":\"%s\",\"bytes\":%u,\"frames\":%u,\"dropped\":%u,"
+                "\"write_max_us\":%u}",
+                _logName, (unsigned)_logBytes, (unsigned)s.staging.frames, (unsigned)s.staging.dropped,
+                (unsigned)s.write_max_us);
+}
+
+bool BlackboxService::haveSpace() const
+{
+    if (!g_onLittleFs)
+        return true;
+    return LittleFS.totalBytes() - LittleFS.usedBytes() >= BLACKBOX_MIN_FREE_BYTES;
+}
+
+// ===== Retrieval ===============================================================
+
+void BlackboxService::pollSerial()
+{
+    while (_serial->available() > 0)
+    {
+        const int c = _serial->read();
+        if (c < 0)
+            return;
+        if (c == '\r' || c == '\n')
+        {
+            _serialLine[_serialLen] = '\0';
+            if (_serialLen > 3 && strncmp(_serialLine, "bb ", 3) == 0)
+                runCommand(_serialLine + 3, /*serial*/ true);
+            _serialLen = 0;
+        }
+        else if (_serialLen < sizeof(_serialLine) - 1)
+        {
+            _serialLine[_serialLen++] = (char)c;
+        }
+    }
+}
+
+void BlackboxService::runCommand(const char *cmd, bool serial)
+{
+    const char *arg = strchr(cmd, ' ');
+    const size_t verbLen = arg ? (size_t)(arg - cmd) : strlen(cmd);
+    while (arg && *arg == ' ')
+        arg++;
+    auto is = [&](const char *verb)
+    { return strlen(verb) == verbLen && strncmp(cmd, verb, verbLen) == 0; };
+
+    if (is("start"))
+    {
+        if (_logOpen)
+            closeLog();
+        openLog();
+    }
+    else if (is("stop"))
+    {
+        if (_logOpen)
+            closeLog();
+    }
+    else if (is("list"))
+    {
+        listLogs(serial);
+    }
+    else if (is("get") && arg && *arg)
+    {
+        sendFile(arg, serial);
+    }
+    else if (is("rm") && arg && *arg)
+    {
+        const bool busy = _logOpen && strcmp(arg, _logName) == 0;
+        const bool ok = !busy && _storage->remove(arg);
+        publishInfo("{\"event\":\"rm\",\"log\":\"%s\",\"ok\":%s}", arg, ok ? "true" : "false");
+    }
+    else
+    {
+        LOGW("Blackbox", "Unknown command: %s", cmd);
+    }
+}
+
+void BlackboxService::listLogs(bool serial)
+{
+    char msg[512];
+    int pos = snprintf(msg, sizeof(msg), "{\"event\":\"list\",\"recording\":%s,\"log\":\"%s\",\"files\":[",
+                       recording() ? "true" : "false", _logName);
+    char name[32];
+    size_t size;
+    for (size_t i = 0; _storage->entry(i, name, sizeof(name), size); ++i)
+    {
+        if (serial)
+        {
+            char line[64];
+            const int n = snprintf(line, sizeof(line), "BB LIST %s %u\n", name, (unsigned)size);
+            _serial->write(reinterpret_cast<const uint8_t *>(line), (size_t)n);
+        }
+        if (pos > 0 && (size_t)pos < sizeof(msg) - 48)
+            pos += snprintf(msg + pos, sizeof(msg) - pos, "%s{\"name\":\"%s\",\"size\":%u}", i ? "," : "", name,
+                            (unsigned)size);
+    }
+    if (pos > 0 && (size_t)pos < sizeof(msg) - 3)
+    {
+        snprintf(msg + pos, sizeof(msg) - pos, "]}");
+        publishInfo("%s", msg);
+    }
+}
+
+void BlackboxService::sendFile(const char *name, bool serial)
+{
+    static uint8_t chunk[4 + BLACKBOX_CHUNK_BYTES]; // writer task only
+    char topic[48];
+    snprintf(topic, sizeof(topic), "%s/%s", BLACKBOX_DATA_TOPIC, name);
+
+    uint32_t offset = 0;
+    bool ok = true;
+    for (;;)
+    {
+        const size_t n = _storage->read(name, offset, chunk + 4, BLACKBOX_CHUNK_BYTES);
+        if (n == 0)
+            break;
+
+        if (serial)
+        {
+            // "BB <name> <offset> <hex>", one line per BLACKBOX_SERIAL_LINE_BYTES
+            static const char hex[] = "0123456789abcdef";
+            char line[48 + 2 * BLACKBOX_SERIAL_LINE_BYTES];
+            for (size_t i = 0; i < n; i += BLACKBOX_SERIAL_LINE_BYTES)
+            {
+                const size_t m = n - i < BLACKBOX_SERIAL_LINE_BYTES ? n - i : BLACKBOX_SERIAL_LINE_BYTES;
+                int pos = snprintf(line, 48, "BB %s %u ", name, (unsigned)(offset + i));
+                for (size_t j = 0; j < m; ++j)
+                {
+                    line[pos++] = hex[chunk[4 + i + j] >> 4];
+                    line[pos++] = hex[chunk[4 + i + j] & 0x0f];
+                }
+                line[pos++] = '\n';
+                _serial->write(reinterpret_cast<const uint8_t *>(line), (size_t)pos);
+            }
+        }
+        else if (_mqtt)
+        {
+            chunk[0] = (uint8_t)offset;
+            chunk[1] = (uint8_t)(offset >> 8);
+            chunk[2] = (uint8_t)(offset >> 16);
+            chunk[3] = (uint8_t)(offset >> 24);
+            // QoS1 in-flight window paces the transfer; give up after ~2 s of backpressure
+            int waited = 0;
+            while (!_mqtt->publishRel(topic, reinterpret_cast<const char *>(chunk), 4 + n,
+                                      MqttService::QoS::AtLeastOnce))
+            {
+                if (++waited > 200)
+                {
+                    ok = false;
+                    break;
+                }
+                vTaskDelay(pdMS_TO_TICKS(10));
+            }
+            if (!ok)
+                break;
+        }
+        offset += (uint32_t)n;
+        writeSealed(); // keep recording while a log is downloaded
+    }
+
+    if (serial)
+    {
+        char line[64];
+        const int n = snprintf(line, sizeof(line), "BB END %s %u\n", name, (unsigned)offset);
+        _serial->write(reinterpret_cast<const uint8_t *>(line), (size_t)n);
+    }
+    publishInfo("{\"event\":\"get\",\"log\":\"%s\",\"bytes\":%u,\"ok\":%s}", name, (unsigned)offset,
+                ok ? "true" : "false");
+}
+
+void BlackboxService::publishInfo(const char *fmt, ...)
+{
+    if (!_mqtt)
+        return;
+    char msg[512];
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+    if (n <= 0 || (size_t)n >= sizeof(msg))
+        return;
+    _mqtt->publishRel(BLACKBOX_INFO_TOPIC, msg, (size_t)n, MqttService::QoS::AtLeastOnce);
+}
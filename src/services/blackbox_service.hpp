@@ -0,0 +1,176 @@
+#pragma once
+
+/**
+ * @file blackbox_service.hpp
+ * @brief Full-rate flight log on the internal flash filesystem (see telemetry/blackbox_log.hpp).
+ *
+ * Producers (providers, the control loop) call record() with packed samples at full
+ * rate; it copies the frame into a RAM staging block and returns, it never touches
+ * flash. A low-priority writer task appends sealed blocks (one flash sector each) to
+ * `<dir>/NNNN.bbl`. MQTT keeps getting the (decimated) live stream as before.
+ *
+ * Retrieval, on the writer task:
+ * - MQTT: commands on `<device>/` BLACKBOX_CMD_TOPIC, status and listings on
+ *   BLACKBOX_INFO_TOPIC, file contents in chunks on BLACKBOX_DATA_TOPIC `/<name>`
+ *   (u32 offset + bytes).
+ * - Serial: the same commands prefixed with "bb " (e.g. "bb get 0003.bbl"); contents
+ *   come back as "BB <name> <offset> <hex>" lines.
+ * Commands: start, stop, list, get <name>, rm <name>. tools/blackbox_decode.py fetches
+ * over either path and converts logs to CSV.
+ */
+
+#include <atomic>
+#include <Arduino.h>
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
+#include "telemetry/blackbox_log.hpp"
+#include "mqtt_service.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef BLACKBOX_DIR
+#define BLACKBOX_DIR "/littlefs/bb"
+#endif
+
+#ifndef BLACKBOX_MAX_SCHEMAS
+#define BLACKBOX_MAX_SCHEMAS 8
+#endif
+
+#ifndef BLACKBOX_MAX_LOG_BYTES
+#define BLACKBOX_MAX_LOG_BYTES (1024u * 1024u) // per log; recording stops here
+#endif
+
+#ifndef BLACKBOX_MIN_FREE_BYTES
+#define BLACKBOX_MIN_FREE_BYTES (64u * 1024u) // keep headroom for the filesystem itself
+#endif
+
+#ifndef BLACKBOX_FLUSH_MS
+#define BLACKBOX_FLUSH_MS 2000 // seal partial blocks this often (bounds loss on power cut); 0 = only full blocks
+#endif
+
+#ifndef BLACKBOX_TASK_PRIO
+#define BLACKBOX_TASK_PRIO 3 // below telemetry TX: flash writes may take milliseconds
+#endif
+
+#ifndef BLACKBOX_TASK_STACK
+#define BLACKBOX_TASK_STACK 6144
+#endif
+
+#ifndef BLACKBOX_CHUNK_BYTES
+#define BLACKBOX_CHUNK_BYTES 1024 // MQTT retrieval chunk
+#endif
+
+#ifndef BLACKBOX_SERIAL_LINE_BYTES
+#define BLACKBOX_SERIAL_LINE_BYTES 64 // serial retrieval: bytes per hex line
+#endif
+
+#ifndef BLACKBOX_CMD_TOPIC
+#define BLACKBOX_CMD_TOPIC "blackbox/cmd"
+#endif
+
+#ifndef BLACKBOX_INFO_TOPIC
+#define BLACKBOX_INFO_TOPIC "blackbox/info"
+#endif
+
+#ifndef BLACKBOX_DATA_TOPIC
+#define BLACKBOX_DATA_TOPIC "blackbox/data"
+#endif
+
+class BlackboxService
+{
+public:
+    struct Stats
+    {
+        BlackboxStager::Stats staging;
+        uint32_t blocks_written;
+        uint32_t write_errors;
+        uint32_t write_max_us; ///< Slowest sector append
+        uint32_t log_bytes;    ///< Current / last log
+    };
+
+    static BlackboxService &instance();
+
+    /**
+     * @brief Start the writer task on @p storage (nullptr: mount LittleFS and log to BLACKBOX_DIR).
+     * @param serial Polled for "bb ..." commands, nullptr to disable the serial path.
+     */
+    bool begin(IBlackboxStorage *storage = nullptr, Stream *serial = &Serial);
+
+    /// Accept commands on BLACKBOX_CMD_TOPIC. Call after mqtt.begin().
+    void attachMqtt(MqttService::MqttService &mqtt);
+
+    /// Describe a packed schema; written at the start of every log. @p name names the CSV.
+    bool addSchema(const PackedSchema *schema, const char *name);
+
+    /// Open a new log and start recording. Also via the "start" command.
+    bool start();
+    /// Seal, write out and close the current log (asynchronous, on the writer task).
+    void stop();
+
+    bool recording() const { return _recording.load(std::memory_order_relaxed); }
+    const char *currentLog() const { return _logName; }
+
+    /**
+     * @brief Record one packed sample (schema ID first). Never blocks.
+     * @return false if not recording, or dropped because the writer is behind (counted).
+     */
+    bool record(const uint8_t *payload, size_t len, uint32_t tUs);
+    bool record(const uint8_t *payload, size_t len) { return record(payload, len, (uint32_t)micros()); }
+
+    /// Encode @p values (schema field order) with @p schema and record them.
+    bool recordPacked(const PackedSchema &schema, const float *values, uint32_t tUs);
+
+    Stats stats() const;
+
+private:
+    BlackboxService() = default;
+
+    static void _writerThunk(void *arg);
+    void _writerLoop();
+
+    bool openLog();          // writer task
+    void writeSealed();      // writer task
+    void closeLog();         // writer task
+    void pollSerial();       // writer task
+    void runCommand(const char *cmd, bool serial);
+    void publishInfo(const char *fmt, ...);
+    void sendFile(const char *name, bool serial);
+    void listLogs(bool serial);
+    bool haveSpace() const;
+
+    mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    BlackboxStager _stager; // append()/seal()/pop() under _mux; sealed blocks are read by the writer outside it
+
+    IBlackboxStorage *_storage{nullptr};
+    Stream *_serial{nullptr};
+    MqttService::MqttService *_mqtt{nullptr};
+    TaskHandle_t _task{nullptr};
+
+    struct Schema
+    {
+        const PackedSchema *schema;
+        const char *name;
+    };
+    Schema _schemas[BLACKBOX_MAX_SCHEMAS]{};
+    size_t _schemaCount{0};
+
+    std::atomic<bool> _recording{false};
+    std::atomic<bool> _startReq{false};
+    std::atomic<bool> _stopReq{false};
+    bool _logOpen{false}; // writer task
+    char _logName[16]{};
+    uint32_t _logBytes{0};
+    uint32_t _lastSealMs{0};
+
+    // One pending command from MQTT (dispatch task) for the writer task
+    char _cmd[64]{};
+    bool _cmdPending{false}; // under _mux
+    char _serialLine[64]{};
+    size_t _serialLen{0};
+
+    uint32_t _blocksWritten{0};
+    uint32_t _writeErrors{0};
+    uint32_t _writeMaxUs{0};
+};
@@ -0,0 +1,226 @@
+// i2c_bus.cpp
+#include "i2c_bus.hpp"
+#include "logging/logger.hpp"
+
+#include "esp_timer.h" // esp_timer_get_time()
+
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+}
+
+namespace
+{
+    class WireBackend final : public II2cBackend
+    {
+    public:
+        TwoWire *wire{nullptr};
+
+        I2cStatus transfer(uint8_t addr, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) override
+        {
+            if (txLen)
+            {
+                wire->beginTransmission(addr);
+                wire->write(tx, txLen);
+                // Repeated start when a read follows
+                const uint8_t err = wire->endTransmission(rxLen == 0);
+                switch (err)
+                {
+                case 0:
+                    break;
+                case 2: // address NACK
+                case 3: // data NACK
+                    return I2cStatus::Nack;
+                case 5:
+                    return I2cStatus::Timeout;
+                default:
+                    return I2cStatus::BusError;
+                }
+            }
+            if (rxLen)
+            {
+                const size_t n = wire->requestFrom(addr, rxLen, true);
+                if (n != rxLen)
+                    return n == 0 ? I2cStatus::Nack : I2cStatus::Timeout;
+                wire->readBytes(rx, rxLen);
+            }
+            return I2cStatus::Ok;
+        }
+    };
+
+    WireBackend g_backend;
+
+    uint32_t nowUs() { return (uint32_t)esp_timer_get_time(); }
+
+    struct Waiter
+    {
+        SemaphoreHandle_t done;
+        I2cStatus status;
+    };
+}
+
+I2cBus &I2cBus::instance()
+{
+    static I2cBus inst;
+    return inst;
+}
+
+bool I2cBus::begin(TwoWire &wire, uint32_t clockHz, UBaseType_t prio, BaseType_t core)
+{
+    if (_task)
+        return true;
+
+    _clockHz = clockHz > I2C_BUS_MAX_CLOCK_HZ ? I2C_BUS_MAX_CLOCK_HZ : clockHz;
+    _wire = &wire;
+    if (!_wire->begin())
+    {
+        LOGE("I2cBus", "Wire.begin() failed");
+        return false;
+    }
+    _wire->setClock(_clockHz);
+    _wire->setTimeOut(I2C_BUS_TIMEOUT_MS);
+    g_backend.wire = _wire;
+
+    portENTER_CRITICAL(&_mux);
+    _queue.resetStats(nowUs());
+    portEXIT_CRITICAL(&_mux);
+
+    if (xTaskCreatePinnedToCore(&_busThunk, "I2cBus", I2C_BUS_TASK_STACK, this, prio, &_task, core) != pdPASS)
+    {
+        LOGE("I2cBus", "Failed to create bus task");
+        _task = nullptr;
+        return false;
+    }
+    LOGI("I2cBus", "Bus up at %u kHz", (unsigned)(_clockHz / 1000));
+    return true;
+}
+
+I2cStatus I2cBus::submit(const I2cTransaction &t)
+{
+    if (!_task)
+        return I2cStatus::BusError;
+
+    portENTER_CRITICAL(&_mux);
+    const I2cStatus st = _queue.submit(t, nowUs());
+    portEXIT_CRITICAL(&_mux);
+    if (st == I2cStatus::Ok)
+        xTaskNotifyGive(_task);
+    return st;
+}
+
+I2cStatus I2cBus::transfer(const I2cTransaction &t)
+{
+    StaticSemaphore_t buf;
+    Waiter w{xSemaphoreCreateBinaryStatic(&buf), I2cStatus::BusError};
+    I2cTransaction copy = t;
+    copy.waiter = &w;
+
+    const I2cStatus st = submit(copy);
+    if (st != I2cStatus::Ok)
+        return st;
+    // No timeout: the waiter lives on this stack until the bus task has signalled it
+    xSemaphoreTake(w.done, portMAX_DELAY);
+    return w.status;
+}
+
+I2cStatus I2cBus::writeReg(uint8_t addr, uint8_t reg, uint8_t value)
+{
+    const uint8_t data[2] = {reg, value};
+    I2cTransaction t;
+    I2cTransaction::write(t, addr, data, sizeof(data));
+    return transfer(t);
+}
+
+I2cStatus I2cBus::readReg(uint8_t addr, uint8_t reg, uint8_t *rx, size_t len)
+{
+    I2cTransaction t;
+    I2cTransaction::readReg(t, addr, reg, rx, len);
+    return transfer(t);
+}
+
+I2cStatus I2cBus::runExclusive(uint8_t addr, I2cJob job, void *ctx)
+{
+    return transfer(I2cTransaction::exclusive(addr, job, ctx));
+}
+
+II2cBackend &I2cBus::jobBackend()
+{
+    return g_backend;
+}
+
+size_t I2cBus::snapshot(I2cTransactionQueue::Stats &bus, uint8_t &utilPct,
+                        I2cTransactionQueue::DeviceStats *devices, size_t maxDevices, bool reset)
+{
+    const uint32_t now = nowUs();
+    portENTER_CRITICAL(&_mux);
+    bus = _queue.stats();
+    utilPct = _queue.utilizationPct(now);
+    size_t n = _queue.devices() < maxDevices ? _queue.devices() : maxDevices;
+    for (size_t i = 0; i < n; ++i)
+        devices[i] = _queue.device(i);
+    if (reset)
+        _queue.resetStats(now);
+    portEXIT_CRITICAL(&_mux);
+    return n;
+}
+
+const char *I2cBus::statusName(I2cStatus s)
+{
+    switch (s)
+    {
+    case I2cStatus::Ok:
+        return "ok";
+    case I2cStatus::Nack:
+        return "nack";
+    case I2cStatus::Timeout:
+        return "timeout";
+    case I2cStatus::QueueFull:
+        return "queue_full";
+    default:
+        return "bus_error";
+    }
+}
+
+void I2cBus::_busThunk(void *arg)
+{
+    static_cast<I2cBus *>(arg)->_busLoop();
+}
+
+void I2cBus::_busLoop()
+{
+    I2cTransaction t;
+    for (;;)
+    {
+        portENTER_CRITICAL(&_mux);
+        const bool have = _queue.pop(t);
+        portEXIT_CRITICAL(&_mux);
+        if (!have)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // until the next submit()
+            continue;
+        }
+
+        // Back to back: the next transaction is popped as soon as this one is signalled
+        I2cTransactionQueue::execute(t, g_backend, &nowUs);
+
+        portENTER_CRITICAL(&_mux);
+        _queue.record(t);
+        portEXIT_CRITICAL(&_mux);
+
+        if (t.status != I2cStatus::Ok)
+            LOGD("I2cBus", "0x%02x: %s", t.addr, statusName(t.status));
+
+        if (t.done)
+            t.done(t);
+        if (t.notify)
+            xTaskNotify(static_cast<TaskHandle_t>(t.notify), t.notify_bits, eSetBits);
+        if (t.waiter)
+        {
+            Waiter *w = static_cast<Waiter *>(t.waiter);
+            w->status = t.status;
+            xSemaphoreGive(w->done);
+        }
+    }
+}
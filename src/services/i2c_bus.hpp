@@ -0,0 +1,106 @@
+#pragma once
+
+/**
+ * @file i2c_bus.hpp
+ * @brief Asynchronous I2C bus manager: one task owns Wire and runs queued transactions.
+ *
+ * Replaces the global I2C mutex. Providers submit transactions (see
+ * drivers/i2c/i2c_transaction_queue.hpp) and carry on; the bus task runs them back to
+ * back at the configured clock (up to 1 MHz) and completes each through its callback
+ * and/or a task notification. Nobody blocks on a lock held by another sensor, and the
+ * bus is never idle while work is queued. Driver libraries that access Wire themselves
+ * (MPU9250) are submitted as exclusive jobs and run on the bus task too.
+ *
+ * Stats: bus utilization, per-device latency (queue wait + transfer), NACK and timeout
+ * counts; TelemetryService publishes them on TELEMETRY_I2C_TOPIC.
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+}
+#include "drivers/i2c/i2c_transaction_queue.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef I2C_BUS_CLOCK_HZ
+#define I2C_BUS_CLOCK_HZ 400000 // MPU9250 is specified for 400 kHz fast mode
+#endif
+
+#ifndef I2C_BUS_MAX_CLOCK_HZ
+#define I2C_BUS_MAX_CLOCK_HZ 1000000 // fast mode plus
+#endif
+
+#ifndef I2C_BUS_TIMEOUT_MS
+#define I2C_BUS_TIMEOUT_MS 10 // per transfer, a stuck device can't hold the bus longer
+#endif
+
+#ifndef I2C_BUS_TASK_PRIO
+#define I2C_BUS_TASK_PRIO 19 // just above the sampling task that feeds it
+#endif
+
+#ifndef I2C_BUS_TASK_STACK
+#define I2C_BUS_TASK_STACK 6144 // completion callbacks encode samples on this stack
+#endif
+
+class I2cBus
+{
+public:
+    static I2cBus &instance();
+
+    /**
+     * @brief Start @p wire at @p clockHz (clamped to I2C_BUS_MAX_CLOCK_HZ) and the bus task.
+     * From here on only the bus task touches @p wire.
+     */
+    bool begin(TwoWire &wire = Wire, uint32_t clockHz = I2C_BUS_CLOCK_HZ,
+               UBaseType_t prio = I2C_BUS_TASK_PRIO, BaseType_t core = tskNO_AFFINITY);
+
+    bool started() const { return _task != nullptr; }
+    uint32_t clockHz() const { return _clockHz; }
+
+    /**
+     * @brief Queue @p t without waiting. Its `done` callback (on the bus task) and/or
+     * `notify` task (bits `notify_bits` set) are signalled on completion.
+     * @return Ok, or QueueFull (nothing will be signalled).
+     */
+    I2cStatus submit(const I2cTransaction &t);
+
+    /**
+     * @brief Submit and wait for completion; for setup code and slow paths.
+     * Bounded by the queue ahead and I2C_BUS_TIMEOUT_MS per transfer, not by a lock.
+     * @note Don't call from the bus task (i.e. from a completion callback or job).
+     */
+    I2cStatus transfer(const I2cTransaction &t);
+
+    I2cStatus writeReg(uint8_t addr, uint8_t reg, uint8_t value);
+    I2cStatus readReg(uint8_t addr, uint8_t reg, uint8_t *rx, size_t len);
+
+    /// Run @p job with exclusive bus access and wait for it (driver library setup).
+    I2cStatus runExclusive(uint8_t addr, I2cJob job, void *ctx);
+
+    /// Transfers on the bus task's Wire, for jobs that talk to registers themselves. Only inside a job.
+    II2cBackend &jobBackend();
+
+    /**
+     * @brief Copy the bus and per-device stats of the current window, then start a new one.
+     * @return Number of devices written to @p devices (up to @p maxDevices).
+     */
+    size_t snapshot(I2cTransactionQueue::Stats &bus, uint8_t &utilPct,
+                    I2cTransactionQueue::DeviceStats *devices, size_t maxDevices, bool reset = true);
+
+    static const char *statusName(I2cStatus s);
+
+private:
+    I2cBus() = default;
+
+    static void _busThunk(void *arg);
+    void _busLoop();
+
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    I2cTransactionQueue _queue; // submit()/pop()/stats under _mux; run() on the bus task
+    TwoWire *_wire{nullptr};
+    uint32_t _clockHz{0};
+    TaskHandle_t _task{nullptr};
+};
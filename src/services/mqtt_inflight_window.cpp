@@ -0,0 +1,155 @@
+#include "mqtt_inflight_window.hpp"
+
+namespace MqttService
+{
+    void InFlightWindow::setWindow(uint8_t qos, uint8_t window)
+    {
+        if (qos == 0 || qos > 2)
+            return; // QoS0 has no acks to wait for
+        _window[qos] = window > MQTT_INFLIGHT_MAX ? MQTT_INFLIGHT_MAX : window;
+    }
+
+    int InFlightWindow::reserve(uint8_t qos, uint32_t nowUs)
+    {
+        if (qos == 0 || qos > 2)
+            return -1;
+        if (_count[qos] >= _window[qos])
+            expire(nowUs); // maybe some acks are never coming
+        if (_count[qos] < _window[qos])
+        {
+            for (int i = 0; i < MQTT_INFLIGHT_MAX; ++i)
+            {
+                if (!_slots[i].used)
+                {
+                    _slots[i] = Slot{true, false, qos, 0, nowUs};
+                    _count[qos]++;
+                    _unassigned++;
+                    return i;
+                }
+            }
+        }
+        _stats.window_full++;
+        return -1;
+    }
+
+    bool InFlightWindow::assign(int slot, uint16_t id)
+    {
+        if (slot < 0 || slot >= MQTT_INFLIGHT_MAX || !_slots[slot].used || _slots[slot].id != 0)
+            return false;
+        if (_slots[slot].orphaned)
+        {
+            release(slot); // the connection dropped meanwhile, already counted as abandoned
+            return false;
+        }
+        _unassigned--;
+        _slots[slot].id = id;
+
+        bool done = false;
+        for (uint8_t i = 0; i < _earlyCount; ++i)
+        {
+            if (_early[i].id == id)
+            {
+                complete(slot, _early[i].at_us, true);
+                _early[i] = _early[--_earlyCount];
+                done = true;
+                break;
+            }
+        }
+        settleEarlyAcks();
+        return done;
+    }
+
+    void InFlightWindow::release(int slot)
+    {
+        if (slot < 0 || slot >= MQTT_INFLIGHT_MAX || !_slots[slot].used)
+            return;
+        if (_slots[slot].id == 0 && !_slots[slot].orphaned)
+            _unassigned--;
+        _count[_slots[slot].qos]--;
+        _slots[slot].used = false;
+        settleEarlyAcks();
+    }
+
+    void InFlightWindow::ack(uint16_t id, uint32_t nowUs)
+    {
+        for (int i = 0; i < MQTT_INFLIGHT_MAX; ++i)
+        {
+            if (_slots[i].used && _slots[i].id == id)
+            {
+                complete(i, nowUs, false);
+                return;
+            }
+        }
+
+        // A publish still waiting for its id may be this one; keep the ack for assign()
+        if (_unassigned && _earlyCount < MQTT_INFLIGHT_MAX)
+            _early[_earlyCount++] = EarlyAck{id, nowUs};
+        else
+            _stats.unknown++;
+    }
+
+    void InFlightWindow::clear()
+    {
+        for (int i = 0; i < MQTT_INFLIGHT_MAX; ++i)
+        {
+            Slot &f = _slots[i];
+            if (!f.used || f.orphaned)
+                continue;
+            _stats.abandoned++;
+            if (f.id == 0)
+            {
+                f.orphaned = true; // its publish() is still running
+                continue;
+            }
+            f.used = false;
+            _count[f.qos]--;
+        }
+        _unassigned = 0;
+        _stats.unknown += _earlyCount;
+        _earlyCount = 0;
+    }
+
+    void InFlightWindow::complete(int slot, uint32_t ackUs, bool early)
+    {
+        Slot &f = _slots[slot];
+        const uint32_t us = ackUs - f.sent_us;
+        f.used = false;
+        _count[f.qos]--;
+
+        const uint32_t ms = us / 1000u;
+        size_t b = ms ? (size_t)(32 - __builtin_clz(ms)) : 0; // 1->1, 2..3->2, 4..7->3 ...
+        if (b >= AckStats::kBuckets)
+            b = AckStats::kBuckets - 1;
+        _stats.hist[b]++;
+        _stats.acked++;
+        _stats.early += early ? 1 : 0;
+        _stats.latency_sum_us += us;
+        if (us > _stats.latency_max_us)
+            _stats.latency_max_us = us;
+    }
+
+    void InFlightWindow::expire(uint32_t nowUs)
+    {
+        for (int i = 0; i < MQTT_INFLIGHT_MAX; ++i)
+        {
+            Slot &f = _slots[i];
+            // A slot without an id belongs to a publish() still running; it is settled there
+            if (f.used && f.id != 0 && nowUs - f.sent_us > (uint32_t)MQTT_INFLIGHT_TIMEOUT_MS * 1000u)
+            {
+                f.used = false;
+                _count[f.qos]--;
+                _stats.timed_out++;
+            }
+        }
+    }
+
+    void InFlightWindow::settleEarlyAcks()
+    {
+        // Once every slot has its id, parked acks can't belong to anything we sent
+        if (_unassigned == 0 && _earlyCount)
+        {
+            _stats.unknown += _earlyCount;
+            _earlyCount = 0;
+        }
+    }
+} // Namespace MqttService
@@ -0,0 +1,127 @@
+#pragma once
+
+/**
+ * @file mqtt_inflight_window.hpp
+ * @brief Bookkeeping for QoS1/2 publishes awaiting PUBACK/PUBCOMP: per-QoS windows,
+ * ack latency and timeouts.
+ *
+ * A slot is reserved before the packet goes to the client and gets its packet id once
+ * publish() returns it. The ack can beat that: the client may send the packet and the
+ * network task handle the PUBACK before publish() has returned on the publishing task.
+ * Such an ack is parked while any slot is still waiting for its id and matched in
+ * assign(), so it completes the publish instead of counting as unknown and holding
+ * the slot until the timeout.
+ *
+ * Not locked: MqttService calls it under _inflightMux. Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Tunables ===============================================================
+#ifndef MQTT_INFLIGHT_MAX
+#define MQTT_INFLIGHT_MAX 16 // tracked QoS1/2 publishes awaiting PUBACK/PUBCOMP
+#endif
+
+#ifndef MQTT_INFLIGHT_QOS1_WINDOW
+#define MQTT_INFLIGHT_QOS1_WINDOW 8
+#endif
+
+#ifndef MQTT_INFLIGHT_QOS2_WINDOW
+#define MQTT_INFLIGHT_QOS2_WINDOW 4
+#endif
+
+#ifndef MQTT_INFLIGHT_TIMEOUT_MS
+#define MQTT_INFLIGHT_TIMEOUT_MS 5000 // unacked entries older than this are given up on
+#endif
+
+namespace MqttService
+{
+    /**
+     * @brief Publish acknowledgement latency (QoS1/2) and window counters.
+     *
+     * Histogram bucket 0 is < 1 ms, bucket i (i >= 1) is [2^(i-1), 2^i) ms,
+     * the last bucket collects everything above.
+     */
+    struct AckStats
+    {
+        static constexpr size_t kBuckets = 12;
+
+        uint32_t acked;          ///< Acks matched to a tracked publish
+        uint32_t early;          ///< ... of which arrived before publish() returned the id
+        uint32_t unknown;        ///< Acks for ids we weren't tracking
+        uint32_t timed_out;      ///< Entries dropped after MQTT_INFLIGHT_TIMEOUT_MS
+        uint32_t abandoned;      ///< In flight when the connection dropped
+        uint32_t window_full;    ///< Publishes refused by the in-flight window
+        uint32_t client_full;    ///< Publishes refused by the client (TCP buffer)
+        uint32_t latency_max_us;
+        uint64_t latency_sum_us;
+        uint32_t hist[kBuckets];
+    };
+
+    class InFlightWindow
+    {
+    public:
+        /// Max outstanding publishes at @p qos (1 or 2), capped at MQTT_INFLIGHT_MAX.
+        void setWindow(uint8_t qos, uint8_t window);
+        uint8_t count(uint8_t qos) const { return qos < 3 ? _count[qos] : 0; }
+        bool hasRoom(uint8_t qos) const { return qos == 0 || (qos < 3 && _count[qos] < _window[qos]); }
+
+        /**
+         * @brief Take a slot before handing a QoS1/2 publish to the client. Entries past
+         * MQTT_INFLIGHT_TIMEOUT_MS are given up on first if the window is full.
+         * @return Slot index, or -1 if the window is full (counted as window_full).
+         */
+        int reserve(uint8_t qos, uint32_t nowUs);
+
+        /**
+         * @brief The client queued the packet as @p id.
+         * @return true if its ack had already arrived: the publish is complete, the slot free.
+         */
+        bool assign(int slot, uint16_t id);
+
+        /// The client refused the publish: free a reserved slot that never got an id.
+        void release(int slot);
+
+        /// PUBACK (QoS1) or PUBCOMP (QoS2) for @p id.
+        void ack(uint16_t id, uint32_t nowUs);
+
+        /**
+         * @brief Connection dropped: acks for what is in flight will never come. Slots still
+         * waiting for their id stay reserved until their assign()/release(), so a publish()
+         * that straddles the disconnect can't write its id into someone else's slot.
+         */
+        void clear();
+
+        void clientFull() { _stats.client_full++; }
+        const AckStats &stats() const { return _stats; }
+
+    private:
+        struct Slot
+        {
+            bool used;
+            bool orphaned; // cleared while waiting for its id; freed by assign()
+            uint8_t qos;
+            uint16_t id;      // 0 until the client returned a packet id
+            uint32_t sent_us; // low 32 bits of esp_timer time
+        };
+
+        struct EarlyAck
+        {
+            uint16_t id;
+            uint32_t at_us;
+        };
+
+        void complete(int slot, uint32_t ackUs, bool early);
+        void expire(uint32_t nowUs);
+        void settleEarlyAcks();
+
+        Slot _slots[MQTT_INFLIGHT_MAX] = {};
+        EarlyAck _early[MQTT_INFLIGHT_MAX] = {};
+        uint8_t _earlyCount = 0;
+        uint8_t _unassigned = 0; // reserved slots still waiting for their packet id
+        uint8_t _count[3] = {0, 0, 0}; // per QoS
+        uint8_t _window[3] = {0, MQTT_INFLIGHT_QOS1_WINDOW, MQTT_INFLIGHT_QOS2_WINDOW};
+        AckStats _stats{};
+    };
+} // Namespace MqttService
@@ -0,0 +1,115 @@
+#pragma once
+
+/**
+ * @file mqtt_mailbox.hpp
+ * @brief Hand-off of received MQTT messages from the network task to a handler task.
+ *
+ * - LatestMailbox: single-slot, lock-free "latest value" box (seqlock). One producer
+ *   (the MQTT client callback), one consumer (the dispatch task). A new message
+ *   replaces an unread one; the consumer always sees the newest complete copy.
+ * - Queued delivery uses a FreeRTOS queue of MailItem, see MqttService.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// ===== Tunables ===============================================================
+#ifndef MQTT_MAILBOX_TOPIC_MAX
+#define MQTT_MAILBOX_TOPIC_MAX 64 // bytes incl. NUL
+#endif
+
+#ifndef MQTT_MAILBOX_PAYLOAD_MAX
+#define MQTT_MAILBOX_PAYLOAD_MAX 64 // commands are small; larger messages are dropped
+#endif
+
+#ifndef MQTT_MAILBOX_MAX
+#define MQTT_MAILBOX_MAX 8 // subscriptions using deferred delivery
+#endif
+
+#ifndef MQTT_MAILBOX_QUEUE_LEN
+#define MQTT_MAILBOX_QUEUE_LEN 8 // depth per Queued subscription
+#endif
+
+namespace MqttService
+{
+    /// One received message, copied out of the client's buffers.
+    struct MailItem
+    {
+        int64_t rx_us; ///< esp_timer time the message was received
+        uint16_t len;
+        uint8_t qos;
+        bool retain;
+        char topic[MQTT_MAILBOX_TOPIC_MAX];
+        uint8_t payload[MQTT_MAILBOX_PAYLOAD_MAX];
+
+        /// @return false if topic or payload don't fit.
+        bool assign(const char *t, const uint8_t *p, size_t n, uint8_t q, bool r, int64_t now)
+        {
+            const size_t tlen = t ? strnlen(t, MQTT_MAILBOX_TOPIC_MAX) : MQTT_MAILBOX_TOPIC_MAX;
+            if (tlen >= MQTT_MAILBOX_TOPIC_MAX || n > MQTT_MAILBOX_PAYLOAD_MAX)
+                return false;
+            memcpy(topic, t, tlen);
+            topic[tlen] = '\0';
+            if (n)
+                memcpy(payload, p, n);
+            len = (uint16_t)n;
+            qos = q;
+            retain = r;
+            rx_us = now;
+            return true;
+        }
+    };
+
+    class LatestMailbox
+    {
+    public:
+        /**
+         * @brief Producer side. Never blocks.
+         * @return true if an unread value was overwritten.
+         */
+        bool write(const MailItem &item)
+        {
+            const uint32_t s = _seq.load(std::memory_order_relaxed);
+            const bool overwrote = s != _readSeq.load(std::memory_order_relaxed);
+            _seq.store(s + 1, std::memory_order_relaxed); // odd: write in progress
+            std::atomic_thread_fence(std::memory_order_release);
+            _item = item;
+            _seq.store(s + 2, std::memory_order_release);
+            return overwrote;
+        }
+
+        /**
+         * @brief Consumer side. Copies the newest value if it hasn't been read yet.
+         * @return false if nothing new (or a write kept racing the copy; a notify follows it).
+         */
+        bool read(MailItem &out)
+        {
+            for (int attempt = 0; attempt < 4; ++attempt)
+            {
+                const uint32_t s1 = _seq.load(std::memory_order_acquire);
+                if (s1 == _readSeq.load(std::memory_order_relaxed))
+                    return false;
+                if (s1 & 1u)
+                    continue;
+                out = _item;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq.load(std::memory_order_relaxed) == s1)
+                {
+                    _readSeq.store(s1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Consumer side: mark what's there as read, e.g. before the box changes hands.
+        void reset() { _readSeq.store(_seq.load(std::memory_order_acquire) & ~1u, std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint32_t> _seq{0};
+        std::atomic<uint32_t> _readSeq{0};
+        MailItem _item{};
+    };
+} // namespace MqttService
@@ -0,0 +1,243 @@
+#include "mqtt_outbox.hpp"
+
+#include <string.h>
+
+namespace MqttService
+{
+    bool MqttOutbox::put(const char *topic, const uint8_t *payload, size_t len,
+                         uint8_t qos, bool retain, OfflinePolicy policy)
+    {
+        const size_t tlen = topic ? strnlen(topic, MQTT_OUTBOX_TOPIC_MAX) : MQTT_OUTBOX_TOPIC_MAX;
+        if (policy == OfflinePolicy::Drop || tlen == 0 || tlen >= MQTT_OUTBOX_TOPIC_MAX ||
+            len > MQTT_OUTBOX_PAYLOAD_MAX || (len && !payload))
+        {
+            portENTER_CRITICAL(&_mux);
+            _stats.rejected++;
+            portEXIT_CRITICAL(&_mux);
+            return false;
+        }
+
+        if (policy == OfflinePolicy::Coalesce)
+            return putLatest(topic, tlen, payload, len, qos, retain);
+        return putFifo(topic, tlen, payload, len, qos, retain);
+    }
+
+    bool MqttOutbox::putLatest(const char *topic, size_t tlen, const uint8_t *payload, size_t len,
+                               uint8_t qos, bool retain)
+    {
+        portENTER_CRITICAL(&_mux);
+
+        // Same topic already waiting -> overwrite; otherwise take a free slot or evict the oldest.
+        int target = -1;
+        int freeSlot = -1;
+        int oldest = -1;
+        for (int i = 0; i < MQTT_OUTBOX_LATEST_SLOTS; ++i)
+        {
+            Slot &s = _slots[i];
+            if (!s.used)
+            {
+                if (freeSlot < 0)
+                    freeSlot = i;
+                continue;
+            }
+            if (strncmp(s.topic, topic, MQTT_OUTBOX_TOPIC_MAX) == 0)
+            {
+                target = i;
+                break;
+            }
+            if (oldest < 0 || (int32_t)(s.stamp - _slots[oldest].stamp) < 0)
+                oldest = i;
+        }
+
+        if (target >= 0)
+        {
+            _stats.replaced++;
+        }
+        else if (freeSlot >= 0)
+        {
+            target = freeSlot;
+            _slotsUsed++;
+        }
+        else
+        {
+            target = oldest;
+            _stats.evicted++;
+        }
+
+        Slot &s = _slots[target];
+        s.used = true;
+        s.gen++;
+        s.stamp = ++_stampCounter;
+        s.len = (uint16_t)len;
+        s.qos = qos;
+        s.retain = retain;
+        memcpy(s.topic, topic, tlen);
+        s.topic[tlen] = '\0';
+        if (len)
+            memcpy(s.payload, payload, len);
+        _stats.coalesced++;
+
+        portEXIT_CRITICAL(&_mux);
+        return true;
+    }
+
+    bool MqttOutbox::putFifo(const char *topic, size_t tlen, const uint8_t *payload, size_t len,
+                             uint8_t qos, bool retain)
+    {
+        const size_t need = sizeof(RecordHeader) + tlen + len;
+        if (need > MQTT_OUTBOX_FIFO_BYTES)
+        {
+            portENTER_CRITICAL(&_mux);
+            _stats.rejected++;
+            portEXIT_CRITICAL(&_mux);
+            return false;
+        }
+
+        RecordHeader h{};
+        h.topic_len = (uint8_t)tlen;
+        h.qos = qos;
+        h.retain = retain ? 1 : 0;
+        h.payload_len = (uint16_t)len;
+
+        portENTER_CRITICAL(&_mux);
+        while (MQTT_OUTBOX_FIFO_BYTES - _used < need)
+        {
+            ringDropOldest();
+            _stats.evicted++;
+        }
+        ringWrite(&h, sizeof(h));
+        ringWrite(topic, tlen);
+        if (len)
+            ringWrite(payload, len);
+        _stats.queued++;
+        portEXIT_CRITICAL(&_mux);
+        return true;
+    }
+
+    bool MqttOutbox::front(Entry &out, Token &tok)
+    {
+        portENTER_CRITICAL(&_mux);
+
+        // Latest values first: oldest stamp wins so every topic gets a turn.
+        if (_slotsUsed)
+        {
+            int pick = -1;
+            for (int i = 0; i < MQTT_OUTBOX_LATEST_SLOTS; ++i)
+            {
+                if (_slots[i].used && (pick < 0 || (int32_t)(_slots[i].stamp - _slots[pick].stamp) < 0))
+                    pick = i;
+            }
+            const Slot &s = _slots[pick];
+            memcpy(out.topic, s.topic, sizeof(out.topic));
+            memcpy(out.payload, s.payload, s.len);
+            out.len = s.len;
+            out.qos = s.qos;
+            out.retain = s.retain;
+            tok.kind = OfflinePolicy::Coalesce;
+            tok.slot = (uint8_t)pick;
+            tok.gen = s.gen;
+            portEXIT_CRITICAL(&_mux);
+            return true;
+        }
+
+        if (_used)
+        {
+            RecordHeader h{};
+            size_t pos = _tail;
+            ringRead(pos, &h, sizeof(h));
+            pos = (pos + sizeof(h)) % MQTT_OUTBOX_FIFO_BYTES;
+            ringRead(pos, out.topic, h.topic_len);
+            out.topic[h.topic_len] = '\0';
+            pos = (pos + h.topic_len) % MQTT_OUTBOX_FIFO_BYTES;
+            ringRead(pos, out.payload, h.payload_len);
+            out.len = h.payload_len;
+            out.qos = h.qos;
+            out.retain = h.retain != 0;
+            tok.kind = OfflinePolicy::Fifo;
+            tok.slot = 0;
+            tok.gen = _popCount;
+            portEXIT_CRITICAL(&_mux);
+            return true;
+        }
+
+        portEXIT_CRITICAL(&_mux);
+        return false;
+    }
+
+    void MqttOutbox::commit(const Token &tok)
+    {
+        portENTER_CRITICAL(&_mux);
+        if (tok.kind == OfflinePolicy::Coalesce)
+        {
+            Slot &s = _slots[tok.slot];
+            // A newer value arrived while we were sending the old one: keep it
+            if (s.used && s.gen == tok.gen)
+            {
+                s.used = false;
+                _slotsUsed--;
+                _stats.drained++;
+            }
+        }
+        else if (tok.kind == OfflinePolicy::Fifo)
+        {
+            // Record already evicted by a producer if the pop counter moved
+            if (_used && _popCount == tok.gen)
+            {
+                ringDropOldest();
+                _stats.drained++;
+            }
+        }
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    bool MqttOutbox::hasPending(OfflinePolicy policy) const
+    {
+        portENTER_CRITICAL(&_mux);
+        bool pending = false;
+        if (policy == OfflinePolicy::Coalesce)
+            pending = _slotsUsed != 0;
+        else if (policy == OfflinePolicy::Fifo)
+            pending = _used != 0;
+        portEXIT_CRITICAL(&_mux);
+        return pending;
+    }
+
+    MqttOutbox::Stats MqttOutbox::stats() const
+    {
+        portENTER_CRITICAL(&_mux);
+        Stats s = _stats;
+        portEXIT_CRITICAL(&_mux);
+        return s;
+    }
+
+    // ===== Byte ring ==========================================================
+    void MqttOutbox::ringWrite(const void *src, size_t n)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(src);
+        const size_t first = (n < MQTT_OUTBOX_FIFO_BYTES - _head) ? n : (MQTT_OUTBOX_FIFO_BYTES - _head);
+        memcpy(&_ring[_head], p, first);
+        if (n > first)
+            memcpy(&_ring[0], p + first, n - first);
+        _head = (_head + n) % MQTT_OUTBOX_FIFO_BYTES;
+        _used += n;
+    }
+
+    void MqttOutbox::ringRead(size_t pos, void *dst, size_t n) const
+    {
+        uint8_t *p = static_cast<uint8_t *>(dst);
+        const size_t first = (n < MQTT_OUTBOX_FIFO_BYTES - pos) ? n : (MQTT_OUTBOX_FIFO_BYTES - pos);
+        memcpy(p, &_ring[pos], first);
+        if (n > first)
+            memcpy(p + first, &_ring[0], n - first);
+    }
+
+    void MqttOutbox::ringDropOldest()
+    {
+        RecordHeader h{};
+        ringRead(_tail, &h, sizeof(h));
+        const size_t n = sizeof(h) + h.topic_len + h.payload_len;
+        _tail = (_tail + n) % MQTT_OUTBOX_FIFO_BYTES;
+        _used -= n;
+        _popCount++;
+    }
+} // namespace MqttService
@@ -0,0 +1,163 @@
+#pragma once
+
+/**
+ * @file mqtt_outbox.hpp
+ * @brief Bounded store-and-forward buffer for MQTT publishes made while offline.
+ *
+ * Two storage classes share one outbox:
+ * - Coalesce: keeps only the latest payload per topic (state streams such as
+ *   IMU attitude or status). A newer value for the same topic replaces the old one.
+ * - Fifo: keeps every message in order in a byte ring (event streams such as logs).
+ *   When the ring is full the oldest records are evicted to make room.
+ *
+ * All storage is static; nothing is allocated after construction. The outbox is
+ * safe to use from multiple producer tasks and a single draining task.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+extern "C"
+{
+#include "freertos/FreeRTOS.h"
+}
+
+// ===== Tunables ===============================================================
+#ifndef MQTT_OUTBOX_TOPIC_MAX
+#define MQTT_OUTBOX_TOPIC_MAX 64 // bytes incl. NUL
+#endif
+
+#ifndef MQTT_OUTBOX_PAYLOAD_MAX
+#define MQTT_OUTBOX_PAYLOAD_MAX 256 // bytes per message
+#endif
+
+#ifndef MQTT_OUTBOX_LATEST_SLOTS
+#define MQTT_OUTBOX_LATEST_SLOTS 8 // distinct coalesced topics
+#endif
+
+#ifndef MQTT_OUTBOX_FIFO_BYTES
+#define MQTT_OUTBOX_FIFO_BYTES 8192 // ring capacity for FIFO records (incl. headers)
+#endif
+
+#ifndef MQTT_OUTBOX_DRAIN_PERIOD_MS
+#define MQTT_OUTBOX_DRAIN_PERIOD_MS 20 // drain tick after (re)connect
+#endif
+
+#ifndef MQTT_OUTBOX_DRAIN_BURST
+#define MQTT_OUTBOX_DRAIN_BURST 4 // max publishes per drain tick
+#endif
+
+static_assert(MQTT_OUTBOX_TOPIC_MAX <= 256, "topic length is stored in a uint8_t");
+static_assert(MQTT_OUTBOX_PAYLOAD_MAX <= 65535, "payload length is stored in a uint16_t");
+
+namespace MqttService
+{
+    /**
+     * @brief What to do with a publish that cannot be sent right now.
+     */
+    enum class OfflinePolicy : uint8_t
+    {
+        Drop = 0,     ///< Lose it (previous behavior)
+        Coalesce = 1, ///< Keep only the latest value per topic
+        Fifo = 2      ///< Keep every message in order, evicting the oldest when full
+    };
+
+    class MqttOutbox
+    {
+    public:
+        struct Entry
+        {
+            char topic[MQTT_OUTBOX_TOPIC_MAX];
+            uint8_t payload[MQTT_OUTBOX_PAYLOAD_MAX];
+            uint16_t len;
+            uint8_t qos;
+            bool retain;
+        };
+
+        /// Identifies the entry returned by front() so commit() only removes that one.
+        struct Token
+        {
+            OfflinePolicy kind{OfflinePolicy::Drop};
+            uint8_t slot{0};
+            uint32_t gen{0};
+        };
+
+        struct Stats
+        {
+            uint32_t coalesced; ///< Coalesce puts (incl. overwrites)
+            uint32_t replaced;  ///< Coalesced values overwritten before being sent
+            uint32_t queued;    ///< Fifo puts
+            uint32_t evicted;   ///< Entries dropped to make room (oldest first)
+            uint32_t rejected;  ///< Puts refused (too large / Drop policy)
+            uint32_t drained;   ///< Entries handed back out via commit()
+        };
+
+        MqttOutbox() = default;
+
+        /**
+         * @brief Store a message according to @p policy.
+         * @return false if the message was not stored (Drop policy, oversize topic/payload).
+         */
+        bool put(const char *topic, const uint8_t *payload, size_t len,
+                 uint8_t qos, bool retain, OfflinePolicy policy);
+
+        /**
+         * @brief Copy the next entry to send into @p out without removing it.
+         *
+         * Coalesced values are returned before FIFO records so the freshest
+         * state goes out first after a reconnect.
+         */
+        bool front(Entry &out, Token &tok);
+
+        /// Remove the entry described by @p tok, unless a producer already replaced or evicted it.
+        void commit(const Token &tok);
+
+        /// @return true if anything stored under @p policy is waiting.
+        bool hasPending(OfflinePolicy policy) const;
+        bool empty() const { return !hasPending(OfflinePolicy::Coalesce) && !hasPending(OfflinePolicy::Fifo); }
+
+        Stats stats() const;
+
+    private:
+        struct Slot
+        {
+            bool used;
+            uint32_t gen;   // bumped on every overwrite
+            uint32_t stamp; // insertion order, for oldest-slot eviction
+            uint16_t len;
+            uint8_t qos;
+            bool retain;
+            char topic[MQTT_OUTBOX_TOPIC_MAX];
+            uint8_t payload[MQTT_OUTBOX_PAYLOAD_MAX];
+        };
+
+        struct RecordHeader
+        {
+            uint8_t topic_len; // excl. NUL
+            uint8_t qos;
+            uint8_t retain;
+            uint8_t reserved;
+            uint16_t payload_len;
+        };
+
+        bool putLatest(const char *topic, size_t tlen, const uint8_t *payload, size_t len, uint8_t qos, bool retain);
+        bool putFifo(const char *topic, size_t tlen, const uint8_t *payload, size_t len, uint8_t qos, bool retain);
+
+        // Byte ring helpers (caller holds _mux)
+        void ringWrite(const void *src, size_t n);
+        void ringRead(size_t pos, void *dst, size_t n) const;
+        void ringDropOldest();
+
+        Slot _slots[MQTT_OUTBOX_LATEST_SLOTS] = {};
+        uint8_t _slotsUsed = 0;
+        uint32_t _stampCounter = 0;
+
+        uint8_t _ring[MQTT_OUTBOX_FIFO_BYTES] = {};
+        size_t _head = 0;       // write position
+        size_t _tail = 0;       // oldest record
+        size_t _used = 0;       // bytes in ring
+        uint32_t _popCount = 0; // records removed from the tail (evict or commit)
+
+        Stats _stats{};
+        mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    };
+} // namespace MqttService
@@ -1,6 +1,12 @@
 #include "mqtt_service.hpp"
 #include "logging/logger.hpp"
 
+extern "C"
+{
+#include "esp_timer.h"  // esp_timer_get_time()
+#include "esp_system.h" // esp_random()
+}
+
 namespace MqttService
 {
 
@@ -13,43 +19,54 @@ namespace MqttService
 
     MqttService::MqttService()
     {
-        // Create one-shot timers (2s delay) for reconnects
+        // One-shot reconnect timers; the period is set per attempt by scheduleReconnect()
         _mqttReconnectTimer = xTimerCreate(
             "mqttTimer",
-            pdMS_TO_TICKS(2000),
+            pdMS_TO_TICKS(MQTT_RECONNECT_MIN_MS),
             pdFALSE,
             this,
             &MqttService::mqttTimerCbStatic);
         _wifiReconnectTimer = xTimerCreate(
             "wifiTimer",
-            pdMS_TO_TICKS(2000),
+            pdMS_TO_TICKS(WIFI_RECONNECT_MIN_MS),
             pdFALSE,
             this,
             &MqttService::wifiTimerCbStatic);
+        // Periodic drain of the store-and-forward outbox, only runs while something is pending
+        _outboxTimer = xTimerCreate(
+            "mqttOutbox",
+            pdMS_TO_TICKS(MQTT_OUTBOX_DRAIN_PERIOD_MS),
+            pdTRUE,
+            this,
+            &MqttService::outboxTimerCbStatic);
 
         // Hook WiFi events
         WiFi.onEvent(&MqttService::wifiEventStatic);
 
-        // Hook MQTT events
-        _mqttClient.onConnect(
+        _transport->setCleanSession(_cleanSession);
+        hookTransport();
+    }
+
+    void MqttService::hookTransport()
+    {
+        _transport->onConnect(
             [this](bool sp)
             { this->onMqttConnect(sp); });
-        _mqttClient.onDisconnect(
-            [this](AsyncMqttClientDisconnectReason reason)
+        _transport->onDisconnect(
+            [this](uint8_t reason)
             { this->onMqttDisconnect(reason); });
-        _mqttClient.onSubscribe(
+        _transport->onSubscribe(
             [this](uint16_t id, uint8_t qos)
             { this->onMqttSubscribe(id, (QoS)qos); });
-        _mqttClient.onUnsubscribe(
+        _transport->onUnsubscribe(
             [this](uint16_t id)
             { this->onMqttUnsubscribe(id); });
-        _mqttClient.onMessage(
+        _transport->onMessage(
             [this](
-                char *topic, char *payload,
-                AsyncMqttClientMessageProperties props,
-                size_t len, size_t index, size_t total)
-            { this->onMqttMessage(Message{topic, reinterpret_cast<uint8_t *>(payload), len, props}, index, total); });
-        _mqttClient.onPublish(
+                const char *topic, const uint8_t *payload, size_t len,
+                const MqttMessageProperties &props, size_t index, size_t total)
+            { this->onMqttMessage(Message{topic, payload, len, props}, index, total); });
+        _transport->onPublish(
             [this](uint16_t id)
             { this->onMqttPublish(id); });
     }
@@ -59,7 +76,38 @@ namespace MqttService
     {
         _mqttHost = host;
         _mqttPort = port;
-        _mqttClient.setServer(_mqttHost, _mqttPort);
+        _asyncTransport.setServer(_mqttHost, _mqttPort);
+    }
+
+    void MqttService::setTransport(IMqttTransport *transport)
+    {
+        IMqttTransport *next = transport ? transport : &_asyncTransport;
+        if (next == _transport)
+            return;
+
+        // Unhook before disconnecting: the old client must not deliver anything to us any more,
+        // not even its own disconnect, so nothing from it can race the new one's events.
+        _transport->clearCallbacks();
+        if (_transport->connected())
+            _transport->disconnect();
+
+        // What onMqttDisconnect() would have done for the old connection
+        xTimerStop(_outboxTimer, 0);
+        portENTER_CRITICAL(&_inflightMux);
+        _inflight.clear();
+        portEXIT_CRITICAL(&_inflightMux);
+        _session.forget(); // a different client, a different broker session
+
+        _transport = next;
+        _transport->setCleanSession(_cleanSession);
+        hookTransport();
+    }
+
+    void MqttService::setCleanSession(bool clean)
+    {
+        _cleanSession = clean;
+        _session.setCleanSession(clean);
+        _transport->setCleanSession(clean);
     }
 
     void MqttService::begin(const char *wifiSsid, const char *wifiPassword, const char *deviceId,
@@ -96,103 +144,203 @@ namespace MqttService
 
     void MqttService::connectMqtt()
     {
-        if (_mqttHost == IPAddress() || _mqttPort == 0)
+        if (!_transport->configured())
         {
             LOGE("MqttService", "MQTT server not set. Call setServer() or pass host/port to begin().");
             return;
         }
-        if (_mqttClient.connected())
+        if (_transport->connected())
             return;
         LOGI("MqttService", "Connecting to MQTT %s:%u…", _mqttHost.toString().c_str(), _mqttPort);
-        _mqttClient.connect();
+        _transport->connect();
     }
 
     void MqttService::disconnectMqtt()
     {
-        if (_mqttClient.connected())
+        if (_transport->connected())
         {
             LOGI("MqttService", "Disconnecting MQTT…");
-            _mqttClient.disconnect();
+            _transport->disconnect();
         }
     }
 
     bool MqttService::publish(
         Topic topic, const char *payload,
-        QoS qos, bool retain)
+        QoS qos, bool retain, OfflinePolicy offline)
     {
-        if (!_mqttClient.connected())
-            return false;
-        uint16_t id = _mqttClient.publish(topic, (uint8_t)qos, retain, payload);
-        return id != 0;
+        return publish(topic, payload, payload ? strlen(payload) : 0, qos, retain, offline);
     }
 
     bool MqttService::publish(
         Topic topic, const char *payload, size_t len,
-        QoS qos, bool retain)
+        QoS qos, bool retain, OfflinePolicy offline)
     {
-        if (!_mqttClient.connected())
-            return false;
-        uint16_t id = _mqttClient.publish(topic, (uint8_t)qos, retain, payload, len);
-        return id != 0;
+        const PublishStatus st = tryPublish(topic, payload, len, qos, retain, offline);
+        return st == PublishStatus::Sent || st == PublishStatus::Buffered;
     }
 
-    bool MqttService::subscribe(Topic topic, QoS qos)
+    PublishStatus MqttService::tryPublish(
+        Topic topic, const char *payload, size_t len,
+        QoS qos, bool retain, OfflinePolicy offline)
     {
-        // Keep a persistent copy for future resubscribe
-        _subs.push_back(Sub{String(topic), qos, nullptr});
-        if (!_mqttClient.connected())
+        const bool connected = _transport->connected();
+        PublishStatus st = connected ? PublishStatus::Backpressure : PublishStatus::Disconnected;
+
+        // Go direct unless older messages of the same class are still buffered,
+        // in which case queue behind them to keep ordering (and coalescing) intact.
+        if (connected && (offline == OfflinePolicy::Drop || !_outbox.hasPending(offline)))
         {
-            LOGW("MqttService", "Queued sub '%s' not yet connected", topic);
-            return true; // Queued
+            st = sendNow(topic, payload, len, qos, retain);
+            if (st == PublishStatus::Sent)
+                return st;
         }
-        uint16_t id = _mqttClient.subscribe(topic, (uint8_t)qos);
-        return id != 0;
+
+        if (offline == OfflinePolicy::Drop)
+            return st;
+
+        if (!_outbox.put(topic, reinterpret_cast<const uint8_t *>(payload), len, (uint8_t)qos, retain, offline))
+            return st;
+        if (connected)
+            startOutboxDrain();
+        return PublishStatus::Buffered;
     }
 
-    bool MqttService::subscribe(Topic topic, QoS qos, MessageCallback cb)
+    PublishStatus MqttService::sendNow(Topic topic, const char *payload, size_t len, QoS qos, bool retain)
     {
-        _subs.push_back(Sub{String(topic), qos, std::move(cb)});
-        if (!_mqttClient.connected())
+        const uint8_t q = (uint8_t)qos;
+        int slot = -1;
+        if (q > 0)
         {
-            LOGW("MqttService", "Queued sub '%s' with message callback, not yet connected", topic);
-            return true; // Queued
+            portENTER_CRITICAL(&_inflightMux);
+            slot = _inflight.reserve(q, (uint32_t)esp_timer_get_time());
+            portEXIT_CRITICAL(&_inflightMux);
+            if (slot < 0)
+                return PublishStatus::Backpressure;
+        }
+
+        // The ack may be handled on the client task before this returns; the window keeps it for assign()
+        const uint16_t id = _transport->publish(topic, q, retain, payload, len);
+        if (id == 0)
+        {
+            portENTER_CRITICAL(&_inflightMux);
+            _inflight.release(slot);
+            _inflight.clientFull();
+            portEXIT_CRITICAL(&_inflightMux);
+            return PublishStatus::Backpressure;
         }
-        uint16_t id = _mqttClient.subscribe(topic, (uint8_t)qos);
-        return id != 0;
+
+        if (slot >= 0)
+        {
+            portENTER_CRITICAL(&_inflightMux);
+            _inflight.assign(slot, id);
+            portEXIT_CRITICAL(&_inflightMux);
+        }
+        return PublishStatus::Sent;
     }
 
-    void MqttService::resubscribeAll()
+    // ===== In-flight window =====
+    void MqttService::setMaxInFlight(QoS qos, uint8_t window)
     {
-        for (const auto &sub : _subs)
+        portENTER_CRITICAL(&_inflightMux);
+        _inflight.setWindow((uint8_t)qos, window);
+        portEXIT_CRITICAL(&_inflightMux);
+    }
+
+    uint8_t MqttService::inFlight(QoS qos) const
+    {
+        portENTER_CRITICAL(&_inflightMux);
+        const uint8_t n = _inflight.count((uint8_t)qos);
+        portEXIT_CRITICAL(&_inflightMux);
+        return n;
+    }
+
+    bool MqttService::canPublish(QoS qos) const
+    {
+        if (!_transport->connected())
+            return false;
+        portENTER_CRITICAL(&_inflightMux);
+        const bool ok = _inflight.hasRoom((uint8_t)qos);
+        portEXIT_CRITICAL(&_inflightMux);
+        return ok;
+    }
+
+    AckStats MqttService::ackStats() const
+    {
+        portENTER_CRITICAL(&_inflightMux);
+        AckStats s = _inflight.stats();
+        portEXIT_CRITICAL(&_inflightMux);
+        return s;
+    }
+
+    void MqttService::startOutboxDrain()
+    {
+        if (_outboxTimer && xTimerIsTimerActive(_outboxTimer) == pdFALSE)
+            xTimerStart(_outboxTimer, 0);
+    }
+
+    void MqttService::drainOutbox()
+    {
+        for (int i = 0; i < MQTT_OUTBOX_DRAIN_BURST; ++i)
         {
-            uint16_t id = _mqttClient.subscribe(sub.topic.c_str(), (uint8_t)sub.qos);
-            LOGI("MqttService", "(Re)subscribe '%s' qos=%u -> id=%u",
-                 sub.topic.c_str(), sub.qos, id);
+            MqttOutbox::Token tok;
+            if (!_transport->connected() || !_outbox.front(_drainEntry, tok))
+            {
+                xTimerStop(_outboxTimer, 0); // restarted on next connect / store
+                return;
+            }
+
+            const PublishStatus st = sendNow(
+                _drainEntry.topic, reinterpret_cast<const char *>(_drainEntry.payload), _drainEntry.len,
+                (QoS)_drainEntry.qos, _drainEntry.retain);
+            if (st != PublishStatus::Sent)
+                return; // window or client buffer full, retry next tick
+
+            _outbox.commit(tok);
         }
     }
 
+    bool MqttService::subscribe(Topic topic, QoS qos)
+    {
+        // Keep a persistent copy for future resubscribe
+        _subs.push_back(Sub{String(topic), nullptr});
+        if (!_transport->connected())
+            LOGW("MqttService", "Queued sub '%s' not yet connected", topic);
+        return _session.add(*_transport, topic, (uint8_t)qos);
+    }
+
+    bool MqttService::subscribe(Topic topic, QoS qos, MessageCallback cb, Delivery delivery)
+    {
+        int8_t mailbox = -1;
+        if (delivery != Delivery::Inline)
+        {
+            mailbox = allocMailbox(delivery, cb);
+            if (mailbox < 0)
+            {
+                LOGE("MqttService", "No mailbox for '%s' (max %d), delivering inline", topic, MQTT_MAILBOX_MAX);
+            }
+        }
+
+        _subs.push_back(Sub{String(topic), std::move(cb), mailbox});
+        if (!_transport->connected())
+            LOGW("MqttService", "Queued sub '%s' with message callback, not yet connected", topic);
+        return _session.add(*_transport, topic, (uint8_t)qos);
+    }
+
     bool MqttService::unsubscribe(const char *topic)
     {
         auto it = std::find_if(
             _subs.begin(), _subs.end(),
             [topic](const Sub &s)
             { return s.topic == topic; });
-        if (it != _subs.end())
-        {
-            String t = it->topic; // keep a copy for the broker call
-            _subs.erase(it);
-            if (_mqttClient.connected())
-            {
-                uint16_t id = _mqttClient.unsubscribe(t.c_str());
-                return id != 0;
-            }
-            return false;
-        }
-        else
+        if (it == _subs.end())
         {
             LOGW("MqttService", "Attempted to unsubscribe from non-subscribed topic: %s", topic);
             return false;
         }
+        if (it->mailbox >= 0)
+            _mailboxes[it->mailbox].active = false; // free for the next subscribe(), see allocMailbox()
+        _subs.erase(it);
+        return _session.remove(*_transport, topic);
     }
 
     void MqttService::onMessage(MessageCallback cb)
@@ -200,6 +348,143 @@ namespace MqttService
         _appMsgCb = std::move(cb);
     }
 
+    // ===== Deferred delivery =====
+    bool MqttService::beginDispatch(UBaseType_t prio, uint32_t stackWords, BaseType_t core)
+    {
+        if (_dispatchTask)
+            return true;
+        const BaseType_t ok = xTaskCreatePinnedToCore(
+            &MqttService::dispatchTaskStatic, "MqttDispatch", stackWords, this, prio, &_dispatchTask, core);
+        if (ok != pdPASS)
+        {
+            LOGE("MqttService", "Failed to create dispatch task");
+            _dispatchTask = nullptr;
+            return false;
+        }
+        xTaskNotifyGive(_dispatchTask); // pick up anything received before we started
+        return true;
+    }
+
+    int8_t MqttService::allocMailbox(Delivery mode, MessageCallback cb)
+    {
+        // A slot freed by unsubscribe() first. The dispatch task scans without locking: it
+        // marks a slot busy before it checks active, so an inactive slot it isn't busy with
+        // stays untouched until active is set again.
+        uint8_t i = 0;
+        while (i < _mailboxCount && (_mailboxes[i].active || _mailboxes[i].busy))
+            ++i;
+        if (i >= MQTT_MAILBOX_MAX)
+            return -1;
+
+        Mailbox &mb = _mailboxes[i];
+        if (mode == Delivery::Queued)
+        {
+            if (mb.queue)
+                xQueueReset(mb.queue); // what the previous subscriber left unread
+            else
+                mb.queue = xQueueCreate(MQTT_MAILBOX_QUEUE_LEN, sizeof(MailItem));
+            if (!mb.queue)
+                return -1;
+        }
+        mb.latest.reset();
+        mb.mode = mode;
+        mb.cb = std::move(cb);
+        mb.stats = DeliveryStats{};
+        mb.active = true;
+        if (i == _mailboxCount)
+            _mailboxCount++;
+        return (int8_t)i;
+    }
+
+    bool MqttService::postToMailbox(Mailbox &mb, const Message &msg)
+    {
+        if (!_rxItem.assign(msg.topic, msg.payload, msg.len, msg.props.qos, msg.props.retain, esp_timer_get_time()))
+        {
+            mb.stats.dropped++;
+            return false;
+        }
+
+        if (mb.mode == Delivery::Latest)
+        {
+            if (mb.latest.write(_rxItem))
+                mb.stats.overwritten++;
+        }
+        else if (xQueueSend(mb.queue, &_rxItem, 0) != pdTRUE)
+        {
+            mb.stats.dropped++;
+            return false;
+        }
+
+        if (_dispatchTask)
+            xTaskNotifyGive(_dispatchTask);
+        return true;
+    }
+
+    void MqttService::deliver(Mailbox &mb, const MailItem &item)
+    {
+        MqttMessageProperties props{};
+        props.qos = item.qos;
+        props.retain = item.retain;
+        mb.cb(Message{item.topic, item.payload, item.len, props});
+
+        const int64_t dt = esp_timer_get_time() - item.rx_us;
+        const uint32_t us = dt > 0 ? (uint32_t)dt : 0;
+        mb.stats.delivered++;
+        mb.stats.latency_sum_us += us;
+        if (us > mb.stats.latency_max_us)
+            mb.stats.latency_max_us = us;
+    }
+
+    void MqttService::dispatchTaskStatic(void *arg)
+    {
+        static_cast<MqttService *>(arg)->dispatchLoop();
+    }
+
+    void MqttService::dispatchLoop()
+    {
+        for (;;)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+            const uint8_t n = _mailboxCount;
+            for (uint8_t i = 0; i < n; ++i)
+            {
+                Mailbox &mb = _mailboxes[i];
+                mb.busy = true; // before active: allocMailbox() won't reuse the slot meanwhile
+                if (!mb.active || !mb.cb)
+                {
+                    mb.busy = false;
+                    continue;
+                }
+
+                if (mb.mode == Delivery::Latest)
+                {
+                    if (mb.latest.read(_dispatchItem))
+                        deliver(mb, _dispatchItem);
+                }
+                else
+                {
+                    while (xQueueReceive(mb.queue, &_dispatchItem, 0) == pdTRUE)
+                        deliver(mb, _dispatchItem);
+                }
+                mb.busy = false;
+            }
+        }
+    }
+
+    bool MqttService::deliveryStats(Topic filter, DeliveryStats &out) const
+    {
+        for (const auto &sub : _subs)
+        {
+            if (sub.mailbox >= 0 && sub.topic == filter)
+            {
+                out = _mailboxes[sub.mailbox].stats;
+                return true;
+            }
+        }
+        return false;
+    }
+
     // ===== Static shims =====
     void MqttService::wifiEventStatic(WiFiEvent_t event)
     {
@@ -209,15 +494,30 @@ namespace MqttService
     void MqttService::mqttTimerCbStatic(TimerHandle_t t)
     {
         auto *self = static_cast<MqttService *>(pvTimerGetTimerID(t));
-        if (self)
-            self->connectMqtt();
+        if (!self)
+            return;
+        portENTER_CRITICAL(&self->_recoveryMux);
+        self->_recovery.attempt();
+        portEXIT_CRITICAL(&self->_recoveryMux);
+        self->connectMqtt();
     }
 
     void MqttService::wifiTimerCbStatic(TimerHandle_t t)
+    {
+        auto *self = static_cast<MqttService *>(pvTimerGetTimerID(t));
+        if (!self)
+            return;
+        portENTER_CRITICAL(&self->_recoveryMux);
+        self->_recovery.attempt();
+        portEXIT_CRITICAL(&self->_recoveryMux);
+        self->connectWifi();
+    }
+
+    void MqttService::outboxTimerCbStatic(TimerHandle_t t)
     {
         auto *self = static_cast<MqttService *>(pvTimerGetTimerID(t));
         if (self)
-            self->connectWifi();
+            self->drainOutbox();
     }
 
     // ===== Event handlers =====
@@ -228,12 +528,19 @@ namespace MqttService
         {
         case SYSTEM_EVENT_STA_GOT_IP:
             LOGI("MqttService", "WiFi Connected. IP: %s", WiFi.localIP().toString().c_str());
+            xTimerStop(_wifiReconnectTimer, 0);
+            _wifiBackoff.reset();
+            portENTER_CRITICAL(&_recoveryMux);
+            _recovery.wifiUp((uint64_t)esp_timer_get_time());
+            portEXIT_CRITICAL(&_recoveryMux);
             connectMqtt();
             break;
         case SYSTEM_EVENT_STA_DISCONNECTED:
+            // Also raised for every failed association attempt, so this paces Wi-Fi retries
             LOGW("MqttService", "WiFi Disconnected.");
+            markLinkDown();
             xTimerStop(_mqttReconnectTimer, 0); // don't race reconnects
-            xTimerStart(_wifiReconnectTimer, 0);
+            scheduleReconnect(_wifiReconnectTimer, _wifiBackoff);
             break;
         default:
             break;
@@ -243,86 +550,114 @@ namespace MqttService
     void MqttService::onMqttConnect(bool sessionPresent)
     {
         LOGI("MqttService", "Connected. sessionPresent=%d", sessionPresent);
-        resubscribeAll(); // Resubscribe to all topics
+        xTimerStop(_mqttReconnectTimer, 0);
+        _mqttBackoff.reset();
+        portENTER_CRITICAL(&_recoveryMux);
+        _recovery.connected((uint64_t)esp_timer_get_time());
+        portEXIT_CRITICAL(&_recoveryMux);
+
+        // A resumed session still holds our filters; only what changed while offline is sent
+        const uint16_t waitId = _session.connected(*_transport, sessionPresent);
+        LOGI("MqttService", "%u/%u filter(s) in session%s", (unsigned)_session.inSession(), (unsigned)_session.size(),
+             waitId ? ", waiting for SUBACK" : "");
+        if (!waitId)
+            finishRecovery(sessionPresent);
+
+        // Flush what was buffered while offline, paced by the drain timer
+        if (!_outbox.empty())
+            startOutboxDrain();
     }
 
-    void MqttService::onMqttDisconnect(AsyncMqttClientDisconnectReason reason)
+    void MqttService::onMqttDisconnect(uint8_t reason)
     {
         LOGI("MqttService", "Disconnected. reason=%d", static_cast<int>(reason));
+        markLinkDown();
+        _session.disconnected();
+        xTimerStop(_outboxTimer, 0);
+        portENTER_CRITICAL(&_inflightMux);
+        _inflight.clear(); // acks for these will never arrive on a new connection
+        portEXIT_CRITICAL(&_inflightMux);
         if (WiFi.isConnected())
         {
-            xTimerStart(_mqttReconnectTimer, 0);
+            scheduleReconnect(_mqttReconnectTimer, _mqttBackoff);
         }
     }
 
     void MqttService::onMqttSubscribe(uint16_t packetId, QoS qos)
     {
-        LOGI("MqttService", "Subscribed. id=%u qos=%u", packetId, qos);
+        (void)qos;
+        if (_session.subscribed(packetId))
+            finishRecovery(false);
     }
 
-    void MqttService::onMqttUnsubscribe(uint16_t packetId)
+    // ===== Reconnect / recovery =====
+    void MqttService::scheduleReconnect(TimerHandle_t timer, ReconnectBackoff &backoff)
     {
-        LOGI("MqttService", "Unsubscribed. id=%u", packetId);
+        const uint32_t ms = backoff.next(esp_random());
+        TickType_t ticks = pdMS_TO_TICKS(ms);
+        if (ticks == 0)
+            ticks = 1;
+        xTimerChangePeriod(timer, ticks, 0); // (re)starts the one-shot timer
     }
 
-    void MqttService::onMqttPublish(uint16_t packetId)
+    void MqttService::markLinkDown()
     {
-        LOGI("MqttService", "Publish ACK. id=%u", packetId);
+        portENTER_CRITICAL(&_recoveryMux);
+        _recovery.linkDown((uint64_t)esp_timer_get_time());
+        portEXIT_CRITICAL(&_recoveryMux);
     }
 
-    static bool segEq(const char *a, size_t alen, const char *b, size_t blen)
+    void MqttService::finishRecovery(bool sessionPresent)
     {
-        return alen == blen && memcmp(a, b, alen) == 0;
+        const uint64_t now = (uint64_t)esp_timer_get_time();
+        portENTER_CRITICAL(&_recoveryMux);
+        const bool recovered = _recovery.ready(now, sessionPresent);
+        const RecoveryStats snap = _recovery.stats();
+        portEXIT_CRITICAL(&_recoveryMux);
+
+        if (recovered)
+            publishRecovery(snap, sessionPresent);
     }
 
-    bool MqttService::topicMatches(const std::string &filter, const char *topic)
+    void MqttService::publishRecovery(const RecoveryStats &s, bool sessionPresent)
     {
-        // MQTT match per spec: filter tokens vs topic tokens
-        const char *f = filter.c_str();
-        const char *t = topic;
-
-        while (*f && *t)
-        {
-            // read next token from filter
-            const char *fstart = f;
-            while (*f && *f != '/')
-                ++f;
-            size_t flen = size_t(f - fstart);
-
-            // read next token from topic
-            const char *tstart = t;
-            while (*t && *t != '/')
-                ++t;
-            size_t tlen = size_t(t - tstart);
-
-            if (flen == 1 && fstart[0] == '+')
-            {
-                // single-level wildcard: always matches this level
-            }
-            else if (flen == 1 && fstart[0] == '#')
-            {
-                // multi-level wildcard: must be last in filter
-                return true;
-            }
-            else if (!segEq(fstart, flen, tstart, tlen))
-            {
-                return false;
-            }
+        char json[200];
+        const int n = snprintf(
+            json, sizeof(json),
+            "{\"ready_ms\":%lu,\"connect_ms\":%lu,\"wifi_ms\":%lu,\"attempts\":%lu,"
+            "\"session\":%s,\"outages\":%lu,\"max_ready_ms\":%lu}",
+            (unsigned long)s.last_ready_ms, (unsigned long)s.last_connect_ms, (unsigned long)s.last_wifi_ms,
+            (unsigned long)s.last_attempts, sessionPresent ? "true" : "false",
+            (unsigned long)s.outages, (unsigned long)s.max_ready_ms);
+        if (n <= 0 || n >= (int)sizeof(json))
+            return;
+        LOGI("MqttService", "Recovered in %lu ms (connect %lu ms, %lu attempts, session=%d)",
+             (unsigned long)s.last_ready_ms, (unsigned long)s.last_connect_ms,
+             (unsigned long)s.last_attempts, sessionPresent);
+        if (_device_id)
+            tryPublishRel(MQTT_RECOVERY_TOPIC, json, (size_t)n, QoS::AtMostOnce, /*retain*/ true);
+    }
 
-            if (*f == '/')
-                ++f;
-            if (*t == '/')
-                ++t;
-        }
+    RecoveryStats MqttService::recoveryStats() const
+    {
+        portENTER_CRITICAL(&_recoveryMux);
+        RecoveryStats s = _recovery.stats();
+        portEXIT_CRITICAL(&_recoveryMux);
+        return s;
+    }
 
-        // If filter has trailing '#', it matches remaining topic
-        if (*f == '#' && (f == filter.c_str() || *(f - 1) == '/') && *(f + 1) == '\0')
-        {
-            return true;
-        }
+    void MqttService::onMqttUnsubscribe(uint16_t packetId)
+    {
+        LOGI("MqttService", "Unsubscribed. id=%u", packetId);
+    }
 
-        // Both must end at the same time (no leftover levels)
-        return *f == '\0' && *t == '\0';
+    void MqttService::onMqttPublish(uint16_t packetId)
+    {
+        // Hot path with QoS1/2: record latency, no logging
+        const uint32_t now = (uint32_t)esp_timer_get_time();
+        portENTER_CRITICAL(&_inflightMux);
+        _inflight.ack(packetId, now);
+        portEXIT_CRITICAL(&_inflightMux);
     }
 
     void MqttService::onMqttMessage(Message msg, size_t index, size_t total)
@@ -333,9 +668,19 @@ namespace MqttService
         bool handled = false;
         for (const auto &sub : _subs)
         {
-            if (topicMatches(sub.topic.c_str(), msg.topic))
+            if (mqttTopicMatches(sub.topic.c_str(), msg.topic))
             {
-                if (sub.cb)
+                if (sub.mailbox >= 0)
+                {
+                    // Deferred: copy out and let the dispatch task run the handler.
+                    // Only whole messages are handed over.
+                    if (index == 0 && msg.len == total)
+                        postToMailbox(_mailboxes[sub.mailbox], msg);
+                    else
+                        _mailboxes[sub.mailbox].stats.dropped++;
+                    handled = true;
+                }
+                else if (sub.cb)
                 {
                     sub.cb(msg);
                     handled = true;
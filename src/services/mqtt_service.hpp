@@ -1,6 +1,11 @@
 #pragma once
 
 #include "logging/logger.hpp"
+#include "mqtt_outbox.hpp"
+#include "mqtt_mailbox.hpp"
+#include "mqtt_inflight_window.hpp"
+#include "mqtt_session.hpp"
+#include "reconnect_backoff.hpp"
 
 #include <Arduino.h>
 #include <WiFi.h>
@@ -8,10 +13,34 @@ extern "C"
 {
 #include "freertos/FreeRTOS.h"
 #include "freertos/timers.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 }
-#include <AsyncMqttClient.h>
+#include "transport/imqtt_transport.hpp"
+#include "transport/async_mqtt_transport.hpp"
 #include <functional>
 
+// ===== Tunables ===============================================================
+#ifndef MQTT_RECONNECT_MIN_MS
+#define MQTT_RECONNECT_MIN_MS 50 // first MQTT retry after 25..50 ms, doubling per failure
+#endif
+
+#ifndef MQTT_RECONNECT_MAX_MS
+#define MQTT_RECONNECT_MAX_MS 5000
+#endif
+
+#ifndef WIFI_RECONNECT_MIN_MS
+#define WIFI_RECONNECT_MIN_MS 100
+#endif
+
+#ifndef WIFI_RECONNECT_MAX_MS
+#define WIFI_RECONNECT_MAX_MS 8000
+#endif
+
+#ifndef MQTT_RECOVERY_TOPIC
+#define MQTT_RECOVERY_TOPIC "net/recovery" // relative; retained JSON after each recovery
+#endif
+
 namespace MqttService
 {
     /**
@@ -35,12 +64,43 @@ namespace MqttService
         AtLeastOnce = 1,
         ExactlyOnce = 2
     };
+    /**
+     * @brief Where a subscription's callback runs.
+     */
+    enum class Delivery : uint8_t
+    {
+        Inline, ///< On the MQTT client (async_tcp) task as the message arrives; keep it trivial
+        Latest, ///< On the dispatch task; only the newest unread message is kept (setpoints)
+        Queued  ///< On the dispatch task; in order, new messages dropped when the queue is full (events)
+    };
+
+    /// Per-subscription counters for deferred delivery.
+    struct DeliveryStats
+    {
+        uint32_t delivered;      ///< Callbacks run on the dispatch task
+        uint32_t overwritten;    ///< Latest: unread values replaced by newer ones
+        uint32_t dropped;        ///< Queued: queue full; both: payload/topic too large
+        uint32_t latency_max_us; ///< Receipt -> callback returned
+        uint64_t latency_sum_us;
+    };
+
+    /**
+     * @brief Outcome of a publish attempt.
+     */
+    enum class PublishStatus : uint8_t
+    {
+        Sent,         ///< Handed to the client
+        Buffered,     ///< Kept in the outbox, sent later
+        Backpressure, ///< In-flight window or client buffer full; try again shortly
+        Disconnected, ///< No broker connection
+    };
+
     struct Message
     {
         const char *topic;
         const uint8_t *payload;
         size_t len;
-        AsyncMqttClientMessageProperties props;
+        MqttMessageProperties props;
     };
 
     class MqttService
@@ -59,44 +119,79 @@ namespace MqttService
         // Set MQTT server before begin() if you don't pass host/port there.
         void setServer(const IPAddress &host, Port port);
 
+        /**
+         * @brief Replace the default AsyncMqttClient transport (e.g. with a loopback broker
+         * for benchmarks). Call before begin()/connectMqtt(); nullptr restores the default.
+         * The previous transport is unhooked and disconnected, its in-flight publishes given up.
+         */
+        void setTransport(IMqttTransport *transport);
+
+        /**
+         * @brief false asks the broker to keep our session across disconnects so a reconnect
+         * can skip re-subscribing (default true: a fresh session every time). Call before begin().
+         * @note With a kept session the broker also queues QoS1/2 messages for us while offline
+         * and delivers them after reconnecting, however old. Subscribe latest-value topics
+         * (setpoints) at QoS0 then, or a stale value is applied after an outage.
+         */
+        void setCleanSession(bool clean);
+
         // High-level helpers
         void connectWifi();
         void connectMqtt();
         void disconnectMqtt();
 
-        // MQTT ops (return true if a packet was queued)
+        // MQTT ops (return true if a packet was queued, either to the client or to the outbox)
+        // `offline` decides what happens to the message if it can't be sent right now.
+        // Use tryPublish() to tell backpressure apart from disconnects.
+        PublishStatus tryPublish(
+            Topic topic, const char *payload, size_t len,
+            QoS qos = QoS::AtMostOnce, bool retain = false,
+            OfflinePolicy offline = OfflinePolicy::Drop);
+        PublishStatus tryPublishRel(
+            Topic topic, const char *payload, size_t len,
+            QoS qos = QoS::AtMostOnce, bool retain = false,
+            OfflinePolicy offline = OfflinePolicy::Drop)
+        {
+            String topicStr = String(getIfValidDeviceId()) + "/" + String(topic);
+            return tryPublish(topicStr.c_str(), payload, len, qos, retain, offline);
+        }
+
         bool publish(
             Topic topic, const char *payload,
-            QoS qos = QoS::AtMostOnce, bool retain = false);
+            QoS qos = QoS::AtMostOnce, bool retain = false,
+            OfflinePolicy offline = OfflinePolicy::Drop);
         bool publish(
             Topic topic, const char *payload, size_t len,
-            QoS qos = QoS::AtMostOnce, bool retain = false);
+            QoS qos = QoS::AtMostOnce, bool retain = false,
+            OfflinePolicy offline = OfflinePolicy::Drop);
 
         bool publishRel(
             Topic topic, const char *payload,
-            QoS qos = QoS::AtMostOnce, bool retain = false)
+            QoS qos = QoS::AtMostOnce, bool retain = false,
+            OfflinePolicy offline = OfflinePolicy::Drop)
         {
-            String topicStr = String(topic) + String(getIfValidDeviceId());
+            String topicStr = String(getIfValidDeviceId()) + "/" + String(topic);
             return publish(
-                topicStr.c_str(), payload, qos, retain);
+                topicStr.c_str(), payload, qos, retain, offline);
         }
         bool publishRel(
             Topic topic, const char *payload, size_t len,
-            QoS qos = QoS::AtMostOnce, bool retain = false)
+            QoS qos = QoS::AtMostOnce, bool retain = false,
+            OfflinePolicy offline = OfflinePolicy::Drop)
         {
             String topicStr = String(getIfValidDeviceId()) + "/" + String(topic);
             return publish(
-                topicStr.c_str(), payload, len, qos, retain);
+                topicStr.c_str(), payload, len, qos, retain, offline);
         }
 
         struct Sub
         {
             String topic;
-            QoS qos;
             MessageCallback cb;
+            int8_t mailbox{-1}; // index into _mailboxes for deferred delivery
         };
         bool subscribe(Topic topic, QoS qos);
-        bool subscribe(Topic topic, QoS qos, MessageCallback cb);
+        bool subscribe(Topic topic, QoS qos, MessageCallback cb, Delivery delivery = Delivery::Inline);
 
         bool subscribeRel(Topic topic, QoS qos)
         {
@@ -104,22 +199,43 @@ namespace MqttService
             return subscribe(topicStr.c_str(), qos);
         }
 
-        bool subscribeRel(Topic topic, QoS qos, MessageCallback cb)
+        bool subscribeRel(Topic topic, QoS qos, MessageCallback cb, Delivery delivery = Delivery::Inline)
         {
             String topicStr = String(getIfValidDeviceId()) + "/" + String(topic);
             LOGI("MQTT", "Constructed topic: %s", topicStr.c_str());
-            return subscribe(topicStr.c_str(), qos, std::move(cb));
+            return subscribe(topicStr.c_str(), qos, std::move(cb), delivery);
         }
 
         bool unsubscribe(Topic topic);
 
         void onMessage(MessageCallback cb);
 
+        /**
+         * @brief Start the task that runs Latest/Queued subscription callbacks.
+         * Messages received before this is called wait in their mailboxes.
+         */
+        bool beginDispatch(UBaseType_t prio = 10, uint32_t stackWords = 4096, BaseType_t core = tskNO_AFFINITY);
+
+        /// Deferred-delivery counters for the subscription with this exact (absolute) filter.
+        bool deliveryStats(Topic filter, DeliveryStats &out) const;
+
         // Lightweight state
         bool wifiConnected() const { return WiFi.isConnected(); }
-        bool mqttConnected() const { return _mqttClient.connected(); }
+        bool mqttConnected() const { return _transport->connected(); }
         IPAddress localIp() const { return WiFi.localIP(); }
 
+        // Store-and-forward counters (see MqttOutbox)
+        MqttOutbox::Stats outboxStats() const { return _outbox.stats(); }
+
+        // In-flight window for QoS1/2 (QoS0 is never tracked)
+        void setMaxInFlight(QoS qos, uint8_t window);
+        uint8_t inFlight(QoS qos) const;
+        /// @return false if a publish at this QoS would currently hit backpressure.
+        bool canPublish(QoS qos) const;
+        AckStats ackStats() const;
+
+        RecoveryStats recoveryStats() const;
+
     private:
         MqttService();
         ~MqttService() = default;
@@ -131,25 +247,76 @@ namespace MqttService
         void handleWifiEvent(WiFiEvent_t event);
 
         void onMqttConnect(bool sessionPresent);
-        void onMqttDisconnect(AsyncMqttClientDisconnectReason reason);
+        void onMqttDisconnect(uint8_t reason);
         void onMqttSubscribe(uint16_t packetId, QoS qos);
         void onMqttUnsubscribe(uint16_t packetId);
         void onMqttMessage(Message msg, size_t index, size_t total);
         void onMqttPublish(uint16_t packetId);
 
-        bool topicMatches(const std::string &filter, Topic topic);
+        void hookTransport();
 
-        void resubscribeAll();
-        std::vector<Sub> _subs;
+        std::vector<Sub> _subs;          // callbacks / mailboxes per filter
+        SessionSubscriptions _session; // what the broker session holds, resynced on connect
+
+        // Reconnect / recovery bookkeeping
+        void scheduleReconnect(TimerHandle_t timer, ReconnectBackoff &backoff);
+        void markLinkDown();
+        void finishRecovery(bool sessionPresent);
+        void publishRecovery(const RecoveryStats &s, bool sessionPresent);
 
         // FreeRTOS timer callbacks
         static void mqttTimerCbStatic(TimerHandle_t);
         static void wifiTimerCbStatic(TimerHandle_t);
+        static void outboxTimerCbStatic(TimerHandle_t);
+
+        // Deferred delivery
+        struct Mailbox
+        {
+            Delivery mode{Delivery::Inline};
+            std::atomic<bool> active{false};
+            std::atomic<bool> busy{false}; // dispatch task is handling it, don't reuse yet
+            MessageCallback cb{};
+            LatestMailbox latest;         // Delivery::Latest
+            QueueHandle_t queue{nullptr}; // Delivery::Queued, items are MailItem
+            DeliveryStats stats{};
+        };
+        int8_t allocMailbox(Delivery mode, MessageCallback cb);
+        bool postToMailbox(Mailbox &mb, const Message &msg);
+        void deliver(Mailbox &mb, const MailItem &item);
+        static void dispatchTaskStatic(void *arg);
+        void dispatchLoop();
+
+        // Send through the client, respecting the in-flight window
+        PublishStatus sendNow(Topic topic, const char *payload, size_t len, QoS qos, bool retain);
+
+        // Publish buffered messages at a bounded rate (runs on the timer task)
+        void drainOutbox();
+        void startOutboxDrain();
 
     private:
-        AsyncMqttClient _mqttClient;
+        AsyncMqttTransport _asyncTransport;
+        IMqttTransport *_transport{&_asyncTransport};
         TimerHandle_t _mqttReconnectTimer{nullptr};
         TimerHandle_t _wifiReconnectTimer{nullptr};
+        TimerHandle_t _outboxTimer{nullptr};
+        ReconnectBackoff _mqttBackoff{MQTT_RECONNECT_MIN_MS, MQTT_RECONNECT_MAX_MS};
+        ReconnectBackoff _wifiBackoff{WIFI_RECONNECT_MIN_MS, WIFI_RECONNECT_MAX_MS};
+        bool _cleanSession{true};
+
+        RecoveryTracker _recovery;
+        mutable portMUX_TYPE _recoveryMux = portMUX_INITIALIZER_UNLOCKED;
+
+        MqttOutbox _outbox;
+        MqttOutbox::Entry _drainEntry{}; // scratch for drainOutbox(), keeps it off the timer stack
+
+        InFlightWindow _inflight; // QoS1/2 publishes awaiting acks
+        mutable portMUX_TYPE _inflightMux = portMUX_INITIALIZER_UNLOCKED;
+
+        Mailbox _mailboxes[MQTT_MAILBOX_MAX];
+        uint8_t _mailboxCount{0}; // slots in use so far; freed ones are reused, see allocMailbox()
+        TaskHandle_t _dispatchTask{nullptr};
+        MailItem _rxItem{};       // scratch, MQTT client task only
+        MailItem _dispatchItem{}; // scratch, dispatch task only
 
         IPAddress _mqttHost{};
         Port _mqttPort{0};
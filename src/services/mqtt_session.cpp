@@ -0,0 +1,156 @@
+#include "mqtt_session.hpp"
+
+#include <algorithm>
+
+namespace MqttService
+{
+    // ===== SessionSubscriptions =====
+    bool SessionSubscriptions::add(IMqttTransport &t, const char *filter, uint8_t qos)
+    {
+        if (!filter)
+            return false;
+        _filters.push_back(Filter{std::string(filter), qos, false});
+        // Wanted again before the broker heard it was dropped: no UNSUBSCRIBE, the SUBSCRIBE replaces it
+        _pendingUnsubs.erase(std::remove(_pendingUnsubs.begin(), _pendingUnsubs.end(), _filters.back().topic),
+                             _pendingUnsubs.end());
+        if (!t.connected())
+            return true; // queued for the next connect
+        const uint16_t id = t.subscribe(filter, qos);
+        _filters.back().inSession = id != 0;
+        return id != 0;
+    }
+
+    bool SessionSubscriptions::remove(IMqttTransport &t, const char *filter)
+    {
+        auto it = std::find_if(
+            _filters.begin(), _filters.end(),
+            [filter](const Filter &f)
+            { return filter && f.topic == filter; });
+        if (it == _filters.end())
+            return false;
+
+        std::string topic = std::move(it->topic);
+        const bool inSession = it->inSession;
+        _filters.erase(it);
+        if (t.connected())
+            return t.unsubscribe(topic.c_str()) != 0;
+        if (inSession && !_cleanSession)
+            _pendingUnsubs.push_back(std::move(topic)); // sent if the broker resumes the session
+        return false;
+    }
+
+    uint16_t SessionSubscriptions::connected(IMqttTransport &t, bool sessionPresent)
+    {
+        // A resumed session still holds our filters; otherwise the broker has none of them
+        if (!sessionPresent)
+        {
+            for (Filter &f : _filters)
+                f.inSession = false;
+            _pendingUnsubs.clear();
+        }
+
+        // Filters dropped while offline are still in a resumed broker session
+        for (const std::string &topic : _pendingUnsubs)
+            t.unsubscribe(topic.c_str());
+        _pendingUnsubs.clear();
+
+        const char *topics[MQTT_SUBSCRIBE_BATCH_MAX];
+        uint8_t qos[MQTT_SUBSCRIBE_BATCH_MAX];
+        Filter *batch[MQTT_SUBSCRIBE_BATCH_MAX];
+        size_t n = 0;
+        uint16_t lastId = 0;
+
+        for (size_t i = 0; i <= _filters.size(); ++i)
+        {
+            const bool end = i == _filters.size();
+            if (!end && !_filters[i].inSession)
+            {
+                topics[n] = _filters[i].topic.c_str();
+                qos[n] = _filters[i].qos;
+                batch[n++] = &_filters[i];
+            }
+            if (n && (end || n == MQTT_SUBSCRIBE_BATCH_MAX))
+            {
+                const uint16_t id = t.subscribeMany(topics, qos, n);
+                for (size_t k = 0; k < n; ++k)
+                    batch[k]->inSession = id != 0; // failed ones go out again on the next connect
+                lastId = id ? id : lastId;
+                n = 0;
+            }
+        }
+
+        // Recovery completes on the SUBACK of the last packet (acks come back in order)
+        _waitId = lastId;
+        return lastId;
+    }
+
+    bool SessionSubscriptions::subscribed(uint16_t packetId)
+    {
+        if (!_waitId || packetId != _waitId)
+            return false;
+        _waitId = 0;
+        return true;
+    }
+
+    void SessionSubscriptions::forget()
+    {
+        for (Filter &f : _filters)
+            f.inSession = false;
+        _pendingUnsubs.clear();
+        _waitId = 0;
+    }
+
+    size_t SessionSubscriptions::inSession() const
+    {
+        size_t n = 0;
+        for (const Filter &f : _filters)
+            n += f.inSession ? 1 : 0;
+        return n;
+    }
+
+    // ===== RecoveryTracker =====
+    void RecoveryTracker::linkDown(uint64_t nowUs)
+    {
+        if (!_linkUp)
+            return; // already counting this outage (or never up)
+        _linkUp = false;
+        _downSinceUs = nowUs;
+        _wifiUpUs = 0;
+        _connectedUs = 0;
+        _outageAttempts = 0;
+        _stats.outages++;
+    }
+
+    void RecoveryTracker::wifiUp(uint64_t nowUs)
+    {
+        if (_downSinceUs)
+            _wifiUpUs = nowUs;
+    }
+
+    void RecoveryTracker::connected(uint64_t nowUs)
+    {
+        if (_downSinceUs)
+            _connectedUs = nowUs;
+    }
+
+    bool RecoveryTracker::ready(uint64_t nowUs, bool sessionResumed)
+    {
+        _linkUp = true;
+        if (!_downSinceUs)
+            return false;
+
+        const uint32_t readyMs = (uint32_t)((nowUs - _downSinceUs) / 1000u);
+        _stats.recoveries++;
+        _stats.sessions_resumed += sessionResumed ? 1 : 0;
+        _stats.attempts += _outageAttempts;
+        _stats.last_attempts = _outageAttempts;
+        _stats.last_wifi_ms = _wifiUpUs ? (uint32_t)((_wifiUpUs - _downSinceUs) / 1000u) : 0;
+        _stats.last_connect_ms = _connectedUs ? (uint32_t)((_connectedUs - _downSinceUs) / 1000u) : readyMs;
+        _stats.last_ready_ms = readyMs;
+        _stats.sum_ready_ms += readyMs;
+        if (readyMs > _stats.max_ready_ms)
+            _stats.max_ready_ms = readyMs;
+        _downSinceUs = 0;
+        return true;
+    }
+} // Namespace MqttService
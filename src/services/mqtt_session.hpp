@@ -0,0 +1,136 @@
+#pragma once
+
+/**
+ * @file mqtt_session.hpp
+ * @brief Broker session bookkeeping behind MqttService's reconnects.
+ *
+ * - SessionSubscriptions: the filters we want against the ones the broker session holds.
+ *   On CONNACK it sends only what is missing (everything after a clean session, nothing
+ *   but offline changes after a resumed one) and names the SUBACK that completes recovery.
+ * - RecoveryTracker: outage timing, from the first disconnect to "subscriptions in place".
+ *
+ * Neither is locked: MqttService calls SessionSubscriptions from the client's callbacks
+ * and subscribe()/unsubscribe(), RecoveryTracker under _recoveryMux. Both build on the
+ * host and run against LoopbackTransport in test_native_reconnect.
+ */
+
+#include "transport/imqtt_transport.hpp"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// ===== Tunables ===============================================================
+#ifndef MQTT_SUBSCRIBE_BATCH_MAX
+#define MQTT_SUBSCRIBE_BATCH_MAX 8 // filters per SUBSCRIBE packet on (re)connect
+#endif
+
+namespace MqttService
+{
+    /**
+     * @brief Link recovery timing. An outage starts at the first Wi-Fi or MQTT disconnect
+     * and ends when the broker connection is back and all subscriptions are acknowledged
+     * (or the session was resumed). Times are measured from the start of the outage.
+     */
+    struct RecoveryStats
+    {
+        uint32_t outages;          ///< Disconnects after the link had been up
+        uint32_t recoveries;       ///< Outages that ended
+        uint32_t sessions_resumed; ///< Recoveries where the broker kept our session (no resubscribe)
+        uint32_t attempts;         ///< Wi-Fi + MQTT connect attempts, all outages
+        uint32_t last_wifi_ms;     ///< Until Wi-Fi had an IP again (0 if Wi-Fi stayed up)
+        uint32_t last_connect_ms;  ///< Until CONNACK
+        uint32_t last_ready_ms;    ///< Until subscriptions were in place
+        uint32_t last_attempts;    ///< Connect attempts during the last outage
+        uint32_t max_ready_ms;
+        uint64_t sum_ready_ms;
+    };
+
+    class SessionSubscriptions
+    {
+    public:
+        /// Must match the transport's flag: only a kept session needs offline unsubscribes replayed.
+        void setCleanSession(bool clean) { _cleanSession = clean; }
+
+        /**
+         * @brief Want @p filter. Subscribed right away if @p t is connected, else on connect.
+         * @return false if the SUBSCRIBE couldn't be sent now (retried on the next connect).
+         */
+        bool add(IMqttTransport &t, const char *filter, uint8_t qos);
+
+        /**
+         * @brief Stop wanting @p filter. Unsubscribed right away if connected; if not, and a
+         * kept session holds it, the UNSUBSCRIBE goes out if the broker resumes that session.
+         * @return false if it wasn't wanted, or no UNSUBSCRIBE was sent now.
+         */
+        bool remove(IMqttTransport &t, const char *filter);
+
+        /**
+         * @brief CONNACK: bring the broker session up to date, SUBSCRIBEs batched by
+         * MQTT_SUBSCRIBE_BATCH_MAX. With @p sessionPresent only offline changes are sent.
+         * @return Id of the last SUBSCRIBE (its SUBACK comes last and completes recovery,
+         * see subscribed()), 0 if nothing had to be sent: the link is ready now.
+         */
+        uint16_t connected(IMqttTransport &t, bool sessionPresent);
+
+        /// SUBACK. @return true if it is the one connected() waited for.
+        bool subscribed(uint16_t packetId);
+
+        /// Connection lost: whatever connected() was waiting for won't come.
+        void disconnected() { _waitId = 0; }
+
+        /// Different client or broker (transport swap): nothing is in a session any more.
+        void forget();
+
+        bool recovering() const { return _waitId != 0; }
+        size_t size() const { return _filters.size(); }
+        /// Filters the current broker session holds (or was sent).
+        size_t inSession() const;
+        size_t pendingUnsubscribes() const { return _pendingUnsubs.size(); }
+
+    private:
+        struct Filter
+        {
+            std::string topic;
+            uint8_t qos;
+            bool inSession; // SUBSCRIBE sent on the current broker session
+        };
+
+        std::vector<Filter> _filters;
+        std::vector<std::string> _pendingUnsubs; // removed while offline, a kept session still has them
+        bool _cleanSession{true};
+        uint16_t _waitId{0}; // SUBACK that completes recovery, 0 = not recovering
+    };
+
+    class RecoveryTracker
+    {
+    public:
+        /// Wi-Fi or MQTT lost. Starts an outage if the link was up.
+        void linkDown(uint64_t nowUs);
+        /// Wi-Fi has an IP again.
+        void wifiUp(uint64_t nowUs);
+        /// A Wi-Fi or MQTT connect attempt.
+        void attempt() { _outageAttempts++; }
+        /// CONNACK.
+        void connected(uint64_t nowUs);
+
+        /**
+         * @brief Subscriptions are in place (or the session was resumed): the link is up.
+         * @return true if this ended an outage; stats() has its timing. The first connect
+         * after boot is not an outage.
+         */
+        bool ready(uint64_t nowUs, bool sessionResumed);
+
+        bool down() const { return _downSinceUs != 0; }
+        const RecoveryStats &stats() const { return _stats; }
+
+    private:
+        bool _linkUp{false};      // connected and subscribed at least once since the last outage
+        uint64_t _downSinceUs{0}; // start of the current outage
+        uint64_t _wifiUpUs{0};
+        uint64_t _connectedUs{0};
+        uint32_t _outageAttempts{0};
+        RecoveryStats _stats{};
+    };
+} // Namespace MqttService
@@ -0,0 +1,41 @@
+#pragma once
+
+/**
+ * @file reconnect_backoff.hpp
+ * @brief Capped exponential backoff with "equal jitter" for reconnect timers.
+ *
+ * Attempt n waits in [base/2, base] with base = min(max, min * 2^n): the first
+ * retry goes out within tens of milliseconds, and devices that dropped together
+ * (AP reboot) don't reconnect in lock-step.
+ */
+
+#include <stdint.h>
+
+class ReconnectBackoff
+{
+public:
+    ReconnectBackoff(uint32_t minMs, uint32_t maxMs)
+        : _minMs(minMs ? minMs : 1), _maxMs(maxMs < minMs ? minMs : maxMs) {}
+
+    /**
+     * @brief Delay before the next attempt.
+     * @param rnd Any 32-bit random value (esp_random() on target).
+     */
+    uint32_t next(uint32_t rnd)
+    {
+        uint32_t base = _maxMs;
+        if (_attempts < 31 && (_minMs << _attempts) >> _attempts == _minMs) // no overflow
+            base = (_minMs << _attempts) < _maxMs ? (_minMs << _attempts) : _maxMs;
+        _attempts++;
+        const uint32_t half = base / 2;
+        return half + rnd % (base - half + 1);
+    }
+
+    void reset() { _attempts = 0; }
+    uint32_t attempts() const { return _attempts; }
+
+private:
+    uint32_t _minMs;
+    uint32_t _maxMs;
+    uint32_t _attempts = 0;
+};
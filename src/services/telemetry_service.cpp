@@ -3,16 +3,22 @@
 #include "logging/logger.hpp"
 #include "mqtt_service.hpp" // TODO: Allow for publishing through sinks and logger instead? or something
 
-#include <cstring> // strlen
+#include <cstdio>  // snprintf
+#include <cstring> // strcmp, memset
+#include "esp_timer.h" // esp_timer_get_time()
 
 extern "C"
 {
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "freertos/queue.h"
 }
 
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_TX_BACKPRESSURE_RETRIES
+#define TELEMETRY_TX_BACKPRESSURE_RETRIES 2 // extra attempts (1 tick apart) before dropping a sample
+#endif
+
 TelemetryService &TelemetryService::instance()
 {
     static TelemetryService inst;
@@ -26,21 +32,27 @@ void TelemetryService::begin(
     uint32_t txStackWords,
     BaseType_t txCore)
 {
-    _deviceId = droneId ? droneId : "Drone";
+    _topics.setPrefix(droneId);
+    std::memset(_streamUdp, -1, sizeof(_streamUdp));
+    _bundleStream = _topics.add(TELEMETRY_BUNDLE_TOPIC);
+    _rateStream = _topics.add(TELEMETRY_RATE_TOPIC);
+    _schedStream = _topics.add(TELEMETRY_SCHED_TOPIC);
+    _i2cStream = _topics.add(TELEMETRY_I2C_TOPIC);
+    _streamsStream = _topics.add(TELEMETRY_STREAMS_TOPIC);
+    _statusStream = _topics.add(TELEMETRY_STATUS_TOPIC);
+    _nextControlUs = (uint32_t)esp_timer_get_time() + TELEMETRY_RATE_CONTROL_MS * 1000u;
+    _nextStreamStatsUs = (uint32_t)esp_timer_get_time() + TELEMETRY_STREAM_STATS_MS * 1000u;
 
-    _queue = xQueueCreate(queueLen, sizeof(TelemetrySample));
-    if (!_queue)
-    {
-        LOGE("Telemetry", "Failed to create telemetry queue");
-        return;
-    }
+    TelemetryClassConfig bulk = _txq.config(TelemetryClass::Bulk);
+    bulk.depth = (uint8_t)(queueLen < TELEMETRY_CLASS_QUEUE_MAX ? queueLen : TELEMETRY_CLASS_QUEUE_MAX);
+    if (!configureClass(TelemetryClass::Bulk, bulk))
+        LOGW("Telemetry", "Bad TX queue length %u, keeping %u", (unsigned)queueLen,
+             (unsigned)_txq.config(TelemetryClass::Bulk).depth);
+    configureClass(TelemetryClass::Control, _txq.config(TelemetryClass::Control)); // fit the default to the pool
 
-    _i2cMutex = xSemaphoreCreateMutex();
-    if (!_i2cMutex)
-    {
-        LOGW("Telemetry", "Failed to create I2C mutex");
-        // Continue, but providers that use I2C should check for null
-    }
+    _ctlQueue = xQueueCreate(TELEMETRY_CTL_QUEUE_LEN, sizeof(CtlCommand));
+    if (!_ctlQueue)
+        LOGE("Telemetry", "Failed to create stream command queue");
 
     const BaseType_t ok = xTaskCreatePinnedToCore(
         &_txThunk, "TelemetryTx", txStackWords, this, txPrio, &_txTask, txCore);
@@ -48,19 +60,86 @@ void TelemetryService::begin(
     {
         LOGE("Telemetry", "Failed to create TX task");
     }
+
+    // Sampling task for scheduled providers; sleeps on a one-shot esp_timer between deadlines
+    const esp_timer_create_args_t timerArgs{
+        .callback = &_sampleTimerCb,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "TelemetrySample",
+        .skip_unhandled_events = false,
+    };
+    if (esp_timer_create(&timerArgs, &_sampleTimer) != ESP_OK)
+    {
+        LOGE("Telemetry", "Failed to create sampling timer");
+        return;
+    }
+    _nextSchedStatsUs = (uint64_t)esp_timer_get_time() + TELEMETRY_SCHED_STATS_MS * 1000ull;
+    if (xTaskCreatePinnedToCore(&_sampleThunk, "TelemetrySample", TELEMETRY_SAMPLE_TASK_STACK, this,
+                                TELEMETRY_SAMPLE_TASK_PRIO, &_sampleTask, tskNO_AFFINITY) != pdPASS)
+    {
+        LOGE("Telemetry", "Failed to create sampling task");
+    }
 }
 
 void TelemetryService::addProvider(ITelemetryProvider *provider)
 {
-    if (!provider || !_queue)
+    addProvider(provider, TelemetryRateLimits{});
+}
+
+void TelemetryService::addProvider(ITelemetryProvider *provider, const TelemetryRateLimits &limits,
+                                   TelemetryDemand demand)
+{
+    if (!provider || !_txTask)
         return;
 
-    provider->setOutputQueue(_queue);
+    provider->setOutput(this);
+    provider->setBufferPool(&_pool);
+    provider->setTopicTable(&_topics); // streams are registered in begin()
+    provider->setStreamStats(&_streamStats);
 
     if (provider->begin())
     {
         _providers.push_back(provider);
         LOGI("Telemetry", "Provider added: %s", provider->name());
+
+        const uint32_t nominalHz = provider->sampleRateHz();
+        portENTER_CRITICAL(&_rateMux);
+        const int idx = _rate.add(nominalHz, limits);
+        if (idx >= 0)
+        {
+            _rateProviders[idx] = provider;
+            _ctl.add(provider->name(), demand);
+        }
+        const bool idle = idx >= 0 && _ctl.effective(idx, _rate.rate(idx)) == 0;
+        portEXIT_CRITICAL(&_rateMux);
+        if (idx < 0)
+            LOGW("Telemetry", "Rate controller full, %s keeps a fixed rate and can't be switched off",
+                 provider->name());
+        if (idle)
+            provider->onSamplingRateChange(0); // OnDemand: nothing until a client leases it
+        _statusDirty = true;
+
+        if (provider->scheduled())
+        {
+            const uint64_t now = (uint64_t)esp_timer_get_time();
+            const uint32_t hz = provider->sampleRateHz(); // 0 while idle, unless the blackbox records
+            portENTER_CRITICAL(&_schedMux);
+            const int slot = _sched.add(nominalHz, now);
+            if (slot >= 0)
+            {
+                _schedProviders[slot] = provider;
+                _sched.setRate(slot, hz, now);
+                _sched.setTriggered(slot, provider->triggered(), now);
+            }
+            portEXIT_CRITICAL(&_schedMux);
+            if (slot < 0)
+                LOGE("Telemetry", "Sampling scheduler full, %s won't be sampled", provider->name());
+            else if (provider->triggered())
+                provider->setSampleTrigger(this, slot); // its interrupt paces it from here on
+            if (slot >= 0 && _sampleTask)
+                xTaskNotifyGive(_sampleTask); // re-plan: the new entry may be due first
+        }
     }
     else
     {
@@ -68,6 +147,568 @@ void TelemetryService::addProvider(ITelemetryProvider *provider)
     }
 }
 
+void TelemetryService::attachMqtt(MqttService::MqttService &mqtt)
+{
+    mqtt.subscribeRel(
+        TELEMETRY_CTL_TOPIC, MqttService::QoS::AtLeastOnce,
+        [this](const MqttService::Message &msg)
+        {
+            // Copy it for the TX task; never wait here, this is the MQTT dispatch task
+            CtlCommand cmd;
+            if (msg.len > sizeof(cmd.text))
+            {
+                LOGW("Telemetry", "Stream command too long (%u bytes), dropped", (unsigned)msg.len);
+                return;
+            }
+            cmd.len = (uint16_t)msg.len;
+            memcpy(cmd.text, msg.payload, msg.len);
+            if (!_ctlQueue || xQueueSend(_ctlQueue, &cmd, 0) != pdTRUE)
+            {
+                LOGW("Telemetry", "Stream command queue full, dropped: %.*s", (int)cmd.len, cmd.text);
+                return;
+            }
+            if (_txTask)
+                xTaskNotifyGive(_txTask);
+        },
+        MqttService::Delivery::Queued);
+    _statusDirty = true;
+}
+
+void TelemetryService::drainCommands()
+{
+    CtlCommand cmd;
+    while (_ctlQueue && xQueueReceive(_ctlQueue, &cmd, 0) == pdTRUE)
+        handleCommand(cmd.text, cmd.len);
+}
+
+void TelemetryService::handleCommand(const char *cmd, size_t len)
+{
+    // Tokenize outside the lock; only the table update runs in the critical section
+    const TelemetryStreamControl::Command parsed = TelemetryStreamControl::parse(cmd, len);
+    const uint32_t nowMs = millis();
+    portENTER_CRITICAL(&_rateMux);
+    const TelemetryStreamControl::Outcome o = _ctl.apply(parsed, nowMs);
+    portEXIT_CRITICAL(&_rateMux);
+
+    switch (o.result)
+    {
+    case TelemetryStreamControl::Result::Ok:
+        if (o.changed)
+            applyRates(o.changed);
+        publishStatus(); // renewals too: lease_ms moves
+        break;
+    case TelemetryStreamControl::Result::Status:
+        publishStatus();
+        break;
+    default:
+        LOGW("Telemetry", "Bad stream command: %.*s", (int)len, cmd);
+        break;
+    }
+}
+
+void TelemetryService::applyRates(uint32_t changed)
+{
+    uint32_t rates[TELEMETRY_RATE_MAX_STREAMS];
+    ITelemetryProvider *providers[TELEMETRY_RATE_MAX_STREAMS];
+    size_t count;
+    portENTER_CRITICAL(&_rateMux);
+    count = _rate.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        rates[i] = _ctl.effective(i, _rate.rate(i));
+        providers[i] = _rateProviders[i];
+    }
+    portEXIT_CRITICAL(&_rateMux);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if ((changed & (1u << i)) && providers[i])
+        {
+            LOGI("Telemetry", "%s: %s", providers[i]->name(), rates[i] ? "on" : "idle");
+            providers[i]->onSamplingRateChange(rates[i]);
+        }
+    }
+    wakeIdleSampling(); // a provider going idle is parked by the sampling loop itself
+}
+
+void TelemetryService::wakeIdleSampling()
+{
+    // The sampling loop never runs idle entries, so it can't see them get a rate again
+    // (leased, or the blackbox started recording): resume them from here
+    ITelemetryProvider *idle[SAMPLE_SCHEDULER_MAX_ENTRIES]{};
+    portENTER_CRITICAL(&_schedMux);
+    for (size_t i = 0; i < _sched.size(); ++i)
+    {
+        if (_sched.idle((int)i))
+            idle[i] = _schedProviders[i];
+    }
+    portEXIT_CRITICAL(&_schedMux);
+
+    bool woke = false;
+    const uint64_t now = (uint64_t)esp_timer_get_time();
+    for (size_t i = 0; i < SAMPLE_SCHEDULER_MAX_ENTRIES; ++i)
+    {
+        const uint32_t hz = idle[i] ? idle[i]->sampleRateHz() : 0;
+        if (!hz)
+            continue;
+        portENTER_CRITICAL(&_schedMux);
+        _sched.setRate((int)i, hz, now);
+        portEXIT_CRITICAL(&_schedMux);
+        woke = true;
+    }
+    if (woke && _sampleTask)
+        xTaskNotifyGive(_sampleTask); // re-plan
+}
+
+void TelemetryService::publishStatus()
+{
+    // {"streams":[{"provider":"IMU_MPU_9250","demand":"continuous","state":"on","hz":100,"lease_ms":0},...]}
+    const uint32_t nowMs = millis();
+    struct Row
+    {
+        const char *name;
+        TelemetryDemand demand;
+        uint32_t hz;
+        uint32_t leaseMs;
+    };
+    Row rows[TELEMETRY_RATE_MAX_STREAMS];
+    size_t count;
+    portENTER_CRITICAL(&_rateMux);
+    count = _ctl.size();
+    for (size_t i = 0; i < count; ++i)
+        rows[i] = Row{_ctl.name(i), _ctl.demand(i), _ctl.effective(i, _rate.rate(i)), _ctl.leaseRemainingMs(i, nowMs)};
+    portEXIT_CRITICAL(&_rateMux);
+
+    int n = snprintf(_statusMsg, sizeof(_statusMsg), "{\"streams\":[");
+    for (size_t i = 0; i < count && n > 0 && (size_t)n < sizeof(_statusMsg); ++i)
+    {
+        n += snprintf(_statusMsg + n, sizeof(_statusMsg) - n,
+                      "%s{\"provider\":\"%s\",\"demand\":\"%s\",\"state\":\"%s\",\"hz\":%u,\"lease_ms\":%u}",
+                      i ? "," : "", rows[i].name,
+                      rows[i].demand == TelemetryDemand::OnDemand ? "on_demand" : "continuous",
+                      rows[i].hz ? "on" : "idle", (unsigned)rows[i].hz, (unsigned)rows[i].leaseMs);
+    }
+    if (n > 0 && (size_t)n < sizeof(_statusMsg))
+        n += snprintf(_statusMsg + n, sizeof(_statusMsg) - n, "]}");
+    if (n <= 0 || (size_t)n >= sizeof(_statusMsg))
+        return;
+
+    TelemetrySample sample{
+        .topic_suffix = TELEMETRY_STATUS_TOPIC,
+        .payload = reinterpret_cast<const uint8_t *>(_statusMsg),
+        .payload_length = (size_t)n,
+        .meta = TelemetryMeta{
+            .qos = 0,
+            .retain = true, // what is on right now, for clients subscribing later
+            .content_type = TelemetryContentType::JSON,
+            .full_topic = false,
+            .offline = TelemetryOfflinePolicy::Coalesce,
+        }};
+    sample.stream = _statusStream;
+    stamp(sample);
+    const char *topic = _topics.topic(_statusStream);
+    if (topic)
+        transmit(topic, sample);
+}
+
+bool TelemetryService::beginUdp(const IPAddress &host, uint16_t port)
+{
+    if (_txTask)
+    {
+        LOGE("Telemetry", "beginUdp() after begin(): the TX task already runs");
+        return false;
+    }
+    return _udp.begin(host, port);
+}
+
+bool TelemetryService::routeUdp(const char *topicSuffix)
+{
+    if (_txTask)
+    {
+        LOGE("Telemetry", "routeUdp() after begin(): the TX task already runs");
+        return false;
+    }
+    if (!topicSuffix || _udpRouteCount >= TELEMETRY_UDP_ROUTES_MAX)
+        return false;
+    _udpRoutes[_udpRouteCount++] = topicSuffix;
+    std::memset(_streamUdp, -1, sizeof(_streamUdp)); // re-decide per stream
+    return true;
+}
+
+bool TelemetryService::routedUdp(const char *topicSuffix) const
+{
+    if (!topicSuffix)
+        return false;
+    for (size_t i = 0; i < _udpRouteCount; ++i)
+    {
+        if (std::strcmp(_udpRoutes[i], topicSuffix) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool TelemetryService::streamRoutedUdp(const TelemetrySample &s)
+{
+    if (!_udp.configured())
+        return false;
+    if (s.stream >= TELEMETRY_MAX_STREAMS)
+        return routedUdp(s.topic_suffix);
+
+    // Registered stream: compare suffixes once, then it's an array lookup
+    int8_t &route = _streamUdp[s.stream];
+    if (route < 0)
+        route = routedUdp(_topics.suffix(s.stream)) ? 1 : 0;
+    return route == 1;
+}
+
+bool TelemetryService::samplingStats(const ITelemetryProvider *provider, SampleScheduler::Stats &out) const
+{
+    bool found = false;
+    portENTER_CRITICAL(&_schedMux);
+    for (size_t i = 0; i < _sched.size(); ++i)
+    {
+        if (_schedProviders[i] == provider)
+        {
+            out = _sched.stats((int)i);
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_schedMux);
+    return found;
+}
+
+void TelemetryService::_sampleThunk(void *arg)
+{
+    static_cast<TelemetryService *>(arg)->_sampleLoop();
+}
+
+void TelemetryService::_sampleTimerCb(void *arg)
+{
+    xTaskNotifyGive(static_cast<TelemetryService *>(arg)->_sampleTask);
+}
+
+void IRAM_ATTR TelemetryService::triggerFromISR(int slot, uint64_t isrUs)
+{
+    portENTER_CRITICAL_ISR(&_schedMux);
+    _sched.trigger(slot, isrUs);
+    portEXIT_CRITICAL_ISR(&_schedMux);
+
+    BaseType_t woken = pdFALSE;
+    if (_sampleTask)
+        vTaskNotifyGiveFromISR(_sampleTask, &woken);
+    if (woken == pdTRUE)
+        portYIELD_FROM_ISR();
+}
+
+void TelemetryService::_sampleLoop()
+{
+    for (;;)
+    {
+        uint64_t due = 0;
+        ITelemetryProvider *provider = nullptr;
+        portENTER_CRITICAL(&_schedMux);
+        const int idx = _sched.next(due);
+        if (idx >= 0)
+            provider = _schedProviders[idx];
+        portEXIT_CRITICAL(&_schedMux);
+
+        if (!provider)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // until the first scheduled provider is added
+            continue;
+        }
+
+        // Sleep until the deadline (µs timer, no tick rounding), then re-plan: a provider
+        // added meanwhile may be due first
+        const uint64_t now = (uint64_t)esp_timer_get_time();
+        if (due > now)
+        {
+            esp_timer_start_once(_sampleTimer, due - now);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            esp_timer_stop(_sampleTimer); // woken early by addProvider(); harmless otherwise
+            continue;
+        }
+
+        portENTER_CRITICAL(&_schedMux);
+        _sched.start(idx, now); // a trigger from here on is for the next run
+        portEXIT_CRITICAL(&_schedMux);
+        provider->sample();
+        const uint64_t end = (uint64_t)esp_timer_get_time();
+        const uint32_t hz = provider->sampleRateHz(); // may have been changed by the rate controller
+
+        portENTER_CRITICAL(&_schedMux);
+        _sched.complete(idx, now, end);
+        if (SampleScheduler::periodUs(hz) != _sched.stats(idx).period_us)
+            _sched.setRate(idx, hz);
+        portEXIT_CRITICAL(&_schedMux);
+
+        if (TELEMETRY_SCHED_STATS_MS > 0 && end >= _nextSchedStatsUs)
+        {
+            publishSchedStats();
+            publishBusStats();
+            _nextSchedStatsUs = end + TELEMETRY_SCHED_STATS_MS * 1000ull;
+        }
+    }
+}
+
+void TelemetryService::publishSchedStats()
+{
+    // One sample per provider: {"provider":..,"hz":..,"runs":..,"miss":..,"overrun":..,"late_avg_us":..,...}
+    for (size_t i = 0;; ++i)
+    {
+        SampleScheduler::Stats st{};
+        ITelemetryProvider *provider = nullptr;
+        portENTER_CRITICAL(&_schedMux);
+        if (i < _sched.size())
+        {
+            st = _sched.stats((int)i);
+            provider = _schedProviders[i];
+            _sched.resetStats((int)i);
+        }
+        portEXIT_CRITICAL(&_schedMux);
+        if (!provider)
+            return;
+
+        TelemetryLease lease = _pool.acquire(TelemetryClass::Bulk);
+        if (!lease.valid())
+            return;
+        const int n = snprintf(reinterpret_cast<char *>(lease.data), lease.capacity,
+                               "{\"provider\":\"%s\",\"hz\":%u,\"runs\":%u,\"miss\":%u,\"overrun\":%u,"
+                               "\"late_avg_us\":%u,\"late_max_us\":%u,\"exec_max_us\":%u,\"timeout\":%u}",
+                               provider->name(), (unsigned)(st.period_us ? 1000000u / st.period_us : 0),
+                               (unsigned)st.runs, (unsigned)st.misses, (unsigned)st.overruns,
+                               (unsigned)(st.runs ? st.late_sum_us / st.runs : 0), (unsigned)st.late_max_us,
+                               (unsigned)st.exec_max_us, (unsigned)st.timeouts);
+        publishStats(lease, n, TELEMETRY_SCHED_TOPIC, _schedStream);
+    }
+}
+
+void TelemetryService::publishBusStats()
+{
+    I2cBus &bus = I2cBus::instance();
+    if (!bus.started())
+        return;
+
+    I2cTransactionQueue::Stats st{};
+    I2cTransactionQueue::DeviceStats devices[I2C_BUS_MAX_DEVICES];
+    uint8_t util = 0;
+    const size_t count = bus.snapshot(st, util, devices, I2C_BUS_MAX_DEVICES);
+
+    // One sample per device: {"addr":"0x68","util_pct":..,"n":..,"nack":..,"timeout":..,"lat_avg_us":..,...}
+    for (size_t i = 0; i < count; ++i)
+    {
+        const I2cTransactionQueue::DeviceStats &d = devices[i];
+        TelemetryLease lease = _pool.acquire(TelemetryClass::Bulk);
+        if (!lease.valid())
+            return;
+        const int n = snprintf(reinterpret_cast<char *>(lease.data), lease.capacity,
+                               "{\"addr\":\"0x%02x\",\"clock_khz\":%u,\"util_pct\":%u,\"queue_hw\":%u,"
+                               "\"queue_full\":%u,\"n\":%u,\"nack\":%u,\"timeout\":%u,\"err\":%u,"
+                               "\"lat_avg_us\":%u,\"lat_max_us\":%u,\"xfer_max_us\":%u}",
+                               d.addr, (unsigned)(bus.clockHz() / 1000), (unsigned)util,
+                               (unsigned)st.queue_high_water, (unsigned)st.queue_full, (unsigned)d.transactions,
+                               (unsigned)d.nacks, (unsigned)d.timeouts, (unsigned)d.errors,
+                               (unsigned)(d.transactions ? d.latency_sum_us / d.transactions : 0),
+                               (unsigned)d.latency_max_us, (unsigned)d.transfer_max_us);
+        publishStats(lease, n, TELEMETRY_I2C_TOPIC, _i2cStream);
+    }
+}
+
+bool TelemetryService::publishStats(TelemetryLease &lease, int len, const char *topicSuffix,
+                                    TelemetryStreamId stream)
+{
+    if (len <= 0 || (size_t)len >= lease.capacity)
+    {
+        _pool.release(lease.slot);
+        return false;
+    }
+
+    TelemetrySample sample{
+        .topic_suffix = topicSuffix,
+        .payload = lease.data,
+        .payload_length = (size_t)len,
+        .meta = TelemetryMeta{
+            .qos = 0,
+            .retain = false,
+            .content_type = TelemetryContentType::JSON,
+            .full_topic = false,
+            .offline = TelemetryOfflinePolicy::Drop,
+        }};
+    sample.buffer = lease.slot;
+    sample.stream = stream;
+    stamp(sample);
+    if (!enqueue(sample, 0, false))
+    {
+        _pool.release(lease.slot);
+        return false;
+    }
+    return true;
+}
+
+bool TelemetryService::configureClass(TelemetryClass cls, const TelemetryClassConfig &cfg)
+{
+    // An evicting class deeper than its pool share would run out of buffers first: its
+    // providers would skip the newest samples while stale ones stay queued
+    TelemetryClassConfig fit = cfg;
+    const size_t share = TelemetryBufferPool::queueShare(cls);
+    if (cfg.policy != TelemetryDropPolicy::DropNewest && cfg.depth > share)
+    {
+        fit.depth = (uint8_t)share;
+        LOGI("Telemetry", "%s queue depth %u capped at its pool share, %u", TelemetryClassQueue::className(cls),
+             (unsigned)cfg.depth, (unsigned)share);
+    }
+    portENTER_CRITICAL(&_txMux);
+    const bool ok = _txq.configure(cls, fit);
+    portEXIT_CRITICAL(&_txMux);
+    return ok;
+}
+
+TelemetryClassQueue::Stats TelemetryService::classStats(TelemetryClass cls) const
+{
+    portENTER_CRITICAL(&_txMux);
+    const TelemetryClassQueue::Stats st = _txq.stats(cls);
+    portEXIT_CRITICAL(&_txMux);
+    return st;
+}
+
+bool TelemetryService::enqueue(const TelemetrySample &sample, TickType_t timeoutTicks, bool latestOnly)
+{
+    TelemetrySample displaced{};
+    TelemetryClassQueue::Push r = TelemetryClassQueue::Push::Refused;
+    for (;;)
+    {
+        // A full DropNewest class refuses; with a timeout, wait for the TX task to make room
+        portENTER_CRITICAL(&_txMux);
+        const bool wait = timeoutTicks > 0 && !latestOnly && _txq.full(sample.meta.traffic_class) &&
+                          _txq.config(sample.meta.traffic_class).policy == TelemetryDropPolicy::DropNewest;
+        if (!wait)
+            r = _txq.push(sample, displaced, latestOnly);
+        portEXIT_CRITICAL(&_txMux);
+        if (!wait)
+            break;
+        vTaskDelay(1);
+        timeoutTicks--;
+    }
+
+    if (r == TelemetryClassQueue::Push::Refused)
+    {
+        _streamStats.enqueueDropped(sample.stream);
+        return false;
+    }
+    if (r == TelemetryClassQueue::Push::Displaced)
+    {
+        // Evicted or replaced: lost like a refused sample, but its buffer is ours to free
+        _streamStats.enqueueDropped(displaced.stream);
+        _pool.release(displaced.buffer);
+    }
+    if (_txTask)
+        xTaskNotifyGive(_txTask);
+    return true;
+}
+
+void TelemetryService::stamp(TelemetrySample &s)
+{
+    if (!s.t_us)
+        s.t_us = (uint32_t)esp_timer_get_time();
+    s.seq = _streamStats.stamp(s.stream);
+}
+
+void TelemetryService::publishStreamStats()
+{
+    // One sample per stream that carried anything, then the device-wide stages:
+    // {"stream":"telemetry/imu","seq":..,"enq_drop":..,"tx_fail":..,"buffered":..,"sent":..,"age_p50_us":..,...}
+    for (size_t i = 0; i < _topics.size(); ++i)
+    {
+        const TelemetryStreamStats::Snapshot st = _streamStats.snapshot((TelemetryStreamId)i, true);
+        if (st.seq == 0)
+            continue;
+        const int n = snprintf(_streamMsg, sizeof(_streamMsg),
+                               "{\"stream\":\"%s\",\"seq\":%u,\"enq_drop\":%u,\"tx_fail\":%u,\"buffered\":%u,"
+                               "\"sent\":%u,\"t_us\":%u,\"age_n\":%u,\"age_p50_us\":%u,\"age_p90_us\":%u,"
+                               "\"age_p99_us\":%u,\"age_max_us\":%u}",
+                               _topics.suffix((TelemetryStreamId)i), (unsigned)st.seq, (unsigned)st.enqueue_drops,
+                               (unsigned)st.tx_failures, (unsigned)st.buffered, (unsigned)st.sent,
+                               (unsigned)st.last_capture_us, (unsigned)st.age_count, (unsigned)st.age_p50_us,
+                               (unsigned)st.age_p90_us, (unsigned)st.age_p99_us, (unsigned)st.age_max_us);
+        if (n <= 0 || (size_t)n >= sizeof(_streamMsg))
+            continue;
+
+        TelemetrySample sample{
+            .topic_suffix = TELEMETRY_STREAMS_TOPIC,
+            .payload = reinterpret_cast<const uint8_t *>(_streamMsg),
+            .payload_length = (size_t)n,
+            .meta = TelemetryMeta{
+                .qos = 0,
+                .retain = false,
+                .content_type = TelemetryContentType::JSON,
+                .full_topic = false,
+                .offline = TelemetryOfflinePolicy::Drop,
+            }};
+        sample.stream = _streamsStream;
+        stamp(sample);
+        transmit(_topics.topic(_streamsStream), sample);
+    }
+
+    // TX queue classes: {"class":"bulk","depth":64,"policy":"drop_oldest","waiting":..,"hw":..,"queued":..,...}
+    for (size_t c = 0; c < TELEMETRY_CLASS_COUNT; ++c)
+    {
+        const TelemetryClass cls = (TelemetryClass)c;
+        portENTER_CRITICAL(&_txMux);
+        const TelemetryClassConfig cfg = _txq.config(cls);
+        const TelemetryClassQueue::Stats st = _txq.stats(cls);
+        const size_t waiting = _txq.size(cls);
+        portEXIT_CRITICAL(&_txMux);
+        const int n = snprintf(_streamMsg, sizeof(_streamMsg),
+                               "{\"class\":\"%s\",\"depth\":%u,\"policy\":\"%s\",\"waiting\":%u,\"hw\":%u,"
+                               "\"queued\":%u,\"sent\":%u,\"drop_newest\":%u,\"drop_oldest\":%u,\"replaced\":%u}",
+                               TelemetryClassQueue::className(cls), (unsigned)cfg.depth,
+                               TelemetryClassQueue::policyName(cfg.policy), (unsigned)waiting,
+                               (unsigned)st.high_water, (unsigned)st.queued, (unsigned)st.sent,
+                               (unsigned)st.drop_newest, (unsigned)st.drop_oldest, (unsigned)st.replaced);
+        if (n <= 0 || (size_t)n >= sizeof(_streamMsg))
+            continue;
+        TelemetrySample sample{
+            .topic_suffix = TELEMETRY_STREAMS_TOPIC,
+            .payload = reinterpret_cast<const uint8_t *>(_streamMsg),
+            .payload_length = (size_t)n,
+            .meta = TelemetryMeta{
+                .qos = 0,
+                .retain = false,
+                .content_type = TelemetryContentType::JSON,
+                .full_topic = false,
+                .offline = TelemetryOfflinePolicy::Drop,
+            }};
+        sample.stream = _streamsStream;
+        stamp(sample);
+        transmit(_topics.topic(_streamsStream), sample);
+    }
+
+    // Store-and-forward losses: the outbox is shared by every publisher, so these are device-wide
+    const MqttService::MqttOutbox::Stats ob = MqttService::MqttService::instance().outboxStats();
+    const int n = snprintf(_streamMsg, sizeof(_streamMsg),
+                           "{\"stream\":\"*\",\"t_us\":%u,\"outbox_replaced\":%u,\"outbox_evicted\":%u,"
+                           "\"outbox_rejected\":%u,\"pool_exhausted\":%u}",
+                           (unsigned)esp_timer_get_time(), (unsigned)ob.replaced, (unsigned)ob.evicted,
+                           (unsigned)ob.rejected, (unsigned)_pool.stats().exhausted);
+    if (n <= 0 || (size_t)n >= sizeof(_streamMsg))
+        return;
+    TelemetrySample sample{
+        .topic_suffix = TELEMETRY_STREAMS_TOPIC,
+        .payload = reinterpret_cast<const uint8_t *>(_streamMsg),
+        .payload_length = (size_t)n,
+        .meta = TelemetryMeta{
+            .qos = 0,
+            .retain = false,
+            .content_type = TelemetryContentType::JSON,
+            .full_topic = false,
+            .offline = TelemetryOfflinePolicy::Drop,
+        }};
+    sample.stream = _streamsStream;
+    stamp(sample);
+    transmit(_topics.topic(_streamsStream), sample);
+}
+
 void TelemetryService::_txThunk(void *arg)
 {
     static_cast<TelemetryService *>(arg)->_txLoop();
@@ -78,34 +719,303 @@ void TelemetryService::_txLoop()
     TelemetrySample s{};
     for (;;)
     {
-        if (xQueueReceive(_queue, &s, portMAX_DELAY) == pdTRUE)
+        // Sleep until the next sample, the open bundle's deadline or the next control period
+        const uint32_t now = (uint32_t)esp_timer_get_time();
+        if (TELEMETRY_RATE_CONTROL_MS > 0 && (int32_t)(now - _nextControlUs) >= 0)
+        {
+            controlRates();
+            _nextControlUs = now + TELEMETRY_RATE_CONTROL_MS * 1000u;
+        }
+        if (TELEMETRY_STREAM_STATS_MS > 0 && (int32_t)(now - _nextStreamStatsUs) >= 0)
         {
-            // Build final topic
-            String topic;
-            if (s.meta.full_topic)
+            publishStreamStats();
+            _nextStreamStatsUs = now + TELEMETRY_STREAM_STATS_MS * 1000u;
+        }
+        if ((int32_t)(now - _nextLeaseCheckUs) >= 0)
+        {
+            portENTER_CRITICAL(&_rateMux);
+            const uint32_t expired = _ctl.expire(millis());
+            portEXIT_CRITICAL(&_rateMux);
+            if (expired)
             {
-                topic = s.topic_suffix ? s.topic_suffix : "";
+                applyRates(expired);
+                _statusDirty = true;
             }
             else
             {
-                const size_t suffixLen = s.topic_suffix ? std::strlen(s.topic_suffix) : 0;
-                topic.reserve(_deviceId.length() + 1 + suffixLen);
-                topic = _deviceId;
-                topic += '/';
-                if (s.topic_suffix)
-                    topic += s.topic_suffix;
+                wakeIdleSampling(); // e.g. the blackbox started recording an idle provider
             }
+            if (_statusDirty.exchange(false))
+                publishStatus();
+            _nextLeaseCheckUs = now + TELEMETRY_LEASE_CHECK_MS * 1000u;
+        }
+        drainCommands(); // ahead of every sample, whatever its class
+        if (_bundler.due(now))
+        {
+            flushBundle(false);
+            continue;
+        }
+
+        uint32_t remainingUs = UINT32_MAX;
+        if (TELEMETRY_RATE_CONTROL_MS > 0)
+            remainingUs = _nextControlUs - now;
+        if (TELEMETRY_STREAM_STATS_MS > 0 && _nextStreamStatsUs - now < remainingUs)
+            remainingUs = _nextStreamStatsUs - now;
+        if (_nextLeaseCheckUs - now < remainingUs)
+            remainingUs = _nextLeaseCheckUs - now;
+        if (_bundler.pending() && _bundler.remainingUs(now) < remainingUs)
+            remainingUs = _bundler.remainingUs(now);
+        TickType_t wait = portMAX_DELAY;
+        if (remainingUs != UINT32_MAX)
+        {
+            wait = pdMS_TO_TICKS((remainingUs + 999) / 1000);
+            if (wait == 0)
+                wait = 1;
+        }
+
+        // Critical first, then control / bulk by weight; sleep until a producer notifies
+        portENTER_CRITICAL(&_txMux);
+        const bool got = _txq.pop(s);
+        portEXIT_CRITICAL(&_txMux);
+        if (!got)
+        {
+            ulTaskNotifyTake(pdTRUE, wait);
+            continue;
+        }
+
+        // Peak backlog for the rate controller, as pool use: the evicting classes are capped
+        // at their pool share, so their rings can't fill past it (this sample's buffer counts)
+        const uint8_t fill = _pool.fillPct(TelemetryClass::Bulk);
+        if (fill > _peakFillPct)
+            _peakFillPct = fill;
 
-            // Transmit now (do not stash pointers for later)
-            transmit(topic.c_str(), s);
+        // Registered streams: topic resolved at registration. Others: composed into scratch.
+        const char *topic = _topics.topic(s.stream);
+        if (!topic)
+            topic = _topics.compose(s.topic_suffix, s.meta.full_topic, _topicScratch, sizeof(_topicScratch));
+        if (!topic)
+        {
+            LOGW("Telemetry", "Topic too long, dropping sample");
+            _txStats.dropped++;
+            _pool.release(s.buffer);
+            continue;
+        }
+
+        // Transmit now (do not stash pointers for later)
+        if (streamRoutedUdp(s))
+        {
+            // Registered streams put their own seq and capture time on the wire
+            const bool ok = s.stream < TELEMETRY_MAX_STREAMS
+                                ? _udp.send(topic, s.payload, s.payload_length, (uint8_t)s.meta.content_type,
+                                            s.seq, s.t_us)
+                                : _udp.send(topic, s.payload, s.payload_length, (uint8_t)s.meta.content_type);
+            if (ok)
+                _txStats.udp_sent++;
+            else
+                _txStats.udp_failed++; // state streams: the next sample supersedes this one
+            _streamStats.transmitted(s.stream,
+                                     ok ? TelemetryStreamStats::Outcome::Sent : TelemetryStreamStats::Outcome::Failed,
+                                     s.t_us, (uint32_t)esp_timer_get_time());
+        }
+        else if (bundleEligible(s))
+        {
+            bundle(topic, s);
         }
+        else
+        {
+            transmit(topic, s);
+        }
+
+        // All paths copy the payload (TCP buffer / outbox / datagram / bundle), the buffer is free again
+        _pool.release(s.buffer);
     }
 }
 
-void TelemetryService::transmit(const char *topic, const TelemetrySample &s)
+bool TelemetryService::bundleEligible(const TelemetrySample &s) const
+{
+    // Bundles are QoS 0 and dropped while offline: only live streams qualify. Coalesce
+    // samples keep their own publish while MQTT is down, so the outbox holds their latest.
+    if (!_bundler.enabled() || _bundleStream == TELEMETRY_STREAM_NONE || s.meta.qos != 0 || s.meta.retain)
+        return false;
+    if (s.meta.offline == TelemetryOfflinePolicy::Fifo)
+        return false;
+    return s.meta.offline != TelemetryOfflinePolicy::Coalesce || MqttService::MqttService::instance().mqttConnected();
+}
+
+void TelemetryService::bundle(const char *topic, const TelemetrySample &s)
+{
+    // Records carry the suffix; the receiver re-adds the device prefix
+    const char *suffix = s.stream != TELEMETRY_STREAM_NONE ? _topics.suffix(s.stream) : s.topic_suffix;
+    const uint8_t content = (uint8_t)s.meta.content_type;
+
+    if (_bundledCount == TELEMETRY_BUNDLE_RECORDS_MAX)
+        flushBundle(true);
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    TelemetryBundler::AddResult r = _bundler.add(
+        suffix, s.meta.full_topic, content, s.payload, s.payload_length, now, s.seq, s.t_us);
+    if (r == TelemetryBundler::AddResult::Full)
+    {
+        flushBundle(true);
+        now = (uint32_t)esp_timer_get_time();
+        r = _bundler.add(suffix, s.meta.full_topic, content, s.payload, s.payload_length, now, s.seq, s.t_us);
+    }
+    if (r == TelemetryBundler::AddResult::Added)
+        _bundled[_bundledCount++] = BundledSample{s.stream, s.t_us}; // counted when the frame goes out
+    else
+        transmit(topic, s); // too large for a frame: publish on its own
+}
+
+void TelemetryService::flushBundle(bool full)
+{
+    const uint8_t *frame = nullptr;
+    const size_t len = _bundler.flush((uint32_t)esp_timer_get_time(), full, frame);
+    if (len == 0)
+        return;
+
+    TelemetrySample b{
+        .topic_suffix = TELEMETRY_BUNDLE_TOPIC,
+        .payload = frame,
+        .payload_length = len,
+        .meta = TelemetryMeta{
+            .qos = 0,
+            .retain = false,
+            .content_type = TelemetryContentType::BINARY,
+            .full_topic = false,
+            .offline = TelemetryOfflinePolicy::Drop, // a frame of old samples isn't worth keeping
+        }};
+    b.stream = _bundleStream;
+    stamp(b);
+    const bool sent = transmit(_topics.topic(_bundleStream), b);
+
+    // Each record's stream gets the frame's outcome, its age up to now
+    const uint32_t now = (uint32_t)esp_timer_get_time();
+    for (size_t i = 0; i < _bundledCount; ++i)
+        _streamStats.transmitted(_bundled[i].stream,
+                                 sent ? TelemetryStreamStats::Outcome::Sent : TelemetryStreamStats::Outcome::Failed,
+                                 _bundled[i].t_us, sent ? now : 0);
+    _bundledCount = 0;
+}
+
+void TelemetryService::controlRates()
+{
+    // Inputs over the last period: peak backlog, failed publishes (incl. samples skipped
+    // for lack of buffers) and the mean QoS1/2 ack RTT
+    const MqttService::AckStats acks = MqttService::MqttService::instance().ackStats();
+    const uint32_t exhausted = _pool.stats().exhausted;
+
+    TelemetryRateController::Input in{};
+    in.queue_fill_pct = _peakFillPct > 100 ? 100 : _peakFillPct;
+    in.failures = (_txStats.dropped - _lastTx.dropped) + (_txStats.backpressure - _lastTx.backpressure) +
+                  (exhausted - _lastExhausted);
+    const uint32_t acked = acks.acked - _lastAcked;
+    in.rtt_ms = acked ? (uint32_t)((acks.latency_sum_us - _lastAckSumUs) / acked / 1000u) : 0;
+
+    _peakFillPct = 0;
+    _lastTx = _txStats;
+    _lastExhausted = exhausted;
+    _lastAcked = acks.acked;
+    _lastAckSumUs = acks.latency_sum_us;
+
+    uint32_t rates[TELEMETRY_RATE_MAX_STREAMS];
+    ITelemetryProvider *providers[TELEMETRY_RATE_MAX_STREAMS];
+    size_t count;
+    portENTER_CRITICAL(&_rateMux);
+    const TelemetryRateController::Decision d = _rate.update(in);
+    count = _rate.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        rates[i] = _ctl.effective(i, _rate.rate(i)); // leased caps and idle streams win
+        providers[i] = _rateProviders[i];
+    }
+    portEXIT_CRITICAL(&_rateMux);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if ((d.changed & (1u << i)) && providers[i])
+            providers[i]->onSamplingRateChange(rates[i]);
+    }
+
+    // Publish changes, and the first period of a saturated episode
+    const bool report = d.changed != 0 ||
+                        (d.action == TelemetryRateController::Action::Saturated && _lastRateAction != d.action);
+    _lastRateAction = d.action;
+    if (report)
+        publishRateDecision(d.action, in, providers, rates, count);
+}
+
+void TelemetryService::publishRateDecision(TelemetryRateController::Action action,
+                                           const TelemetryRateController::Input &in,
+                                           ITelemetryProvider *const *providers, const uint32_t *rates, size_t count)
+{
+    int n = snprintf(_rateMsg, sizeof(_rateMsg), "{\"action\":\"%s\",\"fill\":%u,\"fail\":%u,\"rtt\":%u,\"rates\":{",
+                     TelemetryRateController::actionName(action), (unsigned)in.queue_fill_pct,
+                     (unsigned)in.failures, (unsigned)in.rtt_ms);
+    for (size_t i = 0; i < count && n > 0 && (size_t)n < sizeof(_rateMsg); ++i)
+    {
+        n += snprintf(_rateMsg + n, sizeof(_rateMsg) - n, "%s\"%s\":%u", i ? "," : "",
+                      providers[i] ? providers[i]->name() : "?", (unsigned)rates[i]);
+    }
+    if (n > 0 && (size_t)n < sizeof(_rateMsg))
+        n += snprintf(_rateMsg + n, sizeof(_rateMsg) - n, "}}");
+    if (n <= 0 || (size_t)n >= sizeof(_rateMsg))
+        return;
+
+    LOGI("Telemetry", "Rate %s: %s", TelemetryRateController::actionName(action), _rateMsg);
+
+    TelemetrySample sample{
+        .topic_suffix = TELEMETRY_RATE_TOPIC,
+        .payload = reinterpret_cast<const uint8_t *>(_rateMsg),
+        .payload_length = (size_t)n,
+        .meta = TelemetryMeta{
+            .qos = 0,
+            .retain = true, // the current rates, for anyone subscribing later
+            .content_type = TelemetryContentType::JSON,
+            .full_topic = false,
+            .offline = TelemetryOfflinePolicy::Coalesce,
+        }};
+    sample.stream = _rateStream;
+    stamp(sample);
+    const char *topic = _topics.topic(_rateStream);
+    if (topic)
+        transmit(topic, sample);
+}
+
+bool TelemetryService::transmit(const char *topic, const TelemetrySample &s)
 {
     // (For now) Publish directly through MQTT
-    MqttService::MqttService::instance().publish(
-        topic, reinterpret_cast<const char *>(s.payload), s.payload_length,
-        (MqttService::QoS)s.meta.qos, s.meta.retain);
+    auto &mqtt = MqttService::MqttService::instance();
+    for (int attempt = 0;; ++attempt)
+    {
+        const MqttService::PublishStatus st = mqtt.tryPublish(
+            topic, reinterpret_cast<const char *>(s.payload), s.payload_length,
+            (MqttService::QoS)s.meta.qos, s.meta.retain,
+            (MqttService::OfflinePolicy)s.meta.offline);
+
+        switch (st)
+        {
+        case MqttService::PublishStatus::Sent:
+            _txStats.sent++;
+            _streamStats.transmitted(s.stream, TelemetryStreamStats::Outcome::Sent, s.t_us,
+                                     (uint32_t)esp_timer_get_time());
+            return true;
+        case MqttService::PublishStatus::Buffered:
+            _txStats.buffered++;
+            _streamStats.transmitted(s.stream, TelemetryStreamStats::Outcome::Buffered, s.t_us,
+                                     (uint32_t)esp_timer_get_time());
+            return true;
+        case MqttService::PublishStatus::Backpressure:
+            _txStats.backpressure++;
+            if (attempt < TELEMETRY_TX_BACKPRESSURE_RETRIES)
+            {
+                vTaskDelay(1); // let the network task drain / acks arrive
+                continue;
+            }
+            break;
+        default:
+            break;
+        }
+        _txStats.dropped++;
+        _streamStats.transmitted(s.stream, TelemetryStreamStats::Outcome::Failed, s.t_us, 0);
+        return false;
+    }
 }
@@ -9,20 +9,199 @@ extern "C"
 #include "freertos/semphr.h"
 }
 #include "telemetry/itelemetry_provider.hpp"
+#include "telemetry/telemetry_bundle.hpp"
+#include "telemetry/telemetry_rate_controller.hpp"
+#include "telemetry/telemetry_stream_control.hpp"
+#include "telemetry/telemetry_class_queue.hpp"
+#include "telemetry/sample_scheduler.hpp"
+#include "esp_timer.h"
+#include "udp_telemetry_link.hpp"
+#include "i2c_bus.hpp"
+#include "mqtt_service.hpp"
 
-class TelemetryService
+#ifndef TELEMETRY_UDP_ROUTES_MAX
+#define TELEMETRY_UDP_ROUTES_MAX 8
+#endif
+
+#ifndef TELEMETRY_BUNDLE_WINDOW_MS
+#define TELEMETRY_BUNDLE_WINDOW_MS 20
+#endif
+
+#ifndef TELEMETRY_BUNDLE_TOPIC
+#define TELEMETRY_BUNDLE_TOPIC "telemetry/bundle"
+#endif
+
+#ifndef TELEMETRY_BUNDLE_RECORDS_MAX
+#define TELEMETRY_BUNDLE_RECORDS_MAX 48 // samples per frame; their outcome is counted when it is sent
+#endif
+
+#ifndef TELEMETRY_RATE_CONTROL_MS
+#define TELEMETRY_RATE_CONTROL_MS 500 // 0 disables adaptive rates
+#endif
+
+#ifndef TELEMETRY_RATE_TOPIC
+#define TELEMETRY_RATE_TOPIC "telemetry/rate"
+#endif
+
+#ifndef TELEMETRY_SAMPLE_TASK_PRIO
+#define TELEMETRY_SAMPLE_TASK_PRIO 18 // above everything but the network stack
+#endif
+
+#ifndef TELEMETRY_SAMPLE_TASK_STACK
+#define TELEMETRY_SAMPLE_TASK_STACK 8192
+#endif
+
+#ifndef TELEMETRY_SCHED_STATS_MS
+#define TELEMETRY_SCHED_STATS_MS 5000 // 0 = don't publish scheduler stats
+#endif
+
+#ifndef TELEMETRY_SCHED_TOPIC
+#define TELEMETRY_SCHED_TOPIC "telemetry/sched"
+#endif
+
+#ifndef TELEMETRY_I2C_TOPIC
+#define TELEMETRY_I2C_TOPIC "telemetry/i2c" // I2cBus stats, same cadence as the scheduler's
+#endif
+
+#ifndef TELEMETRY_STREAM_STATS_MS
+#define TELEMETRY_STREAM_STATS_MS 5000 // 0 = don't publish per-stream seq/drop/age stats
+#endif
+
+#ifndef TELEMETRY_STREAMS_TOPIC
+#define TELEMETRY_STREAMS_TOPIC "telemetry/streams"
+#endif
+
+#ifndef TELEMETRY_CTL_TOPIC
+#define TELEMETRY_CTL_TOPIC "telemetry/ctl" // ground commands, see telemetry_stream_control.hpp
+#endif
+
+#ifndef TELEMETRY_STATUS_TOPIC
+#define TELEMETRY_STATUS_TOPIC "telemetry/status" // retained: every provider's state and rate
+#endif
+
+#ifndef TELEMETRY_CTL_QUEUE_LEN
+#define TELEMETRY_CTL_QUEUE_LEN 4 // stream commands waiting for the TX task; more are dropped
+#endif
+
+#ifndef TELEMETRY_CTL_CMD_MAX
+#define TELEMETRY_CTL_CMD_MAX 64 // bytes per stream command (the MQTT mailbox payload limit)
+#endif
+
+#ifndef TELEMETRY_LEASE_CHECK_MS
+#define TELEMETRY_LEASE_CHECK_MS 250 // lease expiry resolution
+#endif
+
+class TelemetryService : public ITelemetrySink, public ISampleTrigger
 {
 public:
     static TelemetryService &instance();
 
+    /// Create the TX and sampling tasks. @p queueLen is the Bulk class's depth (see configureClass()),
+    /// at most its share of the buffer pool.
     void begin(const char *droneId, size_t queueLen = 64, UBaseType_t txPrio = 2,
-               uint32_t txStackWords = 4096, BaseType_t txCore = tskNO_AFFINITY); // create telemetry post task @ `tickHz`
+               uint32_t txStackWords = 4096, BaseType_t txCore = tskNO_AFFINITY);
     void addProvider(ITelemetryProvider *provider);
 
     /**
-     * @brief For i2c bus safety always request the handle before using the bus.
+     * @brief Add a provider whose rate the adaptive rate controller may lower (down to
+     * limits.minHz, least important priority first) while the uplink is congested.
+     * addProvider(provider) uses default limits (nominal / 10 .. nominal, priority 1).
+     *
+     * An OnDemand provider stays idle (onSamplingRateChange(0), not sampled) until a
+     * ground client leases it on TELEMETRY_CTL_TOPIC; see attachMqtt().
+     */
+    void addProvider(ITelemetryProvider *provider, const TelemetryRateLimits &limits,
+                     TelemetryDemand demand = TelemetryDemand::Continuous);
+
+    /**
+     * @brief Take stream commands on `<device>/` TELEMETRY_CTL_TOPIC (on/off/auto with a
+     * lease, see telemetry_stream_control.hpp) and publish every provider's state and rate,
+     * retained, on TELEMETRY_STATUS_TOPIC. Commands are applied on the TX task: the MQTT
+     * dispatch task copies them into a TELEMETRY_CTL_QUEUE_LEN deep queue without waiting
+     * and drops them (logged) when it is full.
+     * @note Call after begin().
+     */
+    void attachMqtt(MqttService::MqttService &mqtt);
+
+    /**
+     * @brief Depth, drop policy and round robin weight of one traffic class of the TX queue
+     * (see telemetry_class_queue.hpp). Samples pick their class with meta.traffic_class.
+     * DropOldest and LatestOnly classes get at most TelemetryBufferPool::queueShare(cls) entries,
+     * so they evict before their providers run out of pool buffers.
+     * @note Configure before adding providers: a class that holds samples can't be changed.
+     */
+    bool configureClass(TelemetryClass cls, const TelemetryClassConfig &cfg);
+
+    /// Queued / sent / dropped counters of one traffic class; also published on TELEMETRY_STREAMS_TOPIC.
+    TelemetryClassQueue::Stats classStats(TelemetryClass cls) const;
+
+    /// ITelemetrySink: providers' publish() lands here (any task).
+    bool enqueue(const TelemetrySample &sample, TickType_t timeoutTicks, bool latestOnly) override;
+
+    /// ISampleTrigger: a triggered provider's interrupt wakes the sampling task.
+    void triggerFromISR(int slot, uint64_t isrUs) override;
+
+    /// Command / lease counters of the stream control table.
+    TelemetryStreamControl::Stats controlStats() const { return _ctl.stats(); }
+
+    /**
+     * @brief Send the streams selected with routeUdp() as datagrams to @p host:@p port
+     * instead of over MQTT. Logs and commands stay on MQTT.
+     * @note Configure before begin(); the TX task reads the routing table without locking,
+     * so both return false once it runs.
+     */
+    bool beginUdp(const IPAddress &host, uint16_t port);
+
+    /// @brief Route samples with this topic suffix over UDP (see beginUdp()). Before begin().
+    bool routeUdp(const char *topicSuffix);
+
+    const UdpTelemetryLink::Stats &udpStats() const { return _udp.stats(); }
+
+    /**
+     * @brief Collect live samples (QoS 0, not retained, not Fifo, not UDP-routed) for up to
+     * @p windowMs, or until @p maxBytes, and publish them as one frame on
+     * `<device>/` TELEMETRY_BUNDLE_TOPIC (see telemetry_bundle.hpp). 0 disables.
+     * @note Configure after begin() and before adding providers.
+     */
+    void enableBundling(uint32_t windowMs = TELEMETRY_BUNDLE_WINDOW_MS, size_t maxBytes = TELEMETRY_BUNDLE_MAX_BYTES)
+    {
+        _bundler.configure(windowMs * 1000u, maxBytes);
+    }
+
+    /**
+     * @brief Deadline-miss / jitter stats of a scheduled provider for the current stats
+     * window (reset every TELEMETRY_SCHED_STATS_MS after publishing).
+     * @return false if @p provider isn't scheduled.
      */
-    SemaphoreHandle_t i2cMutex() const { return _i2cMutex; };
+    bool samplingStats(const ITelemetryProvider *provider, SampleScheduler::Stats &out) const;
+
+    /// Adaptive rate controller counters; decisions are also published on TELEMETRY_RATE_TOPIC.
+    TelemetryRateController::Stats rateStats() const { return _rate.stats(); }
+
+    /// Efficiency (samples/bundle, framing overhead) vs added latency (hold times).
+    const TelemetryBundler::Stats &bundleStats() const { return _bundler.stats(); }
+
+    /// Shared payload pool; `exhausted` counts samples providers had to skip.
+    TelemetryBufferPool::Stats poolStats() const { return _pool.stats(); }
+
+    struct TxStats
+    {
+        uint32_t sent;         ///< Handed to MQTT
+        uint32_t udp_sent;     ///< Handed to the UDP fast path
+        uint32_t udp_failed;   ///< UDP route could not send (link down, too large); not retried
+        uint32_t buffered;     ///< Kept in the MQTT outbox for later
+        uint32_t backpressure; ///< Publish attempts refused by MQTT flow control (incl. retries)
+        uint32_t dropped;      ///< Gave up on the sample
+    };
+    TxStats txStats() const { return _txStats; }
+
+    /**
+     * @brief Sequence number, per-stage drops and capture-to-send age of a registered stream
+     * (see telemetry_stream_stats.hpp). Published on TELEMETRY_STREAMS_TOPIC every
+     * TELEMETRY_STREAM_STATS_MS, which also starts a new age window.
+     * @note Counters are owned by the TX task; read from elsewhere they may be mid-update.
+     */
+    TelemetryStreamStats::Snapshot streamStats(TelemetryStreamId stream) { return _streamStats.snapshot(stream, false); }
 
 private:
     explicit TelemetryService() = default;
@@ -30,12 +209,93 @@ private:
     static void _txThunk(void *arg);
     void _txLoop();
 
-    void transmit(const char *topic, const TelemetrySample &s);
+    static void _sampleThunk(void *arg);
+    static void _sampleTimerCb(void *arg);
+    void _sampleLoop();
+    void publishSchedStats();
+    void publishBusStats();
+    bool publishStats(TelemetryLease &lease, int len, const char *topicSuffix, TelemetryStreamId stream);
+    void publishStreamStats();
+    void stamp(TelemetrySample &s);
+    void drainCommands();
+    void handleCommand(const char *cmd, size_t len);
+    void applyRates(uint32_t changed);
+    void wakeIdleSampling();
+    void publishStatus();
+
+    bool transmit(const char *topic, const TelemetrySample &s);
+    bool routedUdp(const char *topicSuffix) const;
+    bool streamRoutedUdp(const TelemetrySample &s);
+    bool bundleEligible(const TelemetrySample &s) const;
+    void bundle(const char *topic, const TelemetrySample &s);
+    void flushBundle(bool full);
+    void controlRates();
+    void publishRateDecision(TelemetryRateController::Action action, const TelemetryRateController::Input &in,
+                             ITelemetryProvider *const *providers, const uint32_t *rates, size_t count);
 
 private:
     std::vector<ITelemetryProvider *> _providers;
-    QueueHandle_t _queue{nullptr};
-    TaskHandle_t _txTask{nullptr};
-    SemaphoreHandle_t _i2cMutex{nullptr};
-    String _deviceId{"Drone"};
+    TelemetryBufferPool _pool;
+    mutable portMUX_TYPE _txMux = portMUX_INITIALIZER_UNLOCKED;
+    TelemetryClassQueue _txq; // producers push, the TX task pops; both under _txMux
+    TaskHandle_t _txTask{nullptr}; // notified on every push
+    TelemetryTopicTable _topics;
+    char _topicScratch[TELEMETRY_TOPIC_MAX]{}; // unregistered samples, TX task only
+    TxStats _txStats{}; // written by the TX task only
+    TelemetryStreamStats _streamStats; // stamped by producers, outcomes by the TX task
+    TelemetryStreamId _streamsStream{TELEMETRY_STREAM_NONE};
+    uint32_t _nextStreamStatsUs{0}; // TX task only
+    char _streamMsg[256]{};
+
+    UdpTelemetryLink _udp;
+    const char *_udpRoutes[TELEMETRY_UDP_ROUTES_MAX]{};
+    size_t _udpRouteCount{0};
+    int8_t _streamUdp[TELEMETRY_MAX_STREAMS]; // -1 = not decided yet, TX task only
+
+    TelemetryBundler _bundler; // TX task only (after configuration)
+    TelemetryStreamId _bundleStream{TELEMETRY_STREAM_NONE};
+    struct BundledSample
+    {
+        TelemetryStreamId stream;
+        uint32_t t_us;
+    };
+    BundledSample _bundled[TELEMETRY_BUNDLE_RECORDS_MAX]{}; // the open frame's samples, TX task only
+    size_t _bundledCount{0};
+
+    // Adaptive rates: providers are added from setup() while the TX task runs the controller
+    portMUX_TYPE _rateMux = portMUX_INITIALIZER_UNLOCKED;
+    TelemetryRateController _rate;
+    TelemetryStreamControl _ctl; // same indices as _rate; commands and expiry on the TX task
+    ITelemetryProvider *_rateProviders[TELEMETRY_RATE_MAX_STREAMS]{};
+    TelemetryStreamId _rateStream{TELEMETRY_STREAM_NONE};
+    uint32_t _nextControlUs{0};
+    uint8_t _peakFillPct{0}; // TX task only, since the last control period
+    TelemetryRateController::Action _lastRateAction{TelemetryRateController::Action::Hold};
+    TxStats _lastTx{};
+    uint32_t _lastAcked{0};
+    uint64_t _lastAckSumUs{0};
+    uint32_t _lastExhausted{0};
+    char _rateMsg[256]{};
+
+    // Ground-controlled leases
+    struct CtlCommand
+    {
+        uint16_t len;
+        char text[TELEMETRY_CTL_CMD_MAX];
+    };
+    QueueHandle_t _ctlQueue{nullptr}; // CtlCommand, MQTT dispatch task -> TX task
+    TelemetryStreamId _statusStream{TELEMETRY_STREAM_NONE};
+    uint32_t _nextLeaseCheckUs{0}; // TX task only
+    std::atomic<bool> _statusDirty{false}; // providers added / control attached: republish the status
+    char _statusMsg[512]{};
+
+    // Sampling scheduler: one task for all scheduled providers, woken by a µs one-shot timer
+    mutable portMUX_TYPE _schedMux = portMUX_INITIALIZER_UNLOCKED;
+    SampleScheduler _sched;
+    ITelemetryProvider *_schedProviders[SAMPLE_SCHEDULER_MAX_ENTRIES]{};
+    TaskHandle_t _sampleTask{nullptr};
+    esp_timer_handle_t _sampleTimer{nullptr};
+    TelemetryStreamId _schedStream{TELEMETRY_STREAM_NONE};
+    TelemetryStreamId _i2cStream{TELEMETRY_STREAM_NONE};
+    uint64_t _nextSchedStatsUs{0}; // sampling task only
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "async_mqtt_transport.hpp"
+
+AsyncMqttTransport::AsyncMqttTransport()
+{
+    // Forward client events through the interface callbacks (looked up at call time,
+    // so they may be set after construction)
+    _client.onConnect(
+        [this](bool sp)
+        { if (_onConnect) _onConnect(sp); });
+    _client.onDisconnect(
+        [this](AsyncMqttClientDisconnectReason reason)
+        { if (_onDisconnect) _onDisconnect(static_cast<uint8_t>(reason)); });
+    _client.onSubscribe(
+        [this](uint16_t id, uint8_t qos)
+        { if (_onSubscribe) _onSubscribe(id, qos); });
+    _client.onUnsubscribe(
+        [this](uint16_t id)
+        { if (_onUnsubscribe) _onUnsubscribe(id); });
+    _client.onMessage(
+        [this](
+            char *topic, char *payload,
+            AsyncMqttClientMessageProperties props,
+            size_t len, size_t index, size_t total)
+        {
+            if (_onMessage)
+                _onMessage(topic, reinterpret_cast<const uint8_t *>(payload), len,
+                           MqttMessageProperties{props.qos, props.dup, props.retain}, index, total);
+        });
+    _client.onPublish(
+        [this](uint16_t id)
+        { if (_onPublish) _onPublish(id); });
+}
+
+void AsyncMqttTransport::setServer(const IPAddress &host, uint16_t port)
+{
+    _host = host;
+    _port = port;
+    _client.setServer(_host, _port);
+}
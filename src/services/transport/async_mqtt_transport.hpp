@@ -0,0 +1,36 @@
+#pragma once
+#include "imqtt_transport.hpp"
+
+#include <Arduino.h>
+#include <AsyncMqttClient.h>
+
+/**
+ * @brief IMqttTransport backed by AsyncMqttClient (firmware default).
+ */
+class AsyncMqttTransport final : public IMqttTransport
+{
+public:
+    AsyncMqttTransport();
+
+    void setServer(const IPAddress &host, uint16_t port);
+
+    bool configured() const override { return _host != IPAddress() && _port != 0; }
+    void setCleanSession(bool clean) override { _client.setCleanSession(clean); }
+    void connect() override { _client.connect(); }
+    void disconnect() override { _client.disconnect(); }
+    bool connected() const override { return _client.connected(); }
+
+    uint16_t publish(const char *topic, uint8_t qos, bool retain,
+                     const char *payload, size_t len) override
+    {
+        return _client.publish(topic, qos, retain, payload, len);
+    }
+    uint16_t subscribe(const char *topic, uint8_t qos) override { return _client.subscribe(topic, qos); }
+    uint16_t unsubscribe(const char *topic) override { return _client.unsubscribe(topic); }
+    // subscribeMany(): AsyncMqttClient 0.9 has no multi-filter SUBSCRIBE, the default loop applies
+
+private:
+    AsyncMqttClient _client;
+    IPAddress _host{};
+    uint16_t _port{0};
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+/**
+ * @file imqtt_transport.hpp
+ * @brief Minimal MQTT client interface underneath MqttService.
+ *
+ * Implementations:
+ * - AsyncMqttTransport: AsyncMqttClient over Wi-Fi (firmware default)
+ * - LoopbackTransport: in-process broker stand-in with a simulated link (host benchmarks)
+ *
+ * Callbacks are invoked from the transport's own context (async_tcp task, or the
+ * loopback broker thread) and must stay short. Kept free of Arduino types so it
+ * also builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+
+struct MqttMessageProperties
+{
+    uint8_t qos;
+    bool dup;
+    bool retain;
+};
+
+class IMqttTransport
+{
+public:
+    using ConnectCallback = std::function<void(bool sessionPresent)>;
+    using DisconnectCallback = std::function<void(uint8_t reason)>;
+    using SubscribeCallback = std::function<void(uint16_t packetId, uint8_t qos)>;
+    using PacketCallback = std::function<void(uint16_t packetId)>;
+    using MessageCallback = std::function<void(
+        const char *topic, const uint8_t *payload, size_t len,
+        const MqttMessageProperties &props, size_t index, size_t total)>;
+
+    virtual ~IMqttTransport() = default;
+
+    /// @return false if the transport lacks configuration (e.g. no server set).
+    virtual bool configured() const { return true; }
+
+    /// MQTT cleanSession flag for the next connect(). false = broker keeps subscriptions
+    /// (and QoS1/2 messages) across disconnects and reports sessionPresent.
+    virtual void setCleanSession(bool clean) { (void)clean; }
+
+    virtual void connect() = 0;
+    virtual void disconnect() = 0;
+    virtual bool connected() const = 0;
+
+    /// @return Packet id (QoS1/2), 1 for QoS0, or 0 if the message was not queued.
+    virtual uint16_t publish(const char *topic, uint8_t qos, bool retain,
+                             const char *payload, size_t len) = 0;
+    /// @return Packet id, or 0 on failure.
+    virtual uint16_t subscribe(const char *topic, uint8_t qos) = 0;
+    virtual uint16_t unsubscribe(const char *topic) = 0;
+
+    /**
+     * @brief Subscribe to several filters. Transports that can send them in one SUBSCRIBE
+     * packet (one SUBACK) override this; the default sends one packet per filter.
+     * @return Id of the last SUBSCRIBE packet (its SUBACK comes last), 0 if any failed.
+     */
+    virtual uint16_t subscribeMany(const char *const *topics, const uint8_t *qos, size_t count)
+    {
+        uint16_t id = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            id = subscribe(topics[i], qos[i]);
+            if (id == 0)
+                return 0;
+        }
+        return id;
+    }
+
+    void onConnect(ConnectCallback cb) { _onConnect = std::move(cb); }
+    void onDisconnect(DisconnectCallback cb) { _onDisconnect = std::move(cb); }
+    void onSubscribe(SubscribeCallback cb) { _onSubscribe = std::move(cb); }
+    void onUnsubscribe(PacketCallback cb) { _onUnsubscribe = std::move(cb); }
+    void onMessage(MessageCallback cb) { _onMessage = std::move(cb); }
+    void onPublish(PacketCallback cb) { _onPublish = std::move(cb); }
+
+    /// Drop every callback (owner switching transports). Only while no callback can run.
+    void clearCallbacks()
+    {
+        _onConnect = nullptr;
+        _onDisconnect = nullptr;
+        _onSubscribe = nullptr;
+        _onUnsubscribe = nullptr;
+        _onMessage = nullptr;
+        _onPublish = nullptr;
+    }
+
+protected:
+    ConnectCallback _onConnect{};
+    DisconnectCallback _onDisconnect{};
+    SubscribeCallback _onSubscribe{};
+    PacketCallback _onUnsubscribe{};
+    MessageCallback _onMessage{};
+    PacketCallback _onPublish{};
+};
+
+/**
+ * @brief MQTT topic filter match per spec ('+' single level, trailing '#' multi level).
+ */
+inline bool mqttTopicMatches(const char *filter, const char *topic)
+{
+    const char *f = filter;
+    const char *t = topic;
+
+    while (*f && *t)
+    {
+        // read next token from filter
+        const char *fstart = f;
+        while (*f && *f != '/')
+            ++f;
+        const size_t flen = size_t(f - fstart);
+
+        // read next token from topic
+        const char *tstart = t;
+        while (*t && *t != '/')
+            ++t;
+        const size_t tlen = size_t(t - tstart);
+
+        if (flen == 1 && fstart[0] == '+')
+        {
+            // single-level wildcard: always matches this level
+        }
+        else if (flen == 1 && fstart[0] == '#')
+        {
+            // multi-level wildcard: must be last in filter
+            return true;
+        }
+        else if (flen != tlen || memcmp(fstart, tstart, flen) != 0)
+        {
+            return false;
+        }
+
+        if (*f == '/')
+            ++f;
+        if (*t == '/')
+            ++t;
+    }
+
+    // If filter has trailing '#', it matches remaining topic
+    if (*f == '#' && (f == filter || *(f - 1) == '/') && *(f + 1) == '\0')
+    {
+        return true;
+    }
+
+    // Both must end at the same time (no leftover levels)
+    return *f == '\0' && *t == '\0';
+}
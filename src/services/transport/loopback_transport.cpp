@@ -0,0 +1,437 @@
+#include "loopback_transport.hpp"
+
+#include <chrono>
+#include <memory>
+
+namespace
+{
+    constexpr size_t kTcpIpOverhead = 40; // IPv4 + TCP headers, no options
+    constexpr size_t kControlPacket = 4 + kTcpIpOverhead; // CONNACK/PUBACK/SUBACK...
+    constexpr size_t kConnectPacket = 32 + kTcpIpOverhead;
+} // namespace
+
+// ===== LoopbackBroker ========================================================
+LoopbackBroker::LoopbackBroker()
+    : _worker([this]
+              { run(); })
+{
+}
+
+LoopbackBroker::~LoopbackBroker()
+{
+    {
+        std::lock_guard<std::mutex> lk(_mx);
+        _stop = true;
+    }
+    _cv.notify_all();
+    _worker.join();
+}
+
+uint64_t LoopbackBroker::nowUs()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+size_t LoopbackBroker::publishWireBytes(size_t topicLen, size_t payloadLen, uint8_t qos)
+{
+    const size_t remaining = 2 + topicLen + (qos ? 2 : 0) + payloadLen;
+    const size_t lenBytes = remaining < 128 ? 1 : (remaining < 16384 ? 2 : 3);
+    return 1 + lenBytes + remaining + kTcpIpOverhead;
+}
+
+LoopbackBroker::Stats LoopbackBroker::stats() const
+{
+    std::lock_guard<std::mutex> lk(_mx);
+    return _stats;
+}
+
+bool LoopbackBroker::waitIdle(uint32_t timeoutMs)
+{
+    std::unique_lock<std::mutex> lk(_mx);
+    return _cv.wait_for(lk, std::chrono::milliseconds(timeoutMs),
+                        [this]
+                        { return _events.empty() && !_busy; });
+}
+
+void LoopbackBroker::postLocked(uint64_t atUs, std::function<void()> fn)
+{
+    _events.push(Event{atUs, _order++, std::move(fn)});
+    _cv.notify_all();
+}
+
+LoopbackTransport *LoopbackBroker::clientLocked(int id) const
+{
+    auto it = _clients.find(id);
+    return it == _clients.end() ? nullptr : it->second;
+}
+
+int LoopbackBroker::attach(LoopbackTransport *t)
+{
+    std::lock_guard<std::mutex> lk(_mx);
+    const int id = _nextClient++;
+    _clients[id] = t;
+    return id;
+}
+
+void LoopbackBroker::detach(int id)
+{
+    std::unique_lock<std::mutex> lk(_mx);
+    _clients.erase(id);
+    for (auto it = _subs.begin(); it != _subs.end();)
+        it = (it->client == id) ? _subs.erase(it) : it + 1;
+    // Don't return while the worker may still be inside one of this client's callbacks
+    if (std::this_thread::get_id() != _worker.get_id())
+        _cv.wait(lk, [this]
+                 { return !_busy; });
+}
+
+void LoopbackBroker::route(int fromClient, const std::string &topic, const std::vector<uint8_t> &payload,
+                           uint8_t qos, bool retain)
+{
+    (void)fromClient;
+    auto body = std::make_shared<const std::vector<uint8_t>>(payload);
+    auto name = std::make_shared<const std::string>(topic);
+
+    std::lock_guard<std::mutex> lk(_mx);
+    _stats.published++;
+    _stats.bytes_up += publishWireBytes(topic.size(), payload.size(), qos);
+
+    bool routed = false;
+    const uint64_t now = nowUs();
+    for (const auto &sub : _subs)
+    {
+        if (!mqttTopicMatches(sub.filter.c_str(), topic.c_str()))
+            continue;
+        LoopbackTransport *c = clientLocked(sub.client);
+        if (!c)
+            continue;
+
+        routed = true;
+        const uint8_t q = qos < sub.qos ? qos : sub.qos;
+        const size_t bytes = publishWireBytes(topic.size(), payload.size(), q);
+        uint64_t at = 0;
+        if (!c->_down.schedule(bytes, now, at))
+        {
+            continue;
+        }
+        _stats.bytes_down += bytes;
+
+        const int cid = sub.client;
+        postLocked(at, [this, cid, name, body, q, retain]
+                   {
+            LoopbackTransport *t = nullptr;
+            {
+                std::lock_guard<std::mutex> lk2(_mx);
+                t = clientLocked(cid);
+                if (!t || !t->connected())
+                    return;
+                _stats.delivered++;
+            }
+            if (t->_onMessage)
+                t->_onMessage(name->c_str(), body->data(), body->size(),
+                              MqttMessageProperties{q, false, retain}, 0, body->size()); });
+    }
+    if (!routed)
+        _stats.unrouted++;
+}
+
+void LoopbackBroker::run()
+{
+    std::unique_lock<std::mutex> lk(_mx);
+    for (;;)
+    {
+        if (_stop)
+            return;
+        if (_events.empty())
+        {
+            _cv.wait(lk);
+            continue;
+        }
+        const uint64_t at = _events.top().at_us;
+        const uint64_t now = nowUs();
+        if (at > now)
+        {
+            _cv.wait_for(lk, std::chrono::microseconds(at - now));
+            continue;
+        }
+
+        std::function<void()> fn = std::move(const_cast<Event &>(_events.top()).fn);
+        _events.pop();
+        _busy = true;
+        lk.unlock();
+        fn();
+        lk.lock();
+        _busy = false;
+        _cv.notify_all();
+    }
+}
+
+// ===== LoopbackTransport =====================================================
+LoopbackTransport::LoopbackTransport(LoopbackBroker &broker, const LinkModel &uplink,
+                                     const LinkModel &downlink, uint32_t seed)
+    : _broker(broker), _id(broker.attach(this)),
+      _up(uplink, /*reliable*/ true, seed), _down(downlink, /*reliable*/ true, seed * 7919u + 1u)
+{
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+    _broker.detach(_id);
+}
+
+void LoopbackTransport::setLinks(const LinkModel &uplink, const LinkModel &downlink)
+{
+    std::lock_guard<std::mutex> lk(_broker._mx);
+    _up.setModel(uplink);
+    _down.setModel(downlink);
+}
+
+uint16_t LoopbackTransport::nextPacketId()
+{
+    if (++_packetId == 0)
+        _packetId = 1;
+    return _packetId;
+}
+
+void LoopbackTransport::setCleanSession(bool clean)
+{
+    std::lock_guard<std::mutex> lk(_broker._mx);
+    _cleanSession = clean;
+}
+
+void LoopbackTransport::connect()
+{
+    std::lock_guard<std::mutex> lk(_broker._mx);
+    if (_connected || _connecting)
+        return;
+    _connecting = true;
+
+    uint64_t at = 0;
+    _up.schedule(kConnectPacket, LoopbackBroker::nowUs(), at);
+    const int id = _id;
+    LoopbackBroker *b = &_broker;
+    b->postLocked(at, [b, id]
+                  {
+        LoopbackTransport *t = nullptr;
+        {
+            // Broker got CONNECT -> CONNACK back down
+            std::lock_guard<std::mutex> lk2(b->_mx);
+            t = b->clientLocked(id);
+            if (!t)
+                return;
+            if (t->_cleanSession)
+            {
+                for (auto it = b->_subs.begin(); it != b->_subs.end();)
+                    it = (it->client == id) ? b->_subs.erase(it) : it + 1;
+            }
+            const bool sessionPresent = !t->_cleanSession && t->_hasSession;
+            t->_hasSession = !t->_cleanSession;
+
+            uint64_t at2 = 0;
+            t->_down.schedule(kControlPacket, LoopbackBroker::nowUs(), at2);
+            b->postLocked(at2, [b, id, sessionPresent]
+                          {
+                LoopbackTransport *c = nullptr;
+                {
+                    std::lock_guard<std::mutex> lk3(b->_mx);
+                    c = b->clientLocked(id);
+                    if (!c || !c->_connecting)
+                        return;
+                    c->_connecting = false;
+                    c->_connected = true;
+                }
+                if (c->_onConnect)
+                    c->_onConnect(sessionPresent); });
+        } });
+}
+
+void LoopbackTransport::disconnect()
+{
+    std::lock_guard<std::mutex> lk(_broker._mx);
+    const bool was = _connected.exchange(false) || _connecting;
+    _connecting = false;
+    // Clean session: the broker forgets our subscriptions; otherwise they survive until the next connect
+    if (_cleanSession)
+    {
+        for (auto it = _broker._subs.begin(); it != _broker._subs.end();)
+            it = (it->client == _id) ? _broker._subs.erase(it) : it + 1;
+    }
+    if (!was)
+        return;
+
+    const int id = _id;
+    LoopbackBroker *b = &_broker;
+    b->postLocked(LoopbackBroker::nowUs(), [b, id]
+                  {
+        LoopbackTransport *t = nullptr;
+        {
+            std::lock_guard<std::mutex> lk2(b->_mx);
+            t = b->clientLocked(id);
+        }
+        if (t && t->_onDisconnect)
+            t->_onDisconnect(0); });
+}
+
+uint16_t LoopbackTransport::publish(const char *topic, uint8_t qos, bool retain,
+                                    const char *payload, size_t len)
+{
+    if (!topic)
+        return 0;
+    std::lock_guard<std::mutex> lk(_broker._mx);
+    if (!_connected)
+        return 0;
+
+    const uint16_t pid = qos ? nextPacketId() : 1;
+    const size_t n = payload ? (len ? len : strlen(payload)) : 0;
+    std::string name(topic);
+    std::vector<uint8_t> body(reinterpret_cast<const uint8_t *>(payload),
+                              reinterpret_cast<const uint8_t *>(payload) + n);
+
+    uint64_t at = 0;
+    _up.schedule(LoopbackBroker::publishWireBytes(name.size(), n, qos), LoopbackBroker::nowUs(), at);
+
+    const int id = _id;
+    LoopbackBroker *b = &_broker;
+    b->postLocked(at, [b, id, pid, qos, retain, name = std::move(name), body = std::move(body)]
+                  {
+        b->route(id, name, body, qos, retain);
+        if (qos == 0)
+            return;
+
+        // PUBACK (QoS1) or PUBREC/PUBREL/PUBCOMP (QoS2, one extra round trip)
+        std::lock_guard<std::mutex> lk2(b->_mx);
+        LoopbackTransport *t = b->clientLocked(id);
+        if (!t)
+            return;
+        uint64_t ackAt = 0;
+        t->_down.schedule(kControlPacket, LoopbackBroker::nowUs(), ackAt);
+        if (qos == 2)
+        {
+            uint64_t relAt = 0;
+            t->_up.schedule(kControlPacket, ackAt, relAt);
+            t->_down.schedule(kControlPacket, relAt, ackAt);
+        }
+        b->postLocked(ackAt, [b, id, pid]
+                      {
+            LoopbackTransport *c = nullptr;
+            {
+                std::lock_guard<std::mutex> lk3(b->_mx);
+                c = b->clientLocked(id);
+                if (!c || !c->connected())
+                    return;
+            }
+            if (c->_onPublish)
+                c->_onPublish(pid); }); });
+    return pid;
+}
+
+uint16_t LoopbackTransport::subscribe(const char *topic, uint8_t qos)
+{
+    if (!topic)
+        return 0;
+    return sendSubscribe({{std::string(topic), qos}});
+}
+
+uint16_t LoopbackTransport::subscribeMany(const char *const *topics, const uint8_t *qos, size_t count)
+{
+    std::vector<std::pair<std::string, uint8_t>> filters;
+    filters.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!topics[i])
+            return 0;
+        filters.emplace_back(topics[i], qos[i]);
+    }
+    return filters.empty() ? 0 : sendSubscribe(std::move(filters));
+}
+
+uint16_t LoopbackTransport::sendSubscribe(std::vector<std::pair<std::string, uint8_t>> filters)
+{
+    std::lock_guard<std::mutex> lk(_broker._mx);
+    if (!_connected)
+        return 0;
+
+    const uint16_t pid = nextPacketId();
+    size_t bytes = kControlPacket;
+    for (const auto &f : filters)
+        bytes += 3 + f.first.size(); // length prefix + options byte
+    uint64_t at = 0;
+    _up.schedule(bytes, LoopbackBroker::nowUs(), at);
+    _subscribePackets++;
+
+    const int id = _id;
+    LoopbackBroker *b = &_broker;
+    b->postLocked(at, [b, id, pid, filters = std::move(filters)]
+                  {
+        std::lock_guard<std::mutex> lk2(b->_mx);
+        LoopbackTransport *t = b->clientLocked(id);
+        if (!t)
+            return;
+        for (const auto &f : filters)
+        {
+            bool replaced = false;
+            for (auto &s : b->_subs)
+            {
+                if (s.client == id && s.filter == f.first)
+                {
+                    s.qos = f.second;
+                    replaced = true;
+                }
+            }
+            if (!replaced)
+                b->_subs.push_back(LoopbackBroker::Subscription{id, f.first, f.second});
+        }
+
+        // One SUBACK for the whole packet; reports the first filter's QoS like a single-topic client would
+        const uint8_t qos = filters.front().second;
+        uint64_t ackAt = 0;
+        t->_down.schedule(kControlPacket + filters.size(), LoopbackBroker::nowUs(), ackAt);
+        b->postLocked(ackAt, [b, id, pid, qos]
+                      {
+            LoopbackTransport *c = nullptr;
+            {
+                std::lock_guard<std::mutex> lk3(b->_mx);
+                c = b->clientLocked(id);
+            }
+            if (c && c->_onSubscribe)
+                c->_onSubscribe(pid, qos); }); });
+    return pid;
+}
+
+uint16_t LoopbackTransport::unsubscribe(const char *topic)
+{
+    if (!topic)
+        return 0;
+    std::lock_guard<std::mutex> lk(_broker._mx);
+    if (!_connected)
+        return 0;
+
+    const uint16_t pid = nextPacketId();
+    uint64_t at = 0;
+    _up.schedule(kControlPacket + strlen(topic), LoopbackBroker::nowUs(), at);
+
+    const int id = _id;
+    LoopbackBroker *b = &_broker;
+    b->postLocked(at, [b, id, pid, filter = std::string(topic)]
+                  {
+        std::lock_guard<std::mutex> lk2(b->_mx);
+        LoopbackTransport *t = b->clientLocked(id);
+        if (!t)
+            return;
+        for (auto it = b->_subs.begin(); it != b->_subs.end();)
+            it = (it->client == id && it->filter == filter) ? b->_subs.erase(it) : it + 1;
+
+        uint64_t ackAt = 0;
+        t->_down.schedule(kControlPacket, LoopbackBroker::nowUs(), ackAt);
+        b->postLocked(ackAt, [b, id, pid]
+                      {
+            LoopbackTransport *c = nullptr;
+            {
+                std::lock_guard<std::mutex> lk3(b->_mx);
+                c = b->clientLocked(id);
+            }
+            if (c && c->_onUnsubscribe)
+                c->_onUnsubscribe(pid); }); });
+    return pid;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+/**
+ * @file loopback_transport.hpp
+ * @brief In-process MQTT broker stand-in for host-side throughput/latency tests.
+ *
+ * A LoopbackBroker runs one worker thread that delivers timed events (CONNACK,
+ * PUBLISH fan-out, PUBACK, SUBACK) to attached LoopbackTransport clients. Each
+ * client has its own uplink and downlink SimLink, so latency, bandwidth and loss
+ * can be set per client. Callbacks run on the broker thread, like they would on
+ * the async_tcp task on target.
+ *
+ * Host only (std::thread); excluded from the firmware build.
+ */
+
+#include "imqtt_transport.hpp"
+#include "sim_link.hpp"
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class LoopbackTransport;
+
+class LoopbackBroker
+{
+public:
+    struct Stats
+    {
+        uint64_t published;  ///< PUBLISH packets received by the broker
+        uint64_t delivered;  ///< PUBLISH packets delivered to subscribers
+        uint64_t unrouted;   ///< Received with no matching subscriber
+        uint64_t bytes_up;   ///< Client -> broker, incl. header estimate
+        uint64_t bytes_down; ///< Broker -> client, incl. header estimate
+    };
+
+    LoopbackBroker();
+    ~LoopbackBroker();
+    LoopbackBroker(const LoopbackBroker &) = delete;
+    LoopbackBroker &operator=(const LoopbackBroker &) = delete;
+
+    Stats stats() const;
+
+    /// Block until no events are pending (or @p timeoutMs passes). @return true if idle.
+    bool waitIdle(uint32_t timeoutMs = 5000);
+
+    /// Monotonic host time in microseconds (shared time base for tests).
+    static uint64_t nowUs();
+
+    /// Approximate on-wire size of an MQTT PUBLISH (fixed header, topic, id, TCP/IP).
+    static size_t publishWireBytes(size_t topicLen, size_t payloadLen, uint8_t qos);
+
+private:
+    friend class LoopbackTransport;
+
+    struct Event
+    {
+        uint64_t at_us;
+        uint64_t order; // FIFO among equal timestamps
+        std::function<void()> fn;
+        bool operator>(const Event &o) const { return at_us != o.at_us ? at_us > o.at_us : order > o.order; }
+    };
+
+    struct Subscription
+    {
+        int client;
+        std::string filter;
+        uint8_t qos;
+    };
+
+    // Called with _mx held
+    void postLocked(uint64_t atUs, std::function<void()> fn);
+    LoopbackTransport *clientLocked(int id) const;
+
+    int attach(LoopbackTransport *t);
+    void detach(int id);
+
+    void route(int fromClient, const std::string &topic, const std::vector<uint8_t> &payload,
+               uint8_t qos, bool retain);
+    void run();
+
+    mutable std::mutex _mx;
+    std::condition_variable _cv;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> _events;
+    uint64_t _order = 0;
+    bool _busy = false; // an event is executing outside the lock
+    bool _stop = false;
+
+    std::map<int, LoopbackTransport *> _clients;
+    int _nextClient = 1;
+    std::vector<Subscription> _subs;
+    Stats _stats{};
+
+    std::thread _worker;
+};
+
+class LoopbackTransport final : public IMqttTransport
+{
+public:
+    LoopbackTransport(LoopbackBroker &broker, const LinkModel &uplink = LinkModel{},
+                      const LinkModel &downlink = LinkModel{}, uint32_t seed = 1);
+    ~LoopbackTransport() override;
+
+    void setLinks(const LinkModel &uplink, const LinkModel &downlink);
+
+    void setCleanSession(bool clean) override;
+    void connect() override;
+    void disconnect() override;
+    bool connected() const override { return _connected.load(); }
+
+    uint16_t publish(const char *topic, uint8_t qos, bool retain,
+                     const char *payload, size_t len) override;
+    uint16_t subscribe(const char *topic, uint8_t qos) override;
+    uint16_t unsubscribe(const char *topic) override;
+    uint16_t subscribeMany(const char *const *topics, const uint8_t *qos, size_t count) override;
+
+    /// SUBSCRIBE packets sent (a batch counts once).
+    uint32_t subscribePackets() const { return _subscribePackets.load(); }
+
+private:
+    friend class LoopbackBroker;
+
+    uint16_t nextPacketId(); // caller holds broker mutex
+    uint16_t sendSubscribe(std::vector<std::pair<std::string, uint8_t>> filters);
+
+    LoopbackBroker &_broker;
+    int _id;
+    SimLink _up;
+    SimLink _down;
+    std::atomic<bool> _connected{false};
+    bool _connecting = false;
+    bool _cleanSession = true;
+    bool _hasSession = false; // broker side: session state kept for this client
+    uint16_t _packetId = 0;
+    std::atomic<uint32_t> _subscribePackets{0};
+};
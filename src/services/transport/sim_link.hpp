@@ -0,0 +1,83 @@
+#pragma once
+
+/**
+ * @file sim_link.hpp
+ * @brief Deterministic one-way network link model for host-side transports.
+ *
+ * Each packet is serialized at the configured bandwidth, then arrives after
+ * latency + jitter. Loss behaves differently depending on the transport:
+ * - reliable (TCP): a lost packet is retransmitted after `retransmit_us` and,
+ *   because the stream is ordered, every packet behind it waits too (head-of-line blocking);
+ * - unreliable (UDP): a lost packet is simply gone, later packets are unaffected.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <random>
+
+struct LinkModel
+{
+    uint32_t latency_us = 0;         ///< One-way propagation delay
+    uint32_t jitter_us = 0;          ///< Uniform extra delay in [0, jitter_us]
+    uint32_t bandwidth_Bps = 0;      ///< Bytes per second, 0 = unlimited
+    float loss = 0.0f;               ///< Per-packet loss probability [0, 1]
+    uint32_t retransmit_us = 200000; ///< Reliable links: delay added per lost transmission (RTO)
+};
+
+class SimLink
+{
+public:
+    explicit SimLink(const LinkModel &model = LinkModel{}, bool reliable = true, uint32_t seed = 1)
+        : _m(model), _reliable(reliable), _rng(seed) {}
+
+    void setModel(const LinkModel &model) { _m = model; }
+    const LinkModel &model() const { return _m; }
+
+    /**
+     * @brief Send one packet of @p bytes at @p nowUs.
+     * @param deliverAtUs Arrival time when the packet gets through
+     * @return false if the packet was lost (unreliable links only)
+     */
+    bool schedule(size_t bytes, uint64_t nowUs, uint64_t &deliverAtUs)
+    {
+        // Serialization: the link sends one packet at a time
+        const uint64_t start = nowUs > _busyUntil ? nowUs : _busyUntil;
+        const uint64_t txUs = _m.bandwidth_Bps ? (uint64_t)bytes * 1000000ull / _m.bandwidth_Bps : 0;
+        _busyUntil = start + txUs;
+
+        uint64_t arrival = _busyUntil + _m.latency_us;
+        if (_m.jitter_us)
+            arrival += std::uniform_int_distribution<uint32_t>(0, _m.jitter_us)(_rng);
+
+        if (_reliable)
+        {
+            // Retransmit until it gets through (bounded, like TCP's retry limit); ordered delivery
+            for (int r = 0; r < kMaxRetransmits && _m.loss > 0.0f && _coin(_rng) < _m.loss; ++r)
+                arrival += _m.retransmit_us;
+            if (arrival < _lastArrival)
+                arrival = _lastArrival;
+            _lastArrival = arrival;
+        }
+        else if (_m.loss > 0.0f && _coin(_rng) < _m.loss)
+        {
+            _lost++;
+            return false;
+        }
+
+        deliverAtUs = arrival;
+        return true;
+    }
+
+    uint64_t lost() const { return _lost; }
+
+private:
+    static constexpr int kMaxRetransmits = 8;
+
+    LinkModel _m;
+    bool _reliable;
+    std::mt19937 _rng;
+    std::uniform_real_distribution<float> _coin{0.0f, 1.0f};
+    uint64_t _busyUntil = 0;
+    uint64_t _lastArrival = 0;
+    uint64_t _lost = 0;
+};
@@ -0,0 +1,105 @@
+#include "udp_datagram.hpp"
+
+#include <string.h>
+
+namespace
+{
+    inline uint32_t rd32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    inline void wr32(uint8_t *p, uint32_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+        p[2] = (uint8_t)(v >> 16);
+        p[3] = (uint8_t)(v >> 24);
+    }
+}
+
+namespace UdpDatagram
+{
+    size_t encodedLength(size_t topicLen, size_t payloadLen)
+    {
+        if (topicLen == 0 || topicLen > UDP_DGRAM_TOPIC_MAX)
+            return 0;
+        const size_t total = UDP_DGRAM_HEADER_LEN + topicLen + payloadLen;
+        return total <= UDP_DGRAM_MAX_LEN ? total : 0;
+    }
+
+    size_t encode(uint8_t *out, size_t cap, const char *topic, size_t topicLen,
+                  const uint8_t *payload, size_t payloadLen,
+                  uint32_t seq, uint32_t senderUs, uint8_t content, uint8_t flags)
+    {
+        const size_t total = encodedLength(topicLen, payloadLen);
+        if (!out || !topic || total == 0 || total > cap || (payloadLen && !payload))
+            return 0;
+
+        out[0] = UDP_DGRAM_VERSION;
+        out[1] = (uint8_t)topicLen;
+        out[2] = content;
+        out[3] = flags;
+        wr32(out + 4, seq);
+        wr32(out + 8, senderUs);
+        memcpy(out + UDP_DGRAM_HEADER_LEN, topic, topicLen);
+        if (payloadLen)
+            memcpy(out + UDP_DGRAM_HEADER_LEN + topicLen, payload, payloadLen);
+        return total;
+    }
+
+    bool decode(const uint8_t *data, size_t len, UdpDatagramView &out)
+    {
+        if (!data || len < UDP_DGRAM_HEADER_LEN || data[0] != UDP_DGRAM_VERSION)
+            return false;
+
+        const uint8_t topicLen = data[1];
+        if (topicLen == 0 || UDP_DGRAM_HEADER_LEN + (size_t)topicLen > len)
+            return false;
+
+        out.content = data[2];
+        out.flags = data[3];
+        out.seq = rd32(data + 4);
+        out.sender_us = rd32(data + 8);
+        out.topic = reinterpret_cast<const char *>(data + UDP_DGRAM_HEADER_LEN);
+        out.topic_len = topicLen;
+        out.payload = data + UDP_DGRAM_HEADER_LEN + topicLen;
+        out.payload_len = len - UDP_DGRAM_HEADER_LEN - topicLen;
+        return true;
+    }
+}
+
+UdpSequenceTracker::Result UdpSequenceTracker::update(uint32_t seq, uint8_t flags)
+{
+    if (!_started || (flags & UDP_DGRAM_FLAG_RESTART))
+    {
+        if (_started)
+            _s.restarts++;
+        _started = true;
+        _newest = seq;
+        _s.received++;
+        return Result::First;
+    }
+
+    const int32_t diff = (int32_t)(seq - _newest); // serial arithmetic
+    if (diff == 0)
+    {
+        _s.duplicate++;
+        return Result::Duplicate;
+    }
+
+    _s.received++;
+    if (diff > 0)
+    {
+        _newest = seq;
+        if (diff == 1)
+            return Result::InOrder;
+        _s.lost += (uint32_t)(diff - 1);
+        return Result::Gap;
+    }
+
+    // Filled an earlier gap (a late duplicate of an old seq is miscounted here; rare on UDP)
+    if (_s.lost)
+        _s.lost--;
+    _s.reordered++;
+    return Result::Late;
+}
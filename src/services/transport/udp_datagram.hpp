@@ -0,0 +1,108 @@
+#pragma once
+
+/**
+ * @file udp_datagram.hpp
+ * @brief Self-contained telemetry datagram for the UDP fast path, plus a receiver-side
+ * sequence tracker.
+ *
+ * Wire format (little-endian, no padding), one sample per datagram:
+ * @code
+ *  offset size field
+ *  0      1    version     (UDP_DGRAM_VERSION)
+ *  1      1    topic_len   (1..UDP_DGRAM_TOPIC_MAX)
+ *  2      1    content     (TelemetryContentType)
+ *  3      1    flags       (UDP_DGRAM_FLAG_*)
+ *  4      4    seq         (per topic: the sample's stream sequence number, +1 per sample)
+ *  8      4    sender_us   (sender clock, microseconds, wraps: the sample's capture time)
+ *  12     T    topic       (full MQTT topic, not NUL terminated)
+ *  12+T   N    payload
+ * @endcode
+ *
+ * Every datagram carries its full topic so the receiver can republish it without
+ * any session state; a lost datagram costs exactly one sample and nothing else.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Tunables ===============================================================
+#ifndef UDP_DGRAM_TOPIC_MAX
+#define UDP_DGRAM_TOPIC_MAX 64
+#endif
+
+#ifndef UDP_DGRAM_MAX_LEN
+#define UDP_DGRAM_MAX_LEN 1400 // stay below a typical path MTU, no IP fragmentation
+#endif
+
+#define UDP_DGRAM_VERSION 1
+#define UDP_DGRAM_HEADER_LEN 12
+
+/// First datagram after the sender (re)started; receivers reset their sequence state.
+#define UDP_DGRAM_FLAG_RESTART 0x01
+
+struct UdpDatagramView
+{
+    uint8_t content;
+    uint8_t flags;
+    uint32_t seq;
+    uint32_t sender_us;
+    const char *topic; ///< Points into the datagram, not NUL terminated
+    uint8_t topic_len;
+    const uint8_t *payload;
+    size_t payload_len;
+};
+
+namespace UdpDatagram
+{
+    /// @return Datagram size for the given topic/payload, 0 if it would not fit.
+    size_t encodedLength(size_t topicLen, size_t payloadLen);
+
+    /**
+     * @brief Serialize one sample into @p out.
+     * @return Bytes written, or 0 if @p out is too small or the topic is empty/too long.
+     */
+    size_t encode(uint8_t *out, size_t cap, const char *topic, size_t topicLen,
+                  const uint8_t *payload, size_t payloadLen,
+                  uint32_t seq, uint32_t senderUs, uint8_t content, uint8_t flags = 0);
+
+    /// @return false if the datagram is truncated or has an unknown version.
+    bool decode(const uint8_t *data, size_t len, UdpDatagramView &out);
+}
+
+/**
+ * @brief Loss/reorder accounting for one stream on the receiver.
+ *
+ * Sequence numbers are compared with serial arithmetic, so wrap-around is fine.
+ * A gap counts as lost immediately; if the missing datagram shows up later it is
+ * moved from `lost` to `reordered`.
+ */
+class UdpSequenceTracker
+{
+public:
+    struct Stats
+    {
+        uint32_t received;  ///< Datagrams accepted (incl. late ones)
+        uint32_t lost;      ///< Sequence numbers never seen (so far)
+        uint32_t reordered; ///< Arrived after a newer datagram
+        uint32_t duplicate; ///< Same seq as the newest one
+        uint32_t restarts;  ///< Sender restarts observed
+    };
+
+    enum class Result : uint8_t
+    {
+        InOrder,
+        Gap,       ///< Newer than expected; the skipped ones were counted as lost
+        Late,      ///< Older than the newest seen
+        Duplicate,
+        First      ///< First datagram (or first after a restart)
+    };
+
+    Result update(uint32_t seq, uint8_t flags = 0);
+    const Stats &stats() const { return _s; }
+    void reset() { *this = UdpSequenceTracker{}; }
+
+private:
+    bool _started = false;
+    uint32_t _newest = 0;
+    Stats _s{};
+};
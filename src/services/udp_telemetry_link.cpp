@@ -0,0 +1,115 @@
+#include "udp_telemetry_link.hpp"
+#include "logging/logger.hpp"
+
+#include "esp_timer.h" // esp_timer_get_time()
+#include <cstring>
+
+namespace
+{
+    // FNV-1a; topics are short and fixed per stream
+    uint32_t topicHash(const char *s, size_t n)
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < n; ++i)
+        {
+            h ^= (uint8_t)s[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+}
+
+bool UdpTelemetryLink::begin(const IPAddress &host, uint16_t port)
+{
+    if (port == 0)
+    {
+        LOGE("UdpTelemetry", "Invalid UDP port");
+        return false;
+    }
+
+    _host = host;
+    _port = port;
+    _udp.begin(0); // any local port; we never receive
+    for (size_t i = 0; i < _streamCount; ++i)
+        _streams[i].restart = true;
+    LOGI("UdpTelemetry", "UDP telemetry -> %s:%u", host.toString().c_str(), port);
+    return true;
+}
+
+void UdpTelemetryLink::end()
+{
+    _udp.stop();
+    _port = 0;
+}
+
+UdpTelemetryLink::Stream *UdpTelemetryLink::streamFor(const char *topic, size_t topicLen)
+{
+    const uint32_t h = topicHash(topic, topicLen);
+    for (size_t i = 0; i < _streamCount; ++i)
+    {
+        if (_streams[i].hash == h)
+            return &_streams[i];
+    }
+    if (_streamCount >= UDP_TELEMETRY_MAX_STREAMS)
+        return nullptr;
+
+    Stream &s = _streams[_streamCount++];
+    s.hash = h;
+    s.seq = 0;
+    s.restart = true;
+    return &s;
+}
+
+bool UdpTelemetryLink::send(const char *topic, const uint8_t *payload, size_t len, uint8_t content)
+{
+    return sendImpl(topic, payload, len, content, nullptr, (uint32_t)esp_timer_get_time());
+}
+
+bool UdpTelemetryLink::send(const char *topic, const uint8_t *payload, size_t len, uint8_t content,
+                            uint32_t seq, uint32_t captureUs)
+{
+    return sendImpl(topic, payload, len, content, &seq, captureUs);
+}
+
+bool UdpTelemetryLink::sendImpl(const char *topic, const uint8_t *payload, size_t len, uint8_t content,
+                                const uint32_t *seq, uint32_t senderUs)
+{
+    if (!configured() || !topic)
+        return false;
+
+    if (!WiFi.isConnected())
+    {
+        _stats.link_down++;
+        return false;
+    }
+
+    const size_t topicLen = std::strlen(topic);
+    Stream *s = streamFor(topic, topicLen);
+    if (!s)
+    {
+        _stats.no_stream++;
+        return false;
+    }
+
+    const size_t n = UdpDatagram::encode(
+        _buf, sizeof(_buf), topic, topicLen, payload, len,
+        seq ? *seq : s->seq, senderUs, content,
+        s->restart ? UDP_DGRAM_FLAG_RESTART : 0);
+    if (n == 0)
+    {
+        _stats.too_large++;
+        return false;
+    }
+
+    // The seq is consumed even if the send fails, so the receiver sees the gap
+    s->seq++;
+    s->restart = false;
+
+    if (!_udp.beginPacket(_host, _port) || _udp.write(_buf, n) != n || !_udp.endPacket())
+    {
+        _stats.send_fail++;
+        return false;
+    }
+    _stats.sent++;
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+/**
+ * @file udp_telemetry_link.hpp
+ * @brief Connectionless datagram sender for high-rate telemetry streams.
+ *
+ * Each sample goes out as one UdpDatagram carrying its full topic and a per-topic
+ * sequence number, so a lost packet costs one sample instead of stalling every
+ * stream behind it (as a TCP retransmit does for MQTT). Pair with
+ * tools/udp_telemetry_rx.py on the ground side.
+ *
+ * Not thread-safe: owned and used by the TelemetryTx task only.
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include "transport/udp_datagram.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef UDP_TELEMETRY_MAX_STREAMS
+#define UDP_TELEMETRY_MAX_STREAMS 8 // distinct topics with their own sequence counter
+#endif
+
+class UdpTelemetryLink
+{
+public:
+    struct Stats
+    {
+        uint32_t sent;       ///< Datagrams handed to the IP stack
+        uint32_t send_fail;  ///< beginPacket/endPacket failed (no route, out of pbufs)
+        uint32_t too_large;  ///< Topic + payload exceed UDP_DGRAM_MAX_LEN
+        uint32_t no_stream;  ///< Stream table full
+        uint32_t link_down;  ///< Not sent because Wi-Fi is not connected
+    };
+
+    /// @return false if @p port is 0.
+    bool begin(const IPAddress &host, uint16_t port);
+    void end();
+    bool configured() const { return _port != 0; }
+
+    /// @brief Send one sample. @return true if it was handed to the IP stack.
+    bool send(const char *topic, const uint8_t *payload, size_t len, uint8_t content);
+
+    /**
+     * @brief Send one stamped sample: the datagram carries the sample's stream sequence
+     * number and capture time instead of the link's own counter and the send time, so the
+     * receiver also sees samples lost before the link.
+     */
+    bool send(const char *topic, const uint8_t *payload, size_t len, uint8_t content,
+              uint32_t seq, uint32_t captureUs);
+
+    const Stats &stats() const { return _stats; }
+
+private:
+    struct Stream
+    {
+        uint32_t hash;
+        uint32_t seq;
+        bool restart; ///< first datagram after begin(): tell the receiver
+    };
+
+    Stream *streamFor(const char *topic, size_t topicLen);
+    bool sendImpl(const char *topic, const uint8_t *payload, size_t len, uint8_t content,
+                  const uint32_t *seq, uint32_t senderUs);
+
+    WiFiUDP _udp;
+    IPAddress _host;
+    uint16_t _port{0};
+    Stream _streams[UDP_TELEMETRY_MAX_STREAMS]{};
+    size_t _streamCount{0};
+    uint8_t _buf[UDP_DGRAM_MAX_LEN];
+    Stats _stats{};
+};
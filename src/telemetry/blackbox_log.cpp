@@ -0,0 +1,275 @@
+#include "blackbox_log.hpp"
+
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace
+{
+    void putU16(uint8_t *p, uint16_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    void putU32(uint8_t *p, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = (uint8_t)(v >> (8 * i));
+    }
+
+    uint16_t getU16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+    uint32_t getU32(const uint8_t *p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    bool isLogName(const char *name)
+    {
+        const size_t n = strlen(name);
+        return n > 4 && strcmp(name + n - 4, ".bbl") == 0;
+    }
+}
+
+size_t blackboxSchemaFrame(const PackedSchema &schema, const char *name, uint8_t *out, size_t cap)
+{
+    size_t pos = 0;
+    auto putName = [&](const char *s) -> bool
+    {
+        const size_t n = strlen(s);
+        if (n > 255 || pos + 1 + n > cap)
+            return false;
+        out[pos++] = (uint8_t)n;
+        memcpy(out + pos, s, n);
+        pos += n;
+        return true;
+    };
+
+    if (cap < 3)
+        return 0;
+    out[pos++] = BLACKBOX_SCHEMA_DEF;
+    out[pos++] = schema.id;
+    out[pos++] = schema.count;
+    if (!putName(name))
+        return 0;
+    for (uint8_t i = 0; i < schema.count; ++i)
+    {
+        const PackedField &f = schema.fields[i];
+        if (pos + 5 > cap)
+            return 0;
+        out[pos++] = (uint8_t)f.type;
+        memcpy(out + pos, &f.scale, 4); // IEEE-754, little endian on both ends
+        pos += 4;
+        if (!putName(f.name))
+            return 0;
+    }
+    return pos;
+}
+
+// ===== BlackboxStager =========================================================
+
+void BlackboxStager::reset()
+{
+    _head = 0;
+    _sealed = 0;
+    _used = BLACKBOX_BLOCK_HEADER;
+    _frames = 0;
+    _seq = 0;
+    _stats = Stats{};
+}
+
+bool BlackboxStager::append(uint32_t tUs, const uint8_t *payload, size_t len)
+{
+    if (len > BLACKBOX_FRAME_MAX)
+    {
+        _stats.too_large++;
+        return false;
+    }
+    const size_t need = BLACKBOX_FRAME_HEADER + len;
+    if (_used + need > BLACKBOX_BLOCK_SIZE && !seal())
+    {
+        _stats.dropped++; // writer is behind on every staging block
+        return false;
+    }
+
+    uint8_t *p = filling() + _used;
+    p[0] = (uint8_t)len;
+    putU32(p + 1, tUs);
+    memcpy(p + BLACKBOX_FRAME_HEADER, payload, len);
+    _used += need;
+    _frames++;
+    _stats.frames++;
+    _stats.bytes += (uint32_t)need;
+    return true;
+}
+
+bool BlackboxStager::seal()
+{
+    if (_frames == 0 || _sealed + 1 >= BLACKBOX_STAGING_BLOCKS)
+        return false; // keep one block to fill
+
+    uint8_t *b = filling();
+    putU32(b, BLACKBOX_BLOCK_MAGIC);
+    putU32(b + 4, _seq++);
+    putU16(b + 8, (uint16_t)_used);
+    putU16(b + 10, _frames);
+    memset(b + _used, 0, BLACKBOX_BLOCK_SIZE - _used);
+
+    _sealed++;
+    _stats.blocks++;
+    if (_sealed > _stats.high_water)
+        _stats.high_water = (uint32_t)_sealed;
+    _used = BLACKBOX_BLOCK_HEADER;
+    _frames = 0;
+    return true;
+}
+
+void BlackboxStager::pop()
+{
+    if (!_sealed)
+        return;
+    _head = (_head + 1) % BLACKBOX_STAGING_BLOCKS;
+    _sealed--;
+}
+
+// ===== BlackboxReader =========================================================
+
+bool BlackboxReader::enterBlock()
+{
+    while (_block + BLACKBOX_BLOCK_SIZE <= _len)
+    {
+        const uint8_t *b = _data + _block;
+        const uint16_t used = getU16(b + 8);
+        if (getU32(b) != BLACKBOX_BLOCK_MAGIC || used < BLACKBOX_BLOCK_HEADER || used > BLACKBOX_BLOCK_SIZE)
+        {
+            _bad++;
+            _block += BLACKBOX_BLOCK_SIZE;
+            continue;
+        }
+        const uint32_t seq = getU32(b + 4);
+        if (seq > _nextSeq)
+            _lost += seq - _nextSeq;
+        _nextSeq = seq + 1;
+        _blocks++;
+        _pos = BLACKBOX_BLOCK_HEADER;
+        _end = used;
+        return true;
+    }
+    return false;
+}
+
+bool BlackboxReader::next(uint32_t &tUs, const uint8_t *&payload, size_t &len)
+{
+    for (;;)
+    {
+        if (_pos == 0 && !enterBlock())
+            return false;
+
+        const uint8_t *b = _data + _block;
+        if (_pos + BLACKBOX_FRAME_HEADER <= _end)
+        {
+            const size_t n = b[_pos];
+            if (_pos + BLACKBOX_FRAME_HEADER + n <= _end)
+            {
+                tUs = getU32(b + _pos + 1);
+                payload = b + _pos + BLACKBOX_FRAME_HEADER;
+                len = n;
+                _pos += BLACKBOX_FRAME_HEADER + n;
+                return true;
+            }
+            _bad++; // truncated frame: rest of the block is unusable
+        }
+        _block += BLACKBOX_BLOCK_SIZE;
+        _pos = 0;
+    }
+}
+
+// ===== FileBlackboxStorage ====================================================
+
+bool FileBlackboxStorage::path(const char *name, char *out, size_t cap) const
+{
+    const int n = snprintf(out, cap, "%s/%s", _dir, name);
+    return n > 0 && (size_t)n < cap && !strchr(name, '/');
+}
+
+bool FileBlackboxStorage::begin()
+{
+    struct stat st;
+    if (stat(_dir, &st) == 0)
+        return S_ISDIR(st.st_mode);
+    return mkdir(_dir, 0775) == 0;
+}
+
+bool FileBlackboxStorage::create(const char *name)
+{
+    close();
+    char p[96];
+    if (!path(name, p, sizeof(p)))
+        return false;
+    _out = fopen(p, "wb");
+    return _out != nullptr;
+}
+
+bool FileBlackboxStorage::append(const uint8_t *data, size_t len)
+{
+    if (!_out)
+        return false;
+    if (fwrite(data, 1, len, _out) != len)
+        return false;
+    return fflush(_out) == 0; // a block on flash is a block kept on power loss
+}
+
+void FileBlackboxStorage::close()
+{
+    if (_out)
+    {
+        fclose(_out);
+        _out = nullptr;
+    }
+}
+
+size_t FileBlackboxStorage::read(const char *name, size_t offset, uint8_t *buf, size_t len)
+{
+    char p[96];
+    if (!path(name, p, sizeof(p)))
+        return 0;
+    FILE *f = fopen(p, "rb");
+    if (!f)
+        return 0;
+    size_t n = 0;
+    if (fseek(f, (long)offset, SEEK_SET) == 0)
+        n = fread(buf, 1, len, f);
+    fclose(f);
+    return n;
+}
+
+bool FileBlackboxStorage::remove(const char *name)
+{
+    char p[96];
+    return path(name, p, sizeof(p)) && ::remove(p) == 0;
+}
+
+bool FileBlackboxStorage::entry(size_t idx, char *name, size_t cap, size_t &size)
+{
+    DIR *d = opendir(_dir);
+    if (!d)
+        return false;
+    bool found = false;
+    size_t i = 0;
+    while (struct dirent *e = readdir(d))
+    {
+        if (!isLogName(e->d_name) || i++ != idx)
+            continue;
+        char p[96];
+        struct stat st;
+        if (strlen(e->d_name) >= cap || !path(e->d_name, p, sizeof(p)) || stat(p, &st) != 0)
+            break;
+        strcpy(name, e->d_name);
+        size = (size_t)st.st_size;
+        found = true;
+        break;
+    }
+    closedir(d);
+    return found;
+}
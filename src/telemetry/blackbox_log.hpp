@@ -0,0 +1,171 @@
+#pragma once
+
+/**
+ * @file blackbox_log.hpp
+ * @brief On-board flight log format: RAM staging in flash-sector blocks, file storage, reader.
+ *
+ * A log is a sequence of BLACKBOX_BLOCK_SIZE blocks, the flash sector size, so the
+ * filesystem only ever sees whole-sector appends:
+ *
+ *   block  := u32 magic "FBBK" | u32 seq | u16 used | u16 frames | frames... | zero padding
+ *   frame  := u8 len | u32 t_us | payload[len]
+ *
+ * A payload is a packed sample (see packed_writer.hpp): schema ID first, then the values,
+ * or a raw IMU block (IMU_RAW_BLOCK_ID first, see imu_raw_block.hpp).
+ * Each log starts with definition frames (payload[0] = BLACKBOX_SCHEMA_DEF) that describe
+ * every schema, so a log decodes without the firmware that wrote it
+ * (tools/blackbox_decode.py):
+ *
+ *   schema := 0 | u8 id | u8 count | u8 name_len | name | count x (u8 type | f32 scale | u8 name_len | name)
+ *
+ * Frames never span blocks; a gap in `seq` means blocks were lost. Little endian.
+ *
+ * BlackboxStager is what producers write into: append() is a bounded memcpy and never
+ * waits for flash. When the staging blocks are all sealed and not yet written, frames
+ * are dropped and counted. Not thread-safe on its own (BlackboxService locks it).
+ * Builds on the host, together with FileBlackboxStorage as the flash stand-in.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "packed_writer.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef BLACKBOX_BLOCK_SIZE
+#define BLACKBOX_BLOCK_SIZE 4096 // flash sector
+#endif
+
+#ifndef BLACKBOX_STAGING_BLOCKS
+#define BLACKBOX_STAGING_BLOCKS 4 // RAM: 16 KB, ~0.5 s at 32 kB/s of writer stall
+#endif
+
+#ifndef BLACKBOX_FRAME_MAX
+#define BLACKBOX_FRAME_MAX 224 // payload bytes; raw IMU blocks (imu_raw_block.hpp) are the largest frames
+#endif
+
+static constexpr uint32_t BLACKBOX_BLOCK_MAGIC = 0x4B424246; // "FBBK"
+static constexpr size_t BLACKBOX_BLOCK_HEADER = 12;
+static constexpr size_t BLACKBOX_FRAME_HEADER = 5;
+static constexpr uint8_t BLACKBOX_SCHEMA_DEF = 0;
+
+/**
+ * @brief Encode the definition frame payload for @p schema.
+ * @return Payload length, 0 if it doesn't fit in @p cap.
+ */
+size_t blackboxSchemaFrame(const PackedSchema &schema, const char *name, uint8_t *out, size_t cap);
+
+class BlackboxStager
+{
+public:
+    struct Stats
+    {
+        uint32_t frames;     ///< Appended
+        uint32_t bytes;      ///< ... incl. frame headers
+        uint32_t dropped;    ///< Every staging block was waiting for the writer
+        uint32_t too_large;  ///< Payload over BLACKBOX_FRAME_MAX
+        uint32_t blocks;     ///< Sealed
+        uint32_t high_water; ///< Most blocks waiting for the writer at once
+    };
+
+    /// Discard staged data and restart block numbering (new log).
+    void reset();
+
+    /// Copy one frame in. @return false if dropped (counted).
+    bool append(uint32_t tUs, const uint8_t *payload, size_t len);
+
+    /// Close the partially filled block so the writer can take it. @return false if it was empty or no block is free.
+    bool seal();
+
+    /// Oldest sealed block (BLACKBOX_BLOCK_SIZE bytes), or nullptr. Stays valid until pop().
+    const uint8_t *front() const { return _sealed ? _blocks[_head] : nullptr; }
+    void pop();
+
+    size_t sealed() const { return _sealed; }
+    bool pendingFrames() const { return _frames != 0; }
+    const Stats &stats() const { return _stats; }
+
+private:
+    uint8_t *filling() { return _blocks[(_head + _sealed) % BLACKBOX_STAGING_BLOCKS]; }
+
+    uint8_t _blocks[BLACKBOX_STAGING_BLOCKS][BLACKBOX_BLOCK_SIZE];
+    size_t _head{0};
+    size_t _sealed{0};
+    size_t _used{BLACKBOX_BLOCK_HEADER}; // in the filling block
+    uint16_t _frames{0};
+    uint32_t _seq{0};
+    Stats _stats{};
+};
+
+/// Iterates the frames of a log image (tests, on-device checks).
+class BlackboxReader
+{
+public:
+    BlackboxReader(const uint8_t *data, size_t len) : _data(data), _len(len) {}
+
+    /// @return false at the end of the log.
+    bool next(uint32_t &tUs, const uint8_t *&payload, size_t &len);
+
+    uint32_t blocks() const { return _blocks; }
+    uint32_t lostBlocks() const { return _lost; }  ///< Gaps in the block sequence
+    uint32_t badBlocks() const { return _bad; }    ///< Wrong magic or header, skipped
+
+private:
+    bool enterBlock();
+
+    const uint8_t *_data;
+    size_t _len;
+    size_t _block{0};   // offset of the current block
+    size_t _pos{0};     // offset in it, 0 = not entered
+    size_t _end{0};
+    uint32_t _nextSeq{0};
+    uint32_t _blocks{0};
+    uint32_t _lost{0};
+    uint32_t _bad{0};
+};
+
+/// Where finished blocks go; one log open for writing at a time.
+class IBlackboxStorage
+{
+public:
+    virtual ~IBlackboxStorage() = default;
+
+    virtual bool begin() = 0;
+    /// Create (truncate) @p name and make it the log appended to.
+    virtual bool create(const char *name) = 0;
+    virtual bool append(const uint8_t *data, size_t len) = 0;
+    virtual void close() = 0;
+
+    /// @return Bytes read (0 past the end or if @p name doesn't exist).
+    virtual size_t read(const char *name, size_t offset, uint8_t *buf, size_t len) = 0;
+    virtual bool remove(const char *name) = 0;
+
+    /// Enumerate logs. @return false once @p idx is past the last one.
+    virtual bool entry(size_t idx, char *name, size_t cap, size_t &size) = 0;
+};
+
+/**
+ * @brief Logs as `<dir>/<name>` through stdio: the LittleFS VFS mount on target
+ * (e.g. "/littlefs/bb"), any directory on the host.
+ */
+class FileBlackboxStorage final : public IBlackboxStorage
+{
+public:
+    explicit FileBlackboxStorage(const char *dir) : _dir(dir) {}
+    ~FileBlackboxStorage() override { close(); }
+
+    bool begin() override;
+    bool create(const char *name) override;
+    bool append(const uint8_t *data, size_t len) override;
+    void close() override;
+    size_t read(const char *name, size_t offset, uint8_t *buf, size_t len) override;
+    bool remove(const char *name) override;
+    bool entry(size_t idx, char *name, size_t cap, size_t &size) override;
+
+private:
+    bool path(const char *name, char *out, size_t cap) const;
+
+    const char *_dir;
+    FILE *_out{nullptr};
+};
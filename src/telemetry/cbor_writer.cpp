@@ -0,0 +1,170 @@
+#include "cbor_writer.hpp"
+
+#include <string.h>
+
+namespace
+{
+    constexpr uint8_t kUnsigned = 0;
+    constexpr uint8_t kNegative = 1;
+    constexpr uint8_t kText = 3;
+    constexpr uint8_t kArrayIndef = 0x9F;
+    constexpr uint8_t kMapIndef = 0xBF;
+    constexpr uint8_t kBreak = 0xFF;
+    constexpr uint8_t kFalse = 0xF4;
+    constexpr uint8_t kTrue = 0xF5;
+    constexpr uint8_t kNull = 0xF6;
+    constexpr uint8_t kFloat32 = 0xFA;
+    constexpr uint8_t kFloat64 = 0xFB;
+}
+
+void CborBufWriter::reset(uint8_t *buf, size_t cap)
+{
+    _buf = buf;
+    _cap = buf ? cap : 0;
+    _len = 0;
+    _depth = 0;
+    _overflow = false;
+}
+
+void CborBufWriter::put(uint8_t b)
+{
+    if (_len >= _cap)
+    {
+        _overflow = true;
+        return;
+    }
+    _buf[_len++] = b;
+}
+
+void CborBufWriter::put(const void *p, size_t n)
+{
+    if (n > _cap - _len)
+    {
+        _overflow = true;
+        return;
+    }
+    memcpy(_buf + _len, p, n);
+    _len += n;
+}
+
+void CborBufWriter::head(uint8_t major, uint64_t arg)
+{
+    // Shortest form: inline (< 24), then 1/2/4/8 bytes big endian
+    const uint8_t m = (uint8_t)(major << 5);
+    if (arg < 24)
+    {
+        put((uint8_t)(m | arg));
+        return;
+    }
+    uint8_t b[9];
+    int n;
+    if (arg <= 0xFF)
+    {
+        b[0] = m | 24;
+        n = 1;
+    }
+    else if (arg <= 0xFFFF)
+    {
+        b[0] = m | 25;
+        n = 2;
+    }
+    else if (arg <= 0xFFFFFFFFull)
+    {
+        b[0] = m | 26;
+        n = 4;
+    }
+    else
+    {
+        b[0] = m | 27;
+        n = 8;
+    }
+    for (int i = 0; i < n; ++i)
+        b[1 + i] = (uint8_t)(arg >> (8 * (n - 1 - i)));
+    put(b, (size_t)n + 1);
+}
+
+void CborBufWriter::text(const char *s)
+{
+    const size_t n = s ? strlen(s) : 0;
+    head(kText, n);
+    if (n)
+        put(s, n);
+}
+
+void CborBufWriter::beginObject()
+{
+    put(kMapIndef);
+    _depth++;
+}
+
+void CborBufWriter::endObject()
+{
+    put(kBreak);
+    _depth--;
+}
+
+void CborBufWriter::beginArray()
+{
+    put(kArrayIndef);
+    _depth++;
+}
+
+void CborBufWriter::endArray()
+{
+    put(kBreak);
+    _depth--;
+}
+
+void CborBufWriter::key(const char *k) { text(k); }
+
+void CborBufWriter::value(float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint8_t b[5] = {kFloat32, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits};
+    put(b, sizeof(b));
+}
+
+void CborBufWriter::value(double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint8_t b[9];
+    b[0] = kFloat64;
+    for (int i = 0; i < 8; ++i)
+        b[1 + i] = (uint8_t)(bits >> (8 * (7 - i)));
+    put(b, sizeof(b));
+}
+
+void CborBufWriter::value(int64_t v)
+{
+    if (v >= 0)
+        head(kUnsigned, (uint64_t)v);
+    else
+        head(kNegative, (uint64_t)(-1 - v)); // -1 - n without overflow at INT64_MIN
+}
+
+void CborBufWriter::value(uint64_t v) { head(kUnsigned, v); }
+
+void CborBufWriter::value(bool v) { put(v ? kTrue : kFalse); }
+
+void CborBufWriter::value(const char *s)
+{
+    if (!s)
+    {
+        null();
+        return;
+    }
+    text(s);
+}
+
+void CborBufWriter::null() { put(kNull); }
+
+bool CborBufWriter::finalize(const uint8_t *&out, size_t &len) const
+{
+    if (_overflow || _depth != 0)
+        return false;
+    out = _buf;
+    len = _len;
+    return true;
+}
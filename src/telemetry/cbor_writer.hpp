@@ -0,0 +1,58 @@
+#pragma once
+
+/**
+ * @file cbor_writer.hpp
+ * @brief Minimal streaming CBOR (RFC 8949) encoder into a caller-owned buffer.
+ *
+ * Same call sequence as JsonBufWriter (beginObject/key/value/endObject/finalize), so
+ * providers can swap encodings without restructuring. Maps and arrays are written
+ * with indefinite length (0xBF/0x9F ... 0xFF), so no element count is needed up front.
+ * Floats are encoded as float32, doubles as float64. No heap; builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+class CborBufWriter
+{
+public:
+    CborBufWriter(uint8_t *buf, size_t cap) { reset(buf, cap); }
+
+    void reset(uint8_t *buf, size_t cap);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    /// Map key (text string). Must alternate with values inside an object.
+    void key(const char *k);
+
+    void value(float v);
+    void value(double v);
+    void value(int32_t v) { value((int64_t)v); }
+    void value(uint32_t v) { value((uint64_t)v); }
+    void value(int64_t v);
+    void value(uint64_t v);
+    void value(bool v);
+    void value(const char *s);
+    void null();
+
+    /// @return false on overflow or unbalanced containers.
+    bool finalize(const uint8_t *&out, size_t &len) const;
+
+    bool ok() const { return !_overflow; }
+    size_t size() const { return _len; }
+
+private:
+    void head(uint8_t major, uint64_t arg);
+    void put(uint8_t b);
+    void put(const void *p, size_t n);
+    void text(const char *s);
+
+    uint8_t *_buf{nullptr};
+    size_t _cap{0};
+    size_t _len{0};
+    int _depth{0};
+    bool _overflow{false};
+};
@@ -0,0 +1,199 @@
+#include "delta_codec.hpp"
+
+#include <string.h>
+
+namespace
+{
+    int32_t quantize(float v, float scale)
+    {
+        double s = (double)v * (scale != 0.0f ? scale : 1.0f);
+        if (!(s == s)) // NaN
+            s = 0;
+        s = s < -DELTA_QUANT_LIMIT ? -DELTA_QUANT_LIMIT : (s > DELTA_QUANT_LIMIT ? DELTA_QUANT_LIMIT : s);
+        return (int32_t)(s < 0 ? s - 0.5 : s + 0.5); // half away from zero, like PackedBufWriter
+    }
+
+    bool usable(const PackedSchema *s) { return s && s->count > 0 && s->count <= DELTA_MAX_CHANNELS; }
+}
+
+size_t deltaPutVarint(int32_t v, uint8_t *out, size_t cap)
+{
+    uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+    size_t n = 0;
+    do
+    {
+        if (n == cap)
+            return 0;
+        const uint8_t b = z & 0x7F;
+        z >>= 7;
+        out[n++] = z ? (uint8_t)(b | 0x80) : b;
+    } while (z);
+    return n;
+}
+
+size_t deltaGetVarint(const uint8_t *in, size_t len, int32_t &v)
+{
+    uint32_t z = 0;
+    for (size_t n = 0; n < len && n < 5; ++n)
+    {
+        z |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80))
+        {
+            v = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+// ===== DeltaEncoder ===========================================================
+
+size_t DeltaEncoder::encode(const float *values, uint8_t *out, size_t cap)
+{
+    if (!usable(_schema) || cap < DELTA_HEADER_BYTES)
+        return 0;
+
+    const bool key = _sinceKey == 0;
+    int32_t q[DELTA_MAX_CHANNELS];
+    size_t pos = DELTA_HEADER_BYTES;
+    for (uint8_t i = 0; i < _schema->count; ++i)
+    {
+        q[i] = quantize(values[i], _schema->fields[i].scale);
+        const size_t n = deltaPutVarint(key ? q[i] : q[i] - _prev[i], out + pos, cap - pos);
+        if (!n)
+            return 0;
+        pos += n;
+    }
+
+    out[0] = _schema->id;
+    const uint16_t hdr = (uint16_t)((key ? DELTA_FLAG_KEYFRAME : 0) | (_seq & DELTA_SEQ_MASK));
+    out[1] = (uint8_t)(hdr & 0xFF);
+    out[2] = (uint8_t)(hdr >> 8);
+    memcpy(_prev, q, sizeof(int32_t) * _schema->count);
+    _seq++;
+    _sinceKey = (uint16_t)((_sinceKey + 1) % _keyInterval);
+
+    _stats.samples++;
+    if (key)
+        _stats.keyframes++;
+    _stats.bytes += (uint32_t)pos;
+    return pos;
+}
+
+// ===== DeltaDecoder ===========================================================
+
+DeltaDecoder::Result DeltaDecoder::decode(const uint8_t *data, size_t len, double *out)
+{
+    if (!usable(_schema) || !data || len < DELTA_HEADER_BYTES || data[0] != _schema->id)
+    {
+        _stats.errors++;
+        return Result::Error;
+    }
+
+    const uint16_t hdr = deltaHeader(data);
+    const bool key = hdr & DELTA_FLAG_KEYFRAME;
+    const uint16_t seq = hdr & DELTA_SEQ_MASK;
+    int32_t v[DELTA_MAX_CHANNELS];
+    size_t pos = DELTA_HEADER_BYTES;
+    for (uint8_t i = 0; i < _schema->count; ++i)
+    {
+        const size_t n = deltaGetVarint(data + pos, len - pos, v[i]);
+        if (!n)
+        {
+            _stats.errors++;
+            return Result::Error;
+        }
+        pos += n;
+    }
+    if (pos != len)
+    {
+        _stats.errors++;
+        return Result::Error;
+    }
+
+    if (_haveSeq && seq != _nextSeq)
+    {
+        _stats.lost += (uint16_t)(seq - _nextSeq) & DELTA_SEQ_MASK;
+        _synced = false; // the missing samples' deltas are gone
+    }
+    _haveSeq = true;
+    _nextSeq = (seq + 1) & DELTA_SEQ_MASK;
+
+    if (!key && !_synced)
+    {
+        _stats.skipped++;
+        return Result::Waiting;
+    }
+
+    for (uint8_t i = 0; i < _schema->count; ++i)
+    {
+        _prev[i] = key ? v[i] : (int32_t)((uint32_t)_prev[i] + (uint32_t)v[i]);
+        const float sc = _schema->fields[i].scale;
+        out[i] = _prev[i] / (double)(sc != 0.0f ? sc : 1.0f);
+    }
+    _synced = true;
+    _stats.samples++;
+    if (key)
+        _stats.keyframes++;
+    return Result::Ok;
+}
+
+// ===== DeltaBufWriter =========================================================
+
+DeltaBufWriter::DeltaBufWriter(uint8_t *buf, size_t cap, DeltaEncoder *encoder)
+    : _buf(buf), _cap(buf ? cap : 0), _enc(encoder), _error(!encoder || !usable(encoder->schema()))
+{
+}
+
+void DeltaBufWriter::beginObject()
+{
+    if (_open || _closed)
+        _error = true; // flat objects only
+    _open = true;
+}
+
+void DeltaBufWriter::key(const char *k)
+{
+    if (_error || !_open || _keyed || _next >= _enc->schema()->count)
+    {
+        _error = true;
+        return;
+    }
+    const char *want = _enc->schema()->fields[_next].name;
+    if (k != want && (!k || strcmp(k, want) != 0))
+        _error = true;
+    _keyed = true;
+}
+
+void DeltaBufWriter::number(float v)
+{
+    if (_error || !_open || !_keyed)
+    {
+        _error = true;
+        return;
+    }
+    _keyed = false;
+    _values[_next++] = v;
+}
+
+void DeltaBufWriter::endObject()
+{
+    if (_error || !_open || _next != _enc->schema()->count)
+        _error = true;
+    _open = false;
+    _closed = true;
+    if (_error)
+        return;
+    _len = _enc->encode(_values, _buf, _cap);
+    if (!_len)
+        _error = true;
+}
+
+bool DeltaBufWriter::finalize(const uint8_t *&out, size_t &len) const
+{
+    if (_error || !_closed)
+        return false;
+    out = _buf;
+    len = _len;
+    return true;
+}
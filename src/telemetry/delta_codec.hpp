@@ -0,0 +1,179 @@
+#pragma once
+
+/**
+ * @file delta_codec.hpp
+ * @brief Quantized delta encoding for slowly changing multi-channel streams (IMU attitude).
+ *
+ * Each channel is quantized with its PackedField scale (stored = round(value * scale),
+ * e.g. 100 = 0.01 deg) and sent as the zigzag varint difference to the previous sample's
+ * quantized value. A sample at rest or turning slowly costs one byte per channel. Every
+ * DELTA_KEYFRAME_INTERVAL samples (and after forceKeyframe()) the absolute values are sent
+ * instead, so a receiver that lost samples resyncs there.
+ *
+ * Payload layout (one sample per payload):
+ *
+ *     u8 schema id | u16 hdr (LE): 0x8000 keyframe, low 15 bits seq | count x zigzag varint
+ *
+ * The encoder differences against what it sent, not against the raw input, so the
+ * quantization error never accumulates: every decoded value is within 0.5 / scale of
+ * the input (inside the ±DELTA_QUANT_LIMIT quantized range). The decoder uses `seq` to
+ * notice lost samples and discards deltas until the next keyframe. Only a gap of exactly
+ * a multiple of 32768 samples (5.5 min at 100 Hz) goes unnoticed; the deltas after it
+ * decode against stale values until the next keyframe, at most the keyframe interval later.
+ *
+ * Every payload depends on all the ones since the last keyframe, so a delta stream must
+ * never be coalesced (keeping only the latest payload of an outage): drop what can't be sent.
+ *
+ * No heap; builds on the host. DeltaBufWriter gives the encoder the JsonBufWriter call
+ * sequence for TelemetryWriter. tools/imu_delta_rx.py decodes on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "packed_writer.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef DELTA_KEYFRAME_INTERVAL
+#define DELTA_KEYFRAME_INTERVAL 50 // samples between keyframes (0.5 s at 100 Hz)
+#endif
+
+#ifndef DELTA_MAX_CHANNELS
+#define DELTA_MAX_CHANNELS 8
+#endif
+
+static constexpr uint16_t DELTA_FLAG_KEYFRAME = 0x8000;
+static constexpr uint16_t DELTA_SEQ_MASK = 0x7FFF;
+static constexpr size_t DELTA_HEADER_BYTES = 3; // schema id, u16 hdr
+static constexpr int32_t DELTA_QUANT_LIMIT = 0x3FFFFFFF; // quantized values saturate here, deltas fit int32
+
+/// Zigzag-map @p v and write it as a LEB128 varint. @return bytes written, 0 if @p cap is too small.
+size_t deltaPutVarint(int32_t v, uint8_t *out, size_t cap);
+/// Read one zigzag varint. @return bytes consumed, 0 if truncated or longer than 5 bytes.
+size_t deltaGetVarint(const uint8_t *in, size_t len, int32_t &v);
+/// The hdr of a payload of at least DELTA_HEADER_BYTES: keyframe flag and seq.
+inline uint16_t deltaHeader(const uint8_t *payload) { return (uint16_t)(payload[1] | (payload[2] << 8)); }
+
+class DeltaEncoder
+{
+public:
+    struct Stats
+    {
+        uint32_t samples;
+        uint32_t keyframes;
+        uint32_t bytes; ///< Payload bytes produced
+    };
+
+    /// @p schema supplies the ID, channel count (<= DELTA_MAX_CHANNELS) and per-channel scale.
+    explicit DeltaEncoder(const PackedSchema *schema, uint16_t keyInterval = DELTA_KEYFRAME_INTERVAL)
+        : _schema(schema), _keyInterval(keyInterval ? keyInterval : 1) {}
+
+    const PackedSchema *schema() const { return _schema; }
+
+    /**
+     * @brief Encode one sample (@p values in schema order).
+     * @return Payload length, 0 if @p cap is too small (encoder state unchanged).
+     */
+    size_t encode(const float *values, uint8_t *out, size_t cap);
+
+    /// Send the next sample as a keyframe, e.g. because the last payload was never sent.
+    void forceKeyframe() { _sinceKey = 0; }
+
+    /// Worst case payload size for @p schema (a keyframe of 5-byte varints).
+    static size_t maxEncodedLength(const PackedSchema &schema) { return DELTA_HEADER_BYTES + 5u * schema.count; }
+
+    const Stats &stats() const { return _stats; }
+
+private:
+    const PackedSchema *_schema;
+    uint16_t _keyInterval;
+    uint16_t _sinceKey{0}; // 0: next sample is a keyframe
+    uint16_t _seq{0};
+    int32_t _prev[DELTA_MAX_CHANNELS]{};
+    Stats _stats{};
+};
+
+class DeltaDecoder
+{
+public:
+    enum class Result : uint8_t
+    {
+        Ok,
+        Waiting, ///< Delta after lost samples (or before the first keyframe): skipped until a keyframe
+        Error    ///< Wrong schema ID, truncated or trailing bytes
+    };
+
+    struct Stats
+    {
+        uint32_t samples;   ///< Decoded
+        uint32_t keyframes;
+        uint32_t lost;      ///< Samples missing according to seq (mod 32768 per gap)
+        uint32_t skipped;   ///< Deltas discarded while waiting for a keyframe
+        uint32_t errors;
+    };
+
+    explicit DeltaDecoder(const PackedSchema *schema) : _schema(schema) {}
+
+    /// Decode one payload into @p out (schema order, scale removed).
+    Result decode(const uint8_t *data, size_t len, double *out);
+
+    /// Forget the stream state; the next delta waits for a keyframe.
+    void reset() { _synced = false; }
+
+    const Stats &stats() const { return _stats; }
+
+private:
+    const PackedSchema *_schema;
+    bool _synced{false};
+    bool _haveSeq{false};
+    uint16_t _nextSeq{0};
+    int32_t _prev[DELTA_MAX_CHANNELS]{};
+    Stats _stats{};
+};
+
+/**
+ * @brief JsonBufWriter call sequence on top of a DeltaEncoder (flat object, schema order).
+ *
+ * Collects the values and encodes on endObject(), so the encoder state only advances for
+ * complete samples.
+ */
+class DeltaBufWriter
+{
+public:
+    DeltaBufWriter(uint8_t *buf, size_t cap, DeltaEncoder *encoder);
+
+    void beginObject();
+    void endObject();
+    void beginArray() { _error = true; }
+    void endArray() { _error = true; }
+
+    /// Must name the next schema field.
+    void key(const char *k);
+
+    void value(float v) { number(v); }
+    void value(double v) { number((float)v); }
+    void value(int32_t v) { number((float)v); }
+    void value(uint32_t v) { number((float)v); }
+    void value(int64_t v) { number((float)v); }
+    void value(uint64_t v) { number((float)v); }
+    void value(bool v) { number(v ? 1.0f : 0.0f); }
+    void value(const char *) { _error = true; }
+
+    /// @return false on overflow, schema mismatch or missing fields.
+    bool finalize(const uint8_t *&out, size_t &len) const;
+
+    bool ok() const { return !_error; }
+
+private:
+    void number(float v);
+
+    uint8_t *_buf;
+    size_t _cap;
+    size_t _len{0};
+    DeltaEncoder *_enc;
+    float _values[DELTA_MAX_CHANNELS]{};
+    uint8_t _next{0};
+    bool _keyed{false};
+    bool _open{false};
+    bool _closed{false};
+    bool _error{false};
+};
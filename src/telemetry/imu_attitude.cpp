@@ -0,0 +1,54 @@
+#include "imu_attitude.hpp"
+
+#include <string.h>
+
+namespace
+{
+    const PackedField kAttitudeFields[] = {
+        {"roll", PackedType::I16, 100.0f},
+        {"pitch", PackedType::I16, 100.0f},
+        {"yaw", PackedType::I16, 100.0f},
+    };
+}
+
+const PackedSchema kImuAttitudeSchema{1, kAttitudeFields, 3};
+
+void imuFuseBatch(const ImuCalibration &cal, AhrsFilter &ahrs, const ImuRawSample *raw, size_t n, const float *mag,
+                  ImuSample *scaled, float attitude[3], float (*perSample)[3])
+{
+    if (!n)
+        return;
+    cal.apply(raw, n, scaled);
+    for (size_t i = 0; i < n; ++i)
+    {
+        ahrs.update(scaled[i].gyro, scaled[i].accel, mag);
+        if (perSample)
+            ahrs.toEuler(perSample[i][0], perSample[i][1], perSample[i][2]);
+    }
+    if (perSample)
+        memcpy(attitude, perSample[n - 1], sizeof(float) * 3);
+    else
+        ahrs.toEuler(attitude[0], attitude[1], attitude[2]); // once per batch, not per sample
+}
+
+bool imuEncodeAttitude(TelemetryContentType type, const float attitude[3], DeltaEncoder *delta, uint8_t *buf,
+                       size_t cap, const uint8_t *&out, size_t &len, TelemetryContentType &contentType)
+{
+    TelemetryWriter w(type, buf, cap, &kImuAttitudeSchema, delta);
+    w.beginObject();
+    w.key("roll");
+    w.value(attitude[0]);
+    w.key("pitch");
+    w.value(attitude[1]);
+    w.key("yaw");
+    w.value(attitude[2]);
+    w.endObject();
+    contentType = w.contentType();
+    return w.finalize(out, len);
+}
+
+TelemetryOfflinePolicy imuAttitudeOfflinePolicy(TelemetryContentType contentType)
+{
+    return contentType == TelemetryContentType::DELTA ? TelemetryOfflinePolicy::Drop
+                                                      : TelemetryOfflinePolicy::Coalesce;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * @file imu_attitude.hpp
+ * @brief The IMU's sample-to-payload path: a FIFO batch to corrected SI units, fused at a
+ * fixed step, and the attitude encoded in the stream's content type.
+ *
+ * IMU_MPU9250 runs it on the bus task for every drain; ImuReplay runs the same code on
+ * recorded samples, so host benchmarks (test_native_imu_replay) measure what the firmware
+ * does. Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_writer.hpp"
+#include "drivers/imu/ahrs_filter.hpp"
+#include "drivers/imu/imu_calibration.hpp"
+#include "drivers/imu/mpu9250_fifo.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef IMU_DELTA_KEYFRAME_INTERVAL
+#define IMU_DELTA_KEYFRAME_INTERVAL DELTA_KEYFRAME_INTERVAL // DELTA encoding: samples between keyframes
+#endif
+
+/// Packed attitude, schema 1: roll, pitch, yaw as int16 centidegrees (±327 deg at 0.01 deg).
+extern const PackedSchema kImuAttitudeSchema;
+
+/// FIFO counts to SI units, for ImuCalibration::setRawScale().
+static constexpr float IMU_FIFO_ACCEL_MS2_PER_LSB = IMU_STANDARD_GRAVITY / Mpu9250Fifo::kAccelLsbPerG;
+static constexpr float IMU_FIFO_GYRO_RADS_PER_LSB = 0.0174532925f / Mpu9250Fifo::kGyroLsbPerDps;
+
+/**
+ * @brief Fuse one FIFO batch: all @p n frames to corrected SI units first (one
+ * multiply-subtract per value, see ImuCalibration), then one filter step per sample at the
+ * filter's fixed rate, oldest first, then the Euler angles once.
+ *
+ * @param mag Corrected field in uT used for the whole batch, nullptr = accel + gyro only
+ * @param scaled Out: the @p n corrected samples (calibration routines take them)
+ * @param attitude Out: roll, pitch, yaw in degrees after the newest sample
+ * @param perSample Out (optional): roll, pitch, yaw after each of the @p n samples, for the
+ * blackbox's full-rate log; costs one Euler conversion per sample, nullptr = the newest only
+ */
+void imuFuseBatch(const ImuCalibration &cal, AhrsFilter &ahrs, const ImuRawSample *raw, size_t n, const float *mag,
+                  ImuSample *scaled, float attitude[3], float (*perSample)[3] = nullptr);
+
+/**
+ * @brief Encode roll, pitch, yaw (degrees) as @p type into @p buf: a {"roll","pitch","yaw"}
+ * map for JSON and CBOR, kImuAttitudeSchema for BINARY, through @p delta for DELTA.
+ *
+ * @param out, len The payload, inside @p buf
+ * @param contentType Out: what was written (TEXT is written as JSON)
+ * @return false if it doesn't fit in @p cap
+ */
+bool imuEncodeAttitude(TelemetryContentType type, const float attitude[3], DeltaEncoder *delta, uint8_t *buf,
+                       size_t cap, const uint8_t *&out, size_t &len, TelemetryContentType &contentType);
+
+/**
+ * @brief What to do with an attitude payload of @p contentType that can't be sent now:
+ * keep the latest (Coalesce, attitude is state), except for DELTA, which only decodes on
+ * top of every payload before it and is dropped (the receiver resyncs at a keyframe).
+ */
+TelemetryOfflinePolicy imuAttitudeOfflinePolicy(TelemetryContentType contentType);
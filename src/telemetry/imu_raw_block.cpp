@@ -0,0 +1,122 @@
+#include "imu_raw_block.hpp"
+
+#include <string.h>
+
+namespace
+{
+    void put16(uint8_t *p, uint16_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    void put32(uint8_t *p, uint32_t v)
+    {
+        put16(p, (uint16_t)v);
+        put16(p + 2, (uint16_t)(v >> 16));
+    }
+
+    uint16_t get16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+    uint32_t get32(const uint8_t *p) { return get16(p) | (uint32_t)get16(p + 2) << 16; }
+}
+
+void ImuRawBlockWriter::configure(uint16_t rateHz, uint16_t accelLsbPerG, uint16_t gyroLsbPerDpsX10)
+{
+    _rateHz = rateHz;
+    _accelLsbPerG = accelLsbPerG;
+    _gyroLsbPerDpsX10 = gyroLsbPerDpsX10;
+}
+
+void ImuRawBlockWriter::reset()
+{
+    _n = 0;
+    _index = 0;
+    _blocks = 0;
+    _gap = false;
+}
+
+void ImuRawBlockWriter::skip(uint32_t n)
+{
+    // Blocks are contiguous: the partial one is dropped too (its samples show up in the jump)
+    _index += n;
+    _gap = true;
+    _n = 0;
+}
+
+bool ImuRawBlockWriter::add(const ImuRawSample &s, uint32_t readUs)
+{
+    if (_n == 0)
+    {
+        _buf[0] = IMU_RAW_BLOCK_ID;
+        _buf[1] = _gap ? IMU_RAW_FLAG_GAP : 0;
+        put16(_buf + 2, _rateHz);
+        put32(_buf + 4, _index);
+        put16(_buf + 12, _accelLsbPerG);
+        put16(_buf + 14, _gyroLsbPerDpsX10);
+        _gap = false;
+    }
+    uint8_t *p = _buf + IMU_RAW_BLOCK_HEADER + _n * IMU_RAW_SAMPLE_BYTES;
+    for (int a = 0; a < 3; ++a)
+    {
+        put16(p + 2 * a, (uint16_t)s.accel[a]);
+        put16(p + 6 + 2 * a, (uint16_t)s.gyro[a]);
+    }
+    _index++;
+    if (++_n < IMU_RAW_BLOCK_SAMPLES)
+        return false;
+
+    put32(_buf + 8, readUs);
+    _n = 0;
+    _blocks++;
+    return true;
+}
+
+bool imuRawBlockDecode(const uint8_t *data, size_t len, ImuRawBlockInfo &info, ImuRawSample *out, size_t cap)
+{
+    if (len < IMU_RAW_BLOCK_HEADER || data[0] != IMU_RAW_BLOCK_ID ||
+        (len - IMU_RAW_BLOCK_HEADER) % IMU_RAW_SAMPLE_BYTES)
+        return false;
+
+    info.flags = data[1];
+    info.rate_hz = get16(data + 2);
+    info.index = get32(data + 4);
+    info.t_us = get32(data + 8);
+    info.accel_lsb_per_g = get16(data + 12);
+    info.gyro_lsb_per_dps_x10 = get16(data + 14);
+    info.count = (len - IMU_RAW_BLOCK_HEADER) / IMU_RAW_SAMPLE_BYTES;
+
+    const uint8_t *p = data + IMU_RAW_BLOCK_HEADER;
+    for (size_t i = 0; i < info.count && i < cap; ++i, p += IMU_RAW_SAMPLE_BYTES)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            out[i].accel[a] = (int16_t)get16(p + 2 * a);
+            out[i].gyro[a] = (int16_t)get16(p + 6 + 2 * a);
+        }
+    }
+    return true;
+}
+
+size_t imuRawSerialFrame(const uint8_t *block, size_t len, uint8_t *out, size_t cap)
+{
+    if (len > 255 || len + IMU_RAW_SERIAL_OVERHEAD > cap)
+        return 0;
+    out[0] = 0xA5;
+    out[1] = 0x5A;
+    out[2] = (uint8_t)len;
+    memcpy(out + 3, block, len);
+    put16(out + 3 + len, imuRawCrc16(block, len));
+    return len + IMU_RAW_SERIAL_OVERHEAD;
+}
+
+uint16_t imuRawCrc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; ++b)
+            crc = crc & 0x8000 ? (uint16_t)(crc << 1 ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+/**
+ * @file imu_raw_block.hpp
+ * @brief Raw IMU samples (accel + gyro counts) packed into fixed-size binary blocks, for
+ * vibration analysis and filter tuning at the FIFO rate.
+ *
+ * A fused attitude at the publish rate hides everything above a few Hz. Raw mode sends the
+ * sensor's int16 frames as they came out of the FIFO, IMU_RAW_BLOCK_SAMPLES per payload,
+ * with one small header instead of per-sample JSON. Block layout (little endian):
+ *
+ *     u8  id = IMU_RAW_BLOCK_ID
+ *     u8  flags: bit 0 = samples were lost right before this block (FIFO overflow, restart)
+ *     u16 rate_hz            FIFO sample rate
+ *     u32 index              sensor sample number of the first sample; a jump = lost samples
+ *     u32 t_us               read time of the last sample
+ *     u16 accel_lsb_per_g
+ *     u16 gyro_lsb_per_dps x 10
+ *     n x (i16 ax, ay, az, gx, gy, gz)    n = (length - 16) / 12
+ *
+ * The same block is a telemetry payload, a blackbox frame (the id doesn't collide with
+ * packed schema ids) and, wrapped by imuRawSerialFrame(), a serial frame:
+ *
+ *     u8 0xA5 | u8 0x5A | u8 length | block | u16 CRC-16/CCITT-FALSE over the block
+ *
+ * so a reader can resync on a port that also carries log lines. Builds on the host;
+ * tools/imu_raw_rx.py decodes all three.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "drivers/imu/mpu9250_fifo.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef IMU_RAW_BLOCK_SAMPLES
+#define IMU_RAW_BLOCK_SAMPLES 16 // 208 byte blocks: one pool buffer, one blackbox frame (u8 length)
+#endif
+
+static constexpr uint8_t IMU_RAW_BLOCK_ID = 0x52; // 'R'
+static constexpr uint8_t IMU_RAW_FLAG_GAP = 0x01;
+static constexpr size_t IMU_RAW_BLOCK_HEADER = 16;
+static constexpr size_t IMU_RAW_SAMPLE_BYTES = 12;
+static constexpr size_t IMU_RAW_BLOCK_BYTES = IMU_RAW_BLOCK_HEADER + IMU_RAW_BLOCK_SAMPLES * IMU_RAW_SAMPLE_BYTES;
+static constexpr size_t IMU_RAW_SERIAL_OVERHEAD = 5; // sync, length, CRC
+
+static_assert(IMU_RAW_BLOCK_SAMPLES > 0 && IMU_RAW_BLOCK_BYTES <= 255,
+              "IMU_RAW_BLOCK_SAMPLES: a block must fit a u8 length (blackbox frames, serial frames)");
+
+/**
+ * @brief Collects samples into a block; add() says when it is full.
+ *
+ * Bus task only. The block buffer is the writer's own; copy it out (acquireBuffer(),
+ * record()) before the next add().
+ */
+class ImuRawBlockWriter
+{
+public:
+    /// Scales and rate go into every header.
+    void configure(uint16_t rateHz, uint16_t accelLsbPerG, uint16_t gyroLsbPerDpsX10);
+
+    /// Start over at sample 0, no gap (raw mode switched on).
+    void reset();
+
+    /// @p n samples were lost before the next one: the index skips them (and the partial
+    /// block, which is dropped), the next block is flagged.
+    void skip(uint32_t n);
+
+    /**
+     * @brief Append one frame read at @p readUs.
+     * @return true when the block is full: block() is valid until the next add()
+     */
+    bool add(const ImuRawSample &s, uint32_t readUs);
+
+    const uint8_t *block() const { return _buf; }
+    size_t blockLength() const { return IMU_RAW_BLOCK_BYTES; }
+
+    /// Blocks completed since reset().
+    uint32_t blocks() const { return _blocks; }
+
+private:
+    uint8_t _buf[IMU_RAW_BLOCK_BYTES]{};
+    size_t _n{0};
+    uint32_t _index{0}; ///< Sample number of the next add()
+    uint32_t _blocks{0};
+    bool _gap{false};
+    uint16_t _rateHz{0}, _accelLsbPerG{0}, _gyroLsbPerDpsX10{0};
+};
+
+struct ImuRawBlockInfo
+{
+    uint8_t flags;
+    uint16_t rate_hz;
+    uint32_t index;
+    uint32_t t_us;
+    uint16_t accel_lsb_per_g;
+    uint16_t gyro_lsb_per_dps_x10;
+    size_t count;
+};
+
+/**
+ * @brief Parse a block (tests, tools). Samples go to @p out (up to @p cap of them).
+ * @return false if it isn't a raw block or its length doesn't add up
+ */
+bool imuRawBlockDecode(const uint8_t *data, size_t len, ImuRawBlockInfo &info, ImuRawSample *out, size_t cap);
+
+/**
+ * @brief Wrap a block for a byte stream (see the file comment).
+ * @return Frame length, 0 if it doesn't fit in @p cap
+ */
+size_t imuRawSerialFrame(const uint8_t *block, size_t len, uint8_t *out, size_t cap);
+
+/// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+uint16_t imuRawCrc16(const uint8_t *data, size_t len);
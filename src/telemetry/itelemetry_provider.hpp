@@ -6,40 +6,42 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "telemetry_buffer_pool.hpp"
+#include "telemetry_topic_table.hpp"
+#include "telemetry_sample.hpp"
+#include "telemetry_stream_stats.hpp"
+
+#include "esp_timer.h"
 
 extern "C"
 {
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 }
 
-enum class TelemetryContentType : uint8_t
+/// Where providers queue their samples (TelemetryService's per-class TX queue).
+class ITelemetrySink
 {
-    JSON,
-    CBOR,
-    BINARY,
-    TEXT
-};
+public:
+    virtual ~ITelemetrySink() = default;
 
-struct TelemetryMeta
-{
-    uint8_t qos = 0;
-    bool retain = false;
-    TelemetryContentType content_type = TelemetryContentType::JSON;
-    bool full_topic = false;
+    /**
+     * @brief Queue @p sample in its meta.traffic_class. Samples the class displaces to make
+     * room are released (and counted) by the sink.
+     * @param timeoutTicks How long to wait for room in a full DropNewest class.
+     * @param latestOnly Replace a queued sample of the same stream instead of adding one.
+     * @return false if @p sample was not queued; its buffer is still the caller's.
+     */
+    virtual bool enqueue(const TelemetrySample &sample, TickType_t timeoutTicks, bool latestOnly) = 0;
 };
 
-/**
- * @brief Telemetry sample descriptor passed through the queue.
- * NOTE: topic_suffix/payload must point to storage that remains valid
- * until the consumer has used them (provider should double-buffer or similar).
- */
-struct TelemetrySample
+/// Lets an interrupt-driven provider wake the sampling task (TelemetryService).
+class ISampleTrigger
 {
-    const char *topic_suffix{nullptr};
-    const uint8_t *payload{nullptr};
-    size_t payload_length{0};
-    TelemetryMeta meta{};
+public:
+    virtual ~ISampleTrigger() = default;
+
+    /// ISR-safe: run scheduler entry @p slot's sample() now; @p isrUs is when the interrupt fired.
+    virtual void triggerFromISR(int slot, uint64_t isrUs) = 0;
 };
 
 class ITelemetryProvider
@@ -59,38 +61,137 @@ public:
     /// Called when e.g. TelemetryService changes sampling rate of this provider.
     virtual void onSamplingRateChange(uint32_t newRateHz) { (void)newRateHz; }
 
-    /// Wire the output queue before tasks start.
-    void setOutputQueue(QueueHandle_t qHandle) { _out = qHandle; }
+    /**
+     * @brief Return true to be sampled by TelemetryService's scheduler: sample() is then
+     * called at sampleRateHz() from the shared sampling task, and begin() must not start
+     * a task of its own.
+     */
+    virtual bool scheduled() const { return false; }
+
+    /**
+     * @brief Return true (scheduled providers) to be sampled when the provider's interrupt
+     * calls triggerSampleFromISR() rather than on a timer; sampleRateHz() is then the rate
+     * the interrupts are expected at, and a backstop if they stop. Asked after begin().
+     */
+    virtual bool triggered() const { return false; }
+
+    /// Take and publish one sample (scheduled providers). Keep it short and non-blocking.
+    virtual void sample() {}
+
+    /// Wire the output before tasks start.
+    void setOutput(ITelemetrySink *sink) { _out = sink; }
+
+    /// Wire the shared payload pool before tasks start.
+    void setBufferPool(TelemetryBufferPool *pool) { _pool = pool; }
+
+    /// Wire the stream topic table before begin().
+    void setTopicTable(TelemetryTopicTable *topics) { _topics = topics; }
+
+    /// Wire the per-stream sequence/drop accounting before tasks start.
+    void setStreamStats(TelemetryStreamStats *stats) { _stats = stats; }
+
+    /// Wire the sampling task's trigger (triggered providers, after begin()).
+    void setSampleTrigger(ISampleTrigger *trigger, int slot)
+    {
+        _triggerSlot = slot;
+        _trigger = trigger;
+    }
 
 protected:
+    /**
+     * @brief Register a stream's topic once (call from begin()) and tag its samples with the ID.
+     * @return Stream ID, or TELEMETRY_STREAM_NONE (samples then fall back to topic_suffix).
+     */
+    TelemetryStreamId registerStream(const char *topicSuffix, bool fullTopic = false)
+    {
+        return _topics ? _topics->add(topicSuffix, fullTopic) : TELEMETRY_STREAM_NONE;
+    }
+
+    /// From the provider's ISR: have sample() run on the sampling task as soon as possible.
+    void triggerSampleFromISR(uint64_t isrUs)
+    {
+        ISampleTrigger *t = _trigger;
+        if (t)
+            t->triggerFromISR(_triggerSlot, isrUs);
+    }
+
     /**
      * @brief Publish by value (no heap). Returns false on failure.
-     * @param timeoutTicks Use 0 to drop when the queue is full; or a small timeout for backpressure.
+     * @param timeoutTicks Use 0 to give up at once when the class is full; or a small timeout
+     * for backpressure (DropNewest classes; the others make room instead).
+     *
+     * Stamps the stream's next sequence number (and the capture time, unless the provider
+     * set `t_us` when it read the sensor). Samples the queue refuses or displaces are
+     * counted as enqueue drops of their stream.
      *
-     * @warning IMPORTANT: The queue must be created with item_size == sizeof(TelemetrySample).
-     * The pointed-to buffers must remain valid until the consumer is done.
+     * @warning The pointed-to buffers must remain valid until the consumer is done.
      */
-    bool publish(const TelemetrySample &sample, TickType_t timeoutTicks = 0)
+    bool publish(TelemetrySample sample, TickType_t timeoutTicks = 0)
     {
         if (!_out)
         {
             return false;
         }
-        // FreeRTOS will copy sizeof(TelemetrySample) bytes into the queue
-        return xQueueSend(_out, &sample, timeoutTicks) == pdTRUE;
+        if (!sample.t_us)
+            sample.t_us = (uint32_t)esp_timer_get_time();
+        if (_stats)
+            sample.seq = _stats->stamp(sample.stream);
+        return _out->enqueue(sample, timeoutTicks, false); // copied into the class queue
+    }
+
+    /**
+     * @brief Get a payload buffer from the shared pool for a sample of class @p cls. Check
+     * valid(): when the pool is exhausted (TX is behind) the sample should be skipped.
+     * Bulk and Control leave a reserve for Critical samples, see telemetry_buffer_pool.hpp.
+     */
+    TelemetryLease acquireBuffer(TelemetryClass cls = TelemetryClass::Bulk)
+    {
+        return _pool ? _pool->acquire(cls) : TelemetryLease{};
+    }
+
+    /**
+     * @brief Queue a sample whose payload was written into @p lease. Ownership of the
+     * buffer passes to the queue; it is released here if the queue is full.
+     */
+    bool publishBuffer(TelemetryLease &lease, TelemetrySample sample, TickType_t timeoutTicks = 0)
+    {
+        sample.buffer = lease.slot;
+        lease = TelemetryLease{};
+        if (publish(sample, timeoutTicks))
+            return true;
+        if (_pool)
+            _pool->release(sample.buffer);
+        return false;
+    }
+
+    /// Give back a buffer that won't be published (e.g. encoding failed).
+    void releaseBuffer(TelemetryLease &lease)
+    {
+        if (_pool)
+            _pool->release(lease.slot);
+        lease = TelemetryLease{};
     }
 
     /**
-     * @brief Overwrite the single-slot queue (latest-only semantics).
-     * Only use if _out refers to a queue created with length==1.
+     * @brief Publish with latest-only semantics: a sample of the same stream still waiting in
+     * the queue is replaced (its pooled buffer released), whatever the class's drop policy.
      */
-    bool publishOverwrite(const TelemetrySample &sample)
+    bool publishOverwrite(TelemetrySample sample)
     {
         if (!_out)
             return false;
-        return xQueueOverwrite(_out, &sample) == pdTRUE;
+        if (!sample.t_us)
+            sample.t_us = (uint32_t)esp_timer_get_time();
+        if (_stats)
+            sample.seq = _stats->stamp(sample.stream); // an overwritten sample shows up as a gap
+        return _out->enqueue(sample, 0, true);
     }
 
 private:
-    QueueHandle_t _out{nullptr};
+    ITelemetrySink *_out{nullptr};
+    TelemetryBufferPool *_pool{nullptr};
+    TelemetryTopicTable *_topics{nullptr};
+    TelemetryStreamStats *_stats{nullptr};
+    ISampleTrigger *volatile _trigger{nullptr}; // read by the provider's ISR
+    int _triggerSlot{-1};
 };
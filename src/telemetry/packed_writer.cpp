@@ -0,0 +1,224 @@
+#include "packed_writer.hpp"
+
+#include <string.h>
+
+namespace
+{
+    size_t typeSize(PackedType t)
+    {
+        switch (t)
+        {
+        case PackedType::I8:
+        case PackedType::U8:
+        case PackedType::Bool:
+            return 1;
+        case PackedType::I16:
+        case PackedType::U16:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+
+    int64_t scaled(double v, double scale, double lo, double hi)
+    {
+        double s = v * scale;
+        if (!(s == s)) // NaN
+            s = 0;
+        s = s < lo ? lo : (s > hi ? hi : s);
+        return (int64_t)(s < 0 ? s - 0.5 : s + 0.5); // half away from zero, cheaper than lround()
+    }
+
+    void putLe(uint8_t *p, uint32_t v, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            p[i] = (uint8_t)(v >> (8 * i));
+    }
+
+    uint32_t getLe(const uint8_t *p, size_t n)
+    {
+        uint32_t v = 0;
+        for (size_t i = 0; i < n; ++i)
+            v |= (uint32_t)p[i] << (8 * i);
+        return v;
+    }
+}
+
+void PackedBufWriter::reset(uint8_t *buf, size_t cap, const PackedSchema *schema)
+{
+    _buf = buf;
+    _cap = buf ? cap : 0;
+    _len = 0;
+    _schema = schema;
+    _next = 0;
+    _keyed = false;
+    _open = false;
+    _closed = false;
+    _error = !schema;
+}
+
+void PackedBufWriter::put(const void *p, size_t n)
+{
+    if (n > _cap - _len)
+    {
+        _error = true;
+        return;
+    }
+    memcpy(_buf + _len, p, n);
+    _len += n;
+}
+
+void PackedBufWriter::beginObject()
+{
+    if (_open || _closed || _error)
+    {
+        _error = true; // flat objects only
+        return;
+    }
+    _open = true;
+    put(&_schema->id, 1);
+}
+
+void PackedBufWriter::endObject()
+{
+    if (!_open || _next != _schema->count)
+        _error = true;
+    _open = false;
+    _closed = true;
+}
+
+void PackedBufWriter::key(const char *k)
+{
+    if (!_open || _keyed || _next >= _schema->count)
+    {
+        _error = true;
+        return;
+    }
+    const char *want = _schema->fields[_next].name;
+    if (k != want && (!k || strcmp(k, want) != 0))
+        _error = true;
+    _keyed = true;
+}
+
+const PackedField *PackedBufWriter::field()
+{
+    if (_error || !_open || !_keyed)
+    {
+        _error = true;
+        return nullptr;
+    }
+    _keyed = false;
+    return &_schema->fields[_next++];
+}
+
+void PackedBufWriter::value(float v)
+{
+    if (const PackedField *f = field())
+        emit(*f, v); // float -> double -> float is exact for F32 fields
+}
+
+void PackedBufWriter::number(double v)
+{
+    if (const PackedField *f = field())
+        emit(*f, v);
+}
+
+void PackedBufWriter::emit(const PackedField &f, double v)
+{
+    uint8_t b[4];
+    const double sc = f.scale != 0.0f ? f.scale : 1.0;
+    uint32_t raw;
+    switch (f.type)
+    {
+    case PackedType::F32:
+    {
+        const float fv = (float)v;
+        memcpy(&raw, &fv, sizeof(raw));
+        break;
+    }
+    case PackedType::I8:
+        raw = (uint32_t)scaled(v, sc, -128, 127);
+        break;
+    case PackedType::U8:
+        raw = (uint32_t)scaled(v, sc, 0, 255);
+        break;
+    case PackedType::I16:
+        raw = (uint32_t)scaled(v, sc, -32768, 32767);
+        break;
+    case PackedType::U16:
+        raw = (uint32_t)scaled(v, sc, 0, 65535);
+        break;
+    case PackedType::I32:
+        raw = (uint32_t)scaled(v, sc, -2147483648.0, 2147483647.0);
+        break;
+    case PackedType::U32:
+        raw = (uint32_t)scaled(v, sc, 0, 4294967295.0);
+        break;
+    default:
+        raw = v != 0.0 ? 1 : 0;
+        break;
+    }
+    const size_t n = typeSize(f.type);
+    putLe(b, raw, n);
+    put(b, n);
+}
+
+bool PackedBufWriter::finalize(const uint8_t *&out, size_t &len) const
+{
+    if (_error || !_closed)
+        return false;
+    out = _buf;
+    len = _len;
+    return true;
+}
+
+size_t PackedBufWriter::encodedLength(const PackedSchema &schema)
+{
+    size_t n = 1;
+    for (uint8_t i = 0; i < schema.count; ++i)
+        n += typeSize(schema.fields[i].type);
+    return n;
+}
+
+bool packedDecode(const PackedSchema &schema, const uint8_t *data, size_t len, double *out)
+{
+    if (!data || len != PackedBufWriter::encodedLength(schema) || data[0] != schema.id)
+        return false;
+    const uint8_t *p = data + 1;
+    for (uint8_t i = 0; i < schema.count; ++i)
+    {
+        const PackedField &f = schema.fields[i];
+        const size_t n = typeSize(f.type);
+        const uint32_t raw = getLe(p, n);
+        const double sc = f.scale != 0.0f ? f.scale : 1.0;
+        double v;
+        switch (f.type)
+        {
+        case PackedType::F32:
+        {
+            float fv;
+            memcpy(&fv, &raw, sizeof(fv));
+            v = fv;
+            break;
+        }
+        case PackedType::I8:
+            v = (int8_t)raw / sc;
+            break;
+        case PackedType::I16:
+            v = (int16_t)raw / sc;
+            break;
+        case PackedType::I32:
+            v = (int32_t)raw / sc;
+            break;
+        case PackedType::Bool:
+            v = raw ? 1.0 : 0.0;
+            break;
+        default:
+            v = raw / sc;
+            break;
+        }
+        out[i] = v;
+        p += n;
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * @file packed_writer.hpp
+ * @brief Schema-driven packed binary encoder with the JsonBufWriter call sequence.
+ *
+ * The schema fixes field order and wire type, so a sample is just a schema ID byte
+ * followed by the values, little endian, without names or tags. key() checks the
+ * name against the schema so a provider that drifts from its schema fails finalize()
+ * instead of emitting misaligned data. Integer fields can carry a scale
+ * (stored = round(value * scale)), e.g. angles as int16 centidegrees.
+ *
+ * Flat objects only: nested objects, arrays and strings are rejected. No heap; builds
+ * on the host. packedDecode() is the matching reader for tools and tests.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum class PackedType : uint8_t
+{
+    F32,
+    I8,
+    U8,
+    I16,
+    U16,
+    I32,
+    U32,
+    Bool
+};
+
+struct PackedField
+{
+    const char *name;
+    PackedType type;
+    float scale; ///< Integer types: stored = round(value * scale), saturated. Ignored for F32/Bool.
+};
+
+struct PackedSchema
+{
+    uint8_t id; ///< First payload byte, lets the receiver pick the schema
+    const PackedField *fields;
+    uint8_t count;
+};
+
+class PackedBufWriter
+{
+public:
+    PackedBufWriter(uint8_t *buf, size_t cap, const PackedSchema *schema) { reset(buf, cap, schema); }
+
+    void reset(uint8_t *buf, size_t cap, const PackedSchema *schema);
+
+    void beginObject();
+    void endObject();
+    void beginArray() { _error = true; }
+    void endArray() { _error = true; }
+
+    /// Must name the next schema field.
+    void key(const char *k);
+
+    void value(float v);
+    void value(double v) { number(v); }
+    void value(int32_t v) { number((double)v); }
+    void value(uint32_t v) { number((double)v); }
+    void value(int64_t v) { number((double)v); }
+    void value(uint64_t v) { number((double)v); }
+    void value(bool v) { number(v ? 1.0 : 0.0); }
+    void value(const char *) { _error = true; }
+
+    /// @return false on overflow, schema mismatch or missing fields.
+    bool finalize(const uint8_t *&out, size_t &len) const;
+
+    bool ok() const { return !_error; }
+    size_t size() const { return _len; }
+
+    /// Encoded size of one sample for @p schema.
+    static size_t encodedLength(const PackedSchema &schema);
+
+private:
+    void number(double v);
+    const PackedField *field();
+    void emit(const PackedField &f, double v);
+    void put(const void *p, size_t n);
+
+    uint8_t *_buf{nullptr};
+    size_t _cap{0};
+    size_t _len{0};
+    const PackedSchema *_schema{nullptr};
+    uint8_t _next{0};    // index of the field the next value belongs to
+    bool _keyed{false};  // key() seen for _next
+    bool _open{false};
+    bool _closed{false};
+    bool _error{false};
+};
+
+/**
+ * @brief Decode one packed sample into @p out (schema order, scale removed).
+ * @return false on wrong schema ID or length.
+ */
+bool packedDecode(const PackedSchema &schema, const uint8_t *data, size_t len, double *out);
@@ -0,0 +1,128 @@
+#include "sample_scheduler.hpp"
+
+int SampleScheduler::add(uint32_t rateHz, uint64_t nowUs)
+{
+    if (_count >= SAMPLE_SCHEDULER_MAX_ENTRIES || rateHz == 0)
+        return -1;
+    Entry &e = _entries[_count];
+    e = Entry{};
+    e.stats.period_us = periodUs(rateHz);
+    e.due_us = nowUs + e.stats.period_us;
+    return (int)_count++;
+}
+
+void SampleScheduler::setRate(int idx, uint32_t rateHz, uint64_t nowUs)
+{
+    if (idx < 0 || (size_t)idx >= _count)
+        return;
+    Entry &e = _entries[idx];
+    if (e.stats.period_us == 0 && rateHz)
+        e.due_us = nowUs + periodUs(rateHz); // waking up: no backlog of missed slots
+    e.stats.period_us = periodUs(rateHz);
+}
+
+void SampleScheduler::setTriggered(int idx, bool on, uint64_t nowUs)
+{
+    if (idx < 0 || (size_t)idx >= _count)
+        return;
+    Entry &e = _entries[idx];
+    if (e.triggered == on)
+        return;
+    e.triggered = on;
+    e.pending = false;
+    e.due_us = on ? nowUs : nowUs + e.stats.period_us; // backstop base / next slot on the grid
+}
+
+void SampleScheduler::trigger(int idx, uint64_t atUs)
+{
+    if (idx < 0 || (size_t)idx >= _count)
+        return;
+    Entry &e = _entries[idx];
+    if (!e.triggered || e.stats.period_us == 0)
+        return;
+    if (e.pending)
+        e.stats.misses++;
+    e.due_us = atUs;
+    e.pending = true;
+}
+
+int SampleScheduler::next(uint64_t &dueUs) const
+{
+    int best = -1;
+    uint64_t bestDue = 0;
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (_entries[i].stats.period_us == 0)
+            continue;
+        const uint64_t due = dueOf(_entries[i]);
+        if (best < 0 || due < bestDue)
+        {
+            best = (int)i;
+            bestDue = due;
+        }
+    }
+    if (best >= 0)
+        dueUs = bestDue;
+    return best;
+}
+
+void SampleScheduler::start(int idx, uint64_t startUs)
+{
+    if (idx < 0 || (size_t)idx >= _count || !_entries[idx].triggered)
+        return;
+    // A trigger that arrives from here on is for the next run
+    Entry &e = _entries[idx];
+    e.run_due_us = dueOf(e);
+    e.backstop = !e.pending;
+    e.pending = false;
+    e.due_us = startUs;
+}
+
+void SampleScheduler::complete(int idx, uint64_t startUs, uint64_t endUs)
+{
+    if (idx < 0 || (size_t)idx >= _count || idle(idx))
+        return;
+    Entry &e = _entries[idx];
+    Stats &st = e.stats;
+
+    const uint64_t due = e.triggered ? e.run_due_us : e.due_us;
+    const uint64_t late = startUs > due ? startUs - due : 0;
+    const uint64_t exec = endUs > startUs ? endUs - startUs : 0;
+    st.runs++;
+    st.late_sum_us += late;
+    if (late > st.late_max_us)
+        st.late_max_us = (uint32_t)late;
+    if (exec > st.exec_max_us)
+        st.exec_max_us = (uint32_t)exec;
+
+    if (e.triggered)
+    {
+        // Misses are counted by trigger(); the next deadline is the next interrupt
+        if (e.backstop)
+            st.timeouts++;
+        if (endUs > due + st.period_us)
+            st.overruns++;
+        return;
+    }
+
+    // Next slot on the original grid; skip (and count) slots that have already passed
+    const uint32_t period = st.period_us;
+    e.due_us += period;
+    if (startUs >= e.due_us)
+    {
+        const uint64_t skipped = (startUs - e.due_us) / period + 1;
+        st.misses += (uint32_t)skipped;
+        e.due_us += skipped * period;
+    }
+    if (endUs > e.due_us)
+        st.overruns++; // the next run will start late
+}
+
+void SampleScheduler::resetStats(int idx)
+{
+    if (idx < 0 || (size_t)idx >= _count)
+        return;
+    const uint32_t period = _entries[idx].stats.period_us;
+    _entries[idx].stats = Stats{};
+    _entries[idx].stats.period_us = period;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * @file sample_scheduler.hpp
+ * @brief Earliest-deadline-first timetable for periodic sampling, microsecond deadlines.
+ *
+ * TelemetryService's sampling task asks for the entry due next, sleeps until its
+ * deadline and reports when the run started and ended. Deadlines advance by whole
+ * periods from the previous deadline (not from the run), so there is no drift and no
+ * tick rounding. When a run is so late that whole periods were skipped, they are
+ * counted as misses and the entry resumes on the next future slot instead of
+ * bursting to catch up. An entry set to 0 Hz is idle: next() passes it over until
+ * it gets a rate again.
+ *
+ * A triggered entry (setTriggered()) runs when an interrupt calls trigger() instead, with
+ * the interrupt time as its deadline, so `late` is the interrupt-to-run latency. Its period
+ * is only a backstop: without a trigger for two periods it runs anyway (counted as a
+ * timeout), so a dead interrupt line slows the entry down instead of stopping it.
+ * Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Tunables ===============================================================
+#ifndef SAMPLE_SCHEDULER_MAX_ENTRIES
+#define SAMPLE_SCHEDULER_MAX_ENTRIES 8
+#endif
+
+class SampleScheduler
+{
+public:
+    struct Stats
+    {
+        uint32_t runs;
+        uint32_t misses;      ///< Periods skipped because a run started a full period late
+        uint32_t overruns;    ///< Runs that ended after their next deadline
+        uint32_t late_max_us; ///< Start - deadline (jitter), worst case
+        uint64_t late_sum_us; ///< ... sum over runs, / runs = mean
+        uint32_t exec_max_us; ///< Longest run
+        uint32_t period_us;   ///< Current period, 0 = idle
+        uint32_t timeouts;    ///< Triggered entries: runs without a trigger (backstop)
+    };
+
+    /// @return Entry index, or -1 if full / rate is 0.
+    int add(uint32_t rateHz, uint64_t nowUs);
+
+    /**
+     * @brief Change an entry's rate; takes effect from its next deadline.
+     * 0 makes it idle; an idle entry that gets a rate is next due one period after @p nowUs.
+     */
+    void setRate(int idx, uint32_t rateHz, uint64_t nowUs = 0);
+
+    bool idle(int idx) const { return _entries[idx].stats.period_us == 0; }
+
+    /// Run @p idx on trigger() instead of its period grid (or back on the grid).
+    void setTriggered(int idx, bool on, uint64_t nowUs = 0);
+    bool triggered(int idx) const { return _entries[idx].triggered; }
+
+    /**
+     * @brief Interrupt side: @p idx is due at @p atUs. A trigger still pending is replaced
+     * and counted as a miss (the data it announced was overwritten before it was read).
+     * Ignored while the entry is idle or not triggered.
+     */
+    void trigger(int idx, uint64_t atUs);
+
+    /// @return Index of the entry due first (@p dueUs set), or -1 if none is active.
+    int next(uint64_t &dueUs) const;
+
+    /// A run of @p idx starts (takes its pending trigger; nothing to do for periodic entries).
+    void start(int idx, uint64_t startUs);
+
+    /// Record a run of @p idx and schedule its next deadline.
+    void complete(int idx, uint64_t startUs, uint64_t endUs);
+
+    size_t size() const { return _count; }
+    const Stats &stats(int idx) const { return _entries[idx].stats; }
+
+    /// Clear run/miss/jitter counters (e.g. after publishing a stats window).
+    void resetStats(int idx);
+
+    static uint32_t periodUs(uint32_t rateHz) { return rateHz ? (1000000u + rateHz / 2) / rateHz : 0; }
+
+private:
+    struct Entry
+    {
+        uint64_t due_us;     // triggered: the pending trigger, else the last run (backstop base)
+        uint64_t run_due_us; // triggered: deadline of the run in progress
+        bool triggered;
+        bool pending;        // triggered: trigger() since the last start()
+        bool backstop;       // triggered: the run in progress had no trigger
+        Stats stats;
+    };
+
+    static uint64_t dueOf(const Entry &e)
+    {
+        return e.triggered && !e.pending ? e.due_us + 2ull * e.stats.period_us : e.due_us;
+    }
+
+    Entry _entries[SAMPLE_SCHEDULER_MAX_ENTRIES]{};
+    size_t _count{0};
+};
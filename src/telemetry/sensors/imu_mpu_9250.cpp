@@ -1,114 +1,718 @@
 #include "imu_mpu_9250.hpp"
 #include "logging/logger.hpp"
+#include "telemetry/sample_scheduler.hpp"
+#include "esp_timer.h" // esp_timer_get_time()
 
-bool IMU_MPU9250::begin()
+#include <cstdarg>
+#include <cstdio> // snprintf
+#include <cstdlib> // atof
+#include <cstring>
+
+namespace
 {
-    // Guard setup: WHOAMI, config writes, etc.
-    if (_i2cMutex)
+    constexpr uint8_t kMpuAddr = 0x68;
+    constexpr uint8_t kMagAddr = 0x0C; // AK8963, on the main bus through the MPU9250's bypass
+
+    constexpr float kRadPerDeg = 0.0174532925f;
+    constexpr float kMagUtPerLsb = 4912.0f / 32760.0f; // AK8963, 16 bit output
+    constexpr float kUtPerMilliGauss = 0.1f;           // the library's getMag*()
+
+    // FIFO mode: a gap this long is an idle period (stream off, bus backlog), not an overflow
+    constexpr uint32_t kFifoStaleUs = 500000;
+
+    static_assert(IMU_RAW_BLOCK_BYTES <= TELEMETRY_POOL_BUFFER_SIZE && IMU_RAW_BLOCK_BYTES <= BLACKBOX_FRAME_MAX,
+                  "a raw block must fit one pool buffer and one blackbox frame");
+
+    // FIFO mode: ST1, HXL..HZH, ST2 in one burst (reading ST2 releases the next sample).
+    // Scaled to uT without the fuse ROM sensitivity (the mag calibration takes it up); out
+    // keeps its last value while no new sample is ready.
+    I2cStatus readMag(II2cBackend &bus, float out[3])
     {
-        xSemaphoreTake(_i2cMutex, portMAX_DELAY);
+        const uint8_t reg = 0x02;
+        uint8_t rx[8];
+        const I2cStatus st = bus.transfer(kMagAddr, &reg, 1, rx, sizeof(rx));
+        if (st != I2cStatus::Ok)
+            return st;
+        if ((rx[0] & 0x01) && !(rx[7] & 0x08)) // data ready, no magnetic sensor overflow
+        {
+            const int16_t x = (int16_t)(rx[1] | rx[2] << 8);
+            const int16_t y = (int16_t)(rx[3] | rx[4] << 8);
+            const int16_t z = (int16_t)(rx[5] | rx[6] << 8);
+            out[0] = y * kMagUtPerLsb; // AK8963 axes -> accel/gyro axes
+            out[1] = x * kMagUtPerLsb;
+            out[2] = -z * kMagUtPerLsb;
+        }
+        return I2cStatus::Ok;
     }
-    const bool ok = _imu.setup(0x68);
-    if (_i2cMutex)
+}
+
+bool IMU_MPU9250::begin()
+{
+    if ((_fifoHz || _drdyPin >= 0) && !_bus)
     {
-        xSemaphoreGive(_i2cMutex);
+        LOGW("IMU_MPU9250", "FIFO mode and data-ready pacing need the I2cBus, polling on a timer instead");
+        _fifoHz = 0;
+        _drdyPin = -1;
     }
 
+    // WHOAMI, config writes, etc. run on the bus task like every other access
+    const bool ok = _bus ? _bus->runExclusive(kMpuAddr, &_setupJob, this) == I2cStatus::Ok
+                         : _imu.setup(kMpuAddr);
     if (!ok)
     {
         LOGE("IMU_MPU9250", "MPU connection failed");
+        _drdyPin = -1;
         return false;
     }
+    _imu.ahrs(false); // raw readings only, AhrsFilter fuses
+    _cal.setRawScale(IMU_FIFO_ACCEL_MS2_PER_LSB, IMU_FIFO_GYRO_RADS_PER_LSB);
+    if (!loadCalibration())
+        LOGW("IMU_MPU9250", "No stored calibration, running uncalibrated (see %s)", IMU_CAL_CMD_TOPIC);
 
-    // Create sampling task
-    const BaseType_t rc = xTaskCreatePinnedToCore(
-        &_taskThunk, "IMU_MPU9250", 8196, this, 18, &_taskHandle, tskNO_AFFINITY);
-    if (rc != pdPASS)
+    _streamId = registerStream(_topicSuffix); // topic resolved once, not per sample
+    if (_fifo.configured())
     {
-        LOGE("IMU_MPU9250", "Task create failed");
-        return false;
+        _ahrs.setSampleRate((float)_fifo.rateHz());
+        _rawWriter.configure((uint16_t)_fifo.rateHz(), (uint16_t)Mpu9250Fifo::kAccelLsbPerG,
+                             (uint16_t)(Mpu9250Fifo::kGyroLsbPerDps * 10.0f + 0.5f));
+        _rawStream = registerStream(IMU_RAW_TOPIC);
+        LOGI("IMU_MPU9250", "FIFO mode at %u Hz", (unsigned)_fifo.rateHz());
+    }
+    else if (_rawRequested.load())
+    {
+        LOGW("IMU_MPU9250", "Raw mode needs FIFO mode, off");
+        _rawRequested = false;
     }
+    updatePacing();
+    if (_drdyPin >= 0)
+    {
+        // The ISR only triggers once TelemetryService has wired the sampling task
+        pinMode(_drdyPin, INPUT);
+        attachInterruptArg(digitalPinToInterrupt(_drdyPin), &_drdyIsr, this, RISING);
+        LOGI("IMU_MPU9250", "Data-ready interrupt on GPIO %d at %u Hz", _drdyPin, (unsigned)_sensorHz);
+    }
+    if (IMU_STATS_MS > 0)
+        _statsStream = registerStream(IMU_STATS_TOPIC);
+    _calStream = registerStream(IMU_CAL_TOPIC);
+    _timing.resetStats((uint32_t)micros());
+    _nextStatsUs = (uint32_t)micros() + IMU_STATS_MS * 1000u;
+    _delta = DeltaEncoder(&kImuAttitudeSchema, IMU_DELTA_KEYFRAME_INTERVAL);
+    BlackboxService::instance().addSchema(&kImuAttitudeSchema, "imu"); // full-rate log, whatever the MQTT encoding
+
+    // Sampling is driven by TelemetryService's scheduler (see sample())
     return true;
 }
 
-void IMU_MPU9250::_taskThunk(void *arg)
+I2cStatus IMU_MPU9250::_setupJob(void *ctx)
 {
-    static_cast<IMU_MPU9250 *>(arg)->_runLoop();
+    IMU_MPU9250 *self = static_cast<IMU_MPU9250 *>(ctx);
+    if (!self->_imu.setup(kMpuAddr))
+        return I2cStatus::Nack;
+
+    I2cStatus st = I2cStatus::Ok;
+    if (self->_fifoHz)
+    {
+        // On top of the library's setup: own sample rate and ranges, FIFO on
+        const uint32_t now = (uint32_t)micros();
+        st = self->_fifo.configure(self->_bus->jobBackend(), kMpuAddr, self->_fifoHz, now);
+        self->_lastDrainUs = now;
+    }
+    if (st == I2cStatus::Ok && self->_drdyPin >= 0)
+    {
+        // Polled: one pulse per sample at the configured rate. FIFO mode: at the FIFO rate.
+        uint32_t hz = 0;
+        st = Mpu9250DataReady::enable(self->_bus->jobBackend(), kMpuAddr, self->_fifoHz ? 0 : self->_fullRateHz, hz);
+        self->_sensorHz = self->_fifoHz ? self->_fifo.rateHz() : hz;
+    }
+    return st;
 }
 
-void IMU_MPU9250::_runLoop()
+void IMU_MPU9250::updatePacing()
 {
-    TickType_t last = xTaskGetTickCount(); // run now
-    while (true)
+    const uint32_t hz = sampleRateHz();
+    if (!hz)
+        return; // idle: the scheduler ignores triggers anyway
+
+    // Interrupt paced: every div-th pulse, as close to the wanted rate as the sensor allows
+    uint32_t div = 1;
+    uint32_t periodUs = SampleScheduler::periodUs(hz);
+    if (_drdyPin >= 0 && _sensorHz)
     {
-        // Pace FIRST so failures can’t spin the loop
-        const uint32_t hz = _rateHz ? _rateHz : 1;
-        const TickType_t period =
-            (TickType_t)(((uint64_t)configTICK_RATE_HZ + hz - 1) / hz); // ceil
+        div = (_sensorHz + hz / 2) / hz;
+        if (div == 0)
+            div = 1;
+        periodUs = (uint32_t)((uint64_t)div * 1000000u / _sensorHz);
+    }
+    _drdyDivider.store(div, std::memory_order_relaxed);
+    _readPeriodUs.store(periodUs, std::memory_order_relaxed);
+}
 
-        vTaskDelayUntil(&last, period);
+void IRAM_ATTR IMU_MPU9250::_drdyIsr(void *arg)
+{
+    IMU_MPU9250 *self = static_cast<IMU_MPU9250 *>(arg);
+    if (++self->_drdyPhase < self->_drdyDivider.load(std::memory_order_relaxed))
+        return;
+    self->_drdyPhase = 0;
+    const uint64_t now = (uint64_t)esp_timer_get_time();
+    self->_drdyIsrUs.store((uint32_t)now, std::memory_order_relaxed);
+    self->triggerSampleFromISR(now);
+}
 
-        // --- Read sensor (I2C protected) ---
-        if (_i2cMutex)
-        {
-            xSemaphoreTake(_i2cMutex, portMAX_DELAY);
-        }
-        else
-        {
-            // Warn about I2C mutex not taken
-            LOGW("IMU_MPU9250", "I2C mutex not taken");
-        }
+void IMU_MPU9250::recordRead(uint32_t readUs)
+{
+    // A pulse time we've already used means this read came from the backstop timer
+    const uint32_t isrUs = _drdyIsrUs.load(std::memory_order_relaxed);
+    const bool fromIsr = _drdyPin >= 0 && isrUs != _lastIsrUs;
+    _lastIsrUs = isrUs;
+    _timing.setPeriod(_readPeriodUs.load(std::memory_order_relaxed));
+    _timing.record(readUs, isrUs, fromIsr);
+}
 
-        const bool ok = _imu.update();
+I2cStatus IMU_MPU9250::_updateJob(void *ctx)
+{
+    IMU_MPU9250 *self = static_cast<IMU_MPU9250 *>(ctx);
+    self->recordRead((uint32_t)micros());
+    self->_updated = self->_imu.update(); // false = no new data, not a bus error
+    if (self->_updated)
+        self->fusePolled();
+    return I2cStatus::Ok;
+}
 
-        if (_i2cMutex)
-        {
-            xSemaphoreGive(_i2cMutex);
-        }
+I2cStatus IMU_MPU9250::_drainJob(void *ctx)
+{
+    IMU_MPU9250 *self = static_cast<IMU_MPU9250 *>(ctx);
+    II2cBackend &bus = self->_bus->jobBackend();
+    const uint32_t now = (uint32_t)micros();
+    const uint32_t gap = now - self->_lastDrainUs;
+    self->_lastDrainUs = now;
+    self->_batchLen = 0;
 
-        if (!ok)
-        {
-            LOGE("IMU_MPU9250", "IMU update failed");
-            continue;
-        }
+    // Nobody drained for a while: what's queued is stale (and the FIFO overflowed long ago)
+    if (gap > kFifoStaleUs)
+    {
+        self->packRaw(now, (uint32_t)((uint64_t)gap * self->_fifo.rateHz() / 1000000u));
+        return self->_fifo.restart(bus);
+    }
 
-        // update current buffer
-        JsonBufWriter &jw = _jw[_buf_index];
-        jw.reset(_buf[_buf_index], sizeof(_buf[_buf_index]));
-        // Create json string
-        jw.beginObject();
-        jw.key("roll");
-        jw.value(_imu.getRoll());
-        jw.key("pitch");
-        jw.value(_imu.getPitch());
-        jw.key("yaw");
-        jw.value(_imu.getYaw());
-        jw.endObject();
-
-        const uint8_t *output;
-        size_t length;
-        if (!jw.finalize(output, length))
-        {
-            LOGE("IMU_MPU9250", "JSON finalization failed");
-            return;
-        }
+    self->recordRead(now);
+    const uint32_t lost = self->_fifo.stats().lost;
+    const I2cStatus st = self->_fifo.drain(bus, self->_batch, MPU9250_FIFO_FRAMES, self->_batchLen);
+    if (self->wantMag() && self->_batchLen)
+        readMag(bus, self->_mag); // on failure the batch fuses with the previous field
+    self->fuseBatch(now);
+    self->packRaw(now, self->_fifo.stats().lost - lost);
+    return st;
+}
+
+void IMU_MPU9250::fuseBatch(uint32_t readUs)
+{
+    if (!_batchLen)
+        return;
+    syncCalibration();
+
+    // A fixed step at the FIFO rate per sample; the field is the drain's one reading
+    const bool haveMag = _mag[0] != 0.0f || _mag[1] != 0.0f || _mag[2] != 0.0f;
+    float mag[3];
+    _cal.applyMag(_mag, mag);
+    BlackboxService &blackbox = BlackboxService::instance();
+    const bool log = blackbox.recording();
+    imuFuseBatch(_cal, _ahrs, _batch, _batchLen, _fuseMag && haveMag ? mag : nullptr, _scaled, _attitude,
+                 log ? _batchAttitude : nullptr);
+    if (log)
+    {
+        // The blackbox gets every FIFO sample, the newest read at readUs, one period apart
+        const uint32_t periodUs = 1000000u / _fifo.rateHz();
+        for (size_t i = 0; i < _batchLen; ++i)
+            blackbox.recordPacked(kImuAttitudeSchema, _batchAttitude[i],
+                                  readUs - (uint32_t)(_batchLen - 1 - i) * periodUs);
+    }
+    if (_calibrator.running())
+        feedCalibrator(_scaled, _batchLen, haveMag ? _mag : nullptr);
+}
+
+void IMU_MPU9250::packRaw(uint32_t readUs, uint32_t lost)
+{
+    const bool on = _rawRequested.load(std::memory_order_relaxed);
+    if (on != _rawOn)
+    {
+        _rawOn = on;
+        _rawWriter.reset(); // a new recording starts at sample 0, whatever was lost before
+        lost = 0;
+        LOGI("IMU_MPU9250", "Raw mode %s", on ? "on" : "off");
+    }
+    if (!_rawOn)
+        return;
 
+    if (lost)
+        _rawWriter.skip(lost);
+    for (size_t i = 0; i < _batchLen; ++i)
+    {
+        if (_rawWriter.add(_batch[i], readUs))
+            sendRawBlock(readUs);
+    }
+}
+
+void IMU_MPU9250::sendRawBlock(uint32_t readUs)
+{
+    // Every sink gets the same block; each one drops rather than waits (the decoder sees the
+    // jump in `index`)
+    const uint8_t *block = _rawWriter.block();
+    const size_t len = _rawWriter.blockLength();
+    BlackboxService::instance().record(block, len, readUs);
+
+    TelemetryLease lease = acquireBuffer();
+    if (lease.valid())
+    {
+        memcpy(lease.data, block, len);
         TelemetrySample sample{
-            .topic_suffix = _topicSuffix,
-            .payload = output,
-            .payload_length = length,
+            .topic_suffix = IMU_RAW_TOPIC,
+            .payload = lease.data,
+            .payload_length = len,
             .meta = TelemetryMeta{
                 .qos = 0,
                 .retain = false,
-                .content_type = TelemetryContentType::JSON,
+                .content_type = TelemetryContentType::BINARY,
                 .full_topic = false,
+                .offline = TelemetryOfflinePolicy::Drop, // a gap in a recording, not worth buffering
             }};
+        sample.stream = _rawStream;
+        sample.t_us = readUs;
+        publishBuffer(lease, sample, 0);
+    }
 
-        // LOGI("IMU_MPU9250", "Publishing telemetry sample, topic %s", _topicSuffix);
-        (void)publish(sample, 0); // Non-blocking, drop if queue is full
+    if (_rawSerial)
+    {
+        uint8_t frame[IMU_RAW_BLOCK_BYTES + IMU_RAW_SERIAL_OVERHEAD];
+        const size_t n = imuRawSerialFrame(block, len, frame, sizeof(frame));
+        if (n && _rawSerial->availableForWrite() >= (int)n)
+            _rawSerial->write(frame, n); // one write: log lines can't land inside the frame
+    }
+}
 
-        // Flip buffer index
-        constexpr size_t kBufCount = sizeof(_buf) / sizeof(_buf[0]);
-        _buf_index = (_buf_index + 1) % kBufCount;
+void IMU_MPU9250::fusePolled()
+{
+    // One step per read, at the read period (it follows the rate controller and the blackbox)
+    const uint32_t periodUs = _readPeriodUs.load(std::memory_order_relaxed);
+    if (periodUs && periodUs != _fusedPeriodUs)
+    {
+        _ahrs.setSampleRate(1000000.0f / periodUs);
+        _fusedPeriodUs = periodUs;
+    }
+    syncCalibration();
+    const float gyro[3] = {_imu.getGyroX() * kRadPerDeg, _imu.getGyroY() * kRadPerDeg, _imu.getGyroZ() * kRadPerDeg};
+    const float accel[3] = {_imu.getAccX() * IMU_STANDARD_GRAVITY, _imu.getAccY() * IMU_STANDARD_GRAVITY,
+                            _imu.getAccZ() * IMU_STANDARD_GRAVITY};
+    ImuSample s;
+    _cal.apply(accel, gyro, s);
+    _mag[0] = _imu.getMagY() * kUtPerMilliGauss; // AK8963 axes -> accel/gyro axes
+    _mag[1] = _imu.getMagX() * kUtPerMilliGauss;
+    _mag[2] = -_imu.getMagZ() * kUtPerMilliGauss;
+    float mag[3];
+    _cal.applyMag(_mag, mag);
+    _ahrs.update(s.gyro, s.accel, _fuseMag ? mag : nullptr);
+    if (_calibrator.running())
+        feedCalibrator(&s, 1, _mag);
+    _ahrs.toEuler(_attitude[0], _attitude[1], _attitude[2]);
+}
+
+void IMU_MPU9250::syncCalibration()
+{
+    if (!_calPending.load(std::memory_order_acquire))
+        return;
+    ImuCalibrationData next{};
+    portENTER_CRITICAL(&_calMux);
+    const bool apply = _calNextValid;
+    if (apply)
+        next = _calNext;
+    const ImuCalKind kind = _calStartKind;
+    const uint32_t samples = _calStartSamples;
+    _calNextValid = false;
+    _calStartKind = ImuCalKind::None;
+    _calPending.store(false, std::memory_order_relaxed);
+    portEXIT_CRITICAL(&_calMux);
+
+    if (apply)
+        _cal.set(next);
+    if (kind != ImuCalKind::None)
+        _calibrator.start(kind, samples);
+}
+
+void IMU_MPU9250::feedCalibrator(const ImuSample *samples, size_t n, const float *rawMag)
+{
+    for (size_t i = 0; i < n && _calibrator.running(); ++i)
+        _calibrator.add(samples[i], rawMag);
+    if (_calibrator.running())
+        return;
+
+    // Finished: use the result from the next sample on, tell the ground either way
+    ImuCalibrationData d = _cal.data();
+    if (_calibrator.result(d))
+    {
+        _cal.set(d);
+        portENTER_CRITICAL(&_calMux);
+        _calShared = d;
+        portEXIT_CRITICAL(&_calMux);
     }
-}
\ No newline at end of file
+    const ImuCalKind kind = _calibrator.kind();
+    const char *status = ImuCalibrator::statusName(_calibrator.status());
+    const float spread = _calibrator.spread();
+    const float *v = kind == ImuCalKind::Gyro ? d.gyro_zerorate : kind == ImuCalKind::Accel ? d.accel_zerog : d.mag_hardiron;
+    if (kind == ImuCalKind::Mag)
+        publishCal("{\"event\":\"mag\",\"status\":\"%s\",\"spread\":%.4g,\"hard\":[%.4g,%.4g,%.4g],"
+                   "\"soft\":[%.4g,%.4g,%.4g],\"field\":%.4g}",
+                   status, spread, v[0], v[1], v[2], d.mag_softiron[0], d.mag_softiron[4], d.mag_softiron[8],
+                   d.mag_field);
+    else
+        publishCal("{\"event\":\"%s\",\"status\":\"%s\",\"spread\":%.4g,\"offset\":[%.4g,%.4g,%.4g]}",
+                   ImuCalibrator::kindName(kind), status, spread, v[0], v[1], v[2]);
+    _calibrator.cancel();
+    _calibrating.store(false, std::memory_order_relaxed);
+    LOGI("IMU_MPU9250", "Calibration %s: %s", ImuCalibrator::kindName(kind), status);
+}
+
+ImuCalibrationData IMU_MPU9250::calibration() const
+{
+    portENTER_CRITICAL(&_calMux);
+    const ImuCalibrationData d = _calShared;
+    portEXIT_CRITICAL(&_calMux);
+    return d;
+}
+
+void IMU_MPU9250::setCalibration(const ImuCalibrationData &cal)
+{
+    portENTER_CRITICAL(&_calMux);
+    _calShared = cal;
+    _calNext = cal;
+    _calNextValid = true;
+    _calPending.store(true, std::memory_order_release);
+    portEXIT_CRITICAL(&_calMux);
+}
+
+bool IMU_MPU9250::startCalibration(ImuCalKind kind, float seconds)
+{
+    if (kind == ImuCalKind::None || seconds <= 0.0f)
+        return false;
+    bool idle = false;
+    if (!_calibrating.compare_exchange_strong(idle, true))
+        return false;
+
+    // Counted in fused samples: one per FIFO frame, or one per read at the full rate
+    const uint32_t hz = _fifoHz ? _fifo.rateHz() : _fullRateHz;
+    uint32_t samples = (uint32_t)(seconds * hz);
+    samples = samples ? samples : 1;
+    portENTER_CRITICAL(&_calMux);
+    _calStartKind = kind;
+    _calStartSamples = samples;
+    _calPending.store(true, std::memory_order_release);
+    portEXIT_CRITICAL(&_calMux);
+
+    publishCal("{\"event\":\"start\",\"kind\":\"%s\",\"samples\":%u}", ImuCalibrator::kindName(kind),
+               (unsigned)samples);
+    return true;
+}
+
+bool IMU_MPU9250::loadCalibration()
+{
+    const uint32_t t0 = (uint32_t)micros();
+    if (!_calStoreReady)
+        _calStoreReady = _calStore.begin();
+    if (!_calStoreReady || !_calStore.loadCalibration()) // CRC checked
+        return false;
+
+    ImuCalibrationData d;
+    memcpy(d.accel_zerog, _calStore.accel_zerog, sizeof(d.accel_zerog));
+    memcpy(d.gyro_zerorate, _calStore.gyro_zerorate, sizeof(d.gyro_zerorate));
+    memcpy(d.mag_hardiron, _calStore.mag_hardiron, sizeof(d.mag_hardiron));
+    memcpy(d.mag_softiron, _calStore.mag_softiron, sizeof(d.mag_softiron));
+    d.mag_field = _calStore.mag_field;
+    setCalibration(d);
+    LOGI("IMU_MPU9250", "Calibration loaded from NVS in %u us", (unsigned)((uint32_t)micros() - t0));
+    return true;
+}
+
+bool IMU_MPU9250::saveCalibration()
+{
+    if (!_calStoreReady)
+        _calStoreReady = _calStore.begin();
+    if (!_calStoreReady)
+        return false;
+
+    const ImuCalibrationData d = calibration();
+    memcpy(_calStore.accel_zerog, d.accel_zerog, sizeof(d.accel_zerog));
+    memcpy(_calStore.gyro_zerorate, d.gyro_zerorate, sizeof(d.gyro_zerorate));
+    memcpy(_calStore.mag_hardiron, d.mag_hardiron, sizeof(d.mag_hardiron));
+    memcpy(_calStore.mag_softiron, d.mag_softiron, sizeof(d.mag_softiron));
+    _calStore.mag_field = d.mag_field;
+    return _calStore.saveCalibration();
+}
+
+void IMU_MPU9250::attachMqtt(MqttService::MqttService &mqtt)
+{
+    mqtt.subscribeRel(
+        IMU_CAL_CMD_TOPIC, MqttService::QoS::AtLeastOnce,
+        [this](const MqttService::Message &msg)
+        {
+            char cmd[32];
+            const size_t n = msg.len < sizeof(cmd) - 1 ? msg.len : sizeof(cmd) - 1;
+            memcpy(cmd, msg.payload, n);
+            cmd[n] = '\0';
+            runCalCommand(cmd);
+        },
+        MqttService::Delivery::Queued);
+    mqtt.subscribeRel(
+        IMU_RAW_CMD_TOPIC, MqttService::QoS::AtLeastOnce,
+        [this](const MqttService::Message &msg)
+        {
+            const bool on = msg.len == 2 && memcmp(msg.payload, "on", 2) == 0;
+            if (!on && !(msg.len == 3 && memcmp(msg.payload, "off", 3) == 0))
+                return;
+            setRawStream(on && _fifoHz);
+        },
+        MqttService::Delivery::Latest);
+}
+
+void IMU_MPU9250::runCalCommand(const char *cmd)
+{
+    const char *arg = strchr(cmd, ' ');
+    const size_t verbLen = arg ? (size_t)(arg - cmd) : strlen(cmd);
+    while (arg && *arg == ' ')
+        arg++;
+    auto is = [&](const char *verb)
+    { return strlen(verb) == verbLen && strncmp(cmd, verb, verbLen) == 0; };
+    auto seconds = [&](float fallback)
+    { return arg && *arg ? (float)atof(arg) : fallback; };
+
+    const ImuCalKind kind = is("gyro") ? ImuCalKind::Gyro : is("accel") ? ImuCalKind::Accel : is("mag") ? ImuCalKind::Mag
+                                                                                                      : ImuCalKind::None;
+    if (kind != ImuCalKind::None)
+    {
+        if (!startCalibration(kind, seconds(kind == ImuCalKind::Mag ? IMU_CAL_MAG_S : IMU_CAL_REST_S)))
+            publishCal("{\"event\":\"start\",\"kind\":\"%s\",\"error\":\"busy\"}", ImuCalibrator::kindName(kind));
+    }
+    else if (is("save"))
+    {
+        publishCal("{\"event\":\"save\",\"ok\":%s}", saveCalibration() ? "true" : "false");
+    }
+    else if (is("load"))
+    {
+        publishCal("{\"event\":\"load\",\"ok\":%s}", loadCalibration() ? "true" : "false");
+    }
+    else if (is("reset"))
+    {
+        setCalibration(ImuCalibrationData::identity()); // what's stored stays until the next save
+        publishCal("{\"event\":\"reset\",\"ok\":true}");
+    }
+    else if (is("show"))
+    {
+        publishCalibration();
+    }
+    else
+    {
+        LOGW("IMU_MPU9250", "Unknown calibration command: %s", cmd);
+    }
+}
+
+void IMU_MPU9250::publishCalibration()
+{
+    // Two messages: the whole record doesn't fit one pool buffer
+    const ImuCalibrationData d = calibration();
+    publishCal("{\"event\":\"show\",\"gyro\":[%.4g,%.4g,%.4g],\"accel\":[%.4g,%.4g,%.4g]}", d.gyro_zerorate[0],
+               d.gyro_zerorate[1], d.gyro_zerorate[2], d.accel_zerog[0], d.accel_zerog[1], d.accel_zerog[2]);
+    const float *s = d.mag_softiron;
+    publishCal("{\"event\":\"show\",\"hard\":[%.4g,%.4g,%.4g],\"soft\":[%.4g,%.4g,%.4g,%.4g,%.4g,%.4g,%.4g,%.4g,"
+               "%.4g],\"field\":%.4g}",
+               d.mag_hardiron[0], d.mag_hardiron[1], d.mag_hardiron[2], s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7],
+               s[8], d.mag_field);
+}
+
+void IMU_MPU9250::publishCal(const char *fmt, ...)
+{
+    // Bus task (results) or dispatch task (replies): a pooled buffer, never blocks
+    TelemetryLease lease = acquireBuffer(TelemetryClass::Critical);
+    if (!lease.valid())
+        return;
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(reinterpret_cast<char *>(lease.data), lease.capacity, fmt, args);
+    va_end(args);
+    if (n <= 0 || (size_t)n >= lease.capacity)
+    {
+        releaseBuffer(lease);
+        return;
+    }
+    TelemetrySample sample{
+        .topic_suffix = IMU_CAL_TOPIC,
+        .payload = lease.data,
+        .payload_length = (size_t)n,
+        .meta = TelemetryMeta{
+            .qos = 1,
+            .retain = false,
+            .content_type = TelemetryContentType::JSON,
+            .full_topic = false,
+            .offline = TelemetryOfflinePolicy::Fifo, // replies to commands, every one counts
+            // Not Control: it is latest-only per stream, so "show"'s second message would replace its first
+            .traffic_class = TelemetryClass::Critical,
+        }};
+    sample.stream = _calStream;
+    publishBuffer(lease, sample, 0);
+}
+
+void IMU_MPU9250::_onUpdated(const I2cTransaction &t)
+{
+    IMU_MPU9250 *self = static_cast<IMU_MPU9250 *>(t.ctx);
+    if (t.status == I2cStatus::Ok)
+        self->publishAttitude();
+    if (self->_statsStream != TELEMETRY_STREAM_NONE && (int32_t)(t.end_us - self->_nextStatsUs) >= 0)
+    {
+        self->publishStats(t.end_us);
+        self->_nextStatsUs = t.end_us + IMU_STATS_MS * 1000u;
+    }
+    self->_inFlight.store(false, std::memory_order_release);
+}
+
+void IMU_MPU9250::sample()
+{
+    updatePacing(); // the rate controller or the blackbox may have changed sampleRateHz()
+    if (!_bus)
+    {
+        recordRead((uint32_t)micros());
+        _updated = _imu.update();
+        if (_updated)
+            fusePolled();
+        publishAttitude();
+        return;
+    }
+
+    // One read in flight at most: if the bus is still behind, skip rather than pile up
+    bool idle = false;
+    if (!_inFlight.compare_exchange_strong(idle, true, std::memory_order_acq_rel))
+    {
+        _busBusy.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    I2cTransaction t = I2cTransaction::exclusive(kMpuAddr, _fifo.configured() ? &_drainJob : &_updateJob, this);
+    t.done = &_onUpdated; // encodes and publishes on the bus task
+    if (_bus->submit(t) != I2cStatus::Ok)
+    {
+        _busBusy.fetch_add(1, std::memory_order_relaxed);
+        _inFlight.store(false, std::memory_order_release);
+    }
+}
+
+void IMU_MPU9250::publishAttitude()
+{
+    if (_fifo.configured())
+    {
+        if (!_batchLen)
+            return; // drained faster than the FIFO fills, or just restarted: nothing new
+    }
+    else if (!_updated)
+    {
+        LOGE("IMU_MPU9250", "IMU update failed");
+        return;
+    }
+
+    // Polled, every read goes to the blackbox (FIFO batches are logged per sample in
+    // fuseBatch()); MQTT gets rateHz out of sampleRateHz()
+    const float *attitude = _attitude;
+    const uint32_t captureUs = (uint32_t)micros();
+    if (!_fifo.configured())
+        BlackboxService::instance().recordPacked(kImuAttitudeSchema, attitude, captureUs);
+    const uint32_t sampleHz = sampleRateHz();
+    const uint32_t publishHz = _rateHz.load();
+    if (publishHz == 0)
+        return; // idle: nobody leased the stream, only the blackbox wants samples
+    _publishAcc += publishHz;
+    if (_publishAcc < sampleHz)
+        return;
+    _publishAcc -= sampleHz;
+    if (_publishAcc >= sampleHz)
+        _publishAcc = 0; // rate changed meanwhile
+
+    // Encode straight into a pooled buffer; it stays ours until TelemetryTx has sent it
+    TelemetryLease lease = acquireBuffer();
+    if (!lease.valid())
+    {
+        return; // TX is behind and every buffer is queued: skip this sample (counted by the pool)
+    }
+
+    const uint8_t *output;
+    size_t length;
+    TelemetryContentType contentType;
+    if (!imuEncodeAttitude(_encoding, attitude, &_delta, lease.data, lease.capacity, output, length, contentType))
+    {
+        LOGE("IMU_MPU9250", "Encoding failed");
+        releaseBuffer(lease);
+        return;
+    }
+
+    TelemetrySample sample{
+        .topic_suffix = _topicSuffix,
+        .payload = output,
+        .payload_length = length,
+        .meta = TelemetryMeta{
+            .qos = 0,
+            .retain = false,
+            .content_type = contentType,
+            .full_topic = false,
+            .offline = imuAttitudeOfflinePolicy(contentType), // latest wins, but DELTA needs every payload
+        }};
+    sample.stream = _streamId;
+    sample.t_us = captureUs; // age is measured from the read, not from the enqueue
+
+    // LOGI("IMU_MPU9250", "Publishing telemetry sample, topic %s", _topicSuffix);
+    if (!publishBuffer(lease, sample, 0)) // Non-blocking, drop (and release) if queue is full
+        _delta.forceKeyframe();           // DELTA: the receiver can't apply the next delta without it
+}
+
+void IMU_MPU9250::publishStats(uint32_t nowUs)
+{
+    TelemetryLease lease = acquireBuffer();
+    if (lease.valid())
+    {
+        char *out = reinterpret_cast<char *>(lease.data);
+        const Mpu9250DataReady::Stats &rt = _timing.stats();
+        int n = snprintf(out, lease.capacity,
+                         "{\"pacing\":\"%s\",\"reads\":%u,\"lat_avg_us\":%u,\"lat_max_us\":%u,"
+                         "\"jit_avg_us\":%u,\"jit_max_us\":%u,\"gaps\":%u",
+                         _drdyPin >= 0 ? "drdy" : "timer", (unsigned)rt.reads,
+                         (unsigned)(rt.triggered ? rt.latency_sum_us / rt.triggered : 0), (unsigned)rt.latency_max_us,
+                         (unsigned)(rt.intervals ? rt.jitter_sum_us / rt.intervals : 0), (unsigned)rt.jitter_max_us,
+                         (unsigned)rt.gaps);
+        if (n > 0 && (size_t)n < lease.capacity && _fifo.configured())
+        {
+            const Mpu9250Fifo::Stats &st = _fifo.stats();
+            n += snprintf(out + n, lease.capacity - n,
+                          ",\"rate_hz\":%u,\"effective_hz\":%u,\"samples\":%u,\"drains\":%u,\"max_batch\":%u,"
+                          "\"overflows\":%u,\"lost\":%u,\"restarts\":%u,\"errors\":%u",
+                          (unsigned)_fifo.rateHz(), (unsigned)_fifo.effectiveHz(nowUs), (unsigned)st.samples,
+                          (unsigned)st.drains, (unsigned)st.max_batch, (unsigned)st.overflows, (unsigned)st.lost,
+                          (unsigned)st.restarts, (unsigned)st.errors);
+        }
+        if (n > 0 && (size_t)n + 1 < lease.capacity)
+        {
+            out[n++] = '}';
+            TelemetrySample sample{
+                .topic_suffix = IMU_STATS_TOPIC,
+                .payload = lease.data,
+                .payload_length = (size_t)n,
+                .meta = TelemetryMeta{
+                    .qos = 0,
+                    .retain = false,
+                    .content_type = TelemetryContentType::JSON,
+                    .full_topic = false,
+                    .offline = TelemetryOfflinePolicy::Drop,
+                }};
+            sample.stream = _statsStream;
+            publishBuffer(lease, sample, 0);
+        }
+        else
+        {
+            releaseBuffer(lease);
+        }
+    }
+    // New windows for the effective rate and the timing, published or not
+    _fifo.resetStats(nowUs);
+    _timing.resetStats(nowUs);
+}
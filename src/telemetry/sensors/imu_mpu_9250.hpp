@@ -5,30 +5,96 @@
  *
  * This class provides telemetry data from an MPU9250 IMU sensor, including
  * roll, pitch, and yaw measurements. The sensor data is continuously sampled
- * in a dedicated FreeRTOS task and published as JSON telemetry.
+ * by TelemetryService's sampling scheduler (see sample()) and published as telemetry.
  *
  * @warning The MPU9250 sensor requires continuous updates to maintain proper
  * sensor fusion and filtering. Update rates below 10Hz may result in stale
  * or incorrect readings. Recommended minimum rate is 25-40Hz for reliable
- * operation. I2C mutex blocking can also interfere with sensor fusion timing.
+ * operation.
  *
  * Key features:
- * - Thread-safe I2C communication with mutex support
- * - Double-buffered JSON encoding to prevent blocking
+ * - Reads run as exclusive jobs on the I2cBus task; sample() only queues them and the
+ *   sample is encoded and published from the completion callback
+ * - JSON, CBOR, packed binary or quantized delta (see `encoding`), encoded into
+ *   TelemetryService's buffer pool (no overwrite while queued)
  * - Configurable sampling rate (default 200Hz)
+ * - Attitude from our own AhrsFilter (Mahony or Madgwick, setFusion()), fed with the calibrated
+ *   accel, gyro and magnetometer readings; the library's built-in fusion is switched off.
+ *   Fusion and encoding are imu_attitude.hpp, which ImuReplay runs on recorded samples
+ * - FIFO mode (setFifoRate()): the MPU9250 samples accel + gyro at up to 1 kHz into its
+ *   FIFO, each sample() drains it in burst reads (plus one magnetometer read) and fuses the
+ *   whole batch at a fixed step, so no sensor sample is lost between ticks
+ * - Data-ready interrupt (setDataReadyPin()): the MPU9250's INT pin triggers sample() on
+ *   the sampling task instead of a timer, so reads follow new data by microseconds
+ * - Calibration (gyro bias, accel zero-g, mag hard/soft iron) applied to every sample before
+ *   fusion, measured on command (attachMqtt(), IMU_CAL_CMD_TOPIC) and kept in NVS as an
+ *   Adafruit_Sensor_Calibration record, loaded in begin(): no recalibration on boot
+ * - Raw mode (setRawStream()): the FIFO's int16 accel + gyro frames in binary blocks on
+ *   IMU_RAW_TOPIC, into the blackbox and optionally on a serial port, for offline analysis
+ * - Read timing (interrupt-to-read latency, interval jitter) and FIFO stats on IMU_STATS_TOPIC
+ * - While the blackbox records, samples at the configured rate into the log and
+ *   publishes a decimated stream at the rate the controller allows
  * - Non-blocking telemetry publishing
  *
  * JSON output format:
  * @code{.json}
  * {"roll": 0.123, "pitch": -0.456, "yaw": 180.789}
  * @endcode
+ * CBOR carries the same map with float32 values. BINARY uses packed schema 1:
+ * u8 id = 1, then roll, pitch, yaw as int16 centidegrees (little endian), 7 bytes.
+ * DELTA quantizes the same schema to 0.01 deg and sends zigzag varint differences to the
+ * previous sample, with a keyframe every IMU_DELTA_KEYFRAME_INTERVAL samples (see
+ * delta_codec.hpp): 5 bytes at rest, 2-3 bytes more per fast-moving axis.
  */
 
 #include "../itelemetry_provider.hpp"
-#include <json_buffer_writer.hpp>
+#include "../imu_attitude.hpp"
+#include "../imu_raw_block.hpp"
+#include "services/i2c_bus.hpp"
+#include "services/blackbox_service.hpp"
+#include "drivers/imu/mpu9250_fifo.hpp"
+#include "drivers/imu/mpu9250_data_ready.hpp"
+#include "drivers/imu/ahrs_filter.hpp"
+#include "drivers/imu/imu_calibration.hpp"
+#include "services/mqtt_service.hpp"
 
+#include <atomic>
 #include <Arduino.h>
 #include <MPU9250.h>
+#include <Adafruit_Sensor_Calibration.h>
+
+// ===== Tunables ===============================================================
+#ifndef IMU_STATS_MS
+#define IMU_STATS_MS 5000 // read timing / FIFO stats period on IMU_STATS_TOPIC, 0 = don't publish
+#endif
+
+#ifndef IMU_STATS_TOPIC
+#define IMU_STATS_TOPIC "telemetry/imu_stats"
+#endif
+
+#ifndef IMU_RAW_TOPIC
+#define IMU_RAW_TOPIC "telemetry/imu_raw" // raw mode blocks (imu_raw_block.hpp)
+#endif
+
+#ifndef IMU_RAW_CMD_TOPIC
+#define IMU_RAW_CMD_TOPIC "imu/raw" // "on" / "off"
+#endif
+
+#ifndef IMU_CAL_CMD_TOPIC
+#define IMU_CAL_CMD_TOPIC "imu/cal" // gyro|accel|mag [seconds], save, load, reset, show
+#endif
+
+#ifndef IMU_CAL_TOPIC
+#define IMU_CAL_TOPIC "telemetry/imu_cal" // calibration results and replies
+#endif
+
+#ifndef IMU_CAL_REST_S
+#define IMU_CAL_REST_S 3 // gyro / accel routines: seconds held still
+#endif
+
+#ifndef IMU_CAL_MAG_S
+#define IMU_CAL_MAG_S 30 // mag routine: seconds of turning the board through every orientation
+#endif
 
 class IMU_MPU9250 final : public ITelemetryProvider
 {
@@ -36,16 +102,18 @@ public:
     /**
      * @brief Construct a new IMU_MPU9250 telemetry provider
      *
-     * @param i2cMutex Optional I2C mutex for thread-safe communication (can be nullptr)
+     * @param bus I2C bus manager (nullptr: access Wire directly, only safe as the sole I2C user)
      * @param rateHz Sampling rate in Hz (default: 200Hz, minimum recommended: 25Hz)
      * @param topicSuffix MQTT topic suffix for telemetry publishing
+     * @param encoding Payload format (JSON, CBOR, BINARY or DELTA)
      *
      * @warning Using rates below 25Hz may cause sensor fusion issues and stale readings
      */
-    explicit IMU_MPU9250(SemaphoreHandle_t i2cMutex = nullptr,
+    explicit IMU_MPU9250(I2cBus *bus = nullptr,
                          uint32_t rateHz = 200,
-                         const char *topicSuffix = "telemetry/imu")
-        : _i2cMutex(i2cMutex), _rateHz(rateHz), _topicSuffix(topicSuffix) {}
+                         const char *topicSuffix = "telemetry/imu",
+                         TelemetryContentType encoding = TelemetryContentType::JSON)
+        : _bus(bus), _rateHz(rateHz), _fullRateHz(rateHz), _topicSuffix(topicSuffix), _encoding(encoding) {}
 
     /**
      * @brief Get the provider name
@@ -55,15 +123,24 @@ public:
 
     /**
      * @brief Get the current sampling rate
-     * @return Sampling rate in Hz
+     * @return Sampling rate in Hz; the configured full rate while the blackbox records, a
+     * calibration runs, raw mode is on or (FIFO mode) whenever it publishes at all, 0 while
+     * idle (no stream lease)
      */
-    uint32_t sampleRateHz() const override { return _rateHz; }
+    uint32_t sampleRateHz() const override
+    {
+        if (BlackboxService::instance().recording() || _calibrating.load(std::memory_order_relaxed) ||
+            (_fifoHz && _rawRequested.load(std::memory_order_relaxed)))
+            return _fullRateHz;
+        const uint32_t hz = _rateHz.load();
+        return hz && _fifoHz ? _fullRateHz : hz; // the FIFO is drained at full rate, publishing decimates
+    }
 
     /**
-     * @brief Initialize the IMU sensor and start sampling task
+     * @brief Initialize the IMU sensor
      *
-     * Performs sensor initialization, creates the sampling task, and begins
-     * continuous telemetry generation.
+     * Performs sensor initialization and registers the telemetry stream; sampling
+     * starts once TelemetryService schedules the provider.
      *
      * @return true if initialization successful, false otherwise
      * @warning Ensure I2C bus is properly initialized before calling this method
@@ -71,58 +148,243 @@ public:
     bool begin() override;
 
     /**
-     * @brief Set the I2C mutex for thread-safe communication
+     * @brief Set the I2C bus manager
+     *
+     * @param bus Started I2cBus, or nullptr to access Wire directly
+     * @warning Set before begin(); not synchronized with sampling
+     */
+    void setI2cBus(I2cBus *bus) { _bus = bus; }
+
+    /**
+     * @brief Sample accel + gyro into the MPU9250's FIFO at @p hz (up to 1000; 1 kHz / n)
+     * instead of polling the library once per sample().
+     *
+     * Each sample() then drains the FIFO in burst reads and fuses every sample in it, so
+     * the fusion runs at @p hz while publishing keeps its own rate. The FIFO holds 42
+     * samples: sampleRateHz() must stay above hz / 42 or samples are lost (counted as
+     * overflows). The magnetometer (100 Hz) is read once per drain and held for the batch.
+     *
+     * @param hz 0 = poll the library's update() (default)
+     * @warning Set before begin(); needs the I2cBus.
+     */
+    void setFifoRate(uint32_t hz) { _fifoHz = hz; }
+
+    /**
+     * @brief Pace sample() by the MPU9250's data-ready interrupt on @p gpio instead of a timer.
+     *
+     * The sensor pulses INT on every new sample (polled: at the configured rate; FIFO mode:
+     * at the FIFO rate, and every n-th pulse triggers a drain). The ISR wakes the sampling
+     * task, which queues the read at once. If the interrupts stop, the scheduler still
+     * samples every two periods (counted as `timeout` in the scheduler stats).
+     *
+     * @param gpio -1 = timer paced (default)
+     * @warning Set before begin(); needs the I2cBus.
+     */
+    void setDataReadyPin(int gpio) { _drdyPin = gpio; }
+
+    /**
+     * @brief Raw mode: also send every FIFO frame (int16 accel + gyro counts) in blocks of
+     * IMU_RAW_BLOCK_SAMPLES (see imu_raw_block.hpp) on IMU_RAW_TOPIC, into the blackbox while
+     * it records and, with setRawSerial(), on a serial port. Any task, any time; also the
+     * "on" / "off" commands on IMU_RAW_CMD_TOPIC.
+     *
+     * While on, the FIFO is drained at the full rate whether the attitude stream is leased or
+     * not. Needs FIFO mode (setFifoRate()), ignored otherwise.
+     */
+    void setRawStream(bool enable) { _rawRequested.store(enable, std::memory_order_relaxed); }
+    bool rawStream() const { return _rawRequested.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Also write raw blocks to @p port, framed with sync bytes and a CRC (see
+     * imuRawSerialFrame()). Never waits: a frame that doesn't fit the port's free TX buffer is
+     * dropped, so the port needs a TX buffer of a frame or more and the baud for the rate
+     * (921600 for 1 kHz, see docs).
+     * @warning Set before begin().
+     */
+    void setRawSerial(Stream *port) { _rawSerial = port; }
+
+    /**
+     * @brief Choose the attitude filter (default Mahony, with the magnetometer).
+     * @param useMag false = accel + gyro only, yaw integrated from the gyro
+     * @warning Set before begin().
+     */
+    void setFusion(AhrsAlgorithm algorithm, bool useMag = true)
+    {
+        _ahrs.setAlgorithm(algorithm);
+        _fuseMag = useMag;
+    }
+
+    /**
+     * @brief Accept calibration commands on IMU_CAL_CMD_TOPIC (results and replies go out
+     * on IMU_CAL_TOPIC) and raw mode on / off on IMU_RAW_CMD_TOPIC. Call after begin() and
+     * mqtt.begin().
+     *
+     * Commands run on the MQTT dispatch task (a save writes flash for a few ms there, the
+     * bus is not held up). `gyro` and `accel` want the board still (accel: level, z up),
+     * `mag` wants it turned through every orientation; each replaces its part of the
+     * calibration in use when it succeeds, `save` makes that survive a reboot.
+     */
+    void attachMqtt(MqttService::MqttService &mqtt);
+
+    /// Calibration in use (any task).
+    ImuCalibrationData calibration() const;
+
+    /// Use @p cal from the next sample on (any task); not persisted, see saveCalibration().
+    void setCalibration(const ImuCalibrationData &cal);
+
+    /**
+     * @brief Run a calibration routine over @p seconds of fused samples (any task).
      *
-     * @param i2cMutex Mutex handle, or nullptr to disable mutex protection
-     * @warning Changing mutex during operation may cause race conditions
+     * Samples at the full rate meanwhile, stream leased or not. The result is published on
+     * IMU_CAL_TOPIC and, if the routine succeeded, used from then on.
+     * @return false if one is already running
+     */
+    bool startCalibration(ImuCalKind kind, float seconds);
+
+    /**
+     * @brief Persist the calibration in use in NVS (Adafruit_Sensor_Calibration's EEPROM
+     * record, CRC-16). The soft iron matrix is stored symmetric.
+     * @warning Writes flash: not from the bus task, and not in flight.
+     */
+    bool saveCalibration();
+
+    /// Use the calibration stored in NVS; false (nothing changed) if none or its CRC fails.
+    bool loadCalibration();
+
+    /// Attitude of the newest fused sample (written by the bus task).
+    AhrsQuaternion attitudeQuaternion() const { return _ahrs.quaternion(); }
+
+    /// Paced by the data-ready interrupt (after a successful begin()).
+    bool triggered() const override { return _drdyPin >= 0; }
+
+    /**
+     * @brief FIFO counters of the current stats window (reset every IMU_STATS_MS
+     * after publishing). Written by the bus task.
      */
-    void setI2CMutex(SemaphoreHandle_t i2cMutex) { _i2cMutex = i2cMutex; }
+    Mpu9250Fifo::Stats fifoStats() const { return _fifo.stats(); }
+
+    /// Interrupt-to-read latency and read interval jitter of the current stats window (bus task).
+    Mpu9250DataReady::Stats readTiming() const { return _timing.stats(); }
+
+    /// Sensor samples per second the FIFO really delivered in the current stats window.
+    uint32_t fifoEffectiveHz() const { return _fifo.effectiveHz((uint32_t)micros()); }
+
+    /// Samples skipped because the previous read was still queued or running on the bus.
+    uint32_t busBusySkips() const { return _busBusy.load(std::memory_order_relaxed); }
 
     /**
      * @brief Handle sampling rate change requests
      *
-     * @param newRateHz New sampling rate in Hz (minimum 1Hz)
+     * While the blackbox records, this only sets the MQTT rate; sampling stays at full rate.
+     *
+     * @param newRateHz New sampling rate in Hz; 0 = idle, nothing is published (and nothing
+     * sampled unless the blackbox records)
      * @warning Rates below 25Hz may cause sensor fusion issues. The MPU9250
      * requires regular updates to maintain accurate orientation calculations.
      */
     void onSamplingRateChange(uint32_t newRateHz) override
     {
-        _rateHz = (newRateHz == 0 ? 1 : newRateHz);
+        _rateHz = newRateHz;
+        updatePacing();
     }
 
-private:
-    // Tasking / synchronization
-    /**
-     * @brief Static task entry point for FreeRTOS
-     * @param arg Pointer to IMU_MPU9250 instance
-     */
-    static void _taskThunk(void *arg);
+    /// Sampled by TelemetryService's scheduler, no task of its own.
+    bool scheduled() const override { return true; }
 
     /**
-     * @brief Main sampling loop running in dedicated task
+     * @brief Queue a sensor read; the sample is encoded and published when it completes
      *
-     * Continuously samples the IMU sensor, generates JSON telemetry,
-     * and publishes data at the configured rate.
+     * Called from TelemetryService's sampling task at sampleRateHz(). Never waits for the bus.
      */
-    void _runLoop();
+    void sample() override;
+
+private:
+    static I2cStatus _setupJob(void *ctx);
+    static I2cStatus _updateJob(void *ctx);
+    static I2cStatus _drainJob(void *ctx);
+    static void _onUpdated(const I2cTransaction &t);
+    static void _drdyIsr(void *arg);
+    void updatePacing();
+    void recordRead(uint32_t readUs);
+    void fusePolled();
+    void fuseBatch(uint32_t readUs);
+    void syncCalibration();
+    void feedCalibrator(const ImuSample *samples, size_t n, const float *rawMag);
+    bool wantMag() const { return _fuseMag || _calibrator.kind() == ImuCalKind::Mag; }
+    void runCalCommand(const char *cmd);
+    void publishCalibration();
+    void publishCal(const char *fmt, ...);
+    void publishAttitude();
+    void packRaw(uint32_t readUs, uint32_t lost);
+    void sendRawBlock(uint32_t readUs);
+    void publishStats(uint32_t nowUs);
 
-    TaskHandle_t _taskHandle;    ///< FreeRTOS task handle
-    SemaphoreHandle_t _i2cMutex; ///< I2C bus protection mutex
+    I2cBus *_bus; ///< Owns Wire; reads are queued as exclusive jobs
+    std::atomic<bool> _inFlight{false}; ///< Read queued or running
+    std::atomic<uint32_t> _busBusy{0};
+    bool _updated{false}; ///< Result of the last _imu.update() (bus task)
 
     // Config
-    uint32_t _rateHz;         ///< Sampling rate in Hz
+    std::atomic<uint32_t> _rateHz; ///< Sampling/publish rate in Hz, 0 = idle (set by TelemetryService, read by the scheduler)
+    const uint32_t _fullRateHz;    ///< Configured rate, kept while the blackbox records
+    uint32_t _publishAcc{0};       ///< Decimation accumulator (bus task)
     const char *_topicSuffix; ///< MQTT topic suffix
+    TelemetryStreamId _streamId{TELEMETRY_STREAM_NONE};
+    TelemetryContentType _encoding; ///< Payload format
+    DeltaEncoder _delta{nullptr};   ///< DELTA state: last sent sample (bus task), set up in begin()
 
     // Sensor
-    MPU9250 _imu; ///< MPU9250 sensor instance
+    MPU9250 _imu; ///< MPU9250 sensor instance, raw readings only (its fusion is off)
+
+    // Fusion (bus task after begin(); the sampling task without a bus)
+    AhrsFilter _ahrs;
+    bool _fuseMag{true};
+    float _mag[3]{};            ///< Newest magnetometer reading in uT, accel/gyro axes, zero = none yet
+    uint32_t _fusedPeriodUs{0}; ///< Polled: step the filter is set up for
+    float _attitude[3]{};       ///< roll, pitch, yaw of the newest fused sample
+
+    // FIFO mode (bus task only, after begin())
+    uint32_t _fifoHz{0}; ///< Requested FIFO rate, 0 = polled
+    Mpu9250Fifo _fifo;
+    ImuRawSample _batch[MPU9250_FIFO_FRAMES]{};
+    ImuSample _scaled[MPU9250_FIFO_FRAMES]{}; ///< _batch corrected, in SI units
+    float _batchAttitude[MPU9250_FIFO_FRAMES][3]{}; ///< Attitude after each sample, while the blackbox records
+    size_t _batchLen{0};
+    uint32_t _lastDrainUs{0};
+
+    // Raw mode (blocks built on the bus task)
+    std::atomic<bool> _rawRequested{false};
+    bool _rawOn{false}; ///< What the bus task last acted on
+    ImuRawBlockWriter _rawWriter;
+    Stream *_rawSerial{nullptr};
+    TelemetryStreamId _rawStream{TELEMETRY_STREAM_NONE};
+
+    // Data-ready pacing: the ISR triggers every _drdyDivider-th pulse
+    int _drdyPin{-1};
+    uint32_t _sensorHz{0};                  ///< INT pulse rate, set in begin()
+    std::atomic<uint32_t> _drdyDivider{1};  ///< Sampling task writes, ISR reads
+    uint32_t _drdyPhase{0};                 ///< ISR only
+    std::atomic<uint32_t> _drdyIsrUs{0};    ///< Last triggering pulse
+    uint32_t _lastIsrUs{0};                 ///< ... already accounted (bus task)
+    std::atomic<uint32_t> _readPeriodUs{0}; ///< Expected read interval
 
-    // Double Buffering
-    uint8_t _buf[2][256];    ///< Double buffer for JSON data
-    size_t _len[2] = {0, 0}; ///< Buffer lengths
-    uint8_t _buf_index = 0;  ///< Current buffer index
+    // Calibration: applied and measured on the bus task; commands hand over under _calMux
+    ImuCalibration _cal;
+    ImuCalibrator _calibrator;
+    Adafruit_Sensor_Calibration_EEPROM _calStore; ///< NVS on the ESP32 (the EEPROM emulation)
+    bool _calStoreReady{false};
+    mutable portMUX_TYPE _calMux = portMUX_INITIALIZER_UNLOCKED;
+    ImuCalibrationData _calShared{ImuCalibrationData::identity()}; ///< Copy of _cal's data for commands
+    ImuCalibrationData _calNext{};                                   ///< For the bus task to apply ...
+    bool _calNextValid{false};                                       ///< ... if set
+    ImuCalKind _calStartKind{ImuCalKind::None};                      ///< For the bus task to start
+    uint32_t _calStartSamples{0};
+    std::atomic<bool> _calPending{false}; ///< _calNext or _calStartKind set
+    std::atomic<bool> _calibrating{false};
+    TelemetryStreamId _calStream{TELEMETRY_STREAM_NONE};
 
-    // Json Encoding
-    JsonBufWriter _jw[2] = {///< JSON writers for each buffer
-                            JsonBufWriter(_buf[0], sizeof(_buf[0])),
-                            JsonBufWriter(_buf[1], sizeof(_buf[1]))};
+    // Stats (bus task)
+    Mpu9250DataReady _timing;
+    uint32_t _nextStatsUs{0};
+    TelemetryStreamId _statsStream{TELEMETRY_STREAM_NONE};
 };
\ No newline at end of file
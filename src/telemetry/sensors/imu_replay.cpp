@@ -0,0 +1,286 @@
+#include "imu_replay.hpp"
+#include "telemetry/blackbox_log.hpp"
+#include "telemetry/imu_raw_block.hpp"
+
+#include <math.h>
+#include <stdio.h>
+
+namespace
+{
+    constexpr float kRadPerDeg = 0.0174532925f;
+
+    // Largest block a u8 frame length allows, whatever IMU_RAW_BLOCK_SAMPLES the log was written with
+    constexpr size_t kMaxBlockSamples = (255 - IMU_RAW_BLOCK_HEADER) / IMU_RAW_SAMPLE_BYTES;
+
+    int16_t toCounts(float v, float lsbPerUnit)
+    {
+        const long c = lroundf(v * lsbPerUnit);
+        return (int16_t)(c > INT16_MAX ? INT16_MAX : c < INT16_MIN ? INT16_MIN : c);
+    }
+}
+
+bool ImuReplay::begin()
+{
+    if (_samples.empty())
+        return false; // nothing loaded
+
+    _ahrs.setSampleRate((float)_recordedHz);
+    _streamId = registerStream(_topicSuffix);
+    _delta = DeltaEncoder(&kImuAttitudeSchema, IMU_DELTA_KEYFRAME_INTERVAL);
+    restart();
+    return true;
+}
+
+void ImuReplay::restart()
+{
+    _pos = 0;
+    _lapUs = 0;
+    _startUs = 0;
+    _steps = 0;
+    _publishAcc = 0;
+    _ahrs.reset();
+    _delta.forceKeyframe();
+    _attitude[0] = _attitude[1] = _attitude[2] = 0.0f;
+    _stats = Stats{};
+}
+
+// ===== Loading ================================================================
+
+void ImuReplay::clear()
+{
+    _samples.clear();
+    _firstUs = 0;
+    _lastUs = 0;
+    _recordedHz = 0;
+    _periodUs = 0;
+}
+
+void ImuReplay::add(uint32_t tUs, const ImuRawSample &raw)
+{
+    if (_samples.empty())
+    {
+        _firstUs = tUs;
+        _lastUs = tUs;
+    }
+    // Unwrap the u32 clock; a step back (read jitter, raw mode restarted) keeps the order
+    const uint32_t step = tUs - (uint32_t)_lastUs;
+    if (step < 0x80000000u)
+        _lastUs += step;
+    _samples.push_back(Recorded{(uint32_t)(_lastUs - _firstUs), raw});
+}
+
+bool ImuReplay::finishLoad(uint32_t rateHz, float accelLsbPerG, float gyroLsbPerDps)
+{
+    if (_samples.size() < 2 || rateHz == 0 || accelLsbPerG <= 0.0f || gyroLsbPerDps <= 0.0f)
+    {
+        clear();
+        return false;
+    }
+    _recordedHz = rateHz;
+    _periodUs = 1000000u / rateHz;
+    _cal.setRawScale(IMU_STANDARD_GRAVITY / accelLsbPerG, kRadPerDeg / gyroLsbPerDps);
+    return true;
+}
+
+bool ImuReplay::loadBlackbox(const uint8_t *log, size_t len)
+{
+    clear();
+    BlackboxReader reader(log, len);
+    uint32_t tUs;
+    const uint8_t *payload;
+    size_t n;
+    ImuRawBlockInfo info{};
+    uint16_t rateHz = 0, accelLsb = 0, gyroLsbX10 = 0;
+    ImuRawSample block[kMaxBlockSamples];
+    while (reader.next(tUs, payload, n))
+    {
+        if (!n || payload[0] != IMU_RAW_BLOCK_ID || !imuRawBlockDecode(payload, n, info, block, kMaxBlockSamples) ||
+            !info.count || !info.rate_hz)
+            continue;
+        if (!rateHz)
+        {
+            rateHz = info.rate_hz;
+            accelLsb = info.accel_lsb_per_g;
+            gyroLsbX10 = info.gyro_lsb_per_dps_x10;
+        }
+        // t_us is the newest sample's read time; the others were a sample period apart
+        const uint32_t period = 1000000u / info.rate_hz;
+        for (size_t i = 0; i < info.count; ++i)
+            add(info.t_us - (uint32_t)(info.count - 1 - i) * period, block[i]);
+    }
+    return finishLoad(rateHz, accelLsb, gyroLsbX10 / 10.0f);
+}
+
+bool ImuReplay::loadBlackboxFile(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    std::vector<uint8_t> log;
+    uint8_t buf[BLACKBOX_BLOCK_SIZE];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        log.insert(log.end(), buf, buf + n);
+    fclose(f);
+    return loadBlackbox(log.data(), log.size());
+}
+
+bool ImuReplay::loadCsv(const char *path)
+{
+    clear();
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+
+    char line[160];
+    unsigned long index, tUs, firstIndex = 0, firstUs = 0, lastIndex = 0, lastUs = 0;
+    float v[6];
+    while (fgets(line, sizeof(line), f))
+    {
+        // The header and anything else that isn't a sample row is skipped
+        if (sscanf(line, "%lu,%lu,%f,%f,%f,%f,%f,%f", &index, &tUs, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 8)
+            continue;
+        if (_samples.empty())
+        {
+            firstIndex = index;
+            firstUs = tUs;
+        }
+        lastIndex = index;
+        lastUs = tUs;
+
+        ImuRawSample s;
+        for (int a = 0; a < 3; ++a)
+        {
+            s.accel[a] = toCounts(v[a], Mpu9250Fifo::kAccelLsbPerG);
+            s.gyro[a] = toCounts(v[3 + a], Mpu9250Fifo::kGyroLsbPerDps);
+        }
+        add((uint32_t)tUs, s);
+    }
+    fclose(f);
+
+    // The CSV has no header fields: the rate is what index and time say, the scales the FIFO's
+    const uint32_t spanUs = (uint32_t)(lastUs - firstUs);
+    const uint32_t rateHz =
+        spanUs ? (uint32_t)(((uint64_t)(uint32_t)(lastIndex - firstIndex) * 1000000u + spanUs / 2) / spanUs) : 0;
+    return finishLoad(rateHz, Mpu9250Fifo::kAccelLsbPerG, Mpu9250Fifo::kGyroLsbPerDps);
+}
+
+// ===== Replay =================================================================
+
+void ImuReplay::sample()
+{
+    if (_samples.empty() || !_fullRateHz)
+        return;
+    const uint32_t captureUs = (uint32_t)esp_timer_get_time(); // the "read": age includes fusion and encoding
+
+    // How far into the recording the replay is
+    uint64_t clockUs;
+    if (_speed > 0.0f)
+    {
+        const uint64_t now = (uint64_t)esp_timer_get_time();
+        if (!_startUs)
+            _startUs = now;
+        clockUs = (uint64_t)((double)(now - _startUs) * _speed);
+    }
+    else
+    {
+        clockUs = _steps++ * 1000000ull / _fullRateHz; // the first step takes the first sample
+    }
+
+    // Everything due, in FIFO-sized batches, like one drain
+    size_t n = 0;
+    bool any = false;
+    for (;;)
+    {
+        if (_pos >= _samples.size())
+        {
+            if (!_loop || _lapUs + durationUs() > clockUs)
+                break;
+            _lapUs += durationUs();
+            _pos = 0;
+            _stats.laps++;
+        }
+        const Recorded &r = _samples[_pos];
+        if (_lapUs + r.at_us > clockUs)
+            break;
+        _batch[n++] = r.raw;
+        _pos++;
+        if (n == MPU9250_FIFO_FRAMES)
+        {
+            fuse(n);
+            n = 0;
+            any = true;
+        }
+    }
+    if (n)
+    {
+        fuse(n);
+        any = true;
+    }
+    if (!any)
+        return; // sampled faster than recorded: nothing new, like an empty drain
+
+    _stats.batches++;
+    publishAttitude(captureUs);
+}
+
+void ImuReplay::fuse(size_t n)
+{
+    imuFuseBatch(_cal, _ahrs, _batch, n, nullptr, _scaled, _attitude);
+    _stats.fused += (uint32_t)n;
+}
+
+void ImuReplay::publishAttitude(uint32_t captureUs)
+{
+    // Decimated to the leased rate exactly like IMU_MPU9250::publishAttitude()
+    const uint32_t sampleHz = _fullRateHz;
+    const uint32_t publishHz = _rateHz.load();
+    if (publishHz == 0)
+        return;
+    _publishAcc += publishHz;
+    if (_publishAcc < sampleHz)
+        return;
+    _publishAcc -= sampleHz;
+    if (_publishAcc >= sampleHz)
+        _publishAcc = 0;
+
+    TelemetryLease lease = acquireBuffer();
+    if (!lease.valid())
+    {
+        _stats.no_buffer++;
+        return;
+    }
+
+    const uint8_t *output;
+    size_t length;
+    TelemetryContentType contentType;
+    if (!imuEncodeAttitude(_encoding, _attitude, &_delta, lease.data, lease.capacity, output, length, contentType))
+    {
+        releaseBuffer(lease);
+        return;
+    }
+
+    TelemetrySample sample{
+        .topic_suffix = _topicSuffix,
+        .payload = output,
+        .payload_length = length,
+        .meta = TelemetryMeta{
+            .qos = 0,
+            .retain = false,
+            .content_type = contentType,
+            .full_topic = false,
+            .offline = imuAttitudeOfflinePolicy(contentType),
+        }};
+    sample.stream = _streamId;
+    sample.t_us = captureUs;
+
+    if (publishBuffer(lease, sample, 0))
+    {
+        _stats.published++;
+    }
+    else
+    {
+        _stats.refused++;
+        _delta.forceKeyframe();
+    }
+}
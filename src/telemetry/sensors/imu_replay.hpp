@@ -0,0 +1,162 @@
+#pragma once
+
+/**
+ * @brief IMU telemetry provider that replays recorded samples instead of reading a sensor
+ *
+ * Loads raw accel + gyro frames, from the raw IMU blocks of a blackbox log (raw mode while
+ * recording, see IMU_MPU9250::setRawStream()) or from the CSV written by tools/imu_raw_rx.py
+ * and blackbox_decode.py, and runs them through IMU_MPU9250's FIFO path (imu_attitude.hpp):
+ * calibration, fixed-step fusion at the recorded rate, decimation to the leased rate, encoding
+ * into a pool buffer, publishBuffer(). Everything downstream (class queue, stream stats, TX,
+ * transports) sees an ordinary IMU stream, which makes the whole sensor-to-publish chain
+ * benchmarkable on the host (test_native_imu_replay).
+ *
+ * Pacing (setSpeed()):
+ * - speed > 0: the recording plays against esp_timer_get_time(), @p speed times faster than
+ *   recorded; each sample() fuses whatever came due since the last one, like a drain takes
+ *   what the FIFO collected. Latencies are real ones.
+ * - speed 0 (stepped): each sample() moves the recording on by one sampling period, whatever
+ *   the clock says, so batches, attitude and payloads are identical on every run and the
+ *   caller sets the pace (throughput benchmarks).
+ *
+ * Raw blocks carry no magnetometer: the replay fuses accel + gyro, yaw comes from the gyro.
+ * Host only (the recording is held in a std::vector); excluded from the firmware build.
+ */
+
+#include "../itelemetry_provider.hpp"
+#include "../imu_attitude.hpp"
+
+#include <atomic>
+#include <vector>
+
+class ImuReplay final : public ITelemetryProvider
+{
+public:
+    struct Stats
+    {
+        uint32_t fused;     ///< Recorded samples through the filter
+        uint32_t batches;   ///< sample() calls that had samples due
+        uint32_t published; ///< Attitude samples queued
+        uint32_t no_buffer; ///< Skipped, the pool was exhausted
+        uint32_t refused;   ///< Not queued by the sink
+        uint32_t laps;      ///< Times the recording restarted (setLoop())
+    };
+
+    /**
+     * @param rateHz Publish rate in Hz until the rate controller changes it; the recording is
+     * drained at this rate too (sampleRateHz())
+     * @param topicSuffix MQTT topic suffix, the IMU's by default
+     * @param encoding Payload format (JSON, CBOR, BINARY or DELTA)
+     */
+    explicit ImuReplay(uint32_t rateHz = 200,
+                       const char *topicSuffix = "telemetry/imu",
+                       TelemetryContentType encoding = TelemetryContentType::JSON)
+        : _rateHz(rateHz), _fullRateHz(rateHz), _topicSuffix(topicSuffix), _encoding(encoding) {}
+
+    const char *name() const override { return "IMU_REPLAY"; }
+
+    /// Configured rate while the stream is leased (the drain rate), 0 while idle.
+    uint32_t sampleRateHz() const override { return _rateHz.load() ? _fullRateHz : 0; }
+
+    /// Needs a loaded recording. Registers the stream and sets the filter to the recorded rate.
+    bool begin() override;
+
+    void onSamplingRateChange(uint32_t newRateHz) override { _rateHz = newRateHz; }
+
+    /// Sampled by TelemetryService's scheduler (or a test loop), no task of its own.
+    bool scheduled() const override { return true; }
+
+    /// Fuse what is due (see the class comment) and publish at the leased rate.
+    void sample() override;
+
+    /**
+     * @brief Take the raw IMU blocks of a blackbox log image (every other frame is skipped).
+     * Sample times come from the block headers; lost samples stay lost.
+     * @return false if the log has no raw blocks. Before begin().
+     */
+    bool loadBlackbox(const uint8_t *log, size_t len);
+
+    /// loadBlackbox() on a log file (fetched with tools/blackbox_decode.py).
+    bool loadBlackboxFile(const char *path);
+
+    /**
+     * @brief Take a CSV of `index,t_us,ax_g,ay_g,az_g,gx_dps,gy_dps,gz_dps` rows (the raw
+     * decoders' output), back to FIFO counts. The rate is estimated from index and t_us.
+     * @return false if the file can't be read or has fewer than two samples. Before begin().
+     */
+    bool loadCsv(const char *path);
+
+    /// 1 = real time, 10 = ten times faster, 0 = stepped (default). Before begin().
+    void setSpeed(float speed) { _speed = speed < 0.0f ? 0.0f : speed; }
+
+    /// Start over when the recording ends, with the filter carrying on (default: stop).
+    void setLoop(bool loop) { _loop = loop; }
+
+    /// Calibration applied before fusion (default identity: the recording is raw). Before begin().
+    void setCalibration(const ImuCalibrationData &cal) { _cal.set(cal); }
+
+    /// Attitude filter (default Mahony, like IMU_MPU9250). Before begin().
+    void setFusion(AhrsAlgorithm algorithm) { _ahrs.setAlgorithm(algorithm); }
+
+    /// Back to the first sample with a fresh filter (not while sample() runs).
+    void restart();
+
+    size_t samples() const { return _samples.size(); }
+    uint32_t recordedHz() const { return _recordedHz; }
+
+    /// Recording length in µs of sensor time.
+    uint32_t durationUs() const { return _samples.empty() ? 0 : _samples.back().at_us + _periodUs; }
+
+    /// Played to the end (never with setLoop()).
+    bool finished() const { return _pos >= _samples.size(); }
+
+    /// roll, pitch, yaw of the newest fused sample (sampling task).
+    const float *attitude() const { return _attitude; }
+
+    /// Sampling task; read when it is idle.
+    const Stats &stats() const { return _stats; }
+
+private:
+    struct Recorded
+    {
+        uint32_t at_us; ///< Since the first sample
+        ImuRawSample raw;
+    };
+
+    void clear();
+    void add(uint32_t tUs, const ImuRawSample &raw);
+    bool finishLoad(uint32_t rateHz, float accelLsbPerG, float gyroLsbPerDps);
+    void fuse(size_t n);
+    void publishAttitude(uint32_t captureUs);
+
+    // Recording
+    std::vector<Recorded> _samples;
+    uint32_t _firstUs{0};
+    uint64_t _lastUs{0}; ///< Unwrapped time of the last add()
+    uint32_t _recordedHz{0};
+    uint32_t _periodUs{0};
+
+    // Replay (sampling task)
+    float _speed{0.0f};
+    bool _loop{false};
+    size_t _pos{0};
+    uint64_t _lapUs{0};   ///< Recording time of the laps played
+    uint64_t _startUs{0}; ///< esp_timer time of the first sample() (speed > 0)
+    uint64_t _steps{0};   ///< sample() calls so far (stepped)
+
+    // The IMU's path
+    std::atomic<uint32_t> _rateHz; ///< Publish rate in Hz, 0 = idle
+    const uint32_t _fullRateHz;    ///< Configured rate, the drain rate
+    uint32_t _publishAcc{0};
+    const char *_topicSuffix;
+    TelemetryStreamId _streamId{TELEMETRY_STREAM_NONE};
+    TelemetryContentType _encoding;
+    DeltaEncoder _delta{nullptr};
+    ImuCalibration _cal;
+    AhrsFilter _ahrs;
+    ImuRawSample _batch[MPU9250_FIFO_FRAMES]{};
+    ImuSample _scaled[MPU9250_FIFO_FRAMES]{};
+    float _attitude[3]{};
+
+    Stats _stats{};
+};
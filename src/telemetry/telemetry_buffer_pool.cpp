@@ -0,0 +1,91 @@
+#include "telemetry_buffer_pool.hpp"
+
+namespace
+{
+    constexpr uint32_t kAllFree =
+        TELEMETRY_POOL_BUFFERS == 32 ? 0xFFFFFFFFu : ((1u << TELEMETRY_POOL_BUFFERS) - 1u);
+}
+
+TelemetryBufferPool::TelemetryBufferPool()
+    : _free(kAllFree)
+{
+    for (auto &r : _refs)
+        r.store(0, std::memory_order_relaxed);
+}
+
+TelemetryLease TelemetryBufferPool::acquire(size_t keepFree)
+{
+    uint32_t mask = _free.load(std::memory_order_acquire);
+    for (;;)
+    {
+        if ((size_t)__builtin_popcount(mask) <= keepFree)
+        {
+            _exhausted.fetch_add(1, std::memory_order_relaxed);
+            return TelemetryLease{};
+        }
+        const int slot = __builtin_ctz(mask);
+        if (_free.compare_exchange_weak(mask, mask & ~(1u << slot),
+                                        std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            _refs[slot].store(1, std::memory_order_relaxed);
+            _acquired.fetch_add(1, std::memory_order_relaxed);
+
+            // High-water mark of buffers in use
+            const uint32_t used = (uint32_t)(TELEMETRY_POOL_BUFFERS - __builtin_popcount(mask)) + 1u;
+            uint32_t hw = _highWater.load(std::memory_order_relaxed);
+            while (used > hw && !_highWater.compare_exchange_weak(hw, used, std::memory_order_relaxed))
+            {
+            }
+            return TelemetryLease{_slab[slot], TELEMETRY_POOL_BUFFER_SIZE, (int8_t)slot};
+        }
+        // mask was reloaded by the failed CAS, retry
+    }
+}
+
+void TelemetryBufferPool::retain(int8_t slot)
+{
+    if (slot < 0 || slot >= TELEMETRY_POOL_BUFFERS)
+        return;
+    _refs[slot].fetch_add(1, std::memory_order_relaxed);
+}
+
+void TelemetryBufferPool::release(int8_t slot)
+{
+    if (slot < 0 || slot >= TELEMETRY_POOL_BUFFERS)
+        return;
+    if (_refs[slot].fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        _released.fetch_add(1, std::memory_order_relaxed);
+        _free.fetch_or(1u << slot, std::memory_order_release);
+    }
+}
+
+const uint8_t *TelemetryBufferPool::data(int8_t slot) const
+{
+    if (slot < 0 || slot >= TELEMETRY_POOL_BUFFERS)
+        return nullptr;
+    return _slab[slot];
+}
+
+size_t TelemetryBufferPool::freeCount() const
+{
+    return (size_t)__builtin_popcount(_free.load(std::memory_order_relaxed));
+}
+
+uint8_t TelemetryBufferPool::fillPct(TelemetryClass cls) const
+{
+    const size_t inUse = TELEMETRY_POOL_BUFFERS - freeCount();
+    const size_t usable = TELEMETRY_POOL_BUFFERS - reserveFor(cls);
+    return inUse >= usable ? 100 : (uint8_t)(inUse * 100 / usable);
+}
+
+TelemetryBufferPool::Stats TelemetryBufferPool::stats() const
+{
+    Stats s{};
+    s.acquired = _acquired.load(std::memory_order_relaxed);
+    s.exhausted = _exhausted.load(std::memory_order_relaxed);
+    s.released = _released.load(std::memory_order_relaxed);
+    s.in_use = (uint32_t)(TELEMETRY_POOL_BUFFERS - freeCount());
+    s.high_water = _highWater.load(std::memory_order_relaxed);
+    return s;
+}
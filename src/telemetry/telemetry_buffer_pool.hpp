@@ -0,0 +1,133 @@
+#pragma once
+
+/**
+ * @file telemetry_buffer_pool.hpp
+ * @brief Fixed slab of payload buffers shared by all telemetry providers.
+ *
+ * A provider acquires a buffer, encodes into it and commits it with its sample.
+ * The buffer stays owned by the sample until the TX task has transmitted it and
+ * releases it, so a fast provider can never overwrite a payload that is still
+ * waiting in the queue; when all buffers are in use, acquire() fails and the
+ * provider drops the sample instead.
+ *
+ * The TX queue's classes share the pool, so a saturated Bulk class must not take the
+ * buffers a Critical sample needs. acquire(cls) leaves reserveFor(cls) buffers free:
+ * Bulk stops short of the Control and Critical reserves, Control short of the Critical
+ * one, and only Critical may take the last buffer. TelemetryService also caps the depth
+ * of the evicting classes at queueShare(cls), so their rings fill (and drop the oldest
+ * sample) before the pool runs out for them.
+ *
+ * Lock-free (one atomic free mask plus per-slot refcounts): safe from any task,
+ * no heap, no copies. Builds on the host as well.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "telemetry_sample.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_POOL_BUFFERS
+#define TELEMETRY_POOL_BUFFERS 16 // max 32 (free mask is one word)
+#endif
+
+#ifndef TELEMETRY_POOL_BUFFER_SIZE
+#define TELEMETRY_POOL_BUFFER_SIZE 256
+#endif
+
+#ifndef TELEMETRY_POOL_CRITICAL_RESERVE
+#define TELEMETRY_POOL_CRITICAL_RESERVE 4 // buffers only Critical samples may take
+#endif
+
+#ifndef TELEMETRY_POOL_CONTROL_RESERVE
+#define TELEMETRY_POOL_CONTROL_RESERVE 2 // further buffers Bulk samples may not take
+#endif
+
+#ifndef TELEMETRY_POOL_IN_FLIGHT
+#define TELEMETRY_POOL_IN_FLIGHT 2 // held outside the queue: a provider encoding, the TX task sending
+#endif
+
+static_assert(TELEMETRY_POOL_BUFFERS > 0 && TELEMETRY_POOL_BUFFERS <= 32, "TELEMETRY_POOL_BUFFERS must be 1..32");
+static_assert(TELEMETRY_POOL_CRITICAL_RESERVE + TELEMETRY_POOL_CONTROL_RESERVE + TELEMETRY_POOL_IN_FLIGHT <
+                  TELEMETRY_POOL_BUFFERS,
+              "pool reserves leave no buffers for Bulk");
+
+/**
+ * @brief A buffer handed out by TelemetryBufferPool. `slot` travels with the sample.
+ */
+struct TelemetryLease
+{
+    uint8_t *data{nullptr};
+    size_t capacity{0};
+    int8_t slot{-1};
+
+    bool valid() const { return slot >= 0; }
+};
+
+class TelemetryBufferPool
+{
+public:
+    struct Stats
+    {
+        uint32_t acquired;   ///< Successful acquire() calls
+        uint32_t exhausted;  ///< acquire() found no free buffer
+        uint32_t released;   ///< Buffers returned to the pool
+        uint32_t in_use;     ///< Currently held by providers / samples in flight
+        uint32_t high_water; ///< Most buffers ever in use at once
+    };
+
+    TelemetryBufferPool();
+    TelemetryBufferPool(const TelemetryBufferPool &) = delete;
+    TelemetryBufferPool &operator=(const TelemetryBufferPool &) = delete;
+
+    /**
+     * @return A buffer with refcount 1, or an invalid lease if that would leave fewer
+     * than @p keepFree buffers free (counted as exhausted).
+     */
+    TelemetryLease acquire(size_t keepFree = 0);
+
+    /// A buffer for a sample of @p cls, leaving the other classes' reserves alone.
+    TelemetryLease acquire(TelemetryClass cls) { return acquire(reserveFor(cls)); }
+
+    /// Buffers acquire(@p cls) leaves free.
+    static constexpr size_t reserveFor(TelemetryClass cls)
+    {
+        return cls == TelemetryClass::Critical  ? 0
+               : cls == TelemetryClass::Control ? TELEMETRY_POOL_CRITICAL_RESERVE
+                                                : TELEMETRY_POOL_CRITICAL_RESERVE + TELEMETRY_POOL_CONTROL_RESERVE;
+    }
+
+    /// Samples of @p cls that can wait in the queue while the class still gets buffers.
+    static constexpr size_t queueShare(TelemetryClass cls)
+    {
+        return TELEMETRY_POOL_BUFFERS - reserveFor(cls) - TELEMETRY_POOL_IN_FLIGHT;
+    }
+
+    /// Add a reference (e.g. the same payload queued to two transports).
+    void retain(int8_t slot);
+
+    /// Drop a reference; the buffer returns to the pool at zero. Ignores slot < 0.
+    void release(int8_t slot);
+
+    /// Start of the buffer for @p slot (nullptr if out of range).
+    const uint8_t *data(int8_t slot) const;
+
+    static constexpr size_t bufferSize() { return TELEMETRY_POOL_BUFFER_SIZE; }
+    static constexpr size_t bufferCount() { return TELEMETRY_POOL_BUFFERS; }
+    size_t freeCount() const;
+
+    /// Buffers in use, % of what acquire(@p cls) can hand out: 100 = @p cls gets no buffer.
+    uint8_t fillPct(TelemetryClass cls) const;
+
+    Stats stats() const;
+
+private:
+    alignas(4) uint8_t _slab[TELEMETRY_POOL_BUFFERS][TELEMETRY_POOL_BUFFER_SIZE];
+    std::atomic<uint32_t> _free;                       // bit i set = slot i free
+    std::atomic<uint8_t> _refs[TELEMETRY_POOL_BUFFERS];
+
+    std::atomic<uint32_t> _acquired{0};
+    std::atomic<uint32_t> _exhausted{0};
+    std::atomic<uint32_t> _released{0};
+    std::atomic<uint32_t> _highWater{0};
+};
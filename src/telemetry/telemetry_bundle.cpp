@@ -0,0 +1,150 @@
+#include "telemetry_bundle.hpp"
+
+#include <string.h>
+
+namespace
+{
+    void putU16(uint8_t *p, uint16_t v)
+    {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    void putU32(uint8_t *p, uint32_t v)
+    {
+        putU16(p, (uint16_t)v);
+        putU16(p + 2, (uint16_t)(v >> 16));
+    }
+
+    uint16_t getU16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+    uint32_t getU32(const uint8_t *p) { return getU16(p) | ((uint32_t)getU16(p + 2) << 16); }
+}
+
+void TelemetryBundler::configure(uint32_t windowUs, size_t maxBytes)
+{
+    _windowUs = windowUs > BUNDLE_WINDOW_MAX_US ? BUNDLE_WINDOW_MAX_US : windowUs;
+    _maxBytes = (maxBytes > sizeof(_buf) || maxBytes <= BUNDLE_HEADER_LEN) ? sizeof(_buf) : maxBytes;
+}
+
+TelemetryBundler::AddResult TelemetryBundler::add(const char *topic, bool fullTopic, uint8_t contentType,
+                                                  const uint8_t *payload, size_t len, uint32_t nowUs,
+                                                  uint32_t seq, uint32_t captureUs)
+{
+    const size_t topicLen = topic ? strlen(topic) : 0;
+    const size_t need = BUNDLE_RECORD_HEADER_LEN + topicLen + len;
+    if (topicLen == 0 || topicLen > 0xFF || len > 0xFFFF || BUNDLE_HEADER_LEN + need > _maxBytes)
+    {
+        _stats.too_large++;
+        return AddResult::TooLarge;
+    }
+    if (_count == 0xFF || (_count > 0 && _len + need > _maxBytes))
+        return AddResult::Full;
+
+    if (_count == 0)
+    {
+        _t0Us = nowUs;
+        _len = BUNDLE_HEADER_LEN;
+        _payloadBytes = 0;
+        _offsetSum = 0;
+    }
+
+    const uint32_t offset = nowUs - _t0Us;
+    uint8_t *r = _buf + _len;
+    r[0] = (uint8_t)topicLen;
+    r[1] = (uint8_t)((contentType & 0x0F) | (fullTopic ? BUNDLE_FLAG_FULL_TOPIC : 0));
+    putU16(r + 2, (uint16_t)len);
+    putU16(r + 4, (uint16_t)seq);
+    putU32(r + 6, captureUs);
+    memcpy(r + BUNDLE_RECORD_HEADER_LEN, topic, topicLen);
+    if (len)
+        memcpy(r + BUNDLE_RECORD_HEADER_LEN + topicLen, payload, len);
+
+    _len += need;
+    _count++;
+    _payloadBytes += (uint32_t)len;
+    _offsetSum += offset;
+    return AddResult::Added;
+}
+
+uint32_t TelemetryBundler::remainingUs(uint32_t nowUs) const
+{
+    if (!pending())
+        return 0;
+    const uint32_t elapsed = nowUs - _t0Us;
+    return elapsed >= _windowUs ? 0 : _windowUs - elapsed;
+}
+
+size_t TelemetryBundler::flush(uint32_t nowUs, bool full, const uint8_t *&out)
+{
+    if (!pending())
+        return 0;
+
+    _buf[0] = BUNDLE_VERSION;
+    _buf[1] = _count;
+    putU16(_buf + 2, _seq++);
+    putU32(_buf + 4, _t0Us);
+
+    // Every record waited from its offset until now
+    const uint32_t held = nowUs - _t0Us;
+    _stats.bundles++;
+    _stats.samples += _count;
+    _stats.payload_bytes += _payloadBytes;
+    _stats.frame_bytes += (uint32_t)_len;
+    if (full)
+        _stats.flush_full++;
+    else
+        _stats.flush_window++;
+    if (held > _stats.hold_us_max)
+        _stats.hold_us_max = held;
+    _stats.hold_us_sum += (uint64_t)held * _count - _offsetSum;
+
+    out = _buf;
+    const size_t len = _len;
+    _count = 0;
+    _len = 0;
+    return len;
+}
+
+bool TelemetryBundleReader::begin(const uint8_t *frame, size_t len)
+{
+    _frame = frame;
+    _len = len;
+    _pos = BUNDLE_HEADER_LEN;
+    _read = 0;
+    _error = !frame || len < BUNDLE_HEADER_LEN || frame[0] != BUNDLE_VERSION;
+    if (_error)
+        return false;
+    _count = frame[1];
+    _seq = getU16(frame + 2);
+    _t0Us = getU32(frame + 4);
+    return true;
+}
+
+bool TelemetryBundleReader::next(Record &r)
+{
+    if (_error || _read >= _count)
+        return false;
+    if (_pos + BUNDLE_RECORD_HEADER_LEN > _len)
+    {
+        _error = true;
+        return false;
+    }
+    const uint8_t *h = _frame + _pos;
+    r.topic_len = h[0];
+    r.full_topic = (h[1] & BUNDLE_FLAG_FULL_TOPIC) != 0;
+    r.content_type = h[1] & 0x0F;
+    r.payload_len = getU16(h + 2);
+    r.seq = getU16(h + 4);
+    r.t_us = getU32(h + 6);
+    const size_t end = _pos + BUNDLE_RECORD_HEADER_LEN + r.topic_len + r.payload_len;
+    if (end > _len)
+    {
+        _error = true;
+        return false;
+    }
+    r.topic = reinterpret_cast<const char *>(h + BUNDLE_RECORD_HEADER_LEN);
+    r.payload = h + BUNDLE_RECORD_HEADER_LEN + r.topic_len;
+    _pos = end;
+    _read++;
+    return true;
+}
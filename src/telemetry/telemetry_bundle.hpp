@@ -0,0 +1,141 @@
+#pragma once
+
+/**
+ * @file telemetry_bundle.hpp
+ * @brief Packs several telemetry samples into one framed payload (`<device>/telemetry/bundle`).
+ *
+ * Small samples from many providers each cost a full MQTT publish (fixed header, topic,
+ * TCP/IP headers). The bundler collects them for a short window, or until the frame
+ * would exceed the configured size, and the TX task publishes the frame once.
+ *
+ * Frame layout (little endian):
+ *
+ *     header  : u8 version | u8 count | u16 seq | u32 t0_us
+ *     record* : u8 topic_len | u8 flags | u16 payload_len | u16 stream_seq | u32 t_us | topic | payload
+ *
+ * `t0_us` is the sender time (low 32 bits of esp_timer) the bundle was opened. Each record
+ * carries its sample's stream sequence number (low 16 bits) and capture time `t_us` on the
+ * same clock, so receivers can count lost samples per stream and measure their age.
+ * `flags` holds the TelemetryContentType in the low nibble and BUNDLE_FLAG_FULL_TOPIC when
+ * the topic is absolute (no device prefix).
+ * A decoder lives in tools/telemetry_bundle_rx.py. Builds on the host as well.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_BUNDLE_MAX_BYTES
+#define TELEMETRY_BUNDLE_MAX_BYTES 1200 // one TCP segment incl. MQTT header and topic (lwIP MSS 1436)
+#endif
+
+static constexpr uint8_t BUNDLE_VERSION = 2;
+static constexpr size_t BUNDLE_HEADER_LEN = 8;
+static constexpr size_t BUNDLE_RECORD_HEADER_LEN = 10;
+static constexpr uint8_t BUNDLE_FLAG_FULL_TOPIC = 0x80;
+static constexpr uint32_t BUNDLE_WINDOW_MAX_US = 60000; // a bundle adds up to its window of latency
+
+class TelemetryBundler
+{
+public:
+    enum class AddResult : uint8_t
+    {
+        Added,
+        Full,    ///< Doesn't fit any more: flush(), then add again
+        TooLarge ///< Doesn't fit even an empty frame: send on its own
+    };
+
+    struct Stats
+    {
+        uint32_t bundles;       ///< Frames produced
+        uint32_t samples;       ///< Records in those frames
+        uint32_t payload_bytes; ///< Sample payload bytes carried
+        uint32_t frame_bytes;   ///< Total frame bytes (payload + topics + framing)
+        uint32_t flush_window;  ///< Frames closed by the window
+        uint32_t flush_full;    ///< Frames closed because the next sample didn't fit
+        uint32_t too_large;     ///< Samples sent unbundled because they exceed the frame
+        uint32_t hold_us_max;   ///< Longest time a sample waited in a frame
+        uint64_t hold_us_sum;   ///< Sum over samples, / samples = mean added latency
+    };
+
+    /**
+     * @brief Set the collection window and frame size limit. @p windowUs 0 disables bundling.
+     * @note Call while no frame is open (before the TX task starts).
+     */
+    void configure(uint32_t windowUs, size_t maxBytes = TELEMETRY_BUNDLE_MAX_BYTES);
+
+    bool enabled() const { return _windowUs > 0; }
+
+    /// @param seq, captureUs The sample's stream sequence number and capture time (TelemetrySample).
+    AddResult add(const char *topic, bool fullTopic, uint8_t contentType,
+                  const uint8_t *payload, size_t len, uint32_t nowUs, uint32_t seq, uint32_t captureUs);
+
+    bool pending() const { return _count > 0; }
+
+    /// @return true once the open frame's window has elapsed.
+    bool due(uint32_t nowUs) const { return pending() && (nowUs - _t0Us) >= _windowUs; }
+
+    /// @return µs until the open frame is due (0 if due or nothing is open).
+    uint32_t remainingUs(uint32_t nowUs) const;
+
+    /**
+     * @brief Close the open frame. @p out stays valid until the next add().
+     * @param full true if closed because a sample didn't fit (statistics only)
+     * @return Frame length, 0 if nothing was pending.
+     */
+    size_t flush(uint32_t nowUs, bool full, const uint8_t *&out);
+
+    const Stats &stats() const { return _stats; }
+
+private:
+    uint8_t _buf[TELEMETRY_BUNDLE_MAX_BYTES];
+    size_t _len{0};
+    size_t _maxBytes{TELEMETRY_BUNDLE_MAX_BYTES};
+    uint32_t _windowUs{0};
+    uint32_t _t0Us{0};
+    uint8_t _count{0};
+    uint16_t _seq{0};
+    uint32_t _payloadBytes{0}; // open frame
+    uint64_t _offsetSum{0};    // open frame
+    Stats _stats{};
+};
+
+/**
+ * @brief Walks the records of a received frame (host tools and tests).
+ */
+class TelemetryBundleReader
+{
+public:
+    struct Record
+    {
+        const char *topic; ///< Not NUL-terminated
+        uint8_t topic_len;
+        bool full_topic;
+        uint8_t content_type;
+        const uint8_t *payload;
+        uint16_t payload_len;
+        uint16_t seq;  ///< Stream sequence number, low 16 bits
+        uint32_t t_us; ///< Capture time
+    };
+
+    /// @return false if the header is malformed.
+    bool begin(const uint8_t *frame, size_t len);
+
+    /// @return false at the end of the frame or on a truncated record (see error()).
+    bool next(Record &r);
+
+    uint8_t count() const { return _count; }
+    uint16_t seq() const { return _seq; }
+    uint32_t t0Us() const { return _t0Us; }
+    bool error() const { return _error; }
+
+private:
+    const uint8_t *_frame{nullptr};
+    size_t _len{0};
+    size_t _pos{0};
+    uint8_t _count{0};
+    uint8_t _read{0};
+    uint16_t _seq{0};
+    uint32_t _t0Us{0};
+    bool _error{false};
+};
@@ -0,0 +1,148 @@
+#include "telemetry_class_queue.hpp"
+
+TelemetryClassQueue::TelemetryClassQueue()
+{
+    // Critical: small, refuses rather than forgets a fault; Control: one per stream;
+    // Bulk: most of the room, oldest goes first
+    _classes[index(TelemetryClass::Critical)].cfg = {16, TelemetryDropPolicy::DropNewest, 1};
+    _classes[index(TelemetryClass::Control)].cfg = {16, TelemetryDropPolicy::LatestOnly, 3};
+    _classes[index(TelemetryClass::Bulk)].cfg = {TELEMETRY_CLASS_QUEUE_MAX, TelemetryDropPolicy::DropOldest, 1};
+}
+
+bool TelemetryClassQueue::configure(TelemetryClass cls, const TelemetryClassConfig &cfg)
+{
+    Ring &r = _classes[index(cls)];
+    if (r.count || cfg.depth == 0 || cfg.depth > TELEMETRY_CLASS_QUEUE_MAX)
+        return false;
+    r.cfg = cfg;
+    if (r.cfg.weight == 0)
+        r.cfg.weight = 1;
+    r.head = 0;
+    return true;
+}
+
+TelemetryClassQueue::Push TelemetryClassQueue::push(const TelemetrySample &s, TelemetrySample &displaced,
+                                                    bool latestOnly)
+{
+    Ring &r = _classes[index(s.meta.traffic_class)];
+    const TelemetryDropPolicy policy = latestOnly ? TelemetryDropPolicy::LatestOnly : r.cfg.policy;
+
+    if (policy == TelemetryDropPolicy::LatestOnly)
+    {
+        // Same stream already waiting: take its place in line
+        for (size_t i = 0; i < r.count; ++i)
+        {
+            TelemetrySample &q = at(r, i);
+            const bool same = s.stream != TELEMETRY_STREAM_NONE
+                                  ? q.stream == s.stream
+                                  : q.stream == TELEMETRY_STREAM_NONE && q.topic_suffix == s.topic_suffix;
+            if (same)
+            {
+                displaced = q;
+                q = s;
+                r.stats.queued++;
+                r.stats.replaced++;
+                return Push::Displaced;
+            }
+        }
+    }
+
+    Push result = Push::Queued;
+    if (r.count >= r.cfg.depth)
+    {
+        if (policy == TelemetryDropPolicy::DropNewest)
+        {
+            r.stats.drop_newest++;
+            return Push::Refused;
+        }
+        displaced = at(r, 0);
+        r.head = (uint8_t)((r.head + 1) % TELEMETRY_CLASS_QUEUE_MAX);
+        r.count--;
+        r.stats.drop_oldest++;
+        result = Push::Displaced;
+    }
+
+    at(r, r.count) = s;
+    r.count++;
+    r.stats.queued++;
+    if (r.count > r.stats.high_water)
+        r.stats.high_water = r.count;
+    return result;
+}
+
+bool TelemetryClassQueue::take(Ring &r, TelemetrySample &out)
+{
+    if (!r.count)
+        return false;
+    out = at(r, 0);
+    r.head = (uint8_t)((r.head + 1) % TELEMETRY_CLASS_QUEUE_MAX);
+    r.count--;
+    r.stats.sent++;
+    return true;
+}
+
+bool TelemetryClassQueue::pop(TelemetrySample &out)
+{
+    if (take(_classes[index(TelemetryClass::Critical)], out))
+        return true;
+
+    Ring &control = _classes[index(TelemetryClass::Control)];
+    Ring &bulk = _classes[index(TelemetryClass::Bulk)];
+    if (!control.count || !bulk.count)
+        return take(control, out) || take(bulk, out); // no contention, no turns
+
+    if (_credit == 0)
+        _credit = _classes[_turn].cfg.weight;
+    const bool ok = take(_classes[_turn], out);
+    if (--_credit == 0)
+        _turn = _turn == (uint8_t)TelemetryClass::Control ? (uint8_t)TelemetryClass::Bulk : (uint8_t)TelemetryClass::Control;
+    return ok;
+}
+
+bool TelemetryClassQueue::full(TelemetryClass cls) const
+{
+    const Ring &r = _classes[index(cls)];
+    return r.count >= r.cfg.depth;
+}
+
+size_t TelemetryClassQueue::size() const
+{
+    size_t n = 0;
+    for (const Ring &r : _classes)
+        n += r.count;
+    return n;
+}
+
+size_t TelemetryClassQueue::capacity() const
+{
+    size_t n = 0;
+    for (const Ring &r : _classes)
+        n += r.cfg.depth;
+    return n;
+}
+
+const char *TelemetryClassQueue::className(TelemetryClass cls)
+{
+    switch (cls)
+    {
+    case TelemetryClass::Critical:
+        return "critical";
+    case TelemetryClass::Control:
+        return "control";
+    default:
+        return "bulk";
+    }
+}
+
+const char *TelemetryClassQueue::policyName(TelemetryDropPolicy policy)
+{
+    switch (policy)
+    {
+    case TelemetryDropPolicy::DropNewest:
+        return "drop_newest";
+    case TelemetryDropPolicy::DropOldest:
+        return "drop_oldest";
+    default:
+        return "latest_only";
+    }
+}
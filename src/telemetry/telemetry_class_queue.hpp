@@ -0,0 +1,116 @@
+#pragma once
+
+/**
+ * @file telemetry_class_queue.hpp
+ * @brief TelemetryService's TX queue: one bounded ring per TelemetryClass, each with its own
+ * drop policy, drained critical first.
+ *
+ * A single FIFO lets a burst of IMU samples push a rare battery-low sample out, or hold it
+ * behind a full queue. Here every class has its own ring, so bulk traffic can only ever
+ * displace bulk traffic, and pop() always returns a queued Critical sample first. Control
+ * and Bulk then share the TX task by weight (weighted round robin, in samples), so a
+ * saturated bulk class can't starve control either.
+ *
+ * Drop policies, when a class is full:
+ * - DropNewest: the new sample is refused (events: the first report matters).
+ * - DropOldest: the oldest queued sample makes room (live data: fresh beats stale).
+ * - LatestOnly: a queued sample of the same stream is replaced in place, so a stream has
+ *   at most one sample waiting; this happens even when the ring isn't full. Without one
+ *   to replace, the oldest makes room.
+ * publish() callers can also ask for LatestOnly per sample (ITelemetryProvider::publishOverwrite()).
+ *
+ * push() hands back whatever it displaced, so the caller can release pool buffers and count
+ * the loss against the right stream. Not synchronized; builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_sample.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_CLASS_QUEUE_MAX
+#define TELEMETRY_CLASS_QUEUE_MAX 64 // ring size per class (storage); the configured depth may be lower
+#endif
+
+static_assert(TELEMETRY_CLASS_QUEUE_MAX > 0 && TELEMETRY_CLASS_QUEUE_MAX <= 255, "TELEMETRY_CLASS_QUEUE_MAX must be 1..255");
+
+static constexpr size_t TELEMETRY_CLASS_COUNT = 3;
+
+enum class TelemetryDropPolicy : uint8_t
+{
+    DropNewest,
+    DropOldest,
+    LatestOnly
+};
+
+struct TelemetryClassConfig
+{
+    uint8_t depth;              ///< 1..TELEMETRY_CLASS_QUEUE_MAX
+    TelemetryDropPolicy policy;
+    uint8_t weight;             ///< Control/Bulk: samples per round robin turn (Critical: unused, strict)
+};
+
+class TelemetryClassQueue
+{
+public:
+    enum class Push : uint8_t
+    {
+        Queued,    ///< Nothing lost
+        Displaced, ///< Queued; `displaced` was evicted or replaced and is the caller's again
+        Refused    ///< Not queued (DropNewest and full): the sample is still the caller's
+    };
+
+    struct Stats
+    {
+        uint32_t queued;
+        uint32_t sent;         ///< Handed to the TX task by pop()
+        uint32_t drop_newest;  ///< Refused
+        uint32_t drop_oldest;  ///< Evicted to make room
+        uint32_t replaced;     ///< LatestOnly: superseded by a newer sample of the same stream
+        uint8_t high_water;    ///< Most samples waiting at once
+    };
+
+    TelemetryClassQueue();
+
+    /// Change a class's depth, policy or weight. Only while it is empty (before the TX task starts).
+    bool configure(TelemetryClass cls, const TelemetryClassConfig &cfg);
+    const TelemetryClassConfig &config(TelemetryClass cls) const { return _classes[index(cls)].cfg; }
+
+    /// Queue @p s in its meta.traffic_class; @p latestOnly forces LatestOnly for this sample.
+    Push push(const TelemetrySample &s, TelemetrySample &displaced, bool latestOnly = false);
+
+    /// Next sample to send: Critical first, then Control/Bulk by weight. @return false if all are empty.
+    bool pop(TelemetrySample &out);
+
+    bool full(TelemetryClass cls) const;
+    size_t size() const;
+    size_t size(TelemetryClass cls) const { return _classes[index(cls)].count; }
+    /// Configured depth of all classes together.
+    size_t capacity() const;
+
+    const Stats &stats(TelemetryClass cls) const { return _classes[index(cls)].stats; }
+
+    static const char *className(TelemetryClass cls);
+    static const char *policyName(TelemetryDropPolicy policy);
+
+private:
+    struct Ring
+    {
+        TelemetryClassConfig cfg{};
+        TelemetrySample items[TELEMETRY_CLASS_QUEUE_MAX];
+        uint8_t head{0};
+        uint8_t count{0};
+        Stats stats{};
+    };
+
+    static size_t index(TelemetryClass cls)
+    {
+        return (size_t)cls < TELEMETRY_CLASS_COUNT ? (size_t)cls : TELEMETRY_CLASS_COUNT - 1;
+    }
+    static TelemetrySample &at(Ring &r, size_t i) { return r.items[(r.head + i) % TELEMETRY_CLASS_QUEUE_MAX]; }
+    static bool take(Ring &r, TelemetrySample &out);
+
+    Ring _classes[TELEMETRY_CLASS_COUNT];
+    uint8_t _turn{(uint8_t)TelemetryClass::Control}; // whose weighted turn it is
+    uint8_t _credit{0};                               // samples left in that turn
+};
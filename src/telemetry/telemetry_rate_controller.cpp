@@ -0,0 +1,126 @@
+#include "telemetry_rate_controller.hpp"
+
+int TelemetryRateController::add(uint32_t nominalHz, const TelemetryRateLimits &limits)
+{
+    if (_count >= TELEMETRY_RATE_MAX_STREAMS)
+        return -1;
+
+    Stream &s = _streams[_count];
+    s.maxHz = limits.maxHz ? limits.maxHz : (nominalHz ? nominalHz : 1);
+    s.minHz = limits.minHz ? limits.minHz : s.maxHz / 10;
+    if (s.minHz == 0)
+        s.minHz = 1;
+    if (s.minHz > s.maxHz)
+        s.minHz = s.maxHz;
+    s.hz = nominalHz < s.minHz ? s.minHz : (nominalHz > s.maxHz ? s.maxHz : nominalHz);
+    s.priority = limits.priority;
+    return (int)_count++;
+}
+
+uint32_t TelemetryRateController::decrease()
+{
+    // Least important class that can still give something up
+    int victim = -1;
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (_streams[i].hz > _streams[i].minHz && (int)_streams[i].priority > victim)
+            victim = _streams[i].priority;
+    }
+    if (victim < 0)
+        return 0;
+
+    uint32_t changed = 0;
+    for (size_t i = 0; i < _count; ++i)
+    {
+        Stream &s = _streams[i];
+        if (s.priority != victim || s.hz <= s.minHz)
+            continue;
+        const uint32_t hz = s.hz / 2;
+        s.hz = hz < s.minHz ? s.minHz : hz;
+        changed |= 1u << i;
+    }
+    return changed;
+}
+
+uint32_t TelemetryRateController::increase()
+{
+    // Most important class that is below nominal
+    int winner = 256;
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (_streams[i].hz < _streams[i].maxHz && (int)_streams[i].priority < winner)
+            winner = _streams[i].priority;
+    }
+    if (winner == 256)
+        return 0;
+
+    uint32_t changed = 0;
+    for (size_t i = 0; i < _count; ++i)
+    {
+        Stream &s = _streams[i];
+        if (s.priority != winner || s.hz >= s.maxHz)
+            continue;
+        uint32_t step = s.maxHz * _cfg.step_pct / 100;
+        if (step == 0)
+            step = 1;
+        s.hz = (s.maxHz - s.hz) < step ? s.maxHz : s.hz + step;
+        changed |= 1u << i;
+    }
+    return changed;
+}
+
+TelemetryRateController::Decision TelemetryRateController::update(const Input &in)
+{
+    _stats.periods++;
+
+    const bool congested = in.queue_fill_pct >= _cfg.fill_high_pct || in.failures > 0 ||
+                           (in.rtt_ms && in.rtt_ms >= _cfg.rtt_high_ms);
+    const bool clear = in.queue_fill_pct <= _cfg.fill_low_pct && in.failures == 0 &&
+                       (!in.rtt_ms || in.rtt_ms <= _cfg.rtt_low_ms);
+
+    if (congested)
+    {
+        _stats.congested++;
+        _clearPeriods = 0;
+        const uint32_t changed = decrease();
+        if (!changed)
+        {
+            _stats.saturated++;
+            return {Action::Saturated, 0};
+        }
+        _stats.decreases++;
+        return {Action::Decrease, changed};
+    }
+
+    if (!clear)
+    {
+        _clearPeriods = 0; // in between: hold what we have
+        return {Action::Hold, 0};
+    }
+
+    if (_clearPeriods < _cfg.recover_periods)
+    {
+        _clearPeriods++;
+        return {Action::Hold, 0};
+    }
+    const uint32_t changed = increase();
+    if (!changed)
+        return {Action::Hold, 0};
+    _stats.increases++;
+    return {Action::Increase, changed};
+}
+
+const char *TelemetryRateController::actionName(Action a)
+{
+    switch (a)
+    {
+    case Action::Decrease:
+        return "decrease";
+    case Action::Increase:
+        return "increase";
+    case Action::Saturated:
+        return "saturated";
+    default:
+        return "hold";
+    }
+}
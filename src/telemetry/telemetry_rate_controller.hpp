@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+ * @file telemetry_rate_controller.hpp
+ * @brief Lowers provider rates when the uplink can't keep up and restores them when it can.
+ *
+ * TelemetryService feeds one Input per control period (peak backlog, failed
+ * publishes, ack RTT). On congestion the controller halves the rates of the least
+ * important priority class that is still above its minimum; once the link has been
+ * clear for a few periods it steps the most important reduced class back up towards
+ * its nominal rate (multiplicative decrease, additive increase). Priorities: 0 is the
+ * most important. Builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_RATE_MAX_STREAMS
+#define TELEMETRY_RATE_MAX_STREAMS 8
+#endif
+
+/// Per-provider bounds for the rate controller.
+struct TelemetryRateLimits
+{
+    uint32_t minHz{0};    ///< 0 = nominal / 10 (at least 1 Hz)
+    uint32_t maxHz{0};    ///< 0 = nominal (the provider's sampleRateHz() when added)
+    uint8_t priority{1};  ///< 0 = reduced last, restored first
+};
+
+class TelemetryRateController
+{
+public:
+    struct Config
+    {
+        uint8_t fill_high_pct{50}; ///< Peak queue fill that counts as congestion
+        uint8_t fill_low_pct{20};  ///< ... and as clear
+        uint32_t rtt_high_ms{300};
+        uint32_t rtt_low_ms{100};
+        uint8_t recover_periods{3}; ///< Clear periods before the first increase
+        uint8_t step_pct{25};       ///< Increase per period, % of nominal
+    };
+
+    struct Input
+    {
+        uint8_t queue_fill_pct; ///< Peak backlog over the period (TelemetryBufferPool::fillPct(Bulk))
+        uint32_t failures;      ///< Dropped / refused publishes over the period
+        uint32_t rtt_ms;        ///< Mean ack RTT over the period, 0 = no sample
+    };
+
+    enum class Action : uint8_t
+    {
+        Hold,
+        Decrease,
+        Increase,
+        Saturated ///< Congested, but every stream is already at its minimum
+    };
+
+    struct Decision
+    {
+        Action action;
+        uint32_t changed; ///< Bit i set = stream i got a new rate
+    };
+
+    struct Stats
+    {
+        uint32_t periods;
+        uint32_t congested;
+        uint32_t decreases;
+        uint32_t increases;
+        uint32_t saturated;
+    };
+
+    void configure(const Config &cfg) { _cfg = cfg; }
+
+    /// @return Stream index, or -1 if the table is full.
+    int add(uint32_t nominalHz, const TelemetryRateLimits &limits = {});
+
+    Decision update(const Input &in);
+
+    size_t size() const { return _count; }
+    uint32_t rate(size_t i) const { return i < _count ? _streams[i].hz : 0; }
+    uint32_t nominal(size_t i) const { return i < _count ? _streams[i].maxHz : 0; }
+    const Stats &stats() const { return _stats; }
+
+    static const char *actionName(Action a);
+
+private:
+    struct Stream
+    {
+        uint32_t hz;
+        uint32_t minHz;
+        uint32_t maxHz;
+        uint8_t priority;
+    };
+
+    uint32_t decrease();
+    uint32_t increase();
+
+    Config _cfg{};
+    Stream _streams[TELEMETRY_RATE_MAX_STREAMS]{};
+    size_t _count{0};
+    uint8_t _clearPeriods{0};
+    Stats _stats{};
+};
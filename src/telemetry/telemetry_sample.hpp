@@ -0,0 +1,73 @@
+#pragma once
+/**
+ * @file telemetry_sample.hpp
+ * @brief The sample descriptor providers hand to TelemetryService, and its metadata.
+ * No FreeRTOS; builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_topic_table.hpp"
+
+enum class TelemetryContentType : uint8_t
+{
+    JSON,
+    CBOR,
+    BINARY,
+    TEXT,
+    DELTA ///< Quantized delta stream, see delta_codec.hpp
+};
+
+/**
+ * @brief What the transport should do with a sample it can't send right now (e.g. link down).
+ * Values mirror MqttService::OfflinePolicy.
+ */
+enum class TelemetryOfflinePolicy : uint8_t
+{
+    Drop,     ///< Lose it
+    Coalesce, ///< Keep only the latest sample per topic (state streams)
+    Fifo      ///< Keep every sample in order (event streams)
+};
+
+/**
+ * @brief TX queue a sample waits in (see telemetry_class_queue.hpp). Critical is always
+ * sent first; Control and Bulk share what is left by weight.
+ */
+enum class TelemetryClass : uint8_t
+{
+    Critical, ///< Rare and must arrive: battery low, ESC fault, command replies
+    Control,  ///< Low-rate state the ground acts on
+    Bulk      ///< High-rate streams (IMU) and statistics
+};
+
+struct TelemetryMeta
+{
+    uint8_t qos = 0;
+    bool retain = false;
+    TelemetryContentType content_type = TelemetryContentType::JSON;
+    bool full_topic = false;
+    TelemetryOfflinePolicy offline = TelemetryOfflinePolicy::Drop;
+    TelemetryClass traffic_class = TelemetryClass::Bulk;
+};
+
+/**
+ * @brief Telemetry sample descriptor passed through the queue.
+ * NOTE: Prefer `stream` (from registerStream()); topic_suffix is only used when it is
+ * TELEMETRY_STREAM_NONE and must point to storage that outlives the sample. Samples of
+ * registered streams are stamped with a per-stream `seq` on publish() (see
+ * telemetry_stream_stats.hpp).
+ * payload should live in a TelemetryBufferPool buffer (`buffer` >= 0), which the TX task
+ * releases after transmitting; provider-owned payloads (`buffer` == -1) must stay valid
+ * until the consumer has used them.
+ */
+struct TelemetrySample
+{
+    const char *topic_suffix{nullptr};
+    const uint8_t *payload{nullptr};
+    size_t payload_length{0};
+    TelemetryMeta meta{};
+    int8_t buffer{-1}; ///< TelemetryBufferPool slot holding the payload, -1 if provider-owned
+    TelemetryStreamId stream{TELEMETRY_STREAM_NONE}; ///< Pre-resolved topic, see registerStream()
+    uint32_t seq{0};  ///< Per-stream sequence number, set by publish()
+    uint32_t t_us{0}; ///< Capture time (low 32 bits of esp_timer µs); 0 = stamped by publish()
+};
@@ -0,0 +1,204 @@
+#include "telemetry_stream_control.hpp"
+
+#include <string.h>
+
+namespace
+{
+    // Next space-separated token of [p, end)
+    bool token(const char *&p, const char *end, const char *&tok, size_t &len)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            ++p;
+        tok = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+            ++p;
+        len = (size_t)(p - tok);
+        return len > 0;
+    }
+
+    bool number(const char *tok, size_t len, uint32_t &out)
+    {
+        if (len == 0 || len > 9)
+            return false;
+        uint32_t v = 0;
+        for (size_t i = 0; i < len; ++i)
+        {
+            if (tok[i] < '0' || tok[i] > '9')
+                return false;
+            v = v * 10 + (uint32_t)(tok[i] - '0');
+        }
+        out = v;
+        return true;
+    }
+
+    bool is(const char *tok, size_t len, const char *word)
+    {
+        return strlen(word) == len && memcmp(tok, word, len) == 0;
+    }
+}
+
+int TelemetryStreamControl::add(const char *name, TelemetryDemand demand)
+{
+    if (!name || _count >= TELEMETRY_RATE_MAX_STREAMS)
+        return -1;
+    _entries[_count] = Entry{name, demand, State::Default, 0, 0};
+    return (int)_count++;
+}
+
+uint32_t TelemetryStreamControl::match(const char *name, size_t len) const
+{
+    if (is(name, len, "*"))
+        return _count ? (uint32_t)((1ull << _count) - 1) : 0;
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (is(name, len, _entries[i].name))
+            return 1u << i;
+    }
+    return 0;
+}
+
+TelemetryStreamControl::Command TelemetryStreamControl::parse(const char *cmd, size_t len)
+{
+    Command c{Result::Ok, Command::Verb::Auto, nullptr, 0, 0, 0};
+    const char *p = cmd;
+    const char *end = cmd + len;
+    const char *verb, *arg;
+    size_t verbLen, argLen;
+
+    if (!token(p, end, verb, verbLen))
+    {
+        c.result = Result::UnknownCommand;
+        return c;
+    }
+    if (is(verb, verbLen, "status"))
+    {
+        c.verb = Command::Verb::Status;
+        return c;
+    }
+    if (is(verb, verbLen, "on"))
+        c.verb = Command::Verb::On;
+    else if (is(verb, verbLen, "off"))
+        c.verb = Command::Verb::Off;
+    else if (is(verb, verbLen, "auto"))
+        c.verb = Command::Verb::Auto;
+    else
+        c.result = Result::UnknownCommand;
+    if (c.result == Result::Ok && !token(p, end, c.who, c.whoLen))
+        c.result = Result::BadArgument;
+    if (c.result != Result::Ok)
+        return c;
+
+    // on: [hz] [lease_s]; off: [lease_s]; auto: nothing
+    const bool on = c.verb == Command::Verb::On;
+    const bool off = c.verb == Command::Verb::Off;
+    uint32_t args[2] = {0, 0};
+    size_t argc = 0;
+    while (token(p, end, arg, argLen))
+    {
+        if (argc >= (on ? 2u : off ? 1u : 0u) || !number(arg, argLen, args[argc]))
+        {
+            c.result = Result::BadArgument;
+            return c;
+        }
+        argc++;
+    }
+    c.capHz = on ? args[0] : 0;
+    c.leaseS = on ? args[1] : args[0];
+    if (c.leaseS == 0)
+        c.leaseS = TELEMETRY_LEASE_DEFAULT_S;
+    if (c.leaseS > TELEMETRY_LEASE_MAX_S)
+        c.leaseS = TELEMETRY_LEASE_MAX_S;
+    return c;
+}
+
+TelemetryStreamControl::Outcome TelemetryStreamControl::apply(const Command &cmd, uint32_t nowMs)
+{
+    if (cmd.result != Result::Ok)
+    {
+        _stats.rejected++;
+        return Outcome{cmd.result, 0};
+    }
+    if (cmd.verb == Command::Verb::Status)
+        return Outcome{Result::Status, 0};
+
+    const uint32_t targets = match(cmd.who, cmd.whoLen);
+    if (!targets)
+    {
+        _stats.rejected++;
+        return Outcome{Result::UnknownProvider, 0};
+    }
+
+    Outcome out{Result::Ok, 0};
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (!(targets & (1u << i)))
+            continue;
+        Entry &e = _entries[i];
+        const uint32_t before = cap(i);
+        if (cmd.verb != Command::Verb::Auto)
+        {
+            e.state = cmd.verb == Command::Verb::On ? State::On : State::Off;
+            e.capHz = cmd.capHz;
+            e.expiresMs = nowMs + cmd.leaseS * 1000u;
+        }
+        else
+        {
+            e.state = State::Default;
+        }
+        if (cap(i) != before)
+            out.changed |= 1u << i;
+    }
+    _stats.commands++;
+    return out;
+}
+
+uint32_t TelemetryStreamControl::expire(uint32_t nowMs)
+{
+    uint32_t changed = 0;
+    for (size_t i = 0; i < _count; ++i)
+    {
+        Entry &e = _entries[i];
+        if (e.state == State::Default || (int32_t)(nowMs - e.expiresMs) < 0)
+            continue;
+        const uint32_t before = cap(i);
+        e.state = State::Default;
+        _stats.expired++;
+        if (cap(i) != before)
+            changed |= 1u << i;
+    }
+    return changed;
+}
+
+uint32_t TelemetryStreamControl::cap(size_t i) const
+{
+    if (i >= _count)
+        return kUncapped;
+    const Entry &e = _entries[i];
+    switch (e.state)
+    {
+    case State::On:
+        return e.capHz ? e.capHz : kUncapped;
+    case State::Off:
+        return 0;
+    default:
+        return e.demand == TelemetryDemand::OnDemand ? 0 : kUncapped;
+    }
+}
+
+uint32_t TelemetryStreamControl::leaseRemainingMs(size_t i, uint32_t nowMs) const
+{
+    if (i >= _count || _entries[i].state == State::Default)
+        return 0;
+    const int32_t left = (int32_t)(_entries[i].expiresMs - nowMs);
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+bool TelemetryStreamControl::leased() const
+{
+    for (size_t i = 0; i < _count; ++i)
+    {
+        if (_entries[i].state != State::Default)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+/**
+ * @file telemetry_stream_control.hpp
+ * @brief Ground-side leases that switch provider streams on, off or to a lower rate.
+ *
+ * A ground client sends text commands on `<device>/telemetry/ctl`:
+ *
+ *     on <provider|*> [hz] [lease_s]   publish, at most hz (0 / omitted = uncapped)
+ *     off <provider|*> [lease_s]       publish nothing
+ *     auto <provider|*>                drop the lease now
+ *     status                           republish the status
+ *
+ * Every on/off holds for a lease (TELEMETRY_LEASE_DEFAULT_S unless given, at most
+ * TELEMETRY_LEASE_MAX_S) and has to be renewed by repeating it. When it runs out the
+ * provider goes back to its default: Continuous providers publish, OnDemand providers
+ * stay idle. So a crashed ground station can't leave a stream switched on, or off, for good.
+ *
+ * The table only decides a cap per provider; TelemetryService combines it with the
+ * adaptive rate (effective()) and tells the provider (onSamplingRateChange(0) = idle).
+ * Indices match TelemetryRateController's. Not synchronized; builds on the host.
+ * parse() reads no table state, so an owner that locks the table can tokenize a command
+ * outside its lock and hold it only for apply(Command).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_rate_controller.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_LEASE_DEFAULT_S
+#define TELEMETRY_LEASE_DEFAULT_S 30
+#endif
+
+#ifndef TELEMETRY_LEASE_MAX_S
+#define TELEMETRY_LEASE_MAX_S 3600
+#endif
+
+/// What a provider does while no lease is held.
+enum class TelemetryDemand : uint8_t
+{
+    Continuous, ///< Publishes unless a client switches it off
+    OnDemand    ///< Idle until a client switches it on
+};
+
+class TelemetryStreamControl
+{
+public:
+    enum class Result : uint8_t
+    {
+        Ok,
+        Status,          ///< "status": nothing changed, report anyway
+        UnknownCommand,
+        UnknownProvider,
+        BadArgument
+    };
+
+    struct Outcome
+    {
+        Result result;
+        uint32_t changed; ///< Bit i set = provider i got a new cap
+    };
+
+    struct Stats
+    {
+        uint32_t commands; ///< Accepted on/off/auto
+        uint32_t rejected;
+        uint32_t expired;  ///< Leases that ran out
+    };
+
+    /// A tokenized command. Points into the text given to parse(), which must outlive it.
+    struct Command
+    {
+        enum class Verb : uint8_t
+        {
+            On,
+            Off,
+            Auto,
+            Status
+        };
+
+        Result result; ///< Ok, or why parse() refused it (apply() counts it as rejected)
+        Verb verb;
+        const char *who; ///< Provider name or "*", not NUL terminated
+        size_t whoLen;
+        uint32_t capHz;  ///< On: 0 = uncapped
+        uint32_t leaseS; ///< On/Off: default applied and clamped to TELEMETRY_LEASE_MAX_S
+    };
+
+    static constexpr uint32_t kUncapped = UINT32_MAX;
+
+    /// @p name must outlive the table (provider names are literals). @return Index, or -1 if full.
+    int add(const char *name, TelemetryDemand demand);
+
+    /// Tokenize one command (need not be NUL terminated). Touches no table state.
+    static Command parse(const char *cmd, size_t len);
+
+    /// Apply a parsed command: match the provider(s) and set their leases.
+    Outcome apply(const Command &cmd, uint32_t nowMs);
+
+    /// parse() and apply() in one go.
+    Outcome apply(const char *cmd, size_t len, uint32_t nowMs) { return apply(parse(cmd, len), nowMs); }
+
+    /// Drop leases that have run out. @return Providers whose cap changed.
+    uint32_t expire(uint32_t nowMs);
+
+    /// 0 = idle, kUncapped = whatever the rate controller allows, else a cap in Hz.
+    uint32_t cap(size_t i) const;
+
+    /// Rate provider @p i should run at, given the rate controller's @p adaptiveHz.
+    uint32_t effective(size_t i, uint32_t adaptiveHz) const
+    {
+        const uint32_t c = cap(i);
+        return c < adaptiveHz ? c : adaptiveHz;
+    }
+
+    /// ms left on provider @p i's lease, 0 without one.
+    uint32_t leaseRemainingMs(size_t i, uint32_t nowMs) const;
+
+    /// True while any lease is held (the owner then calls expire() periodically).
+    bool leased() const;
+
+    size_t size() const { return _count; }
+    const char *name(size_t i) const { return i < _count ? _entries[i].name : nullptr; }
+    TelemetryDemand demand(size_t i) const { return i < _count ? _entries[i].demand : TelemetryDemand::Continuous; }
+    const Stats &stats() const { return _stats; }
+
+private:
+    enum class State : uint8_t
+    {
+        Default,
+        On,
+        Off
+    };
+
+    struct Entry
+    {
+        const char *name;
+        TelemetryDemand demand;
+        State state;
+        uint32_t capHz;     // On: 0 = uncapped
+        uint32_t expiresMs; // On/Off
+    };
+
+    uint32_t match(const char *name, size_t len) const;
+
+    Entry _entries[TELEMETRY_RATE_MAX_STREAMS]{};
+    size_t _count{0};
+    Stats _stats{};
+};
@@ -0,0 +1,93 @@
+#include "telemetry_stream_stats.hpp"
+
+#include <string.h>
+
+size_t TelemetryStreamStats::ageBucket(uint32_t us)
+{
+    if (us < 2)
+        return us;
+    const unsigned msb = 31u - (unsigned)__builtin_clz(us);
+    const size_t b = 2 * msb + ((us >> (msb - 1)) & 1u); // two buckets per power of two
+    return b < TELEMETRY_AGE_BUCKETS ? b : TELEMETRY_AGE_BUCKETS - 1;
+}
+
+uint32_t TelemetryStreamStats::bucketUpperUs(size_t bucket)
+{
+    if (bucket < 2)
+        return (uint32_t)bucket;
+    if (bucket >= TELEMETRY_AGE_BUCKETS - 1)
+        return UINT32_MAX;
+    const unsigned msb = (unsigned)(bucket / 2);
+    const uint32_t half = 1u << (msb - 1);
+    return (1u << msb) + (bucket & 1 ? 2 * half : half) - 1;
+}
+
+void TelemetryStreamStats::transmitted(TelemetryStreamId id, Outcome outcome, uint32_t captureUs, uint32_t nowUs)
+{
+    if (id >= TELEMETRY_MAX_STREAMS)
+        return;
+    Entry &e = _entries[id];
+    switch (outcome)
+    {
+    case Outcome::Sent:
+        e.sent++;
+        break;
+    case Outcome::Buffered:
+        e.buffered++;
+        break;
+    default:
+        e.failed++;
+        return; // no hand-off, no age
+    }
+
+    const uint32_t age = nowUs - captureUs;
+    e.lastCaptureUs = captureUs;
+    e.ageCount++;
+    e.ageHist[ageBucket(age)]++;
+    if (age > e.ageMaxUs)
+        e.ageMaxUs = age;
+}
+
+uint32_t TelemetryStreamStats::percentile(const Entry &e, uint32_t permille) const
+{
+    if (!e.ageCount)
+        return 0;
+    const uint64_t rank = ((uint64_t)e.ageCount * permille + 999) / 1000; // 1-based, rounded up
+    uint64_t seen = 0;
+    for (size_t b = 0; b < TELEMETRY_AGE_BUCKETS; ++b)
+    {
+        seen += e.ageHist[b];
+        if (seen >= rank)
+        {
+            const uint32_t upper = bucketUpperUs(b);
+            return upper < e.ageMaxUs ? upper : e.ageMaxUs;
+        }
+    }
+    return e.ageMaxUs;
+}
+
+TelemetryStreamStats::Snapshot TelemetryStreamStats::snapshot(TelemetryStreamId id, bool resetAge)
+{
+    Snapshot s{};
+    if (id >= TELEMETRY_MAX_STREAMS)
+        return s;
+    Entry &e = _entries[id];
+    s.seq = e.seq.load(std::memory_order_relaxed);
+    s.enqueue_drops = e.enqueueDrops.load(std::memory_order_relaxed);
+    s.sent = e.sent;
+    s.buffered = e.buffered;
+    s.tx_failures = e.failed;
+    s.last_capture_us = e.lastCaptureUs;
+    s.age_count = e.ageCount;
+    s.age_p50_us = percentile(e, 500);
+    s.age_p90_us = percentile(e, 900);
+    s.age_p99_us = percentile(e, 990);
+    s.age_max_us = e.ageMaxUs;
+    if (resetAge)
+    {
+        e.ageCount = 0;
+        e.ageMaxUs = 0;
+        memset(e.ageHist, 0, sizeof(e.ageHist));
+    }
+    return s;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+ * @file telemetry_stream_stats.hpp
+ * @brief Per-stream sequence numbers and drop/age accounting for registered telemetry streams.
+ *
+ * Every sample a provider tries to enqueue takes the stream's next sequence number, so a
+ * receiver sees a gap for any sample lost after that point. The device counts where
+ * those samples went, one counter per stage:
+ *
+ *     stamp() ── enqueue ──> TX task ──> MQTT / outbox / UDP / bundle
+ *                  │            │
+ *            enqueue_drops   tx_failures
+ *
+ * `seq - enqueue_drops - sent - buffered - tx_failures` is what is still queued. Samples
+ * the outbox later replaces or evicts are counted there (MqttOutbox::Stats), as the outbox
+ * is shared by every publisher.
+ *
+ * Age is the time from capture (TelemetrySample::t_us) to hand-off by the TX task, kept
+ * per window in half-octave buckets (p50/p90/p99 within ~20 %, max exact).
+ *
+ * stamp() and enqueueDropped() may run on any task (atomics); everything else belongs to
+ * the TX task. No heap; builds on the host.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "telemetry_topic_table.hpp"
+
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_AGE_BUCKETS
+#define TELEMETRY_AGE_BUCKETS 48 // half-octave buckets; the last one takes everything from ~12.6 s
+#endif
+
+class TelemetryStreamStats
+{
+public:
+    enum class Outcome : uint8_t
+    {
+        Sent,     ///< Handed to MQTT, the UDP link or a bundle
+        Buffered, ///< Kept in the MQTT outbox for later
+        Failed    ///< Given up by the TX task
+    };
+
+    struct Snapshot
+    {
+        uint32_t seq;             ///< Samples stamped so far (next sequence number)
+        uint32_t enqueue_drops;   ///< Refused or displaced by the TX class queue
+        uint32_t sent;
+        uint32_t buffered;
+        uint32_t tx_failures;     ///< Topic too long, MQTT refused, UDP send failed
+        uint32_t last_capture_us; ///< t_us of the newest sample handed off
+        // Capture -> hand-off, current window
+        uint32_t age_count;
+        uint32_t age_p50_us;
+        uint32_t age_p90_us;
+        uint32_t age_p99_us;
+        uint32_t age_max_us;
+    };
+
+    /// Take the next sequence number of @p id (0 for unregistered streams).
+    uint32_t stamp(TelemetryStreamId id)
+    {
+        return id < TELEMETRY_MAX_STREAMS ? _entries[id].seq.fetch_add(1, std::memory_order_relaxed) : 0;
+    }
+
+    /// The stamped sample was refused by, or later displaced from, the TX queue.
+    void enqueueDropped(TelemetryStreamId id)
+    {
+        if (id < TELEMETRY_MAX_STREAMS)
+            _entries[id].enqueueDrops.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// TX task: a sample captured at @p captureUs left the queue with @p outcome at @p nowUs.
+    void transmitted(TelemetryStreamId id, Outcome outcome, uint32_t captureUs, uint32_t nowUs);
+
+    /**
+     * @brief Counters (cumulative) and age percentiles (since the last reset) of @p id.
+     * @param resetAge Start a new age window.
+     */
+    Snapshot snapshot(TelemetryStreamId id, bool resetAge);
+
+    /// Bucket of an age in µs, and the largest age a bucket holds.
+    static size_t ageBucket(uint32_t us);
+    static uint32_t bucketUpperUs(size_t bucket);
+
+private:
+    struct Entry
+    {
+        std::atomic<uint32_t> seq{0};
+        std::atomic<uint32_t> enqueueDrops{0};
+        uint32_t sent{0};
+        uint32_t buffered{0};
+        uint32_t failed{0};
+        uint32_t lastCaptureUs{0};
+        uint32_t ageCount{0};
+        uint32_t ageMaxUs{0};
+        uint32_t ageHist[TELEMETRY_AGE_BUCKETS]{};
+    };
+
+    uint32_t percentile(const Entry &e, uint32_t permille) const;
+
+    Entry _entries[TELEMETRY_MAX_STREAMS];
+};
@@ -0,0 +1,41 @@
+#include "telemetry_topic_table.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+void TelemetryTopicTable::setPrefix(const char *deviceId)
+{
+    snprintf(_prefix, sizeof(_prefix), "%s", deviceId ? deviceId : "Drone");
+}
+
+TelemetryStreamId TelemetryTopicTable::add(const char *topicSuffix, bool fullTopic)
+{
+    if (!topicSuffix)
+        return TELEMETRY_STREAM_NONE;
+
+    // Registration happens from setup()/provider begin(), one at a time
+    const uint8_t n = _count.load(std::memory_order_relaxed);
+    for (uint8_t i = 0; i < n; ++i)
+    {
+        if (_entries[i].full == fullTopic && strcmp(_entries[i].suffix, topicSuffix) == 0)
+            return i;
+    }
+    if (n >= TELEMETRY_MAX_STREAMS)
+        return TELEMETRY_STREAM_NONE;
+
+    Entry &e = _entries[n];
+    if (!compose(topicSuffix, fullTopic, e.topic, sizeof(e.topic)))
+        return TELEMETRY_STREAM_NONE;
+    e.suffix = topicSuffix;
+    e.full = fullTopic;
+    _count.store(n + 1, std::memory_order_release);
+    return n;
+}
+
+const char *TelemetryTopicTable::compose(const char *topicSuffix, bool fullTopic, char *scratch, size_t cap) const
+{
+    const char *suffix = topicSuffix ? topicSuffix : "";
+    const int len = fullTopic ? snprintf(scratch, cap, "%s", suffix)
+                              : snprintf(scratch, cap, "%s/%s", _prefix, suffix);
+    return (len < 0 || (size_t)len >= cap) ? nullptr : scratch;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+/**
+ * @file telemetry_topic_table.hpp
+ * @brief Absolute MQTT topics for telemetry streams, resolved once at registration.
+ *
+ * Providers register each stream's topic suffix once and then tag samples with the
+ * returned stream ID; the TX task looks the full `<deviceId>/<suffix>` topic up by
+ * index instead of building a String per sample.
+ *
+ * Registration may run while the TX task is reading: entries are written before the
+ * count is published (release/acquire), and never change afterwards.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// ===== Tunables ===============================================================
+#ifndef TELEMETRY_MAX_STREAMS
+#define TELEMETRY_MAX_STREAMS 16
+#endif
+
+#ifndef TELEMETRY_TOPIC_MAX
+#define TELEMETRY_TOPIC_MAX 64 // incl. device prefix and NUL
+#endif
+
+using TelemetryStreamId = uint8_t;
+static constexpr TelemetryStreamId TELEMETRY_STREAM_NONE = 0xFF;
+
+class TelemetryTopicTable
+{
+public:
+    /// Device prefix for relative topics. Set before the first registration.
+    void setPrefix(const char *deviceId);
+
+    /**
+     * @brief Register a stream (idempotent: the same suffix returns the same ID).
+     * @param fullTopic Use @p topicSuffix as-is, without the device prefix
+     * @return Stream ID, or TELEMETRY_STREAM_NONE if the table is full or the topic too long.
+     */
+    TelemetryStreamId add(const char *topicSuffix, bool fullTopic = false);
+
+    /// @return Absolute topic for @p id, or nullptr for an unknown ID.
+    const char *topic(TelemetryStreamId id) const
+    {
+        return id < _count.load(std::memory_order_acquire) ? _entries[id].topic : nullptr;
+    }
+
+    /// @return The registered suffix (for routing decisions), or nullptr.
+    const char *suffix(TelemetryStreamId id) const
+    {
+        return id < _count.load(std::memory_order_acquire) ? _entries[id].suffix : nullptr;
+    }
+
+    /**
+     * @brief Build a topic for an unregistered sample into @p scratch (no heap).
+     * @return @p scratch, or nullptr if it doesn't fit.
+     */
+    const char *compose(const char *topicSuffix, bool fullTopic, char *scratch, size_t cap) const;
+
+    size_t size() const { return _count.load(std::memory_order_acquire); }
+
+private:
+    struct Entry
+    {
+        const char *suffix; // as registered (usually a literal owned by the provider)
+        bool full;
+        char topic[TELEMETRY_TOPIC_MAX];
+    };
+
+    Entry _entries[TELEMETRY_MAX_STREAMS]{};
+    std::atomic<uint8_t> _count{0};
+    char _prefix[TELEMETRY_TOPIC_MAX] = "Drone";
+};
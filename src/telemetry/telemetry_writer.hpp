@@ -0,0 +1,122 @@
+#pragma once
+
+/**
+ * @file telemetry_writer.hpp
+ * @brief One streaming writer for all TelemetryContentTypes.
+ *
+ * Forwards the JsonBufWriter call sequence to the JSON, CBOR, packed-binary or delta writer
+ * picked at construction, so a provider encodes its sample once and switches format
+ * by changing the content type it is configured with:
+ *
+ * @code
+ * TelemetryWriter w(_encoding, lease.data, lease.capacity, &kAttitudeSchema);
+ * w.beginObject(); w.key("roll"); w.value(roll); ... w.endObject();
+ * sample.meta.content_type = w.contentType();
+ * @endcode
+ *
+ * BINARY needs a PackedSchema (finalize() fails without one); DELTA needs the provider's
+ * DeltaEncoder, which carries the schema and the previous sample. TEXT is written as JSON.
+ */
+
+#include <new>
+#include <json_buffer_writer.hpp>
+#include "itelemetry_provider.hpp"
+#include "cbor_writer.hpp"
+#include "packed_writer.hpp"
+#include "delta_codec.hpp"
+
+class TelemetryWriter
+{
+public:
+    TelemetryWriter(TelemetryContentType type, uint8_t *buf, size_t cap, const PackedSchema *schema = nullptr,
+                    DeltaEncoder *delta = nullptr)
+        : _type(type == TelemetryContentType::TEXT ? TelemetryContentType::JSON : type)
+    {
+        switch (_type)
+        {
+        case TelemetryContentType::CBOR:
+            new (&_cbor) CborBufWriter(buf, cap);
+            break;
+        case TelemetryContentType::BINARY:
+            new (&_packed) PackedBufWriter(buf, cap, schema);
+            break;
+        case TelemetryContentType::DELTA:
+            new (&_delta) DeltaBufWriter(buf, cap, delta);
+            break;
+        default:
+            new (&_json) JsonBufWriter(buf, cap);
+            break;
+        }
+    }
+
+    ~TelemetryWriter()
+    {
+        switch (_type)
+        {
+        case TelemetryContentType::CBOR:
+            _cbor.~CborBufWriter();
+            break;
+        case TelemetryContentType::BINARY:
+            _packed.~PackedBufWriter();
+            break;
+        case TelemetryContentType::DELTA:
+            _delta.~DeltaBufWriter();
+            break;
+        default:
+            _json.~JsonBufWriter();
+            break;
+        }
+    }
+
+    TelemetryWriter(const TelemetryWriter &) = delete;
+    TelemetryWriter &operator=(const TelemetryWriter &) = delete;
+
+    /// Content type of the bytes produced (for TelemetryMeta::content_type).
+    TelemetryContentType contentType() const { return _type; }
+
+    void beginObject() { forward([](auto &w) { w.beginObject(); }); }
+    void endObject() { forward([](auto &w) { w.endObject(); }); }
+    void beginArray() { forward([](auto &w) { w.beginArray(); }); }
+    void endArray() { forward([](auto &w) { w.endArray(); }); }
+    void key(const char *k) { forward([k](auto &w) { w.key(k); }); }
+
+    template <typename T>
+    void value(T v) { forward([v](auto &w) { w.value(v); }); }
+
+    bool finalize(const uint8_t *&out, size_t &len)
+    {
+        bool ok = false;
+        forward([&](auto &w) { ok = w.finalize(out, len); });
+        return ok;
+    }
+
+private:
+    template <typename Fn>
+    void forward(Fn &&fn)
+    {
+        switch (_type)
+        {
+        case TelemetryContentType::CBOR:
+            fn(_cbor);
+            break;
+        case TelemetryContentType::BINARY:
+            fn(_packed);
+            break;
+        case TelemetryContentType::DELTA:
+            fn(_delta);
+            break;
+        default:
+            fn(_json);
+            break;
+        }
+    }
+
+    TelemetryContentType _type;
+    union
+    {
+        JsonBufWriter _json;
+        CborBufWriter _cbor;
+        PackedBufWriter _packed;
+        DeltaBufWriter _delta;
+    };
+};
@@ -0,0 +1,127 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "control/actuator_command.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+static uint8_t frame[ActuatorCommandDecoder::frameLength(ACTUATOR_CMD_MAX_CHANNELS)];
+
+void test_roundtrip_setpoints()
+{
+    ActuatorCommandDecoder dec;
+    ActuatorCommand cmd;
+    const float sp[3] = {-1.0f, 0.5f, 0.123f};
+    size_t n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 1, 1000, sp, 3);
+    TEST_ASSERT_EQUAL(ActuatorCommandDecoder::frameLength(3), n);
+
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 5000, cmd));
+    TEST_ASSERT_EQUAL(3, cmd.channel_count);
+    TEST_ASSERT_EQUAL_UINT32(1, cmd.seq);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f / 32767.0f, -1.0f, cmd.setpoint[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f / 32767.0f, 0.5f, cmd.setpoint[1]);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f / 32767.0f, 0.123f, cmd.setpoint[2]);
+}
+
+void test_malformed_frames_rejected_and_counted()
+{
+    ActuatorCommandDecoder dec;
+    ActuatorCommand cmd;
+    const float sp[2] = {0.0f, 0.0f};
+    size_t n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 1, 0, sp, 2);
+
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::BadLength, dec.decode(frame, n - 1, 0, cmd));
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::BadLength, dec.decode(frame, 4, 0, cmd));
+
+    frame[0] = ACTUATOR_CMD_VERSION + 1;
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::BadVersion, dec.decode(frame, n, 0, cmd));
+    frame[0] = ACTUATOR_CMD_VERSION;
+
+    frame[1] = 0;
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::BadChannels, dec.decode(frame, n, 0, cmd));
+
+    TEST_ASSERT_EQUAL_UINT32(2, dec.stats().bad_length);
+    TEST_ASSERT_EQUAL_UINT32(1, dec.stats().bad_version);
+    TEST_ASSERT_EQUAL_UINT32(1, dec.stats().bad_channels);
+    TEST_ASSERT_EQUAL_UINT32(0, dec.stats().accepted);
+}
+
+void test_out_of_order_and_duplicate_rejected()
+{
+    ActuatorCommandDecoder dec;
+    ActuatorCommand cmd;
+    const float sp[1] = {0.2f};
+    size_t n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 10, 100, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 150, cmd));
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::OutOfOrder, dec.decode(frame, n, 151, cmd)); // duplicate
+
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 9, 110, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::OutOfOrder, dec.decode(frame, n, 160, cmd));
+
+    // seq wraparound is still "newer"
+    dec.reset();
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 0xFFFFFFFFu, 200, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 250, cmd));
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 0, 210, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 260, cmd));
+    TEST_ASSERT_EQUAL_UINT32(2, dec.stats().out_of_order);
+}
+
+void test_stale_frames_rejected_relative_to_best_transit()
+{
+    ActuatorCommandDecoder dec(/*maxAgeMs*/ 50);
+    ActuatorCommand cmd;
+    const float sp[1] = {0.0f};
+
+    // Sender clock is 10 s behind ours; first frame establishes the offset
+    size_t n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 1, 0, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 10000, cmd));
+
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 2, 20, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 10040, cmd)); // 20 ms late
+
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 3, 40, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Stale, dec.decode(frame, n, 10200, cmd)); // 160 ms late
+    TEST_ASSERT_EQUAL_UINT32(1, dec.stats().stale);
+
+    // Resync flag re-seeds the offset after the sender's clock restarted
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 4, 0, sp, 1, ACTUATOR_CMD_FLAG_RESYNC);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 20000, cmd));
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 5, 30, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 20040, cmd)); // 10 ms late
+}
+
+void test_delayed_or_replayed_resync_rejected()
+{
+    ActuatorCommandDecoder dec(/*maxAgeMs*/ 50);
+    ActuatorCommand cmd;
+    const float sp[1] = {0.0f};
+    uint8_t resync[sizeof(frame)];
+
+    const size_t rn = ActuatorCommandDecoder::encode(resync, sizeof(resync), 1, 0, sp, 1, ACTUATOR_CMD_FLAG_RESYNC);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(resync, rn, 1000, cmd));
+    size_t n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 2, 20, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Ok, dec.decode(frame, n, 1020, cmd));
+
+    // The same resync frame again, 5 s later: not newer, not applied
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::OutOfOrder, dec.decode(resync, rn, 6000, cmd));
+
+    // ... and the envelope is untouched: a 160 ms late frame is still stale
+    n = ActuatorCommandDecoder::encode(frame, sizeof(frame), 3, 40, sp, 1);
+    TEST_ASSERT_EQUAL(ActuatorCommandStatus::Stale, dec.decode(frame, n, 1200, cmd));
+    TEST_ASSERT_EQUAL_UINT32(1, dec.stats().out_of_order);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    UNITY_BEGIN();
+    RUN_TEST(test_roundtrip_setpoints);
+    RUN_TEST(test_malformed_frames_rejected_and_counted);
+    RUN_TEST(test_out_of_order_and_duplicate_rejected);
+    RUN_TEST(test_stale_frames_rejected_relative_to_best_transit);
+    RUN_TEST(test_delayed_or_replayed_resync_rejected);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,101 @@
+// On-target benchmark: CPU cycles per AHRS update on the ESP32, against the Adafruit AHRS
+// Mahony it replaces in FIFO mode. Prints the share of one core the fusion takes at 1 kHz.
+#include <Arduino.h>
+#include <unity.h>
+#include <Adafruit_AHRS.h>
+#include "drivers/imu/ahrs_filter.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+static constexpr uint32_t kSamples = 1000;
+static constexpr float kDegPerRad = 57.2957795f;
+
+// A second of slow rotation at 1 kHz (computed once, outside the timed loops)
+static float gyro[kSamples][3], accel[kSamples][3], mag[kSamples][3];
+
+static void makeInputs()
+{
+    for (uint32_t n = 0; n < kSamples; ++n)
+    {
+        const float t = n / 1000.0f;
+        gyro[n][0] = 0.6f * cosf(2.0f * t);
+        gyro[n][1] = 0.3f * sinf(1.3f * t);
+        gyro[n][2] = 0.2f;
+        accel[n][0] = 300.0f * sinf(t);
+        accel[n][1] = -200.0f * cosf(0.7f * t);
+        accel[n][2] = 2000.0f;
+        mag[n][0] = 160.0f * cosf(0.2f * t);
+        mag[n][1] = 160.0f * sinf(0.2f * t);
+        mag[n][2] = -290.0f;
+    }
+}
+
+struct Result
+{
+    uint32_t cyclesPerUpdate;
+    float cpuPctAt1kHz;
+};
+
+template <typename F>
+static Result measure(F &&update)
+{
+    const uint32_t start = ESP.getCycleCount();
+    for (uint32_t n = 0; n < kSamples; ++n)
+        update(n);
+    const uint32_t cycles = (ESP.getCycleCount() - start) / kSamples;
+    const float cpuHz = getCpuFrequencyMhz() * 1e6f;
+    return {cycles, cycles * 1000.0f * 100.0f / cpuHz};
+}
+
+static void report(const char *name, const Result &r)
+{
+    char line[96];
+    snprintf(line, sizeof(line), "%-22s %6u cycles/update  %5.2f %% of a core at 1 kHz", name,
+             (unsigned)r.cyclesPerUpdate, r.cpuPctAt1kHz);
+    TEST_MESSAGE(line);
+}
+
+void test_cycles_per_update()
+{
+    makeInputs();
+    AhrsFilter mahony(AhrsAlgorithm::Mahony), madgwick(AhrsAlgorithm::Madgwick);
+    mahony.setSampleRate(1000.0f);
+    madgwick.setSampleRate(1000.0f);
+    Adafruit_Mahony adafruit;
+    adafruit.begin(1000.0f);
+
+    // Interrupts stay on: this is what the bus task gets, not a best case
+    const Result m9 = measure([&](uint32_t n) { mahony.update(gyro[n], accel[n], mag[n]); });
+    const Result m6 = measure([&](uint32_t n) { mahony.update(gyro[n], accel[n], nullptr); });
+    const Result g9 = measure([&](uint32_t n) { madgwick.update(gyro[n], accel[n], mag[n]); });
+    const Result g6 = measure([&](uint32_t n) { madgwick.update(gyro[n], accel[n], nullptr); });
+    const Result a6 = measure([&](uint32_t n) {
+        adafruit.updateIMU(gyro[n][0] * kDegPerRad, gyro[n][1] * kDegPerRad, gyro[n][2] * kDegPerRad, accel[n][0],
+                           accel[n][1], accel[n][2]);
+    });
+    float roll, pitch, yaw;
+    const Result euler = measure([&](uint32_t) { mahony.toEuler(roll, pitch, yaw); });
+
+    report("mahony 9-axis", m9);
+    report("mahony 6-axis", m6);
+    report("madgwick 9-axis", g9);
+    report("madgwick 6-axis", g6);
+    report("adafruit mahony 6-axis", a6);
+    report("toEuler (per publish)", euler);
+
+    // 1 kHz fusion must stay a small share of the bus task's core
+    TEST_ASSERT_LESS_THAN_UINT32(6000, m9.cyclesPerUpdate);
+    TEST_ASSERT_LESS_THAN_UINT32(6000, g9.cyclesPerUpdate);
+    TEST_ASSERT_TRUE(m6.cyclesPerUpdate <= a6.cyclesPerUpdate * 11 / 10);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    UNITY_BEGIN();
+    RUN_TEST(test_cycles_per_update);
+    UNITY_END();
+}
+
+void loop() {}
@@ -0,0 +1,101 @@
+// On-target test: the IMU calibration record in NVS (Adafruit_Sensor_Calibration's EEPROM
+// emulation). Round trip, a corrupted record refused by its CRC, and the time a boot spends
+// loading it. Puts back whatever calibration the board had.
+#include <Arduino.h>
+#include <unity.h>
+#include <EEPROM.h>
+#include <Adafruit_Sensor_Calibration.h>
+#include "drivers/imu/imu_calibration.hpp"
+
+void setUp() {}
+void tearDown() {}
+
+static Adafruit_Sensor_Calibration_EEPROM store;
+static bool hadStored = false;
+static Adafruit_Sensor_Calibration_EEPROM original;
+
+static void fill(Adafruit_Sensor_Calibration &c, float k)
+{
+    for (int a = 0; a < 3; ++a)
+    {
+        c.accel_zerog[a] = 0.1f * k * (a + 1);
+        c.gyro_zerorate[a] = -0.001f * k * (a + 1);
+        c.mag_hardiron[a] = 10.0f * k - a;
+    }
+    const ImuCalibrationData id = ImuCalibrationData::identity();
+    memcpy(c.mag_softiron, id.mag_softiron, sizeof(c.mag_softiron));
+    c.mag_softiron[0] = 1.05f;
+    c.mag_softiron[4] = 0.97f;
+    c.mag_field = 47.5f;
+}
+
+void test_round_trip()
+{
+    TEST_ASSERT_TRUE(store.begin());
+    fill(store, 2.0f);
+    TEST_ASSERT_TRUE(store.saveCalibration());
+
+    Adafruit_Sensor_Calibration_EEPROM loaded;
+    TEST_ASSERT_TRUE(loaded.begin());
+    TEST_ASSERT_TRUE(loaded.loadCalibration());
+    for (int a = 0; a < 3; ++a)
+    {
+        TEST_ASSERT_EQUAL_FLOAT(store.accel_zerog[a], loaded.accel_zerog[a]);
+        TEST_ASSERT_EQUAL_FLOAT(store.gyro_zerorate[a], loaded.gyro_zerorate[a]);
+        TEST_ASSERT_EQUAL_FLOAT(store.mag_hardiron[a], loaded.mag_hardiron[a]);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(1.05f, loaded.mag_softiron[0]);
+    TEST_ASSERT_EQUAL_FLOAT(0.97f, loaded.mag_softiron[4]);
+    TEST_ASSERT_EQUAL_FLOAT(47.5f, loaded.mag_field);
+}
+
+void test_boot_load_time()
+{
+    // What IMU_MPU9250::begin() pays: open the NVS blob, check the CRC, copy the fields
+    EEPROM.end();
+    const uint32_t t0 = micros();
+    Adafruit_Sensor_Calibration_EEPROM boot;
+    const bool ok = boot.begin() && boot.loadCalibration();
+    const uint32_t cold = micros() - t0;
+    const uint32_t t1 = micros();
+    const bool again = boot.loadCalibration();
+    const uint32_t warm = micros() - t1;
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_TRUE(again);
+
+    char line[96];
+    snprintf(line, sizeof(line), "load: %u us from NVS (boot), %u us from the RAM copy", (unsigned)cold, (unsigned)warm);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_LESS_THAN_UINT32(5000, cold);
+}
+
+void test_corrupted_record_is_refused()
+{
+    TEST_ASSERT_TRUE(store.begin());
+    fill(store, 3.0f);
+    TEST_ASSERT_TRUE(store.saveCalibration());
+
+    EEPROM.write(10, EEPROM.read(10) ^ 0x40); // a bit in accel_zerog
+    EEPROM.commit();
+    Adafruit_Sensor_Calibration_EEPROM loaded;
+    TEST_ASSERT_TRUE(loaded.begin());
+    TEST_ASSERT_FALSE(loaded.loadCalibration());
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    original.begin();
+    hadStored = original.loadCalibration();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_boot_load_time);
+    RUN_TEST(test_corrupted_record_is_refused);
+    UNITY_END();
+
+    if (hadStored)
+        original.saveCalibration();
+}
+
+void loop() {}
@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <unity.h>
+#include "services/mqtt_outbox.hpp"
+
+using MqttService::MqttOutbox;
+using MqttService::OfflinePolicy;
+
+void setUp() {}
+void tearDown() {}
+
+static bool put(MqttOutbox &ob, const char *topic, const char *payload, OfflinePolicy p)
+{
+    return ob.put(topic, reinterpret_cast<const uint8_t *>(payload), strlen(payload), 0, false, p);
+}
+
+static bool pop(MqttOutbox &ob, MqttOutbox::Entry &e)
+{
+    MqttOutbox::Token tok;
+    if (!ob.front(e, tok))
+        return false;
+    ob.commit(tok);
+    return true;
+}
+
+void test_drop_policy_is_not_stored()
+{
+    static MqttOutbox ob;
+    TEST_ASSERT_FALSE(put(ob, "d/log/INFO", "x", OfflinePolicy::Drop));
+    TEST_ASSERT_TRUE(ob.empty());
+    TEST_ASSERT_EQUAL_UINT32(1, ob.stats().rejected);
+}
+
+void test_coalesce_keeps_latest_per_topic()
+{
+    static MqttOutbox ob;
+    static MqttOutbox::Entry e;
+    TEST_ASSERT_TRUE(put(ob, "d/telemetry/imu", "1", OfflinePolicy::Coalesce));
+    TEST_ASSERT_TRUE(put(ob, "d/telemetry/imu", "2", OfflinePolicy::Coalesce));
+    TEST_ASSERT_TRUE(put(ob, "d/status", "up", OfflinePolicy::Coalesce));
+    TEST_ASSERT_TRUE(put(ob, "d/telemetry/imu", "3", OfflinePolicy::Coalesce));
+
+    TEST_ASSERT_TRUE(pop(ob, e));
+    TEST_ASSERT_EQUAL_STRING("d/status", e.topic);
+    TEST_ASSERT_TRUE(pop(ob, e));
+    TEST_ASSERT_EQUAL_STRING("d/telemetry/imu", e.topic);
+    TEST_ASSERT_EQUAL(1, e.len);
+    TEST_ASSERT_EQUAL('3', e.payload[0]);
+    TEST_ASSERT_FALSE(pop(ob, e));
+    TEST_ASSERT_EQUAL_UINT32(2, ob.stats().replaced);
+}
+
+void test_commit_keeps_value_replaced_while_sending()
+{
+    static MqttOutbox ob;
+    static MqttOutbox::Entry e;
+    MqttOutbox::Token tok;
+    put(ob, "d/telemetry/imu", "old", OfflinePolicy::Coalesce);
+    TEST_ASSERT_TRUE(ob.front(e, tok));
+    put(ob, "d/telemetry/imu", "new", OfflinePolicy::Coalesce); // arrives mid-send
+    ob.commit(tok);
+
+    TEST_ASSERT_TRUE(pop(ob, e));
+    TEST_ASSERT_EQUAL_MEMORY("new", e.payload, 3);
+}
+
+void test_fifo_order_and_oldest_eviction()
+{
+    static MqttOutbox ob;
+    static MqttOutbox::Entry e;
+    static char payload[MQTT_OUTBOX_PAYLOAD_MAX];
+    memset(payload, 'p', sizeof(payload) - 1);
+    payload[sizeof(payload) - 1] = '\0';
+
+    // Fill well past capacity; early records must be evicted, order preserved
+    const int n = (MQTT_OUTBOX_FIFO_BYTES / MQTT_OUTBOX_PAYLOAD_MAX) * 2;
+    char topic[32];
+    for (int i = 0; i < n; ++i)
+    {
+        snprintf(topic, sizeof(topic), "d/log/%d", i);
+        TEST_ASSERT_TRUE(put(ob, topic, payload, OfflinePolicy::Fifo));
+    }
+    TEST_ASSERT_TRUE(ob.stats().evicted > 0);
+
+    int last = -1;
+    int count = 0;
+    while (pop(ob, e))
+    {
+        int idx = atoi(e.topic + strlen("d/log/"));
+        TEST_ASSERT_TRUE(idx > last);
+        last = idx;
+        count++;
+    }
+    TEST_ASSERT_EQUAL(n - 1, last); // newest survived
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)n, (uint32_t)count + ob.stats().evicted);
+}
+
+void test_oversize_payload_rejected()
+{
+    static MqttOutbox ob;
+    static uint8_t big[MQTT_OUTBOX_PAYLOAD_MAX + 1] = {};
+    TEST_ASSERT_FALSE(ob.put("d/log/INFO", big, sizeof(big), 0, false, OfflinePolicy::Fifo));
+    TEST_ASSERT_TRUE(ob.empty());
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    UNITY_BEGIN();
+    RUN_TEST(test_drop_policy_is_not_stored);
+    RUN_TEST(test_coalesce_keeps_latest_per_topic);
+    RUN_TEST(test_commit_keeps_value_replaced_while_sending);
+    RUN_TEST(test_fifo_order_and_oldest_eviction);
+    RUN_TEST(test_oversize_payload_rejected);
+    UNITY_END();
+}
+
+void loop() {}
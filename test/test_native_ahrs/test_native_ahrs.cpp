@@ -0,0 +1,379 @@
+// Host-side tests for the AHRS filter: fast inverse square root error, attitude accuracy on a
+// recorded-style 1 kHz int16 stream of a known trajectory, the float kernel against a double
+// precision reference, and time per update.
+// Run with: pio test -e native -f test_native_ahrs -v
+#include <unity.h>
+#include "drivers/imu/ahrs_filter.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+void setUp() {}
+void tearDown() {}
+
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kDegToRad = kPi / 180.0;
+
+// Scales of the MPU9250 FIFO setup (±16 g, ±2000 deg/s) and the AK8963 (0.15 µT/LSB)
+static constexpr double kAccelLsbPerG = 2048.0;
+static constexpr double kGyroLsbPerDps = 16.4;
+static constexpr double kMagLsbPerUt = 1.0 / 0.15;
+static constexpr float kGyroRadPerLsb = (float)(kDegToRad / kGyroLsbPerDps);
+
+struct Quat
+{
+    double w, x, y, z;
+};
+
+static Quat mul(const Quat &a, const Quat &b)
+{
+    return {a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+            a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x, a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w};
+}
+
+// Earth -> sensor: v_s = q* v_e q
+static void toSensor(const Quat &q, const double e[3], double s[3])
+{
+    const Quat v{0, e[0], e[1], e[2]};
+    const Quat r = mul(mul(Quat{q.w, -q.x, -q.y, -q.z}, v), q);
+    s[0] = r.x;
+    s[1] = r.y;
+    s[2] = r.z;
+}
+
+static Quat fromEuler(double roll, double pitch, double yaw)
+{
+    const double cr = cos(roll / 2), sr = sin(roll / 2), cp = cos(pitch / 2), sp = sin(pitch / 2);
+    const double cy = cos(yaw / 2), sy = sin(yaw / 2);
+    return {cr * cp * cy + sr * sp * sy, sr * cp * cy - cr * sp * sy, cr * sp * cy + sr * cp * sy,
+            cr * cp * sy - sr * sp * cy};
+}
+
+// Angle between two attitudes, degrees (atan2, not acos: acos of a dot product near 1
+// turns a 1e-6 norm error into a tenth of a degree)
+static double angleDeg(const Quat &a, const AhrsQuaternion &b)
+{
+    const Quat d = mul(Quat{a.w, -a.x, -a.y, -a.z}, Quat{b.w, b.x, b.y, b.z});
+    return 2.0 * atan2(sqrt(d.x * d.x + d.y * d.y + d.z * d.z), fabs(d.w)) / kDegToRad;
+}
+
+// Tilt error only (roll/pitch), degrees: angle between the gravity directions
+static double tiltDeg(const Quat &a, const AhrsQuaternion &b)
+{
+    const double up[3] = {0, 0, 1};
+    double sa[3], sb[3];
+    toSensor(a, up, sa);
+    toSensor(Quat{b.w, b.x, b.y, b.z}, up, sb);
+    const double cx = sa[1] * sb[2] - sa[2] * sb[1], cy = sa[2] * sb[0] - sa[0] * sb[2], cz = sa[0] * sb[1] - sa[1] * sb[0];
+    return atan2(sqrt(cx * cx + cy * cy + cz * cz), sa[0] * sb[0] + sa[1] * sb[1] + sa[2] * sb[2]) / kDegToRad;
+}
+
+// A flight-like recording: roll ±35°, pitch ±20°, yaw sweeping 0..±90° at different rates,
+// 1 kHz, as int16 counts with noise, a 0.5 deg/s gyro bias and the earth's field at 60°
+// inclination. Truth is kept alongside.
+struct Recording
+{
+    static constexpr uint32_t kHz = 1000;
+    uint32_t seed{1};
+
+    double noise(double sigma)
+    {
+        // Sum of uniforms ~ gaussian, deterministic
+        double s = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            s += (seed >> 8) / 16777216.0 - 0.5;
+        }
+        return s * sigma * 1.732;
+    }
+
+    static Quat truth(double t)
+    {
+        return fromEuler(35 * kDegToRad * sin(2 * kPi * 0.3 * t), 20 * kDegToRad * sin(2 * kPi * 0.17 * t + 1),
+                         90 * kDegToRad * sin(2 * kPi * 0.05 * t));
+    }
+
+    static int16_t sat(double v) { return (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : lround(v)); }
+
+    // Sample n: counts for accel, gyro, mag
+    void sample(uint32_t n, int16_t acc[3], int16_t gyr[3], int16_t mag[3])
+    {
+        const double dt = 1.0 / kHz;
+        const double t = n * dt;
+        const Quat q = truth(t);
+        // Body rate: 2 q* dq/dt, central difference
+        const Quat qa = truth(t - dt / 2), qb = truth(t + dt / 2);
+        const Quat dq{(qb.w - qa.w) / dt, (qb.x - qa.x) / dt, (qb.y - qa.y) / dt, (qb.z - qa.z) / dt};
+        const Quat w = mul(Quat{q.w, -q.x, -q.y, -q.z}, dq);
+        const double up[3] = {0, 0, 1};
+        const double field[3] = {25 * cos(60 * kDegToRad), 0, -50 * sin(60 * kDegToRad)}; // µT, z up
+        double a[3], m[3];
+        toSensor(q, up, a);
+        toSensor(q, field, m);
+        for (int i = 0; i < 3; ++i)
+        {
+            acc[i] = sat((a[i] + noise(0.01)) * kAccelLsbPerG);
+            gyr[i] = sat((2 * (&w.x)[i] / kDegToRad + 0.5 + noise(0.1)) * kGyroLsbPerDps);
+            mag[i] = sat((m[i] + noise(0.4)) * kMagLsbPerUt);
+        }
+    }
+};
+
+struct Accuracy
+{
+    double maxDeg;     ///< After convergence
+    double rmsDeg;
+    double maxTiltDeg;
+    double convergeS;  ///< First time under 2° (from a 0° start vs. truth)
+};
+
+static Accuracy run(AhrsAlgorithm algo, bool withMag, uint32_t seconds)
+{
+    AhrsFilter f(algo);
+    f.setSampleRate((float)Recording::kHz);
+    Recording rec;
+    Accuracy acc{0, 0, 0, -1};
+    double sumSq = 0;
+    uint32_t count = 0;
+    for (uint32_t n = 0; n < seconds * Recording::kHz; ++n)
+    {
+        int16_t a[3], g[3], m[3];
+        rec.sample(n, a, g, m);
+        const float gyro[3] = {g[0] * kGyroRadPerLsb, g[1] * kGyroRadPerLsb, g[2] * kGyroRadPerLsb};
+        const float accel[3] = {(float)a[0], (float)a[1], (float)a[2]};
+        const float mag[3] = {(float)m[0], (float)m[1], (float)m[2]};
+        f.update(gyro, accel, withMag ? mag : nullptr);
+
+        const Quat q = Recording::truth(n / (double)Recording::kHz);
+        const double err = angleDeg(q, f.quaternion());
+        const double tilt = tiltDeg(q, f.quaternion());
+        if (acc.convergeS < 0 && err < 2.0)
+            acc.convergeS = n / (double)Recording::kHz;
+        if (n >= 10 * Recording::kHz) // after 10 s
+        {
+            if (err > acc.maxDeg)
+                acc.maxDeg = err;
+            if (tilt > acc.maxTiltDeg)
+                acc.maxTiltDeg = tilt;
+            sumSq += err * err;
+            count++;
+        }
+    }
+    acc.rmsDeg = count ? sqrt(sumSq / count) : 0;
+    return acc;
+}
+
+void test_inv_sqrt_error()
+{
+    double worst = 0;
+    for (float x = 1e-3f; x < 1e4f; x *= 1.01f)
+    {
+        const double exact = 1.0 / sqrt((double)x);
+        const double rel = fabs(AhrsFilter::invSqrt(x) - exact) / exact;
+        if (rel > worst)
+            worst = rel;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "invSqrt max relative error %.4f %%", worst * 100);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(worst < 0.0018);
+}
+
+void test_attitude_accuracy_on_recorded_stream()
+{
+    struct Case
+    {
+        const char *name;
+        AhrsAlgorithm algo;
+        bool mag;
+    } cases[] = {
+        {"mahony 9-axis", AhrsAlgorithm::Mahony, true},
+        {"mahony 6-axis", AhrsAlgorithm::Mahony, false},
+        {"madgwick 9-axis", AhrsAlgorithm::Madgwick, true},
+        {"madgwick 6-axis", AhrsAlgorithm::Madgwick, false},
+    };
+    TEST_MESSAGE("filter            max deg   rms deg   tilt max deg   converged s");
+    for (const Case &c : cases)
+    {
+        const Accuracy a = run(c.algo, c.mag, 60);
+        char line[96];
+        snprintf(line, sizeof(line), "%-16s %8.2f  %8.2f  %13.2f  %12.2f", c.name, a.maxDeg, a.rmsDeg, a.maxTiltDeg,
+                 a.convergeS);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_TRUE_MESSAGE(a.maxTiltDeg < 1.5, c.name); // roll/pitch: gravity always corrects
+        if (c.mag)
+        {
+            // Heading too, within what the 0.5 deg/s gyro bias leaves (no gyro calibration here)
+            TEST_ASSERT_TRUE_MESSAGE(a.maxDeg < 5.0, c.name);
+            TEST_ASSERT_TRUE_MESSAGE(a.rmsDeg < 3.5, c.name);
+            TEST_ASSERT_TRUE_MESSAGE(a.convergeS >= 0 && a.convergeS < 5.0, c.name);
+        }
+    }
+}
+
+void test_converges_from_a_wrong_start()
+{
+    // At rest, tilted 60° in roll, then level, then turned 90°: the gains pull it over
+    // (Madgwick's step is bounded by beta, hence the long settling times)
+    const AhrsAlgorithm algos[] = {AhrsAlgorithm::Mahony, AhrsAlgorithm::Madgwick};
+    for (AhrsAlgorithm algo : algos)
+    {
+        AhrsFilter f(algo);
+        f.setSampleRate(1000.0f);
+        f.setMahonyGains(AHRS_MAHONY_KP, 0.0f); // no bias to learn, and the integral only adds overshoot
+        const float gyro[3] = {0, 0, 0};
+        const float tilted[3] = {0, 1774, 1024}; // roll 60°: gravity in y-z
+        const float level[3] = {0, 0, 2048};
+        float roll, pitch, yaw;
+        for (int i = 0; i < 20000; ++i)
+            f.update(gyro, tilted, nullptr);
+        f.toEuler(roll, pitch, yaw);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 60.0f, roll);
+        for (int i = 0; i < 20000; ++i)
+            f.update(gyro, level, nullptr);
+        f.toEuler(roll, pitch, yaw);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, roll);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, pitch);
+
+        // Field 90° off the sensor's x axis, 60° inclination: only its horizontal half turns
+        // the heading, so this is the slow one
+        f.reset();
+        const float mag[3] = {0, -167, -289};
+        for (int i = 0; i < 60000; ++i)
+            f.update(gyro, level, mag);
+        f.toEuler(roll, pitch, yaw);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 90.0f, yaw);
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, roll);
+    }
+}
+
+// Mahony as published (double, libm sqrt), for the cost of single precision + fast invSqrt
+struct MahonyRef
+{
+    double q0{1}, q1{0}, q2{0}, q3{0};
+    double twoKp{2.0 * AHRS_MAHONY_KP};
+    double twoKi{2.0 * AHRS_MAHONY_KI};
+    double ix{0}, iy{0}, iz{0};
+    double dt{0.001};
+
+    void update(double gx, double gy, double gz, double ax, double ay, double az, double mx, double my, double mz)
+    {
+        double r = 1.0 / sqrt(ax * ax + ay * ay + az * az);
+        ax *= r, ay *= r, az *= r;
+        r = 1.0 / sqrt(mx * mx + my * my + mz * mz);
+        mx *= r, my *= r, mz *= r;
+        const double q0q0 = q0 * q0, q0q1 = q0 * q1, q0q2 = q0 * q2, q0q3 = q0 * q3, q1q1 = q1 * q1;
+        const double q1q2 = q1 * q2, q1q3 = q1 * q3, q2q2 = q2 * q2, q2q3 = q2 * q3, q3q3 = q3 * q3;
+        const double hx = 2 * (mx * (0.5 - q2q2 - q3q3) + my * (q1q2 - q0q3) + mz * (q1q3 + q0q2));
+        const double hy = 2 * (mx * (q1q2 + q0q3) + my * (0.5 - q1q1 - q3q3) + mz * (q2q3 - q0q1));
+        const double bx = sqrt(hx * hx + hy * hy);
+        const double bz = 2 * (mx * (q1q3 - q0q2) + my * (q2q3 + q0q1) + mz * (0.5 - q1q1 - q2q2));
+        const double vx = q1q3 - q0q2, vy = q0q1 + q2q3, vz = q0q0 - 0.5 + q3q3;
+        const double wx = bx * (0.5 - q2q2 - q3q3) + bz * (q1q3 - q0q2);
+        const double wy = bx * (q1q2 - q0q3) + bz * (q0q1 + q2q3);
+        const double wz = bx * (q0q2 + q1q3) + bz * (0.5 - q1q1 - q2q2);
+        const double ex = (ay * vz - az * vy) + (my * wz - mz * wy);
+        const double ey = (az * vx - ax * vz) + (mz * wx - mx * wz);
+        const double ez = (ax * vy - ay * vx) + (mx * wy - my * wx);
+        ix += twoKi * ex * dt, iy += twoKi * ey * dt, iz += twoKi * ez * dt;
+        gx += twoKp * ex + ix;
+        gy += twoKp * ey + iy;
+        gz += twoKp * ez + iz;
+        gx *= 0.5 * dt, gy *= 0.5 * dt, gz *= 0.5 * dt;
+        const double a = q0, b = q1, c = q2;
+        q0 += -b * gx - c * gy - q3 * gz;
+        q1 += a * gx + c * gz - q3 * gy;
+        q2 += a * gy - b * gz + q3 * gx;
+        q3 += a * gz + b * gy - c * gx;
+        r = 1.0 / sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+        q0 *= r, q1 *= r, q2 *= r, q3 *= r;
+    }
+};
+
+void test_single_precision_kernel_matches_double_reference()
+{
+    AhrsFilter f(AhrsAlgorithm::Mahony);
+    f.setSampleRate(1000.0f);
+    MahonyRef ref;
+    Recording rec;
+    double worst = 0;
+    for (uint32_t n = 0; n < 60 * Recording::kHz; ++n)
+    {
+        int16_t a[3], g[3], m[3];
+        rec.sample(n, a, g, m);
+        const float gyro[3] = {g[0] * kGyroRadPerLsb, g[1] * kGyroRadPerLsb, g[2] * kGyroRadPerLsb};
+        const float accel[3] = {(float)a[0], (float)a[1], (float)a[2]};
+        const float mag[3] = {(float)m[0], (float)m[1], (float)m[2]};
+        f.update(gyro, accel, mag);
+        const double k = kDegToRad / kGyroLsbPerDps;
+        ref.update(g[0] * k, g[1] * k, g[2] * k, a[0], a[1], a[2], m[0], m[1], m[2]);
+        const double d = angleDeg(Quat{ref.q0, ref.q1, ref.q2, ref.q3}, f.quaternion());
+        if (d > worst)
+            worst = d;
+    }
+    char line[80];
+    snprintf(line, sizeof(line), "float + invSqrt vs double reference, 60 s at 1 kHz: max %.4f deg", worst);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(worst < 0.05);
+}
+
+void test_time_per_update()
+{
+    // Inputs precomputed so only the kernel is timed
+    static float gyro[1000][3], accel[1000][3], mag[1000][3];
+    Recording rec;
+    for (uint32_t n = 0; n < 1000; ++n)
+    {
+        int16_t a[3], g[3], m[3];
+        rec.sample(n, a, g, m);
+        for (int i = 0; i < 3; ++i)
+        {
+            gyro[n][i] = g[i] * kGyroRadPerLsb;
+            accel[n][i] = a[i];
+            mag[n][i] = m[i];
+        }
+    }
+
+    TEST_MESSAGE("filter            ns/update   host CPU % at 1 kHz");
+    const struct
+    {
+        const char *name;
+        AhrsAlgorithm algo;
+        bool mag;
+    } cases[] = {
+        {"mahony 9-axis", AhrsAlgorithm::Mahony, true},
+        {"mahony 6-axis", AhrsAlgorithm::Mahony, false},
+        {"madgwick 9-axis", AhrsAlgorithm::Madgwick, true},
+        {"madgwick 6-axis", AhrsAlgorithm::Madgwick, false},
+    };
+    for (const auto &c : cases)
+    {
+        AhrsFilter f(c.algo);
+        f.setSampleRate(1000.0f);
+        const uint32_t rounds = 2000;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (uint32_t r = 0; r < rounds; ++r)
+            for (uint32_t n = 0; n < 1000; ++n)
+                f.update(gyro[n], accel[n], c.mag ? mag[n] : nullptr);
+        const auto t1 = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (rounds * 1000.0);
+        char line[80];
+        snprintf(line, sizeof(line), "%-16s %10.1f   %8.4f", c.name, ns, ns * 1000 / 1e7);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_TRUE(f.quaternion().w == f.quaternion().w); // keep the loop, no NaN
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_inv_sqrt_error);
+    RUN_TEST(test_attitude_accuracy_on_recorded_stream);
+    RUN_TEST(test_converges_from_a_wrong_start);
+    RUN_TEST(test_single_precision_kernel_matches_double_reference);
+    RUN_TEST(test_time_per_update);
+    return UNITY_END();
+}
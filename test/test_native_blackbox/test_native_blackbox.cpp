@@ -0,0 +1,264 @@
+// Host-side tests for the blackbox log: staging blocks, the file-backed flash stand-in and
+// the reader, incl. a full-rate recording with a writer that stalls like a flash erase.
+// Run with: pio test -e native -f test_native_blackbox -v
+#include <unity.h>
+#include "telemetry/blackbox_log.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+static const PackedField kAttitudeFields[] = {
+    {"roll", PackedType::I16, 100.0f},
+    {"pitch", PackedType::I16, 100.0f},
+    {"yaw", PackedType::I16, 100.0f},
+};
+static const PackedSchema kAttitude{1, kAttitudeFields, 3};
+
+static const PackedField kControlFields[] = {
+    {"motor", PackedType::I16, 10000.0f},
+    {"servo", PackedType::U16, 10000.0f},
+};
+static const PackedSchema kControl{2, kControlFields, 2};
+
+static size_t encode(const PackedSchema &s, const float *v, uint8_t *out)
+{
+    PackedBufWriter w(out, 32, &s);
+    w.beginObject();
+    for (uint8_t i = 0; i < s.count; ++i)
+    {
+        w.key(s.fields[i].name);
+        w.value(v[i]);
+    }
+    w.endObject();
+    const uint8_t *p;
+    size_t n = 0;
+    w.finalize(p, n);
+    return n;
+}
+
+static std::vector<uint8_t> readAll(FileBlackboxStorage &fs, const char *name)
+{
+    std::vector<uint8_t> out;
+    uint8_t buf[1000];
+    size_t n;
+    while ((n = fs.read(name, out.size(), buf, sizeof(buf))) > 0)
+        out.insert(out.end(), buf, buf + n);
+    return out;
+}
+
+// Writer side, like BlackboxService::writeSealed()
+static void writeSealed(BlackboxStager &st, IBlackboxStorage &fs)
+{
+    while (const uint8_t *b = st.front())
+    {
+        TEST_ASSERT_TRUE(fs.append(b, BLACKBOX_BLOCK_SIZE));
+        st.pop();
+    }
+}
+
+void test_frames_never_span_blocks()
+{
+    static BlackboxStager st;
+    st.reset();
+    uint8_t payload[BLACKBOX_FRAME_MAX + 1] = {};
+    TEST_ASSERT_FALSE(st.append(0, payload, sizeof(payload)));
+    TEST_ASSERT_EQUAL_UINT32(1, st.stats().too_large);
+
+    // 4084 usable bytes per block, 5 + 45 per frame: 81 frames, the 82nd opens block 2
+    for (int i = 0; i < 82; ++i)
+        TEST_ASSERT_TRUE(st.append(i, payload, 45));
+    TEST_ASSERT_EQUAL_size_t(1, st.sealed());
+
+    const uint8_t *b = st.front();
+    TEST_ASSERT_EQUAL_UINT16(12 + 81 * 50, b[8] | (b[9] << 8));
+    TEST_ASSERT_EQUAL_UINT16(81, b[10] | (b[11] << 8));
+    TEST_ASSERT_EQUAL_UINT8(0, b[BLACKBOX_BLOCK_SIZE - 1]); // zero padding
+
+    // No free block: the producer drops instead of waiting
+    for (int i = 0; i < 82 * (BLACKBOX_STAGING_BLOCKS - 1); ++i)
+        st.append(i, payload, 45);
+    TEST_ASSERT_EQUAL_size_t(BLACKBOX_STAGING_BLOCKS - 1, st.sealed());
+    TEST_ASSERT_TRUE(st.stats().dropped > 0);
+    TEST_ASSERT_FALSE(st.seal());
+}
+
+void test_schema_frame_and_reader_round_trip()
+{
+    char dir[] = "/tmp/bbtestXXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    FileBlackboxStorage fs(dir);
+    TEST_ASSERT_TRUE(fs.begin());
+    TEST_ASSERT_TRUE(fs.create("0001.bbl"));
+
+    static BlackboxStager st;
+    st.reset();
+    uint8_t def[BLACKBOX_FRAME_MAX];
+    const size_t n = blackboxSchemaFrame(kAttitude, "imu", def, sizeof(def));
+    TEST_ASSERT_EQUAL_size_t(3 + (1 + 3) + 3 * (1 + 4 + 1) + 4 + 5 + 3, n); // header, "imu", 3 fields + names
+    st.append(0, def, n);
+
+    uint8_t buf[32];
+    const float v[3] = {1.25f, -45.5f, 179.99f};
+    st.append(1000, buf, encode(kAttitude, v, buf));
+    TEST_ASSERT_TRUE(st.seal());
+    writeSealed(st, fs);
+    fs.close();
+
+    const std::vector<uint8_t> log = readAll(fs, "0001.bbl");
+    TEST_ASSERT_EQUAL_size_t(BLACKBOX_BLOCK_SIZE, log.size());
+
+    BlackboxReader r(log.data(), log.size());
+    uint32_t t;
+    const uint8_t *p;
+    size_t len;
+    TEST_ASSERT_TRUE(r.next(t, p, len));
+    TEST_ASSERT_EQUAL_UINT8(BLACKBOX_SCHEMA_DEF, p[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, p[1]);
+    TEST_ASSERT_EQUAL_STRING_LEN("imu", (const char *)p + 4, 3);
+    TEST_ASSERT_TRUE(r.next(t, p, len));
+    TEST_ASSERT_EQUAL_UINT32(1000, t);
+    double out[3];
+    TEST_ASSERT_TRUE(packedDecode(kAttitude, p, len, out));
+    TEST_ASSERT_TRUE(out[1] > -45.51 && out[1] < -45.49);
+    TEST_ASSERT_FALSE(r.next(t, p, len));
+
+    char name[32];
+    size_t size = 0;
+    TEST_ASSERT_TRUE(fs.entry(0, name, sizeof(name), size));
+    TEST_ASSERT_EQUAL_STRING("0001.bbl", name);
+    TEST_ASSERT_EQUAL_size_t(BLACKBOX_BLOCK_SIZE, size);
+    TEST_ASSERT_FALSE(fs.entry(1, name, sizeof(name), size));
+    TEST_ASSERT_TRUE(fs.remove("0001.bbl"));
+    remove(dir);
+}
+
+void test_reader_skips_bad_and_counts_lost_blocks()
+{
+    static BlackboxStager st;
+    st.reset();
+    std::vector<uint8_t> log;
+    uint8_t payload[40] = {7};
+    for (int blk = 0; blk < 3; ++blk)
+    {
+        st.append(blk, payload, sizeof(payload));
+        st.seal();
+        log.insert(log.end(), st.front(), st.front() + BLACKBOX_BLOCK_SIZE);
+        st.pop();
+    }
+    // Blocks 0 and 2 (1 lost), then a block with a broken magic
+    std::vector<uint8_t> damaged(log.begin(), log.begin() + BLACKBOX_BLOCK_SIZE);
+    damaged.insert(damaged.end(), log.begin() + 2 * BLACKBOX_BLOCK_SIZE, log.end());
+    damaged.insert(damaged.end(), log.begin(), log.begin() + BLACKBOX_BLOCK_SIZE);
+    damaged[2 * BLACKBOX_BLOCK_SIZE] ^= 0xff;
+
+    BlackboxReader r(damaged.data(), damaged.size());
+    uint32_t t;
+    const uint8_t *p;
+    size_t len, frames = 0;
+    while (r.next(t, p, len))
+        frames++;
+    TEST_ASSERT_EQUAL_size_t(2, frames);
+    TEST_ASSERT_EQUAL_UINT32(1, r.lostBlocks());
+    TEST_ASSERT_EQUAL_UINT32(1, r.badBlocks());
+}
+
+// ===== Full-rate recording ====================================================
+// IMU attitude at 1 kHz and control setpoints at 2 kHz for 10 s (~32 kB/s). The writer
+// appends one sector every 2 ms, but stalls for stallMs once (LittleFS erasing/compacting).
+static void recordRun(uint32_t stallMs, uint32_t &frames, uint32_t &dropped, uint32_t &highWater)
+{
+    char dir[] = "/tmp/bbtestXXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    FileBlackboxStorage fs(dir);
+    fs.begin();
+    fs.create("0001.bbl");
+
+    static BlackboxStager st;
+    st.reset();
+    uint8_t def[BLACKBOX_FRAME_MAX];
+    st.append(0, def, blackboxSchemaFrame(kAttitude, "imu", def, sizeof(def)));
+    st.append(0, def, blackboxSchemaFrame(kControl, "control", def, sizeof(def)));
+
+    uint32_t produced = 2;
+    uint32_t writerBusyUntil = 0;
+    uint8_t buf[32];
+    for (uint32_t us = 0; us < 10000000; us += 500)
+    {
+        const float ctl[2] = {0.5f * (float)((us / 100000) % 3) - 0.5f, 0.5f};
+        st.append(us, buf, encode(kControl, ctl, buf));
+        produced++;
+        if (us % 1000 == 0)
+        {
+            const float att[3] = {us * 1e-5f, 0.0f, -us * 1e-5f};
+            st.append(us, buf, encode(kAttitude, att, buf));
+            produced++;
+        }
+
+        const bool stalled = us >= 3000000 && us < 3000000 + stallMs * 1000;
+        if (!stalled && us >= writerBusyUntil && st.front())
+        {
+            fs.append(st.front(), BLACKBOX_BLOCK_SIZE);
+            st.pop();
+            writerBusyUntil = us + 2000;
+        }
+    }
+    st.seal();
+    writeSealed(st, fs);
+    fs.close();
+
+    const std::vector<uint8_t> log = readAll(fs, "0001.bbl");
+    TEST_ASSERT_EQUAL_size_t(0, log.size() % BLACKBOX_BLOCK_SIZE); // sector-aligned appends only
+
+    BlackboxReader r(log.data(), log.size());
+    uint32_t t, last = 0;
+    const uint8_t *p;
+    size_t len;
+    frames = 0;
+    while (r.next(t, p, len))
+    {
+        TEST_ASSERT_TRUE(t >= last);
+        last = t;
+        frames++;
+    }
+    dropped = st.stats().dropped;
+    highWater = st.stats().high_water;
+    TEST_ASSERT_EQUAL_UINT32(produced - dropped, frames);
+    TEST_ASSERT_EQUAL_UINT32(0, r.lostBlocks());
+
+    fs.remove("0001.bbl");
+    remove(dir);
+}
+
+void test_full_rate_recording_rides_out_writer_stalls()
+{
+    TEST_MESSAGE("writer stall ms  frames logged  dropped  staging high water (blocks)");
+    const uint32_t stalls[] = {0, 300, 1500};
+    uint32_t dropped[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        uint32_t frames, hw;
+        recordRun(stalls[i], frames, dropped[i], hw);
+        char line[96];
+        snprintf(line, sizeof(line), "%15u  %13u  %7u  %u of %u", (unsigned)stalls[i], (unsigned)frames,
+                 (unsigned)dropped[i], (unsigned)hw, (unsigned)(BLACKBOX_STAGING_BLOCKS - 1));
+        TEST_MESSAGE(line);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, dropped[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, dropped[1]); // 3 spare sectors cover ~380 ms at 32 kB/s
+    TEST_ASSERT_TRUE(dropped[2] > 0);        // longer: dropped and counted, the producer never waits
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_never_span_blocks);
+    RUN_TEST(test_schema_frame_and_reader_round_trip);
+    RUN_TEST(test_reader_skips_bad_and_counts_lost_blocks);
+    RUN_TEST(test_full_rate_recording_rides_out_writer_stalls);
+    return UNITY_END();
+}
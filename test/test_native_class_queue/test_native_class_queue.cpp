@@ -0,0 +1,297 @@
+// Host-side tests for TelemetryService's per-class TX queue: drop policies, strict priority
+// for critical samples, weighted sharing between control and bulk, and a saturated link
+// where an IMU burst must not delay or lose battery/ESC fault samples, including when
+// every sample needs a buffer from the shared pool.
+// Run with: pio test -e native -f test_native_class_queue -v
+#include <unity.h>
+#include "telemetry/telemetry_buffer_pool.hpp"
+#include "telemetry/telemetry_class_queue.hpp"
+
+#include <stdio.h>
+
+void setUp() {}
+void tearDown() {}
+
+using Push = TelemetryClassQueue::Push;
+
+static TelemetrySample sample(TelemetryClass cls, TelemetryStreamId stream, uint32_t seq)
+{
+    TelemetrySample s{};
+    s.meta.traffic_class = cls;
+    s.stream = stream;
+    s.seq = seq;
+    return s;
+}
+
+void test_drop_newest_refuses_and_keeps_the_first()
+{
+    TelemetryClassQueue q;
+    TEST_ASSERT_TRUE(q.configure(TelemetryClass::Critical, {2, TelemetryDropPolicy::DropNewest, 1}));
+    TelemetrySample d{};
+    TEST_ASSERT_TRUE(q.push(sample(TelemetryClass::Critical, 1, 0), d) == Push::Queued);
+    TEST_ASSERT_TRUE(q.push(sample(TelemetryClass::Critical, 1, 1), d) == Push::Queued);
+    TEST_ASSERT_TRUE(q.full(TelemetryClass::Critical));
+    TEST_ASSERT_TRUE(q.push(sample(TelemetryClass::Critical, 1, 2), d) == Push::Refused);
+
+    TelemetrySample out{};
+    TEST_ASSERT_TRUE(q.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(0, out.seq);
+    const auto &st = q.stats(TelemetryClass::Critical);
+    TEST_ASSERT_EQUAL_UINT32(2, st.queued);
+    TEST_ASSERT_EQUAL_UINT32(1, st.drop_newest);
+    TEST_ASSERT_EQUAL_UINT32(1, st.sent);
+    TEST_ASSERT_EQUAL_UINT8(2, st.high_water);
+    TEST_ASSERT_FALSE(q.configure(TelemetryClass::Critical, {4, TelemetryDropPolicy::DropOldest, 1})); // not empty
+}
+
+void test_drop_oldest_hands_back_the_evicted()
+{
+    TelemetryClassQueue q;
+    q.configure(TelemetryClass::Bulk, {3, TelemetryDropPolicy::DropOldest, 1});
+    TelemetrySample d{};
+    for (uint32_t i = 0; i < 3; ++i)
+        q.push(sample(TelemetryClass::Bulk, 2, i), d);
+    d.seq = 99;
+    TEST_ASSERT_TRUE(q.push(sample(TelemetryClass::Bulk, 2, 3), d) == Push::Displaced);
+    TEST_ASSERT_EQUAL_UINT32(0, d.seq); // the caller releases its buffer
+    TelemetrySample out{};
+    for (uint32_t want = 1; want <= 3; ++want)
+    {
+        TEST_ASSERT_TRUE(q.pop(out));
+        TEST_ASSERT_EQUAL_UINT32(want, out.seq);
+    }
+    TEST_ASSERT_FALSE(q.pop(out));
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats(TelemetryClass::Bulk).drop_oldest);
+}
+
+void test_latest_only_replaces_in_place()
+{
+    TelemetryClassQueue q;
+    TelemetrySample d{};
+    q.push(sample(TelemetryClass::Control, 4, 0), d); // rate decision
+    q.push(sample(TelemetryClass::Control, 5, 0), d); // ESC state
+    TEST_ASSERT_TRUE(q.push(sample(TelemetryClass::Control, 4, 1), d) == Push::Displaced);
+    TEST_ASSERT_EQUAL_UINT32(0, d.seq);
+    TEST_ASSERT_EQUAL_size_t(2, q.size(TelemetryClass::Control)); // one per stream
+
+    TelemetrySample out{};
+    q.pop(out);
+    TEST_ASSERT_EQUAL_UINT8(4, out.stream); // kept its place in line, with the newest value
+    TEST_ASSERT_EQUAL_UINT32(1, out.seq);
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats(TelemetryClass::Control).replaced);
+
+    // Asked for per sample in a DropOldest class (publishOverwrite)
+    q.push(sample(TelemetryClass::Bulk, 7, 0), d);
+    q.push(sample(TelemetryClass::Bulk, 8, 0), d);
+    TEST_ASSERT_TRUE(q.push(sample(TelemetryClass::Bulk, 7, 1), d, true) == Push::Displaced);
+    TEST_ASSERT_TRUE(q.push(sample(TelemetryClass::Bulk, 7, 2), d) == Push::Queued); // class policy again
+    TEST_ASSERT_EQUAL_size_t(3, q.size(TelemetryClass::Bulk));
+}
+
+void test_critical_first_then_weighted()
+{
+    TelemetryClassQueue q;
+    q.configure(TelemetryClass::Control, {16, TelemetryDropPolicy::DropOldest, 3});
+    TelemetrySample d{};
+    for (uint32_t i = 0; i < 12; ++i)
+    {
+        q.push(sample(TelemetryClass::Bulk, 1, i), d);
+        q.push(sample(TelemetryClass::Control, 2, i), d);
+    }
+    q.push(sample(TelemetryClass::Critical, 3, 0), d); // arrives last
+
+    TelemetrySample out{};
+    q.pop(out);
+    TEST_ASSERT_TRUE(out.meta.traffic_class == TelemetryClass::Critical);
+
+    // 3 control : 1 bulk while both have samples
+    char pattern[17] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        q.pop(out);
+        pattern[i] = out.meta.traffic_class == TelemetryClass::Control ? 'c' : 'b';
+    }
+    TEST_ASSERT_EQUAL_STRING("cccbcccbcccbcccb", pattern);
+    // Control ran dry: bulk gets everything
+    size_t bulk = 0;
+    while (q.pop(out))
+        bulk += out.meta.traffic_class == TelemetryClass::Bulk;
+    TEST_ASSERT_EQUAL_size_t(8, bulk);
+}
+
+// The TX task manages 1 sample/ms while the IMU bursts at 4/ms for 2 s, with a battery/ESC
+// fault every 50 ms and control state every 10 ms. Compared with one shared 64-deep FIFO.
+void test_saturated_link_critical_always_gets_through()
+{
+    TelemetryClassQueue q;
+    TelemetrySample fifo[64];
+    size_t fifoHead = 0, fifoCount = 0;
+
+    uint32_t critSent = 0, critLost = 0, critWorstMs = 0;
+    uint32_t fifoCritSent = 0, fifoCritLost = 0, fifoCritWorstMs = 0;
+    uint32_t critTotal = 0;
+
+    for (uint32_t ms = 0; ms < 2000; ++ms)
+    {
+        auto offer = [&](const TelemetrySample &s)
+        {
+            TelemetrySample displaced{};
+            const Push r = q.push(s, displaced);
+            if ((r == Push::Refused && s.meta.traffic_class == TelemetryClass::Critical) ||
+                (r == Push::Displaced && displaced.meta.traffic_class == TelemetryClass::Critical))
+                critLost++;
+            if (fifoCount < 64)
+                fifo[(fifoHead + fifoCount++) % 64] = s;
+            else if (s.meta.traffic_class == TelemetryClass::Critical)
+                fifoCritLost++;
+        };
+        for (int i = 0; i < 4; ++i)
+            offer(sample(TelemetryClass::Bulk, 1, ms));
+        if (ms % 10 == 0)
+            offer(sample(TelemetryClass::Control, 2, ms));
+        if (ms % 50 == 25)
+        {
+            offer(sample(TelemetryClass::Critical, 3, ms));
+            critTotal++;
+        }
+
+        TelemetrySample out{};
+        if (q.pop(out) && out.meta.traffic_class == TelemetryClass::Critical)
+        {
+            critSent++;
+            if (ms - out.seq > critWorstMs)
+                critWorstMs = ms - out.seq;
+        }
+        if (fifoCount)
+        {
+            out = fifo[fifoHead];
+            fifoHead = (fifoHead + 1) % 64;
+            fifoCount--;
+            if (out.meta.traffic_class == TelemetryClass::Critical)
+            {
+                fifoCritSent++;
+                if (ms - out.seq > fifoCritWorstMs)
+                    fifoCritWorstMs = ms - out.seq;
+            }
+        }
+    }
+
+    char line[160];
+    snprintf(line, sizeof(line), "critical %u: classes sent %u lost %u worst %u ms | one FIFO sent %u lost %u worst %u ms",
+             (unsigned)critTotal, (unsigned)critSent, (unsigned)critLost, (unsigned)critWorstMs,
+             (unsigned)fifoCritSent, (unsigned)fifoCritLost, (unsigned)fifoCritWorstMs);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(critTotal, critSent);
+    TEST_ASSERT_EQUAL_UINT32(0, critLost);
+    TEST_ASSERT_EQUAL_UINT32(0, critWorstMs); // sent in the same slot it arrived
+    TEST_ASSERT_TRUE(fifoCritLost > 0);       // the shared FIFO loses them to the burst
+
+    const auto &bulk = q.stats(TelemetryClass::Bulk);
+    TEST_ASSERT_EQUAL_UINT32(bulk.queued, bulk.sent + bulk.drop_oldest + q.size(TelemetryClass::Bulk));
+    TEST_ASSERT_EQUAL_UINT32(0, q.stats(TelemetryClass::Control).drop_oldest); // LatestOnly: one per stream
+}
+
+struct PooledRun
+{
+    uint32_t critTotal, critSent, critNoBuffer;
+    uint32_t bulkNoBuffer, bulkEvicted, bulkWorstAgeMs;
+};
+
+// Providers acquire a pool buffer per sample and push it like TelemetryService::enqueue()
+// (displaced buffers go back to the pool); the TX task sends one sample per ms and releases it
+static PooledRun runPooled(bool reserved)
+{
+    static TelemetryBufferPool pool; // all buffers are back after every run
+    TelemetryClassQueue q;
+    if (reserved)
+    {
+        q.configure(TelemetryClass::Bulk, {(uint8_t)TelemetryBufferPool::queueShare(TelemetryClass::Bulk),
+                                           TelemetryDropPolicy::DropOldest, 1});
+        q.configure(TelemetryClass::Control, {(uint8_t)TelemetryBufferPool::queueShare(TelemetryClass::Control),
+                                              TelemetryDropPolicy::LatestOnly, 3});
+    }
+    PooledRun r{};
+
+    auto offer = [&](TelemetryClass cls, TelemetryStreamId stream, uint32_t ms) -> bool
+    {
+        const TelemetryLease l = reserved ? pool.acquire(cls) : pool.acquire();
+        if (!l.valid())
+            return false;
+        TelemetrySample s = sample(cls, stream, ms);
+        s.buffer = l.slot;
+        TelemetrySample displaced{};
+        const Push p = q.push(s, displaced);
+        if (p == Push::Refused)
+            pool.release(s.buffer);
+        if (p == Push::Displaced)
+        {
+            pool.release(displaced.buffer);
+            r.bulkEvicted += displaced.meta.traffic_class == TelemetryClass::Bulk ? 1 : 0;
+        }
+        return p != Push::Refused;
+    };
+
+    for (uint32_t ms = 0; ms < 2000; ++ms)
+    {
+        for (int i = 0; i < 4; ++i)
+            r.bulkNoBuffer += offer(TelemetryClass::Bulk, 1, ms) ? 0 : 1;
+        if (ms % 10 == 0)
+            offer(TelemetryClass::Control, 2, ms);
+        if (ms % 50 == 25)
+        {
+            r.critTotal++;
+            r.critNoBuffer += offer(TelemetryClass::Critical, 3, ms) ? 0 : 1;
+        }
+
+        TelemetrySample out{};
+        if (q.pop(out))
+        {
+            if (out.meta.traffic_class == TelemetryClass::Critical)
+                r.critSent++;
+            if (out.meta.traffic_class == TelemetryClass::Bulk && ms - out.seq > r.bulkWorstAgeMs)
+                r.bulkWorstAgeMs = ms - out.seq;
+            pool.release(out.buffer);
+        }
+    }
+    TelemetrySample out{};
+    while (q.pop(out))
+        pool.release(out.buffer);
+    return r;
+}
+
+void test_pool_reserve_keeps_critical_and_drop_oldest_working()
+{
+    const PooledRun shared = runPooled(false);  // one pool, Bulk as deep as the old default
+    const PooledRun reserved = runPooled(true); // reserves and Bulk capped at its share
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "pooled, critical %u: shared pool sent %u (no buffer %u), bulk evicted %u skipped %u | "
+             "reserved sent %u, bulk evicted %u skipped %u, worst bulk age %u ms",
+             (unsigned)shared.critTotal, (unsigned)shared.critSent, (unsigned)shared.critNoBuffer,
+             (unsigned)shared.bulkEvicted, (unsigned)shared.bulkNoBuffer, (unsigned)reserved.critSent,
+             (unsigned)reserved.bulkEvicted, (unsigned)reserved.bulkNoBuffer, (unsigned)reserved.bulkWorstAgeMs);
+    TEST_MESSAGE(line);
+
+    // Without reserves Bulk holds every buffer: critical samples find none, and the newest
+    // bulk samples are skipped at acquire() while DropOldest never fires
+    TEST_ASSERT_TRUE(shared.critNoBuffer > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, shared.bulkEvicted);
+
+    TEST_ASSERT_EQUAL_UINT32(0, reserved.critNoBuffer);
+    TEST_ASSERT_EQUAL_UINT32(reserved.critTotal, reserved.critSent);
+    TEST_ASSERT_TRUE(reserved.bulkEvicted > reserved.bulkNoBuffer); // the oldest make room
+    TEST_ASSERT_TRUE(reserved.bulkWorstAgeMs <= TelemetryBufferPool::queueShare(TelemetryClass::Bulk));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_drop_newest_refuses_and_keeps_the_first);
+    RUN_TEST(test_drop_oldest_hands_back_the_evicted);
+    RUN_TEST(test_latest_only_replaces_in_place);
+    RUN_TEST(test_critical_first_then_weighted);
+    RUN_TEST(test_saturated_link_critical_always_gets_through);
+    RUN_TEST(test_pool_reserve_keeps_critical_and_drop_oldest_working);
+    return UNITY_END();
+}
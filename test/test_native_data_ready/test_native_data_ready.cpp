@@ -0,0 +1,178 @@
+// Host-side tests for MPU9250 data-ready pacing: the interrupt setup, the read timing stats, and
+// a virtual-time comparison of timer-paced reads against reads triggered by the INT pulse.
+// Run with: pio test -e native -f test_native_data_ready -v
+#include <unity.h>
+#include "drivers/imu/mpu9250_data_ready.hpp"
+
+#include <stdio.h>
+
+void setUp() {}
+void tearDown() {}
+
+// Register file only: enough to check what enable() writes
+class FakeRegs final : public II2cBackend
+{
+public:
+    uint8_t regs[128]{};
+    uint32_t writes{0};
+
+    I2cStatus transfer(uint8_t addr, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) override
+    {
+        if (addr != 0x68)
+            return I2cStatus::Nack;
+        if (rxLen)
+        {
+            for (size_t i = 0; i < rxLen; ++i)
+                rx[i] = regs[(tx[0] + i) & 0x7F];
+        }
+        else if (txLen == 2)
+        {
+            regs[tx[0] & 0x7F] = tx[1];
+            writes++;
+        }
+        return I2cStatus::Ok;
+    }
+};
+
+void test_enable_sets_rate_and_keeps_other_interrupts()
+{
+    FakeRegs mpu;
+    mpu.regs[0x38] = 0x10; // FIFO overflow interrupt from the FIFO driver
+    uint32_t hz = 0;
+    TEST_ASSERT_EQUAL(I2cStatus::Ok, Mpu9250DataReady::enable(mpu, 0x68, 200, hz));
+    TEST_ASSERT_EQUAL_UINT32(200, hz);
+    TEST_ASSERT_EQUAL_HEX8(4, mpu.regs[0x19]);    // 1 kHz / 5
+    TEST_ASSERT_EQUAL_HEX8(0x02, mpu.regs[0x37]); // bypass kept, active high pulse
+    TEST_ASSERT_EQUAL_HEX8(0x11, mpu.regs[0x38]);
+
+    // Rate owned by the FIFO driver: left alone
+    mpu.regs[0x19] = 0;
+    TEST_ASSERT_EQUAL(I2cStatus::Ok, Mpu9250DataReady::enable(mpu, 0x68, 0, hz));
+    TEST_ASSERT_EQUAL_UINT32(0, hz);
+    TEST_ASSERT_EQUAL_HEX8(0, mpu.regs[0x19]);
+
+    TEST_ASSERT_EQUAL(I2cStatus::Nack, Mpu9250DataReady::enable(mpu, 0x69, 100, hz));
+}
+
+void test_record_latency_jitter_and_gaps()
+{
+    Mpu9250DataReady t;
+    t.setPeriod(1000);
+    t.resetStats(0);
+    t.record(1050, 1000, true);  // first read: latency only
+    t.record(2030, 2000, true);  // interval 980: jitter 20
+    t.record(3100, 3000, false); // backstop read: no latency, jitter 70
+    t.record(5100, 4000, true);  // 2 ms interval: a gap, not jitter
+    const Mpu9250DataReady::Stats &st = t.stats();
+    TEST_ASSERT_EQUAL_UINT32(4, st.reads);
+    TEST_ASSERT_EQUAL_UINT32(3, st.triggered);
+    TEST_ASSERT_EQUAL_UINT32(1100, st.latency_max_us);
+    TEST_ASSERT_EQUAL_UINT64(50 + 30 + 1100, st.latency_sum_us);
+    TEST_ASSERT_EQUAL_UINT32(2, st.intervals);
+    TEST_ASSERT_EQUAL_UINT32(70, st.jitter_max_us);
+    TEST_ASSERT_EQUAL_UINT32(1, st.gaps);
+
+    t.resetStats(6000);
+    TEST_ASSERT_EQUAL_UINT32(0, t.stats().reads);
+    TEST_ASSERT_EQUAL_UINT32(6000, t.stats().since_us);
+    TEST_ASSERT_EQUAL_UINT32(1000, t.periodUs());
+}
+
+struct PacingResult
+{
+    uint32_t reads;
+    uint32_t duplicates; ///< Same sample read twice
+    uint32_t skipped;    ///< Samples never read
+    uint32_t ageMaxUs;   ///< Read time - sample time
+    uint64_t ageSumUs;
+};
+
+// Sensor sampling at nominally 100 Hz on its own (0.5 % fast) clock for 10 s. Timer pacing
+// reads every 10 ms on the host clock; triggered pacing reads 30-90 µs after each pulse
+// (ISR, task wake-up, a bus job queued ahead).
+static PacingResult simulate(bool triggered, Mpu9250DataReady &timing)
+{
+    const uint32_t sensorPeriod = 9950;
+    const uint32_t hostPeriod = 10000;
+    const uint32_t endUs = 10000000;
+    PacingResult r{};
+    int32_t lastSample = -1;
+    uint32_t seed = 12345;
+
+    timing.setPeriod(triggered ? sensorPeriod : hostPeriod);
+    timing.resetStats(0);
+    for (uint32_t n = 1;; ++n)
+    {
+        uint32_t readUs, isrUs = 0;
+        if (triggered)
+        {
+            seed = seed * 1103515245u + 12345u;
+            isrUs = n * sensorPeriod + 3000; // sensor started 3 ms into the host's period
+            readUs = isrUs + 30 + (seed >> 16) % 61;
+        }
+        else
+        {
+            readUs = n * hostPeriod;
+        }
+        if (readUs >= endUs)
+            break;
+        timing.record(readUs, isrUs, triggered);
+
+        // Newest sample in the registers at readUs
+        if (readUs < 3000 + sensorPeriod)
+            continue;
+        const int32_t sample = (int32_t)((readUs - 3000) / sensorPeriod);
+        const uint32_t age = readUs - (3000 + (uint32_t)sample * sensorPeriod);
+        r.reads++;
+        if (sample == lastSample)
+            r.duplicates++;
+        else if (lastSample >= 0)
+            r.skipped += (uint32_t)(sample - lastSample - 1);
+        lastSample = sample;
+        r.ageSumUs += age;
+        if (age > r.ageMaxUs)
+            r.ageMaxUs = age;
+    }
+    return r;
+}
+
+void test_triggered_reads_every_sample_once_at_a_fixed_age()
+{
+    Mpu9250DataReady timerTiming, drdyTiming;
+    const PacingResult timer = simulate(false, timerTiming);
+    const PacingResult drdy = simulate(true, drdyTiming);
+
+    TEST_MESSAGE("pacing   reads   dup   skipped   age avg/max us   jitter max us");
+    char line[96];
+    snprintf(line, sizeof(line), "timer    %5u   %3u   %7u   %6u / %5u   %13u", (unsigned)timer.reads,
+             (unsigned)timer.duplicates, (unsigned)timer.skipped, (unsigned)(timer.ageSumUs / timer.reads),
+             (unsigned)timer.ageMaxUs, (unsigned)timerTiming.stats().jitter_max_us);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "drdy     %5u   %3u   %7u   %6u / %5u   %13u", (unsigned)drdy.reads,
+             (unsigned)drdy.duplicates, (unsigned)drdy.skipped, (unsigned)(drdy.ageSumUs / drdy.reads),
+             (unsigned)drdy.ageMaxUs, (unsigned)drdyTiming.stats().jitter_max_us);
+    TEST_MESSAGE(line);
+
+    // The timer drifts through the sensor's period: stale samples of any age up to a period,
+    // and every ~2 s one skipped
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(4, timer.skipped);
+    TEST_ASSERT_GREATER_THAN_UINT32(9000, timer.ageMaxUs);
+    TEST_ASSERT_EQUAL_UINT32(0, timerTiming.stats().jitter_max_us); // perfectly regular, still wrong
+
+    // Triggered: every sample exactly once, never older than the read latency
+    TEST_ASSERT_EQUAL_UINT32(0, drdy.duplicates);
+    TEST_ASSERT_EQUAL_UINT32(0, drdy.skipped);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(90, drdy.ageMaxUs);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(90, drdyTiming.stats().latency_max_us);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(60, drdyTiming.stats().jitter_max_us);
+    TEST_ASSERT_EQUAL_UINT32(0, drdyTiming.stats().gaps);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_enable_sets_rate_and_keeps_other_interrupts);
+    RUN_TEST(test_record_latency_jitter_and_gaps);
+    RUN_TEST(test_triggered_reads_every_sample_once_at_a_fixed_age);
+    return UNITY_END();
+}
@@ -0,0 +1,346 @@
+// Host-side tests for the quantized delta codec: varint edge cases, round-trip error bounds
+// on synthetic attitude traces, resync after lost samples, and size against JSON/packed.
+// Run with: pio test -e native -f test_native_delta_codec -v
+#include <unity.h>
+#include "telemetry/delta_codec.hpp"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+void setUp() {}
+void tearDown() {}
+
+static const PackedField kAttitudeFields[] = {
+    {"roll", PackedType::I16, 100.0f},
+    {"pitch", PackedType::I16, 100.0f},
+    {"yaw", PackedType::I16, 100.0f},
+};
+static const PackedSchema kAttitude{1, kAttitudeFields, 3};
+
+static uint32_t lcg(uint32_t &s)
+{
+    s = s * 1664525u + 1013904223u;
+    return s >> 8;
+}
+
+static float noise(uint32_t &s, float amp) { return amp * ((lcg(s) & 0xFFFF) / 32768.0f - 1.0f); }
+
+// Attitude at 100 Hz: roll/pitch oscillating, yaw turning through the ±180 wrap, sensor noise
+static void attitudeAt(int i, float rateScale, uint32_t &rng, float *v)
+{
+    const float t = i * 0.01f;
+    v[0] = 30.0f * rateScale * sinf(2.0f * (float)M_PI * 0.2f * t) + noise(rng, 0.05f);
+    v[1] = 10.0f * rateScale * sinf(2.0f * (float)M_PI * 0.5f * t + 1.0f) + noise(rng, 0.05f);
+    v[2] = fmodf(20.0f * rateScale * t + 360.0f * 100.0f + 180.0f, 360.0f) - 180.0f + noise(rng, 0.05f);
+}
+
+void test_zigzag_varint()
+{
+    uint8_t b[8];
+    const struct
+    {
+        int32_t v;
+        size_t n;
+        uint8_t first;
+    } cases[] = {{0, 1, 0x00}, {-1, 1, 0x01}, {1, 1, 0x02}, {-64, 1, 0x7F}, {63, 1, 0x7E}, {64, 2, 0x80},
+                 {-8192, 2, 0xFF}, {8192, 3, 0x80}, {INT32_MAX, 5, 0xFE}, {INT32_MIN, 5, 0xFF}};
+    for (const auto &c : cases)
+    {
+        TEST_ASSERT_EQUAL_size_t(c.n, deltaPutVarint(c.v, b, sizeof(b)));
+        TEST_ASSERT_EQUAL_UINT8(c.first, b[0]);
+        int32_t back = 0;
+        TEST_ASSERT_EQUAL_size_t(c.n, deltaGetVarint(b, c.n, back));
+        TEST_ASSERT_EQUAL_INT32(c.v, back);
+        if (c.n > 1)
+            TEST_ASSERT_EQUAL_size_t(0, deltaGetVarint(b, c.n - 1, back)); // truncated
+    }
+    TEST_ASSERT_EQUAL_size_t(0, deltaPutVarint(8192, b, 2));
+    const uint8_t tooLong[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+    int32_t v;
+    TEST_ASSERT_EQUAL_size_t(0, deltaGetVarint(tooLong, sizeof(tooLong), v));
+}
+
+void test_round_trip_error_is_bounded_and_does_not_drift()
+{
+    DeltaEncoder enc(&kAttitude, 50);
+    DeltaDecoder dec(&kAttitude);
+    uint32_t rng = 1;
+    uint8_t buf[32];
+    double maxErr = 0;
+    for (int i = 0; i < 60 * 100; ++i) // 60 s
+    {
+        float v[3];
+        attitudeAt(i, 1.0f, rng, v);
+        const size_t n = enc.encode(v, buf, sizeof(buf));
+        TEST_ASSERT_TRUE(n >= 5);
+        TEST_ASSERT_EQUAL(i % 50 == 0, (deltaHeader(buf) & DELTA_FLAG_KEYFRAME) != 0);
+
+        double out[3];
+        TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, dec.decode(buf, n, out));
+        for (int c = 0; c < 3; ++c)
+            maxErr = fmax(maxErr, fabs(out[c] - v[c]));
+    }
+    // Half a quantization step, plus float rounding of the input near ±180
+    TEST_ASSERT_TRUE(maxErr <= 0.005 + 1e-5);
+    TEST_ASSERT_EQUAL_UINT32(120, enc.stats().keyframes);
+    TEST_ASSERT_EQUAL_UINT32(6000, dec.stats().samples);
+    TEST_ASSERT_EQUAL_UINT32(0, dec.stats().lost);
+}
+
+void test_saturation_and_nan()
+{
+    DeltaEncoder enc(&kAttitude);
+    DeltaDecoder dec(&kAttitude);
+    uint8_t buf[32];
+    double out[3];
+    const float big[3] = {1e12f, -1e12f, NAN};
+    size_t n = enc.encode(big, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_size_t(DELTA_HEADER_BYTES + 5 + 5 + 1, n); // saturated: 5-byte varints; NaN -> 0, one byte
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, dec.decode(buf, n, out));
+    TEST_ASSERT_TRUE(out[0] == DELTA_QUANT_LIMIT / 100.0);
+    TEST_ASSERT_TRUE(out[1] == -DELTA_QUANT_LIMIT / 100.0);
+    TEST_ASSERT_TRUE(out[2] == 0.0);
+
+    // Largest possible delta (full negative swing) still fits and round-trips
+    const float swing[3] = {-1e12f, 1e12f, 0.0f};
+    n = enc.encode(swing, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(n > 0 && n <= DeltaEncoder::maxEncodedLength(kAttitude));
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, dec.decode(buf, n, out));
+    TEST_ASSERT_TRUE(out[0] == -DELTA_QUANT_LIMIT / 100.0);
+
+    // Too small a buffer fails without advancing the stream
+    const DeltaEncoder::Stats before = enc.stats();
+    TEST_ASSERT_EQUAL_size_t(0, enc.encode(swing, buf, 4));
+    TEST_ASSERT_EQUAL_UINT32(before.samples, enc.stats().samples);
+    const float zero[3] = {0, 0, 0};
+    n = enc.encode(zero, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, dec.decode(buf, n, out));
+    TEST_ASSERT_TRUE(out[0] == 0.0 && out[1] == 0.0);
+
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Error, dec.decode(buf, n - 1, out));
+    buf[0] = 9;
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Error, dec.decode(buf, n, out));
+}
+
+void test_lost_samples_resync_at_keyframe()
+{
+    const uint16_t interval = 20;
+    DeltaEncoder enc(&kAttitude, interval);
+    DeltaDecoder dec(&kAttitude);
+    uint32_t rng = 7, drop = 99;
+    uint8_t buf[32];
+    uint32_t delivered = 0, ok = 0, waiting = 0, keysDelivered = 0;
+    int lastLost = -1000;
+    for (int i = 0; i < 20000; ++i)
+    {
+        float v[3];
+        attitudeAt(i, 1.0f, rng, v);
+        const size_t n = enc.encode(v, buf, sizeof(buf));
+        if (lcg(drop) % 100 < 5) // 5 % loss, as on a bad QoS 0 link
+        {
+            lastLost = i;
+            continue;
+        }
+        delivered++;
+        const bool key = deltaHeader(buf) & DELTA_FLAG_KEYFRAME;
+        keysDelivered += key;
+
+        double out[3];
+        const DeltaDecoder::Result r = dec.decode(buf, n, out);
+        if (key)
+            TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, r); // keyframes always resync
+        if (r == DeltaDecoder::Result::Waiting)
+        {
+            TEST_ASSERT_TRUE(i - lastLost < interval); // only until the next keyframe
+            waiting++;
+            continue;
+        }
+        TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, r);
+        ok++;
+        for (int c = 0; c < 3; ++c)
+            TEST_ASSERT_TRUE(fabs(out[c] - v[c]) <= 0.005 + 1e-5); // never a value built on a lost delta
+    }
+    TEST_ASSERT_EQUAL_UINT32(delivered, ok + waiting);
+    TEST_ASSERT_EQUAL_UINT32(20000 - delivered, dec.stats().lost);
+    TEST_ASSERT_EQUAL_UINT32(waiting, dec.stats().skipped);
+    TEST_ASSERT_EQUAL_UINT32(keysDelivered, dec.stats().keyframes);
+
+    char line[96];
+    snprintf(line, sizeof(line), "5%% loss, keyframe every %u: %u delivered, %u decoded, %u skipped until resync",
+             (unsigned)interval, (unsigned)delivered, (unsigned)ok, (unsigned)waiting);
+    TEST_MESSAGE(line);
+}
+
+void test_force_keyframe_after_unsent_payload()
+{
+    DeltaEncoder enc(&kAttitude, 50);
+    uint8_t buf[32];
+    const float v[3] = {1, 2, 3};
+    enc.encode(v, buf, sizeof(buf));
+    enc.encode(v, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT8(0, deltaHeader(buf) & DELTA_FLAG_KEYFRAME);
+    enc.forceKeyframe(); // e.g. the TX queue dropped it
+    enc.encode(v, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_HEX16(DELTA_FLAG_KEYFRAME | 2, deltaHeader(buf));
+}
+
+// Encode samples first..last of a ramp (every channel = i / 10 deg); deliver only `last`
+static DeltaDecoder::Result skipTo(DeltaEncoder &enc, DeltaDecoder &dec, int first, int last, double *out)
+{
+    uint8_t buf[32];
+    size_t n = 0;
+    for (int i = first; i <= last; ++i)
+    {
+        const float v[3] = {i * 0.1f, -i * 0.1f, 0.0f};
+        n = enc.encode(v, buf, sizeof(buf));
+    }
+    return dec.decode(buf, n, out);
+}
+
+void test_outage_of_128_samples_is_noticed()
+{
+    // A 7-bit seq wrapped here: the delta after the gap was applied to a stale value
+    DeltaEncoder enc(&kAttitude, 1000);
+    DeltaDecoder dec(&kAttitude);
+    double out[3];
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, skipTo(enc, dec, 0, 0, out));
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, skipTo(enc, dec, 1, 1, out));
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Waiting, skipTo(enc, dec, 2, 130, out)); // 128 lost
+    TEST_ASSERT_EQUAL_UINT32(128, dec.stats().lost);
+}
+
+void test_outage_of_32768_samples_aliases_until_keyframe()
+{
+    // Documented limit: a gap of exactly 2^15 samples matches the expected seq. The deltas
+    // after it decode against the value before the outage, until the next keyframe resyncs.
+    const uint16_t interval = 50;
+    DeltaEncoder enc(&kAttitude, interval);
+    DeltaDecoder dec(&kAttitude);
+    double out[3];
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, skipTo(enc, dec, 0, 0, out));
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, skipTo(enc, dec, 1, 1, out));
+    const int after = 1 + 32768 + 1; // not a keyframe (32770 % 50 != 0)
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, skipTo(enc, dec, 2, after, out));
+    TEST_ASSERT_EQUAL_UINT32(0, dec.stats().lost);
+    TEST_ASSERT_TRUE(fabs(out[0] - after * 0.1) > 1.0); // stale: 0.2 deg plus one step
+
+    int i = after + 1;
+    for (; i % interval != 0; ++i)
+        TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, skipTo(enc, dec, i, i, out));
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, skipTo(enc, dec, i, i, out)); // the keyframe
+    TEST_ASSERT_TRUE(fabs(out[0] - i * 0.1) <= 0.005 + 1e-5);
+    TEST_ASSERT_TRUE(fabs(out[1] + i * 0.1) <= 0.005 + 1e-5);
+}
+
+void test_buf_writer_call_sequence()
+{
+    DeltaEncoder enc(&kAttitude);
+    uint8_t buf[32];
+    const uint8_t *out;
+    size_t len;
+
+    DeltaBufWriter w(buf, sizeof(buf), &enc);
+    w.beginObject();
+    w.key("roll");
+    w.value(1.5f);
+    w.key("pitch");
+    w.value(-2.25);
+    w.key("yaw");
+    w.value((int32_t)90);
+    w.endObject();
+    TEST_ASSERT_TRUE(w.finalize(out, len));
+    DeltaDecoder dec(&kAttitude);
+    double v[3];
+    TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, dec.decode(out, len, v));
+    TEST_ASSERT_TRUE(v[0] == 1.5 && v[1] == -2.25 && v[2] == 90.0);
+
+    // Schema drift or an incomplete sample fails and leaves the encoder where it was
+    DeltaBufWriter bad(buf, sizeof(buf), &enc);
+    bad.beginObject();
+    bad.key("pitch");
+    bad.value(1.0f);
+    TEST_ASSERT_FALSE(bad.ok());
+    DeltaBufWriter partial(buf, sizeof(buf), &enc);
+    partial.beginObject();
+    partial.key("roll");
+    partial.value(1.0f);
+    partial.endObject();
+    TEST_ASSERT_FALSE(partial.finalize(out, len));
+    TEST_ASSERT_EQUAL_UINT32(1, enc.stats().samples);
+
+    DeltaBufWriter none(buf, sizeof(buf), nullptr);
+    none.beginObject();
+    none.endObject();
+    TEST_ASSERT_FALSE(none.finalize(out, len));
+}
+
+// ===== Size against JSON and packed ===========================================
+// JSON as the IMU provider sent it by default: {"roll":..,"pitch":..,"yaw":..}
+static size_t jsonLength(const float *v)
+{
+    char s[96];
+    return (size_t)snprintf(s, sizeof(s), "{\"roll\":%.3f,\"pitch\":%.3f,\"yaw\":%.3f}", v[0], v[1], v[2]);
+}
+
+void test_size_against_json_and_packed()
+{
+    TEST_MESSAGE("motion     resolution  json B  packed B  delta B  vs json  max error");
+    const struct
+    {
+        const char *name;
+        float rateScale;
+        float scale;
+    } runs[] = {{"hover", 0.05f, 100.0f}, {"cruise", 1.0f, 100.0f}, {"aerobatic", 8.0f, 100.0f},
+                {"aerobatic", 8.0f, 10.0f}};
+    double ratio[4];
+    for (int r = 0; r < 4; ++r)
+    {
+        const PackedField f[] = {{"roll", PackedType::I16, runs[r].scale},
+                                 {"pitch", PackedType::I16, runs[r].scale},
+                                 {"yaw", PackedType::I16, runs[r].scale}};
+        const PackedSchema s{1, f, 3};
+        DeltaEncoder enc(&s, DELTA_KEYFRAME_INTERVAL);
+        DeltaDecoder dec(&s);
+        uint32_t rng = 3;
+        uint8_t buf[32];
+        uint64_t json = 0;
+        double maxErr = 0;
+        const int n = 60 * 100;
+        for (int i = 0; i < n; ++i)
+        {
+            float v[3];
+            attitudeAt(i, runs[r].rateScale, rng, v);
+            json += jsonLength(v);
+            double out[3];
+            TEST_ASSERT_EQUAL(DeltaDecoder::Result::Ok, dec.decode(buf, enc.encode(v, buf, sizeof(buf)), out));
+            for (int c = 0; c < 3; ++c)
+                maxErr = fmax(maxErr, fabs(out[c] - v[c]));
+        }
+        TEST_ASSERT_TRUE(maxErr <= 0.5 / runs[r].scale + 1e-5);
+        const double jsonB = (double)json / n, deltaB = (double)enc.stats().bytes / n;
+        ratio[r] = jsonB / deltaB;
+        char line[112];
+        snprintf(line, sizeof(line), "%-9s  %7.2f deg  %6.1f  %8u  %7.2f  %6.1fx  %9.4f", runs[r].name,
+                 1.0 / runs[r].scale, jsonB, (unsigned)PackedBufWriter::encodedLength(s), deltaB, ratio[r], maxErr);
+        TEST_MESSAGE(line);
+    }
+    TEST_ASSERT_TRUE(ratio[0] >= 6.5); // at rest: 6 bytes, keyframes aside
+    TEST_ASSERT_TRUE(ratio[1] >= 5.0);
+    TEST_ASSERT_TRUE(ratio[3] > ratio[2]); // coarser resolution, smaller deltas
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_zigzag_varint);
+    RUN_TEST(test_round_trip_error_is_bounded_and_does_not_drift);
+    RUN_TEST(test_saturation_and_nan);
+    RUN_TEST(test_lost_samples_resync_at_keyframe);
+    RUN_TEST(test_force_keyframe_after_unsent_payload);
+    RUN_TEST(test_outage_of_128_samples_is_noticed);
+    RUN_TEST(test_outage_of_32768_samples_aliases_until_keyframe);
+    RUN_TEST(test_buf_writer_call_sequence);
+    RUN_TEST(test_size_against_json_and_packed);
+    return UNITY_END();
+}
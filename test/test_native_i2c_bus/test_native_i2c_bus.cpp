@@ -0,0 +1,306 @@
+// Host-side tests for the I2C transaction queue against a fake bus in virtual time, incl. a
+// clock sweep of bus utilization and per-device latency for a typical sensor mix.
+// Run with: pio test -e native -f test_native_i2c_bus -v
+#include <unity.h>
+#include "drivers/i2c/i2c_transaction_queue.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+void setUp() {}
+void tearDown() {}
+
+static uint32_t g_now = 0;
+static uint32_t clockNow() { return g_now; }
+
+// Timing of a real transfer: start + address + bytes (9 bits each incl. ACK), repeated start
+// + address for the read, stop. Unknown addresses NACK after the address byte.
+class FakeBus final : public II2cBackend
+{
+public:
+    uint32_t clockHz{400000};
+    uint8_t present[4]{0x68, 0x0c, 0x76, 0};
+    uint8_t stuck{0};        ///< holds SCL low until the timeout
+    uint32_t timeoutUs{10000};
+    uint32_t transfers{0};
+
+    uint32_t bitsUs(uint32_t bits) const { return (bits * 1000000u + clockHz - 1) / clockHz; }
+
+    I2cStatus transfer(uint8_t addr, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) override
+    {
+        (void)tx;
+        transfers++;
+        if (addr == stuck)
+        {
+            g_now += timeoutUs;
+            return I2cStatus::Timeout;
+        }
+        bool found = false;
+        for (uint8_t a : present)
+            found |= a && a == addr;
+        if (!found)
+        {
+            g_now += bitsUs(1 + 9 + 1);
+            return I2cStatus::Nack;
+        }
+        uint32_t bits = 1 + 9 + 9 * (uint32_t)txLen + 1;
+        if (rxLen)
+            bits += 1 + 9 + 9 * (uint32_t)rxLen;
+        g_now += bitsUs(bits);
+        for (size_t i = 0; i < rxLen; ++i)
+            rx[i] = (uint8_t)(addr + i);
+        return I2cStatus::Ok;
+    }
+};
+
+static uint32_t g_doneOrder[16];
+static size_t g_doneCount = 0;
+static void recordDone(const I2cTransaction &t)
+{
+    g_doneOrder[g_doneCount++] = (uint32_t)(uintptr_t)t.ctx;
+}
+
+// Drain the queue like the bus task: pop, execute, record, signal
+static void drain(I2cTransactionQueue &q, FakeBus &bus)
+{
+    I2cTransaction t;
+    while (q.pop(t))
+    {
+        q.run(t, bus, &clockNow);
+        if (t.done)
+            t.done(t);
+    }
+}
+
+void test_runs_back_to_back_in_submission_order()
+{
+    g_now = 1000;
+    g_doneCount = 0;
+    FakeBus bus;
+    I2cTransactionQueue q;
+    q.resetStats(g_now);
+
+    uint8_t accel[14], mag[7], baro[3];
+    I2cTransaction t;
+    I2cTransaction::readReg(t, 0x68, 0x3b, accel, sizeof(accel));
+    t.done = &recordDone;
+    t.ctx = (void *)1;
+    q.submit(t, g_now);
+    I2cTransaction::readReg(t, 0x0c, 0x03, mag, sizeof(mag));
+    t.ctx = (void *)2;
+    q.submit(t, g_now);
+    I2cTransaction::readReg(t, 0x76, 0xf7, baro, sizeof(baro));
+    t.ctx = (void *)3;
+    q.submit(t, g_now);
+    TEST_ASSERT_EQUAL_size_t(3, q.pending());
+
+    // First one: 1+9+9+1 + 1+9+14*9 = 156 bits at 400 kHz = 390 µs, no wait
+    I2cTransaction first;
+    TEST_ASSERT_TRUE(q.pop(first));
+    q.run(first, bus, &clockNow);
+    first.done(first);
+    TEST_ASSERT_EQUAL_UINT32(1000, first.start_us);
+    TEST_ASSERT_EQUAL_UINT32(390, first.end_us - first.start_us);
+    TEST_ASSERT_EQUAL_UINT8(0x68 + 13, accel[13]);
+
+    // The rest start the moment the previous one ended
+    uint32_t lastEnd = first.end_us;
+    while (q.pop(t))
+    {
+        q.run(t, bus, &clockNow);
+        TEST_ASSERT_EQUAL_UINT32(lastEnd, t.start_us);
+        lastEnd = t.end_us;
+        t.done(t);
+    }
+    TEST_ASSERT_EQUAL_size_t(3, g_doneCount);
+    for (size_t i = 0; i < 3; ++i)
+        TEST_ASSERT_EQUAL_UINT32(i + 1, g_doneOrder[i]);
+
+    // Latency includes the wait behind the accel read
+    const auto *baroStats = q.deviceStats(0x76);
+    TEST_ASSERT_NOT_NULL(baroStats);
+    TEST_ASSERT_EQUAL_UINT32(lastEnd - 1000, baroStats->latency_max_us);
+    TEST_ASSERT_EQUAL_UINT8(100, q.utilizationPct(g_now)); // never idle while work was queued
+}
+
+void test_nack_and_timeout_counted_per_device()
+{
+    g_now = 0;
+    FakeBus bus;
+    bus.stuck = 0x0c;
+    I2cTransactionQueue q;
+    q.resetStats(g_now);
+
+    const uint8_t cfg[2] = {0x6b, 0x00};
+    I2cTransaction t;
+    I2cTransaction::write(t, 0x68, cfg, sizeof(cfg));
+    q.submit(t, g_now);
+    I2cTransaction::write(t, 0x42, cfg, sizeof(cfg)); // nobody home
+    q.submit(t, g_now);
+    q.submit(t, g_now);
+    I2cTransaction::write(t, 0x0c, cfg, sizeof(cfg));
+    q.submit(t, g_now);
+    drain(q, bus);
+
+    TEST_ASSERT_EQUAL_UINT32(0, q.deviceStats(0x68)->nacks);
+    TEST_ASSERT_EQUAL_UINT32(2, q.deviceStats(0x42)->nacks);
+    TEST_ASSERT_EQUAL_UINT32(2, q.deviceStats(0x42)->transactions);
+    TEST_ASSERT_EQUAL_UINT32(1, q.deviceStats(0x0c)->timeouts);
+    TEST_ASSERT_EQUAL_UINT32(10000, q.deviceStats(0x0c)->transfer_max_us);
+    TEST_ASSERT_EQUAL_UINT32(4, q.stats().completed);
+
+    uint8_t big[I2C_TX_INLINE_MAX + 1] = {};
+    TEST_ASSERT_FALSE(I2cTransaction::write(t, 0x68, big, sizeof(big)));
+}
+
+void test_queue_full_and_stats_window()
+{
+    g_now = 0;
+    FakeBus bus;
+    I2cTransactionQueue q;
+    q.resetStats(g_now);
+    I2cTransaction t;
+    const uint8_t reg = 0x75;
+    I2cTransaction::write(t, 0x68, &reg, 1);
+    for (int i = 0; i < I2C_BUS_QUEUE_LEN; ++i)
+        TEST_ASSERT_TRUE(q.submit(t, g_now) == I2cStatus::Ok);
+    TEST_ASSERT_TRUE(q.submit(t, g_now) == I2cStatus::QueueFull);
+    TEST_ASSERT_EQUAL_UINT32(1, q.stats().queue_full);
+    TEST_ASSERT_EQUAL_UINT32(I2C_BUS_QUEUE_LEN, q.stats().queue_high_water);
+    drain(q, bus);
+
+    // Idle for as long as the bus was busy: 50 %
+    g_now += g_now;
+    TEST_ASSERT_EQUAL_UINT8(50, q.utilizationPct(g_now));
+
+    q.resetStats(g_now);
+    TEST_ASSERT_EQUAL_UINT32(0, q.stats().completed);
+    TEST_ASSERT_EQUAL_UINT32(0, q.deviceStats(0x68)->transactions);
+    TEST_ASSERT_EQUAL_UINT8(0, q.utilizationPct(g_now));
+}
+
+static I2cStatus fakeDriverUpdate(void *ctx)
+{
+    // A driver library doing several Wire transfers of its own
+    FakeBus *bus = static_cast<FakeBus *>(ctx);
+    uint8_t buf[14];
+    const uint8_t reg = 0x3a;
+    for (int i = 0; i < 3; ++i)
+        bus->transfer(0x68, &reg, 1, buf, i == 0 ? 1 : 14);
+    return I2cStatus::Ok;
+}
+
+void test_exclusive_job_holds_bus_for_its_duration()
+{
+    g_now = 0;
+    FakeBus bus;
+    I2cTransactionQueue q;
+    q.resetStats(g_now);
+
+    q.submit(I2cTransaction::exclusive(0x68, &fakeDriverUpdate, &bus), g_now);
+    uint8_t baro[3];
+    I2cTransaction t;
+    I2cTransaction::readReg(t, 0x76, 0xf7, baro, sizeof(baro));
+    q.submit(t, g_now);
+
+    I2cTransaction job;
+    q.pop(job);
+    q.run(job, bus, &clockNow);
+    TEST_ASSERT_EQUAL_UINT32(3, bus.transfers);
+    TEST_ASSERT_EQUAL_UINT32(job.end_us, q.deviceStats(0x68)->busy_us);
+    q.pop(t);
+    q.run(t, bus, &clockNow);
+    TEST_ASSERT_EQUAL_UINT32(job.end_us, t.start_us); // baro waited for the whole job
+}
+
+// ===== Sensor mix ==============================================================
+// IMU accel+gyro+temp burst (14 bytes) at 1 kHz, magnetometer (7 bytes) at 100 Hz, baro
+// (6 bytes) at 50 Hz, submitted on their own schedules; the bus drains the queue as it can.
+// Standard mode (100 kHz) can't carry the IMU alone; that's what the queue_full count shows.
+struct SimDevice
+{
+    const char *name;
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t len;
+    uint32_t periodUs;
+    uint32_t phaseUs;
+};
+
+void test_clock_sweep_sensor_mix()
+{
+    const SimDevice devs[] = {
+        {"imu", 0x68, 0x3b, 14, 1000, 0},
+        {"mag", 0x0c, 0x03, 7, 10000, 137},
+        {"baro", 0x76, 0xf7, 6, 20000, 411},
+    };
+    const uint32_t clocks[] = {100000, 400000, 1000000};
+    uint8_t rx[16];
+
+    TEST_MESSAGE("clock kHz  util %  imu avg/max us  mag avg/max us  baro avg/max us");
+    uint8_t util[3] = {};
+    for (size_t c = 0; c < 3; ++c)
+    {
+        FakeBus bus;
+        bus.clockHz = clocks[c];
+        I2cTransactionQueue q;
+        g_now = 0;
+        q.resetStats(0);
+
+        uint32_t next[3] = {devs[0].phaseUs, devs[1].phaseUs, devs[2].phaseUs};
+        const uint32_t endUs = 1000000;
+        while (g_now < endUs)
+        {
+            // Submit everything that has become due, then run one transaction (or idle to the next release)
+            uint32_t soonest = endUs;
+            for (size_t d = 0; d < 3; ++d)
+            {
+                while (next[d] <= g_now)
+                {
+                    I2cTransaction t;
+                    I2cTransaction::readReg(t, devs[d].addr, devs[d].reg, rx, devs[d].len);
+                    q.submit(t, next[d]);
+                    next[d] += devs[d].periodUs;
+                }
+                if (next[d] < soonest)
+                    soonest = next[d];
+            }
+            I2cTransaction t;
+            if (q.pop(t))
+                q.run(t, bus, &clockNow);
+            else
+                g_now = soonest;
+        }
+
+        util[c] = q.utilizationPct(endUs);
+        char line[128];
+        int n = snprintf(line, sizeof(line), "%9u  %6u", (unsigned)(clocks[c] / 1000), (unsigned)util[c]);
+        for (size_t d = 0; d < 3; ++d)
+        {
+            const auto *s = q.deviceStats(devs[d].addr);
+            n += snprintf(line + n, sizeof(line) - n, "  %6u/%-6u", (unsigned)(s->latency_sum_us / s->transactions),
+                          (unsigned)s->latency_max_us);
+            if (clocks[c] >= 400000)
+                TEST_ASSERT_EQUAL_UINT32(endUs / devs[d].periodUs, s->transactions);
+        }
+        TEST_MESSAGE(line);
+        if (clocks[c] >= 400000)
+            TEST_ASSERT_EQUAL_UINT32(0, q.stats().queue_full);
+        else
+            TEST_ASSERT_TRUE(q.stats().queue_full > 0); // a 14-byte read takes 1.56 ms: 1 kHz doesn't fit
+    }
+    TEST_ASSERT_EQUAL_UINT8(100, util[0]);
+    TEST_ASSERT_TRUE(util[1] > util[2]);
+    TEST_ASSERT_TRUE(util[2] < 25); // 1 MHz leaves most of the bus for more sensors
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_runs_back_to_back_in_submission_order);
+    RUN_TEST(test_nack_and_timeout_counted_per_device);
+    RUN_TEST(test_queue_full_and_stats_window);
+    RUN_TEST(test_exclusive_job_holds_bus_for_its_duration);
+    RUN_TEST(test_clock_sweep_sensor_mix);
+    return UNITY_END();
+}
@@ -0,0 +1,262 @@
+// Host-side tests for the IMU calibration: the batch transform against a per-sample reference,
+// gyro / accel / mag routines on simulated noisy sensors (including the refusals), a full
+// correction round trip, and time per corrected FIFO batch.
+// Run with: pio test -e native -f test_native_imu_calibration -v
+#include <unity.h>
+#include "drivers/imu/imu_calibration.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+
+void setUp() {}
+void tearDown() {}
+
+static constexpr float kAccelPerLsb = IMU_STANDARD_GRAVITY / Mpu9250Fifo::kAccelLsbPerG;
+static constexpr float kGyroPerLsb = 0.0174532925f / Mpu9250Fifo::kGyroLsbPerDps;
+
+// Deterministic noise: sum of 4 uniforms, roughly normal with the given sigma
+static uint32_t rng = 12345;
+static float noise(float sigma)
+{
+    float s = 0.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        rng = rng * 1664525u + 1013904223u;
+        s += (float)(rng >> 8) / 16777216.0f - 0.5f;
+    }
+    return s * sigma * 1.732f; // 4 uniforms on [-0.5, 0.5): variance 1/3
+}
+
+static ImuCalibrationData someCalibration()
+{
+    ImuCalibrationData d = ImuCalibrationData::identity();
+    d.accel_zerog[0] = 0.2f;
+    d.accel_zerog[1] = -0.15f;
+    d.accel_zerog[2] = 0.3f;
+    d.gyro_zerorate[0] = 0.012f;
+    d.gyro_zerorate[1] = -0.02f;
+    d.gyro_zerorate[2] = 0.005f;
+    return d;
+}
+
+void test_batch_transform_matches_per_sample()
+{
+    ImuCalibration cal(someCalibration());
+    cal.setRawScale(kAccelPerLsb, kGyroPerLsb);
+
+    ImuRawSample raw[MPU9250_FIFO_FRAMES];
+    for (size_t i = 0; i < MPU9250_FIFO_FRAMES; ++i)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            raw[i].accel[a] = (int16_t)(i * 97 + a * 1000 - 2000);
+            raw[i].gyro[a] = (int16_t)(a * 300 - (int)i * 13);
+        }
+    }
+    ImuSample out[MPU9250_FIFO_FRAMES];
+    cal.apply(raw, MPU9250_FIFO_FRAMES, out);
+
+    const ImuCalibrationData &d = cal.data();
+    for (size_t i = 0; i < MPU9250_FIFO_FRAMES; ++i)
+    {
+        const float accel[3] = {raw[i].accel[0] * kAccelPerLsb, raw[i].accel[1] * kAccelPerLsb,
+                                raw[i].accel[2] * kAccelPerLsb};
+        const float gyro[3] = {raw[i].gyro[0] * kGyroPerLsb, raw[i].gyro[1] * kGyroPerLsb,
+                               raw[i].gyro[2] * kGyroPerLsb};
+        ImuSample one;
+        cal.apply(accel, gyro, one);
+        for (int a = 0; a < 3; ++a)
+        {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, accel[a] - d.accel_zerog[a], out[i].accel[a]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-6f, gyro[a] - d.gyro_zerorate[a], out[i].gyro[a]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-5f, one.accel[a], out[i].accel[a]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-6f, one.gyro[a], out[i].gyro[a]);
+        }
+    }
+}
+
+// Still and level with a bias; samples corrected by @p cal as they would be on the fusion path
+static void feedStill(ImuCalibrator &c, const ImuCalibration &cal, const float accelBias[3], const float gyroBias[3],
+                      uint32_t n, float gyroSigma = 0.003f, float tiltRad = 0.0f)
+{
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const float accel[3] = {IMU_STANDARD_GRAVITY * sinf(tiltRad) + accelBias[0] + noise(0.05f),
+                                accelBias[1] + noise(0.05f),
+                                IMU_STANDARD_GRAVITY * cosf(tiltRad) + accelBias[2] + noise(0.05f)};
+        const float gyro[3] = {gyroBias[0] + noise(gyroSigma), gyroBias[1] + noise(gyroSigma),
+                               gyroBias[2] + noise(gyroSigma)};
+        ImuSample s;
+        cal.apply(accel, gyro, s);
+        c.add(s, nullptr);
+    }
+}
+
+void test_gyro_and_accel_offsets_from_still_samples()
+{
+    const float accelBias[3] = {0.25f, -0.4f, 0.35f};
+    const float gyroBias[3] = {0.015f, -0.03f, 0.008f};
+
+    // Starting from a previous, partly right calibration: the result adds to it
+    ImuCalibrationData d = ImuCalibrationData::identity();
+    d.gyro_zerorate[0] = 0.01f;
+    d.accel_zerog[2] = 0.1f;
+    ImuCalibration cal(d);
+
+    ImuCalibrator c;
+    c.start(ImuCalKind::Gyro, 2000);
+    feedStill(c, cal, accelBias, gyroBias, 1999);
+    TEST_ASSERT_TRUE(c.running());
+    feedStill(c, cal, accelBias, gyroBias, 1);
+    TEST_ASSERT_EQUAL(ImuCalStatus::Done, c.status());
+    TEST_ASSERT_TRUE(c.result(d));
+    for (int a = 0; a < 3; ++a)
+        TEST_ASSERT_FLOAT_WITHIN(0.0005f, gyroBias[a], d.gyro_zerorate[a]);
+
+    cal.set(d);
+    c.start(ImuCalKind::Accel, 2000);
+    feedStill(c, cal, accelBias, gyroBias, 2000);
+    TEST_ASSERT_EQUAL(ImuCalStatus::Done, c.status());
+    TEST_ASSERT_TRUE(c.result(d));
+    for (int a = 0; a < 3; ++a)
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, accelBias[a], d.accel_zerog[a]);
+
+    // Corrected: gravity straight down, no rate
+    cal.set(d);
+    c.start(ImuCalKind::Gyro, 1000); // reuse the accumulator as a mean
+    feedStill(c, cal, accelBias, gyroBias, 1000);
+    ImuCalibrationData zero{};
+    TEST_ASSERT_TRUE(c.result(zero));
+    for (int a = 0; a < 3; ++a)
+        TEST_ASSERT_FLOAT_WITHIN(0.0005f, 0.0f, zero.gyro_zerorate[a]);
+}
+
+void test_refuses_moving_or_tilted_board()
+{
+    const float zero[3] = {};
+    ImuCalibration cal;
+    ImuCalibrator c;
+    ImuCalibrationData d = ImuCalibrationData::identity();
+
+    c.start(ImuCalKind::Gyro, 500);
+    feedStill(c, cal, zero, zero, 500, /*gyroSigma*/ 0.2f);
+    TEST_ASSERT_EQUAL(ImuCalStatus::Moving, c.status());
+    TEST_ASSERT_FALSE(c.result(d));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, d.gyro_zerorate[0]);
+
+    c.start(ImuCalKind::Accel, 500);
+    feedStill(c, cal, zero, zero, 500, 0.003f, /*tiltRad*/ 0.3f);
+    TEST_ASSERT_EQUAL(ImuCalStatus::NotLevel, c.status());
+    TEST_ASSERT_FALSE(c.result(d));
+
+    c.start(ImuCalKind::Mag, 100);
+    feedStill(c, cal, zero, zero, 100);
+    TEST_ASSERT_EQUAL(ImuCalStatus::NoData, c.status());
+
+    // Nothing collected yet: not done
+    c.start(ImuCalKind::Gyro, 10);
+    TEST_ASSERT_FALSE(c.result(d));
+    c.cancel();
+    TEST_ASSERT_EQUAL(ImuCalStatus::Idle, c.status());
+}
+
+// Earth field of 48 uT seen through a hard iron offset and per-axis gains, turned through
+// @p turns of yaw and a pitch sweep of +-@p pitchRad
+static void feedMag(ImuCalibrator &c, const float hard[3], const float gain[3], uint32_t n, float pitchRad)
+{
+    const ImuSample s{};
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const float t = (float)i / (float)n;
+        const float yaw = 6.2831853f * 3.0f * t;
+        const float pitch = pitchRad * sinf(6.2831853f * 7.0f * t);
+        const float e[3] = {48.0f * cosf(pitch) * cosf(yaw), 48.0f * cosf(pitch) * sinf(yaw), 48.0f * sinf(pitch)};
+        const float raw[3] = {e[0] * gain[0] + hard[0] + noise(0.3f), e[1] * gain[1] + hard[1] + noise(0.3f),
+                              e[2] * gain[2] + hard[2] + noise(0.3f)};
+        c.add(s, raw);
+    }
+}
+
+void test_mag_hard_and_soft_iron_from_rotation()
+{
+    const float hard[3] = {12.0f, -30.0f, 21.0f};
+    const float gain[3] = {1.1f, 0.92f, 1.0f};
+
+    ImuCalibrator c;
+    ImuCalibrationData d = ImuCalibrationData::identity();
+    c.start(ImuCalKind::Mag, 6000);
+    feedMag(c, hard, gain, 6000, 1.5707963f);
+    TEST_ASSERT_EQUAL(ImuCalStatus::Done, c.status());
+    TEST_ASSERT_TRUE(c.result(d));
+    for (int a = 0; a < 3; ++a)
+        TEST_ASSERT_FLOAT_WITHIN(1.0f, hard[a], d.mag_hardiron[a]);
+
+    // Corrected field: same magnitude in every direction
+    ImuCalibration cal(d);
+    float lo = INFINITY, hi = 0.0f;
+    for (int i = 0; i < 360; i += 5)
+    {
+        for (int p = -80; p <= 80; p += 20)
+        {
+            const float yaw = i * 0.0174533f, pitch = p * 0.0174533f;
+            const float e[3] = {48.0f * cosf(pitch) * cosf(yaw), 48.0f * cosf(pitch) * sinf(yaw), 48.0f * sinf(pitch)};
+            const float raw[3] = {e[0] * gain[0] + hard[0], e[1] * gain[1] + hard[1], e[2] * gain[2] + hard[2]};
+            float m[3];
+            cal.applyMag(raw, m);
+            const float r = sqrtf(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+            lo = r < lo ? r : lo;
+            hi = r > hi ? r : hi;
+        }
+    }
+    char line[80];
+    snprintf(line, sizeof(line), "corrected |B| %.2f .. %.2f uT, field %.2f uT", lo, hi, d.mag_field);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(hi - lo < 0.04f * d.mag_field);
+
+    // Yaw only, board kept flat: z never swings, refused
+    c.start(ImuCalKind::Mag, 3000);
+    feedMag(c, hard, gain, 3000, 0.05f);
+    TEST_ASSERT_EQUAL(ImuCalStatus::NoRotation, c.status());
+}
+
+void test_time_per_corrected_batch()
+{
+    ImuCalibration cal(someCalibration());
+    cal.setRawScale(kAccelPerLsb, kGyroPerLsb);
+    ImuRawSample raw[MPU9250_FIFO_FRAMES];
+    for (size_t i = 0; i < MPU9250_FIFO_FRAMES; ++i)
+        for (int a = 0; a < 3; ++a)
+        {
+            raw[i].accel[a] = (int16_t)(i * 31 + a);
+            raw[i].gyro[a] = (int16_t)(i * 7 - a);
+        }
+    ImuSample out[MPU9250_FIFO_FRAMES];
+    const int rounds = 100000;
+    float sink = 0.0f;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        raw[r % MPU9250_FIFO_FRAMES].gyro[0] = (int16_t)r; // keep the loop honest
+        cal.apply(raw, MPU9250_FIFO_FRAMES, out);
+        sink += out[r % MPU9250_FIFO_FRAMES].gyro[0];
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)rounds * MPU9250_FIFO_FRAMES);
+    char line[80];
+    snprintf(line, sizeof(line), "apply: %.2f ns per sample (42-sample batches)", ns);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(sink == sink);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_transform_matches_per_sample);
+    RUN_TEST(test_gyro_and_accel_offsets_from_still_samples);
+    RUN_TEST(test_refuses_moving_or_tilted_board);
+    RUN_TEST(test_mag_hard_and_soft_iron_from_rotation);
+    RUN_TEST(test_time_per_corrected_batch);
+    return UNITY_END();
+}
@@ -0,0 +1,220 @@
+// Host-side tests for the IMU raw mode blocks: packing and decoding, gaps, the serial framing,
+// and the sample rate raw blocks sustain over MQTT and serial links (SimLink) next to one
+// JSON publish per sample, plus the time to pack and frame a block.
+// Run with: pio test -e native -f test_native_imu_raw_block -v
+#include <unity.h>
+#include "telemetry/imu_raw_block.hpp"
+#include "services/transport/sim_link.hpp"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+
+void setUp() {}
+void tearDown() {}
+
+static ImuRawSample sampleAt(uint32_t n)
+{
+    ImuRawSample s;
+    for (int a = 0; a < 3; ++a)
+    {
+        s.accel[a] = (int16_t)(n * 3 + a - 1000);
+        s.gyro[a] = (int16_t)(-(int32_t)n * 7 + a * 11000);
+    }
+    return s;
+}
+
+static ImuRawBlockWriter makeWriter()
+{
+    ImuRawBlockWriter w;
+    w.configure(1000, 2048, 164);
+    w.reset();
+    return w;
+}
+
+void test_blocks_round_trip()
+{
+    ImuRawBlockWriter w = makeWriter();
+    uint32_t n = 0;
+    for (int b = 0; b < 3; ++b)
+    {
+        for (size_t i = 0; i + 1 < IMU_RAW_BLOCK_SAMPLES; ++i, ++n)
+            TEST_ASSERT_FALSE(w.add(sampleAt(n), 5000 + n));
+        TEST_ASSERT_TRUE(w.add(sampleAt(n), 777000u + b));
+        ++n;
+
+        ImuRawBlockInfo info;
+        ImuRawSample out[IMU_RAW_BLOCK_SAMPLES];
+        TEST_ASSERT_EQUAL(IMU_RAW_BLOCK_BYTES, w.blockLength());
+        TEST_ASSERT_TRUE(imuRawBlockDecode(w.block(), w.blockLength(), info, out, IMU_RAW_BLOCK_SAMPLES));
+        TEST_ASSERT_EQUAL(0, info.flags);
+        TEST_ASSERT_EQUAL(1000, info.rate_hz);
+        TEST_ASSERT_EQUAL(2048, info.accel_lsb_per_g);
+        TEST_ASSERT_EQUAL(164, info.gyro_lsb_per_dps_x10);
+        TEST_ASSERT_EQUAL((uint32_t)(b * IMU_RAW_BLOCK_SAMPLES), info.index);
+        TEST_ASSERT_EQUAL(777000u + b, info.t_us);
+        TEST_ASSERT_EQUAL(IMU_RAW_BLOCK_SAMPLES, info.count);
+        for (size_t i = 0; i < IMU_RAW_BLOCK_SAMPLES; ++i)
+        {
+            const ImuRawSample ref = sampleAt(info.index + i);
+            TEST_ASSERT_EQUAL_MEMORY(&ref, &out[i], sizeof(ref));
+        }
+    }
+    TEST_ASSERT_EQUAL(3, w.blocks());
+
+    // Not a block: wrong id, or a length that isn't header + whole samples
+    ImuRawBlockInfo info;
+    uint8_t bad[IMU_RAW_BLOCK_BYTES];
+    memcpy(bad, w.block(), sizeof(bad));
+    TEST_ASSERT_FALSE(imuRawBlockDecode(bad, sizeof(bad) - 1, info, nullptr, 0));
+    bad[0] = 1;
+    TEST_ASSERT_FALSE(imuRawBlockDecode(bad, sizeof(bad), info, nullptr, 0));
+}
+
+void test_lost_samples_show_in_the_index()
+{
+    ImuRawBlockWriter w = makeWriter();
+    for (size_t i = 0; i < IMU_RAW_BLOCK_SAMPLES + 5; ++i)
+        w.add(sampleAt(i), 0); // one block out, 5 samples pending
+
+    w.skip(42); // FIFO overflow: the 5 pending go too
+    ImuRawBlockInfo info;
+    bool full = false;
+    for (size_t i = 0; i < IMU_RAW_BLOCK_SAMPLES; ++i)
+        full = w.add(sampleAt(1000 + i), 0);
+    TEST_ASSERT_TRUE(full);
+    TEST_ASSERT_TRUE(imuRawBlockDecode(w.block(), w.blockLength(), info, nullptr, 0));
+    TEST_ASSERT_EQUAL(IMU_RAW_FLAG_GAP, info.flags);
+    TEST_ASSERT_EQUAL(IMU_RAW_BLOCK_SAMPLES + 5 + 42, info.index);
+
+    // Only the first block after the gap is flagged
+    for (size_t i = 0; i < IMU_RAW_BLOCK_SAMPLES; ++i)
+        w.add(sampleAt(i), 0);
+    TEST_ASSERT_TRUE(imuRawBlockDecode(w.block(), w.blockLength(), info, nullptr, 0));
+    TEST_ASSERT_EQUAL(0, info.flags);
+    TEST_ASSERT_EQUAL(2 * IMU_RAW_BLOCK_SAMPLES + 5 + 42, info.index);
+}
+
+void test_serial_frame()
+{
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, imuRawCrc16(reinterpret_cast<const uint8_t *>("123456789"), 9));
+
+    ImuRawBlockWriter w = makeWriter();
+    for (size_t i = 0; i < IMU_RAW_BLOCK_SAMPLES; ++i)
+        w.add(sampleAt(i), 1234);
+    uint8_t frame[IMU_RAW_BLOCK_BYTES + IMU_RAW_SERIAL_OVERHEAD];
+    TEST_ASSERT_EQUAL(0, imuRawSerialFrame(w.block(), w.blockLength(), frame, sizeof(frame) - 1));
+    const size_t n = imuRawSerialFrame(w.block(), w.blockLength(), frame, sizeof(frame));
+    TEST_ASSERT_EQUAL(IMU_RAW_BLOCK_BYTES + IMU_RAW_SERIAL_OVERHEAD, n);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, frame[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x5A, frame[1]);
+    TEST_ASSERT_EQUAL(IMU_RAW_BLOCK_BYTES, frame[2]);
+    TEST_ASSERT_EQUAL_MEMORY(w.block(), frame + 3, IMU_RAW_BLOCK_BYTES);
+    const uint16_t crc = imuRawCrc16(w.block(), w.blockLength());
+    TEST_ASSERT_EQUAL_HEX8(crc & 0xFF, frame[n - 2]);
+    TEST_ASSERT_EQUAL_HEX8(crc >> 8, frame[n - 1]);
+}
+
+// Highest rate (Hz, 50 Hz steps) at which 10 s of payloads of @p bytesPerPayload, one per
+// @p samplesPerPayload samples, get through @p model without the backlog growing past 200 ms
+static uint32_t sustainableHz(const LinkModel &model, size_t bytesPerPayload, uint32_t samplesPerPayload)
+{
+    uint32_t best = 0;
+    for (uint32_t hz = 50; hz <= 10000; hz += 50)
+    {
+        SimLink link(model, /*reliable*/ true);
+        const uint64_t periodUs = 1000000ull * samplesPerPayload / hz;
+        uint64_t worst = 0;
+        for (uint64_t t = 0; t < 10000000ull; t += periodUs)
+        {
+            uint64_t at = 0;
+            link.schedule(bytesPerPayload, t, at);
+            worst = at - t > worst ? at - t : worst;
+        }
+        if (worst > 200000)
+            break;
+        best = hz;
+    }
+    return best;
+}
+
+void test_sustainable_rate()
+{
+    // On the wire per payload. MQTT: fixed header (3) + topic length (2) + topic, then
+    // TCP/IP (40), one publish per segment. Serial: 10 bits per byte.
+    const char *topic = "Drone/telemetry/imu_raw";
+    const size_t mqttOverhead = 3 + 2 + strlen(topic) + 40;
+    char json[128];
+    const ImuRawSample s = sampleAt(4321);
+    const int jsonLen = snprintf(json, sizeof(json), "{\"ax\":%d,\"ay\":%d,\"az\":%d,\"gx\":%d,\"gy\":%d,\"gz\":%d}",
+                                 s.accel[0], s.accel[1], s.accel[2], s.gyro[0], s.gyro[1], s.gyro[2]);
+
+    struct Link
+    {
+        const char *name;
+        uint32_t bandwidth_Bps;
+        bool serial;
+    } links[] = {
+        {"serial 115200", 11520, true},
+        {"serial 921600", 92160, true},
+        {"MQTT, 1 Mbit/s", 125000, false},
+    };
+
+    TEST_MESSAGE("link              raw blocks   JSON/sample  (Hz sustained)");
+    uint32_t rawSerialFast = 0, rawMqtt = 0;
+    for (const Link &l : links)
+    {
+        LinkModel m;
+        m.bandwidth_Bps = l.bandwidth_Bps;
+        m.latency_us = l.serial ? 0 : 5000;
+        const size_t rawBytes = l.serial ? IMU_RAW_BLOCK_BYTES + IMU_RAW_SERIAL_OVERHEAD : IMU_RAW_BLOCK_BYTES + mqttOverhead;
+        const size_t jsonBytes = l.serial ? (size_t)jsonLen + 1 : (size_t)jsonLen + mqttOverhead; // serial: one line each
+        const uint32_t raw = sustainableHz(m, rawBytes, IMU_RAW_BLOCK_SAMPLES);
+        const uint32_t js = sustainableHz(m, jsonBytes, 1);
+        char line[96];
+        snprintf(line, sizeof(line), "%-16s %8u Hz  %8u Hz   (%u vs %u B/sample)", l.name, (unsigned)raw, (unsigned)js,
+                 (unsigned)(rawBytes / IMU_RAW_BLOCK_SAMPLES), (unsigned)jsonBytes);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_TRUE(raw > js);
+        if (l.bandwidth_Bps == 92160)
+            rawSerialFast = raw;
+        if (!l.serial)
+            rawMqtt = raw;
+    }
+    // 1 kHz must fit the fast serial port and a modest MQTT link
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1000, rawSerialFast);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1000, rawMqtt);
+}
+
+void test_time_per_block()
+{
+    ImuRawBlockWriter w = makeWriter();
+    uint8_t frame[IMU_RAW_BLOCK_BYTES + IMU_RAW_SERIAL_OVERHEAD];
+    const uint32_t samples = 2000000;
+    size_t sink = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < samples; ++n)
+    {
+        if (w.add(sampleAt(n), n))
+            sink += imuRawSerialFrame(w.block(), w.blockLength(), frame, sizeof(frame)) + frame[20];
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / samples;
+    char line[96];
+    snprintf(line, sizeof(line), "pack + serial frame: %.1f ns per sample (%.2f us per block)", ns,
+             ns * IMU_RAW_BLOCK_SAMPLES / 1000.0);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(sink > 0);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_blocks_round_trip);
+    RUN_TEST(test_lost_samples_show_in_the_index);
+    RUN_TEST(test_serial_frame);
+    RUN_TEST(test_sustainable_rate);
+    RUN_TEST(test_time_per_block);
+    return UNITY_END();
+}
@@ -0,0 +1,463 @@
+// Host-side tests and benchmarks for ImuReplay: a recorded IMU run (raw blocks in a blackbox
+// log, or the decoders' CSV) through the IMU's fusion and encoding path, the class queue,
+// stream stats and a TX loop like TelemetryService's, into the loopback broker.
+// Stepped replay gives reproducible throughput per encoding; real-time replay the
+// capture-to-hand-off age the device would report.
+// Run with: pio test -e native -f test_native_imu_replay -v
+#include <unity.h>
+#include "telemetry/sensors/imu_replay.hpp"
+#include "telemetry/blackbox_log.hpp"
+#include "telemetry/imu_raw_block.hpp"
+#include "telemetry/telemetry_class_queue.hpp"
+#include "services/transport/loopback_transport.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+static constexpr uint32_t kRecordHz = 1000;
+static constexpr uint32_t kRecordS = 10;
+
+// ===== Recording ==============================================================
+
+// Level, then a turn about z at 45 deg/s for 2 s (90 deg), then still again, with a little noise
+static std::vector<ImuRawSample> recording()
+{
+    std::vector<ImuRawSample> out;
+    uint32_t seed = 12345;
+    auto noise = [&seed]() -> int16_t
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (int16_t)((seed >> 24) % 7) - 3;
+    };
+    for (uint32_t i = 0; i < kRecordHz * kRecordS; ++i)
+    {
+        const bool turning = i >= 3 * kRecordHz && i < 5 * kRecordHz;
+        ImuRawSample s;
+        s.accel[0] = noise();
+        s.accel[1] = noise();
+        s.accel[2] = (int16_t)(2048 + noise());
+        s.gyro[0] = noise();
+        s.gyro[1] = noise();
+        s.gyro[2] = (int16_t)(turning ? lroundf(45.0f * 16.4f) : noise());
+        out.push_back(s);
+    }
+    return out;
+}
+
+// The samples as the IMU logs them in raw mode: ImuRawBlockWriter blocks in blackbox frames
+static std::vector<uint8_t> blackboxLog(const std::vector<ImuRawSample> &samples)
+{
+    ImuRawBlockWriter w;
+    w.configure(kRecordHz, 2048, 164);
+    w.reset();
+    static BlackboxStager stager; // 16 KB of staging
+    stager.reset();
+    std::vector<uint8_t> log;
+    auto drain = [&]()
+    {
+        while (const uint8_t *b = stager.front())
+        {
+            log.insert(log.end(), b, b + BLACKBOX_BLOCK_SIZE);
+            stager.pop();
+        }
+    };
+    const uint32_t t0 = 0xFFFF0000u; // wraps during the recording
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        if (w.add(samples[i], t0 + (uint32_t)(i * (1000000 / kRecordHz))))
+            TEST_ASSERT_TRUE(stager.append(t0 + (uint32_t)i * 1000, w.block(), w.blockLength()));
+        drain();
+    }
+    stager.seal();
+    drain();
+    return log;
+}
+
+// The same samples as tools/imu_raw_rx.py writes them
+static void writeCsv(const char *path, const std::vector<ImuRawSample> &samples)
+{
+    FILE *f = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(f);
+    fprintf(f, "index,t_us,ax_g,ay_g,az_g,gx_dps,gy_dps,gz_dps\n");
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        const ImuRawSample &s = samples[i];
+        fprintf(f, "%u,%u,%.5f,%.5f,%.5f,%.5f,%.5f,%.5f\n", (unsigned)i, (unsigned)(5000 + i * 1000),
+                s.accel[0] / 2048.0, s.accel[1] / 2048.0, s.accel[2] / 2048.0, s.gyro[0] * 10.0 / 164,
+                s.gyro[1] * 10.0 / 164, s.gyro[2] * 10.0 / 164);
+    }
+    fclose(f);
+}
+
+// ===== Telemetry pipeline =====================================================
+
+/**
+ * TelemetryService's sink and TX loop on the host: pool, topic table, stream stats and class
+ * queue wired like on the device, the TX loop publishing to a LoopbackTransport. The queue
+ * lock stands in for _txMux.
+ */
+struct HostTelemetry : ITelemetrySink
+{
+    TelemetryBufferPool pool;
+    TelemetryTopicTable topics;
+    TelemetryStreamStats streamStats;
+    TelemetryClassQueue txq;
+    std::mutex mx;
+    std::condition_variable cv;
+    IMqttTransport *mqtt{nullptr};
+    uint64_t sent{0};
+    uint64_t bytes{0};
+    uint32_t hash{2166136261u}; ///< FNV-1a over every payload sent, in order
+    TelemetryOfflinePolicy offline{TelemetryOfflinePolicy::Drop}; ///< Of the last sample sent
+
+    HostTelemetry() { topics.setPrefix("Drone"); }
+
+    void wire(ITelemetryProvider &p)
+    {
+        p.setOutput(this);
+        p.setBufferPool(&pool);
+        p.setTopicTable(&topics);
+        p.setStreamStats(&streamStats);
+    }
+
+    bool enqueue(const TelemetrySample &sample, TickType_t, bool latestOnly) override
+    {
+        TelemetrySample displaced{};
+        TelemetryClassQueue::Push r;
+        {
+            std::lock_guard<std::mutex> lock(mx);
+            r = txq.push(sample, displaced, latestOnly);
+        }
+        if (r == TelemetryClassQueue::Push::Refused)
+        {
+            streamStats.enqueueDropped(sample.stream);
+            return false;
+        }
+        if (r == TelemetryClassQueue::Push::Displaced)
+        {
+            streamStats.enqueueDropped(displaced.stream);
+            pool.release(displaced.buffer);
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    /// One TX loop turn. @return false if nothing was queued.
+    bool txOnce()
+    {
+        TelemetrySample s;
+        {
+            std::lock_guard<std::mutex> lock(mx);
+            if (!txq.pop(s))
+                return false;
+        }
+        const char *topic = topics.topic(s.stream);
+        if (mqtt)
+            mqtt->publish(topic, s.meta.qos, s.meta.retain, reinterpret_cast<const char *>(s.payload),
+                          s.payload_length);
+        for (size_t i = 0; i < s.payload_length; ++i)
+            hash = (hash ^ s.payload[i]) * 16777619u;
+        bytes += s.payload_length;
+        sent++;
+        offline = s.meta.offline;
+        streamStats.transmitted(s.stream, TelemetryStreamStats::Outcome::Sent, s.t_us,
+                                (uint32_t)esp_timer_get_time());
+        pool.release(s.buffer);
+        return true;
+    }
+};
+
+static std::vector<uint8_t> &sharedLog()
+{
+    static std::vector<uint8_t> log = blackboxLog(recording());
+    return log;
+}
+
+static double wrap180(double deg)
+{
+    while (deg > 180.0)
+        deg -= 360.0;
+    while (deg <= -180.0)
+        deg += 360.0;
+    return deg;
+}
+
+// Stepped replay to the end, TX after every sample()
+static void playStepped(ImuReplay &replay, HostTelemetry &tx)
+{
+    while (!replay.finished())
+    {
+        replay.sample();
+        while (tx.txOnce())
+        {
+        }
+    }
+}
+
+// ===== Tests ==================================================================
+
+// The blackbox logs every FIFO sample: per-sample output is what one-sample batches give
+void test_fuse_batch_attitude_per_sample()
+{
+    const std::vector<ImuRawSample> rec = recording();
+    ImuCalibration cal;
+    cal.setRawScale(IMU_STANDARD_GRAVITY / 2048.0f, 0.0174532925f / 16.4f); // the recording's ranges
+    AhrsFilter batched, stepped;
+    batched.setSampleRate((float)kRecordHz);
+    stepped.setSampleRate((float)kRecordHz);
+
+    const size_t n = 16;
+    ImuSample scaled[n];
+    float attitude[3];
+    float perSample[n][3];
+    for (size_t start = 3 * kRecordHz; start < 3 * kRecordHz + 20 * n; start += n)
+    {
+        imuFuseBatch(cal, batched, &rec[start], n, nullptr, scaled, attitude, perSample);
+        for (size_t i = 0; i < n; ++i)
+        {
+            float one[3];
+            imuFuseBatch(cal, stepped, &rec[start + i], 1, nullptr, scaled, one);
+            for (int k = 0; k < 3; ++k)
+                TEST_ASSERT_EQUAL_FLOAT(one[k], perSample[i][k]);
+        }
+        for (int k = 0; k < 3; ++k)
+            TEST_ASSERT_EQUAL_FLOAT(perSample[n - 1][k], attitude[k]);
+    }
+    TEST_ASSERT_TRUE(perSample[0][2] != perSample[n - 1][2]); // turning: the samples differ
+}
+
+void test_blackbox_replay()
+{
+    const std::vector<uint8_t> &log = sharedLog();
+    ImuReplay replay(1000, "telemetry/imu", TelemetryContentType::BINARY);
+    TEST_ASSERT_FALSE(replay.begin()); // nothing loaded
+    TEST_ASSERT_TRUE(replay.loadBlackbox(log.data(), log.size()));
+    TEST_ASSERT_EQUAL(kRecordHz * kRecordS, replay.samples());
+    TEST_ASSERT_EQUAL(kRecordHz, replay.recordedHz());
+    TEST_ASSERT_EQUAL(kRecordS * 1000000u, replay.durationUs());
+
+    HostTelemetry tx;
+    tx.wire(replay);
+    TEST_ASSERT_TRUE(replay.begin());
+    replay.onSamplingRateChange(100); // leased at 100 Hz: drained at 1 kHz, every 10th published
+    playStepped(replay, tx);
+
+    const ImuReplay::Stats &st = replay.stats();
+    TEST_ASSERT_EQUAL(kRecordHz * kRecordS, st.fused);
+    TEST_ASSERT_EQUAL(kRecordHz * kRecordS, st.batches); // one recorded sample per 1 kHz step
+    TEST_ASSERT_EQUAL(100 * kRecordS, st.published);
+    TEST_ASSERT_EQUAL(100 * kRecordS, tx.sent);
+    TEST_ASSERT_EQUAL(7 * 100 * kRecordS, tx.bytes); // packed schema 1
+
+    // Level throughout, turned 90 deg (the sign is the filter's NWU convention)
+    const float *a = replay.attitude();
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, a[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f, 0.0f, a[1]);
+    TEST_ASSERT_FLOAT_WITHIN(2.0, 90.0, fabs(wrap180(a[2])));
+
+    // Not a log with raw blocks
+    const uint8_t junk[64] = {};
+    TEST_ASSERT_FALSE(replay.loadBlackbox(junk, sizeof(junk)));
+}
+
+void test_replays_are_reproducible()
+{
+    // Stepped: the same payload bytes on every run, and from the CSV as from the log
+    const char *csv = "/tmp/test_native_imu_replay.csv";
+    writeCsv(csv, recording());
+    const std::vector<uint8_t> &log = sharedLog();
+
+    uint32_t hashes[3];
+    float yaw[3];
+    for (int run = 0; run < 3; ++run)
+    {
+        ImuReplay replay(200, "telemetry/imu", TelemetryContentType::DELTA);
+        TEST_ASSERT_TRUE(run == 2 ? replay.loadCsv(csv) : replay.loadBlackbox(log.data(), log.size()));
+        TEST_ASSERT_EQUAL(kRecordHz, replay.recordedHz());
+        HostTelemetry tx;
+        tx.wire(replay);
+        TEST_ASSERT_TRUE(replay.begin());
+        playStepped(replay, tx);
+        TEST_ASSERT_EQUAL(kRecordHz * kRecordS, replay.stats().fused);
+        TEST_ASSERT_EQUAL(200 * kRecordS + 1, tx.sent); // the drain at t = 0 takes the first sample alone
+        hashes[run] = tx.hash;
+        yaw[run] = replay.attitude()[2];
+    }
+    TEST_ASSERT_EQUAL_HEX32(hashes[0], hashes[1]);
+    TEST_ASSERT_EQUAL_HEX32(hashes[0], hashes[2]);
+    TEST_ASSERT_EQUAL_FLOAT(yaw[0], yaw[2]);
+    remove(csv);
+}
+
+void test_delta_stream_is_dropped_offline()
+{
+    // Coalescing keeps only the last delta of an outage, whose predecessors the receiver
+    // never gets: DELTA payloads are dropped offline, the absolute encodings keep the latest
+    const std::vector<uint8_t> &log = sharedLog();
+    const TelemetryContentType encodings[] = {TelemetryContentType::JSON, TelemetryContentType::CBOR,
+                                              TelemetryContentType::BINARY, TelemetryContentType::DELTA};
+    for (TelemetryContentType enc : encodings)
+    {
+        ImuReplay replay(1000, "telemetry/imu", enc);
+        TEST_ASSERT_TRUE(replay.loadBlackbox(log.data(), log.size()));
+        HostTelemetry tx;
+        tx.wire(replay);
+        TEST_ASSERT_TRUE(replay.begin());
+        replay.sample();
+        TEST_ASSERT_TRUE(tx.txOnce());
+        TEST_ASSERT_EQUAL(enc == TelemetryContentType::DELTA ? TelemetryOfflinePolicy::Drop
+                                                             : TelemetryOfflinePolicy::Coalesce,
+                          tx.offline);
+    }
+}
+
+void test_stepped_throughput()
+{
+    // Sensor to publish at the full 1 kHz, per encoding: replay.sample() (fusion, encoding,
+    // enqueue) and the TX turn (pop, topic, loopback publish, stats) timed apart
+    const std::vector<uint8_t> &log = sharedLog();
+    const TelemetryContentType encodings[] = {TelemetryContentType::JSON, TelemetryContentType::CBOR,
+                                              TelemetryContentType::BINARY, TelemetryContentType::DELTA};
+    const char *names[] = {"JSON", "CBOR", "BINARY", "DELTA"};
+    TEST_MESSAGE("encoding  samples/s   sample() ns  TX ns   bytes/sample  (1 kHz stepped, 3 laps)");
+    for (size_t e = 0; e < 4; ++e)
+    {
+        LoopbackBroker broker;
+        LoopbackTransport mqtt(broker);
+        std::atomic<bool> up{false};
+        mqtt.onConnect([&](bool)
+                       { up = true; });
+        mqtt.connect();
+        const uint64_t until = LoopbackBroker::nowUs() + 2000000;
+        while (!up.load() && LoopbackBroker::nowUs() < until)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        TEST_ASSERT_TRUE(up.load());
+
+        ImuReplay replay(1000, "telemetry/imu", encodings[e]);
+        TEST_ASSERT_TRUE(replay.loadBlackbox(log.data(), log.size()));
+        replay.setLoop(true);
+        HostTelemetry tx;
+        tx.mqtt = &mqtt;
+        tx.wire(replay);
+        TEST_ASSERT_TRUE(replay.begin());
+
+        const uint32_t steps = 3 * kRecordHz * kRecordS;
+        std::chrono::steady_clock::duration inSample{}, inTx{};
+        for (uint32_t i = 0; i < steps; ++i)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            replay.sample();
+            const auto t1 = std::chrono::steady_clock::now();
+            while (tx.txOnce())
+            {
+            }
+            inSample += t1 - t0;
+            inTx += std::chrono::steady_clock::now() - t1;
+        }
+        TEST_ASSERT_TRUE(broker.waitIdle());
+        TEST_ASSERT_EQUAL(steps, replay.stats().fused);
+        TEST_ASSERT_EQUAL(2, replay.stats().laps);
+        TEST_ASSERT_EQUAL(steps, tx.sent);
+        TEST_ASSERT_EQUAL(0, replay.stats().no_buffer + replay.stats().refused);
+        TEST_ASSERT_EQUAL_UINT64(steps, broker.stats().published);
+
+        const double sampleNs = std::chrono::duration<double, std::nano>(inSample).count() / steps;
+        const double txNs = std::chrono::duration<double, std::nano>(inTx).count() / steps;
+        char line[128];
+        snprintf(line, sizeof(line), "%-8s %10.0f  %10.0f  %6.0f  %8.1f", names[e], 1e9 / (sampleNs + txNs), sampleNs,
+                 txNs, (double)tx.bytes / tx.sent);
+        TEST_MESSAGE(line);
+    }
+}
+
+void test_real_time_age()
+{
+    // 10 s of recording at 10x: a sampling thread at the drain rate and a TX thread woken by
+    // enqueue, like the two tasks on the device. Age is capture (sample()) to hand-off.
+    const std::vector<uint8_t> &log = sharedLog();
+    LoopbackBroker broker;
+    LoopbackTransport mqtt(broker);
+    std::atomic<bool> up{false};
+    mqtt.onConnect([&](bool)
+                   { up = true; });
+    mqtt.connect();
+    const uint64_t until = LoopbackBroker::nowUs() + 2000000;
+    while (!up.load() && LoopbackBroker::nowUs() < until)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    TEST_ASSERT_TRUE(up.load());
+
+    const float speed = 10.0f;
+    ImuReplay replay(200, "telemetry/imu", TelemetryContentType::CBOR);
+    TEST_ASSERT_TRUE(replay.loadBlackbox(log.data(), log.size()));
+    replay.setSpeed(speed);
+    HostTelemetry tx;
+    tx.mqtt = &mqtt;
+    tx.wire(replay);
+    TEST_ASSERT_TRUE(replay.begin());
+
+    std::atomic<bool> done{false};
+    std::thread txThread([&]()
+                         {
+        for (;;)
+        {
+            if (tx.txOnce())
+                continue;
+            if (done.load())
+                break;
+            std::unique_lock<std::mutex> lock(tx.mx);
+            tx.cv.wait_for(lock, std::chrono::milliseconds(1));
+        } });
+
+    const auto period = std::chrono::nanoseconds((uint64_t)(1e9 / (replay.sampleRateHz() * speed)));
+    const auto t0 = std::chrono::steady_clock::now();
+    auto next = t0;
+    while (!replay.finished())
+    {
+        replay.sample();
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+    const double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    done = true;
+    txThread.join();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+
+    const ImuReplay::Stats &st = replay.stats();
+    const TelemetryStreamStats::Snapshot snap = tx.streamStats.snapshot(0, true);
+    char line[160];
+    snprintf(line, sizeof(line),
+             "10x real time: %.0f ms for %u ms of recording, %u batches, %u published, age p50 %u us p90 %u us "
+             "p99 %u us max %u us",
+             wallMs, (unsigned)(replay.durationUs() / 1000), (unsigned)st.batches, (unsigned)st.published,
+             (unsigned)snap.age_p50_us, (unsigned)snap.age_p90_us, (unsigned)snap.age_p99_us,
+             (unsigned)snap.age_max_us);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(kRecordHz * kRecordS, st.fused);
+    TEST_ASSERT_EQUAL(st.published, snap.sent);
+    TEST_ASSERT_EQUAL(0, snap.enqueue_drops);
+    TEST_ASSERT_TRUE(wallMs > 0.9 * replay.durationUs() / 1000.0 / speed);
+    TEST_ASSERT_TRUE(st.published > 200 * kRecordS / 2); // a late step fuses more at once, it publishes once
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fuse_batch_attitude_per_sample);
+    RUN_TEST(test_blackbox_replay);
+    RUN_TEST(test_replays_are_reproducible);
+    RUN_TEST(test_delta_stream_is_dropped_offline);
+    RUN_TEST(test_stepped_throughput);
+    RUN_TEST(test_real_time_age);
+    return UNITY_END();
+}
@@ -0,0 +1,203 @@
+// Host-side tests for the QoS1/2 in-flight window: windows, acks that beat publish()'s
+// return, timeouts and disconnects.
+// Run with: pio test -e native -f test_native_inflight_window -v
+#include <unity.h>
+#include "services/mqtt_inflight_window.hpp"
+#include "services/transport/imqtt_transport.hpp"
+
+#include <stdio.h>
+
+using MqttService::InFlightWindow;
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * Transport whose PUBACK is handled before publish() returns, like AsyncMqttClient when
+ * the async_tcp task gets the ack while the publishing task is still inside publish().
+ */
+struct EagerAckTransport : IMqttTransport
+{
+    uint16_t nextId = 0;
+    bool ackInline = true;
+
+    void connect() override {}
+    void disconnect() override {}
+    bool connected() const override { return true; }
+    uint16_t publish(const char *, uint8_t qos, bool, const char *, size_t) override
+    {
+        const uint16_t id = qos ? ++nextId : 1;
+        if (qos && ackInline && _onPublish)
+            _onPublish(id);
+        return id;
+    }
+    uint16_t subscribe(const char *, uint8_t) override { return 0; }
+    uint16_t unsubscribe(const char *) override { return 0; }
+};
+
+// MqttService::sendNow() and onMqttPublish() around the window (locking left out)
+struct Sender
+{
+    InFlightWindow window;
+    EagerAckTransport t;
+    uint32_t now = 1000;
+
+    Sender()
+    {
+        t.onPublish([this](uint16_t id)
+                    { window.ack(id, now + 300); });
+    }
+
+    bool send(uint8_t qos)
+    {
+        const int slot = window.reserve(qos, now);
+        if (slot < 0)
+            return false;
+        const uint16_t id = t.publish("d/x", qos, false, "1", 1);
+        if (id == 0)
+        {
+            window.release(slot);
+            return false;
+        }
+        window.assign(slot, id);
+        return true;
+    }
+};
+
+void test_window_limits_outstanding_publishes()
+{
+    InFlightWindow w;
+    w.setWindow(1, 2);
+    TEST_ASSERT_TRUE(w.reserve(1, 0) >= 0);
+    TEST_ASSERT_TRUE(w.reserve(1, 0) >= 0);
+    TEST_ASSERT_FALSE(w.hasRoom(1));
+    TEST_ASSERT_EQUAL(-1, w.reserve(1, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().window_full);
+    TEST_ASSERT_TRUE(w.hasRoom(2)); // per QoS
+    TEST_ASSERT_TRUE(w.hasRoom(0)); // QoS0 is never tracked
+    TEST_ASSERT_EQUAL(-1, w.reserve(0, 0));
+}
+
+void test_ack_before_id_is_matched()
+{
+    Sender s;
+    for (int i = 0; i < 100; ++i)
+        TEST_ASSERT_TRUE(s.send(1 + i % 2));
+
+    const MqttService::AckStats &st = s.window.stats();
+    TEST_ASSERT_EQUAL_UINT32(100, st.acked);
+    TEST_ASSERT_EQUAL_UINT32(100, st.early);
+    TEST_ASSERT_EQUAL_UINT32(0, st.unknown);
+    TEST_ASSERT_EQUAL(0, s.window.count(1)); // nothing left waiting for the timeout
+    TEST_ASSERT_EQUAL(0, s.window.count(2));
+    TEST_ASSERT_EQUAL_UINT32(300, st.latency_max_us);
+}
+
+void test_early_ack_with_several_unassigned_slots()
+{
+    InFlightWindow w;
+    const int a = w.reserve(1, 0);
+    const int b = w.reserve(1, 0);
+    w.ack(8, 50); // b's ack, before either id is known
+    TEST_ASSERT_FALSE(w.assign(a, 7));
+    TEST_ASSERT_TRUE(w.assign(b, 8));
+    TEST_ASSERT_EQUAL(1, w.count(1));
+    w.ack(7, 90);
+    TEST_ASSERT_EQUAL(0, w.count(1));
+    TEST_ASSERT_EQUAL_UINT32(2, w.stats().acked);
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().early);
+    TEST_ASSERT_EQUAL_UINT32(0, w.stats().unknown);
+}
+
+void test_stray_acks_are_unknown()
+{
+    InFlightWindow w;
+    w.ack(3, 0); // nothing in flight
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().unknown);
+
+    // Parked while a slot waited for its id, then that slot got a different id
+    const int a = w.reserve(1, 0);
+    w.ack(4, 10);
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().unknown);
+    TEST_ASSERT_FALSE(w.assign(a, 5));
+    TEST_ASSERT_EQUAL_UINT32(2, w.stats().unknown);
+    TEST_ASSERT_EQUAL(1, w.count(1));
+}
+
+void test_client_refusal_frees_the_slot()
+{
+    InFlightWindow w;
+    w.setWindow(1, 1);
+    const int a = w.reserve(1, 0);
+    w.release(a);
+    w.clientFull();
+    TEST_ASSERT_TRUE(w.hasRoom(1));
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().client_full);
+}
+
+void test_timeout_frees_only_assigned_slots()
+{
+    InFlightWindow w;
+    w.setWindow(1, 2);
+    const int a = w.reserve(1, 0);
+    w.assign(a, 1);
+    const int b = w.reserve(1, 0); // publish() still running
+    const uint32_t late = MQTT_INFLIGHT_TIMEOUT_MS * 1000u + 1;
+    const int c = w.reserve(1, late);
+    TEST_ASSERT_TRUE(c >= 0);
+    TEST_ASSERT_TRUE(c != b);
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().timed_out);
+    TEST_ASSERT_FALSE(w.assign(b, 2));
+    TEST_ASSERT_EQUAL(2, w.count(1));
+}
+
+void test_disconnect_during_publish_keeps_the_slot_private()
+{
+    InFlightWindow w;
+    w.setWindow(1, 4);
+    const int sent = w.reserve(1, 0);
+    w.assign(sent, 1);
+    const int racing = w.reserve(1, 0); // publish() running when the connection drops
+    w.clear();
+    TEST_ASSERT_EQUAL_UINT32(2, w.stats().abandoned);
+    TEST_ASSERT_EQUAL(1, w.count(1));
+
+    const int next = w.reserve(1, 10); // after reconnect
+    TEST_ASSERT_TRUE(next != racing);
+    TEST_ASSERT_FALSE(w.assign(racing, 9)); // freed, not written into `next`
+    TEST_ASSERT_EQUAL(1, w.count(1));
+    TEST_ASSERT_FALSE(w.assign(next, 2));
+    w.ack(2, 20);
+    TEST_ASSERT_EQUAL(0, w.count(1));
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().acked);
+}
+
+void test_eager_acks_keep_the_window_open()
+{
+    // Without matching early acks every publish would sit in the window until the timeout
+    Sender s;
+    s.window.setWindow(1, 4);
+    uint32_t sent = 0;
+    for (int i = 0; i < 1000; ++i)
+        sent += s.send(1) ? 1 : 0;
+    char line[120];
+    snprintf(line, sizeof(line), "eager acks: %u/1000 sent through a 4-deep window, %u early, %u refused",
+             (unsigned)sent, (unsigned)s.window.stats().early, (unsigned)s.window.stats().window_full);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(1000, sent);
+    TEST_ASSERT_EQUAL_UINT32(0, s.window.stats().window_full);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_window_limits_outstanding_publishes);
+    RUN_TEST(test_ack_before_id_is_matched);
+    RUN_TEST(test_early_ack_with_several_unassigned_slots);
+    RUN_TEST(test_stray_acks_are_unknown);
+    RUN_TEST(test_client_refusal_frees_the_slot);
+    RUN_TEST(test_timeout_frees_only_assigned_slots);
+    RUN_TEST(test_disconnect_during_publish_keeps_the_slot_private);
+    RUN_TEST(test_eager_acks_keep_the_window_open);
+    return UNITY_END();
+}
@@ -0,0 +1,296 @@
+// Host-side tests for the MPU9250 FIFO driver against a simulated sensor in virtual time,
+// incl. the bus time of polling at 100 Hz vs draining a 1 kHz FIFO at 100 Hz.
+// Run with: pio test -e native -f test_native_mpu9250_fifo -v
+#include <unity.h>
+#include "drivers/imu/mpu9250_fifo.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+void setUp() {}
+void tearDown() {}
+
+static uint32_t g_now = 0;
+
+// MPU9250 register file with a FIFO that fills on the sensor's clock. Each frame carries a
+// running sample number in accel X (and its negation in gyro Z) so gaps are visible.
+class FakeMpu final : public II2cBackend
+{
+public:
+    uint8_t regs[128]{};
+    uint8_t fifo[MPU9250_FIFO_BYTES]{};
+    size_t fifoHead{0};
+    size_t fifoCount{0};
+    bool overflowFlag{false};
+    uint32_t lastFillUs{0};
+    uint32_t accUs{0};
+    int16_t next{0};
+    uint32_t clockHz{400000};
+    uint32_t busUs{0};      ///< Time spent transferring
+    size_t maxRead{0};      ///< Longest burst
+    uint32_t fifoReads{0};
+
+    uint32_t bitsUs(uint32_t bits) const { return (bits * 1000000u + clockHz - 1) / clockHz; }
+
+    uint32_t rateHz() const { return 1000u / (regs[0x19] + 1u); }
+    bool running() const { return (regs[0x6A] & 0x40) && regs[0x23] == 0x78; }
+
+    void push(uint8_t b)
+    {
+        if (fifoCount == MPU9250_FIFO_BYTES)
+        {
+            // FIFO_MODE 0: overwrite the oldest byte
+            fifoHead = (fifoHead + 1) % MPU9250_FIFO_BYTES;
+            fifoCount--;
+            overflowFlag = true;
+        }
+        fifo[(fifoHead + fifoCount) % MPU9250_FIFO_BYTES] = b;
+        fifoCount++;
+    }
+
+    // Sensor side: one frame per sample period since the last call
+    void fill()
+    {
+        const uint32_t period = 1000000u / rateHz();
+        accUs += g_now - lastFillUs;
+        lastFillUs = g_now;
+        if (!running())
+        {
+            accUs = 0;
+            return;
+        }
+        while (accUs >= period)
+        {
+            accUs -= period;
+            const int16_t v[6] = {next, 0, 2048, 0, 0, (int16_t)-next};
+            next++;
+            for (int16_t x : v)
+            {
+                push((uint8_t)((uint16_t)x >> 8));
+                push((uint8_t)x);
+            }
+        }
+    }
+
+    I2cStatus transfer(uint8_t addr, const uint8_t *tx, size_t txLen, uint8_t *rx, size_t rxLen) override
+    {
+        if (addr != 0x68)
+            return I2cStatus::Nack;
+        fill();
+        uint32_t bits = 1 + 9 + 9 * (uint32_t)txLen + 1;
+        if (rxLen)
+            bits += 1 + 9 + 9 * (uint32_t)rxLen;
+        busUs += bitsUs(bits);
+        g_now += bitsUs(bits);
+
+        const uint8_t reg = tx[0];
+        if (txLen == 2)
+        {
+            regs[reg] = tx[1];
+            if (reg == 0x6A && (tx[1] & 0x04))
+            {
+                fifoHead = fifoCount = 0;
+                regs[0x6A] = tx[1] & ~0x04;
+            }
+            return I2cStatus::Ok;
+        }
+        for (size_t i = 0; i < rxLen; ++i)
+        {
+            if (reg == 0x3A)
+            {
+                rx[i] = overflowFlag ? 0x10 : 0; // read clears
+                overflowFlag = false;
+            }
+            else if (reg == 0x72)
+            {
+                rx[i] = i == 0 ? (uint8_t)(fifoCount >> 8) : (uint8_t)fifoCount;
+            }
+            else if (reg == 0x74)
+            {
+                rx[i] = fifo[fifoHead];
+                fifoHead = (fifoHead + 1) % MPU9250_FIFO_BYTES;
+                fifoCount--;
+            }
+            else
+            {
+                rx[i] = regs[reg + i];
+            }
+        }
+        if (reg == 0x74)
+        {
+            fifoReads++;
+            if (rxLen > maxRead)
+                maxRead = rxLen;
+        }
+        return I2cStatus::Ok;
+    }
+};
+
+// Drain every periodUs until untilUs; checks the frames come out in sensor order
+static uint32_t drainEvery(Mpu9250Fifo &f, FakeMpu &mpu, uint32_t periodUs, uint32_t untilUs, int16_t &expect,
+                           uint32_t &gaps)
+{
+    ImuRawSample batch[MPU9250_FIFO_FRAMES];
+    uint32_t got = 0;
+    while (g_now < untilUs)
+    {
+        const uint32_t start = g_now;
+        size_t n = 0;
+        TEST_ASSERT_EQUAL(I2cStatus::Ok, f.drain(mpu, batch, MPU9250_FIFO_FRAMES, n));
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (batch[i].accel[0] != expect)
+                gaps++;
+            TEST_ASSERT_EQUAL_INT16(-batch[i].accel[0], batch[i].gyro[2]);
+            TEST_ASSERT_EQUAL_INT16(2048, batch[i].accel[2]); // 1 g at ±16 g
+            expect = (int16_t)(batch[i].accel[0] + 1);
+        }
+        got += (uint32_t)n;
+        g_now = start + periodUs;
+    }
+    return got;
+}
+
+void test_configure_sets_rate_and_starts_fifo()
+{
+    g_now = 0;
+    FakeMpu mpu;
+    Mpu9250Fifo f;
+    TEST_ASSERT_FALSE(f.configured());
+    TEST_ASSERT_EQUAL(I2cStatus::Ok, f.configure(mpu, 0x68, 1000, g_now));
+    TEST_ASSERT_EQUAL_UINT8(0, mpu.regs[0x19]);
+    TEST_ASSERT_EQUAL_UINT32(1000, f.rateHz());
+    TEST_ASSERT_TRUE(mpu.running());
+
+    TEST_ASSERT_EQUAL(I2cStatus::Ok, f.configure(mpu, 0x68, 200, g_now));
+    TEST_ASSERT_EQUAL_UINT8(4, mpu.regs[0x19]);
+    TEST_ASSERT_EQUAL_UINT32(200, f.rateHz());
+
+    // Not a divider of 1 kHz: nearest one
+    TEST_ASSERT_EQUAL(I2cStatus::Ok, f.configure(mpu, 0x68, 300, g_now));
+    TEST_ASSERT_EQUAL_UINT32(333, f.rateHz());
+
+    Mpu9250Fifo absent;
+    TEST_ASSERT_EQUAL(I2cStatus::Nack, absent.configure(mpu, 0x69, 1000, g_now));
+    TEST_ASSERT_FALSE(absent.configured());
+    TEST_ASSERT_EQUAL_UINT32(1, absent.stats().errors);
+}
+
+void test_parse_is_big_endian_accel_then_gyro()
+{
+    const uint8_t frame[12] = {0x01, 0x02, 0xFF, 0xFE, 0x08, 0x00, 0x80, 0x00, 0x7F, 0xFF, 0x00, 0x10};
+    ImuRawSample s;
+    Mpu9250Fifo::parse(frame, s);
+    TEST_ASSERT_EQUAL_INT16(0x0102, s.accel[0]);
+    TEST_ASSERT_EQUAL_INT16(-2, s.accel[1]);
+    TEST_ASSERT_EQUAL_INT16(2048, s.accel[2]);
+    TEST_ASSERT_EQUAL_INT16(-32768, s.gyro[0]);
+    TEST_ASSERT_EQUAL_INT16(32767, s.gyro[1]);
+    TEST_ASSERT_EQUAL_INT16(16, s.gyro[2]);
+}
+
+void test_no_samples_lost_between_drains()
+{
+    g_now = 0;
+    FakeMpu mpu;
+    Mpu9250Fifo f;
+    f.configure(mpu, 0x68, 1000, g_now);
+    mpu.lastFillUs = g_now;
+    const uint32_t start = g_now;
+
+    int16_t expect = 0;
+    uint32_t gaps = 0;
+    const uint32_t got = drainEvery(f, mpu, 10000, start + 2000000, expect, gaps); // 100 Hz for 2 s
+    TEST_ASSERT_EQUAL_UINT32(0, gaps);
+    TEST_ASSERT_UINT32_WITHIN(10, 1995, got); // the last period's frames are still in the FIFO
+    TEST_ASSERT_EQUAL_UINT32(0, f.stats().overflows);
+    TEST_ASSERT_TRUE(mpu.maxRead <= MPU9250_FIFO_READ_CHUNK);
+    TEST_ASSERT_EQUAL_UINT32(0, mpu.maxRead % MPU9250_FIFO_FRAME);
+    TEST_ASSERT_UINT32_WITHIN(2, 200, mpu.fifoReads); // 10 frames: one burst per drain
+    TEST_ASSERT_TRUE(f.stats().max_batch >= 10 && f.stats().max_batch <= 11);
+    TEST_ASSERT_UINT32_WITHIN(10, 995, f.effectiveHz(g_now));
+
+    // 25 Hz still fits (40 of 42 frames), in several bursts
+    mpu.fifoReads = 0;
+    f.resetStats(g_now);
+    const uint32_t got25 = drainEvery(f, mpu, 40000, g_now + 1000000, expect, gaps);
+    TEST_ASSERT_EQUAL_UINT32(0, gaps);
+    TEST_ASSERT_UINT32_WITHIN(41, 1000, got25);
+    TEST_ASSERT_EQUAL_UINT32(0, f.stats().overflows);
+    TEST_ASSERT_TRUE(mpu.fifoReads >= 4 * 24); // 120 byte bursts; the first drain had one period of 10 ms
+}
+
+void test_overflow_is_counted_and_resyncs()
+{
+    g_now = 0;
+    FakeMpu mpu;
+    Mpu9250Fifo f;
+    f.configure(mpu, 0x68, 1000, g_now);
+    mpu.lastFillUs = g_now;
+
+    int16_t expect = 0;
+    uint32_t gaps = 0;
+    drainEvery(f, mpu, 10000, g_now + 100000, expect, gaps);
+    TEST_ASSERT_EQUAL_UINT32(0, gaps);
+
+    // Stall for 60 ms: 60 frames into a 42 frame FIFO
+    g_now += 60000;
+    ImuRawSample batch[MPU9250_FIFO_FRAMES];
+    size_t n = 99;
+    TEST_ASSERT_EQUAL(I2cStatus::Ok, f.drain(mpu, batch, MPU9250_FIFO_FRAMES, n));
+    TEST_ASSERT_EQUAL_UINT32(0, n); // misaligned bytes are not parsed
+    TEST_ASSERT_EQUAL_UINT32(1, f.stats().overflows);
+    TEST_ASSERT_EQUAL_UINT32(MPU9250_FIFO_FRAMES, f.stats().lost);
+
+    // After the reset the frames line up again; one gap where the overflow was
+    const uint32_t got = drainEvery(f, mpu, 10000, g_now + 200000, expect, gaps);
+    TEST_ASSERT_EQUAL_UINT32(1, gaps);
+    TEST_ASSERT_UINT32_WITHIN(10, 195, got);
+    TEST_ASSERT_EQUAL_UINT32(1, f.stats().overflows);
+
+    // restart() drops the backlog without calling it an overflow
+    g_now += 30000;
+    TEST_ASSERT_EQUAL(I2cStatus::Ok, f.restart(mpu));
+    TEST_ASSERT_EQUAL_UINT32(1, f.stats().restarts);
+    TEST_ASSERT_EQUAL_UINT32(1, f.stats().overflows);
+}
+
+void test_bus_time_polled_vs_fifo()
+{
+    // Polled: per sample the library reads accel/temp/gyro (14 bytes) and the magnetometer
+    // (ST1, then 7 bytes) at 100 Hz. FIFO: 1 kHz drained at 100 Hz.
+    FakeMpu mpu;
+    uint32_t polledUs = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        polledUs += mpu.bitsUs(1 + 9 + 9 + 1 + 1 + 9 + 9 * 14);
+        polledUs += 2 * mpu.bitsUs(1 + 9 + 9 + 1 + 1 + 9 + 9 * 4); // ST1 + HXL..ST2, one byte each side
+    }
+
+    g_now = 0;
+    Mpu9250Fifo f;
+    f.configure(mpu, 0x68, 1000, g_now);
+    mpu.lastFillUs = g_now;
+    mpu.busUs = 0;
+    int16_t expect = 0;
+    uint32_t gaps = 0;
+    const uint32_t got = drainEvery(f, mpu, 10000, 1000000, expect, gaps);
+
+    printf("  polled 100 Hz: 100 samples, %u us bus/s (%.0f us/sample) | FIFO 1 kHz @ 100 Hz: %u samples, "
+           "%u us bus/s (%.0f us/sample)\n",
+           (unsigned)polledUs, polledUs / 100.0, (unsigned)got, (unsigned)mpu.busUs, mpu.busUs / (double)got);
+    TEST_ASSERT_EQUAL_UINT32(0, gaps);
+    TEST_ASSERT_TRUE(mpu.busUs / (double)got < polledUs / 100.0 / 2); // 10x the samples at less than half the bus time each
+    TEST_ASSERT_TRUE(mpu.busUs < 350000);                             // 1 kHz fits at 400 kHz with room to spare
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_configure_sets_rate_and_starts_fifo);
+    RUN_TEST(test_parse_is_big_endian_accel_then_gyro);
+    RUN_TEST(test_no_samples_lost_between_drains);
+    RUN_TEST(test_overflow_is_counted_and_resyncs);
+    RUN_TEST(test_bus_time_polled_vs_fifo);
+    return UNITY_END();
+}
@@ -0,0 +1,258 @@
+// Host-side tests for the adaptive telemetry rate controller, incl. a simulated uplink whose
+// bandwidth drops and recovers, and the backlog signal taken from the real class queue and pool.
+// Run with: pio test -e native -f test_native_rate_control -v
+#include <unity.h>
+#include "telemetry/telemetry_buffer_pool.hpp"
+#include "telemetry/telemetry_class_queue.hpp"
+#include "telemetry/telemetry_rate_controller.hpp"
+
+#include <stdio.h>
+
+void setUp() {}
+void tearDown() {}
+
+using Action = TelemetryRateController::Action;
+
+void test_decrease_least_important_first()
+{
+    TelemetryRateController c;
+    const int imu = c.add(100, {25, 0, 0});
+    const int esc = c.add(50, {10, 0, 1});
+    const int sys = c.add(10, {1, 0, 2});
+
+    auto d = c.update({80, 0, 0});
+    TEST_ASSERT_TRUE(d.action == Action::Decrease);
+    TEST_ASSERT_EQUAL_UINT32(1u << sys, d.changed);
+    TEST_ASSERT_EQUAL_UINT32(5, c.rate(sys));
+
+    c.update({80, 0, 0}); // 2
+    c.update({80, 0, 0}); // 1 (min)
+    d = c.update({0, 3, 0});
+    TEST_ASSERT_EQUAL_UINT32(1u << esc, d.changed);
+    TEST_ASSERT_EQUAL_UINT32(25, c.rate(esc));
+    c.update({0, 0, 400}); // 12
+    c.update({0, 0, 400}); // 10 (min)
+    d = c.update({60, 0, 0});
+    TEST_ASSERT_EQUAL_UINT32(1u << imu, d.changed);
+    c.update({60, 0, 0});
+    c.update({60, 0, 0}); // 25 (min)
+    TEST_ASSERT_EQUAL_UINT32(25, c.rate(imu));
+
+    d = c.update({90, 0, 0});
+    TEST_ASSERT_TRUE(d.action == Action::Saturated);
+    TEST_ASSERT_EQUAL_UINT32(0, d.changed);
+}
+
+void test_restore_most_important_first()
+{
+    TelemetryRateController c;
+    const int imu = c.add(100, {25, 0, 0});
+    const int sys = c.add(10, {1, 0, 2});
+    for (int i = 0; i < 10; ++i)
+        c.update({100, 1, 0});
+    TEST_ASSERT_EQUAL_UINT32(25, c.rate(imu));
+    TEST_ASSERT_EQUAL_UINT32(1, c.rate(sys));
+
+    // In-between readings hold; clear periods count towards recovery
+    TEST_ASSERT_TRUE(c.update({30, 0, 0}).action == Action::Hold);
+    for (int i = 0; i < 3; ++i)
+        TEST_ASSERT_TRUE(c.update({0, 0, 50}).action == Action::Hold);
+    auto d = c.update({0, 0, 0});
+    TEST_ASSERT_TRUE(d.action == Action::Increase);
+    TEST_ASSERT_EQUAL_UINT32(1u << imu, d.changed);
+    TEST_ASSERT_EQUAL_UINT32(50, c.rate(imu));
+
+    while (c.rate(imu) < 100)
+        c.update({0, 0, 0});
+    TEST_ASSERT_EQUAL_UINT32(1, c.rate(sys)); // only now the next class
+    while (c.update({0, 0, 0}).action == Action::Increase)
+    {
+    }
+    TEST_ASSERT_EQUAL_UINT32(100, c.rate(imu));
+    TEST_ASSERT_EQUAL_UINT32(10, c.rate(sys));
+}
+
+// ===== Simulated uplink ========================================================
+// Providers -> 64-deep queue -> link of N bytes/s (payload + 60 bytes MQTT/TCP/IP per publish).
+// The controller runs every 500 ms on the peak queue fill, queue-full drops and an RTT of
+// 20 ms + queueing delay, like TelemetryService::controlRates().
+struct SimStream
+{
+    const char *name;
+    uint32_t nominalHz;
+    uint32_t bytes;
+    TelemetryRateLimits limits;
+    uint32_t acc;
+};
+
+void test_simulated_bandwidth_limit()
+{
+    SimStream streams[] = {
+        {"imu", 100, 70, {25, 0, 0}, 0},
+        {"esc", 50, 40, {10, 0, 1}, 0},
+        {"battery", 10, 30, {2, 0, 1}, 0},
+        {"system", 10, 120, {1, 0, 2}, 0},
+    };
+    const size_t n = sizeof(streams) / sizeof(streams[0]);
+    TelemetryRateController c;
+    for (auto &s : streams)
+        c.add(s.nominalHz, s.limits);
+
+    const uint32_t queueCap = 64, overhead = 60;
+    uint32_t queue[64];
+    uint32_t qHead = 0, qLen = 0, qBytes = 0;
+    double credit = 0;
+    uint32_t peak = 0, periodDrops = 0;
+    uint32_t produced = 0, dropped = 0; // over the second half of the limited phase
+    uint32_t firstDecreaseMask = 0;
+
+    TEST_MESSAGE("  t[s]  link kB/s  action     imu  esc  batt  sys");
+    for (uint32_t ms = 0; ms < 60000; ++ms)
+    {
+        const uint32_t linkBps = (ms >= 10000 && ms < 30000) ? 6000 : 50000;
+        const bool measure = ms >= 20000 && ms < 30000;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            SimStream &s = streams[i];
+            s.acc += c.rate(i);
+            if (s.acc < 1000)
+                continue;
+            s.acc -= 1000;
+            const uint32_t cost = s.bytes + overhead;
+            produced += measure;
+            if (qLen == queueCap)
+            {
+                periodDrops++;
+                dropped += measure;
+                continue;
+            }
+            queue[(qHead + qLen++) % queueCap] = cost;
+            qBytes += cost;
+        }
+        if (qLen * 100 / queueCap > peak)
+            peak = qLen * 100 / queueCap;
+
+        credit += linkBps / 1000.0;
+        while (qLen && credit >= queue[qHead])
+        {
+            credit -= queue[qHead];
+            qBytes -= queue[qHead];
+            qHead = (qHead + 1) % queueCap;
+            qLen--;
+        }
+        if (!qLen && credit > 1500)
+            credit = 1500; // an idle link doesn't bank bandwidth
+
+        if (ms % 500 == 499)
+        {
+            const uint32_t rtt = 20 + qBytes * 1000 / linkBps;
+            const auto d = c.update({(uint8_t)peak, periodDrops, rtt});
+            if (d.action == Action::Decrease && !firstDecreaseMask)
+                firstDecreaseMask = d.changed;
+            if (d.changed || ms % 5000 == 4999)
+            {
+                char line[120];
+                snprintf(line, sizeof(line), "  %4.1f  %9u  %-9s  %3u  %3u  %4u  %3u", (ms + 1) / 1000.0,
+                         (unsigned)(linkBps / 1000), TelemetryRateController::actionName(d.action),
+                         (unsigned)c.rate(0), (unsigned)c.rate(1), (unsigned)c.rate(2), (unsigned)c.rate(3));
+                TEST_MESSAGE(line);
+            }
+            peak = 0;
+            periodDrops = 0;
+        }
+    }
+
+    char line[120];
+    snprintf(line, sizeof(line), "limited phase, last 10 s: %u of %u samples dropped; %u decreases, %u increases",
+             (unsigned)dropped, (unsigned)produced, (unsigned)c.stats().decreases, (unsigned)c.stats().increases);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL_UINT32(1u << 3, firstDecreaseMask); // system (priority 2) gives up first
+    TEST_ASSERT_TRUE(dropped * 50 < produced);             // < 2 % once adapted
+    for (size_t i = 0; i < n; ++i)
+        TEST_ASSERT_EQUAL_UINT32(streams[i].nominalHz, c.rate(i)); // restored after the link recovered
+}
+
+// IMU -> pooled buffer -> class queue (Bulk at its pool share) -> link, TX measuring the
+// backlog like TelemetryService::_txLoop(). Only the backlog is fed to the controller, so
+// it alone has to see the congestion.
+void test_backlog_from_pool_and_queue_signals_congestion()
+{
+    static TelemetryBufferPool pool;
+    TelemetryClassQueue q;
+    q.configure(TelemetryClass::Bulk, {(uint8_t)TelemetryBufferPool::queueShare(TelemetryClass::Bulk),
+                                       TelemetryDropPolicy::DropOldest, 1});
+    TelemetryRateController c;
+    const int imu = c.add(200, {20, 0, 0});
+    const uint32_t cost = 100 + 60; // payload + MQTT/TCP/IP
+
+    uint32_t acc = 0, minRate = 200;
+    uint8_t peak = 0, peakLimited = 0, queuePeakLimited = 0;
+    double credit = 0;
+    for (uint32_t ms = 0; ms < 16000; ++ms)
+    {
+        const bool limited = ms >= 3000 && ms < 8000;
+        const uint32_t linkBps = limited ? 8000 : 50000;
+
+        acc += c.rate(imu);
+        if (acc >= 1000)
+        {
+            acc -= 1000;
+            const TelemetryLease l = pool.acquire(TelemetryClass::Bulk);
+            if (l.valid())
+            {
+                TelemetrySample s{};
+                s.buffer = l.slot;
+                TelemetrySample displaced{};
+                if (q.push(s, displaced) == TelemetryClassQueue::Push::Displaced)
+                    pool.release(displaced.buffer);
+            }
+        }
+
+        credit += linkBps / 1000.0;
+        TelemetrySample out{};
+        while (credit >= cost && q.pop(out))
+        {
+            const uint8_t fill = pool.fillPct(TelemetryClass::Bulk); // this sample's buffer counts
+            peak = fill > peak ? fill : peak;
+            const uint8_t queueFill = (uint8_t)((q.size() + 1) * 100 / q.capacity()); // the old measure
+            if (limited && queueFill > queuePeakLimited)
+                queuePeakLimited = queueFill;
+            credit -= cost;
+            pool.release(out.buffer);
+        }
+        if (!q.size() && credit > cost)
+            credit = cost; // an idle link doesn't bank bandwidth
+
+        if (ms % 500 == 499)
+        {
+            if (limited && peak > peakLimited)
+                peakLimited = peak;
+            c.update({peak, 0, 0});
+            minRate = c.rate(imu) < minRate ? c.rate(imu) : minRate;
+            peak = 0;
+        }
+    }
+
+    char line[140];
+    snprintf(line, sizeof(line), "limited link: peak backlog %u%% (queue/capacity would say %u%%), imu down to %u Hz",
+             (unsigned)peakLimited, (unsigned)queuePeakLimited, (unsigned)minRate);
+    TEST_MESSAGE(line);
+    TelemetryRateController::Config cfg;
+    TEST_ASSERT_TRUE(peakLimited >= cfg.fill_high_pct);
+    TEST_ASSERT_TRUE(queuePeakLimited < cfg.fill_high_pct); // why the queue's capacity can't be the measure
+    TEST_ASSERT_TRUE(minRate < 200);
+    TEST_ASSERT_EQUAL_UINT32(200, c.rate(imu)); // the pool drains again once the link is back
+    TEST_ASSERT_EQUAL(TELEMETRY_POOL_BUFFERS, pool.freeCount() + q.size());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_decrease_least_important_first);
+    RUN_TEST(test_restore_most_important_first);
+    RUN_TEST(test_simulated_bandwidth_limit);
+    RUN_TEST(test_backlog_from_pool_and_queue_signals_congestion);
+    return UNITY_END();
+}
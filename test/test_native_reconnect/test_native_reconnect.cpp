@@ -0,0 +1,456 @@
+// Host-side tests for reconnect backoff, persistent sessions, batched SUBSCRIBE and
+// MqttService's subscription/recovery bookkeeping across link drops.
+// Run with: pio test -e native -f test_native_reconnect -v
+#include <unity.h>
+#include "services/mqtt_session.hpp"
+#include "services/reconnect_backoff.hpp"
+#include "services/transport/loopback_transport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+
+using MqttService::RecoveryStats;
+using MqttService::RecoveryTracker;
+using MqttService::SessionSubscriptions;
+
+void setUp() {}
+void tearDown() {}
+
+static bool waitFor(const std::atomic<bool> &flag, uint32_t timeoutMs = 2000)
+{
+    const uint64_t end = LoopbackBroker::nowUs() + timeoutMs * 1000ull;
+    while (!flag.load() && LoopbackBroker::nowUs() < end)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    return flag.load();
+}
+
+void test_backoff_starts_small_doubles_and_caps()
+{
+    ReconnectBackoff b(50, 5000);
+    // rnd = 0 gives the low edge (base/2), rnd = ~0 something within [base/2, base]
+    TEST_ASSERT_EQUAL_UINT32(25, b.next(0));
+    TEST_ASSERT_EQUAL_UINT32(50, b.next(0));
+    TEST_ASSERT_EQUAL_UINT32(100, b.next(0));
+    for (int i = 0; i < 40; ++i) // 400, 800, 1600, 3200, then capped; incl. shift overflow
+    {
+        const uint32_t d = b.next(0xFFFFFFFFu);
+        TEST_ASSERT_TRUE(d <= 5000);
+        if (i >= 4)
+            TEST_ASSERT_TRUE(d >= 2500);
+    }
+    TEST_ASSERT_EQUAL_UINT32(43, b.attempts());
+
+    b.reset();
+    TEST_ASSERT_EQUAL_UINT32(0, b.attempts());
+    TEST_ASSERT_TRUE(b.next(12345) <= 50);
+}
+
+void test_backoff_jitter_spreads_retries()
+{
+    ReconnectBackoff b(1000, 1000);
+    uint32_t lo = 0xFFFFFFFFu, hi = 0;
+    for (uint32_t r = 0; r < 1000; ++r)
+    {
+        const uint32_t d = b.next(r * 2654435761u);
+        lo = d < lo ? d : lo;
+        hi = d > hi ? d : hi;
+    }
+    TEST_ASSERT_TRUE(lo >= 500 && lo < 550);
+    TEST_ASSERT_TRUE(hi <= 1000 && hi > 950);
+}
+
+struct Client
+{
+    LoopbackTransport t;
+    std::atomic<bool> up{false};
+    std::atomic<bool> session{false};
+    std::atomic<uint32_t> subacks{0};
+    std::atomic<uint16_t> lastSuback{0};
+
+    Client(LoopbackBroker &b, const LinkModel &link) : t(b, link, link)
+    {
+        t.onConnect([this](bool sp)
+                    { session = sp; up = true; });
+        t.onDisconnect([this](uint8_t)
+                       { up = false; });
+        t.onSubscribe([this](uint16_t id, uint8_t)
+                      { lastSuback = id; subacks++; });
+    }
+    bool connect()
+    {
+        t.connect();
+        return waitFor(up);
+    }
+};
+
+void test_persistent_session_survives_reconnect()
+{
+    LoopbackBroker broker;
+    LinkModel link;
+    link.latency_us = 2000;
+    Client dev(broker, link);
+    Client ground(broker, LinkModel{});
+    dev.t.setCleanSession(false);
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_FALSE(dev.session.load()); // nothing to resume the first time
+    TEST_ASSERT_TRUE(ground.connect());
+
+    const char *topics[] = {"d/motor", "d/servo", "d/cmd/actuators"};
+    const uint8_t qos[] = {2, 2, 0};
+    const uint16_t id = dev.t.subscribeMany(topics, qos, 3);
+    TEST_ASSERT_TRUE(id != 0);
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_EQUAL_UINT32(1, dev.subacks.load()); // one packet, one SUBACK
+    TEST_ASSERT_EQUAL(id, dev.lastSuback.load());
+    TEST_ASSERT_EQUAL_UINT32(1, dev.t.subscribePackets());
+
+    // Link drop + reconnect: session present, filters still routed without re-subscribing
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_TRUE(dev.session.load());
+
+    std::atomic<bool> got{false};
+    dev.t.onMessage([&](const char *, const uint8_t *, size_t, const MqttMessageProperties &, size_t, size_t)
+                    { got = true; });
+    ground.t.publish("d/servo", 0, false, "0.5", 3);
+    TEST_ASSERT_TRUE(waitFor(got));
+    TEST_ASSERT_EQUAL_UINT32(1, dev.t.subscribePackets());
+}
+
+void test_clean_session_forgets_subscriptions()
+{
+    LoopbackBroker broker;
+    Client dev(broker, LinkModel{});
+    Client ground(broker, LinkModel{});
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_TRUE(ground.connect());
+    dev.t.subscribe("d/motor", 0);
+    TEST_ASSERT_TRUE(broker.waitIdle());
+
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_FALSE(dev.session.load());
+
+    ground.t.publish("d/motor", 0, false, "1", 1);
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_EQUAL_UINT64(1, broker.stats().unrouted);
+}
+
+void test_batched_resubscribe_recovers_faster()
+{
+    // Time from CONNACK to "all filters acknowledged" with 6 filters on a 10 ms link
+    LinkModel link;
+    link.latency_us = 10000;
+    link.bandwidth_Bps = 20000;
+    const char *topics[] = {"d/a", "d/b", "d/c", "d/d", "d/e", "d/f"};
+    const uint8_t qos[] = {0, 0, 0, 1, 1, 2};
+
+    uint64_t elapsed[2] = {};
+    for (int batched = 0; batched < 2; ++batched)
+    {
+        LoopbackBroker broker;
+        Client dev(broker, link);
+        TEST_ASSERT_TRUE(dev.connect());
+
+        std::atomic<bool> done{false};
+        std::atomic<uint16_t> lastId{0};
+        dev.t.onSubscribe([&](uint16_t id, uint8_t)
+                          { if (id == lastId) done = true; });
+        const uint64_t t0 = LoopbackBroker::nowUs();
+        if (batched)
+        {
+            lastId = dev.t.subscribeMany(topics, qos, 6);
+        }
+        else
+        {
+            uint16_t id = 0;
+            for (int i = 0; i < 6; ++i)
+                id = dev.t.subscribe(topics[i], qos[i]);
+            lastId = id;
+        }
+        TEST_ASSERT_TRUE(waitFor(done));
+        elapsed[batched] = LoopbackBroker::nowUs() - t0;
+    }
+
+    char line[120];
+    snprintf(line, sizeof(line), "6 filters, 10 ms link: per-filter %.1f ms, batched %.1f ms",
+             elapsed[0] / 1000.0, elapsed[1] / 1000.0);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(elapsed[1] < elapsed[0]);
+}
+
+// MqttService's onMqttConnect/onMqttSubscribe/onMqttDisconnect around the bookkeeping;
+// _mx stands in for _recoveryMux (callbacks run on the broker thread, like async_tcp)
+struct Device
+{
+    LoopbackTransport t;
+    SessionSubscriptions session;
+    std::atomic<bool> ready{false};
+    std::atomic<uint32_t> messages{0};
+
+    Device(LoopbackBroker &b, const LinkModel &link, bool clean) : t(b, link, link)
+    {
+        t.setCleanSession(clean);
+        session.setCleanSession(clean);
+        t.onConnect([this](bool sp)
+                    {
+            {
+                std::lock_guard<std::mutex> lk(_mx);
+                _recovery.connected(LoopbackBroker::nowUs());
+            }
+            if (session.connected(t, sp) == 0)
+                finishRecovery(sp); });
+        t.onSubscribe([this](uint16_t id, uint8_t)
+                      { if (session.subscribed(id)) finishRecovery(false); });
+        t.onDisconnect([this](uint8_t)
+                       {
+            session.disconnected();
+            ready = false;
+            std::lock_guard<std::mutex> lk(_mx);
+            _recovery.linkDown(LoopbackBroker::nowUs()); });
+        t.onMessage([this](const char *, const uint8_t *, size_t, const MqttMessageProperties &, size_t, size_t)
+                    { messages++; });
+    }
+
+    // MqttService::connectMqtt()
+    bool connect()
+    {
+        {
+            std::lock_guard<std::mutex> lk(_mx);
+            _recovery.attempt();
+        }
+        t.connect();
+        return waitFor(ready);
+    }
+
+    RecoveryStats stats()
+    {
+        std::lock_guard<std::mutex> lk(_mx);
+        return _recovery.stats();
+    }
+
+private:
+    void finishRecovery(bool resumed)
+    {
+        {
+            std::lock_guard<std::mutex> lk(_mx);
+            _recovery.ready(LoopbackBroker::nowUs(), resumed);
+        }
+        ready = true;
+    }
+
+    std::mutex _mx;
+    RecoveryTracker _recovery;
+};
+
+void test_resumed_session_is_ready_without_resubscribing()
+{
+    LoopbackBroker broker;
+    LinkModel link;
+    link.latency_us = 2000;
+    Device dev(broker, link, false);
+    TEST_ASSERT_TRUE(dev.session.add(dev.t, "d/motor", 2)); // offline: queued for the connect
+    dev.session.add(dev.t, "d/servo", 2);
+    dev.session.add(dev.t, "d/cmd/actuators", 0);
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_EQUAL_UINT32(1, dev.t.subscribePackets()); // all three in one packet
+    TEST_ASSERT_EQUAL(3, dev.session.inSession());
+    TEST_ASSERT_EQUAL_UINT32(0, dev.stats().outages); // first connect after boot isn't one
+
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_FALSE(dev.ready.load());
+    TEST_ASSERT_TRUE(dev.connect()); // ready on CONNACK, no SUBACK to wait for
+    TEST_ASSERT_FALSE(dev.session.recovering());
+    TEST_ASSERT_EQUAL_UINT32(1, dev.t.subscribePackets());
+
+    const RecoveryStats st = dev.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, st.outages);
+    TEST_ASSERT_EQUAL_UINT32(1, st.recoveries);
+    TEST_ASSERT_EQUAL_UINT32(1, st.sessions_resumed);
+    TEST_ASSERT_EQUAL_UINT32(1, st.last_attempts);
+    TEST_ASSERT_EQUAL_UINT32(st.last_connect_ms, st.last_ready_ms);
+    TEST_ASSERT_TRUE(st.last_ready_ms >= 4); // CONNECT up, CONNACK down
+}
+
+void test_offline_changes_reach_a_resumed_session()
+{
+    LoopbackBroker broker;
+    Device dev(broker, LinkModel{}, false);
+    Device ground(broker, LinkModel{}, true);
+    dev.session.add(dev.t, "d/motor", 1);
+    dev.session.add(dev.t, "d/servo", 1);
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_TRUE(ground.connect());
+
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_FALSE(dev.session.remove(dev.t, "d/servo")); // the kept session still has it
+    TEST_ASSERT_EQUAL(1, dev.session.pendingUnsubscribes());
+    dev.session.add(dev.t, "d/led", 0);
+    TEST_ASSERT_EQUAL(1, dev.session.inSession());
+
+    TEST_ASSERT_TRUE(dev.connect()); // resumed, but ready only once d/led is acknowledged
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_EQUAL_UINT32(2, dev.t.subscribePackets()); // just d/led
+    TEST_ASSERT_EQUAL(0, dev.session.pendingUnsubscribes());
+    TEST_ASSERT_EQUAL(2, dev.session.inSession());
+    TEST_ASSERT_EQUAL_UINT32(0, dev.stats().sessions_resumed); // had to subscribe
+
+    ground.t.publish("d/servo", 0, false, "0.5", 3);
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_EQUAL_UINT64(1, broker.stats().unrouted);
+    ground.t.publish("d/led", 0, false, "1", 1);
+    ground.t.publish("d/motor", 0, false, "1", 1);
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_EQUAL_UINT32(2, dev.messages.load());
+}
+
+void test_readd_while_offline_cancels_the_unsubscribe()
+{
+    LoopbackBroker broker;
+    Device dev(broker, LinkModel{}, false);
+    dev.session.add(dev.t, "d/motor", 1);
+    TEST_ASSERT_TRUE(dev.connect());
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+
+    dev.session.remove(dev.t, "d/motor");
+    dev.session.add(dev.t, "d/motor", 1);
+    TEST_ASSERT_EQUAL(0, dev.session.pendingUnsubscribes());
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_EQUAL_UINT32(2, dev.t.subscribePackets()); // re-sent (maybe new QoS), not dropped
+}
+
+void test_clean_session_resubscribes_everything()
+{
+    LoopbackBroker broker;
+    LinkModel link;
+    link.latency_us = 5000;
+    Device dev(broker, link, true);
+    Device ground(broker, LinkModel{}, true);
+    char topics[MQTT_SUBSCRIBE_BATCH_MAX + 2][16];
+    for (int i = 0; i < MQTT_SUBSCRIBE_BATCH_MAX + 2; ++i)
+    {
+        snprintf(topics[i], sizeof(topics[i]), "d/f%d", i);
+        dev.session.add(dev.t, topics[i], 0);
+    }
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_TRUE(ground.connect());
+    TEST_ASSERT_EQUAL_UINT32(2, dev.t.subscribePackets()); // batched
+
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_FALSE(dev.session.remove(dev.t, topics[0])); // nothing to replay on a clean session
+    TEST_ASSERT_EQUAL(0, dev.session.pendingUnsubscribes());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    TEST_ASSERT_TRUE(dev.connect());
+    TEST_ASSERT_EQUAL_UINT32(4, dev.t.subscribePackets());
+    TEST_ASSERT_EQUAL(MQTT_SUBSCRIBE_BATCH_MAX + 1, dev.session.inSession());
+
+    const RecoveryStats st = dev.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, st.recoveries);
+    TEST_ASSERT_EQUAL_UINT32(0, st.sessions_resumed);
+    TEST_ASSERT_TRUE(st.last_connect_ms >= 20);
+    TEST_ASSERT_TRUE(st.last_ready_ms >= st.last_connect_ms + 10); // waited for the SUBACKs
+
+    char line[120];
+    snprintf(line, sizeof(line), "clean session, %d filters, 5 ms link: CONNACK %u ms, ready %u ms after the drop",
+             MQTT_SUBSCRIBE_BATCH_MAX + 1, (unsigned)st.last_connect_ms, (unsigned)st.last_ready_ms);
+    TEST_MESSAGE(line);
+
+    ground.t.publish(topics[MQTT_SUBSCRIBE_BATCH_MAX + 1], 0, false, "1", 1);
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_EQUAL_UINT32(1, dev.messages.load());
+}
+
+void test_drop_during_resubscribe_is_one_outage()
+{
+    LoopbackBroker broker;
+    LinkModel link;
+    link.latency_us = 10000;
+    Device dev(broker, link, true);
+    dev.session.add(dev.t, "d/motor", 1);
+    TEST_ASSERT_TRUE(dev.connect());
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+
+    // CONNACK arrives, the SUBACK doesn't: dropped while resubscribing
+    std::atomic<bool> connacked{false};
+    dev.t.onConnect([&](bool sp)
+                    { dev.session.connected(dev.t, sp); connacked = true; });
+    dev.t.connect();
+    TEST_ASSERT_TRUE(waitFor(connacked));
+    TEST_ASSERT_TRUE(dev.session.recovering());
+    dev.t.disconnect();
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    TEST_ASSERT_FALSE(dev.session.recovering());
+    TEST_ASSERT_FALSE(dev.ready.load());
+    TEST_ASSERT_EQUAL(1, dev.session.inSession()); // marked sent; a clean session drops that on CONNACK
+
+    RecoveryStats st = dev.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, st.outages);
+    TEST_ASSERT_EQUAL_UINT32(0, st.recoveries);
+}
+
+void test_recovery_tracker_timing()
+{
+    RecoveryTracker r;
+    TEST_ASSERT_FALSE(r.ready(1000, false)); // boot
+    r.linkDown(10000);
+    r.linkDown(12000); // MQTT after Wi-Fi: same outage
+    TEST_ASSERT_TRUE(r.down());
+    r.attempt();
+    r.attempt();
+    r.wifiUp(150000);
+    r.attempt();
+    r.connected(180000);
+    TEST_ASSERT_TRUE(r.ready(200000, false));
+    TEST_ASSERT_FALSE(r.down());
+
+    RecoveryStats st = r.stats();
+    TEST_ASSERT_EQUAL_UINT32(1, st.outages);
+    TEST_ASSERT_EQUAL_UINT32(1, st.recoveries);
+    TEST_ASSERT_EQUAL_UINT32(3, st.last_attempts);
+    TEST_ASSERT_EQUAL_UINT32(140, st.last_wifi_ms);
+    TEST_ASSERT_EQUAL_UINT32(170, st.last_connect_ms);
+    TEST_ASSERT_EQUAL_UINT32(190, st.last_ready_ms);
+
+    // MQTT-only drop, session resumed: no Wi-Fi time, attempts start over
+    r.linkDown(1000000);
+    r.attempt();
+    r.connected(1050000);
+    TEST_ASSERT_TRUE(r.ready(1050000, true));
+    TEST_ASSERT_FALSE(r.ready(1060000, false)); // a later SUBACK doesn't count twice
+    st = r.stats();
+    TEST_ASSERT_EQUAL_UINT32(2, st.recoveries);
+    TEST_ASSERT_EQUAL_UINT32(1, st.sessions_resumed);
+    TEST_ASSERT_EQUAL_UINT32(4, st.attempts);
+    TEST_ASSERT_EQUAL_UINT32(1, st.last_attempts);
+    TEST_ASSERT_EQUAL_UINT32(0, st.last_wifi_ms);
+    TEST_ASSERT_EQUAL_UINT32(50, st.last_ready_ms);
+    TEST_ASSERT_EQUAL_UINT32(190, st.max_ready_ms);
+    TEST_ASSERT_EQUAL_UINT64(240, st.sum_ready_ms);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_backoff_starts_small_doubles_and_caps);
+    RUN_TEST(test_backoff_jitter_spreads_retries);
+    RUN_TEST(test_persistent_session_survives_reconnect);
+    RUN_TEST(test_clean_session_forgets_subscriptions);
+    RUN_TEST(test_batched_resubscribe_recovers_faster);
+    RUN_TEST(test_resumed_session_is_ready_without_resubscribing);
+    RUN_TEST(test_offline_changes_reach_a_resumed_session);
+    RUN_TEST(test_readd_while_offline_cancels_the_unsubscribe);
+    RUN_TEST(test_clean_session_resubscribes_everything);
+    RUN_TEST(test_drop_during_resubscribe_is_one_outage);
+    RUN_TEST(test_recovery_tracker_timing);
+    return UNITY_END();
+}
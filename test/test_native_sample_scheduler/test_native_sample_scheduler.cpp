@@ -0,0 +1,216 @@
+// Host-side tests for the sampling scheduler, driven in virtual time, incl. the rate error of
+// the previous per-provider vTaskDelayUntil() pacing at a 1 kHz tick.
+// Run with: pio test -e native -f test_native_sample_scheduler -v
+#include <unity.h>
+#include "telemetry/sample_scheduler.hpp"
+
+#include <stdio.h>
+
+void setUp() {}
+void tearDown() {}
+
+// Run the sampling task loop in virtual time: sleep to the next deadline (+ wake-up latency),
+// run the entry for execUs[idx], report.
+static void runFor(SampleScheduler &s, uint64_t &now, uint64_t untilUs, const uint32_t *execUs,
+                   uint32_t wakeLatencyUs, uint32_t *runs)
+{
+    for (;;)
+    {
+        uint64_t due;
+        const int i = s.next(due);
+        if (i < 0)
+            return;
+        if (due > now)
+            now = due + wakeLatencyUs;
+        if (now >= untilUs)
+            return;
+        const uint64_t start = now;
+        now += execUs[i];
+        s.complete(i, start, now);
+        runs[i]++;
+    }
+}
+
+void test_rates_are_exact_without_tick_rounding()
+{
+    const uint32_t rates[] = {100, 300, 333, 1000};
+    SampleScheduler s;
+    for (uint32_t r : rates)
+        s.add(r, 0);
+
+    uint64_t now = 0;
+    const uint32_t exec[] = {150, 60, 40, 20};
+    uint32_t runs[4] = {};
+    runFor(s, now, 10000000, exec, 30, runs); // 10 s
+
+    TEST_MESSAGE("rate Hz   scheduler Hz   vTaskDelayUntil @1 kHz tick Hz");
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint32_t ticks = (1000 + rates[i] - 1) / rates[i]; // the old IMU loop: ceil(tick rate / hz)
+        char line[96];
+        snprintf(line, sizeof(line), "%7u   %12.1f   %.1f", (unsigned)rates[i], runs[i] / 10.0, 1000.0 / ticks);
+        TEST_MESSAGE(line);
+        TEST_ASSERT_UINT32_WITHIN(1, rates[i] * 10, runs[i]);
+        TEST_ASSERT_EQUAL_UINT32(0, s.stats(i).misses);
+    }
+}
+
+void test_earliest_deadline_first_and_jitter()
+{
+    SampleScheduler s;
+    const int slow = s.add(10, 0);  // due at 100 ms
+    const int fast = s.add(100, 0); // due at 10 ms
+    uint64_t due;
+    TEST_ASSERT_EQUAL_INT(fast, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(10000, due);
+
+    // Run 'fast' 250 µs late
+    s.complete(fast, 10250, 10400);
+    TEST_ASSERT_EQUAL_INT(fast, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(20000, due); // still on the grid, no drift from the late start
+    TEST_ASSERT_EQUAL_UINT32(250, s.stats(fast).late_max_us);
+    TEST_ASSERT_EQUAL_UINT32(150, s.stats(fast).exec_max_us);
+    (void)slow;
+}
+
+void test_blocked_run_counts_misses_without_catch_up_burst()
+{
+    SampleScheduler s;
+    const int imu = s.add(1000, 0); // 1 ms period
+    s.complete(imu, 1000, 1010);
+    // Next run starts 3.5 ms late (e.g. blocked on the I2C mutex)
+    s.complete(imu, 5500, 5600);
+    uint64_t due;
+    s.next(due);
+    TEST_ASSERT_EQUAL_UINT64(6000, due); // next future slot, not 3000/4000/5000 back to back
+    TEST_ASSERT_EQUAL_UINT32(3, s.stats(imu).misses);
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(imu).overruns);
+
+    // A run longer than a period overruns its next deadline
+    s.complete(imu, 6000, 7200);
+    TEST_ASSERT_EQUAL_UINT32(1, s.stats(imu).overruns);
+
+    s.resetStats(imu);
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(imu).runs);
+    TEST_ASSERT_EQUAL_UINT32(1000, s.stats(imu).period_us);
+}
+
+void test_rate_change_applies_from_next_deadline()
+{
+    SampleScheduler s;
+    const int i = s.add(100, 0);
+    s.setRate(i, 50);
+    uint64_t due;
+    s.next(due);
+    TEST_ASSERT_EQUAL_UINT64(10000, due); // already planned
+    s.complete(i, 10000, 10100);
+    s.next(due);
+    TEST_ASSERT_EQUAL_UINT64(30000, due);
+    TEST_ASSERT_EQUAL_INT(-1, s.add(0, 0));
+}
+
+void test_idle_entry_is_skipped_and_wakes_without_backlog()
+{
+    SampleScheduler s;
+    const int imu = s.add(100, 0);
+    const int baro = s.add(10, 0);
+    s.setRate(imu, 0); // nobody is watching
+    TEST_ASSERT_TRUE(s.idle(imu));
+    uint64_t due;
+    TEST_ASSERT_EQUAL_INT(baro, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(100000, due);
+    s.complete(imu, 5000, 5100); // a run that was already under way: ignored
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(imu).runs);
+
+    s.setRate(baro, 0);
+    TEST_ASSERT_EQUAL_INT(-1, s.next(due));
+
+    // Woken two seconds later: first run one period out, no misses for the idle time
+    s.setRate(imu, 200, 2000000);
+    TEST_ASSERT_EQUAL_INT(imu, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(2005000, due);
+    s.complete(imu, 2005000, 2005100);
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(imu).misses);
+}
+
+void test_triggered_entry_runs_at_the_interrupt()
+{
+    SampleScheduler s;
+    const int imu = s.add(100, 0);  // 10 ms period: only the backstop
+    const int baro = s.add(10, 0);  // due at 100 ms
+    s.setTriggered(imu, true, 0);
+    uint64_t due;
+    TEST_ASSERT_EQUAL_INT(imu, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(20000, due); // no trigger yet: backstop at two periods
+
+    s.trigger(imu, 3000);
+    TEST_ASSERT_EQUAL_INT(imu, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(3000, due);
+    s.start(imu, 3040);
+    s.complete(imu, 3040, 3200);
+    TEST_ASSERT_EQUAL_UINT32(40, s.stats(imu).late_max_us); // interrupt -> run
+    TEST_ASSERT_EQUAL_UINT32(0, s.stats(imu).timeouts);
+
+    // Off the grid: the next run waits for the next interrupt, not 10 ms
+    TEST_ASSERT_EQUAL_INT(imu, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(23040, due);
+    s.trigger(imu, 7500);
+    TEST_ASSERT_EQUAL_INT(imu, s.next(due));
+    TEST_ASSERT_EQUAL_UINT64(7500, due);
+    (void)baro;
+}
+
+void test_trigger_miss_and_backstop_timeout()
+{
+    SampleScheduler s;
+    const int imu = s.add(1000, 0);
+    s.setTriggered(imu, true, 0);
+
+    // Two interrupts before the task got to run: the first sample was overwritten
+    s.trigger(imu, 1000);
+    s.trigger(imu, 2000);
+    TEST_ASSERT_EQUAL_UINT32(1, s.stats(imu).misses);
+    uint64_t due;
+    s.next(due);
+    TEST_ASSERT_EQUAL_UINT64(2000, due);
+
+    // An interrupt during the run is kept for the next one
+    s.start(imu, 2010);
+    s.trigger(imu, 2050);
+    s.complete(imu, 2010, 2100);
+    TEST_ASSERT_EQUAL_UINT32(1, s.stats(imu).misses);
+    s.next(due);
+    TEST_ASSERT_EQUAL_UINT64(2050, due);
+    s.start(imu, 2100);
+    s.complete(imu, 2100, 2150);
+
+    // The line goes quiet: backstop run two periods after the last one, counted
+    s.next(due);
+    TEST_ASSERT_EQUAL_UINT64(4100, due);
+    s.start(imu, 4100);
+    s.complete(imu, 4100, 4150);
+    TEST_ASSERT_EQUAL_UINT32(1, s.stats(imu).timeouts);
+    TEST_ASSERT_EQUAL_UINT32(3, s.stats(imu).runs);
+
+    // Idle: interrupts are ignored; back on the grid when untriggered
+    s.setRate(imu, 0);
+    s.trigger(imu, 5000);
+    TEST_ASSERT_EQUAL_INT(-1, s.next(due));
+    s.setRate(imu, 1000, 6000);
+    s.setTriggered(imu, false, 6000);
+    s.next(due);
+    TEST_ASSERT_EQUAL_UINT64(7000, due);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_rates_are_exact_without_tick_rounding);
+    RUN_TEST(test_earliest_deadline_first_and_jitter);
+    RUN_TEST(test_blocked_run_counts_misses_without_catch_up_burst);
+    RUN_TEST(test_rate_change_applies_from_next_deadline);
+    RUN_TEST(test_idle_entry_is_skipped_and_wakes_without_backlog);
+    RUN_TEST(test_triggered_entry_runs_at_the_interrupt);
+    RUN_TEST(test_trigger_miss_and_backstop_timeout);
+    return UNITY_END();
+}
@@ -0,0 +1,412 @@
+// End-to-end host benchmarks: MqttService, MqttSink and TelemetryService running on the
+// host_platform FreeRTOS/Wi-Fi stand-ins, talking to a ground client through the loopback broker.
+// Run with: pio test -e native -f test_native_services -v
+#include <unity.h>
+#include "services/mqtt_service.hpp"
+#include "services/telemetry_service.hpp"
+#include "services/transport/loopback_transport.hpp"
+#include "logging/logger.hpp"
+#include "logging/sinks/mqtt_sink.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+static const char *const DEVICE = "Drone";
+
+static LinkModel wifiLink()
+{
+    LinkModel link;
+    link.latency_us = 3000;
+    link.jitter_us = 1000;
+    link.bandwidth_Bps = 500000; // ~4 Mbit/s of Wi-Fi goodput
+    return link;
+}
+
+static LoopbackBroker broker;
+static LoopbackTransport device(broker, wifiLink(), wifiLink(), 1);
+static LoopbackTransport ground(broker, LinkModel{}, LinkModel{}, 2);
+static MqttSink logSink(MqttService::MqttService::instance(), "log");
+
+static bool waitUntil(const std::function<bool()> &done, uint32_t timeoutMs = 3000)
+{
+    const uint64_t end = LoopbackBroker::nowUs() + timeoutMs * 1000ull;
+    while (!done() && LoopbackBroker::nowUs() < end)
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    return done();
+}
+
+/// Log lines (Fifo) still waiting in MqttService's outbox: while any are, new ones queue behind
+/// them and go out at the drain rate (MQTT_OUTBOX_DRAIN_BURST per MQTT_OUTBOX_DRAIN_PERIOD_MS).
+static bool outboxDrained()
+{
+    const MqttService::MqttOutbox::Stats o = MqttService::MqttService::instance().outboxStats();
+    return o.queued == o.drained + o.evicted;
+}
+
+/// Ground-side view of one topic filter: arrivals, and ages from the payload's "t" (µs).
+struct Collector
+{
+    std::mutex mx;
+    std::string filterPrefix;
+    std::string mustContain;
+    std::vector<uint32_t> agesUs;
+    std::string last;
+    std::atomic<uint32_t> count{0};
+
+    void reset(const char *prefix, const char *contains = "")
+    {
+        std::lock_guard<std::mutex> g(mx);
+        filterPrefix = prefix;
+        mustContain = contains;
+        agesUs.clear();
+        last.clear();
+        count = 0;
+    }
+
+    void onMessage(const char *topic, const uint8_t *payload, size_t len)
+    {
+        const uint32_t now = (uint32_t)esp_timer_get_time();
+        std::lock_guard<std::mutex> g(mx);
+        if (filterPrefix.empty() || strncmp(topic, filterPrefix.c_str(), filterPrefix.size()) != 0)
+            return;
+        std::string body(reinterpret_cast<const char *>(payload), len);
+        if (!mustContain.empty() && body.find(mustContain) == std::string::npos)
+            return;
+        const size_t t = body.find("\"t\":");
+        if (t != std::string::npos)
+            agesUs.push_back(now - (uint32_t)strtoul(body.c_str() + t + 4, nullptr, 10));
+        last = std::move(body);
+        count++;
+    }
+
+    uint32_t percentile(double p)
+    {
+        std::lock_guard<std::mutex> g(mx);
+        if (agesUs.empty())
+            return 0;
+        std::vector<uint32_t> v = agesUs;
+        std::sort(v.begin(), v.end());
+        return v[(size_t)(p * (v.size() - 1))];
+    }
+};
+
+static Collector collector;
+
+static void report(const char *what, uint32_t count, uint64_t elapsedUs, uint32_t p50, uint32_t p99, uint32_t max)
+{
+    char line[192];
+    snprintf(line, sizeof(line), "%s: %u msgs in %.1f ms -> %.0f msg/s, age p50 %u us p99 %u us max %u us",
+             what, (unsigned)count, elapsedUs / 1000.0, elapsedUs ? count * 1e6 / elapsedUs : 0.0,
+             (unsigned)p50, (unsigned)p99, (unsigned)max);
+    TEST_MESSAGE(line);
+}
+
+static void groundSubscribe(const char *filter)
+{
+    std::atomic<bool> acked{false};
+    ground.onSubscribe([&](uint16_t, uint8_t)
+                       { acked = true; });
+    TEST_ASSERT_TRUE(ground.subscribe(filter, 0) != 0);
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return acked.load(); }));
+    ground.onSubscribe(nullptr);
+}
+
+/// Scheduled provider publishing `{"t":<capture µs>,"n":<count>}` from a pool buffer.
+class BenchProvider final : public ITelemetryProvider
+{
+public:
+    explicit BenchProvider(uint32_t rateHz) : _rateHz(rateHz) {}
+
+    const char *name() const override { return "BENCH"; }
+    uint32_t sampleRateHz() const override { return _rateHz; }
+    bool begin() override
+    {
+        _stream = registerStream("telemetry/bench");
+        return _stream != TELEMETRY_STREAM_NONE;
+    }
+    void onSamplingRateChange(uint32_t newRateHz) override { _rateHz = newRateHz; }
+    bool scheduled() const override { return true; }
+
+    void sample() override
+    {
+        TelemetryLease lease = acquireBuffer();
+        if (!lease.valid())
+        {
+            noBuffer++;
+            return;
+        }
+        const uint32_t t = (uint32_t)esp_timer_get_time();
+        const int n = snprintf(reinterpret_cast<char *>(lease.data), lease.capacity, "{\"t\":%lu,\"n\":%lu}",
+                               (unsigned long)t, (unsigned long)published.load());
+        TelemetrySample s{
+            .topic_suffix = "telemetry/bench",
+            .payload = lease.data,
+            .payload_length = (size_t)n,
+            .meta = TelemetryMeta{},
+        };
+        s.stream = _stream;
+        s.t_us = t;
+        if (publishBuffer(lease, s, 0))
+            published++;
+    }
+
+    std::atomic<uint32_t> published{0};
+    std::atomic<uint32_t> noBuffer{0};
+
+private:
+    std::atomic<uint32_t> _rateHz;
+    TelemetryStreamId _stream{TELEMETRY_STREAM_NONE};
+};
+
+static BenchProvider bench(500);
+
+void test_connects_through_wifi_and_loopback()
+{
+    auto &mqtt = MqttService::MqttService::instance();
+    mqtt.setTransport(&device);
+    const uint64_t t0 = LoopbackBroker::nowUs();
+    mqtt.begin("ssid", "pass", DEVICE, IPAddress(127, 0, 0, 1), 1883);
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return mqtt.wifiConnected() && mqtt.mqttConnected(); }));
+    TEST_ASSERT_TRUE(mqtt.beginDispatch());
+
+    char line[96];
+    snprintf(line, sizeof(line), "Wi-Fi + MQTT connect: %.1f ms", (LoopbackBroker::nowUs() - t0) / 1000.0);
+    TEST_MESSAGE(line);
+}
+
+void test_mqtt_sink_log_throughput()
+{
+    collector.reset("Drone/log/", "\"tag\":\"Bench\"");
+    groundSubscribe("Drone/log/#");
+    TEST_ASSERT_TRUE(waitUntil(outboxDrained)); // the lines logged while connecting
+    const uint32_t evictedBefore = MqttService::MqttService::instance().outboxStats().evicted;
+
+    // 2000 lines at ~2000 lines/s, in bursts the logger queue can hold
+    const uint32_t lines = 2000;
+    const uint64_t t0 = LoopbackBroker::nowUs();
+    for (uint32_t i = 0; i < lines; ++i)
+    {
+        LOGI("Bench", "line %u of %u", (unsigned)i, (unsigned)lines);
+        if (i % 20 == 19)
+            vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    waitUntil([&]
+              { return collector.count.load() >= lines; });
+    const uint64_t elapsed = LoopbackBroker::nowUs() - t0;
+
+    report("MqttSink -> ground", collector.count.load(), elapsed, collector.percentile(0.5),
+           collector.percentile(0.99), collector.percentile(1.0));
+    const uint32_t evicted = MqttService::MqttService::instance().outboxStats().evicted - evictedBefore;
+    char line[128];
+    snprintf(line, sizeof(line), "MqttSink: %u dropped (%u backpressure), %u evicted from the outbox",
+             (unsigned)logSink.droppedPublishes(), (unsigned)logSink.backpressuredPublishes(), (unsigned)evicted);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(lines, collector.count.load() + logSink.droppedPublishes() + evicted);
+    TEST_ASSERT_TRUE(collector.count.load() > lines / 2);
+}
+
+void test_telemetry_service_end_to_end()
+{
+    collector.reset("Drone/telemetry/bench");
+    groundSubscribe("Drone/telemetry/#");
+
+    auto &telemetry = TelemetryService::instance();
+    telemetry.begin(DEVICE);
+    telemetry.attachMqtt(MqttService::MqttService::instance());
+    const uint64_t t0 = LoopbackBroker::nowUs();
+    telemetry.addProvider(&bench);
+    vTaskDelay(pdMS_TO_TICKS(2000));
+    const uint64_t elapsed = LoopbackBroker::nowUs() - t0;
+    TEST_ASSERT_TRUE(broker.waitIdle());
+
+    report("TelemetryService -> ground", collector.count.load(), elapsed, collector.percentile(0.5),
+           collector.percentile(0.99), collector.percentile(1.0));
+    const TelemetryService::TxStats tx = telemetry.txStats();
+    char line[160];
+    snprintf(line, sizeof(line), "provider: %u published, %u without a buffer; TX: %u sent, %u dropped",
+             (unsigned)bench.published.load(), (unsigned)bench.noBuffer.load(), (unsigned)tx.sent,
+             (unsigned)tx.dropped);
+    TEST_MESSAGE(line);
+
+    // 500 Hz for 2 s, give or take the first period and the scheduler's slack
+    TEST_ASSERT_TRUE(collector.count.load() > 800);
+    TEST_ASSERT_EQUAL_UINT32(0, bench.noBuffer.load());
+}
+
+void test_command_path_round_trip()
+{
+    // ctl (QoS1) -> MQTT dispatch task -> TX task -> retained status -> ground
+    collector.reset("Drone/telemetry/status");
+    std::vector<uint32_t> rtt;
+    for (int i = 0; i < 50; ++i)
+    {
+        const uint32_t before = collector.count.load();
+        const uint64_t t0 = LoopbackBroker::nowUs();
+        TEST_ASSERT_TRUE(ground.publish("Drone/telemetry/ctl", 1, false, "status", 6) != 0);
+        TEST_ASSERT_TRUE(waitUntil([&]
+                                   { return collector.count.load() > before; }));
+        rtt.push_back((uint32_t)(LoopbackBroker::nowUs() - t0));
+    }
+    std::sort(rtt.begin(), rtt.end());
+    char line[128];
+    snprintf(line, sizeof(line), "command -> status round trip: p50 %u us p99 %u us max %u us",
+             (unsigned)rtt[rtt.size() / 2], (unsigned)rtt[(rtt.size() - 1) * 99 / 100], (unsigned)rtt.back());
+    TEST_MESSAGE(line);
+
+    // A lease really switches the stream off, and "auto" brings it back
+    const uint32_t before = collector.count.load();
+    ground.publish("Drone/telemetry/ctl", 1, false, "off BENCH", 9);
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return collector.count.load() > before; }));
+    vTaskDelay(pdMS_TO_TICKS(50)); // what was already queued drains
+    const uint32_t frozen = bench.published.load();
+    vTaskDelay(pdMS_TO_TICKS(200));
+    TEST_ASSERT_EQUAL_UINT32(frozen, bench.published.load());
+
+    ground.publish("Drone/telemetry/ctl", 1, false, "auto BENCH", 10);
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return bench.published.load() > frozen + 20; }));
+}
+
+// Mailbox reuse: what the current subscriber got, and anything else that reached it
+static std::atomic<int> mbRound{0};
+static std::atomic<uint32_t> mbGot{0};
+static std::atomic<uint32_t> mbLeaked{0};
+static std::atomic<bool> mbGate{true};
+static std::atomic<bool> mbBlocked{false};
+
+void test_mailbox_slots_are_reused()
+{
+    // More subscribe/unsubscribe cycles than there are slots: each one still gets a mailbox,
+    // and what the previous subscriber left unread never reaches the next one
+    auto &mqtt = MqttService::MqttService::instance();
+    TEST_ASSERT_TRUE(mqtt.subscribe("Drone/mb_block", MqttService::QoS::AtLeastOnce,
+                                    [](const MqttService::Message &)
+                                    {
+                                        mbBlocked = true;
+                                        while (!mbGate.load())
+                                            vTaskDelay(1);
+                                        mbBlocked = false;
+                                    },
+                                    MqttService::Delivery::Queued));
+    for (int round = 0; round < 3 * MQTT_MAILBOX_MAX; ++round)
+    {
+        mbRound = round;
+        mbGot = 0;
+        const MqttService::Delivery mode = round % 2 ? MqttService::Delivery::Latest : MqttService::Delivery::Queued;
+        TEST_ASSERT_TRUE(mqtt.subscribe("Drone/mb", MqttService::QoS::AtLeastOnce,
+                                        [](const MqttService::Message &m)
+                                        {
+                                            char expect[16];
+                                            snprintf(expect, sizeof(expect), "r%d", mbRound.load());
+                                            if (m.len == strlen(expect) && memcmp(m.payload, expect, m.len) == 0)
+                                                mbGot++;
+                                            else
+                                                mbLeaked++;
+                                        },
+                                        mode));
+        MqttService::DeliveryStats ds{};
+        TEST_ASSERT_TRUE(mqtt.deliveryStats("Drone/mb", ds)); // a mailbox, not inline
+        TEST_ASSERT_TRUE(broker.waitIdle());
+
+        char payload[16];
+        const int n = snprintf(payload, sizeof(payload), "r%d", round);
+        TEST_ASSERT_TRUE(ground.publish("Drone/mb", 1, false, payload, n) != 0);
+        TEST_ASSERT_TRUE(waitUntil([]
+                                   { return mbGot.load() == 1; }));
+
+        // Hold the dispatch task in another callback, so this one is left unread in the slot
+        mbGate = false;
+        ground.publish("Drone/mb_block", 1, false, "x", 1);
+        TEST_ASSERT_TRUE(waitUntil([]
+                                   { return mbBlocked.load(); }));
+        ground.publish("Drone/mb", 1, false, "old", 3);
+        TEST_ASSERT_TRUE(broker.waitIdle());
+        TEST_ASSERT_TRUE(mqtt.unsubscribe("Drone/mb"));
+        mbGate = true;
+        TEST_ASSERT_TRUE(waitUntil([]
+                                   { return !mbBlocked.load(); }));
+    }
+    vTaskDelay(pdMS_TO_TICKS(20));
+    TEST_ASSERT_EQUAL_UINT32(0, mbLeaked.load());
+    TEST_ASSERT_TRUE(mqtt.unsubscribe("Drone/mb_block"));
+}
+
+void test_wifi_outage_recovery()
+{
+    auto &mqtt = MqttService::MqttService::instance();
+    collector.reset("Drone/log/", "\"tag\":\"Outage\"");
+
+    // The access point goes away; on the device the TCP connection goes down with it
+    WiFi.setAccessPoint(false);
+    device.disconnect();
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return !mqtt.wifiConnected() && !mqtt.mqttConnected(); }));
+
+    // Info and up are kept in the outbox while offline (MqttSink's offlineMinLevel)
+    const uint32_t lines = 20;
+    for (uint32_t i = 0; i < lines; ++i)
+        LOGW("Outage", "offline line %u", (unsigned)i);
+    vTaskDelay(pdMS_TO_TICKS(300));
+    TEST_ASSERT_EQUAL_UINT32(0, collector.count.load());
+
+    const uint64_t t0 = LoopbackBroker::nowUs();
+    WiFi.setAccessPoint(true);
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return mqtt.mqttConnected(); }, 10000));
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return collector.count.load() >= lines; }));
+    const uint64_t elapsed = LoopbackBroker::nowUs() - t0;
+
+    const MqttService::RecoveryStats rs = mqtt.recoveryStats();
+    char line[160];
+    snprintf(line, sizeof(line), "AP back -> %u buffered lines delivered: %.1f ms (ready after %u ms, %u attempts)",
+             (unsigned)collector.count.load(), elapsed / 1000.0, (unsigned)rs.last_ready_ms,
+             (unsigned)rs.last_attempts);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(lines, collector.count.load());
+}
+
+int main(int, char **)
+{
+    Logger::instance().init();
+    Logger::instance().addSink(&logSink);
+    ground.onMessage([](const char *topic, const uint8_t *payload, size_t len, const MqttMessageProperties &, size_t,
+                        size_t)
+                     { collector.onMessage(topic, payload, len); });
+    std::atomic<bool> up{false};
+    ground.onConnect([&](bool)
+                     { up = true; });
+    ground.connect();
+    waitUntil([&]
+              { return up.load(); });
+    ground.onConnect(nullptr);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_connects_through_wifi_and_loopback);
+    RUN_TEST(test_mqtt_sink_log_throughput);
+    RUN_TEST(test_telemetry_service_end_to_end);
+    RUN_TEST(test_command_path_round_trip);
+    RUN_TEST(test_mailbox_slots_are_reused);
+    RUN_TEST(test_wifi_outage_recovery);
+    const int failures = UNITY_END();
+
+    // The services' tasks run on: hand MqttService its own client back before the loopback
+    // goes away, and park every task before static destruction
+    MqttService::MqttService::instance().setTransport(nullptr);
+    vTaskEndScheduler();
+    return failures;
+}
@@ -0,0 +1,163 @@
+// Host-side tests for ground-controlled stream leases: command parsing, caps combined with
+// the adaptive rate, lease expiry back to each provider's default, and a simulated ground
+// client that renews, forgets and comes back.
+// Run with: pio test -e native -f test_native_stream_control -v
+#include <unity.h>
+#include "telemetry/telemetry_stream_control.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+void setUp() {}
+void tearDown() {}
+
+using Result = TelemetryStreamControl::Result;
+static constexpr uint32_t kUncapped = TelemetryStreamControl::kUncapped;
+
+static TelemetryStreamControl::Outcome cmd(TelemetryStreamControl &c, const char *text, uint32_t nowMs)
+{
+    return c.apply(text, strlen(text), nowMs);
+}
+
+void test_defaults_follow_demand()
+{
+    TelemetryStreamControl c;
+    const int imu = c.add("imu", TelemetryDemand::Continuous);
+    const int gps = c.add("gps", TelemetryDemand::OnDemand);
+    TEST_ASSERT_EQUAL_UINT32(kUncapped, c.cap(imu));
+    TEST_ASSERT_EQUAL_UINT32(0, c.cap(gps));
+    TEST_ASSERT_EQUAL_UINT32(100, c.effective(imu, 100)); // the rate controller decides
+    TEST_ASSERT_EQUAL_UINT32(0, c.effective(gps, 10));
+    TEST_ASSERT_FALSE(c.leased());
+}
+
+void test_commands_and_errors()
+{
+    TelemetryStreamControl c;
+    const int imu = c.add("imu", TelemetryDemand::Continuous);
+    const int gps = c.add("gps", TelemetryDemand::OnDemand);
+
+    auto o = cmd(c, "on gps", 0);
+    TEST_ASSERT_TRUE(o.result == Result::Ok);
+    TEST_ASSERT_EQUAL_UINT32(1u << gps, o.changed);
+    TEST_ASSERT_EQUAL_UINT32(kUncapped, c.cap(gps));
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_LEASE_DEFAULT_S * 1000u, c.leaseRemainingMs(gps, 0));
+
+    o = cmd(c, "on imu 20 5\n", 0); // cap below the adaptive rate, trailing newline
+    TEST_ASSERT_EQUAL_UINT32(1u << imu, o.changed);
+    TEST_ASSERT_EQUAL_UINT32(20, c.effective(imu, 100));
+    TEST_ASSERT_EQUAL_UINT32(12, c.effective(imu, 12)); // congestion still wins
+    TEST_ASSERT_EQUAL_UINT32(5000, c.leaseRemainingMs(imu, 0));
+
+    o = cmd(c, "off * 99999", 0);
+    TEST_ASSERT_EQUAL_UINT32((1u << imu) | (1u << gps), o.changed);
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_LEASE_MAX_S * 1000u, c.leaseRemainingMs(gps, 0)); // clamped
+
+    o = cmd(c, "auto imu", 0);
+    TEST_ASSERT_EQUAL_UINT32(1u << imu, o.changed);
+    TEST_ASSERT_EQUAL_UINT32(kUncapped, c.cap(imu));
+
+    TEST_ASSERT_TRUE(cmd(c, "status", 0).result == Result::Status);
+    TEST_ASSERT_TRUE(cmd(c, "", 0).result == Result::UnknownCommand);
+    TEST_ASSERT_TRUE(cmd(c, "start imu", 0).result == Result::UnknownCommand);
+    TEST_ASSERT_TRUE(cmd(c, "on", 0).result == Result::BadArgument);
+    TEST_ASSERT_TRUE(cmd(c, "on baro", 0).result == Result::UnknownProvider);
+    TEST_ASSERT_TRUE(cmd(c, "on im", 0).result == Result::UnknownProvider); // whole names only
+    TEST_ASSERT_TRUE(cmd(c, "on imu fast", 0).result == Result::BadArgument);
+    TEST_ASSERT_TRUE(cmd(c, "off imu 1 2", 0).result == Result::BadArgument);
+    TEST_ASSERT_TRUE(cmd(c, "auto imu 5", 0).result == Result::BadArgument);
+    TEST_ASSERT_EQUAL_UINT32(0, c.cap(gps)); // rejected commands changed nothing
+    TEST_ASSERT_EQUAL_UINT32(8, c.stats().rejected);
+    TEST_ASSERT_EQUAL_UINT32(4, c.stats().commands);
+}
+
+void test_parse_then_apply()
+{
+    // TelemetryService parses outside its lock and applies under it; a provider may be added in between
+    TelemetryStreamControl c;
+    const int imu = c.add("imu", TelemetryDemand::Continuous);
+    const char text[] = "on gps 5 9";
+    const TelemetryStreamControl::Command parsed = TelemetryStreamControl::parse(text, strlen(text));
+    TEST_ASSERT_TRUE(parsed.result == Result::Ok);
+    TEST_ASSERT_EQUAL_UINT32(5, parsed.capHz);
+    TEST_ASSERT_EQUAL_UINT32(9, parsed.leaseS);
+    TEST_ASSERT_EQUAL_UINT32(0, c.stats().commands + c.stats().rejected); // parse() counts nothing
+
+    const int gps = c.add("gps", TelemetryDemand::OnDemand);
+    const auto o = c.apply(parsed, 0);
+    TEST_ASSERT_EQUAL_UINT32(1u << gps, o.changed);
+    TEST_ASSERT_EQUAL_UINT32(5, c.cap(gps));
+    TEST_ASSERT_EQUAL_UINT32(kUncapped, c.cap(imu));
+
+    const char bad[] = "off gps x";
+    TEST_ASSERT_TRUE(c.apply(TelemetryStreamControl::parse(bad, strlen(bad)), 0).result == Result::BadArgument);
+    TEST_ASSERT_EQUAL_UINT32(1, c.stats().rejected);
+    TEST_ASSERT_EQUAL_UINT32(5, c.cap(gps));
+}
+
+void test_leases_expire_to_default_across_wrap()
+{
+    TelemetryStreamControl c;
+    const int imu = c.add("imu", TelemetryDemand::Continuous);
+    const int gps = c.add("gps", TelemetryDemand::OnDemand);
+    const uint32_t t0 = 0xFFFFF000u; // millis() about to wrap
+
+    cmd(c, "off imu 10", t0);
+    cmd(c, "on gps 5 20", t0);
+    TEST_ASSERT_TRUE(c.leased());
+    TEST_ASSERT_EQUAL_UINT32(0, c.expire(t0 + 9999));
+    TEST_ASSERT_EQUAL_UINT32(1u << imu, c.expire(t0 + 10000));
+    TEST_ASSERT_EQUAL_UINT32(kUncapped, c.cap(imu)); // Continuous: back on
+    TEST_ASSERT_EQUAL_UINT32(1u << gps, c.expire(t0 + 20000));
+    TEST_ASSERT_EQUAL_UINT32(0, c.cap(gps)); // OnDemand: back to idle
+    TEST_ASSERT_FALSE(c.leased());
+    TEST_ASSERT_EQUAL_UINT32(2, c.stats().expired);
+
+    // A lease that ends where the default is anyway expires without a change
+    cmd(c, "on imu 0 1", t0);
+    TEST_ASSERT_EQUAL_UINT32(0, c.expire(t0 + 1000));
+}
+
+// Ground client watching the GPS stream: renews every 20 s on a 30 s lease, drops out for
+// a minute, then comes back. The stream must be on exactly while the client is alive.
+void test_ground_client_session()
+{
+    TelemetryStreamControl c;
+    c.add("imu", TelemetryDemand::Continuous);
+    const int gps = c.add("gps", TelemetryDemand::OnDemand);
+
+    uint32_t onMs = 0, offMs = 0, changes = 0;
+    for (uint32_t t = 0; t < 300000; t += 100)
+    {
+        const bool clientAlive = t < 120000 || t >= 180000;
+        if (clientAlive && t % 20000 == 0)
+            changes += __builtin_popcount(cmd(c, "on gps 5 30", t).changed);
+        changes += __builtin_popcount(c.expire(t));
+
+        if (c.effective(gps, 10) == 5)
+            onMs += 100;
+        else
+            offMs += 100;
+    }
+    // Off from the last renewal (100 s) + 30 s until the client returned at 180 s
+    TEST_ASSERT_EQUAL_UINT32(50000, offMs);
+    TEST_ASSERT_EQUAL_UINT32(250000, onMs);
+    TEST_ASSERT_EQUAL_UINT32(3, changes); // on, expired, on again: renewals are silent
+    TEST_ASSERT_EQUAL_UINT32(1, c.stats().expired);
+
+    char line[96];
+    snprintf(line, sizeof(line), "gps on %u ms, off %u ms over 300 s, %u cap changes", (unsigned)onMs,
+             (unsigned)offMs, (unsigned)changes);
+    TEST_MESSAGE(line);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_defaults_follow_demand);
+    RUN_TEST(test_commands_and_errors);
+    RUN_TEST(test_parse_then_apply);
+    RUN_TEST(test_leases_expire_to_default_across_wrap);
+    RUN_TEST(test_ground_client_session);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+// Host-side tests for per-stream accounting: unique sequence numbers across tasks, age
+// bucket/percentile accuracy, and a simulated pipeline where the device counters plus the
+// receiver's seq gaps account for every stamped sample.
+// Run with: pio test -e native -f test_native_stream_stats -v
+#include <unity.h>
+#include "telemetry/telemetry_stream_stats.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+static uint32_t lcg(uint32_t &s)
+{
+    s = s * 1664525u + 1013904223u;
+    return s >> 8;
+}
+
+void test_stamps_are_unique_across_tasks()
+{
+    static TelemetryStreamStats stats;
+    constexpr int kThreads = 4, kPerThread = 20000;
+    static uint8_t seen[kThreads * kPerThread];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+        threads.emplace_back([]
+                             {
+            for (int i = 0; i < kPerThread; ++i)
+            {
+                const uint32_t seq = stats.stamp(3);
+                if (seq < kThreads * kPerThread)
+                    seen[seq]++;
+            } });
+    for (auto &th : threads)
+        th.join();
+
+    for (uint32_t i = 0; i < kThreads * kPerThread; ++i)
+        TEST_ASSERT_EQUAL_UINT8(1, seen[i]);
+    TEST_ASSERT_EQUAL_UINT32(kThreads * kPerThread, stats.snapshot(3, false).seq);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.snapshot(2, false).seq); // streams are independent
+    TEST_ASSERT_EQUAL_UINT32(0, stats.stamp(TELEMETRY_MAX_STREAMS)); // unregistered: untracked
+}
+
+void test_age_buckets_cover_every_value()
+{
+    TEST_ASSERT_EQUAL_size_t(0, TelemetryStreamStats::ageBucket(0));
+    TEST_ASSERT_EQUAL_size_t(1, TelemetryStreamStats::ageBucket(1));
+    uint32_t prevUpper = 1;
+    for (size_t b = 2; b < TELEMETRY_AGE_BUCKETS - 1; ++b)
+    {
+        const uint32_t upper = TelemetryStreamStats::bucketUpperUs(b);
+        TEST_ASSERT_TRUE(upper > prevUpper);
+        TEST_ASSERT_EQUAL_size_t(b, TelemetryStreamStats::ageBucket(prevUpper + 1)); // contiguous
+        TEST_ASSERT_EQUAL_size_t(b, TelemetryStreamStats::ageBucket(upper));
+        if (upper >= 16)
+            TEST_ASSERT_TRUE((upper - prevUpper) * 1.0 / upper <= 0.35); // half-octave resolution
+        prevUpper = upper;
+    }
+    TEST_ASSERT_EQUAL_size_t(TELEMETRY_AGE_BUCKETS - 1, TelemetryStreamStats::ageBucket(UINT32_MAX));
+}
+
+void test_percentiles_within_bucket_resolution()
+{
+    TelemetryStreamStats stats;
+    // Ages 1..10000 µs, uniform: exact p50 = 5000, p90 = 9000, p99 = 9900
+    for (uint32_t a = 1; a <= 10000; ++a)
+        stats.transmitted(0, TelemetryStreamStats::Outcome::Sent, 1000000u, 1000000u + a);
+    const TelemetryStreamStats::Snapshot s = stats.snapshot(0, true);
+    TEST_ASSERT_EQUAL_UINT32(10000, s.age_count);
+    TEST_ASSERT_EQUAL_UINT32(10000, s.age_max_us);
+    TEST_ASSERT_TRUE(s.age_p50_us >= 5000 && s.age_p50_us <= 5000 * 1.34);
+    TEST_ASSERT_TRUE(s.age_p90_us >= 9000 && s.age_p90_us <= 10000);
+    TEST_ASSERT_TRUE(s.age_p99_us >= 9900 && s.age_p99_us <= 10000); // capped at the max
+    TEST_ASSERT_EQUAL_UINT32(1000000u, s.last_capture_us);
+
+    // The window restarts; counters don't
+    const TelemetryStreamStats::Snapshot next = stats.snapshot(0, false);
+    TEST_ASSERT_EQUAL_UINT32(0, next.age_count);
+    TEST_ASSERT_EQUAL_UINT32(0, next.age_p99_us);
+    TEST_ASSERT_EQUAL_UINT32(10000, next.sent);
+
+    // Failures count but carry no age; the clock may wrap between capture and hand-off
+    stats.transmitted(0, TelemetryStreamStats::Outcome::Failed, 5, 1000);
+    stats.transmitted(0, TelemetryStreamStats::Outcome::Buffered, 0xFFFFFF00u, 0x100u);
+    const TelemetryStreamStats::Snapshot w = stats.snapshot(0, false);
+    TEST_ASSERT_EQUAL_UINT32(1, w.tx_failures);
+    TEST_ASSERT_EQUAL_UINT32(1, w.buffered);
+    TEST_ASSERT_EQUAL_UINT32(1, w.age_count);
+    TEST_ASSERT_EQUAL_UINT32(0x200u, w.age_max_us);
+}
+
+// Provider at 1 kHz into an 8-deep queue, a TX task that stalls now and then and sometimes
+// fails, and a lossy link. The receiver only sees seq numbers; the device only its counters.
+void test_loss_attribution_sums_to_stamped()
+{
+    TelemetryStreamStats stats;
+    constexpr TelemetryStreamId kStream = 1;
+    constexpr size_t kQueue = 8;
+    struct Item
+    {
+        uint32_t seq, t_us;
+    } queue[kQueue];
+    size_t head = 0, count = 0;
+
+    uint32_t rng = 42, now = 0, stallUntil = 0;
+    uint32_t received = 0, newest = 0, networkLost = 0;
+    bool started = false;
+
+    for (int tick = 0; tick < 200000; ++tick, now += 1000)
+    {
+        // Producer: stamp, then try to enqueue
+        const Item it{stats.stamp(kStream), now};
+        if (count < kQueue)
+            queue[(head + count++) % kQueue] = it;
+        else
+            stats.enqueueDropped(kStream);
+
+        // TX task: stalls ~1 % of the ticks for 5..20 ms, else drains two per tick
+        if ((lcg(rng) % 100) < 1 && now >= stallUntil)
+            stallUntil = now + 5000 + (lcg(rng) % 15000);
+        for (int n = 0; n < 2 && count && now >= stallUntil; ++n)
+        {
+            const Item s = queue[head];
+            head = (head + 1) % kQueue;
+            count--;
+            if ((lcg(rng) % 1000) < 3)
+            {
+                stats.transmitted(kStream, TelemetryStreamStats::Outcome::Failed, s.t_us, now);
+                continue;
+            }
+            stats.transmitted(kStream, TelemetryStreamStats::Outcome::Sent, s.t_us, now);
+            if ((lcg(rng) % 100) < 2)
+            {
+                networkLost++;
+                continue;
+            }
+            // Receiver
+            received++;
+            newest = s.seq;
+            started = true;
+        }
+    }
+
+    const TelemetryStreamStats::Snapshot s = stats.snapshot(kStream, false);
+    const uint32_t inQueue = (uint32_t)count;
+    TEST_ASSERT_TRUE(started);
+    TEST_ASSERT_TRUE(s.enqueue_drops > 0 && s.tx_failures > 0 && networkLost > 0);
+    TEST_ASSERT_EQUAL_UINT32(s.seq, s.enqueue_drops + s.sent + s.buffered + s.tx_failures + inQueue);
+
+    // What the receiver can tell from seq alone, split with the device counters
+    const uint32_t missing = newest + 1 - received; // gaps up to the newest received
+    const uint32_t tail = s.seq - 1 - newest; // stamped after the newest received
+    TEST_ASSERT_EQUAL_UINT32(s.seq, received + missing + tail);
+    TEST_ASSERT_EQUAL_UINT32(missing + tail, s.enqueue_drops + s.tx_failures + networkLost + inQueue);
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "stamped %u: received %u, enqueue drops %u, tx failures %u, network %u, queued %u; "
+             "age p50 %u p99 %u max %u us",
+             (unsigned)s.seq, (unsigned)received, (unsigned)s.enqueue_drops, (unsigned)s.tx_failures,
+             (unsigned)networkLost, (unsigned)inQueue, (unsigned)s.age_p50_us, (unsigned)s.age_p99_us,
+             (unsigned)s.age_max_us);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(s.age_max_us >= 5000); // stalls show up in the tail
+    TEST_ASSERT_TRUE(s.age_p50_us < s.age_p99_us);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stamps_are_unique_across_tasks);
+    RUN_TEST(test_age_buckets_cover_every_value);
+    RUN_TEST(test_percentiles_within_bucket_resolution);
+    RUN_TEST(test_loss_attribution_sums_to_stamped);
+    return UNITY_END();
+}
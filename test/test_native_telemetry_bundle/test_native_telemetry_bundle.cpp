@@ -0,0 +1,208 @@
+// Host-side tests for telemetry bundling, incl. a packets/bytes vs added latency sweep.
+// Run with: pio test -e native -f test_native_telemetry_bundle -v
+#include <unity.h>
+#include "telemetry/telemetry_bundle.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+static const uint8_t *bytes(const char *s) { return reinterpret_cast<const uint8_t *>(s); }
+
+void test_round_trip()
+{
+    static TelemetryBundler b;
+    b.configure(20000);
+    TEST_ASSERT_TRUE(b.add("telemetry/imu", false, 0, bytes("{\"r\":1}"), 7, 1000, 41, 900) == TelemetryBundler::AddResult::Added);
+    TEST_ASSERT_TRUE(b.add("telemetry/battery", false, 2, bytes("\x01\x02"), 2, 1500, 0x10007, 1400) == TelemetryBundler::AddResult::Added);
+    TEST_ASSERT_TRUE(b.add("fleet/status", true, 3, bytes("ok"), 2, 4000, 0, 4000) == TelemetryBundler::AddResult::Added);
+    TEST_ASSERT_FALSE(b.due(20999));
+    TEST_ASSERT_TRUE(b.due(21000));
+
+    const uint8_t *frame = nullptr;
+    const size_t len = b.flush(21000, false, frame);
+    TEST_ASSERT_EQUAL(BUNDLE_HEADER_LEN + 3 * BUNDLE_RECORD_HEADER_LEN + 13 + 7 + 17 + 2 + 12 + 2, len);
+    TEST_ASSERT_FALSE(b.pending());
+
+    TelemetryBundleReader rd;
+    TEST_ASSERT_TRUE(rd.begin(frame, len));
+    TEST_ASSERT_EQUAL_UINT8(3, rd.count());
+    TEST_ASSERT_EQUAL_UINT16(0, rd.seq());
+    TEST_ASSERT_EQUAL_UINT32(1000, rd.t0Us());
+
+    TelemetryBundleReader::Record r;
+    TEST_ASSERT_TRUE(rd.next(r));
+    TEST_ASSERT_EQUAL_STRING_LEN("telemetry/imu", r.topic, r.topic_len);
+    TEST_ASSERT_EQUAL_MEMORY("{\"r\":1}", r.payload, r.payload_len);
+    TEST_ASSERT_EQUAL_UINT16(41, r.seq);
+    TEST_ASSERT_EQUAL_UINT32(900, r.t_us); // captured before the bundle opened
+    TEST_ASSERT_TRUE(rd.next(r));
+    TEST_ASSERT_EQUAL_UINT8(2, r.content_type);
+    TEST_ASSERT_EQUAL_UINT16(7, r.seq); // low 16 bits
+    TEST_ASSERT_EQUAL_UINT32(1400, r.t_us);
+    TEST_ASSERT_TRUE(rd.next(r));
+    TEST_ASSERT_TRUE(r.full_topic);
+    TEST_ASSERT_EQUAL_STRING_LEN("fleet/status", r.topic, r.topic_len);
+    TEST_ASSERT_FALSE(rd.next(r));
+    TEST_ASSERT_FALSE(rd.error());
+
+    // Held 20 ms, 19.5 ms and 17 ms
+    TEST_ASSERT_EQUAL_UINT32(20000, b.stats().hold_us_max);
+    TEST_ASSERT_EQUAL_UINT64(56500, b.stats().hold_us_sum);
+
+    // Truncated frames are rejected, not overrun
+    TEST_ASSERT_TRUE(rd.begin(frame, len - 1));
+    TEST_ASSERT_TRUE(rd.next(r));
+    TEST_ASSERT_TRUE(rd.next(r));
+    TEST_ASSERT_FALSE(rd.next(r));
+    TEST_ASSERT_TRUE(rd.error());
+}
+
+void test_full_and_too_large()
+{
+    static TelemetryBundler b;
+    b.configure(20000, 100);
+    uint8_t payload[60] = {};
+    TEST_ASSERT_TRUE(b.add("a", false, 0, payload, 40, 0, 0, 0) == TelemetryBundler::AddResult::Added);
+    TEST_ASSERT_TRUE(b.add("a", false, 0, payload, 40, 10, 1, 10) == TelemetryBundler::AddResult::Full);
+    TEST_ASSERT_TRUE(b.add("a", false, 0, payload, 90, 10, 1, 10) == TelemetryBundler::AddResult::TooLarge);
+
+    const uint8_t *frame = nullptr;
+    TEST_ASSERT_EQUAL(BUNDLE_HEADER_LEN + BUNDLE_RECORD_HEADER_LEN + 1 + 40, b.flush(10, true, frame));
+    TEST_ASSERT_TRUE(b.add("a", false, 0, payload, 40, 10, 1, 10) == TelemetryBundler::AddResult::Added);
+    TEST_ASSERT_EQUAL(1, b.stats().flush_full);
+    TEST_ASSERT_EQUAL(1, b.stats().too_large);
+
+    b.flush(20, false, frame);
+    TelemetryBundleReader rd;
+    TEST_ASSERT_TRUE(rd.begin(frame, BUNDLE_HEADER_LEN + BUNDLE_RECORD_HEADER_LEN + 41));
+    TEST_ASSERT_EQUAL_UINT16(1, rd.seq());
+}
+
+// ===== Efficiency vs latency ===================================================
+// A representative provider mix over 10 s. Wire cost per publish: MQTT fixed header (2) +
+// topic length (2) + topic + payload + TCP/IP headers (40); ACKs and Nagle ignored.
+struct Stream
+{
+    const char *suffix;
+    uint32_t rateHz;
+    size_t payload;
+};
+static const Stream kStreams[] = {
+    {"telemetry/imu", 100, 96},    // attitude JSON
+    {"telemetry/esc", 50, 24},     // 4x rpm/current
+    {"telemetry/battery", 10, 20}, // voltage/current/soc
+    {"telemetry/system", 1, 80},   // heap, uptime, rssi
+};
+static constexpr size_t kDeviceLen = 5; // "Drone/"
+static constexpr size_t kPerPublish = 2 + 2 + 40;
+
+struct SweepResult
+{
+    uint32_t publishes;
+    uint64_t wireBytes;
+    uint64_t payloadBytes;
+    double meanHoldMs;
+    double maxHoldMs;
+};
+
+static SweepResult sweep(uint32_t windowUs)
+{
+    struct Ev
+    {
+        uint32_t t;
+        const Stream *s;
+    };
+    std::vector<Ev> evs;
+    for (const auto &s : kStreams)
+        for (uint32_t t = 0; t < 10000000; t += 1000000 / s.rateHz)
+            evs.push_back({t + (uint32_t)(&s - kStreams) * 137, &s}); // providers aren't phase aligned
+    std::sort(evs.begin(), evs.end(), [](const Ev &a, const Ev &b)
+              { return a.t < b.t; });
+
+    SweepResult r{};
+    static uint8_t payload[256];
+    if (windowUs == 0)
+    {
+        for (const auto &e : evs)
+        {
+            r.publishes++;
+            r.payloadBytes += e.s->payload;
+            r.wireBytes += kPerPublish + kDeviceLen + 1 + strlen(e.s->suffix) + e.s->payload;
+        }
+        return r;
+    }
+
+    static TelemetryBundler b;
+    b = TelemetryBundler{};
+    b.configure(windowUs);
+    const size_t bundleTopic = kDeviceLen + 1 + strlen("telemetry/bundle");
+    const uint8_t *frame = nullptr;
+    auto publish = [&](size_t len)
+    {
+        r.publishes++;
+        r.wireBytes += kPerPublish + bundleTopic + len;
+    };
+    uint32_t deadline = 0;
+    auto add = [&](const Ev &e)
+    {
+        if (!b.pending())
+            deadline = e.t + windowUs;
+        return b.add(e.s->suffix, false, 0, payload, e.s->payload, e.t, 0, e.t);
+    };
+    for (const auto &e : evs)
+    {
+        // The TX task wakes at the deadline if nothing arrives before it
+        if (b.pending() && e.t >= deadline)
+            publish(b.flush(deadline, false, frame));
+        if (add(e) == TelemetryBundler::AddResult::Full)
+        {
+            publish(b.flush(e.t, true, frame));
+            add(e);
+        }
+        r.payloadBytes += e.s->payload;
+    }
+    if (b.pending())
+        publish(b.flush(deadline, false, frame));
+
+    const auto &st = b.stats();
+    TEST_ASSERT_EQUAL_UINT32(evs.size(), st.samples);
+    r.meanHoldMs = (double)st.hold_us_sum / st.samples / 1000.0;
+    r.maxHoldMs = st.hold_us_max / 1000.0;
+    return r;
+}
+
+void test_efficiency_vs_latency()
+{
+    const uint32_t windowsMs[] = {0, 5, 10, 20, 50};
+    SweepResult res[5];
+    TEST_MESSAGE("window  publishes/s  wire kB/s  payload%  hold mean/max ms");
+    for (int i = 0; i < 5; ++i)
+    {
+        res[i] = sweep(windowsMs[i] * 1000);
+        char line[120];
+        snprintf(line, sizeof(line), "%4u ms  %11.1f  %9.2f  %7.1f%%  %6.2f / %.2f", (unsigned)windowsMs[i],
+                 res[i].publishes / 10.0, res[i].wireBytes / 10.0 / 1000.0,
+                 100.0 * res[i].payloadBytes / res[i].wireBytes, res[i].meanHoldMs, res[i].maxHoldMs);
+        TEST_MESSAGE(line);
+    }
+
+    // 20 ms window: far fewer publishes and bytes, added latency bounded by the window
+    TEST_ASSERT_TRUE(res[3].publishes * 3 < res[0].publishes);
+    TEST_ASSERT_TRUE(res[3].wireBytes < res[0].wireBytes);
+    TEST_ASSERT_TRUE(res[3].maxHoldMs <= 20.0);
+    TEST_ASSERT_TRUE(res[3].meanHoldMs < 20.0);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_full_and_too_large);
+    RUN_TEST(test_efficiency_vs_latency);
+    return UNITY_END();
+}
@@ -0,0 +1,257 @@
+// Host-side tests for the CBOR and packed telemetry writers, plus an encode cost / size
+// comparison for the IMU attitude sample across JSON, CBOR and packed binary.
+// Run with: pio test -e native -f test_native_telemetry_encoding -v
+#include <unity.h>
+#include "telemetry/cbor_writer.hpp"
+#include "telemetry/packed_writer.hpp"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#if __has_include(<json_buffer_writer.hpp>)
+#include <json_buffer_writer.hpp>
+#define HAVE_JSON_BUF_WRITER 1
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#else
+static uint64_t cycles() { return 0; }
+#endif
+
+void setUp() {}
+void tearDown() {}
+
+void test_cbor_encodings()
+{
+    // Reference encodings from RFC 8949 appendix A
+    uint8_t buf[64];
+    const uint8_t *out;
+    size_t len;
+
+    CborBufWriter w(buf, sizeof(buf));
+    w.beginArray();
+    w.value((int32_t)10);
+    w.value((int32_t)100);
+    w.value((uint32_t)1000000);
+    w.value((int32_t)-1000);
+    w.value(1.5f);
+    w.value(true);
+    w.value("IETF");
+    w.endArray();
+    TEST_ASSERT_TRUE(w.finalize(out, len));
+    const uint8_t want[] = {0x9F, 0x0A, 0x18, 0x64, 0x1A, 0x00, 0x0F, 0x42, 0x40, 0x39, 0x03, 0xE7,
+                            0xFA, 0x3F, 0xC0, 0x00, 0x00, 0xF5, 0x64, 'I', 'E', 'T', 'F', 0xFF};
+    TEST_ASSERT_EQUAL(sizeof(want), len);
+    TEST_ASSERT_EQUAL_MEMORY(want, out, len);
+
+    // Unbalanced and overflowing writers refuse to finalize
+    w.reset(buf, sizeof(buf));
+    w.beginObject();
+    TEST_ASSERT_FALSE(w.finalize(out, len));
+    w.reset(buf, 3);
+    w.value(1.0f);
+    TEST_ASSERT_FALSE(w.finalize(out, len));
+}
+
+static const PackedField kFields[] = {
+    {"roll", PackedType::I16, 100.0f},
+    {"volts", PackedType::U16, 1000.0f},
+    {"temp", PackedType::F32, 0.0f},
+    {"armed", PackedType::Bool, 0.0f},
+};
+static const PackedSchema kSchema{7, kFields, 4};
+
+void test_packed_round_trip()
+{
+    uint8_t buf[32];
+    PackedBufWriter w(buf, sizeof(buf), &kSchema);
+    w.beginObject();
+    w.key("roll");
+    w.value(-12.345f);
+    w.key("volts");
+    w.value(11.1);
+    w.key("temp");
+    w.value(36.6f);
+    w.key("armed");
+    w.value(true);
+    w.endObject();
+
+    const uint8_t *out;
+    size_t len;
+    TEST_ASSERT_TRUE(w.finalize(out, len));
+    TEST_ASSERT_EQUAL(1 + 2 + 2 + 4 + 1, len);
+    TEST_ASSERT_EQUAL(PackedBufWriter::encodedLength(kSchema), len);
+
+    double v[4];
+    TEST_ASSERT_TRUE(packedDecode(kSchema, out, len, v));
+    TEST_ASSERT_TRUE(fabs(v[0] - -12.35) < 1e-9); // rounded to the scale
+    TEST_ASSERT_TRUE(fabs(v[1] - 11.1) < 1e-9);
+    TEST_ASSERT_TRUE(fabs(v[2] - 36.6) < 1e-5);
+    TEST_ASSERT_TRUE(v[3] == 1.0);
+    TEST_ASSERT_FALSE(packedDecode(kSchema, out, len - 1, v));
+}
+
+void test_packed_rejects_schema_drift()
+{
+    uint8_t buf[32];
+    const uint8_t *out;
+    size_t len;
+
+    PackedBufWriter w(buf, sizeof(buf), &kSchema);
+    w.beginObject();
+    w.key("pitch"); // not the next field
+    w.value(1.0f);
+    TEST_ASSERT_FALSE(w.ok());
+
+    w.reset(buf, sizeof(buf), &kSchema);
+    w.beginObject();
+    w.key("roll");
+    w.value(1.0f);
+    w.endObject(); // missing fields
+    TEST_ASSERT_FALSE(w.finalize(out, len));
+
+    w.reset(buf, sizeof(buf), &kSchema);
+    w.beginObject();
+    w.key("roll");
+    w.value(1000.0f); // saturates instead of wrapping
+    w.key("volts");
+    w.value(-1.0f);
+    w.key("temp");
+    w.value(0.0f);
+    w.key("armed");
+    w.value(false);
+    w.endObject();
+    TEST_ASSERT_TRUE(w.finalize(out, len));
+    double v[4];
+    TEST_ASSERT_TRUE(packedDecode(kSchema, out, len, v));
+    TEST_ASSERT_TRUE(fabs(v[0] - 327.67) < 1e-9);
+    TEST_ASSERT_TRUE(v[1] == 0.0);
+}
+
+// ===== IMU attitude: JSON vs CBOR vs packed ===================================
+static const PackedField kAttitudeFields[] = {
+    {"roll", PackedType::I16, 100.0f},
+    {"pitch", PackedType::I16, 100.0f},
+    {"yaw", PackedType::I16, 100.0f},
+};
+static const PackedSchema kAttitude{1, kAttitudeFields, 3};
+
+#ifndef HAVE_JSON_BUF_WRITER
+// Stand-in with JsonBufWriter's call sequence when the library isn't available on the host
+class JsonBufWriter
+{
+public:
+    JsonBufWriter(uint8_t *buf, size_t cap) : _buf(reinterpret_cast<char *>(buf)), _cap(cap) {}
+    void beginObject() { put("{"); }
+    void endObject() { put("}"); }
+    void key(const char *k)
+    {
+        if (_len > 1)
+            put(",");
+        _len += (size_t)snprintf(_buf + _len, _cap - _len, "\"%s\":", k);
+    }
+    void value(float v) { _len += (size_t)snprintf(_buf + _len, _cap - _len, "%.3f", v); }
+    bool finalize(const uint8_t *&out, size_t &len)
+    {
+        out = reinterpret_cast<const uint8_t *>(_buf);
+        len = _len;
+        return _len < _cap;
+    }
+
+private:
+    void put(const char *s) { _len += (size_t)snprintf(_buf + _len, _cap - _len, "%s", s); }
+    char *_buf;
+    size_t _cap;
+    size_t _len{0};
+};
+#endif
+
+template <typename W>
+static size_t encodeAttitude(W &w, float r, float p, float y)
+{
+    w.beginObject();
+    w.key("roll");
+    w.value(r);
+    w.key("pitch");
+    w.value(p);
+    w.key("yaw");
+    w.value(y);
+    w.endObject();
+    const uint8_t *out;
+    size_t len = 0;
+    return w.finalize(out, len) ? len : 0;
+}
+
+struct Bench
+{
+    double nsPerEncode;
+    double cyclesPerEncode;
+    double bytes;
+};
+
+template <typename Make>
+static Bench bench(Make &&make)
+{
+    static uint8_t buf[256];
+    const int n = 500000;
+    uint64_t bytes = 0;
+    const uint64_t c0 = cycles();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        // Realistic attitude values that change every sample
+        const float r = -45.0f + (i % 9000) * 0.01f, p = 12.5f - (i % 2500) * 0.01f, y = -179.99f + (i % 36000) * 0.01f;
+        auto w = make(buf, sizeof(buf));
+        bytes += encodeAttitude(w, r, p, y);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    return {ns / n, (double)(cycles() - c0) / n, (double)bytes / n};
+}
+
+void test_imu_encoding_comparison()
+{
+    const Bench json = bench([](uint8_t *b, size_t c)
+                             { return JsonBufWriter(b, c); });
+    const Bench cbor = bench([](uint8_t *b, size_t c)
+                             { return CborBufWriter(b, c); });
+    const Bench packed = bench([](uint8_t *b, size_t c)
+                               { return PackedBufWriter(b, c, &kAttitude); });
+
+    char line[120];
+#ifdef HAVE_JSON_BUF_WRITER
+    TEST_MESSAGE("encoding  ns/sample  cycles/sample  bytes");
+#else
+    TEST_MESSAGE("encoding  ns/sample  cycles/sample  bytes   (JSON: snprintf stand-in, library not on host)");
+#endif
+    const struct
+    {
+        const char *name;
+        const Bench &b;
+    } rows[] = {{"json", json}, {"cbor", cbor}, {"packed", packed}};
+    for (const auto &r : rows)
+    {
+        snprintf(line, sizeof(line), "%-8s  %9.1f  %13.0f  %5.1f", r.name, r.b.nsPerEncode, r.b.cyclesPerEncode,
+                 r.b.bytes);
+        TEST_MESSAGE(line);
+    }
+
+    TEST_ASSERT_TRUE(packed.bytes == 7.0);
+    TEST_ASSERT_TRUE(cbor.bytes == 1 + (1 + 4 + 5) + (1 + 5 + 5) + (1 + 3 + 5) + 1); // 32
+    TEST_ASSERT_TRUE(cbor.bytes < json.bytes);
+    TEST_ASSERT_TRUE(cbor.nsPerEncode < json.nsPerEncode);
+    TEST_ASSERT_TRUE(packed.nsPerEncode < json.nsPerEncode);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_cbor_encodings);
+    RUN_TEST(test_packed_round_trip);
+    RUN_TEST(test_packed_rejects_schema_drift);
+    RUN_TEST(test_imu_encoding_comparison);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+// Host-side tests for the telemetry buffer pool, incl. the queued-payload overwrite race it fixes.
+// Run with: pio test -e native -f test_native_telemetry_pool -v
+#include <unity.h>
+#include "telemetry/telemetry_buffer_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+void setUp() {}
+void tearDown() {}
+
+// What travels through the telemetry queue: a pointer, a length and (now) the pool slot
+struct QueuedSample
+{
+    const uint8_t *payload;
+    size_t len;
+    int8_t buffer;
+    uint32_t expected; // test only: the value the producer wrote
+};
+
+static size_t encode(uint8_t *buf, size_t cap, uint32_t seq)
+{
+    return (size_t)snprintf(reinterpret_cast<char *>(buf), cap, "{\"seq\":%u}", (unsigned)seq);
+}
+
+static bool intact(const QueuedSample &s)
+{
+    char want[32];
+    const size_t n = (size_t)snprintf(want, sizeof(want), "{\"seq\":%u}", (unsigned)s.expected);
+    return s.len == n && memcmp(s.payload, want, n) == 0;
+}
+
+void test_double_buffer_overwrites_queued_payloads()
+{
+    // The previous IMU scheme: two provider-owned buffers, a 64-deep queue of pointers.
+    // TX stalls for 5 samples (e.g. a TCP retransmit) and then drains.
+    static uint8_t buf[2][64];
+    std::deque<QueuedSample> queue;
+    for (uint32_t seq = 0; seq < 5; ++seq)
+    {
+        uint8_t *b = buf[seq % 2];
+        const size_t n = encode(b, sizeof(buf[0]), seq);
+        queue.push_back({b, n, -1, seq});
+    }
+
+    uint32_t corrupted = 0;
+    for (const auto &s : queue)
+        corrupted += intact(s) ? 0 : 1;
+
+    char line[80];
+    snprintf(line, sizeof(line), "double buffer: %u of 5 queued payloads overwritten", (unsigned)corrupted);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(3, corrupted); // only the last two survive
+}
+
+void test_pool_keeps_queued_payloads_intact()
+{
+    static TelemetryBufferPool pool;
+    std::deque<QueuedSample> queue;
+    const uint32_t produced = TELEMETRY_POOL_BUFFERS + 4;
+    for (uint32_t seq = 0; seq < produced; ++seq)
+    {
+        TelemetryLease l = pool.acquire();
+        if (!l.valid())
+            continue; // provider skips the sample
+        const size_t n = encode(l.data, l.capacity, seq);
+        queue.push_back({l.data, n, l.slot, seq});
+    }
+    TEST_ASSERT_EQUAL(TELEMETRY_POOL_BUFFERS, queue.size());
+    TEST_ASSERT_EQUAL_UINT32(4, pool.stats().exhausted);
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_POOL_BUFFERS, pool.stats().in_use);
+
+    while (!queue.empty())
+    {
+        TEST_ASSERT_TRUE(intact(queue.front()));
+        pool.release(queue.front().buffer); // after transmit()
+        queue.pop_front();
+    }
+    TEST_ASSERT_EQUAL(TELEMETRY_POOL_BUFFERS, pool.freeCount());
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_POOL_BUFFERS, pool.stats().high_water);
+    TEST_ASSERT_EQUAL_UINT32(pool.stats().acquired, pool.stats().released);
+}
+
+void test_refcount_holds_buffer_until_last_release()
+{
+    static TelemetryBufferPool pool;
+    TelemetryLease l = pool.acquire();
+    TEST_ASSERT_TRUE(l.valid());
+    pool.retain(l.slot); // e.g. queued to a second transport
+    pool.release(l.slot);
+    TEST_ASSERT_EQUAL(TELEMETRY_POOL_BUFFERS - 1, pool.freeCount());
+    pool.release(l.slot);
+    TEST_ASSERT_EQUAL(TELEMETRY_POOL_BUFFERS, pool.freeCount());
+
+    pool.release(-1); // provider-owned payloads pass through untouched
+    TEST_ASSERT_EQUAL_UINT32(1, pool.stats().released);
+}
+
+void test_concurrent_producer_and_slow_consumer()
+{
+    // Producer at full speed, consumer with periodic stalls; no payload may change while queued
+    static TelemetryBufferPool pool;
+    std::mutex mx;
+    std::condition_variable cv;
+    std::deque<QueuedSample> queue; // 64 deep like TELEMETRY_QUEUE_LEN
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> corrupted{0}; // Unity asserts must stay on the main thread
+    const uint32_t total = 200000;
+    uint32_t skipped = 0, queueFull = 0;
+
+    std::thread consumer([&]
+                         {
+        uint32_t n = 0;
+        for (;;)
+        {
+            QueuedSample s;
+            {
+                std::unique_lock<std::mutex> lk(mx);
+                cv.wait(lk, [&] { return !queue.empty() || done.load(); });
+                if (queue.empty())
+                    return;
+                s = queue.front();
+                queue.pop_front();
+            }
+            if (!intact(s))
+                corrupted++;
+            if (++n % 1000 == 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(200)); // TX stall
+            pool.release(s.buffer);
+        } });
+
+    for (uint32_t seq = 0; seq < total; ++seq)
+    {
+        TelemetryLease l = pool.acquire();
+        if (!l.valid())
+        {
+            skipped++;
+            continue;
+        }
+        const size_t n = encode(l.data, l.capacity, seq);
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> lk(mx);
+            if (queue.size() < 64)
+            {
+                queue.push_back({l.data, n, l.slot, seq});
+                queued = true;
+            }
+        }
+        if (!queued)
+        {
+            queueFull++;
+            pool.release(l.slot);
+        }
+        cv.notify_one();
+    }
+    done = true;
+    cv.notify_all();
+    consumer.join();
+
+    const auto st = pool.stats();
+    char line[120];
+    snprintf(line, sizeof(line), "%u samples: %u skipped (pool exhausted), %u queue full, high water %u/%u",
+             (unsigned)total, (unsigned)skipped, (unsigned)queueFull, (unsigned)st.high_water,
+             (unsigned)TELEMETRY_POOL_BUFFERS);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_UINT32(0, corrupted.load());
+    TEST_ASSERT_EQUAL_UINT32(skipped, st.exhausted);
+    TEST_ASSERT_EQUAL_UINT32(st.acquired, st.released);
+    TEST_ASSERT_EQUAL(TELEMETRY_POOL_BUFFERS, pool.freeCount());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_double_buffer_overwrites_queued_payloads);
+    RUN_TEST(test_pool_keeps_queued_payloads_intact);
+    RUN_TEST(test_refcount_holds_buffer_until_last_release);
+    RUN_TEST(test_concurrent_producer_and_slow_consumer);
+    return UNITY_END();
+}
@@ -0,0 +1,202 @@
+// Host-side tests for TelemetryService's bundling on the host_platform stand-ins: per-stream
+// outcomes counted when the frame is published, and state samples kept out of bundles while
+// MQTT is down so the outbox still holds their latest value.
+// Run with: pio test -e native -f test_native_telemetry_service -v
+#include <unity.h>
+#include "services/mqtt_service.hpp"
+#include "services/telemetry_service.hpp"
+#include "services/transport/loopback_transport.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <thread>
+
+void setUp() {}
+void tearDown() {}
+
+static LoopbackBroker broker;
+static LoopbackTransport device(broker, LinkModel{}, LinkModel{}, 1);
+static LoopbackTransport ground(broker, LinkModel{}, LinkModel{}, 2);
+
+static bool waitUntil(const std::function<bool()> &done, uint32_t timeoutMs = 3000)
+{
+    const uint64_t end = LoopbackBroker::nowUs() + timeoutMs * 1000ull;
+    while (!done() && LoopbackBroker::nowUs() < end)
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    return done();
+}
+
+// What the ground client got on Drone/telemetry/state and Drone/telemetry/bundle
+static std::mutex rxMx;
+static std::string lastState;
+static std::atomic<uint32_t> stateCount{0};
+static std::atomic<uint32_t> bundleCount{0};
+
+/// Unscheduled provider: the test publishes `"<value>"` samples of a Coalesce state stream.
+class StateProvider final : public ITelemetryProvider
+{
+public:
+    const char *name() const override { return "STATE"; }
+    uint32_t sampleRateHz() const override { return 10; }
+    bool begin() override
+    {
+        stream = registerStream("telemetry/state");
+        return stream != TELEMETRY_STREAM_NONE;
+    }
+
+    bool emit(int value)
+    {
+        TelemetryLease lease = acquireBuffer();
+        if (!lease.valid())
+            return false;
+        const int n = snprintf(reinterpret_cast<char *>(lease.data), lease.capacity, "%d", value);
+        TelemetrySample s{
+            .topic_suffix = "telemetry/state",
+            .payload = lease.data,
+            .payload_length = (size_t)n,
+            .meta = TelemetryMeta{
+                .qos = 0,
+                .retain = false,
+                .content_type = TelemetryContentType::TEXT,
+                .full_topic = false,
+                .offline = TelemetryOfflinePolicy::Coalesce,
+            }};
+        s.stream = stream;
+        return publishBuffer(lease, s, 0);
+    }
+
+    TelemetryStreamId stream{TELEMETRY_STREAM_NONE};
+};
+
+static StateProvider state;
+
+static TelemetryStreamStats::Snapshot stateStats()
+{
+    return TelemetryService::instance().streamStats(state.stream);
+}
+
+static void goOffline()
+{
+    WiFi.setAccessPoint(false);
+    device.disconnect();
+    TEST_ASSERT_TRUE(waitUntil([]
+                               { return !MqttService::MqttService::instance().mqttConnected(); }));
+}
+
+static void goOnline()
+{
+    WiFi.setAccessPoint(true);
+    TEST_ASSERT_TRUE(waitUntil([]
+                               { return MqttService::MqttService::instance().mqttConnected(); }, 10000));
+}
+
+void test_bundled_samples_count_when_the_frame_is_sent()
+{
+    auto &telemetry = TelemetryService::instance();
+    const uint32_t frames = bundleCount.load();
+    for (int i = 0; i < 5; ++i)
+        TEST_ASSERT_TRUE(state.emit(i));
+
+    // Held in the open frame (200 ms window): not sent yet
+    vTaskDelay(pdMS_TO_TICKS(50));
+    TEST_ASSERT_EQUAL_UINT32(0, stateStats().sent);
+    TEST_ASSERT_EQUAL_UINT32(0, bundleCount.load() - frames);
+
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return bundleCount.load() > frames; }));
+    TEST_ASSERT_TRUE(waitUntil([]
+                               { return stateStats().sent == 5; }));
+    TEST_ASSERT_EQUAL_UINT32(0, stateStats().tx_failures);
+    TEST_ASSERT_EQUAL_UINT32(5, telemetry.bundleStats().samples);
+}
+
+void test_frame_lost_to_an_outage_counts_as_failed()
+{
+    const TelemetryStreamStats::Snapshot before = stateStats();
+    TEST_ASSERT_TRUE(state.emit(10));
+    TEST_ASSERT_TRUE(state.emit(11));
+    vTaskDelay(pdMS_TO_TICKS(20)); // bundled while connected
+    goOffline();
+
+    // The frame is due while MQTT is down: dropped, and so are its samples
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return stateStats().tx_failures == before.tx_failures + 2; }));
+    TEST_ASSERT_EQUAL_UINT32(before.sent, stateStats().sent);
+    TEST_ASSERT_EQUAL_UINT32(0, MqttService::MqttService::instance().outboxStats().coalesced);
+}
+
+void test_offline_state_samples_keep_their_latest_value()
+{
+    // Still offline: the state stream bypasses the bundle, the outbox keeps the latest
+    const TelemetryStreamStats::Snapshot before = stateStats();
+    const uint32_t bundles = TelemetryService::instance().bundleStats().bundles;
+    for (int i = 20; i <= 22; ++i)
+        TEST_ASSERT_TRUE(state.emit(i));
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return stateStats().buffered == before.buffered + 3; }));
+    vTaskDelay(pdMS_TO_TICKS(250)); // past the bundle window
+    TEST_ASSERT_EQUAL_UINT32(bundles, TelemetryService::instance().bundleStats().bundles);
+
+    const uint32_t got = stateCount.load();
+    goOnline();
+    TEST_ASSERT_TRUE(waitUntil([&]
+                               { return stateCount.load() > got; }));
+    TEST_ASSERT_TRUE(broker.waitIdle());
+    vTaskDelay(pdMS_TO_TICKS(100)); // the outbox drains in ticks
+    TEST_ASSERT_EQUAL_UINT32(got + 1, stateCount.load());
+    std::lock_guard<std::mutex> g(rxMx);
+    TEST_ASSERT_EQUAL_STRING("22", lastState.c_str());
+}
+
+int main(int, char **)
+{
+    ground.onMessage([](const char *topic, const uint8_t *payload, size_t len, const MqttMessageProperties &, size_t,
+                        size_t)
+                     {
+        if (strcmp(topic, "Drone/telemetry/bundle") == 0)
+            bundleCount++;
+        if (strcmp(topic, "Drone/telemetry/state") != 0)
+            return;
+        std::lock_guard<std::mutex> g(rxMx);
+        lastState.assign(reinterpret_cast<const char *>(payload), len);
+        stateCount++; });
+    std::atomic<bool> up{false};
+    ground.onConnect([&](bool)
+                     { up = true; });
+    ground.connect();
+    waitUntil([&]
+              { return up.load(); });
+    std::atomic<bool> acked{false};
+    ground.onSubscribe([&](uint16_t, uint8_t)
+                       { acked = true; });
+    ground.subscribe("Drone/telemetry/#", 0);
+    waitUntil([&]
+              { return acked.load(); });
+    ground.onSubscribe(nullptr);
+
+    auto &mqtt = MqttService::MqttService::instance();
+    mqtt.setTransport(&device);
+    mqtt.begin("ssid", "pass", "Drone", IPAddress(127, 0, 0, 1), 1883);
+    waitUntil([&]
+              { return mqtt.mqttConnected(); });
+    auto &telemetry = TelemetryService::instance();
+    telemetry.begin("Drone");
+    telemetry.attachMqtt(mqtt);
+    telemetry.enableBundling(200);
+    telemetry.addProvider(&state);
+    TEST_ASSERT_TRUE(broker.waitIdle());
+
+    UNITY_BEGIN();
+    RUN_TEST(test_bundled_samples_count_when_the_frame_is_sent);
+    RUN_TEST(test_frame_lost_to_an_outage_counts_as_failed);
+    RUN_TEST(test_offline_state_samples_keep_their_latest_value);
+    const int failures = UNITY_END();
+
+    mqtt.setTransport(nullptr);
+    vTaskEndScheduler();
+    return failures;
+}
@@ -0,0 +1,143 @@
+// Host-side benchmark for the TX loop's topic handling: per-sample string building vs the
+// stream topic table. Counts heap allocations with a global operator new hook.
+// Run with: pio test -e native -f test_native_telemetry_tx -v
+#include <unity.h>
+#include "telemetry/telemetry_topic_table.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+static std::atomic<uint64_t> g_allocs{0};
+
+void *operator new(size_t n)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void setUp() {}
+void tearDown() {}
+
+static constexpr uint32_t kSamples = 2000000;
+static const char *kDevice = "FirePilot-0123456789"; // longer than SSO, like a real device ID
+static const char *kSuffixes[] = {"telemetry/imu", "telemetry/baro", "telemetry/battery"};
+
+// Stand-in for mqtt.tryPublish(): touch the topic so the work isn't optimized away
+static volatile uint32_t g_sink = 0;
+static void publish(const char *topic) { g_sink = g_sink + (uint8_t)topic[strlen(topic) - 1]; }
+
+struct Result
+{
+    double samplesPerSec;
+    double allocsPerSample;
+};
+
+template <typename Fn>
+static Result run(Fn &&perSample)
+{
+    const uint64_t a0 = g_allocs.load();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kSamples; ++i)
+        perSample(i);
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return {kSamples / secs, (double)(g_allocs.load() - a0) / kSamples};
+}
+
+void test_topic_table_lookup()
+{
+    TelemetryTopicTable t;
+    t.setPrefix("Drone");
+    const TelemetryStreamId imu = t.add("telemetry/imu");
+    TEST_ASSERT_EQUAL_UINT8(0, imu);
+    TEST_ASSERT_EQUAL_UINT8(imu, t.add("telemetry/imu")); // idempotent
+    TEST_ASSERT_EQUAL_STRING("Drone/telemetry/imu", t.topic(imu));
+    TEST_ASSERT_EQUAL_STRING("telemetry/imu", t.suffix(imu));
+
+    const TelemetryStreamId full = t.add("fleet/status", true);
+    TEST_ASSERT_EQUAL_STRING("fleet/status", t.topic(full));
+    TEST_ASSERT_NULL(t.topic(TELEMETRY_STREAM_NONE));
+    TEST_ASSERT_NULL(t.topic(7));
+
+    char scratch[TELEMETRY_TOPIC_MAX];
+    TEST_ASSERT_EQUAL_STRING("Drone/x", t.compose("x", false, scratch, sizeof(scratch)));
+
+    char longSuffix[TELEMETRY_TOPIC_MAX + 8];
+    memset(longSuffix, 'a', sizeof(longSuffix) - 1);
+    longSuffix[sizeof(longSuffix) - 1] = '\0';
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_STREAM_NONE, t.add(longSuffix));
+    TEST_ASSERT_EQUAL(2, t.size());
+}
+
+void test_topic_table_full()
+{
+    TelemetryTopicTable t;
+    static char names[TELEMETRY_MAX_STREAMS + 1][16];
+    for (int i = 0; i <= TELEMETRY_MAX_STREAMS; ++i)
+        snprintf(names[i], sizeof(names[i]), "s%d", i);
+    for (int i = 0; i < TELEMETRY_MAX_STREAMS; ++i)
+        TEST_ASSERT_EQUAL_UINT8(i, t.add(names[i]));
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_STREAM_NONE, t.add(names[TELEMETRY_MAX_STREAMS]));
+}
+
+void test_tx_topic_string_vs_table()
+{
+    // Previous TX loop: a String per sample, reserve() + prefix + '/' + suffix
+    const std::string deviceId = kDevice;
+    const Result str = run([&](uint32_t i)
+                           {
+        const char *suffix = kSuffixes[i % 3];
+        std::string topic;
+        topic.reserve(deviceId.length() + 1 + strlen(suffix));
+        topic = deviceId;
+        topic += '/';
+        topic += suffix;
+        publish(topic.c_str()); });
+
+    // Current TX loop: streams registered once, lookup by ID
+    TelemetryTopicTable table;
+    table.setPrefix(kDevice);
+    TelemetryStreamId ids[3];
+    for (int k = 0; k < 3; ++k)
+        ids[k] = table.add(kSuffixes[k]);
+    const Result tbl = run([&](uint32_t i)
+                           { publish(table.topic(ids[i % 3])); });
+
+    // Unregistered samples (no stream ID): composed into a fixed scratch buffer
+    char scratch[TELEMETRY_TOPIC_MAX];
+    const Result cmp = run([&](uint32_t i)
+                           { publish(table.compose(kSuffixes[i % 3], false, scratch, sizeof(scratch))); });
+
+    char line[160];
+    snprintf(line, sizeof(line), "string build:  %6.1f M samples/s, %.2f allocs/sample", str.samplesPerSec / 1e6,
+             str.allocsPerSample);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "table lookup:  %6.1f M samples/s, %.2f allocs/sample (%.1fx)", tbl.samplesPerSec / 1e6,
+             tbl.allocsPerSample, tbl.samplesPerSec / str.samplesPerSec);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "scratch build: %6.1f M samples/s, %.2f allocs/sample", cmp.samplesPerSec / 1e6,
+             cmp.allocsPerSample);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE(str.allocsPerSample >= 1.0);
+    TEST_ASSERT_EQUAL_UINT64(0, (uint64_t)(tbl.allocsPerSample * kSamples));
+    TEST_ASSERT_EQUAL_UINT64(0, (uint64_t)(cmp.allocsPerSample * kSamples));
+    TEST_ASSERT_TRUE(tbl.samplesPerSec > str.samplesPerSec);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_topic_table_lookup);
+    RUN_TEST(test_topic_table_full);
+    RUN_TEST(test_tx_topic_string_vs_table);
+    return UNITY_END();
+}
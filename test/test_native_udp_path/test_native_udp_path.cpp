@@ -0,0 +1,185 @@
+// Host-side tests for the UDP telemetry datagram and a TCP vs UDP loss/latency comparison.
+// Run with: pio test -e native -f test_native_udp_path -v
+#include <unity.h>
+#include "services/transport/udp_datagram.hpp"
+#include "services/transport/sim_link.hpp"
+#include "services/transport/loopback_transport.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+void test_datagram_round_trip()
+{
+    const char *topic = "dev/telemetry/imu";
+    const uint8_t payload[] = "{\"roll\":1.0}";
+    uint8_t buf[128];
+    const size_t n = UdpDatagram::encode(buf, sizeof(buf), topic, strlen(topic), payload, sizeof(payload) - 1,
+                                         0xFFFFFFF0u, 123456u, 0, UDP_DGRAM_FLAG_RESTART);
+    TEST_ASSERT_EQUAL(UDP_DGRAM_HEADER_LEN + strlen(topic) + sizeof(payload) - 1, n);
+
+    UdpDatagramView v{};
+    TEST_ASSERT_TRUE(UdpDatagram::decode(buf, n, v));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFF0u, v.seq);
+    TEST_ASSERT_EQUAL_UINT32(123456u, v.sender_us);
+    TEST_ASSERT_EQUAL(UDP_DGRAM_FLAG_RESTART, v.flags);
+    TEST_ASSERT_EQUAL(strlen(topic), v.topic_len);
+    TEST_ASSERT_EQUAL_MEMORY(topic, v.topic, v.topic_len);
+    TEST_ASSERT_EQUAL(sizeof(payload) - 1, v.payload_len);
+    TEST_ASSERT_EQUAL_MEMORY(payload, v.payload, v.payload_len);
+}
+
+void test_datagram_rejects_malformed()
+{
+    uint8_t buf[64];
+    UdpDatagramView v{};
+    TEST_ASSERT_EQUAL(0, UdpDatagram::encode(buf, 16, "a/b", 3, (const uint8_t *)"12345", 5, 0, 0, 0)); // too small
+    TEST_ASSERT_EQUAL(0, UdpDatagram::encode(buf, sizeof(buf), "", 0, nullptr, 0, 0, 0, 0));               // no topic
+
+    const size_t n = UdpDatagram::encode(buf, sizeof(buf), "a/b", 3, (const uint8_t *)"xy", 2, 1, 2, 0);
+    TEST_ASSERT_TRUE(n > 0);
+    TEST_ASSERT_FALSE(UdpDatagram::decode(buf, UDP_DGRAM_HEADER_LEN - 1, v)); // truncated header
+    TEST_ASSERT_FALSE(UdpDatagram::decode(buf, UDP_DGRAM_HEADER_LEN + 2, v)); // truncated topic
+    buf[0] = UDP_DGRAM_VERSION + 1;
+    TEST_ASSERT_FALSE(UdpDatagram::decode(buf, n, v));
+}
+
+void test_sequence_tracker_counts_loss_reorder_and_duplicates()
+{
+    using R = UdpSequenceTracker::Result;
+    UdpSequenceTracker t;
+    TEST_ASSERT_EQUAL(R::First, t.update(10));
+    TEST_ASSERT_EQUAL(R::InOrder, t.update(11));
+    TEST_ASSERT_EQUAL(R::Gap, t.update(14)); // 12, 13 missing
+    TEST_ASSERT_EQUAL_UINT32(2, t.stats().lost);
+    TEST_ASSERT_EQUAL(R::Late, t.update(12)); // 12 was only late
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats().lost);
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats().reordered);
+    TEST_ASSERT_EQUAL(R::Duplicate, t.update(14));
+    TEST_ASSERT_EQUAL_UINT32(1, t.stats().duplicate);
+    TEST_ASSERT_EQUAL_UINT32(4, t.stats().received);
+
+    // Wrap-around
+    UdpSequenceTracker w;
+    w.update(0xFFFFFFFEu);
+    TEST_ASSERT_EQUAL(R::InOrder, w.update(0xFFFFFFFFu));
+    TEST_ASSERT_EQUAL(R::InOrder, w.update(0));
+    TEST_ASSERT_EQUAL_UINT32(0, w.stats().lost);
+
+    // Sender restart
+    TEST_ASSERT_EQUAL(R::First, w.update(0, UDP_DGRAM_FLAG_RESTART));
+    TEST_ASSERT_EQUAL_UINT32(1, w.stats().restarts);
+}
+
+// ===== TCP (MQTT) vs UDP on the same lossy link ==============================
+struct PathResult
+{
+    uint32_t delivered;
+    uint32_t lost;
+    double p50_us, p99_us, max_us;
+};
+
+static double percentile(std::vector<uint64_t> v, double p)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    const size_t i = std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+    return (double)v[i];
+}
+
+// 100 Hz IMU stream in virtual time through one SimLink; latency = arrival - capture
+static PathResult runStream(bool reliable, const LinkModel &link, int samples, uint32_t seed)
+{
+    SimLink l(link, reliable, seed);
+    std::vector<uint64_t> lat;
+    const char *topic = "dev/telemetry/imu";
+    const uint8_t payload[48] = {};
+    uint8_t dgram[128];
+
+    struct Arrival
+    {
+        uint64_t at;
+        uint64_t sent;
+    };
+    std::vector<Arrival> arrivals;
+
+    for (int i = 0; i < samples; ++i)
+    {
+        const uint64_t now = (uint64_t)i * 10000; // 100 Hz
+        const size_t n = UdpDatagram::encode(dgram, sizeof(dgram), topic, strlen(topic), payload, sizeof(payload),
+                                             (uint32_t)i, (uint32_t)now, 0);
+        const size_t wire = reliable ? LoopbackBroker::publishWireBytes(strlen(topic), sizeof(payload), 0)
+                                     : n + 28; // IP + UDP headers
+        uint64_t at = 0;
+        if (l.schedule(wire, now, at))
+            arrivals.push_back({at, now});
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(), [](const Arrival &a, const Arrival &b)
+                     { return a.at < b.at; });
+    for (const Arrival &a : arrivals)
+    {
+        lat.push_back(a.at - a.sent);
+    }
+
+    const uint32_t delivered = (uint32_t)arrivals.size();
+    return {delivered, (uint32_t)samples - delivered,
+            percentile(lat, 0.50), percentile(lat, 0.99), percentile(lat, 1.0)};
+}
+
+static void reportPath(const char *what, const PathResult &r)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "%s: delivered %u lost %u, latency p50 %.1f ms p99 %.1f ms max %.1f ms",
+             what, (unsigned)r.delivered, (unsigned)r.lost, r.p50_us / 1000.0, r.p99_us / 1000.0, r.max_us / 1000.0);
+    TEST_MESSAGE(line);
+}
+
+void test_udp_avoids_head_of_line_blocking_on_lossy_link()
+{
+    LinkModel link;
+    link.latency_us = 5000;
+    link.jitter_us = 2000;
+    link.loss = 0.02f;
+    link.retransmit_us = 200000;
+    const int n = 3000; // 30 s @ 100 Hz
+
+    const PathResult tcp = runStream(true, link, n, 7);
+    const PathResult udp = runStream(false, link, n, 7);
+    reportPath("MQTT/TCP, 2% loss", tcp);
+    reportPath("UDP,      2% loss", udp);
+
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)n, tcp.delivered); // reliable: nothing lost...
+    TEST_ASSERT_TRUE(udp.lost > 0);                       // ...UDP drops some samples
+    TEST_ASSERT_TRUE(udp.lost < (uint32_t)n / 20);
+    TEST_ASSERT_TRUE(udp.max_us <= link.latency_us + link.jitter_us + 1000); // never stalls
+    TEST_ASSERT_TRUE(tcp.p99_us > 10 * udp.p99_us);                          // ...but TCP stalls behind retransmits
+}
+
+void test_paths_match_on_clean_link()
+{
+    LinkModel link;
+    link.latency_us = 5000;
+    const PathResult tcp = runStream(true, link, 500, 1);
+    const PathResult udp = runStream(false, link, 500, 1);
+    reportPath("MQTT/TCP, no loss", tcp);
+    reportPath("UDP,      no loss", udp);
+    TEST_ASSERT_EQUAL_UINT32(500, udp.delivered);
+    TEST_ASSERT_EQUAL_UINT32(500, tcp.delivered);
+    TEST_ASSERT_TRUE(tcp.p99_us == udp.p99_us); // same latency model without loss
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_datagram_round_trip);
+    RUN_TEST(test_datagram_rejects_malformed);
+    RUN_TEST(test_sequence_tracker_counts_loss_reorder_and_duplicates);
+    RUN_TEST(test_udp_avoids_head_of_line_blocking_on_lossy_link);
+    RUN_TEST(test_paths_match_on_clean_link);
+    return UNITY_END();
+}
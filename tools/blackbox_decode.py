@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+"""Fetch and decode FirePilot blackbox logs (see src/telemetry/blackbox_log.hpp).
+
+Logs are self-describing: each one starts with the packed schemas it uses, so decoding
+needs no firmware sources. `decode` writes one CSV per schema (`<log>_<name>.csv`,
+columns t_us + fields), raw IMU blocks to `<log>_imu_raw.csv` (see imu_raw_rx.py), and
+reports lost or damaged blocks.
+
+    python3 tools/blackbox_decode.py decode 0003.bbl --out-dir logs/
+    python3 tools/blackbox_decode.py list --broker localhost --device guspet24
+    python3 tools/blackbox_decode.py fetch-mqtt --broker localhost --device guspet24 0003.bbl
+    python3 tools/blackbox_decode.py fetch-serial --port /dev/ttyUSB0 0003.bbl
+    python3 tools/blackbox_decode.py fetch-serial --capture monitor.txt 0003.bbl
+
+fetch-* save the log (add --decode to convert it right away). fetch-mqtt and list need
+paho-mqtt, fetch-serial --port needs pyserial.
+"""
+
+import argparse
+import csv
+import json
+import os
+import struct
+import sys
+import time
+
+import imu_raw_rx
+
+BLOCK_SIZE = 4096
+BLOCK_MAGIC = 0x4B424246  # "FBBK"
+BLOCK = struct.Struct("<IIHH")  # magic, seq, used, frames
+FRAME = struct.Struct("<BI")  # len, t_us
+SCHEMA_DEF = 0
+
+# PackedType -> (struct code, integer)
+TYPES = {0: ("f", False), 1: ("b", True), 2: ("B", True), 3: ("h", True),
+         4: ("H", True), 5: ("i", True), 6: ("I", True), 7: ("?", False)}
+
+
+def parse_schema(payload):
+    """Return (id, name, [(field, code, is_int, scale), ...]) from a definition frame."""
+    sid, count = payload[1], payload[2]
+    pos = 3
+
+    def name():
+        nonlocal pos
+        n = payload[pos]
+        s = payload[pos + 1:pos + 1 + n].decode("utf-8", "replace")
+        pos += 1 + n
+        return s
+
+    schema_name = name()
+    fields = []
+    for _ in range(count):
+        ptype = payload[pos]
+        (scale,) = struct.unpack_from("<f", payload, pos + 1)
+        pos += 5
+        code, is_int = TYPES[ptype]
+        fields.append((name(), code, is_int, scale))
+    return sid, schema_name, fields
+
+
+def frames(data, stats):
+    """Yield (t_us, payload) for every frame; fills stats with block/lost/bad counts."""
+    next_seq = 0
+    for off in range(0, len(data) - BLOCK_SIZE + 1, BLOCK_SIZE):
+        magic, seq, used, _count = BLOCK.unpack_from(data, off)
+        if magic != BLOCK_MAGIC or used < BLOCK.size or used > BLOCK_SIZE:
+            stats["bad"] += 1
+            continue
+        if seq > next_seq:
+            stats["lost"] += seq - next_seq
+        next_seq = seq + 1
+        stats["blocks"] += 1
+        pos, end = off + BLOCK.size, off + used
+        while pos + FRAME.size <= end:
+            n, t_us = FRAME.unpack_from(data, pos)
+            if pos + FRAME.size + n > end:
+                stats["bad"] += 1
+                break
+            yield t_us, data[pos + FRAME.size:pos + FRAME.size + n]
+            pos += FRAME.size + n
+    if len(data) % BLOCK_SIZE:
+        stats["bad"] += 1  # truncated transfer
+
+
+def decode(path, out_dir):
+    with open(path, "rb") as f:
+        data = f.read()
+    stats = {"blocks": 0, "lost": 0, "bad": 0}
+    schemas, writers, files, counts = {}, {}, [], {}
+    base = os.path.splitext(os.path.basename(path))[0]
+    os.makedirs(out_dir, exist_ok=True)
+    unknown = 0
+    try:
+        for t_us, payload in frames(data, stats):
+            if not payload:
+                continue
+            if payload[0] == SCHEMA_DEF:
+                sid, name, fields = parse_schema(payload)
+                fmt = "<" + "".join(code for _, code, _, _ in fields)
+                schemas[sid] = (name, fields, struct.Struct(fmt))
+                continue
+            sid = payload[0]
+            if sid == imu_raw_rx.BLOCK_ID and sid not in schemas:
+                parsed = imu_raw_rx.parse_block(payload)
+                if parsed is None:
+                    stats["bad"] += 1
+                    continue
+                if sid not in writers:
+                    f = open(os.path.join(out_dir, "%s_imu_raw.csv" % base), "w", newline="")
+                    files.append(f)
+                    writers[sid] = csv.writer(f)
+                    writers[sid].writerow(imu_raw_rx.CSV_HEADER)
+                for r in parsed[1]:
+                    writers[sid].writerow([r[0], r[1]] + ["%.5f" % v for v in r[2:]])
+                counts["imu_raw"] = counts.get("imu_raw", 0) + len(parsed[1])
+                continue
+            if sid not in schemas:
+                unknown += 1
+                continue
+            name, fields, st = schemas[sid]
+            if len(payload) != 1 + st.size:
+                stats["bad"] += 1
+                continue
+            if sid not in writers:
+                f = open(os.path.join(out_dir, "%s_%s.csv" % (base, name)), "w", newline="")
+                files.append(f)
+                writers[sid] = csv.writer(f)
+                writers[sid].writerow(["t_us"] + [fname for fname, _, _, _ in fields])
+            raw = st.unpack_from(payload, 1)
+            row = [t_us]
+            for (_, _, is_int, scale), v in zip(fields, raw):
+                row.append(v / scale if is_int and scale not in (0.0, 1.0) else v)
+            writers[sid].writerow(row)
+            counts[name] = counts.get(name, 0) + 1
+    finally:
+        for f in files:
+            f.close()
+
+    print("%s: %d blocks, %d lost, %d damaged" % (path, stats["blocks"], stats["lost"], stats["bad"]))
+    for name, n in sorted(counts.items()):
+        print("  %-10s %8d samples -> %s_%s.csv" % (name, n, base, name))
+    if unknown:
+        print("  %d frames with an undefined schema skipped" % unknown)
+    return stats["lost"] == 0 and stats["bad"] == 0
+
+
+# ===== Retrieval ==============================================================
+
+def mqtt_client(args):
+    import paho.mqtt.client as mqtt
+    c = mqtt.Client()
+    c.connect(args.broker, args.port)
+    return c
+
+
+def list_mqtt(args):
+    c = mqtt_client(args)
+    done = {}
+
+    def on_message(_c, _u, msg):
+        info = json.loads(msg.payload)
+        if info.get("event") == "list":
+            done["info"] = info
+
+    c.on_message = on_message
+    c.subscribe("%s/blackbox/info" % args.device, qos=1)
+    c.publish("%s/blackbox/cmd" % args.device, "list", qos=1)
+    deadline = time.time() + args.timeout
+    while "info" not in done and time.time() < deadline:
+        c.loop(0.1)
+    if "info" not in done:
+        sys.exit("no answer from %s" % args.device)
+    info = done["info"]
+    print("recording: %s %s" % (info["recording"], info["log"]))
+    for f in info["files"]:
+        print("  %-10s %9d bytes" % (f["name"], f["size"]))
+
+
+def fetch_mqtt(args):
+    c = mqtt_client(args)
+    chunks, state = {}, {}
+
+    def on_message(_c, _u, msg):
+        if msg.topic.endswith("/blackbox/info"):
+            info = json.loads(msg.payload)
+            if info.get("event") == "get" and info.get("log") == args.log:
+                state["done"] = info
+            return
+        (offset,) = struct.unpack_from("<I", msg.payload)
+        chunks[offset] = msg.payload[4:]
+
+    c.on_message = on_message
+    c.subscribe("%s/blackbox/data/%s" % (args.device, args.log), qos=1)
+    c.subscribe("%s/blackbox/info" % args.device, qos=1)
+    c.publish("%s/blackbox/cmd" % args.device, "get " + args.log, qos=1)
+    deadline = time.time() + args.timeout
+    while "done" not in state and time.time() < deadline:
+        c.loop(0.1)
+    for _ in range(20):  # chunks still in flight behind the completion message
+        c.loop(0.05)
+    return assemble(chunks, state.get("done", {}).get("bytes"), args)
+
+
+def fetch_serial(args):
+    chunks, total = {}, None
+
+    def feed(line):
+        nonlocal total
+        parts = line.strip().split()
+        if len(parts) < 3 or parts[0] != "BB":
+            return False
+        if parts[1] == "END" and parts[2] == args.log:
+            total = int(parts[3])
+            return True
+        if parts[1] == args.log and len(parts) == 4:
+            chunks[int(parts[2])] = bytes.fromhex(parts[3])
+        return False
+
+    if args.capture:
+        with open(args.capture, errors="replace") as f:
+            for line in f:
+                if feed(line):
+                    break
+    else:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=1) as s:
+            s.write(("bb get %s\n" % args.log).encode())
+            deadline = time.time() + args.timeout
+            while time.time() < deadline:
+                if feed(s.readline().decode(errors="replace")):
+                    break
+    return assemble(chunks, total, args)
+
+
+def assemble(chunks, total, args):
+    data, pos = bytearray(), 0
+    for offset in sorted(chunks):
+        if offset != pos:
+            sys.exit("missing bytes %d..%d" % (pos, offset))
+        data += chunks[offset]
+        pos += len(chunks[offset])
+    if total is None or pos != total:
+        sys.exit("incomplete: got %d of %s bytes" % (pos, total if total is not None else "?"))
+    out = args.out or args.log
+    with open(out, "wb") as f:
+        f.write(data)
+    print("saved %s (%d bytes)" % (out, len(data)))
+    if args.decode:
+        decode(out, args.out_dir)
+    return True
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    d = sub.add_parser("decode", help="log -> CSV per schema")
+    d.add_argument("log")
+    d.add_argument("--out-dir", default=".")
+
+    for name in ("list", "fetch-mqtt"):
+        p = sub.add_parser(name)
+        p.add_argument("--broker", default="localhost")
+        p.add_argument("--port", type=int, default=1883)
+        p.add_argument("--device", required=True)
+        p.add_argument("--timeout", type=float, default=120.0)
+        if name == "fetch-mqtt":
+            p.add_argument("log")
+
+    s = sub.add_parser("fetch-serial")
+    s.add_argument("log")
+    src = s.add_mutually_exclusive_group(required=True)
+    src.add_argument("--port", help="serial port, sends 'bb get <log>'")
+    src.add_argument("--capture", help="saved monitor output with the BB lines")
+    s.add_argument("--baud", type=int, default=115200)
+    s.add_argument("--timeout", type=float, default=300.0)
+
+    for p in (sub.choices["fetch-mqtt"], s):
+        p.add_argument("--out", help="file to save to (default: the log name)")
+        p.add_argument("--decode", action="store_true", help="convert to CSV after fetching")
+        p.add_argument("--out-dir", default=".")
+
+    args = ap.parse_args()
+    if args.cmd == "decode":
+        sys.exit(0 if decode(args.log, args.out_dir) else 1)
+    if args.cmd == "list":
+        list_mqtt(args)
+    elif args.cmd == "fetch-mqtt":
+        fetch_mqtt(args)
+    else:
+        fetch_serial(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Ground-side decoder for quantized delta telemetry (IMU_ENCODING = DELTA).
+
+Subscribes to `<device>/telemetry/imu` (see src/telemetry/delta_codec.hpp), rebuilds the
+samples from keyframes and zigzag varint deltas, and prints them, writes them as CSV or
+republishes them as JSON. Deltas after lost samples are skipped until the next keyframe;
+the stats line counts them.
+
+    python3 tools/imu_delta_rx.py --broker localhost --device guspet24
+    python3 tools/imu_delta_rx.py --broker localhost --device guspet24 --csv imu.csv
+    python3 tools/imu_delta_rx.py --broker localhost --device guspet24 --republish telemetry/imu_json
+    python3 tools/imu_delta_rx.py --decode payloads.bin   # u8 length-prefixed captured payloads
+
+The payload carries no scale: --fields and --scale must match the firmware schema (default:
+the IMU attitude, 0.01 deg). Needs paho-mqtt (pip install paho-mqtt) except with --decode.
+"""
+
+import argparse
+import csv
+import json
+import math
+import sys
+import time
+
+FLAG_KEYFRAME = 0x8000
+SEQ_MASK = 0x7FFF
+HEADER_BYTES = 3  # schema id, u16 hdr (little endian)
+
+
+def get_varint(data, pos):
+    """Return (value, new_pos) for one zigzag varint, or None if truncated/too long."""
+    z = 0
+    for n in range(5):
+        if pos + n >= len(data):
+            return None
+        b = data[pos + n]
+        z |= (b & 0x7F) << (7 * n)
+        if not b & 0x80:
+            return (z >> 1) ^ -(z & 1), pos + n + 1
+    return None
+
+
+class DeltaDecoder:
+    """Mirror of DeltaDecoder in delta_codec.cpp."""
+
+    def __init__(self, schema_id, scales):
+        self.schema_id, self.scales = schema_id, scales
+        self.prev = [0] * len(scales)
+        self.synced = False
+        self.next_seq = None
+        self.samples = self.keyframes = self.lost = self.skipped = self.errors = 0
+        self.bytes = 0
+
+    def decode(self, payload):
+        """Return the decoded values, or None (waiting for a keyframe or malformed)."""
+        if len(payload) < HEADER_BYTES or payload[0] != self.schema_id:
+            self.errors += 1
+            return None
+        hdr = payload[1] | (payload[2] << 8)
+        key, seq = bool(hdr & FLAG_KEYFRAME), hdr & SEQ_MASK
+        vals, pos = [], HEADER_BYTES
+        for _ in self.scales:
+            r = get_varint(payload, pos)
+            if r is None:
+                self.errors += 1
+                return None
+            v, pos = r
+            vals.append(v)
+        if pos != len(payload):
+            self.errors += 1
+            return None
+        self.bytes += len(payload)
+
+        if self.next_seq is not None and seq != self.next_seq:
+            self.lost += (seq - self.next_seq) & SEQ_MASK
+            self.synced = False
+        self.next_seq = (seq + 1) & SEQ_MASK
+        if not key and not self.synced:
+            self.skipped += 1
+            return None
+
+        self.prev = vals if key else [p + d for p, d in zip(self.prev, vals)]
+        self.synced = True
+        self.samples += 1
+        self.keyframes += key
+        return [q / s for q, s in zip(self.prev, self.scales)]
+
+    def report(self):
+        avg = self.bytes / max(1, self.samples + self.skipped)
+        return ("samples %d  keyframes %d  lost %d  skipped %d  malformed %d  avg %.2f B/sample"
+                % (self.samples, self.keyframes, self.lost, self.skipped, self.errors, avg))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--broker", default="localhost")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--device", default="guspet24", help="device ID (DEVICE_ID in main.cpp)")
+    ap.add_argument("--topic", default="telemetry/imu", help="topic suffix of the delta stream")
+    ap.add_argument("--schema", type=int, default=1, help="schema ID (first payload byte)")
+    ap.add_argument("--fields", default="roll,pitch,yaw")
+    ap.add_argument("--scale", type=float, default=100.0, help="quantization scale, 1/resolution")
+    ap.add_argument("--csv", metavar="FILE", help="write samples as CSV (rx time, fields)")
+    ap.add_argument("--republish", metavar="SUFFIX", help="publish samples as JSON to <device>/SUFFIX")
+    ap.add_argument("--quiet", action="store_true", help="don't print samples")
+    ap.add_argument("--stats", type=float, default=5.0, help="stats interval in seconds (0 = off)")
+    ap.add_argument("--decode", metavar="FILE", help="decode u8 length-prefixed payloads from a file and exit")
+    args = ap.parse_args()
+
+    fields = args.fields.split(",")
+    dec = DeltaDecoder(args.schema, [args.scale] * len(fields))
+    out = open(args.csv, "w", newline="") if args.csv else None
+    writer = csv.writer(out) if out else None
+    if writer:
+        writer.writerow(["rx_s"] + fields)
+    digits = max(0, round(math.log10(args.scale)))
+
+    def emit(values, rx):
+        if writer:
+            writer.writerow(["%.6f" % rx] + ["%.*f" % (digits, v) for v in values])
+        if not args.quiet:
+            print(" ".join("%s=%8.2f" % (f, v) for f, v in zip(fields, values)))
+
+    if args.decode:
+        with open(args.decode, "rb") as f:
+            data = f.read()
+        pos = 0
+        while pos < len(data):
+            n = data[pos]
+            values = dec.decode(data[pos + 1:pos + 1 + n])
+            pos += 1 + n
+            if values is not None:
+                emit(values, 0.0)
+        if out:
+            out.close()
+        print(dec.report())
+        return
+
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("needs paho-mqtt: pip install paho-mqtt")
+
+    topic = f"{args.device}/{args.topic}"
+
+    def on_connect(client, userdata, flags, rc):
+        client.subscribe(topic, qos=0)
+
+    def on_message(client, userdata, msg):
+        values = dec.decode(msg.payload)
+        if values is None:
+            return
+        emit(values, time.time())
+        if args.republish:
+            client.publish(f"{args.device}/{args.republish}", json.dumps(dict(zip(fields, values))), qos=0)
+
+    client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.broker, args.port)
+    client.loop_start()
+    try:
+        while True:
+            time.sleep(args.stats if args.stats else 1.0)
+            if args.stats:
+                print(dec.report(), flush=True)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out:
+            out.close()
+        client.loop_stop()
+        client.disconnect()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""Ground-side decoder for the IMU raw mode (see src/telemetry/imu_raw_block.hpp).
+
+Receives raw accel + gyro blocks from MQTT (`<device>/telemetry/imu_raw`) or a serial port,
+writes every sample as CSV in g and deg/s, and prints what the link really sustained: blocks
+and samples per second, samples lost (jumps in the block index), and for serial the frames
+with a bad CRC. Blackbox logs are decoded by blackbox_decode.py, which uses this module.
+
+    python3 tools/imu_raw_rx.py mqtt --broker localhost --device guspet24 --enable --csv raw.csv
+    python3 tools/imu_raw_rx.py serial --port /dev/ttyUSB0 --baud 921600 --csv raw.csv
+    python3 tools/imu_raw_rx.py decode capture.bin   # a raw serial capture
+
+--enable sends "on" to `<device>/imu/raw` at start and "off" on exit. mqtt needs paho-mqtt,
+serial needs pyserial.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+import time
+
+BLOCK_ID = 0x52
+FLAG_GAP = 0x01
+HEADER = struct.Struct("<BBHIIHH")  # id, flags, rate_hz, index, t_us, accel_lsb_per_g, gyro_lsb_per_dps x10
+SAMPLE = struct.Struct("<6h")
+SYNC = b"\xa5\x5a"
+CSV_HEADER = ["index", "t_us", "ax_g", "ay_g", "az_g", "gx_dps", "gy_dps", "gz_dps"]
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as imuRawCrc16()."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def parse_block(payload):
+    """Return (header dict, [(index, t_us, ax, ay, az, gx, gy, gz) in g and deg/s]) or None."""
+    if len(payload) < HEADER.size or payload[0] != BLOCK_ID or (len(payload) - HEADER.size) % SAMPLE.size:
+        return None
+    _, flags, rate, index, t_us, acc_lsb, gyr_lsb10 = HEADER.unpack_from(payload)
+    n = (len(payload) - HEADER.size) // SAMPLE.size
+    if not rate or not acc_lsb or not gyr_lsb10:
+        return None
+    period = 1e6 / rate
+    rows = []
+    for i in range(n):
+        ax, ay, az, gx, gy, gz = SAMPLE.unpack_from(payload, HEADER.size + i * SAMPLE.size)
+        t = t_us - (n - 1 - i) * period  # t_us is the last sample's read time
+        rows.append((index + i, int(t) & 0xFFFFFFFF, ax / acc_lsb, ay / acc_lsb, az / acc_lsb,
+                     gx * 10.0 / gyr_lsb10, gy * 10.0 / gyr_lsb10, gz * 10.0 / gyr_lsb10))
+    hdr = {"flags": flags, "rate_hz": rate, "index": index, "t_us": t_us, "count": n}
+    return hdr, rows
+
+
+class RawStats:
+    """Counts what arrived against what the index says was sent."""
+
+    def __init__(self):
+        self.blocks = self.samples = self.lost = self.gaps = self.bad = self.crc = self.bytes = 0
+        self.rate_hz = 0
+        self.next_index = None
+        self.t0 = time.time()
+        self.window = (self.t0, 0, 0)  # time, blocks, samples at the last report
+
+    def add(self, hdr, nbytes):
+        self.blocks += 1
+        self.samples += hdr["count"]
+        self.bytes += nbytes
+        self.rate_hz = hdr["rate_hz"]
+        self.gaps += bool(hdr["flags"] & FLAG_GAP)
+        if self.next_index is not None and hdr["index"] != self.next_index:
+            self.lost += (hdr["index"] - self.next_index) & 0xFFFFFFFF
+        self.next_index = (hdr["index"] + hdr["count"]) & 0xFFFFFFFF
+
+    def report(self):
+        now = time.time()
+        t, b, s = self.window
+        dt = max(1e-6, now - t)
+        self.window = (now, self.blocks, self.samples)
+        total = self.samples + self.lost
+        return ("rate %d Hz  rx %.1f blocks/s  %.0f samples/s  %.1f kB/s  lost %d (%.2f %%)  gaps %d  bad %d  crc %d"
+                % (self.rate_hz, (self.blocks - b) / dt, (self.samples - s) / dt,
+                   self.bytes / 1000.0 / max(1e-6, now - self.t0), self.lost,
+                   100.0 * self.lost / total if total else 0.0, self.gaps, self.bad, self.crc))
+
+
+class SerialDeframer:
+    """Finds 0xA5 0x5A | len | block | crc16 frames in a byte stream that also carries log text."""
+
+    def __init__(self, stats):
+        self.buf = bytearray()
+        self.stats = stats
+
+    def feed(self, data):
+        self.buf += data
+        blocks = []
+        while True:
+            i = self.buf.find(SYNC)
+            if i < 0:
+                del self.buf[:-1]  # keep a trailing 0xA5
+                return blocks
+            del self.buf[:i]
+            if len(self.buf) < 3:
+                return blocks
+            n = self.buf[2]
+            if len(self.buf) < 3 + n + 2:
+                return blocks
+            block = bytes(self.buf[3:3 + n])
+            (crc,) = struct.unpack_from("<H", self.buf, 3 + n)
+            if crc != crc16(block):
+                self.stats.crc += 1
+                del self.buf[:2]  # a false sync inside log text or a damaged frame: look further
+                continue
+            del self.buf[:3 + n + 2]
+            blocks.append(block)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", choices=["mqtt", "serial", "decode"])
+    ap.add_argument("file", nargs="?", help="decode: raw serial capture")
+    ap.add_argument("--broker", default="localhost")
+    ap.add_argument("--mqtt-port", type=int, default=1883)
+    ap.add_argument("--device", default="guspet24", help="device ID (DEVICE_ID in main.cpp)")
+    ap.add_argument("--topic", default="telemetry/imu_raw", help="topic suffix of the raw stream")
+    ap.add_argument("--enable", action="store_true", help="switch raw mode on for the run (imu/raw)")
+    ap.add_argument("--port", help="serial port")
+    ap.add_argument("--baud", type=int, default=921600)
+    ap.add_argument("--csv", metavar="FILE", help="write samples as CSV")
+    ap.add_argument("--duration", type=float, default=0.0, help="seconds to run (0 = until Ctrl-C)")
+    ap.add_argument("--stats", type=float, default=2.0, help="stats interval in seconds")
+    args = ap.parse_args()
+
+    stats = RawStats()
+    out = open(args.csv, "w", newline="") if args.csv else None
+    writer = csv.writer(out) if out else None
+    if writer:
+        writer.writerow(CSV_HEADER)
+
+    def on_block(payload):
+        parsed = parse_block(payload)
+        if parsed is None:
+            stats.bad += 1
+            return
+        hdr, rows = parsed
+        stats.add(hdr, len(payload))
+        if writer:
+            for r in rows:
+                writer.writerow([r[0], r[1]] + ["%.5f" % v for v in r[2:]])
+
+    if args.source == "decode":
+        if not args.file:
+            sys.exit("decode needs a capture file")
+        deframer = SerialDeframer(stats)
+        with open(args.file, "rb") as f:
+            for block in deframer.feed(f.read()):
+                on_block(block)
+        if out:
+            out.close()
+        print(stats.report())
+        return
+
+    client = ser = None
+    if args.source == "mqtt":
+        try:
+            import paho.mqtt.client as mqtt
+        except ImportError:
+            sys.exit("needs paho-mqtt: pip install paho-mqtt")
+        client = mqtt.Client()
+        client.on_connect = lambda c, u, f, rc: c.subscribe(f"{args.device}/{args.topic}", qos=0)
+        client.on_message = lambda c, u, msg: on_block(msg.payload)
+        client.connect(args.broker, args.mqtt_port)
+        client.loop_start()
+        if args.enable:
+            client.publish(f"{args.device}/imu/raw", "on", qos=1)
+    else:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("needs pyserial: pip install pyserial")
+        if not args.port:
+            sys.exit("serial needs --port")
+        ser = serial.Serial(args.port, args.baud, timeout=0.1)
+        deframer = SerialDeframer(stats)
+
+    start = next_report = time.time()
+    try:
+        while not args.duration or time.time() - start < args.duration:
+            if ser:
+                for block in deframer.feed(ser.read(4096)):
+                    on_block(block)
+            else:
+                time.sleep(0.1)
+            if args.stats and time.time() >= next_report:
+                print(stats.report(), flush=True)
+                next_report += args.stats
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if client:
+            if args.enable:
+                client.publish(f"{args.device}/imu/raw", "off", qos=1).wait_for_publish(2.0)
+            client.loop_stop()
+            client.disconnect()
+        if ser:
+            ser.close()
+        if out:
+            out.close()
+        print(stats.report())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Ground-side splitter for FirePilot telemetry bundles.
+
+Subscribes to `<device>/telemetry/bundle` (see src/telemetry/telemetry_bundle.hpp),
+splits each frame back into its samples and republishes them under their original
+topics (`<device>/<suffix>`), writes them to a JSON-lines file, or both. Also
+reports lost frames and how many samples each frame carried.
+
+    python3 tools/telemetry_bundle_rx.py --broker localhost --device guspet24 --republish
+    python3 tools/telemetry_bundle_rx.py --broker localhost --device guspet24 --out bundle.jsonl
+    python3 tools/telemetry_bundle_rx.py --decode frame.bin   # one captured frame
+
+Needs paho-mqtt (pip install paho-mqtt) except with --decode.
+"""
+
+import argparse
+import base64
+import json
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<BBHI")  # version, count, seq, t0_us
+RECORD = struct.Struct("<BBHHI")  # topic_len, flags, payload_len, stream_seq, t_us
+VERSION = 2
+FLAG_FULL_TOPIC = 0x80
+CONTENT_NAMES = {0: "json", 1: "cbor", 2: "binary", 3: "text", 4: "delta"}
+
+
+def decode(frame):
+    """Return (seq, t0_us, [(suffix, full_topic, content, stream_seq, t_us, payload), ...]) or None if malformed."""
+    if len(frame) < HEADER.size:
+        return None
+    version, count, seq, t0_us = HEADER.unpack_from(frame)
+    if version != VERSION:
+        return None
+    pos, records = HEADER.size, []
+    for _ in range(count):
+        if pos + RECORD.size > len(frame):
+            return None
+        topic_len, flags, payload_len, stream_seq, t_us = RECORD.unpack_from(frame, pos)
+        pos += RECORD.size
+        end = pos + topic_len + payload_len
+        if end > len(frame):
+            return None
+        topic = frame[pos:pos + topic_len].decode("utf-8", "replace")
+        payload = frame[pos + topic_len:end]
+        records.append((topic, bool(flags & FLAG_FULL_TOPIC), flags & 0x0F, stream_seq, t_us, payload))
+        pos = end
+    return seq, t0_us, records
+
+
+class BundleStats:
+    def __init__(self):
+        self.frames = self.samples = self.lost = self.malformed = 0
+        self.frame_bytes = self.payload_bytes = 0
+        self.last_seq = None
+
+    def update(self, frame, seq, records):
+        if self.last_seq is not None:
+            gap = (seq - self.last_seq - 1) & 0xFFFF
+            if gap < 0x8000:  # otherwise a restart or a duplicate
+                self.lost += gap
+        self.last_seq = seq
+        self.frames += 1
+        self.samples += len(records)
+        self.frame_bytes += len(frame)
+        self.payload_bytes += sum(len(r[5]) for r in records)
+
+    def report(self):
+        per = self.samples / self.frames if self.frames else 0.0
+        eff = 100.0 * self.payload_bytes / self.frame_bytes if self.frame_bytes else 0.0
+        return (f"frames {self.frames} (lost {self.lost}, malformed {self.malformed}) samples {self.samples} "
+                f"| {per:.1f} samples/frame, payload {eff:.0f}% of frame bytes")
+
+
+def record_json(device, rx_us, seq, t0_us, rec):
+    suffix, full, content, stream_seq, t_us, payload = rec
+    out = {"t_rx_us": rx_us, "topic": suffix if full else f"{device}/{suffix}", "bundle_seq": seq,
+           "seq": stream_seq, "sender_us": t_us, "content": CONTENT_NAMES.get(content, content)}
+    if content in (0, 3):
+        out["payload"] = payload.decode("utf-8", "replace")
+    else:
+        out["payload_b64"] = base64.b64encode(payload).decode("ascii")
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--broker", default="localhost")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--device", default="guspet24", help="device ID (DEVICE_ID in main.cpp)")
+    ap.add_argument("--republish", action="store_true", help="publish samples under their original topics")
+    ap.add_argument("--out", metavar="FILE", help="append samples as JSON lines")
+    ap.add_argument("--stats", type=float, default=5.0, help="stats interval in seconds (0 = off)")
+    ap.add_argument("--decode", metavar="FILE", help="decode one raw frame from a file and exit")
+    args = ap.parse_args()
+
+    if args.decode:
+        with open(args.decode, "rb") as f:
+            msg = decode(f.read())
+        if msg is None:
+            sys.exit("malformed frame")
+        seq, t0_us, records = msg
+        for rec in records:
+            print(json.dumps(record_json(args.device, 0, seq, t0_us, rec)))
+        return
+
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("needs paho-mqtt: pip install paho-mqtt")
+
+    out = open(args.out, "a", encoding="utf-8", buffering=1) if args.out else None  # line buffered
+    stats = BundleStats()
+    bundle_topic = f"{args.device}/telemetry/bundle"
+
+    def on_connect(client, userdata, flags, rc):
+        client.subscribe(bundle_topic, qos=0)
+
+    def on_message(client, userdata, msg):
+        rx_us = time.monotonic_ns() // 1000
+        decoded = decode(msg.payload)
+        if decoded is None:
+            stats.malformed += 1
+            return
+        seq, t0_us, records = decoded
+        stats.update(msg.payload, seq, records)
+        for rec in records:
+            if args.republish:
+                suffix, full = rec[0], rec[1]
+                client.publish(suffix if full else f"{args.device}/{suffix}", rec[5], qos=0)
+            if out:
+                out.write(json.dumps(record_json(args.device, rx_us, seq, t0_us, rec)) + "\n")
+
+    client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.broker, args.port)
+    client.loop_start()
+    try:
+        while True:
+            time.sleep(args.stats if args.stats else 1.0)
+            if args.stats:
+                print(stats.report(), flush=True)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out:
+            out.close()
+        client.loop_stop()
+        client.disconnect()
+
+
+if __name__ == "__main__":
+    main()
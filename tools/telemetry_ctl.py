@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Hold a lease on FirePilot telemetry streams (see src/telemetry/telemetry_stream_control.hpp).
+
+Sends `on`/`off` on `<device>/telemetry/ctl` and renews it before the lease runs out, for as
+long as the tool runs; on exit it sends `auto` so the provider goes back to its default.
+Prints `<device>/telemetry/status` whenever it changes.
+
+    python3 tools/telemetry_ctl.py --device guspet24 on IMU_MPU_9250 --hz 20
+    python3 tools/telemetry_ctl.py --device guspet24 off '*' --lease 60
+    python3 tools/telemetry_ctl.py --device guspet24 status
+
+Needs paho-mqtt (pip install paho-mqtt).
+"""
+
+import argparse
+import sys
+import time
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--broker", default="localhost")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--device", default="guspet24", help="device ID (DEVICE_ID in main.cpp)")
+    ap.add_argument("--hz", type=int, default=0, help="rate cap for 'on' (0 = uncapped)")
+    ap.add_argument("--lease", type=int, default=30, help="lease in seconds, renewed at 2/3")
+    ap.add_argument("action", choices=["on", "off", "status"])
+    ap.add_argument("provider", nargs="?", default="*", help="provider name() or '*'")
+    args = ap.parse_args()
+
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("needs paho-mqtt: pip install paho-mqtt")
+
+    ctl = f"{args.device}/telemetry/ctl"
+    status = f"{args.device}/telemetry/status"
+    if args.action == "on":
+        cmd = f"on {args.provider} {args.hz} {args.lease}"
+    elif args.action == "off":
+        cmd = f"off {args.provider} {args.lease}"
+    else:
+        cmd = "status"
+
+    def on_connect(client, userdata, flags, rc):
+        client.subscribe(status, qos=0)
+
+    def on_message(client, userdata, msg):
+        print(msg.payload.decode("utf-8", "replace"), flush=True)
+
+    client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.broker, args.port)
+    client.loop_start()
+    try:
+        if args.action == "status":
+            client.publish(ctl, cmd, qos=1).wait_for_publish()
+            time.sleep(2.0)
+            return
+        while True:
+            client.publish(ctl, cmd, qos=1)
+            time.sleep(max(1.0, args.lease * 2 / 3))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.action != "status":
+            client.publish(ctl, f"auto {args.provider}", qos=1).wait_for_publish()
+        client.loop_stop()
+        client.disconnect()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""End-to-end loss and latency accounting for FirePilot telemetry streams.
+
+Every registered stream stamps its samples with a per-stream `seq` and the capture time
+`t_us` (see src/telemetry/telemetry_stream_stats.hpp). Bundle records and UDP datagrams
+carry both. This tool listens to those and to the device's own accounting on
+`<device>/telemetry/streams`, and splits the samples each stream lost by stage:
+
+    stamped = received + enqueue drops + TX failures + lost after the device (network/outbox)
+
+It also prints the capture -> hand-off age the device measured and the capture -> arrival
+age seen here. The clocks are not synchronized, so the arrival age is relative to the
+fastest observed transit, like tools/udp_telemetry_rx.py.
+
+    python3 tools/telemetry_stats_rx.py --broker localhost --device guspet24
+    python3 tools/telemetry_stats_rx.py --broker localhost --device guspet24 --udp-port 47000
+
+Plain MQTT publishes carry no seq; streams that only go that way get the device-side
+columns, and the outbox losses are in the device-wide `*` line. The `class` lines show the
+TX queue's priority classes (depth, policy, high water and what each policy dropped). Needs paho-mqtt
+(pip install paho-mqtt).
+"""
+
+import argparse
+import json
+import socket
+import sys
+import threading
+import time
+
+from telemetry_bundle_rx import decode as decode_bundle
+from udp_telemetry_rx import decode as decode_udp
+
+
+def percentiles(values):
+    d = sorted(values)
+    if not d:
+        return 0.0, 0.0, 0.0
+    p = lambda q: d[min(len(d) - 1, int(q * (len(d) - 1) + 0.5))] / 1000.0
+    return p(0.5), p(0.99), d[-1] / 1000.0
+
+
+class Stream:
+    """Receiver side of one stream: seq range, count and arrival age."""
+
+    def __init__(self):
+        self.first = self.newest = None
+        self.received = 0
+        self.min_offset_us = None
+        self.age_us = []
+        self.device = None      # newest telemetry/streams report
+        self.device_first = None
+
+    def sample(self, seq, t_us, arrival_us):
+        if self.first is None:
+            self.first = self.newest = seq
+        elif 0 < (seq - self.newest) & 0xFFFFFFFF < 0x80000000:
+            self.newest = seq
+        self.received += 1
+        offset = arrival_us - t_us  # t_us wraps every ~71 min; an outlier per wrap
+        if self.min_offset_us is None or offset < self.min_offset_us:
+            self.min_offset_us = offset
+        self.age_us.append(offset - self.min_offset_us)
+
+    def report(self, name):
+        line = name
+        dev, first = self.device, self.device_first
+        if dev:
+            line += (f" | device: seq {dev['seq']} enq_drop {dev['enq_drop']} tx_fail {dev['tx_fail']} "
+                     f"buffered {dev['buffered']} sent {dev['sent']}, age p50 {dev['age_p50_us'] / 1000:.1f} "
+                     f"p99 {dev['age_p99_us'] / 1000:.1f} max {dev['age_max_us'] / 1000:.1f} ms")
+        if self.first is not None:
+            expected = ((self.newest - self.first) & 0xFFFFFFFF) + 1
+            missing = max(0, expected - self.received)
+            line += f" | rx {self.received}/{expected}"
+            if dev and first:
+                # Device drops over the same span; the rest went missing after the hand-off
+                device_lost = (dev["enq_drop"] - first["enq_drop"]) + (dev["tx_fail"] - first["tx_fail"])
+                line += f", lost on device {min(device_lost, missing)}, after {max(0, missing - device_lost)}"
+            else:
+                line += f", lost {missing}"
+            p50, p99, mx = percentiles(self.age_us)
+            line += f" | arrival age p50 {p50:.1f} p99 {p99:.1f} max {mx:.1f} ms"
+        self.age_us = []
+        return line
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--broker", default="localhost")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--device", default="guspet24", help="device ID (DEVICE_ID in main.cpp)")
+    ap.add_argument("--udp-port", type=int, help="also listen for UDP telemetry (UDP_TELEMETRY_PORT)")
+    ap.add_argument("--stats", type=float, default=5.0, help="report interval in seconds")
+    args = ap.parse_args()
+
+    try:
+        import paho.mqtt.client as mqtt
+    except ImportError:
+        sys.exit("needs paho-mqtt: pip install paho-mqtt")
+
+    prefix = f"{args.device}/"
+    streams, lock = {}, threading.Lock()
+    device_wide = {}
+    classes = {}
+
+    def stream(name):
+        return streams.setdefault(name[len(prefix):] if name.startswith(prefix) else name, Stream())
+
+    def on_connect(client, userdata, flags, rc):
+        client.subscribe(f"{prefix}telemetry/streams", qos=0)
+        client.subscribe(f"{prefix}telemetry/bundle", qos=0)
+
+    def on_message(client, userdata, msg):
+        arrival_us = time.monotonic_ns() // 1000
+        with lock:
+            if msg.topic.endswith("/telemetry/bundle"):
+                decoded = decode_bundle(msg.payload)
+                if decoded is None:
+                    return
+                for suffix, full, _, seq, t_us, _ in decoded[2]:
+                    stream(suffix).sample(seq, t_us, arrival_us)
+                return
+            try:
+                rep = json.loads(msg.payload)
+            except ValueError:
+                return
+            if "class" in rep:
+                classes[rep["class"]] = rep
+                return
+            if rep.get("stream") == "*":
+                device_wide.update(rep)
+                return
+            st = stream(rep.get("stream", "?"))
+            st.device = rep
+            if st.device_first is None:
+                st.device_first = rep
+
+    def udp_loop(sock):
+        while True:
+            data, _ = sock.recvfrom(2048)
+            arrival_us = time.monotonic_ns() // 1000
+            msg = decode_udp(data)
+            if msg is None:
+                continue
+            topic, _, _, _, seq, sender_us = msg
+            with lock:
+                stream(topic).sample(seq, sender_us, arrival_us)
+
+    if args.udp_port:
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+        sock.bind(("0.0.0.0", args.udp_port))
+        threading.Thread(target=udp_loop, args=(sock,), daemon=True).start()
+
+    client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.broker, args.port)
+    client.loop_start()
+    try:
+        while True:
+            time.sleep(args.stats)
+            with lock:
+                for name, st in sorted(streams.items()):
+                    print(st.report(name), flush=True)
+                for name in ("critical", "control", "bulk"):
+                    c = classes.get(name)
+                    if c:
+                        print(f"class {name} ({c['policy']}, depth {c['depth']}) | waiting {c['waiting']} "
+                              f"hw {c['hw']} queued {c['queued']} sent {c['sent']} | "
+                              f"drop newest {c['drop_newest']} oldest {c['drop_oldest']} "
+                              f"replaced {c['replaced']}", flush=True)
+                if device_wide:
+                    print(f"* | outbox replaced {device_wide.get('outbox_replaced', 0)} "
+                          f"evicted {device_wide.get('outbox_evicted', 0)} "
+                          f"rejected {device_wide.get('outbox_rejected', 0)} "
+                          f"pool exhausted {device_wide.get('pool_exhausted', 0)}", flush=True)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        client.loop_stop()
+        client.disconnect()
+
+
+if __name__ == "__main__":
+    main()
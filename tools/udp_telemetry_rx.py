@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Ground-side receiver for the FirePilot UDP telemetry fast path.
+
+Listens for datagrams sent by TelemetryService (see
+src/services/transport/udp_datagram.hpp), tracks loss/reordering per stream
+and either republishes each sample to a local MQTT broker under its original
+topic, writes it to a JSON-lines file, or both.
+
+    python3 tools/udp_telemetry_rx.py --port 5600 --mqtt localhost
+    python3 tools/udp_telemetry_rx.py --port 5600 --out imu.jsonl
+
+Republishing needs paho-mqtt (pip install paho-mqtt); file output does not.
+"""
+
+import argparse
+import base64
+import json
+import socket
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<BBBBII")  # version, topic_len, content, flags, seq, sender_us
+VERSION = 1
+FLAG_RESTART = 0x01
+CONTENT_NAMES = {0: "json", 1: "cbor", 2: "binary", 3: "text", 4: "delta"}
+
+
+def decode(data):
+    """Return (topic, payload, content, flags, seq, sender_us) or None if malformed."""
+    if len(data) < HEADER.size:
+        return None
+    version, topic_len, content, flags, seq, sender_us = HEADER.unpack_from(data)
+    if version != VERSION or topic_len == 0 or HEADER.size + topic_len > len(data):
+        return None
+    topic = data[HEADER.size:HEADER.size + topic_len].decode("utf-8", "replace")
+    payload = data[HEADER.size + topic_len:]
+    return topic, payload, content, flags, seq, sender_us
+
+
+class StreamStats:
+    """Mirror of UdpSequenceTracker plus arrival timing."""
+
+    def __init__(self):
+        self.started = False
+        self.newest = 0
+        self.received = self.lost = self.reordered = self.duplicate = self.restarts = 0
+        self.sender_base = 0       # sender_us is 32-bit and wraps every ~71 min
+        self.last_sender_us = None
+        self.min_offset_us = None  # lowest (arrival - sender) seen = fastest transit
+        self.delay_us = []         # arrival delay above the fastest transit, this interval
+
+    def update(self, seq, flags, sender_us, arrival_us):
+        if flags & FLAG_RESTART:
+            self.sender_base = 0
+        elif self.last_sender_us is not None and sender_us < self.last_sender_us - 0x80000000:
+            self.sender_base += 1 << 32
+        self.last_sender_us = sender_us
+
+        # Relative one-way delay: clocks are not synchronized, so measure against the best case
+        offset = arrival_us - (self.sender_base + sender_us)
+        if self.min_offset_us is None or offset < self.min_offset_us or (flags & FLAG_RESTART):
+            self.min_offset_us = offset
+        self.delay_us.append(offset - self.min_offset_us)
+
+        if not self.started or (flags & FLAG_RESTART):
+            if self.started:
+                self.restarts += 1
+            self.started = True
+            self.newest = seq
+            self.received += 1
+            return
+        diff = (seq - self.newest) & 0xFFFFFFFF
+        if diff >= 0x80000000:
+            diff -= 0x100000000
+        if diff == 0:
+            self.duplicate += 1
+            return
+        self.received += 1
+        if diff > 0:
+            self.lost += diff - 1
+            self.newest = seq
+        else:
+            self.lost = max(0, self.lost - 1)
+            self.reordered += 1
+
+    def report(self, topic):
+        d = sorted(self.delay_us)
+        self.delay_us = []
+        p = (lambda q: d[min(len(d) - 1, int(q * (len(d) - 1) + 0.5))] / 1000.0) if d else (lambda q: 0.0)
+        total = self.received + self.lost
+        loss = 100.0 * self.lost / total if total else 0.0
+        return (f"{topic}: rx {self.received} lost {self.lost} ({loss:.2f}%) reord {self.reordered} "
+                f"dup {self.duplicate} restarts {self.restarts} | extra delay p50 {p(0.5):.1f} ms "
+                f"p99 {p(0.99):.1f} ms max {p(1.0):.1f} ms")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--bind", default="0.0.0.0", help="local address to listen on")
+    ap.add_argument("--port", type=int, required=True, help="UDP port (UDP_TELEMETRY_PORT in main.cpp)")
+    ap.add_argument("--mqtt", metavar="HOST", help="republish to this MQTT broker")
+    ap.add_argument("--mqtt-port", type=int, default=1883)
+    ap.add_argument("--out", metavar="FILE", help="append samples as JSON lines")
+    ap.add_argument("--stats", type=float, default=5.0, help="stats interval in seconds (0 = off)")
+    args = ap.parse_args()
+
+    client = None
+    if args.mqtt:
+        try:
+            import paho.mqtt.client as mqtt
+        except ImportError:
+            sys.exit("--mqtt needs paho-mqtt: pip install paho-mqtt")
+        client = mqtt.Client()
+        client.connect(args.mqtt, args.mqtt_port)
+        client.loop_start()
+
+    out = open(args.out, "a", encoding="utf-8", buffering=1) if args.out else None  # line buffered
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind((args.bind, args.port))
+    sock.settimeout(0.5)
+
+    streams = {}
+    malformed = 0
+    next_report = time.monotonic() + args.stats
+    try:
+        while True:
+            try:
+                data, _ = sock.recvfrom(2048)
+            except socket.timeout:
+                data = None
+
+            if data is not None:
+                arrival_us = time.monotonic_ns() // 1000
+                msg = decode(data)
+                if msg is None:
+                    malformed += 1
+                else:
+                    topic, payload, content, flags, seq, sender_us = msg
+                    streams.setdefault(topic, StreamStats()).update(seq, flags, sender_us, arrival_us)
+                    if client:
+                        client.publish(topic, payload, qos=0)
+                    if out:
+                        rec = {"t_rx_us": arrival_us, "topic": topic, "seq": seq, "sender_us": sender_us,
+                               "content": CONTENT_NAMES.get(content, content)}
+                        if content in (0, 3):
+                            rec["payload"] = payload.decode("utf-8", "replace")
+                        else:
+                            rec["payload_b64"] = base64.b64encode(payload).decode("ascii")
+                        out.write(json.dumps(rec) + "\n")
+
+            if args.stats and time.monotonic() >= next_report:
+                next_report += args.stats
+                for topic, st in sorted(streams.items()):
+                    print(st.report(topic), flush=True)
+                if malformed:
+                    print(f"malformed datagrams: {malformed}", flush=True)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out:
+            out.close()
+        if client:
+            client.loop_stop()
+            client.disconnect()
+
+
+if __name__ == "__main__":
+    main()